@@ -1,16 +1,62 @@
-#include <wrl.h>
-#include <d3d12.h>
-#include <d3dcompiler.h>
-#include <dxgi1_6.h>
-
 #include "Application.h"
+#include "AssetArchive.h"
+#include "AssetStreamer.h"
+#include "D3D12Helpers.h"
+#include "DynamicResolution.h"
+#include "EntityStore.h"
+#include "JobSystem.h"
+#include "LatencyTracker.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "ParallelCommandRecorder.h"
+#include "ProceduralTexture.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include "SingleProducerSingleConsumerQueue.h"
+#include "VisibilityCuller.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <thread>
 #include <vector>
 
-using Microsoft::WRL::ComPtr;
+enum class InputEventType : UINT8
+{
+	KeyPressed,
+	KeyReleased
+};
+
+struct InputEvent
+{
+	InputEventType Type;
+	UINT8 Key;
+	LatencyClock::time_point Timestamp;
+};
+
+// Scene components; the transform is stored exactly as the instance batcher consumes it
+struct MeshComponent
+{
+	uint32_t MeshId;
+};
+
+struct MaterialComponent
+{
+	uint32_t MaterialId;
+};
+
+// Translation per second in normalized device coordinates
+struct MotionComponent
+{
+	float Velocity[2];
+};
 
-void ThrowIfFailed(HRESULT Result)
+static PresentMode ParsePresentMode(const WCHAR* Name)
 {
-	if (FAILED(Result)) throw std::runtime_error("HRESULT Failed");
+	if (_wcsicmp(Name, L"uncapped") == 0) return PresentMode::Uncapped;
+	if (_wcsicmp(Name, L"capped") == 0) return PresentMode::Capped;
+	if (_wcsicmp(Name, L"lowlatency") == 0) return PresentMode::LowLatency;
+	return PresentMode::Vsync;
 }
 
 class Application::ApplicationImplementation
@@ -26,14 +72,6 @@ public:
 			*(LastSlash + 1) = L'\0';
 		}
 		PathToAssets = PathToAssetsBuffer;
-
-		Viewport = { 0.0f, 0.0f, static_cast<float>(GetWidth()), static_cast<float>(GetHeight()) };
-		ScissorRectangle = { 0, 0, static_cast<LONG>(GetWidth()), static_cast<LONG>(GetHeight()) };
-
-		for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
-		{
-			FrameSignalValue[FrameIndex] = 0;
-		}
 	}
 
 	~ApplicationImplementation() = default;
@@ -45,601 +83,732 @@ public:
 
 	void ParseCommandLineArguments(WCHAR* Arguments[], int NumberOfArguments)
 	{
-
+		for (int ArgumentIndex = 1; ArgumentIndex < NumberOfArguments; ArgumentIndex++)
+		{
+			if (_wcsicmp(Arguments[ArgumentIndex], L"-headless") == 0)
+			{
+				UseHeadlessDevice = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-workers") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				WorkerCount = static_cast<UINT>(std::max(_wtoi(Arguments[++ArgumentIndex]), 1));
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-frames") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				FrameCount = static_cast<UINT>(std::min(std::max(_wtoi(Arguments[++ArgumentIndex]), 2), static_cast<int>(RenderDevice::MaximumFrameCount)));
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-present") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				Pacing.Mode = ParsePresentMode(Arguments[++ArgumentIndex]);
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-fps") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				Pacing.Mode = PresentMode::Capped;
+				Pacing.TargetFramesPerSecond = std::max(_wtof(Arguments[++ArgumentIndex]), 1.0);
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-inflight") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				Pacing.FramesInFlight = static_cast<uint32_t>(std::min(std::max(_wtoi(Arguments[++ArgumentIndex]), 1), static_cast<int>(RenderDevice::MaximumFrameCount)));
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-profile") == 0)
+			{
+				ProfileFrames = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-dynres") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				DynamicResolutionBudget = std::max(_wtof(Arguments[++ArgumentIndex]), 1.0);
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-latency") == 0)
+			{
+				MeasureLatency = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-stream") == 0)
+			{
+				StreamTextures = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-archive") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				ArchivePath = Arguments[++ArgumentIndex];
+				StreamTextures = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-kaiser") == 0)
+			{
+				TextureMipFilter = MipFilter::Kaiser;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-bc1") == 0)
+			{
+				TextureStorageFormat = TextureFormat::Bc1;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-bc3") == 0)
+			{
+				TextureStorageFormat = TextureFormat::Bc3;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-bc7") == 0)
+			{
+				TextureStorageFormat = TextureFormat::Bc7;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-floatvertices") == 0)
+			{
+				GeometryFormat = VertexFormat::Float;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-hotreload") == 0)
+			{
+				WatchShaders = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-instances") == 0 && ArgumentIndex + 1 < NumberOfArguments)
+			{
+				SceneInstanceCount = static_cast<UINT>(std::max(_wtoi(Arguments[++ArgumentIndex]), 0));
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-indirect") == 0)
+			{
+				UseIndirectDraws = true;
+			}
+			else if (_wcsicmp(Arguments[ArgumentIndex], L"-nocull") == 0)
+			{
+				CullScene = false;
+			}
+		}
 	}
 
 	void Initialize()
 	{
-		UINT DxgiFactoryFlags = 0;
-#ifdef _DEBUG
+		StartupBegin = LatencyClock::now();
+		// Dynamic resolution reads the GPU frame times the profiler collects, without capturing a trace
+		if (ProfileFrames || DynamicResolutionBudget > 0.0)
 		{
-			ComPtr<ID3D12Debug1> DebugController;
-			if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&DebugController))))
-			{
-				DebugController->EnableDebugLayer();
-				// DebugController->SetEnableGPUBasedValidation(TRUE);
-				DxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
-			}
+			Profiling = std::make_unique<Profiler>();
+			Profiling->SetCapturing(ProfileFrames);
+		}
+		if (DynamicResolutionBudget > 0.0)
+		{
+			DynamicResolutionDescription Resolution;
+			Resolution.BudgetMilliseconds = DynamicResolutionBudget;
+			DynamicResolution = std::make_unique<DynamicResolutionController>(Resolution);
 		}
-#endif
+		Jobs = std::make_unique<JobSystem>(WorkerCount);
+		Device = UseHeadlessDevice ? CreateHeadlessRenderDevice() : CreateD3D12RenderDevice();
+
+		RenderDeviceDescription Description;
+		Description.WindowHandle = Window;
+		Description.PathToAssets = PathToAssets;
+		Description.Width = GetInitialWidth();
+		Description.Height = GetInitialHeight();
+		Description.FrameCount = FrameCount;
+		Pacing.FramesInFlight = std::min(Pacing.FramesInFlight, FrameCount);
+		Description.Pacing = Pacing;
+		Description.Jobs = Jobs.get();
+		Description.TextureMipFilter = TextureMipFilter;
+		Description.GeometryFormat = GeometryFormat;
+		Description.WatchShaders = WatchShaders;
+		Description.Profiling = Profiling.get();
+		Device->Initialize(Description);
+
+		CommandList = Device->CreateCommandList();
+		Recorder = std::make_unique<ParallelCommandRecorder>(*Device, *Jobs);
+		Culler = std::make_unique<VisibilityCuller>(Jobs.get());
+
+		// Create Geometry
+		{
+			// The device stretches y by the aspect ratio, so the meshes stay square when the window is resized
+			const Vertex TriangleCorners[] =
+			{
+				{ {  0.0f,   0.25f, 0.0f }, { 0.5f, 1.0f } },
+				{ {  0.25f, -0.25f, 0.0f }, { 1.0f, 0.0f } },
+				{ { -0.25f, -0.25f, 0.0f }, { 0.0f, 0.0f } }
+			};
+			const Vertex QuadCorners[] =
+			{
+				{ { -0.25f,  0.25f, 0.0f }, { 0.0f, 1.0f } },
+				{ {  0.25f,  0.25f, 0.0f }, { 1.0f, 1.0f } },
+				{ {  0.25f, -0.25f, 0.0f }, { 1.0f, 0.0f } },
+				{ { -0.25f,  0.25f, 0.0f }, { 0.0f, 1.0f } },
+				{ {  0.25f, -0.25f, 0.0f }, { 1.0f, 0.0f } },
+				{ { -0.25f, -0.25f, 0.0f }, { 0.0f, 0.0f } }
+			};
 
-		ComPtr<IDXGIFactory5> Factory;
-		ThrowIfFailed(CreateDXGIFactory2(DxgiFactoryFlags, IID_PPV_ARGS(&Factory)));
+			std::vector<Vertex> Vertices;
+			std::vector<uint32_t> Indices;
+			AppendOptimizedMesh(L"Triangle", TriangleCorners, _countof(TriangleCorners), Meshes[0], Vertices, Indices);
+			AppendOptimizedMesh(L"Quad", QuadCorners, _countof(QuadCorners), Meshes[1], Vertices, Indices);
+			Device->CreateGeometry(Vertices.data(), static_cast<uint32_t>(Vertices.size()), Indices.data(), static_cast<uint32_t>(Indices.size()));
+			CreateScene(static_cast<float>(Device->GetWidth()) / static_cast<float>(Device->GetHeight()));
+		}
 
-		// Create Device
+		// Create Texture
 		{
-			ComPtr<IDXGIAdapter4> ChosenAdapter;
-
-			SIZE_T MaximumVideoMemory = 0;
-			ComPtr<IDXGIAdapter1> Adapter;
-			DXGI_ADAPTER_DESC1 Description;
-			for (UINT AdapterIndex = 0; Factory->EnumAdapters1(AdapterIndex, &Adapter) != DXGI_ERROR_NOT_FOUND; AdapterIndex++)
+			if (StreamTextures)
 			{
-				Adapter->GetDesc1(&Description);
-				if ((Description.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0) continue;
-
-				if (SUCCEEDED(D3D12CreateDevice(Adapter.Get(), D3D_FEATURE_LEVEL_12_1, _uuidof(ID3D12Device3), nullptr)) &&
-					Description.DedicatedVideoMemory > MaximumVideoMemory)
+				Streamer = std::make_unique<AssetStreamer>(*Device, StreamingBudget);
+				const AssetArchiveEntry* ArchivedTexture = ArchivePath.empty() ? nullptr : OpenArchiveTexture();
+				if (ArchivedTexture != nullptr)
+				{
+					StreamRequest Request;
+					Request.Width = ArchivedTexture->Width;
+					Request.Height = ArchivedTexture->Height;
+					Request.Format = ArchivedTexture->Format;
+					Request.Load = [this, ArchivedTexture](const TextureStreamStaging& Staging)
+					{
+						return Archive.ReadTexture(*ArchivedTexture, Staging);
+					};
+					TextureTicket = Streamer->Request(std::move(Request));
+					TextureFromArchive = true;
+				}
+				else
 				{
-					MaximumVideoMemory = Description.DedicatedVideoMemory;
-					Adapter.As(&ChosenAdapter);
+					TextureTicket = Streamer->Request(CreateCheckerboardRequest());
 				}
 			}
-
-			ThrowIfFailed(D3D12CreateDevice(ChosenAdapter.Get(), D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(&Device)));
+			else
+			{
+				std::vector<UINT8> TextureData(4 * TextureSize * TextureSize);
+				GenerateProceduralTexture(GetCheckerboardDescription(), &TextureData[0], 4 * TextureSize, Jobs.get());
+
+				TextureDescription CheckerboardTexture;
+				CheckerboardTexture.Width = TextureSize;
+				CheckerboardTexture.Height = TextureSize;
+				CheckerboardTexture.Format = TextureStorageFormat;
+				Device->CreateTexture(CheckerboardTexture, &TextureData[0]);
+			}
 		}
 
-		// Create Command Queue
-		{
-			D3D12_COMMAND_QUEUE_DESC QueueDescription = {};
-			QueueDescription.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-			QueueDescription.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		Device->FinishUploads();
+		ReportStartupTime(L"Initialize");
+	}
 
-			ThrowIfFailed(Device->CreateCommandQueue(&QueueDescription, IID_PPV_ARGS(&CommandQueue)));
-		}
+	void Update()
+	{
+		// Blocks until the frame may start, so the input consumed below is as recent as the present mode allows
+		Device->BeginFrame();
+		ProfileScope Scope(Profiling.get(), "Update");
 
-		// Create Swap Chain
+		// Only the latest size matters when the window thread resized several times during one frame
+		const uint64_t ResizedSize = PendingSize.exchange(0, std::memory_order_acquire);
+		if (ResizedSize != 0)
 		{
-			DXGI_SWAP_CHAIN_DESC1 SwapChainDescription = {};
-			SwapChainDescription.BufferCount = FrameCount;
-			SwapChainDescription.Width = GetWidth();
-			SwapChainDescription.Height = GetHeight();
-			SwapChainDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			SwapChainDescription.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-			SwapChainDescription.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-			SwapChainDescription.SampleDesc.Count = 1;
-
-			ComPtr<IDXGISwapChain1> TemporarySwapChain;
-			ThrowIfFailed(Factory->CreateSwapChainForHwnd(
-				CommandQueue.Get(),
-				Window,
-				&SwapChainDescription,
-				nullptr,
-				nullptr,
-				&TemporarySwapChain
-			));
-
-			ThrowIfFailed(Factory->MakeWindowAssociation(Window, DXGI_MWA_NO_ALT_ENTER));
-			ThrowIfFailed(TemporarySwapChain.As(&SwapChain));
-			CurrentFrameIndex = SwapChain->GetCurrentBackBufferIndex();
+			Device->Resize(static_cast<uint32_t>(ResizedSize >> 32), static_cast<uint32_t>(ResizedSize));
 		}
+		MeshExtents[1] = 0.25f * static_cast<float>(Device->GetWidth()) / static_cast<float>(Device->GetHeight());
 
-		// Create Descriptor Heaps
+		if (DynamicResolution != nullptr)
 		{
-			D3D12_DESCRIPTOR_HEAP_DESC RenderTargetHeapDescription = {};
-			RenderTargetHeapDescription.NumDescriptors = FrameCount;
-			RenderTargetHeapDescription.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-			RenderTargetHeapDescription.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-			ThrowIfFailed(Device->CreateDescriptorHeap(&RenderTargetHeapDescription, IID_PPV_ARGS(&RenderTargetHeap)));
-			RenderTargetDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-			D3D12_DESCRIPTOR_HEAP_DESC ShaderResourceHeapDescription = {};
-			ShaderResourceHeapDescription.NumDescriptors = 1;
-			ShaderResourceHeapDescription.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-			ShaderResourceHeapDescription.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-			ThrowIfFailed(Device->CreateDescriptorHeap(&ShaderResourceHeapDescription, IID_PPV_ARGS(&ShaderResourceHeap)));
+			UpdateRenderScale();
 		}
 
-		// Create Render Targets
+		InputEvent Event;
+		while (InputQueue.TryPop(Event))
 		{
-			auto Handle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
-			for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+			if (MeasureLatency)
+			{
+				Latency.OnInputConsumed(Event.Timestamp);
+			}
+			// Key repeat sends further presses, only the first one of a press changes the pacing
+			if (Event.Type == InputEventType::KeyPressed && !KeyStates[Event.Key])
 			{
-				ThrowIfFailed(SwapChain->GetBuffer(FrameIndex, IID_PPV_ARGS(&RenderTargets[FrameIndex])));
-				Device->CreateRenderTargetView(RenderTargets[FrameIndex].Get(), nullptr, Handle);
-				Handle.ptr += RenderTargetDescriptorSize;
+				ChangeFramePacing(Event.Key);
 			}
+			KeyStates[Event.Key] = Event.Type == InputEventType::KeyPressed;
 		}
 
-		// Create Root Signature
+		if (Streamer != nullptr)
 		{
-			D3D12_FEATURE_DATA_ROOT_SIGNATURE FeatureData = {};
-			FeatureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-
-			D3D12_DESCRIPTOR_RANGE1 DescriptorRange;
-			DescriptorRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-			DescriptorRange.NumDescriptors = 1;
-			DescriptorRange.BaseShaderRegister = 0;
-			DescriptorRange.RegisterSpace = 0;
-			DescriptorRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-			DescriptorRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
-
-			D3D12_ROOT_PARAMETER1 RootParameter;
-			RootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-			RootParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-			RootParameter.DescriptorTable.pDescriptorRanges = &DescriptorRange;
-			RootParameter.DescriptorTable.NumDescriptorRanges = 1;
-
-			D3D12_STATIC_SAMPLER_DESC Sampler = {};
-			Sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
-			Sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-			Sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-			Sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-			Sampler.MipLODBias = 0;
-			Sampler.MaxAnisotropy = 0;
-			Sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-			Sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-			Sampler.MinLOD = 0.0f;
-			Sampler.MaxLOD = D3D12_FLOAT32_MAX;
-			Sampler.ShaderRegister = 0;
-			Sampler.RegisterSpace = 0;
-			Sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-
-			D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDescription;
-			RootSignatureDescription.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
-			RootSignatureDescription.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-			RootSignatureDescription.Desc_1_1.pParameters = &RootParameter;
-			RootSignatureDescription.Desc_1_1.NumParameters = 1;
-			RootSignatureDescription.Desc_1_1.pStaticSamplers = &Sampler;
-			RootSignatureDescription.Desc_1_1.NumStaticSamplers = 1;
-
-			ComPtr<ID3DBlob> Signature;
-			ComPtr<ID3DBlob> Error;
-			ThrowIfFailed(D3D12SerializeVersionedRootSignature(&RootSignatureDescription, &Signature, &Error));
-			ThrowIfFailed(Device->CreateRootSignature(0, Signature->GetBufferPointer(), Signature->GetBufferSize(), IID_PPV_ARGS(&RootSignature)));
+			Streamer->Pump();
+			// The device may stage another format or footprint than the archive stores, generating it still works
+			if (TextureFromArchive && Streamer->GetState(TextureTicket) == StreamState::Failed)
+			{
+				OutputDebugStringW(L"Archived texture does not fit the device's staging, generating it instead\n");
+				TextureFromArchive = false;
+				TextureTicket = Streamer->Request(CreateCheckerboardRequest());
+			}
+			if (!TextureStreamReported && Streamer->GetState(TextureTicket) == StreamState::Ready)
+			{
+				TextureStreamReported = true;
+				ReportStartupTime(L"Streamed texture ready");
+			}
 		}
 
-		// Create Pipeline State
-		{
-			ComPtr<ID3DBlob> VertexShader;
-			ComPtr<ID3DBlob> PixelShader;
-
-			UINT CompilerFlags = 0;
-
-#ifdef _DEBUG
-			CompilerFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
-			ThrowIfFailed(D3DCompileFromFile(
-				(PathToAssets + L"SimpleVertexShader.hlsl").c_str(),
-				nullptr,
-				nullptr,
-				"Main",
-				"vs_5_0",
-				CompilerFlags,
-				0,
-				&VertexShader,
-				nullptr
-			));
-
-			ThrowIfFailed(D3DCompileFromFile(
-				(PathToAssets + L"SimplePixelShader.hlsl").c_str(),
-				nullptr,
-				nullptr,
-				"Main",
-				"ps_5_0",
-				CompilerFlags,
-				0,
-				&PixelShader,
-				nullptr
-			));
-
-			D3D12_INPUT_ELEMENT_DESC InputElementDescriptions[] =
-			{
-				{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-				{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-			};
-
-			D3D12_RASTERIZER_DESC RasterizerDescription;
-			RasterizerDescription.FillMode = D3D12_FILL_MODE_SOLID;
-			RasterizerDescription.CullMode = D3D12_CULL_MODE_BACK;
-			RasterizerDescription.FrontCounterClockwise = FALSE;
-			RasterizerDescription.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
-			RasterizerDescription.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
-			RasterizerDescription.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
-			RasterizerDescription.DepthClipEnable = TRUE;
-			RasterizerDescription.MultisampleEnable = FALSE;
-			RasterizerDescription.AntialiasedLineEnable = FALSE;
-			RasterizerDescription.ForcedSampleCount = 0;
-			RasterizerDescription.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
-
-			D3D12_BLEND_DESC BlendDescription;
-			BlendDescription.AlphaToCoverageEnable = FALSE;
-			BlendDescription.IndependentBlendEnable = FALSE;
-			const D3D12_RENDER_TARGET_BLEND_DESC DefaultRenderTargetBlendDescription =
-			{
-				FALSE,FALSE,
-				D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-				D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-				D3D12_LOGIC_OP_NOOP,
-				D3D12_COLOR_WRITE_ENABLE_ALL,
-			};
-			for (UINT Index = 0; Index < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; Index++)
-			{
-				BlendDescription.RenderTarget[Index] = DefaultRenderTargetBlendDescription;
-			}
-
-			D3D12_GRAPHICS_PIPELINE_STATE_DESC PipelineStateDescription = {};
-			PipelineStateDescription.InputLayout.pInputElementDescs = InputElementDescriptions;
-			PipelineStateDescription.InputLayout.NumElements = _countof(InputElementDescriptions);
-			PipelineStateDescription.pRootSignature = RootSignature.Get();
-			PipelineStateDescription.VS.pShaderBytecode = VertexShader->GetBufferPointer();
-			PipelineStateDescription.VS.BytecodeLength = VertexShader->GetBufferSize();
-			PipelineStateDescription.PS.pShaderBytecode = PixelShader->GetBufferPointer();
-			PipelineStateDescription.PS.BytecodeLength = PixelShader->GetBufferSize();
-			PipelineStateDescription.RasterizerState = RasterizerDescription;
-			PipelineStateDescription.BlendState = BlendDescription;
-			PipelineStateDescription.DepthStencilState.DepthEnable = FALSE;
-			PipelineStateDescription.DepthStencilState.StencilEnable = FALSE;
-			PipelineStateDescription.SampleMask = UINT_MAX;
-			PipelineStateDescription.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-			PipelineStateDescription.NumRenderTargets = 1;
-			PipelineStateDescription.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-			PipelineStateDescription.SampleDesc.Count = 1;
-			ThrowIfFailed(Device->CreateGraphicsPipelineState(&PipelineStateDescription, IID_PPV_ARGS(&PipelineState)));
-		}
+		const LatencyClock::time_point Now = LatencyClock::now();
+		const float DeltaSeconds = std::min(std::chrono::duration<float>(Now - LastUpdate).count(), 0.1f);
+		LastUpdate = Now;
 
-		//Create Command List and Allocator
+		// Objects drift past the edges of the screen before bouncing back, so some are always outside the view
+		Scene.ParallelForEachChunk<InstanceTransform, MotionComponent>(*Jobs, [DeltaSeconds](uint32_t Count, const EntityStore::Entity*, InstanceTransform* Transforms, MotionComponent* Motions)
 		{
-			for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+			for (uint32_t Index = 0; Index < Count; Index++)
 			{
-				ThrowIfFailed(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&CommandAllocator[FrameIndex])));
+				for (uint32_t Axis = 0; Axis < 2; Axis++)
+				{
+					float& Translation = Transforms[Index].Rows[Axis][3];
+					float& Velocity = Motions[Index].Velocity[Axis];
+					Translation += Velocity * DeltaSeconds;
+					if ((Translation > BounceDistance && Velocity > 0.0f) || (Translation < -BounceDistance && Velocity < 0.0f))
+					{
+						Velocity = -Velocity;
+					}
+				}
 			}
+		});
+	}
 
-			ThrowIfFailed(Device->CreateCommandList(
-				0,
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				CommandAllocator[CurrentFrameIndex].Get(),
-				PipelineState.Get(),
-				IID_PPV_ARGS(&CommandList)
-			));
-		}
+	void Render()
+	{
+		ProfileScope Scope(Profiling.get(), "Render");
+		CommandList->Reset();
 
-		// Create Vertex Buffer
+		const float ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+		CommandList->ClearRenderTarget(ClearColor);
+		CommandList->Close();
+
+		if (Scene.GetEntityCount() != 0)
 		{
-			float AspectRatio = static_cast<float>(GetWidth()) / static_cast<float>(GetHeight());
-			float Vertices[] =
+			// Gathered and batched every frame since the scene moves; one draw per mesh whichever path issues it
 			{
-				 0.0f,   0.25f * AspectRatio, 0.0f,     0.5f, 1.0f,
-				 0.25f, -0.25f * AspectRatio, 0.0f,     1.0f, 0.0f,
-				-0.25f, -0.25f * AspectRatio, 0.0f,     0.0f, 0.0f
-			};
+				ProfileScope BatchScope(Profiling.get(), "Cull and batch");
+				GatherSceneInstances();
+				if (CullScene)
+				{
+					CullSceneInstances();
+				}
+				BuildInstanceBatches(CullScene ? VisibleInstances : SceneInstances, Meshes, _countof(Meshes), Batches, Jobs.get());
+				Device->UploadInstances(Batches);
+			}
 
-			D3D12_HEAP_PROPERTIES UploadHeapProperties;
-			UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			UploadHeapProperties.CreationNodeMask = 1;
-			UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			UploadHeapProperties.VisibleNodeMask = 1;
-
-			D3D12_RESOURCE_DESC VertexBufferDescription;
-			VertexBufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-			VertexBufferDescription.Format = DXGI_FORMAT_UNKNOWN;
-			VertexBufferDescription.Width = sizeof Vertices;
-			VertexBufferDescription.Height = 1;
-			VertexBufferDescription.Alignment = 0;
-			VertexBufferDescription.DepthOrArraySize = 1;
-			VertexBufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
-			VertexBufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-			VertexBufferDescription.MipLevels = 1;
-			VertexBufferDescription.SampleDesc.Count = 1;
-			VertexBufferDescription.SampleDesc.Quality = 0;
-
-			ThrowIfFailed(Device->CreateCommittedResource(
-				&UploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&VertexBufferDescription,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&VertexBuffer)
-			));
-
-			UINT8* VertexData;
-			D3D12_RANGE ReadRange = {};
-			ThrowIfFailed(VertexBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&VertexData)));
-			memcpy(VertexData, Vertices, sizeof Vertices);
-			VertexBuffer->Unmap(0, nullptr);
-
-			VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
-			VertexBufferView.StrideInBytes = 5 * sizeof(float);
-			VertexBufferView.SizeInBytes = sizeof Vertices;
+			Recorder->Record(static_cast<uint32_t>(Batches.Draws.size()), [this](RenderCommandList& DrawCommandList, uint32_t BeginDraw, uint32_t EndDraw)
+			{
+				ProfileScope RecordScope(Profiling.get(), "Record draws");
+				if (UseIndirectDraws)
+				{
+					DrawCommandList.ExecuteIndirect(BeginDraw, EndDraw - BeginDraw);
+				}
+				else
+				{
+					DrawCommandList.DrawInstancedBatches(&Batches.Draws[BeginDraw], EndDraw - BeginDraw);
+				}
+			});
 		}
-
-		ComPtr<ID3D12Resource> TextureUploadHeap;
-		// Create Texture
+		else
 		{
-			D3D12_RESOURCE_DESC TextureDescription = {};
-			TextureDescription.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-			TextureDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			TextureDescription.Width = TextureSize;
-			TextureDescription.Height = TextureSize;
-			TextureDescription.DepthOrArraySize = 1;
-			TextureDescription.MipLevels = 1;
-			TextureDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
-			TextureDescription.SampleDesc.Count = 1;
-			TextureDescription.SampleDesc.Quality = 0;
-
-			D3D12_HEAP_PROPERTIES DefaultHeapProperties;
-			DefaultHeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			DefaultHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			DefaultHeapProperties.CreationNodeMask = 1;
-			DefaultHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			DefaultHeapProperties.VisibleNodeMask = 1;
-
-			ThrowIfFailed(Device->CreateCommittedResource(
-				&DefaultHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&TextureDescription,
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				nullptr,
-				IID_PPV_ARGS(&Texture)
-			));
-
-			UINT64 RequiredUploadSize;
-			D3D12_PLACED_SUBRESOURCE_FOOTPRINT TextureFootprint;
-			Device->GetCopyableFootprints(
-				&TextureDescription, 
-				0, 
-				1, 
-				0, 
-				&TextureFootprint,
-				nullptr, 
-				nullptr, 
-				&RequiredUploadSize
-			);
-
-			D3D12_HEAP_PROPERTIES UploadHeapProperties;
-			UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			UploadHeapProperties.CreationNodeMask = 1;
-			UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			UploadHeapProperties.VisibleNodeMask = 1;
-
-			D3D12_RESOURCE_DESC IntermediaryBufferDescription;
-			IntermediaryBufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-			IntermediaryBufferDescription.Format = DXGI_FORMAT_UNKNOWN;
-			IntermediaryBufferDescription.Width = RequiredUploadSize;
-			IntermediaryBufferDescription.Height = 1;
-			IntermediaryBufferDescription.Alignment = 0;
-			IntermediaryBufferDescription.DepthOrArraySize = 1;
-			IntermediaryBufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
-			IntermediaryBufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-			IntermediaryBufferDescription.MipLevels = 1;
-			IntermediaryBufferDescription.SampleDesc.Count = 1;
-			IntermediaryBufferDescription.SampleDesc.Quality = 0;
-
-			ThrowIfFailed(Device->CreateCommittedResource(
-				&UploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&IntermediaryBufferDescription,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&TextureUploadHeap)
-			));
-
-			std::vector<UINT8> TextureData(4 * TextureSize * TextureSize);
-			for (UINT X = 0; X < TextureSize; X++)
-			{
-				for (UINT Y = 0; Y < TextureSize; Y++)
+			Recorder->Record(DrawCount, [](RenderCommandList& DrawCommandList, uint32_t BeginDraw, uint32_t EndDraw)
+			{
+				for (uint32_t DrawIndex = BeginDraw; DrawIndex < EndDraw; DrawIndex++)
 				{
-					UINT8* Pixel = &TextureData[0] + 4 * (Y * TextureSize + X);
-					UINT GridRow = Y / GridSquareSize;
-					UINT GridColumn = X / GridSquareSize;
-
-					if ((GridRow + GridColumn) % 2 == 0)
-					{
-						Pixel[0] = 255;
-						Pixel[1] = 255;
-						Pixel[2] = 255;
-						Pixel[3] = 255;
-					}
-					else
-					{
-						Pixel[0] = 0;
-						Pixel[1] = 0;
-						Pixel[2] = 0;
-						Pixel[3] = 255;
-					}
+					DrawCommandList.DrawIndexedInstanced(3, 1, 0, 0, 0);
 				}
-			}
-
-			UINT8* TextureUploadData;
-			ThrowIfFailed(TextureUploadHeap->Map(0, nullptr, reinterpret_cast<void**>(&TextureUploadData)));
-			memcpy(TextureUploadData, &TextureData[0], TextureData.size() * sizeof(UINT8));
-			TextureUploadHeap->Unmap(0, nullptr);
-
-			D3D12_TEXTURE_COPY_LOCATION DestinationLocation = {};
-			DestinationLocation.pResource = Texture.Get();
-			DestinationLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-			DestinationLocation.SubresourceIndex = 0;
-
-			D3D12_TEXTURE_COPY_LOCATION SourceLocation = {};
-			SourceLocation.pResource = TextureUploadHeap.Get();
-			SourceLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-			SourceLocation.PlacedFootprint = TextureFootprint;
-
-			CommandList->CopyTextureRegion(
-				&DestinationLocation,
-				0,
-				0,
-				0,
-				&SourceLocation,
-				nullptr
-			);
-
-			D3D12_RESOURCE_BARRIER CopyDestinationToShaderResourceBarrier;
-			CopyDestinationToShaderResourceBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			CopyDestinationToShaderResourceBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			CopyDestinationToShaderResourceBarrier.Transition.pResource = Texture.Get();
-			CopyDestinationToShaderResourceBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-			CopyDestinationToShaderResourceBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			CopyDestinationToShaderResourceBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			CommandList->ResourceBarrier(1, &CopyDestinationToShaderResourceBarrier);
-
-			D3D12_SHADER_RESOURCE_VIEW_DESC ShaderResourceDescription = {};
-			ShaderResourceDescription.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-			ShaderResourceDescription.Format = TextureDescription.Format;
-			ShaderResourceDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			ShaderResourceDescription.Texture2D.MipLevels = 1;
-			Device->CreateShaderResourceView(Texture.Get(), &ShaderResourceDescription, ShaderResourceHeap->GetCPUDescriptorHandleForHeapStart());
+			});
 		}
 
-		ThrowIfFailed(CommandList->Close());
-		ID3D12CommandList* CommandLists[] = { CommandList.Get() };
-		CommandQueue->ExecuteCommandLists(_countof(CommandLists), CommandLists);
+		CommandLists.clear();
+		CommandLists.push_back(CommandList.get());
+		CommandLists.insert(CommandLists.end(), Recorder->GetCommandLists(), Recorder->GetCommandLists() + Recorder->GetCommandListCount());
+		Device->ExecuteCommandLists(CommandLists.data(), static_cast<uint32_t>(CommandLists.size()));
+
+		Device->Present();
 
-		// Create Fence
+		if (MeasureLatency)
 		{
-			ThrowIfFailed(Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence)));
-			FenceValue = 0;
-			FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-			if (FenceEvent == nullptr)
+			Latency.OnPresent(LatencyClock::now());
+
+			double AverageMilliseconds, MaximumMilliseconds;
+			uint64_t SampleCount;
+			if (Latency.TryReport(AverageMilliseconds, MaximumMilliseconds, SampleCount))
 			{
-				ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+				WCHAR Report[160];
+				swprintf_s(Report, L"Input latency: %.2f ms average, %.2f ms worst over %llu events, %llu dropped\n", AverageMilliseconds, MaximumMilliseconds, SampleCount,
+					DroppedInputEvents.load(std::memory_order_relaxed));
+				OutputDebugStringW(Report);
 			}
 		}
 
-		WaitForGpu();
+		if (Profiling != nullptr)
+		{
+			Profiling->EndFrame();
+		}
+		if (ProfileFrames)
+		{
+			ReportFrameTimes();
+		}
 	}
 
-	void Update()
+	void UpdateRenderScale()
 	{
+		// GPU timestamps arrive a few frames late and only from backends that record them
+		const uint64_t GpuFrameCount = Profiling->GetGpuFrameCount();
+		if (GpuFrameCount == MeasuredGpuFrames) return;
+		MeasuredGpuFrames = GpuFrameCount;
+
+		const float PreviousScale = DynamicResolution->GetScale();
+		const float Scale = DynamicResolution->Update(Profiling->GetLastGpuFrameTime());
+		if (Scale == PreviousScale) return;
+
+		Device->SetRenderScale(Scale);
+		WCHAR Report[128];
+		swprintf_s(Report, L"Render scale: %.3f (%ux%u) at %.2f ms smoothed GPU time\n", Scale,
+			DynamicResolutionController::GetScaledSize(Device->GetWidth(), Scale), DynamicResolutionController::GetScaledSize(Device->GetHeight(), Scale),
+			DynamicResolution->GetSmoothedFrameTime());
+		OutputDebugStringW(Report);
 	}
 
-	void Render()
+	void ReportFrameTimes()
 	{
-		ThrowIfFailed(CommandAllocator[CurrentFrameIndex]->Reset());
-		ThrowIfFailed(CommandList->Reset(CommandAllocator[CurrentFrameIndex].Get(), PipelineState.Get()));
+		const LatencyClock::time_point Now = LatencyClock::now();
+		if (Now - LastFrameTimeReport < std::chrono::seconds(1)) return;
+
+		LastFrameTimeReport = Now;
+		WCHAR Report[160];
+		swprintf_s(Report, L"Frame time: CPU %.2f ms p50, %.2f ms p99; GPU %.2f ms p50, %.2f ms p99\n",
+			Profiling->GetCpuFrameTimePercentile(50.0), Profiling->GetCpuFrameTimePercentile(99.0),
+			Profiling->GetGpuFrameTimePercentile(50.0), Profiling->GetGpuFrameTimePercentile(99.0));
+		OutputDebugStringW(Report);
+	}
 
-		// Fill Out Command List
+	// P cycles through the present modes and F through the frames in flight the device allows
+	void ChangeFramePacing(UINT8 Key)
+	{
+		if (Key == 'P')
 		{
-			CommandList->SetGraphicsRootSignature(RootSignature.Get());
-			ID3D12DescriptorHeap* DescriptorHeaps[] = { ShaderResourceHeap.Get() };
-			CommandList->SetDescriptorHeaps(_countof(DescriptorHeaps), DescriptorHeaps);
-			CommandList->SetGraphicsRootDescriptorTable(0, ShaderResourceHeap->GetGPUDescriptorHandleForHeapStart());
-
-			CommandList->RSSetViewports(1, &Viewport);
-			CommandList->RSSetScissorRects(1, &ScissorRectangle);
-
-			D3D12_RESOURCE_BARRIER PresentToRenderTargetBarrier;
-			PresentToRenderTargetBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			PresentToRenderTargetBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			PresentToRenderTargetBarrier.Transition.pResource = RenderTargets[CurrentFrameIndex].Get();
-			PresentToRenderTargetBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-			PresentToRenderTargetBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			PresentToRenderTargetBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			CommandList->ResourceBarrier(1, &PresentToRenderTargetBarrier);
-
-			const float ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-			auto RenderTargetHandle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
-			RenderTargetHandle.ptr += CurrentFrameIndex * RenderTargetDescriptorSize;
-			CommandList->ClearRenderTargetView(RenderTargetHandle, ClearColor, 0, nullptr);
-			CommandList->OMSetRenderTargets(1, &RenderTargetHandle, FALSE, nullptr);
-			CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			CommandList->IASetVertexBuffers(0, 1, &VertexBufferView);
-			CommandList->DrawInstanced(3, 1, 0, 0);
-
-			D3D12_RESOURCE_BARRIER RenderTargetToPresentBarrier;
-			RenderTargetToPresentBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			RenderTargetToPresentBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			RenderTargetToPresentBarrier.Transition.pResource = RenderTargets[CurrentFrameIndex].Get();
-			RenderTargetToPresentBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			RenderTargetToPresentBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-			RenderTargetToPresentBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			CommandList->ResourceBarrier(1, &RenderTargetToPresentBarrier);
+			Pacing.Mode = static_cast<PresentMode>((static_cast<int>(Pacing.Mode) + 1) % 4);
+		}
+		else if (Key == 'F')
+		{
+			Pacing.FramesInFlight = Pacing.FramesInFlight % Device->GetFrameCount() + 1;
+		}
+		else
+		{
+			return;
 		}
 
-		ThrowIfFailed(CommandList->Close());
-		ID3D12CommandList* CommandLists[] = { CommandList.Get() };
-		CommandQueue->ExecuteCommandLists(_countof(CommandLists), CommandLists);
+		Device->SetFramePacing(Pacing);
+		const WCHAR* ModeNames[] = { L"vsync", L"uncapped", L"capped", L"low latency" };
+		WCHAR Report[128];
+		swprintf_s(Report, L"Present mode: %s, %u frames in flight\n", ModeNames[static_cast<int>(Pacing.Mode)], Pacing.FramesInFlight);
+		OutputDebugStringW(Report);
+	}
 
-		ThrowIfFailed(SwapChain->Present(1, 0));
-		AdvanceFrame();
+	void StartRenderThread()
+	{
+		RenderThreadRunning = true;
+		RenderThread = std::thread([this]
+		{
+			if (Profiling != nullptr)
+			{
+				Profiling->SetThreadName("Render");
+			}
+			while (RenderThreadRunning.load(std::memory_order_relaxed))
+			{
+				Update();
+				Render();
+			}
+		});
+	}
+
+	void StopRenderThread()
+	{
+		if (!RenderThread.joinable()) return;
+
+		RenderThreadRunning = false;
+		RenderThread.join();
 	}
 
 	void Dispose()
 	{
-		WaitForGpu();
-		CloseHandle(FenceEvent);
+		StopRenderThread();
+		Device->WaitForIdle();
+		if (ProfileFrames)
+		{
+			// Opens in chrome://tracing or ui.perfetto.dev
+			std::ostringstream Trace;
+			Profiling->WriteChromeTrace(Trace);
+			const std::string TraceText = Trace.str();
+			WriteFileAtomically(ConvertToUtf8(PathToAssets) + "trace.json", TraceText.data(), TraceText.size());
+		}
+		Streamer.reset();
+		Recorder.reset();
+		Culler.reset();
+		Jobs.reset();
+		Device->Dispose();
 	}
 
 	void OnKeyPressed(UINT8 Key)
 	{
+		PushInputEvent(InputEventType::KeyPressed, Key);
 	}
 
 	void OnKeyReleased(UINT8 Key)
 	{
+		PushInputEvent(InputEventType::KeyReleased, Key);
+	}
+
+	void OnResize(UINT Width, UINT Height)
+	{
+		// Minimizing reports a zero size, which the device would ignore anyway
+		if (Width == 0 || Height == 0) return;
+		PendingSize.store(static_cast<uint64_t>(Width) << 32 | Height, std::memory_order_release);
 	}
 
-	UINT GetWidth() const { return 1280; }
-	UINT GetHeight() const { return 720; }
+	UINT GetInitialWidth() const { return 1280; }
+	UINT GetInitialHeight() const { return 720; }
 
 private:
 	HWND Window;
 	std::wstring PathToAssets;
+	bool UseHeadlessDevice = false;
+
+	std::unique_ptr<RenderDevice> Device;
+	UINT FrameCount = 2;
+	FramePacingDescription Pacing;
+	std::unique_ptr<JobSystem> Jobs;
+	UINT WorkerCount = 0;
+	MipFilter TextureMipFilter = MipFilter::Box;
+	TextureFormat TextureStorageFormat = TextureFormat::Rgba8;
+	bool WatchShaders = false;
+	// -floatvertices keeps 32 bit float positions and texture coordinates instead of the quantized layout
+	VertexFormat GeometryFormat = VertexFormat::Quantized;
+
+	std::unique_ptr<RenderCommandList> CommandList;
+	std::unique_ptr<ParallelCommandRecorder> Recorder;
+	std::vector<RenderCommandList*> CommandLists;
+	UINT DrawCount = 1;
+
+	// -instances replaces the single triangle with a grid of triangles and quads drawn as one batch per mesh
+	MeshRange Meshes[2];
+	UINT SceneInstanceCount = 0;
+	bool UseIndirectDraws = false;
+	EntityStore Scene;
+	InstanceList SceneInstances;
+	InstanceBatchBuffer Batches;
+
+	// Instances outside the view are dropped before batching, -nocull batches the whole scene instead
+	static constexpr float BounceDistance = 1.25f;
+	float MeshExtents[3] = { 0.25f, 0.25f, 0.0f };
+	bool CullScene = true;
+	std::unique_ptr<VisibilityCuller> Culler;
+	CullBounds SceneBounds;
+	std::vector<uint32_t> VisibleIndices;
+	InstanceList VisibleInstances;
+	LatencyClock::time_point LastUpdate = LatencyClock::now();
+
+	std::thread RenderThread;
+	std::atomic<bool> RenderThreadRunning{ false };
+
+	// The window thread produces input events and the render thread consumes them in Update
+	SingleProducerSingleConsumerQueue<InputEvent> InputQueue{ 256 };
+	bool KeyStates[256] = {};
+	// Counted by the window thread when the queue is full, read by the render thread for the latency report
+	std::atomic<UINT64> DroppedInputEvents{ 0 };
+
+	bool MeasureLatency = false;
+	LatencyTracker Latency;
+
+	// -profile times CPU scopes and GPU command lists, reports frame time percentiles and writes trace.json on exit
+	bool ProfileFrames = false;
+	std::unique_ptr<Profiler> Profiling;
+	LatencyClock::time_point LastFrameTimeReport;
+
+	// -dynres lowers the render resolution to keep GPU frame times within the given milliseconds
+	double DynamicResolutionBudget = 0.0;
+	std::unique_ptr<DynamicResolutionController> DynamicResolution;
+	uint64_t MeasuredGpuFrames = 0;
+
+	// Latest client size from the window thread as width and height in one value, zero once applied
+	std::atomic<uint64_t> PendingSize{ 0 };
+
+	// -archive streams the texture from a packed archive instead, ready to upload as the packer tool stored it
+	std::wstring ArchivePath;
+	AssetArchive Archive;
+	bool TextureFromArchive = false;
+
+	// -stream loads through the copy queue so startup can be compared against the blocking upload path
+	static const UINT64 StreamingBudget = 32 * 1024 * 1024;
+	bool StreamTextures = false;
+	std::unique_ptr<AssetStreamer> Streamer;
+	StreamTicket TextureTicket = 0;
+	bool TextureStreamReported = false;
+	LatencyClock::time_point StartupBegin;
 
-	D3D12_VIEWPORT Viewport = {};
-	D3D12_RECT ScissorRectangle = {};
+	static const UINT TextureSize = 512;
+	static const UINT GridSquareSize = 32;
 
-	static const UINT FrameCount = 2;
-	ComPtr<IDXGISwapChain4> SwapChain;
-	ComPtr<ID3D12Device3> Device;
-	ComPtr<ID3D12Resource> RenderTargets[FrameCount];
-	ComPtr<ID3D12CommandQueue> CommandQueue;
-	ComPtr<ID3D12CommandAllocator> CommandAllocator[FrameCount];
-	ComPtr<ID3D12GraphicsCommandList> CommandList;
-	ComPtr<ID3D12DescriptorHeap> RenderTargetHeap;
-	ComPtr<ID3D12DescriptorHeap> ShaderResourceHeap;
-	ComPtr<ID3D12PipelineState> PipelineState;
-	ComPtr<ID3D12RootSignature> RootSignature;
+	ProceduralTextureDescription GetCheckerboardDescription() const
+	{
+		ProceduralTextureDescription Checkerboard;
+		Checkerboard.Pattern = ProceduralPattern::Checker;
+		Checkerboard.Width = TextureSize;
+		Checkerboard.Height = TextureSize;
+		Checkerboard.CellSize = GridSquareSize;
+		return Checkerboard;
+	}
 
-	ComPtr<ID3D12Resource> VertexBuffer;
-	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
+	StreamRequest CreateCheckerboardRequest() const
+	{
+		StreamRequest Request;
+		Request.Width = TextureSize;
+		Request.Height = TextureSize;
+		Request.Filter = TextureMipFilter;
+		Request.Format = TextureStorageFormat;
+		Request.Decode = [Checkerboard = GetCheckerboardDescription()](uint8_t* Pixels, uint32_t RowPitch)
+		{
+			GenerateProceduralTexture(Checkerboard, Pixels, RowPitch);
+			return true;
+		};
+		return Request;
+	}
 
-	static const UINT TextureSize = 512;
-	static const UINT GridSquareSize = 32;
-	ComPtr<ID3D12Resource> Texture;
+	// Relative paths are resolved beside the executable. Returns null, after saying why, when the archive cannot
+	// be opened or holds no checkerboard texture.
+	const AssetArchiveEntry* OpenArchiveTexture()
+	{
+		const bool Relative = ArchivePath.find(L':') == std::wstring::npos && ArchivePath[0] != L'\\' && ArchivePath[0] != L'/';
+		const std::string Path = ConvertToUtf8(Relative ? PathToAssets + ArchivePath : ArchivePath);
+		if (!Archive.Open(Path))
+		{
+			OutputDebugStringW(L"Asset archive is missing or damaged, generating the texture instead\n");
+			return nullptr;
+		}
 
-	UINT RenderTargetDescriptorSize = 0;
-	UINT CurrentFrameIndex = 0;
-	HANDLE FenceEvent = nullptr;
-	ComPtr<ID3D12Fence1> Fence;
-	UINT64 FenceValue = 0;
-	UINT64 FrameSignalValue[FrameCount];
+		const AssetArchiveEntry* Texture = Archive.Find("Checkerboard");
+		if (Texture == nullptr || !Texture->IsTexture())
+		{
+			OutputDebugStringW(L"Asset archive has no Checkerboard texture, generating it instead\n");
+			return nullptr;
+		}
+		return Texture;
+	}
 
-	void WaitForGpu()
+	void ReportStartupTime(const WCHAR* Milestone)
 	{
-		ThrowIfFailed(CommandQueue->Signal(Fence.Get(), ++FenceValue));
-		if (Fence->GetCompletedValue() < FenceValue)
+		const double Milliseconds = std::chrono::duration<double, std::milli>(LatencyClock::now() - StartupBegin).count();
+		WCHAR Report[128];
+		swprintf_s(Report, L"%s after %.2f ms (%s uploads)\n", Milestone, Milliseconds, StreamTextures ? L"streaming" : L"blocking");
+		OutputDebugStringW(Report);
+	}
+
+	// Welds the unindexed corners and reorders them for the post-transform cache, overdraw and fetch locality before
+	// appending them to the shared buffers, indexed relative to the mesh's base vertex
+	void AppendOptimizedMesh(const WCHAR* Name, const Vertex* Corners, uint32_t CornerCount, MeshRange& Range, std::vector<Vertex>& Vertices, std::vector<uint32_t>& Indices)
+	{
+		std::vector<uint32_t> MeshIndices(CornerCount);
+		std::vector<Vertex> MeshVertices(CornerCount);
+		const uint32_t UniqueCount = GenerateIndexBuffer(Corners, CornerCount, sizeof(Vertex), MeshIndices.data(), MeshVertices.data());
+		MeshVertices.resize(UniqueCount);
+
+		const VertexCacheStatistics Before = AnalyzeVertexCache(MeshIndices.data(), CornerCount, UniqueCount);
+		OptimizeVertexCache(MeshIndices.data(), CornerCount, UniqueCount);
+		OptimizeOverdraw(MeshIndices.data(), CornerCount, MeshVertices[0].Position, UniqueCount, sizeof(Vertex));
+		const size_t KeptCount = OptimizeVertexFetch(MeshVertices.data(), MeshIndices.data(), CornerCount, UniqueCount, sizeof(Vertex));
+		const VertexCacheStatistics After = AnalyzeVertexCache(MeshIndices.data(), CornerCount, KeptCount);
+
+		const size_t VertexSize = GeometryFormat == VertexFormat::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+		const VertexFetchStatistics Fetch = AnalyzeVertexFetch(MeshIndices.data(), CornerCount, KeptCount, VertexSize);
+		WCHAR Report[192];
+		swprintf_s(Report, L"%s: %u corners welded to %zu vertices of %zu bytes, ACMR %.2f -> %.2f, overfetch %.2f\n",
+			Name, CornerCount, KeptCount, VertexSize, Before.AverageCacheMissRatio, After.AverageCacheMissRatio, Fetch.Overfetch);
+		OutputDebugStringW(Report);
+
+		Range.StartIndex = static_cast<uint32_t>(Indices.size());
+		Range.IndexCount = CornerCount;
+		Range.BaseVertex = static_cast<int32_t>(Vertices.size());
+		Indices.insert(Indices.end(), MeshIndices.begin(), MeshIndices.end());
+		Vertices.insert(Vertices.end(), MeshVertices.begin(), MeshVertices.begin() + KeptCount);
+	}
+
+	void CreateScene(float AspectRatio)
+	{
+		// Meshes alternate so batching has to gather them, materials change per row
+		const UINT Columns = static_cast<UINT>(std::ceil(std::sqrt(static_cast<double>(SceneInstanceCount))));
+		const float CellSize = 2.0f / static_cast<float>(std::max(Columns, 1u));
+		const float Scale = 0.8f * CellSize / (0.5f * AspectRatio);
+
+		for (UINT Index = 0; Index < SceneInstanceCount; Index++)
 		{
-			ThrowIfFailed(Fence->SetEventOnCompletion(FenceValue, FenceEvent));
-			WaitForSingleObject(FenceEvent, INFINITE);
+			const UINT Column = Index % Columns;
+			const UINT Row = Index / Columns;
+			const EntityStore::Entity Object = Scene.Create<InstanceTransform, MeshComponent, MaterialComponent, MotionComponent>();
+			Scene.Get<MeshComponent>(Object)->MeshId = Index % 2;
+			Scene.Get<MaterialComponent>(Object)->MaterialId = Row % 4;
+
+			// Golden angle steps spread the directions evenly
+			MotionComponent& Motion = *Scene.Get<MotionComponent>(Object);
+			Motion.Velocity[0] = 0.05f * std::cos(2.39996f * Index);
+			Motion.Velocity[1] = 0.05f * std::sin(2.39996f * Index);
+
+			InstanceTransform& Transform = *Scene.Get<InstanceTransform>(Object);
+			const float Translation[3] = { -1.0f + (Column + 0.5f) * CellSize, 1.0f - (Row + 0.5f) * CellSize, 0.0f };
+			for (UINT TransformRow = 0; TransformRow < 3; TransformRow++)
+			{
+				for (UINT TransformColumn = 0; TransformColumn < 3; TransformColumn++)
+				{
+					Transform.Rows[TransformRow][TransformColumn] = TransformRow == TransformColumn ? (TransformRow < 2 ? Scale : 1.0f) : 0.0f;
+				}
+				Transform.Rows[TransformRow][3] = Translation[TransformRow];
+			}
 		}
 	}
 
-	void AdvanceFrame()
+	void GatherSceneInstances()
 	{
-		CommandQueue->Signal(Fence.Get(), ++FenceValue);
-		FrameSignalValue[CurrentFrameIndex] = FenceValue;
+		SceneInstances.MeshIds.clear();
+		SceneInstances.MaterialIds.clear();
+		SceneInstances.Transforms.clear();
+		Scene.ForEachChunk<InstanceTransform, MeshComponent, MaterialComponent>([this](uint32_t Count, const EntityStore::Entity*, const InstanceTransform* Transforms, const MeshComponent* MeshComponents, const MaterialComponent* MaterialComponents)
+		{
+			SceneInstances.Transforms.insert(SceneInstances.Transforms.end(), Transforms, Transforms + Count);
+			for (uint32_t Index = 0; Index < Count; Index++)
+			{
+				SceneInstances.MeshIds.push_back(MeshComponents[Index].MeshId);
+				SceneInstances.MaterialIds.push_back(MaterialComponents[Index].MaterialId);
+			}
+		});
+	}
 
-		const UINT NextFrameIndex = SwapChain->GetCurrentBackBufferIndex();
-		if (Fence->GetCompletedValue() < FrameSignalValue[NextFrameIndex])
+	void CullSceneInstances()
+	{
+		// The scene is drawn without a camera, so clip space is world space and the frustum is the unit cube
+		static const float Identity[4][4] = { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } };
+		static const Frustum View = ExtractFrustum(Identity);
+
+		// World space box of each mesh: the absolute transform applied to the local extents
+		const size_t InstanceCount = SceneInstances.Transforms.size();
+		SceneBounds.CenterX.resize(InstanceCount);
+		SceneBounds.CenterY.resize(InstanceCount);
+		SceneBounds.CenterZ.resize(InstanceCount);
+		SceneBounds.Radius.resize(InstanceCount);
+		for (size_t Index = 0; Index < InstanceCount; Index++)
 		{
-			ThrowIfFailed(Fence->SetEventOnCompletion(FrameSignalValue[NextFrameIndex], FenceEvent));
-			WaitForSingleObject(FenceEvent, INFINITE);
+			const InstanceTransform& Transform = SceneInstances.Transforms[Index];
+			float Extents[3];
+			for (UINT Row = 0; Row < 3; Row++)
+			{
+				Extents[Row] = std::fabs(Transform.Rows[Row][0]) * MeshExtents[0] + std::fabs(Transform.Rows[Row][1]) * MeshExtents[1] + std::fabs(Transform.Rows[Row][2]) * MeshExtents[2];
+			}
+			SceneBounds.CenterX[Index] = Transform.Rows[0][3];
+			SceneBounds.CenterY[Index] = Transform.Rows[1][3];
+			SceneBounds.CenterZ[Index] = Transform.Rows[2][3];
+			SceneBounds.Radius[Index] = std::sqrt(Extents[0] * Extents[0] + Extents[1] * Extents[1] + Extents[2] * Extents[2]);
 		}
 
-		CurrentFrameIndex = NextFrameIndex;
+		Culler->Cull(SceneBounds, View, VisibilityOptions(), VisibleIndices);
+
+		VisibleInstances.MeshIds.resize(VisibleIndices.size());
+		VisibleInstances.MaterialIds.resize(VisibleIndices.size());
+		VisibleInstances.Transforms.resize(VisibleIndices.size());
+		for (size_t Visible = 0; Visible < VisibleIndices.size(); Visible++)
+		{
+			const uint32_t Index = VisibleIndices[Visible];
+			VisibleInstances.MeshIds[Visible] = SceneInstances.MeshIds[Index];
+			VisibleInstances.MaterialIds[Visible] = SceneInstances.MaterialIds[Index];
+			VisibleInstances.Transforms[Visible] = SceneInstances.Transforms[Index];
+		}
+	}
+
+	void PushInputEvent(InputEventType Type, UINT8 Key)
+	{
+		InputEvent Event;
+		Event.Type = Type;
+		Event.Key = Key;
+		Event.Timestamp = LatencyClock::now();
+		if (!InputQueue.TryPush(Event))
+		{
+			DroppedInputEvents.fetch_add(1, std::memory_order_relaxed);
+		}
 	}
 };
 
@@ -675,6 +844,16 @@ void Application::Render()
 	Implementation->Render();
 }
 
+void Application::StartRenderThread()
+{
+	Implementation->StartRenderThread();
+}
+
+void Application::StopRenderThread()
+{
+	Implementation->StopRenderThread();
+}
+
 void Application::Dispose()
 {
 	Implementation->Dispose();
@@ -690,17 +869,22 @@ void Application::OnKeyReleased(UINT8 Key)
 	Implementation->OnKeyReleased(Key);
 }
 
+void Application::OnResize(UINT Width, UINT Height)
+{
+	Implementation->OnResize(Width, Height);
+}
+
 const WCHAR* Application::GetWindowTitle() const
 {
 	return L"DirectX 12 Experiment";
 }
 
-UINT Application::GetWidth() const
+UINT Application::GetInitialWidth() const
 {
-	return Implementation->GetWidth();
+	return Implementation->GetInitialWidth();
 }
 
-UINT Application::GetHeight() const
+UINT Application::GetInitialHeight() const
 {
-	return Implementation->GetHeight();
+	return Implementation->GetInitialHeight();
 }
\ No newline at end of file
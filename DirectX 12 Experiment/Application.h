@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Windows.h>
+#include <memory>
 #include <string>
 
 class Application
@@ -17,12 +18,18 @@ public:
 	void Render();
 	void Dispose();
 
+	void StartRenderThread();
+	void StopRenderThread();
+
 	void OnKeyPressed(UINT8 Key);
 	void OnKeyReleased(UINT8 Key);
+	// Called from the window thread, the render thread resizes the swap chain before its next frame
+	void OnResize(UINT Width, UINT Height);
 
 	const WCHAR* GetWindowTitle() const;
-	UINT GetWidth() const;
-	UINT GetHeight() const;
+	// Size the window is created with; after a resize the device holds the current size
+	UINT GetInitialWidth() const;
+	UINT GetInitialHeight() const;
 
 private:
 	class ApplicationImplementation;
@@ -0,0 +1,450 @@
+#include "AssetArchive.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "Lz4Codec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+// "ASPK" when read as little endian bytes
+static const uint32_t ArchiveMagic = 0x4B505341;
+static const uint32_t ArchiveVersion = 1;
+static const uint32_t EmptySlot = 0xFFFFFFFF;
+// The D3D12 limit, which also keeps row sizes of damaged entries from overflowing
+static const uint32_t MaximumTextureDimension = 16384;
+
+struct ArchiveHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t EntryCount;
+	uint32_t SlotCount;
+	uint32_t ChunkSize;
+	uint32_t Reserved;
+	uint64_t Size;
+};
+
+static_assert(sizeof(AssetArchiveEntry) == 64, "Archive entries are read in place and must keep their size");
+
+static uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+{
+	return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+static uint64_t HashName(const char* Name, size_t Size)
+{
+	return HashBytes(Name, Size);
+}
+
+// At most half full, so probes stay short
+static uint32_t GetSlotCount(uint32_t EntryCount)
+{
+	uint32_t SlotCount = 1;
+	while (SlotCount < 2 * EntryCount)
+	{
+		SlotCount *= 2;
+	}
+	return SlotCount;
+}
+
+static uint64_t GetChunkOffset(const uint8_t* Stored, uint32_t Chunk)
+{
+	uint64_t Offset;
+	memcpy(&Offset, Stored + Chunk * sizeof(uint64_t), sizeof(Offset));
+	return Offset;
+}
+
+static bool IsValidFormat(TextureFormat Format)
+{
+	return static_cast<uint32_t>(Format) <= static_cast<uint32_t>(TextureFormat::Bc7);
+}
+
+// Block compressed rows are rows of 4x4 blocks
+static uint32_t GetRowBytes(TextureFormat Format, const TextureLevelLayout& Level)
+{
+	return (IsBlockCompressed(Format) ? (Level.Width + 3) / 4 : Level.Width) * GetFormatElementBytes(Format);
+}
+
+static uint32_t GetRowCount(TextureFormat Format, const TextureLevelLayout& Level)
+{
+	return IsBlockCompressed(Format) ? (Level.Height + 3) / 4 : Level.Height;
+}
+
+// The last row ends without padding, like the upload size D3D12 reports, so a chain fits any matching footprint
+static uint64_t GetTextureSize(TextureFormat Format, uint32_t Width, uint32_t Height, uint32_t MipLevelCount, TextureLevelLayout* Levels)
+{
+	const uint64_t PaddedSize = GetTextureLevelLayouts(Format, Width, Height, MipLevelCount, AssetArchiveRowAlignment, AssetArchiveLevelAlignment, Levels);
+	const TextureLevelLayout& LastLevel = Levels[MipLevelCount - 1];
+	return PaddedSize - LastLevel.RowPitch + GetRowBytes(Format, LastLevel);
+}
+
+bool AssetArchive::Open(const std::string& Path)
+{
+	Close();
+	if (!File.Open(Path)) return false;
+
+	const uint8_t* Data = File.GetData();
+	const uint64_t Size = File.GetSize();
+
+	ArchiveHeader Header;
+	if (Size < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&Header, Data, sizeof(Header));
+
+	const uint64_t TableSize = sizeof(ArchiveHeader) + static_cast<uint64_t>(Header.EntryCount) * sizeof(AssetArchiveEntry) + static_cast<uint64_t>(Header.SlotCount) * sizeof(uint32_t);
+	const bool ValidHeader =
+		Header.Magic == ArchiveMagic && Header.Version == ArchiveVersion && Header.Size == Size && TableSize <= Size &&
+		Header.SlotCount == GetSlotCount(Header.EntryCount) && Header.ChunkSize != 0;
+	if (!ValidHeader)
+	{
+		Close();
+		return false;
+	}
+
+	Entries = reinterpret_cast<const AssetArchiveEntry*>(Data + sizeof(ArchiveHeader));
+	Slots = reinterpret_cast<const uint32_t*>(Entries + Header.EntryCount);
+	EntryCount = Header.EntryCount;
+	SlotCount = Header.SlotCount;
+	ChunkSize = Header.ChunkSize;
+
+	for (uint32_t Slot = 0; Slot < SlotCount; Slot++)
+	{
+		if (Slots[Slot] != EmptySlot && Slots[Slot] >= EntryCount)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	for (uint32_t EntryIndex = 0; EntryIndex < EntryCount; EntryIndex++)
+	{
+		const AssetArchiveEntry& Entry = Entries[EntryIndex];
+		bool Valid =
+			Entry.NameOffset <= Size && Entry.NameSize <= Size - Entry.NameOffset &&
+			Entry.Offset <= Size && Entry.StoredSize <= Size - Entry.Offset;
+
+		if (Valid && Entry.Compression == ArchiveCompression::None)
+		{
+			Valid = Entry.StoredSize == Entry.Size && Entry.ChunkCount == 0;
+		}
+		else if (Valid && Entry.Compression == ArchiveCompression::Lz4)
+		{
+			// Offsets must rise from the end of the table to the end of the entry, no chunk longer than it decodes to
+			const uint64_t ChunkCount = (Entry.Size + ChunkSize - 1) / ChunkSize;
+			const uint64_t ChunkTableSize = (ChunkCount + 1) * sizeof(uint64_t);
+			Valid = Entry.ChunkCount == ChunkCount && ChunkTableSize <= Entry.StoredSize;
+			const uint8_t* Stored = Data + Entry.Offset;
+			for (uint32_t Chunk = 0; Valid && Chunk < Entry.ChunkCount; Chunk++)
+			{
+				const uint64_t Begin = GetChunkOffset(Stored, Chunk);
+				const uint64_t End = GetChunkOffset(Stored, Chunk + 1);
+				const uint64_t ChunkBytes = std::min<uint64_t>(ChunkSize, Entry.Size - static_cast<uint64_t>(Chunk) * ChunkSize);
+				Valid = Begin >= ChunkTableSize && Begin <= End && End - Begin <= ChunkBytes && End <= Entry.StoredSize;
+			}
+			Valid = Valid && GetChunkOffset(Stored, 0) == ChunkTableSize && GetChunkOffset(Stored, Entry.ChunkCount) == Entry.StoredSize;
+		}
+		else
+		{
+			Valid = false;
+		}
+
+		if (Valid && Entry.IsTexture())
+		{
+			TextureLevelLayout Levels[MaximumMipLevelCount];
+			Valid =
+				IsValidFormat(Entry.Format) && Entry.Width <= MaximumTextureDimension && Entry.Height != 0 && Entry.Height <= MaximumTextureDimension &&
+				Entry.MipLevelCount != 0 &&
+				Entry.MipLevelCount <= GetFullMipLevelCount(Entry.Width, Entry.Height) &&
+				GetTextureSize(Entry.Format, Entry.Width, Entry.Height, Entry.MipLevelCount, Levels) == Entry.Size;
+		}
+
+		if (!Valid)
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void AssetArchive::Close()
+{
+	File.Close();
+	Entries = nullptr;
+	Slots = nullptr;
+	EntryCount = 0;
+	SlotCount = 0;
+	ChunkSize = 0;
+}
+
+std::string AssetArchive::GetName(const AssetArchiveEntry& Entry) const
+{
+	return std::string(reinterpret_cast<const char*>(File.GetData() + Entry.NameOffset), Entry.NameSize);
+}
+
+const AssetArchiveEntry* AssetArchive::Find(const std::string& Name) const
+{
+	if (SlotCount == 0) return nullptr;
+
+	// Linear probing from the hashed slot; the table is never full, so an empty slot always ends the search
+	const uint64_t Hash = HashName(Name.data(), Name.size());
+	for (uint32_t Probe = 0; Probe < SlotCount; Probe++)
+	{
+		const uint32_t EntryIndex = Slots[(Hash + Probe) & (SlotCount - 1)];
+		if (EntryIndex == EmptySlot) return nullptr;
+
+		const AssetArchiveEntry& Entry = Entries[EntryIndex];
+		if (Entry.NameHash == Hash && Entry.NameSize == Name.size() && memcmp(File.GetData() + Entry.NameOffset, Name.data(), Name.size()) == 0)
+		{
+			return &Entry;
+		}
+	}
+	return nullptr;
+}
+
+bool AssetArchive::Read(const AssetArchiveEntry& Entry, uint8_t* Destination, JobSystem* Jobs) const
+{
+	const uint8_t* Stored = GetStoredData(Entry);
+	if (Entry.Compression == ArchiveCompression::None)
+	{
+		memcpy(Destination, Stored, static_cast<size_t>(Entry.Size));
+		return true;
+	}
+
+	std::atomic<bool> Succeeded{ true };
+	auto DecodeChunks = [&](uint32_t BeginChunk, uint32_t EndChunk)
+	{
+		for (uint32_t Chunk = BeginChunk; Chunk < EndChunk; Chunk++)
+		{
+			const uint64_t Begin = GetChunkOffset(Stored, Chunk);
+			const uint64_t StoredBytes = GetChunkOffset(Stored, Chunk + 1) - Begin;
+			const uint64_t DecodedOffset = static_cast<uint64_t>(Chunk) * ChunkSize;
+			const size_t ChunkBytes = static_cast<size_t>(std::min<uint64_t>(ChunkSize, Entry.Size - DecodedOffset));
+			if (StoredBytes == ChunkBytes)
+			{
+				memcpy(Destination + DecodedOffset, Stored + Begin, ChunkBytes);
+			}
+			else if (!DecompressLz4(Stored + Begin, static_cast<size_t>(StoredBytes), Destination + DecodedOffset, ChunkBytes))
+			{
+				Succeeded.store(false, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	if (Jobs != nullptr && Entry.ChunkCount > 1)
+	{
+		Jobs->ParallelFor(0, Entry.ChunkCount, 1, DecodeChunks);
+	}
+	else
+	{
+		DecodeChunks(0, Entry.ChunkCount);
+	}
+	return Succeeded.load(std::memory_order_relaxed);
+}
+
+bool AssetArchive::ReadTexture(const AssetArchiveEntry& Entry, const TextureStreamStaging& Staging, JobSystem* Jobs) const
+{
+	if (!Entry.IsTexture() || Entry.Format != Staging.Format || Entry.Width != Staging.Width || Entry.Height != Staging.Height || Entry.MipLevelCount != Staging.MipLevelCount) return false;
+
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	GetTextureSize(Entry.Format, Entry.Width, Entry.Height, Entry.MipLevelCount, Levels);
+	bool SameLayout = true;
+	for (uint32_t Level = 0; Level < Entry.MipLevelCount; Level++)
+	{
+		SameLayout = SameLayout && Levels[Level].Offset == Staging.Levels[Level].Offset && Levels[Level].RowPitch == Staging.Levels[Level].RowPitch;
+	}
+	if (SameLayout) return Read(Entry, Staging.Pixels, Jobs);
+
+	// Only compressed entries need somewhere to decode to before the rows can be moved
+	const uint8_t* Source = GetStoredData(Entry);
+	std::vector<uint8_t> Decoded;
+	if (Entry.Compression != ArchiveCompression::None)
+	{
+		Decoded.resize(static_cast<size_t>(Entry.Size));
+		if (!Read(Entry, Decoded.data(), Jobs)) return false;
+		Source = Decoded.data();
+	}
+
+	for (uint32_t Level = 0; Level < Entry.MipLevelCount; Level++)
+	{
+		const uint32_t RowBytes = GetRowBytes(Entry.Format, Levels[Level]);
+		const uint32_t RowCount = GetRowCount(Entry.Format, Levels[Level]);
+		for (uint32_t Row = 0; Row < RowCount; Row++)
+		{
+			memcpy(Staging.Pixels + Staging.Levels[Level].Offset + static_cast<uint64_t>(Row) * Staging.Levels[Level].RowPitch, Source + Levels[Level].Offset + static_cast<uint64_t>(Row) * Levels[Level].RowPitch, RowBytes);
+		}
+	}
+	return true;
+}
+
+AssetArchiveWriter::AssetArchiveWriter(ArchiveCompression Compression, uint32_t ChunkSize, JobSystem* Jobs) :
+	Compression(Compression),
+	ChunkSize(ChunkSize),
+	Jobs(Jobs)
+{
+	if (ChunkSize == 0) throw std::runtime_error("Archive chunks must not be empty");
+}
+
+void AssetArchiveWriter::AddBlob(const std::string& Name, const void* Data, size_t Size)
+{
+	AssetArchiveEntry Record = {};
+	Add(Name, static_cast<const uint8_t*>(Data), Size, Record);
+}
+
+void AssetArchiveWriter::AddTexture(const std::string& Name, TextureFormat Format, uint32_t Width, uint32_t Height, uint32_t MipLevelCount, const uint8_t* Levels)
+{
+	if (Width == 0 || Height == 0 || Width > MaximumTextureDimension || Height > MaximumTextureDimension || MipLevelCount == 0 || MipLevelCount > GetFullMipLevelCount(Width, Height)) throw std::runtime_error("Invalid archive texture dimensions");
+
+	TextureLevelLayout Layouts[MaximumMipLevelCount];
+	AssetArchiveEntry Record = {};
+	Record.Width = Width;
+	Record.Height = Height;
+	Record.MipLevelCount = MipLevelCount;
+	Record.Format = Format;
+	Add(Name, Levels, GetTextureSize(Format, Width, Height, MipLevelCount, Layouts), Record);
+}
+
+void AssetArchiveWriter::Add(const std::string& Name, const uint8_t* Data, uint64_t Size, AssetArchiveEntry Record)
+{
+	for (const PendingEntry& Existing : Pending)
+	{
+		if (Existing.Name == Name) throw std::runtime_error("Duplicate archive entry " + Name);
+	}
+
+	PendingEntry NewEntry;
+	NewEntry.Name = Name;
+	Record.NameHash = HashName(Name.data(), Name.size());
+	Record.NameSize = static_cast<uint32_t>(Name.size());
+	Record.Size = Size;
+	Record.Compression = Compression;
+
+	if (Compression == ArchiveCompression::None)
+	{
+		NewEntry.Stored.assign(Data, Data + Size);
+	}
+	else
+	{
+		// Every chunk compresses into its own bound sized slot, then the slots are packed behind the offset table
+		const uint32_t ChunkCount = static_cast<uint32_t>((Size + ChunkSize - 1) / ChunkSize);
+		const size_t Bound = GetLz4CompressBound(ChunkSize);
+		std::vector<uint8_t> Compressed(ChunkCount * Bound);
+		std::vector<size_t> CompressedSizes(ChunkCount);
+		auto CompressChunks = [&](uint32_t BeginChunk, uint32_t EndChunk)
+		{
+			for (uint32_t Chunk = BeginChunk; Chunk < EndChunk; Chunk++)
+			{
+				const uint64_t Offset = static_cast<uint64_t>(Chunk) * ChunkSize;
+				const size_t ChunkBytes = static_cast<size_t>(std::min<uint64_t>(ChunkSize, Size - Offset));
+				// Chunks that do not shrink are kept raw, which is how the reader tells them apart
+				size_t CompressedSize = CompressLz4(Data + Offset, ChunkBytes, &Compressed[Chunk * Bound], ChunkBytes - 1);
+				if (CompressedSize == 0)
+				{
+					memcpy(&Compressed[Chunk * Bound], Data + Offset, ChunkBytes);
+					CompressedSize = ChunkBytes;
+				}
+				CompressedSizes[Chunk] = CompressedSize;
+			}
+		};
+		if (Jobs != nullptr && ChunkCount > 1)
+		{
+			Jobs->ParallelFor(0, ChunkCount, 1, CompressChunks);
+		}
+		else
+		{
+			CompressChunks(0, ChunkCount);
+		}
+
+		std::vector<uint64_t> ChunkOffsets(ChunkCount + 1);
+		ChunkOffsets[0] = ChunkOffsets.size() * sizeof(uint64_t);
+		for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+		{
+			ChunkOffsets[Chunk + 1] = ChunkOffsets[Chunk] + CompressedSizes[Chunk];
+		}
+		NewEntry.Stored.resize(static_cast<size_t>(ChunkOffsets.back()));
+		memcpy(NewEntry.Stored.data(), ChunkOffsets.data(), ChunkOffsets.size() * sizeof(uint64_t));
+		for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+		{
+			memcpy(&NewEntry.Stored[static_cast<size_t>(ChunkOffsets[Chunk])], &Compressed[Chunk * Bound], CompressedSizes[Chunk]);
+		}
+		Record.ChunkCount = ChunkCount;
+	}
+
+	Record.StoredSize = NewEntry.Stored.size();
+	NewEntry.Record = Record;
+	Pending.push_back(std::move(NewEntry));
+	DataSize += Size;
+}
+
+uint64_t AssetArchiveWriter::GetFileSize() const
+{
+	const uint32_t EntryCount = static_cast<uint32_t>(Pending.size());
+	uint64_t Size = sizeof(ArchiveHeader) + static_cast<uint64_t>(EntryCount) * sizeof(AssetArchiveEntry) + static_cast<uint64_t>(GetSlotCount(EntryCount)) * sizeof(uint32_t);
+	for (const PendingEntry& Entry : Pending)
+	{
+		Size += Entry.Name.size();
+	}
+	for (const PendingEntry& Entry : Pending)
+	{
+		Size = AlignUp(Size, AssetArchiveDataAlignment) + Entry.Stored.size();
+	}
+	return Size;
+}
+
+bool AssetArchiveWriter::Write(const std::string& Path) const
+{
+	const uint32_t EntryCount = static_cast<uint32_t>(Pending.size());
+	const uint32_t SlotCount = GetSlotCount(EntryCount);
+	std::vector<uint8_t> Buffer(static_cast<size_t>(GetFileSize()));
+
+	ArchiveHeader Header = {};
+	Header.Magic = ArchiveMagic;
+	Header.Version = ArchiveVersion;
+	Header.EntryCount = EntryCount;
+	Header.SlotCount = SlotCount;
+	Header.ChunkSize = ChunkSize;
+	Header.Size = Buffer.size();
+	memcpy(Buffer.data(), &Header, sizeof(Header));
+
+	const uint64_t EntryTableOffset = sizeof(ArchiveHeader);
+	const uint64_t SlotOffset = EntryTableOffset + static_cast<uint64_t>(EntryCount) * sizeof(AssetArchiveEntry);
+	std::vector<uint32_t> Slots(SlotCount, EmptySlot);
+	uint64_t NameOffset = SlotOffset + static_cast<uint64_t>(SlotCount) * sizeof(uint32_t);
+	uint64_t DataOffset = NameOffset;
+	for (const PendingEntry& Entry : Pending)
+	{
+		DataOffset += Entry.Name.size();
+	}
+
+	for (uint32_t EntryIndex = 0; EntryIndex < EntryCount; EntryIndex++)
+	{
+		const PendingEntry& Entry = Pending[EntryIndex];
+		DataOffset = AlignUp(DataOffset, AssetArchiveDataAlignment);
+
+		AssetArchiveEntry Record = Entry.Record;
+		Record.NameOffset = static_cast<uint32_t>(NameOffset);
+		Record.Offset = DataOffset;
+		memcpy(Buffer.data() + EntryTableOffset + EntryIndex * sizeof(AssetArchiveEntry), &Record, sizeof(Record));
+		memcpy(Buffer.data() + NameOffset, Entry.Name.data(), Entry.Name.size());
+		if (!Entry.Stored.empty())
+		{
+			memcpy(Buffer.data() + DataOffset, Entry.Stored.data(), Entry.Stored.size());
+		}
+		NameOffset += Entry.Name.size();
+		DataOffset += Entry.Stored.size();
+
+		uint64_t Slot = Record.NameHash;
+		while (Slots[Slot & (SlotCount - 1)] != EmptySlot)
+		{
+			Slot++;
+		}
+		Slots[Slot & (SlotCount - 1)] = EntryIndex;
+	}
+	memcpy(Buffer.data() + SlotOffset, Slots.data(), Slots.size() * sizeof(uint32_t));
+
+	return WriteFileAtomically(Path, Buffer.data(), Buffer.size());
+}
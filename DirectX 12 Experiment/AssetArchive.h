@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "RenderDevice.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Packed assets in one file: a header, the entry table, a hashed table of contents over the names, the names and
+// then each entry's data starting on its own page. The file is mapped, so data goes from the page cache straight
+// into staging memory; uncompressed entries are never copied anywhere else.
+//
+// Textures are stored as their whole mip chain laid out the way D3D12 places subresources in upload memory, rows
+// padded to 256 bytes and levels to 512, so a matching staging footprint takes them in a single copy. The padding
+// after the very last row is left out, as it is from the upload size D3D12 reports.
+static const uint32_t AssetArchiveRowAlignment = 256;
+static const uint32_t AssetArchiveLevelAlignment = 512;
+static const uint64_t AssetArchiveDataAlignment = 4096;
+
+enum class ArchiveCompression : uint32_t
+{
+	None,
+	// Independent LZ4 blocks of ChunkSize bytes, so they decompress in parallel and a range never decodes more
+	// than one extra chunk
+	Lz4
+};
+
+// Read in place from the mapping, so every field is fixed size and the record a multiple of eight bytes.
+// Compressed data starts with ChunkCount + 1 offsets relative to Offset; a chunk stored as many bytes as it
+// decodes to is kept raw.
+struct AssetArchiveEntry
+{
+	uint64_t NameHash;
+	uint64_t Offset;
+	uint64_t Size;
+	uint64_t StoredSize;
+	uint32_t NameOffset;
+	uint32_t NameSize;
+	ArchiveCompression Compression;
+	uint32_t ChunkCount;
+	// Zero width for plain blobs
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipLevelCount;
+	TextureFormat Format;
+
+	bool IsTexture() const { return Width != 0; }
+};
+
+class AssetArchive
+{
+public:
+	AssetArchive() = default;
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	// Returns false when the file is missing, from another version or damaged. Every table is validated here,
+	// so nothing read afterwards can point outside the file.
+	bool Open(const std::string& Path);
+	void Close();
+	bool IsOpen() const { return File.IsOpen(); }
+
+	uint32_t GetEntryCount() const { return EntryCount; }
+	const AssetArchiveEntry& GetEntry(uint32_t Index) const { return Entries[Index]; }
+	std::string GetName(const AssetArchiveEntry& Entry) const;
+
+	// Null when no entry has the name
+	const AssetArchiveEntry* Find(const std::string& Name) const;
+
+	// The entry's bytes as stored in the mapping, which for uncompressed entries is the data itself
+	const uint8_t* GetStoredData(const AssetArchiveEntry& Entry) const { return File.GetData() + Entry.Offset; }
+
+	// Decompresses Entry.Size bytes into Destination, chunks spread across the job system when one is given.
+	// Returns false if a chunk does not decode.
+	bool Read(const AssetArchiveEntry& Entry, uint8_t* Destination, JobSystem* Jobs = nullptr) const;
+
+	// Fills streamed staging memory with a texture entry. Matching footprints take the whole chain at once,
+	// others are copied row by row. Returns false when the size, level count or format differs from the staging.
+	bool ReadTexture(const AssetArchiveEntry& Entry, const TextureStreamStaging& Staging, JobSystem* Jobs = nullptr) const;
+
+private:
+	MappedFile File;
+	const AssetArchiveEntry* Entries = nullptr;
+	const uint32_t* Slots = nullptr;
+	uint32_t EntryCount = 0;
+	uint32_t SlotCount = 0;
+	uint32_t ChunkSize = 0;
+};
+
+// Builds an archive in memory and writes it in one go. Entries are compressed as they are added.
+class AssetArchiveWriter
+{
+public:
+	explicit AssetArchiveWriter(ArchiveCompression Compression = ArchiveCompression::None, uint32_t ChunkSize = 64 * 1024, JobSystem* Jobs = nullptr);
+
+	// Names must be unique; a second entry with the same name throws
+	void AddBlob(const std::string& Name, const void* Data, size_t Size);
+
+	// Levels holds the whole chain as laid out by GetTextureLevelLayouts with the archive's row and level alignment;
+	// the last row's padding is not read
+	void AddTexture(const std::string& Name, TextureFormat Format, uint32_t Width, uint32_t Height, uint32_t MipLevelCount, const uint8_t* Levels);
+
+	// Uncompressed bytes of every entry and the size of the file Write would produce
+	uint64_t GetDataSize() const { return DataSize; }
+	uint64_t GetFileSize() const;
+
+	bool Write(const std::string& Path) const;
+
+private:
+	struct PendingEntry
+	{
+		std::string Name;
+		AssetArchiveEntry Record;
+		std::vector<uint8_t> Stored;
+	};
+
+	ArchiveCompression Compression;
+	uint32_t ChunkSize;
+	JobSystem* Jobs;
+	std::vector<PendingEntry> Pending;
+	uint64_t DataSize = 0;
+
+	void Add(const std::string& Name, const uint8_t* Data, uint64_t Size, AssetArchiveEntry Record);
+};
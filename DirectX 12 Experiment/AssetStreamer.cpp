@@ -0,0 +1,237 @@
+#include "AssetStreamer.h"
+
+#include <algorithm>
+
+AssetStreamer::AssetStreamer(RenderDevice& Device, uint64_t BudgetBytes, uint32_t NumberOfDecodeThreads) :
+	Device(Device),
+	BudgetBytes(BudgetBytes)
+{
+	for (uint32_t ThreadIndex = 0; ThreadIndex < std::max(NumberOfDecodeThreads, 1u); ThreadIndex++)
+	{
+		DecodeThreads.emplace_back(&AssetStreamer::DecodeMain, this);
+	}
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		ShuttingDown = true;
+	}
+	DecodeCondition.notify_all();
+	for (std::thread& DecodeThread : DecodeThreads)
+	{
+		DecodeThread.join();
+	}
+
+	// Give back staging that was reserved but never submitted
+	for (auto& Entry : Streams)
+	{
+		const StreamState State = Entry.second.State;
+		if (State == StreamState::Decoding || State == StreamState::Decoded)
+		{
+			Device.CancelTextureStream(Entry.second.Staging);
+		}
+	}
+}
+
+StreamTicket AssetStreamer::Request(StreamRequest NewRequest)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	const StreamTicket Ticket = NextTicket++;
+
+	Stream& NewStream = Streams[Ticket];
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	NewStream.Bytes = GetTextureLevelLayouts(NewRequest.Format, NewRequest.Width, NewRequest.Height, GetFullMipLevelCount(NewRequest.Width, NewRequest.Height), 1, 1, Levels);
+	NewStream.Request = std::move(NewRequest);
+	PendingQueue.push({ NewStream.Request.Priority, Ticket });
+	return Ticket;
+}
+
+bool AssetStreamer::Cancel(StreamTicket Ticket)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	auto Entry = Streams.find(Ticket);
+	if (Entry == Streams.end()) return false;
+
+	Stream& Target = Entry->second;
+	switch (Target.State)
+	{
+	case StreamState::Queued:
+		// Still in the pending queue, Pump skips it when it reaches the top
+		Target.State = StreamState::Cancelled;
+		Statistics.CancelledStreams++;
+		return true;
+
+	case StreamState::Decoding:
+	case StreamState::Decoded:
+		// The decode thread may be writing into staging, so Pump releases it once the decode has finished
+		Target.CancelRequested = true;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+StreamState AssetStreamer::GetState(StreamTicket Ticket) const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	auto Entry = Streams.find(Ticket);
+	if (Entry == Streams.end()) return StreamState::Unknown;
+	return Entry->second.CancelRequested ? StreamState::Cancelled : Entry->second.State;
+}
+
+void AssetStreamer::Pump()
+{
+	const uint64_t CompletedFenceValue = Device.GetCompletedStreamFenceValue();
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+
+	for (size_t Index = 0; Index < UploadingStreams.size();)
+	{
+		Stream& Uploading = Streams.at(UploadingStreams[Index]);
+		if (Uploading.FenceValue > CompletedFenceValue)
+		{
+			Index++;
+			continue;
+		}
+
+		Uploading.State = StreamState::Ready;
+		Uploading.Request.Decode = nullptr;
+		Uploading.Request.Load = nullptr;
+		Statistics.BytesInFlight -= Uploading.Bytes;
+		Statistics.CompletedStreams++;
+		UploadingStreams[Index] = UploadingStreams.back();
+		UploadingStreams.pop_back();
+	}
+
+	for (StreamTicket Ticket : DecodedStreams)
+	{
+		Stream& Decoded = Streams.at(Ticket);
+		if (Decoded.CancelRequested || !Decoded.DecodeSucceeded)
+		{
+			Device.CancelTextureStream(Decoded.Staging);
+			Statistics.BytesInFlight -= Decoded.Bytes;
+			if (Decoded.CancelRequested)
+			{
+				Decoded.State = StreamState::Cancelled;
+				Statistics.CancelledStreams++;
+			}
+			else
+			{
+				Decoded.State = StreamState::Failed;
+				Statistics.FailedStreams++;
+			}
+			Decoded.CancelRequested = false;
+			Decoded.Request.Decode = nullptr;
+			Decoded.Request.Load = nullptr;
+			continue;
+		}
+
+		Decoded.FenceValue = Device.SubmitTextureStream(Decoded.Staging);
+		Decoded.State = StreamState::Uploading;
+		UploadingStreams.push_back(Ticket);
+	}
+	DecodedStreams.clear();
+
+	bool StartedDecodes = false;
+	while (!PendingQueue.empty())
+	{
+		const StreamTicket Ticket = PendingQueue.top().Ticket;
+		Stream& Pending = Streams.at(Ticket);
+		if (Pending.State != StreamState::Queued)
+		{
+			PendingQueue.pop();
+			continue;
+		}
+
+		if (Statistics.BytesInFlight != 0 && Statistics.BytesInFlight + Pending.Bytes > BudgetBytes) break;
+		TextureDescription Description;
+		Description.Width = Pending.Request.Width;
+		Description.Height = Pending.Request.Height;
+		Description.Format = Pending.Request.Format;
+		if (!Device.TryBeginTextureStream(Description, Pending.Staging))
+		{
+			Statistics.StagingStalls++;
+			break;
+		}
+
+		PendingQueue.pop();
+		Pending.State = StreamState::Decoding;
+		Statistics.BytesInFlight += Pending.Bytes;
+		Statistics.PeakBytesInFlight = std::max(Statistics.PeakBytesInFlight, Statistics.BytesInFlight);
+		DecodeQueue.push({ Pending.Request.Priority, Ticket });
+		StartedDecodes = true;
+	}
+
+	Lock.unlock();
+	if (StartedDecodes)
+	{
+		DecodeCondition.notify_all();
+	}
+}
+
+AssetStreamerStatistics AssetStreamer::GetStatistics() const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return Statistics;
+}
+
+void AssetStreamer::DecodeMain()
+{
+	// Compressed streams decode and filter in RGBA8 here before encoding into staging, reused across streams
+	std::vector<uint8_t> PixelChain;
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while (true)
+	{
+		DecodeCondition.wait(Lock, [this]() { return ShuttingDown || !DecodeQueue.empty(); });
+		if (ShuttingDown) return;
+
+		const StreamTicket Ticket = DecodeQueue.top().Ticket;
+		DecodeQueue.pop();
+
+		// Map nodes are stable, so the stream can be used unlocked while only this thread touches its staging
+		Stream& Decoding = Streams.at(Ticket);
+		bool Succeeded = false;
+		if (!Decoding.CancelRequested)
+		{
+			const StreamDecoder Decode = Decoding.Request.Decode;
+			const StreamLoader Load = Decoding.Request.Load;
+			const TextureStreamStaging Staging = Decoding.Staging;
+			MipGenerationOptions MipOptions;
+			MipOptions.Filter = Decoding.Request.Filter;
+			Lock.unlock();
+
+			if (Load)
+			{
+				Succeeded = Load(Staging);
+			}
+			else if (IsBlockCompressed(Staging.Format))
+			{
+				TextureLevelLayout PixelLevels[MaximumMipLevelCount];
+				PixelChain.resize(GetTextureLevelLayouts(TextureFormat::Rgba8, Staging.Width, Staging.Height, Staging.MipLevelCount, 4, 16, PixelLevels));
+				Succeeded = Decode(PixelChain.data(), PixelLevels[0].RowPitch);
+				if (Succeeded)
+				{
+					GenerateMipChain(PixelChain.data(), PixelLevels, Staging.MipLevelCount, MipOptions);
+					CompressTexture(Staging.Format, PixelChain.data(), PixelLevels, Staging.Pixels, Staging.Levels, Staging.MipLevelCount, BlockCompressionOptions());
+				}
+			}
+			else
+			{
+				Succeeded = Decode(Staging.Pixels, Staging.RowPitch);
+				if (Succeeded)
+				{
+					GenerateMipChain(Staging.Pixels, Staging.Levels, Staging.MipLevelCount, MipOptions);
+				}
+			}
+			Lock.lock();
+		}
+
+		Decoding.DecodeSucceeded = Succeeded;
+		Decoding.State = StreamState::Decoded;
+		DecodedStreams.push_back(Ticket);
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using StreamTicket = uint64_t;
+
+enum class StreamState
+{
+	Queued,
+	Decoding,
+	Decoded,
+	Uploading,
+	Ready,
+	Cancelled,
+	Failed,
+	Unknown
+};
+
+// Fills level zero with Height rows of RGBA8 texels, RowPitch bytes apart, and returns false if the source could
+// not be decoded. The streamer generates the remaining mip levels and any block compression afterwards on the same thread.
+using StreamDecoder = std::function<bool(uint8_t* Pixels, uint32_t RowPitch)>;
+
+// Fills every level of the staging in Staging.Format, for assets stored ready to upload such as archive textures.
+// Returns false if the data does not fit the staging, which fails the stream.
+using StreamLoader = std::function<bool(const TextureStreamStaging& Staging)>;
+
+struct StreamRequest
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	int32_t Priority = 0;
+	MipFilter Filter = MipFilter::Box;
+	TextureFormat Format = TextureFormat::Rgba8;
+	StreamDecoder Decode;
+	// Takes the place of Decode when set; no mips are generated and nothing is compressed afterwards
+	StreamLoader Load;
+};
+
+struct AssetStreamerStatistics
+{
+	uint64_t BytesInFlight = 0;
+	uint64_t PeakBytesInFlight = 0;
+	uint64_t CompletedStreams = 0;
+	uint64_t CancelledStreams = 0;
+	uint64_t FailedStreams = 0;
+	uint64_t StagingStalls = 0;
+};
+
+// Streams textures in the background. Decoding runs on the streamer's own threads so it never competes with
+// draw recording, straight into staging memory the device reserved; copies go out on the device's copy queue.
+// Request, Cancel and GetState may be called from any thread, Pump only from the thread that owns the device.
+class AssetStreamer
+{
+public:
+	// The budget bounds bytes between staging reservation and copy completion; a single larger request still proceeds alone
+	AssetStreamer(RenderDevice& Device, uint64_t BudgetBytes, uint32_t NumberOfDecodeThreads = 1);
+	~AssetStreamer();
+
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+	// Higher priorities start first, equal priorities in request order
+	StreamTicket Request(StreamRequest NewRequest);
+
+	// Streams already handed to the copy queue can no longer be cancelled
+	bool Cancel(StreamTicket Ticket);
+	StreamState GetState(StreamTicket Ticket) const;
+
+	// Retires completed copies, submits decoded textures and starts new decodes within the budget
+	void Pump();
+
+	AssetStreamerStatistics GetStatistics() const;
+
+private:
+	struct Stream
+	{
+		StreamRequest Request;
+		StreamState State = StreamState::Queued;
+		TextureStreamStaging Staging;
+		uint64_t Bytes = 0;
+		uint64_t FenceValue = 0;
+		bool CancelRequested = false;
+		bool DecodeSucceeded = false;
+	};
+
+	struct QueueEntry
+	{
+		int32_t Priority;
+		StreamTicket Ticket;
+
+		bool operator<(const QueueEntry& Other) const
+		{
+			return Priority != Other.Priority ? Priority < Other.Priority : Ticket > Other.Ticket;
+		}
+	};
+
+	RenderDevice& Device;
+	uint64_t BudgetBytes;
+
+	mutable std::mutex Mutex;
+	std::condition_variable DecodeCondition;
+	std::unordered_map<StreamTicket, Stream> Streams;
+	std::priority_queue<QueueEntry> PendingQueue;
+	std::priority_queue<QueueEntry> DecodeQueue;
+	std::vector<StreamTicket> DecodedStreams;
+	std::vector<StreamTicket> UploadingStreams;
+	StreamTicket NextTicket = 1;
+	bool ShuttingDown = false;
+	AssetStreamerStatistics Statistics;
+
+	std::vector<std::thread> DecodeThreads;
+
+	void DecodeMain();
+};
@@ -0,0 +1,233 @@
+#include "AssetArchive.h"
+#include "BenchmarkFramework.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ProceduralTexture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static std::string GetTemporaryDirectory()
+{
+#ifdef _WIN32
+	const char* Directory = std::getenv("TEMP");
+	return Directory != nullptr ? std::string(Directory) + "\\" : std::string(".\\");
+#else
+	const char* Directory = std::getenv("TMPDIR");
+	return Directory != nullptr ? std::string(Directory) + "/" : std::string("/tmp/");
+#endif
+}
+
+struct PackedAsset
+{
+	std::string Name;
+	bool Texture = false;
+	uint32_t Size = 0;
+	std::vector<uint8_t> Data;
+};
+
+// Checkerboards and noise with full mip chains in the archive's layout, alternating so the compressed archive holds
+// both easy and incompressible data, plus a blob per texture standing in for meshes
+static std::vector<PackedAsset> CreateAssets(uint32_t TextureCount, uint32_t TextureSize, JobSystem& Jobs)
+{
+	std::vector<PackedAsset> Assets;
+	std::mt19937 Random(11);
+	for (uint32_t TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+	{
+		PackedAsset Texture;
+		Texture.Name = "Texture" + std::to_string(TextureIndex);
+		Texture.Texture = true;
+		Texture.Size = TextureSize;
+		const uint32_t LevelCount = GetFullMipLevelCount(TextureSize, TextureSize);
+		TextureLevelLayout Levels[MaximumMipLevelCount];
+		Texture.Data.resize(static_cast<size_t>(GetTextureLevelLayouts(TextureFormat::Rgba8, TextureSize, TextureSize, LevelCount, AssetArchiveRowAlignment, AssetArchiveLevelAlignment, Levels)));
+		ProceduralTextureDescription Description;
+		Description.Pattern = TextureIndex % 2 == 0 ? ProceduralPattern::Checker : ProceduralPattern::Noise;
+		Description.Width = TextureSize;
+		Description.Height = TextureSize;
+		Description.CellSize = 32;
+		GenerateProceduralTexture(Description, Texture.Data.data(), Levels[0].RowPitch, &Jobs);
+		GenerateMipChain(Texture.Data.data(), Levels, LevelCount, MipGenerationOptions(), &Jobs);
+		Assets.push_back(std::move(Texture));
+
+		PackedAsset Blob;
+		Blob.Name = "Mesh" + std::to_string(TextureIndex);
+		Blob.Data.resize(static_cast<size_t>(TextureSize) * TextureSize);
+		for (size_t Index = 0; Index < Blob.Data.size(); Index++)
+		{
+			Blob.Data[Index] = Index % 16 < 12 ? static_cast<uint8_t>(Index >> 4) : static_cast<uint8_t>(Random());
+		}
+		Assets.push_back(std::move(Blob));
+	}
+	return Assets;
+}
+
+// Drops the archive from the page cache so the next pass reads from the disk. Only clean pages of files nobody
+// maps are dropped, which holds between passes since the archive is closed. A no-op on tmpfs.
+static void EvictFromPageCache(const std::string& Path)
+{
+#ifndef _WIN32
+	const int File = open(Path.c_str(), O_RDONLY);
+	if (File < 0) return;
+	fdatasync(File);
+	posix_fadvise(File, 0, 0, POSIX_FADV_DONTNEED);
+	close(File);
+#else
+	(void)Path;
+#endif
+}
+
+// Both paths end in the same staging buffers. Mapped reads go from the page cache straight into staging; buffered
+// reads are the loose file route, read into a vector and then copied or decompressed into staging.
+static bool LoadArchive(const std::string& ArchivePath, bool Mapped, JobSystem* Jobs, const std::vector<PackedAsset>& Assets, std::vector<std::vector<uint8_t>>& Staging)
+{
+	AssetArchive Archive;
+	if (!Archive.Open(ArchivePath)) return false;
+	FILE* File = Mapped ? nullptr : fopen(ArchivePath.c_str(), "rb");
+	if (!Mapped && File == nullptr) return false;
+
+	bool Loaded = true;
+	for (size_t AssetIndex = 0; AssetIndex < Assets.size() && Loaded; AssetIndex++)
+	{
+		const AssetArchiveEntry* Entry = Archive.Find(Assets[AssetIndex].Name);
+		if (Entry == nullptr || Entry->Size != Staging[AssetIndex].size())
+		{
+			Loaded = false;
+			break;
+		}
+
+		uint8_t* Destination = Staging[AssetIndex].data();
+		if (Mapped)
+		{
+			Loaded = Archive.Read(*Entry, Destination, Jobs);
+			continue;
+		}
+
+		std::vector<uint8_t> Stored(static_cast<size_t>(Entry->StoredSize));
+		fseek(File, static_cast<long>(Entry->Offset), SEEK_SET);
+		Loaded = fread(Stored.data(), 1, Stored.size(), File) == Stored.size();
+		if (Loaded && Entry->Compression == ArchiveCompression::None)
+		{
+			memcpy(Destination, Stored.data(), Stored.size());
+		}
+		else if (Loaded)
+		{
+			Loaded = Archive.Read(*Entry, Destination, Jobs);
+		}
+	}
+	if (File != nullptr)
+	{
+		fclose(File);
+	}
+	return Loaded;
+}
+
+// Loading every asset of an uncompressed and an LZ4 archive through the mapping and through buffered reads, warm
+// and with the archive evicted from the page cache. Every pass must leave the packed bytes in staging.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t TextureCount = Quick ? 4 : 24;
+	const uint32_t TextureSize = Quick ? 256 : 1024;
+	const uint32_t Passes = Quick ? 2 : 5;
+
+	JobSystem Jobs;
+	const std::vector<PackedAsset> Assets = CreateAssets(TextureCount, TextureSize, Jobs);
+	std::vector<std::vector<uint8_t>> Staging(Assets.size());
+
+	struct Variant
+	{
+		const char* Name;
+		bool Mapped;
+		bool Cold;
+		JobSystem* Jobs;
+	};
+	const Variant Variants[] =
+	{
+		{ "mapped, warm", true, false, nullptr },
+		{ "buffered, warm", false, false, nullptr },
+		{ "mapped, warm, jobs", true, false, &Jobs },
+		{ "mapped, cold", true, true, nullptr },
+		{ "buffered, cold", false, true, nullptr }
+	};
+
+	const std::string ArchivePath = GetTemporaryDirectory() + "AssetArchiveBenchmark.pack";
+	printf("%zu assets, best and median of %u passes, %u threads\n", Assets.size(), Passes, Jobs.GetThreadCount());
+	printf("%-5s %-20s %10s %10s %10s %10s\n", "codec", "load", "best ms", "MB/s", "median ms", "MB/s");
+
+	for (ArchiveCompression Compression : { ArchiveCompression::None, ArchiveCompression::Lz4 })
+	{
+		AssetArchiveWriter Writer(Compression, 64 * 1024, &Jobs);
+		for (const PackedAsset& Asset : Assets)
+		{
+			if (Asset.Texture)
+			{
+				Writer.AddTexture(Asset.Name, TextureFormat::Rgba8, Asset.Size, Asset.Size, GetFullMipLevelCount(Asset.Size, Asset.Size), Asset.Data.data());
+			}
+			else
+			{
+				Writer.AddBlob(Asset.Name, Asset.Data.data(), Asset.Data.size());
+			}
+		}
+		BenchmarkExpect(Writer.Write(ArchivePath), "the archive can be written");
+
+		// Texture entries leave out the last row's padding, so staging takes the stored size
+		AssetArchive Archive;
+		BenchmarkExpect(Archive.Open(ArchivePath), "the archive opens");
+		uint64_t TotalBytes = 0;
+		for (size_t AssetIndex = 0; AssetIndex < Assets.size() && Archive.IsOpen(); AssetIndex++)
+		{
+			const AssetArchiveEntry* Entry = Archive.Find(Assets[AssetIndex].Name);
+			Staging[AssetIndex].assign(Entry != nullptr ? static_cast<size_t>(Entry->Size) : 0, 0);
+			TotalBytes += Staging[AssetIndex].size();
+		}
+		Archive.Close();
+		const char* CodecName = Compression == ArchiveCompression::None ? "none" : "lz4";
+		printf("%-5s %llu bytes of assets in %llu bytes on disk (%.3f)\n", CodecName, static_cast<unsigned long long>(TotalBytes), static_cast<unsigned long long>(Writer.GetFileSize()), static_cast<double>(Writer.GetFileSize()) / static_cast<double>(std::max<uint64_t>(TotalBytes, 1)));
+
+		for (const Variant& Measured : Variants)
+		{
+			for (std::vector<uint8_t>& Buffer : Staging)
+			{
+				std::fill(Buffer.begin(), Buffer.end(), 0);
+			}
+
+			std::vector<double> Milliseconds;
+			bool Loaded = true;
+			for (uint32_t Pass = 0; Pass < Passes; Pass++)
+			{
+				if (Measured.Cold)
+				{
+					EvictFromPageCache(ArchivePath);
+				}
+				const auto Start = std::chrono::steady_clock::now();
+				Loaded &= LoadArchive(ArchivePath, Measured.Mapped, Measured.Jobs, Assets, Staging);
+				Milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count());
+			}
+			const double Best = GetPercentile(Milliseconds, 0.0);
+			const double Median = GetPercentile(Milliseconds, 50.0);
+			printf("%-5s %-20s %10.2f %10.1f %10.2f %10.1f\n", CodecName, Measured.Name, Best, GetMillionsPerSecond(static_cast<double>(TotalBytes), Best), Median,
+				GetMillionsPerSecond(static_cast<double>(TotalBytes), Median));
+
+			BenchmarkExpect(Loaded, "every entry loads");
+			bool Matches = true;
+			for (size_t AssetIndex = 0; AssetIndex < Assets.size(); AssetIndex++)
+			{
+				Matches &= !Staging[AssetIndex].empty() && std::equal(Staging[AssetIndex].begin(), Staging[AssetIndex].end(), Assets[AssetIndex].Data.begin());
+			}
+			BenchmarkExpect(Matches, "every load leaves the packed bytes in staging");
+		}
+	}
+
+	std::remove(ArchivePath.c_str());
+	return GetBenchmarkExitCode();
+}
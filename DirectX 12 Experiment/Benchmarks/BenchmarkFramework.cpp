@@ -0,0 +1,42 @@
+#include "BenchmarkFramework.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static bool ExpectationFailed = false;
+
+bool IsQuickBenchmarkRun(int NumberOfArguments, char* Arguments[])
+{
+	for (int ArgumentIndex = 1; ArgumentIndex < NumberOfArguments; ArgumentIndex++)
+	{
+		if (strcmp(Arguments[ArgumentIndex], "--quick") == 0) return true;
+	}
+	return false;
+}
+
+void BenchmarkExpect(bool Condition, const char* Description)
+{
+	if (Condition) return;
+	ExpectationFailed = true;
+	fprintf(stderr, "expectation failed: %s\n", Description);
+}
+
+int GetBenchmarkExitCode()
+{
+	return ExpectationFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+double GetPercentile(std::vector<double> Samples, double Percentile)
+{
+	if (Samples.empty()) return 0.0;
+	std::sort(Samples.begin(), Samples.end());
+	const size_t Rank = static_cast<size_t>(std::ceil(Percentile / 100.0 * static_cast<double>(Samples.size())));
+	return Samples[std::min(std::max(Rank, static_cast<size_t>(1)), Samples.size()) - 1];
+}
+
+double GetMillionsPerSecond(double Count, double Milliseconds)
+{
+	return Milliseconds > 0.0 ? Count / (Milliseconds * 1000.0) : 0.0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Benchmarks are plain executables. --quick shrinks sizes and repetitions so ctest can run them as smoke tests;
+// results they can validate are checked with BenchmarkExpect, which fails the run without stopping it.
+bool IsQuickBenchmarkRun(int NumberOfArguments, char* Arguments[]);
+
+void BenchmarkExpect(bool Condition, const char* Description);
+
+// Zero when every expectation held
+int GetBenchmarkExitCode();
+
+struct BenchmarkTiming
+{
+	double BestMilliseconds = 0.0;
+	double MedianMilliseconds = 0.0;
+};
+
+// Best and median of Repetitions runs, after one untimed warm-up run
+template <typename Function>
+BenchmarkTiming MeasureBenchmark(uint32_t Repetitions, Function&& Run)
+{
+	Run();
+	std::vector<double> Milliseconds;
+	for (uint32_t Repetition = 0; Repetition < std::max(Repetitions, 1u); Repetition++)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Run();
+		Milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count());
+	}
+	std::sort(Milliseconds.begin(), Milliseconds.end());
+
+	BenchmarkTiming Timing;
+	Timing.BestMilliseconds = Milliseconds.front();
+	Timing.MedianMilliseconds = Milliseconds[Milliseconds.size() / 2];
+	return Timing;
+}
+
+// Nearest rank percentile of unsorted samples
+double GetPercentile(std::vector<double> Samples, double Percentile);
+
+// Items per second in millions, from a count and milliseconds
+double GetMillionsPerSecond(double Count, double Milliseconds);
@@ -0,0 +1,86 @@
+#include "BenchmarkFramework.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "ProceduralTexture.h"
+
+#include <cstdio>
+#include <string>
+
+static const char* GetInstructionSetName(InstructionSet Set)
+{
+	switch (Set)
+	{
+	case InstructionSet::Scalar: return "scalar";
+	case InstructionSet::Sse2: return "sse2";
+	case InstructionSet::Sse41: return "sse4.1";
+	default: return "avx2";
+	}
+}
+
+static const char* GetFormatName(TextureFormat Format)
+{
+	switch (Format)
+	{
+	case TextureFormat::Bc1: return "bc1";
+	case TextureFormat::Bc3: return "bc3";
+	default: return "bc7";
+	}
+}
+
+// BC1, BC3 and BC7 throughput over a noise texture on every supported instruction set, single threaded and on the
+// job system. Every configuration must write the same blocks as the scalar encoder.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t Size = Quick ? 256 : 2048;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+	const InstructionSet BestSet = GetBestInstructionSet();
+
+	TextureLevelLayout PixelLayout;
+	PixelLayout.Width = Size;
+	PixelLayout.Height = Size;
+	PixelLayout.RowPitch = 4 * Size;
+	std::vector<uint8_t> Pixels(static_cast<size_t>(PixelLayout.RowPitch) * Size);
+	ProceduralTextureDescription Description;
+	Description.Pattern = ProceduralPattern::Noise;
+	Description.Width = Size;
+	Description.Height = Size;
+	GenerateProceduralTexture(Description, Pixels.data(), PixelLayout.RowPitch);
+
+	JobSystem Jobs;
+	const double TexelCount = static_cast<double>(Size) * Size;
+	printf("%ux%u noise, best instruction set %s, %u threads\n", Size, Size, GetInstructionSetName(BestSet), Jobs.GetThreadCount());
+	printf("%6s %-14s %10s %12s %10s\n", "format", "encoder", "best ms", "Mtexels/s", "speedup");
+
+	for (TextureFormat Format : { TextureFormat::Bc1, TextureFormat::Bc3, TextureFormat::Bc7 })
+	{
+		TextureLevelLayout BlockLayout;
+		const uint64_t BlockBytes = GetTextureLevelLayouts(Format, Size, Size, 1, 256, 512, &BlockLayout);
+		std::vector<uint8_t> Reference(BlockBytes);
+		std::vector<uint8_t> Blocks(BlockBytes);
+
+		BlockCompressionOptions Options;
+		Options.MaximumInstructionSet = InstructionSet::Scalar;
+		CompressTexture(Format, Pixels.data(), &PixelLayout, Reference.data(), &BlockLayout, 1, Options);
+
+		double ScalarMilliseconds = 0.0;
+		for (uint32_t Set = 0; Set <= static_cast<uint32_t>(BestSet); Set++)
+		{
+			Options.MaximumInstructionSet = static_cast<InstructionSet>(Set);
+			if (ResolveInstructionSet(Options.MaximumInstructionSet) != Options.MaximumInstructionSet) continue;
+
+			for (JobSystem* Workers : { static_cast<JobSystem*>(nullptr), &Jobs })
+			{
+				std::fill(Blocks.begin(), Blocks.end(), 0);
+				const BenchmarkTiming Timing = MeasureBenchmark(Repetitions, [&] { CompressTexture(Format, Pixels.data(), &PixelLayout, Blocks.data(), &BlockLayout, 1, Options, Workers); });
+				if (ScalarMilliseconds == 0.0) ScalarMilliseconds = Timing.BestMilliseconds;
+
+				const std::string Name = std::string(GetInstructionSetName(Options.MaximumInstructionSet)) + (Workers ? " jobs" : "");
+				printf("%6s %-14s %10.3f %12.1f %10.2f\n", GetFormatName(Format), Name.c_str(), Timing.BestMilliseconds, GetMillionsPerSecond(TexelCount, Timing.BestMilliseconds),
+					ScalarMilliseconds / Timing.BestMilliseconds);
+				BenchmarkExpect(Blocks == Reference, "every encoder configuration writes the scalar encoder's blocks");
+			}
+		}
+	}
+	return GetBenchmarkExitCode();
+}
@@ -0,0 +1,81 @@
+#include "BenchmarkFramework.h"
+#include "HeadlessRenderDevice.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+// Like the application's draw loop, one call per draw. The draw index goes into StartInstanceLocation so the
+// recorded streams can be checked for order afterwards.
+static void RecordDraws(RenderCommandList& CommandList, uint32_t BeginDraw, uint32_t EndDraw)
+{
+	for (uint32_t DrawIndex = BeginDraw; DrawIndex < EndDraw; DrawIndex++)
+	{
+		CommandList.DrawIndexedInstanced(3, 1, 0, 0, DrawIndex);
+	}
+}
+
+// Every draw recorded exactly once, in draw order across the lists as they are submitted
+static bool AreDrawsInOrder(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists, uint32_t DrawCount)
+{
+	uint32_t NextDraw = 0;
+	for (uint32_t ListIndex = 0; ListIndex < NumberOfCommandLists; ListIndex++)
+	{
+		const HeadlessCommandList& CommandList = static_cast<const HeadlessCommandList&>(*CommandLists[ListIndex]);
+		if (!CommandList.IsClosed()) return false;
+		for (const HeadlessCommand& Command : CommandList.GetCommands())
+		{
+			if (Command.StartInstanceLocation != NextDraw++) return false;
+		}
+	}
+	return NextDraw == DrawCount;
+}
+
+// Recording time for DrawCount draws against one to N threads, where N is at least two even on a single core.
+// One thread records serially into a single list without the job system, which is the baseline the speedups are
+// relative to; more threads record through ParallelCommandRecorder with one list per thread.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t DrawCount = Quick ? 20000 : 200000;
+	const uint32_t Repetitions = Quick ? 3 : 20;
+	const uint32_t MaximumThreads = std::max(std::thread::hardware_concurrency(), 2u);
+
+	RenderDeviceDescription Description;
+	Description.Width = 64;
+	Description.Height = 64;
+	HeadlessRenderDevice Device;
+	Device.Initialize(Description);
+
+	std::unique_ptr<RenderCommandList> SerialCommandList = Device.CreateCommandList();
+	const BenchmarkTiming Serial = MeasureBenchmark(Repetitions, [&]
+	{
+		SerialCommandList->Reset();
+		RecordDraws(*SerialCommandList, 0, DrawCount);
+		SerialCommandList->Close();
+	});
+	RenderCommandList* const SerialCommandLists[] = { SerialCommandList.get() };
+	BenchmarkExpect(AreDrawsInOrder(SerialCommandLists, 1, DrawCount), "serial recording keeps every draw in order");
+
+	printf("%u draws, %u hardware threads\n", DrawCount, std::thread::hardware_concurrency());
+	printf("%8s %10s %10s %10s %10s\n", "threads", "best ms", "median ms", "Mdraws/s", "speedup");
+	printf("%8u %10.3f %10.3f %10.2f %10.2f\n", 1u, Serial.BestMilliseconds, Serial.MedianMilliseconds, GetMillionsPerSecond(DrawCount, Serial.BestMilliseconds), 1.0);
+
+	for (uint32_t ThreadCount = 2; ThreadCount <= MaximumThreads; ThreadCount++)
+	{
+		JobSystem Jobs(ThreadCount - 1);
+		ParallelCommandRecorder Recorder(Device, Jobs);
+		const BenchmarkTiming Parallel = MeasureBenchmark(Repetitions, [&]
+		{
+			Recorder.Record(DrawCount, RecordDraws);
+		});
+		printf("%8u %10.3f %10.3f %10.2f %10.2f\n", ThreadCount, Parallel.BestMilliseconds, Parallel.MedianMilliseconds, GetMillionsPerSecond(DrawCount, Parallel.BestMilliseconds),
+			Serial.BestMilliseconds / Parallel.BestMilliseconds);
+
+		BenchmarkExpect(Recorder.GetCommandListCount() == ThreadCount, "one command list per thread");
+		BenchmarkExpect(AreDrawsInOrder(Recorder.GetCommandLists(), Recorder.GetCommandListCount(), DrawCount), "parallel recording keeps every draw in order");
+	}
+	return GetBenchmarkExitCode();
+}
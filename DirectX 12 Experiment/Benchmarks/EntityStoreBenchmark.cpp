@@ -0,0 +1,151 @@
+#include "BenchmarkFramework.h"
+#include "EntityStore.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+struct Position
+{
+	float X, Y, Z;
+};
+
+struct Velocity
+{
+	float X, Y, Z;
+};
+
+struct Health
+{
+	uint32_t Value;
+};
+
+// The object layout the store replaces: both components inside a larger scene object
+struct SceneObject
+{
+	Position Location;
+	Velocity Motion;
+	uint64_t OtherFields[4];
+};
+
+static const float TimeStep = 1.0f / 64.0f;
+
+static void Integrate(uint32_t Count, const EntityStore::Entity*, Position* Positions, Velocity* Velocities)
+{
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		Positions[Index].X += Velocities[Index].X * TimeStep;
+		Positions[Index].Y += Velocities[Index].Y * TimeStep;
+		Positions[Index].Z += Velocities[Index].Z * TimeStep;
+	}
+}
+
+static double GetMillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+// Creation, memory footprint, iteration over two components (serial, on the job system, and over an array of
+// objects for reference), add/remove churn that moves entities between archetypes, and destroy/create churn,
+// all at 1M entities
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t EntityCount = Quick ? 100000 : 1000000;
+	const uint32_t ChurnCount = Quick ? 20000 : 200000;
+	const uint32_t Repetitions = Quick ? 3 : 20;
+
+	JobSystem Jobs;
+	EntityStore Store;
+	std::vector<EntityStore::Entity> Entities(EntityCount);
+	const auto CreateStart = std::chrono::steady_clock::now();
+	for (uint32_t Index = 0; Index < EntityCount; Index++)
+	{
+		Entities[Index] = Store.Create<Position, Velocity>();
+		*Store.Get<Velocity>(Entities[Index]) = { 1.0f, 2.0f, 3.0f };
+	}
+	const double CreateMilliseconds = GetMillisecondsSince(CreateStart);
+
+	const EntityStoreStatistics Statistics = Store.GetStatistics();
+	const double PayloadBytes = sizeof(Position) + sizeof(Velocity);
+	printf("%u entities with Position and Velocity, %u threads\n", EntityCount, Jobs.GetThreadCount());
+	printf("create: %.2f ms, %.1f ns per entity\n", CreateMilliseconds, CreateMilliseconds * 1e6 / EntityCount);
+	printf("footprint: %u chunks, %.1f MiB chunks + %.1f MiB bookkeeping, %.1f bytes per entity for %.0f bytes of components\n", Statistics.ChunkCount,
+		Statistics.ChunkBytes / 1048576.0, Statistics.BookkeepingBytes / 1048576.0, static_cast<double>(Statistics.ChunkBytes + Statistics.BookkeepingBytes) / EntityCount, PayloadBytes);
+	BenchmarkExpect(Statistics.EntityCount == EntityCount && Statistics.ArchetypeCount == 1, "every entity lands in one archetype");
+
+	// The handle, both components, and the record, with room for partly filled chunks
+	BenchmarkExpect(static_cast<double>(Statistics.ChunkBytes + Statistics.BookkeepingBytes) / EntityCount < 2.0 * (PayloadBytes + sizeof(EntityStore::Entity) + 16), "the footprint stays near the component payload");
+
+	printf("%-24s %10s %10s %14s\n", "iteration", "best ms", "median ms", "Mentities/s");
+	auto ReportIteration = [EntityCount](const char* Name, const BenchmarkTiming& Timing)
+	{
+		printf("%-24s %10.3f %10.3f %14.1f\n", Name, Timing.BestMilliseconds, Timing.MedianMilliseconds, GetMillionsPerSecond(EntityCount, Timing.BestMilliseconds));
+	};
+	ReportIteration("chunks", MeasureBenchmark(Repetitions, [&] { Store.ForEachChunk<Position, Velocity>(Integrate); }));
+	ReportIteration("chunks jobs", MeasureBenchmark(Repetitions, [&] { Store.ParallelForEachChunk<Position, Velocity>(Jobs, Integrate); }));
+
+	// Each pass moves X by one step, so after both runs every entity moved the same number of times
+	const float ExpectedX = static_cast<float>(2 * (Repetitions + 1)) * TimeStep;
+	std::atomic<uint32_t> MovedEntities{ 0 };
+	Store.ParallelForEachChunk<Position>(Jobs, [&](uint32_t Count, const EntityStore::Entity*, Position* Positions)
+	{
+		uint32_t Moved = 0;
+		for (uint32_t Index = 0; Index < Count; Index++)
+		{
+			Moved += Positions[Index].X == ExpectedX ? 1 : 0;
+		}
+		MovedEntities += Moved;
+	});
+	BenchmarkExpect(MovedEntities == EntityCount, "every entity was visited once per pass");
+
+	std::vector<SceneObject> Objects(EntityCount);
+	for (SceneObject& Object : Objects)
+	{
+		Object.Motion = { 1.0f, 2.0f, 3.0f };
+	}
+	ReportIteration("array of objects", MeasureBenchmark(Repetitions, [&]
+	{
+		for (SceneObject& Object : Objects)
+		{
+			Integrate(1, nullptr, &Object.Location, &Object.Motion);
+		}
+	}));
+
+	std::mt19937 Random(1);
+	const auto AddRemoveStart = std::chrono::steady_clock::now();
+	for (uint32_t Change = 0; Change < ChurnCount; Change++)
+	{
+		const EntityStore::Entity Target = Entities[Random() % EntityCount];
+		if (Store.Get<Health>(Target) != nullptr)
+		{
+			Store.Remove<Health>(Target);
+		}
+		else
+		{
+			Store.Add(Target, Health{ 100 });
+		}
+	}
+	const double AddRemoveMilliseconds = GetMillisecondsSince(AddRemoveStart);
+
+	const auto RecreateStart = std::chrono::steady_clock::now();
+	for (uint32_t Change = 0; Change < ChurnCount; Change++)
+	{
+		EntityStore::Entity& Target = Entities[Random() % EntityCount];
+		Store.Destroy(Target);
+		Target = Store.Create<Position, Velocity>();
+	}
+	const double RecreateMilliseconds = GetMillisecondsSince(RecreateStart);
+
+	const EntityStoreStatistics Churned = Store.GetStatistics();
+	printf("add/remove churn: %.1f ns per change\n", AddRemoveMilliseconds * 1e6 / ChurnCount);
+	printf("destroy/create churn: %.1f ns per pair\n", RecreateMilliseconds * 1e6 / ChurnCount);
+	printf("after churn: %u archetypes, %u chunks, %u pooled, %.1f bytes per entity\n", Churned.ArchetypeCount, Churned.ChunkCount, Churned.PooledChunkCount,
+		static_cast<double>(Churned.ChunkBytes + Churned.BookkeepingBytes) / EntityCount);
+	BenchmarkExpect(Churned.EntityCount == EntityCount && Churned.ArchetypeCount == 2, "churn keeps the entity count and the two archetypes");
+	BenchmarkExpect(Store.IsAlive(Entities.front()) && Store.IsAlive(Entities.back()), "handles stay valid through churn");
+
+	// Rows freed by churn are reused, so the chunk count only grows by what one archetype leaves partly filled
+	BenchmarkExpect(Churned.ChunkCount <= Statistics.ChunkCount + Statistics.ChunkCount / 2 + 2, "churn does not leak chunks");
+	return GetBenchmarkExitCode();
+}
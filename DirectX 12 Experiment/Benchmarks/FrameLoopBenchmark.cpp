@@ -0,0 +1,173 @@
+#include "BenchmarkFramework.h"
+#include "HeadlessRenderDevice.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+// Every heap allocation of the process is counted, so a frame's allocations are the difference across it
+static std::atomic<uint64_t> AllocationCount(0);
+
+void* operator new(size_t Size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* Memory = std::malloc(Size != 0 ? Size : 1);
+	if (Memory == nullptr) throw std::bad_alloc();
+	return Memory;
+}
+
+void operator delete(void* Memory) noexcept
+{
+	std::free(Memory);
+}
+
+void operator delete(void* Memory, size_t) noexcept
+{
+	std::free(Memory);
+}
+
+static const float ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+static const uint32_t MeshCount = 2;
+static const uint32_t FrameSize = 256;
+
+// A triangle and a quad, small enough that rasterization does not hide the CPU work around it
+static void CreateScene(HeadlessRenderDevice& Device, MeshRange Meshes[MeshCount])
+{
+	const Vertex Vertices[] =
+	{
+		{ {  0.0f,   0.02f, 0.0f }, { 0.5f, 1.0f } },
+		{ {  0.02f, -0.02f, 0.0f }, { 1.0f, 0.0f } },
+		{ { -0.02f, -0.02f, 0.0f }, { 0.0f, 0.0f } },
+		{ { -0.02f,  0.02f, 0.0f }, { 0.0f, 1.0f } },
+		{ {  0.02f,  0.02f, 0.0f }, { 1.0f, 1.0f } },
+		{ {  0.02f, -0.02f, 0.0f }, { 1.0f, 0.0f } },
+		{ { -0.02f, -0.02f, 0.0f }, { 0.0f, 0.0f } }
+	};
+	const uint32_t Indices[] = { 0, 1, 2, 0, 1, 2, 0, 2, 3 };
+	Device.CreateGeometry(Vertices, 7, Indices, 9);
+
+	Meshes[0].StartIndex = 0;
+	Meshes[0].IndexCount = 3;
+	Meshes[0].BaseVertex = 0;
+	Meshes[1].StartIndex = 3;
+	Meshes[1].IndexCount = 6;
+	Meshes[1].BaseVertex = 3;
+
+	const uint8_t Texels[] = { 255, 255, 255, 255 };
+	TextureDescription Texture;
+	Texture.Width = 1;
+	Texture.Height = 1;
+	Device.CreateTexture(Texture, Texels);
+	Device.FinishUploads();
+}
+
+static InstanceList CreateInstances(uint32_t Count)
+{
+	std::mt19937 Random(Count);
+	std::uniform_real_distribution<float> Position(-0.9f, 0.9f);
+	InstanceList Instances;
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		Instances.MeshIds.push_back(Index % MeshCount);
+		Instances.MaterialIds.push_back(Index % 4);
+		Instances.Transforms.push_back({ { { 1.0f, 0.0f, 0.0f, Position(Random) }, { 0.0f, 1.0f, 0.0f, Position(Random) }, { 0.0f, 0.0f, 1.0f, 0.0f } } });
+	}
+	return Instances;
+}
+
+struct FrameLoopResult
+{
+	std::vector<double> FrameMilliseconds;
+	std::vector<double> SubmissionMilliseconds;
+	double AllocationsPerFrame = 0.0;
+	bool AllInstancesDrawn = true;
+};
+
+// The application's frame without a window: batch, upload, record in parallel, submit and present
+static FrameLoopResult RunFrameLoop(JobSystem& Jobs, uint32_t InstanceCount, uint32_t WarmUpFrames, uint32_t MeasuredFrames)
+{
+	RenderDeviceDescription Description;
+	Description.Width = FrameSize;
+	Description.Height = FrameSize;
+	Description.FrameCount = 3;
+	Description.Pacing.Mode = PresentMode::Uncapped;
+	Description.Jobs = &Jobs;
+	HeadlessRenderDevice Device;
+	Device.Initialize(Description);
+
+	MeshRange Meshes[MeshCount];
+	CreateScene(Device, Meshes);
+	const InstanceList Instances = CreateInstances(InstanceCount);
+
+	std::unique_ptr<RenderCommandList> ClearCommandList = Device.CreateCommandList();
+	ParallelCommandRecorder Recorder(Device, Jobs);
+	InstanceBatchBuffer Batches;
+	std::vector<RenderCommandList*> CommandLists;
+
+	FrameLoopResult Result;
+	uint64_t AllocationsBefore = 0;
+	for (uint32_t Frame = 0; Frame < WarmUpFrames + MeasuredFrames; Frame++)
+	{
+		if (Frame == WarmUpFrames)
+		{
+			AllocationsBefore = AllocationCount.load(std::memory_order_relaxed);
+		}
+		const uint64_t DrawnBefore = Device.GetStatistics().DrawnInstances;
+		const auto FrameStart = std::chrono::steady_clock::now();
+
+		Device.BeginFrame();
+		ClearCommandList->Reset();
+		ClearCommandList->ClearRenderTarget(ClearColor);
+		ClearCommandList->Close();
+
+		BuildInstanceBatches(Instances, Meshes, MeshCount, Batches, &Jobs);
+		Device.UploadInstances(Batches);
+		Recorder.Record(static_cast<uint32_t>(Batches.Draws.size()), [&Batches](RenderCommandList& CommandList, uint32_t BeginDraw, uint32_t EndDraw)
+		{
+			CommandList.DrawInstancedBatches(&Batches.Draws[BeginDraw], EndDraw - BeginDraw);
+		});
+
+		CommandLists.clear();
+		CommandLists.push_back(ClearCommandList.get());
+		CommandLists.insert(CommandLists.end(), Recorder.GetCommandLists(), Recorder.GetCommandLists() + Recorder.GetCommandListCount());
+		const auto SubmissionStart = std::chrono::steady_clock::now();
+		Device.ExecuteCommandLists(CommandLists.data(), static_cast<uint32_t>(CommandLists.size()));
+		const auto SubmissionEnd = std::chrono::steady_clock::now();
+		Device.Present();
+
+		if (Frame >= WarmUpFrames)
+		{
+			Result.FrameMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count());
+			Result.SubmissionMilliseconds.push_back(std::chrono::duration<double, std::milli>(SubmissionEnd - SubmissionStart).count());
+		}
+		Result.AllInstancesDrawn &= Device.GetStatistics().DrawnInstances - DrawnBefore == InstanceCount;
+	}
+	Result.AllocationsPerFrame = static_cast<double>(AllocationCount.load(std::memory_order_relaxed) - AllocationsBefore) / MeasuredFrames;
+	return Result;
+}
+
+// Frame time percentiles, heap allocations per steady-state frame and the time spent in ExecuteCommandLists,
+// which on the headless device includes rasterizing the frame
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const std::vector<uint32_t> InstanceCounts = Quick ? std::vector<uint32_t>{ 100, 2000 } : std::vector<uint32_t>{ 1000, 10000, 100000 };
+	const uint32_t MeasuredFrames = Quick ? 20 : 200;
+
+	JobSystem Jobs;
+	printf("%u threads, %ux%u frames\n", Jobs.GetThreadCount(), FrameSize, FrameSize);
+	printf("%10s %10s %10s %10s %12s %14s\n", "instances", "p50 ms", "p99 ms", "max ms", "submit ms", "allocs/frame");
+	for (uint32_t InstanceCount : InstanceCounts)
+	{
+		const FrameLoopResult Result = RunFrameLoop(Jobs, InstanceCount, 10, MeasuredFrames);
+		printf("%10u %10.3f %10.3f %10.3f %12.3f %14.1f\n", InstanceCount, GetPercentile(Result.FrameMilliseconds, 50.0), GetPercentile(Result.FrameMilliseconds, 99.0),
+			GetPercentile(Result.FrameMilliseconds, 100.0), GetPercentile(Result.SubmissionMilliseconds, 50.0), Result.AllocationsPerFrame);
+		BenchmarkExpect(Result.AllInstancesDrawn, "every frame draws every instance");
+	}
+	return GetBenchmarkExitCode();
+}
@@ -0,0 +1,127 @@
+#include "BenchmarkFramework.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static const uint32_t MeshCount = 16;
+
+static InstanceList CreateInstances(uint32_t InstanceCount)
+{
+	InstanceList Instances;
+	Instances.MeshIds.resize(InstanceCount);
+	Instances.MaterialIds.resize(InstanceCount);
+	Instances.Transforms.resize(InstanceCount);
+
+	std::mt19937 Random(InstanceCount);
+	std::uniform_real_distribution<float> Position(-100.0f, 100.0f);
+	for (uint32_t Instance = 0; Instance < InstanceCount; Instance++)
+	{
+		Instances.MeshIds[Instance] = Random() % MeshCount;
+		Instances.MaterialIds[Instance] = Instance;
+		InstanceTransform& Transform = Instances.Transforms[Instance];
+		memset(&Transform, 0, sizeof(Transform));
+		Transform.Rows[0][0] = Transform.Rows[1][1] = Transform.Rows[2][2] = 1.0f;
+		Transform.Rows[0][3] = Position(Random);
+		Transform.Rows[1][3] = Position(Random);
+		Transform.Rows[2][3] = Position(Random);
+	}
+	return Instances;
+}
+
+// The path before batching: one draw of one instance per object, its transform copied next to the draw
+static void BuildDrawPerInstance(const InstanceList& Instances, const MeshRange* Meshes, std::vector<InstanceTransform>& Transforms, std::vector<InstancedDrawArguments>& Draws)
+{
+	const uint32_t InstanceCount = static_cast<uint32_t>(Instances.MeshIds.size());
+	Transforms.resize(InstanceCount);
+	Draws.resize(InstanceCount);
+	for (uint32_t Instance = 0; Instance < InstanceCount; Instance++)
+	{
+		const MeshRange& Mesh = Meshes[Instances.MeshIds[Instance]];
+		Transforms[Instance] = Instances.Transforms[Instance];
+		Draws[Instance] = { Instance, Mesh.IndexCount, 1, Mesh.StartIndex, Mesh.BaseVertex, Instance };
+	}
+}
+
+// Draws cover every instance once in mesh order, and each instance's material moved with its transform. Every mesh
+// has instances at these counts, so draw D belongs to mesh D; the material ID is the source instance index.
+static bool IsValidBatchBuffer(const InstanceList& Instances, const InstanceBatchBuffer& Batches)
+{
+	uint32_t NextInstance = 0;
+	for (uint32_t DrawIndex = 0; DrawIndex < Batches.Draws.size(); DrawIndex++)
+	{
+		const InstancedDrawArguments& Draw = Batches.Draws[DrawIndex];
+		if (Draw.FirstInstance != NextInstance || Draw.StartInstanceLocation != NextInstance) return false;
+		for (uint32_t Instance = Draw.FirstInstance; Instance < Draw.FirstInstance + Draw.InstanceCount; Instance++)
+		{
+			const uint32_t Source = Batches.MaterialIds[Instance];
+			if (Instances.MeshIds[Source] != DrawIndex) return false;
+			if (Batches.TransformRows[(static_cast<size_t>(Batches.InstanceCount) + Instance) * 4 + 3] != Instances.Transforms[Source].Rows[1][3]) return false;
+		}
+		NextInstance += Draw.InstanceCount;
+	}
+	return NextInstance == Instances.MeshIds.size() && Batches.Draws.size() == MeshCount;
+}
+
+// Building the instance buffer and the indirect argument buffer for 10k to 1M instances over 16 meshes, single
+// threaded and on the job system, against one draw per object. The upload copy is what
+// D3D12RenderDevice::UploadInstances does with the result each frame.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t LargestCount = Quick ? 100000 : 1000000;
+	const uint32_t Repetitions = Quick ? 3 : 15;
+
+	MeshRange Meshes[MeshCount];
+	for (uint32_t Mesh = 0; Mesh < MeshCount; Mesh++)
+	{
+		Meshes[Mesh].StartIndex = Mesh * 36;
+		Meshes[Mesh].IndexCount = 36;
+		Meshes[Mesh].BaseVertex = static_cast<int32_t>(Mesh * 24);
+	}
+
+	JobSystem Jobs;
+	printf("%u meshes, %u threads\n", MeshCount, Jobs.GetThreadCount());
+	printf("%9s %-18s %10s %10s %12s %8s\n", "instances", "build", "best ms", "median ms", "ns/instance", "draws");
+
+	for (uint32_t InstanceCount = 10000; InstanceCount <= LargestCount; InstanceCount *= 10)
+	{
+		const InstanceList Instances = CreateInstances(InstanceCount);
+		auto Report = [InstanceCount](const char* Name, const BenchmarkTiming& Timing, size_t DrawCount)
+		{
+			printf("%9u %-18s %10.3f %10.3f %12.2f %8zu\n", InstanceCount, Name, Timing.BestMilliseconds, Timing.MedianMilliseconds,
+				Timing.BestMilliseconds * 1e6 / InstanceCount, DrawCount);
+		};
+
+		std::vector<InstanceTransform> PerInstanceTransforms;
+		std::vector<InstancedDrawArguments> PerInstanceDraws;
+		const BenchmarkTiming PerInstance = MeasureBenchmark(Repetitions, [&] { BuildDrawPerInstance(Instances, Meshes, PerInstanceTransforms, PerInstanceDraws); });
+		Report("draw per instance", PerInstance, PerInstanceDraws.size());
+
+		InstanceBatchBuffer Batches;
+		const BenchmarkTiming Serial = MeasureBenchmark(Repetitions, [&] { BuildInstanceBatches(Instances, Meshes, MeshCount, Batches); });
+		Report("batches", Serial, Batches.Draws.size());
+		BenchmarkExpect(IsValidBatchBuffer(Instances, Batches), "batches cover every instance once");
+
+		InstanceBatchBuffer ParallelBatches;
+		const BenchmarkTiming Parallel = MeasureBenchmark(Repetitions, [&] { BuildInstanceBatches(Instances, Meshes, MeshCount, ParallelBatches, &Jobs); });
+		Report("batches jobs", Parallel, ParallelBatches.Draws.size());
+		BenchmarkExpect(ParallelBatches.TransformRows == Batches.TransformRows && ParallelBatches.MaterialIds == Batches.MaterialIds, "parallel batches match serial ones");
+		BenchmarkExpect(memcmp(ParallelBatches.Draws.data(), Batches.Draws.data(), Batches.Draws.size() * sizeof(InstancedDrawArguments)) == 0, "parallel arguments match serial ones");
+
+		const size_t TransformBytes = Batches.TransformRows.size() * sizeof(float);
+		const size_t MaterialBytes = Batches.MaterialIds.size() * sizeof(uint32_t);
+		const size_t ArgumentBytes = Batches.Draws.size() * sizeof(InstancedDrawArguments);
+		std::vector<uint8_t> UploadBuffer(TransformBytes + MaterialBytes + ArgumentBytes);
+		const BenchmarkTiming Upload = MeasureBenchmark(Repetitions, [&]
+		{
+			memcpy(UploadBuffer.data(), Batches.TransformRows.data(), TransformBytes);
+			memcpy(UploadBuffer.data() + TransformBytes, Batches.MaterialIds.data(), MaterialBytes);
+			memcpy(UploadBuffer.data() + TransformBytes + MaterialBytes, Batches.Draws.data(), ArgumentBytes);
+		});
+		Report("upload copy", Upload, Batches.Draws.size());
+	}
+	return GetBenchmarkExitCode();
+}
@@ -0,0 +1,70 @@
+#include "BenchmarkFramework.h"
+#include "JobSystem.h"
+
+#include <cstdio>
+#include <numeric>
+
+// Scheduling throughput with empty jobs, ParallelFor throughput over a summed array and the round trip of a
+// single job from Schedule to Wait returning
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t JobCount = Quick ? 10000 : 1000000;
+	const uint32_t ElementCount = Quick ? 1 << 16 : 1 << 24;
+	const uint32_t RoundTrips = Quick ? 1000 : 100000;
+	const uint32_t Repetitions = Quick ? 3 : 10;
+
+	JobSystem Jobs;
+	printf("%u threads\n", Jobs.GetThreadCount());
+
+	std::atomic<uint32_t> CompletedJobs(0);
+	const BenchmarkTiming Scheduling = MeasureBenchmark(Repetitions, [&]
+	{
+		JobCounter Counter;
+		for (uint32_t JobIndex = 0; JobIndex < JobCount; JobIndex++)
+		{
+			Jobs.Schedule([&CompletedJobs] { CompletedJobs.fetch_add(1, std::memory_order_relaxed); }, &Counter);
+		}
+		Jobs.Wait(Counter);
+	});
+	printf("schedule and run  %10.2f Mjobs/s (best %.3f ms, median %.3f ms for %u jobs)\n", GetMillionsPerSecond(JobCount, Scheduling.BestMilliseconds),
+		Scheduling.BestMilliseconds, Scheduling.MedianMilliseconds, JobCount);
+	BenchmarkExpect(CompletedJobs.load() == JobCount * (Repetitions + 1), "every scheduled job ran once");
+
+	std::vector<uint32_t> Elements(ElementCount);
+	std::iota(Elements.begin(), Elements.end(), 0u);
+	const uint64_t ExpectedSum = static_cast<uint64_t>(ElementCount) * (ElementCount - 1) / 2;
+	std::atomic<uint64_t> Sum(0);
+	const BenchmarkTiming ParallelSum = MeasureBenchmark(Repetitions, [&]
+	{
+		Sum = 0;
+		Jobs.ParallelFor(0, ElementCount, 0, [&](uint32_t Begin, uint32_t End)
+		{
+			uint64_t ChunkSum = 0;
+			for (uint32_t Index = Begin; Index < End; Index++)
+			{
+				ChunkSum += Elements[Index];
+			}
+			Sum.fetch_add(ChunkSum, std::memory_order_relaxed);
+		});
+	});
+	printf("parallel for sum  %10.2f Melements/s (best %.3f ms, median %.3f ms for %u elements)\n", GetMillionsPerSecond(ElementCount, ParallelSum.BestMilliseconds),
+		ParallelSum.BestMilliseconds, ParallelSum.MedianMilliseconds, ElementCount);
+	BenchmarkExpect(Sum.load() == ExpectedSum, "parallel for visits every element once");
+
+	// The owning thread usually runs the job itself while waiting, unless a worker steals it first
+	std::vector<double> RoundTripMicroseconds;
+	RoundTripMicroseconds.reserve(RoundTrips);
+	for (uint32_t RoundTrip = 0; RoundTrip < RoundTrips; RoundTrip++)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		JobCounter Counter;
+		Jobs.Schedule([] {}, &Counter);
+		Jobs.Wait(Counter);
+		RoundTripMicroseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count());
+	}
+	printf("job round trip    p50 %.2f us, p99 %.2f us, max %.2f us\n", GetPercentile(RoundTripMicroseconds, 50.0), GetPercentile(RoundTripMicroseconds, 99.0),
+		GetPercentile(RoundTripMicroseconds, 100.0));
+
+	return GetBenchmarkExitCode();
+}
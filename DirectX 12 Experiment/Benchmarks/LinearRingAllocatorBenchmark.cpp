@@ -0,0 +1,94 @@
+#include "BenchmarkFramework.h"
+#include "LinearRingAllocator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct AllocationRequest
+{
+	uint64_t Size;
+	uint64_t Alignment;
+};
+
+// Per-frame upload traffic: mostly constant buffers at the 256 byte placement alignment, some larger uploads
+static std::vector<AllocationRequest> CreateRequests(uint32_t Count)
+{
+	std::mt19937 Random(3);
+	std::vector<AllocationRequest> Requests(Count);
+	for (AllocationRequest& Request : Requests)
+	{
+		const bool Large = Random() % 16 == 0;
+		Request.Size = Large ? 4096 + Random() % 65536 : 16 + Random() % 512;
+		Request.Alignment = Large ? 512 : 256;
+	}
+	return Requests;
+}
+
+// Allocation throughput of the ring with three frames in flight, against malloc and free of the same requests
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t RequestsPerFrame = 1000;
+	const uint32_t FrameCount = Quick ? 50 : 5000;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+	const uint32_t FramesInFlight = 3;
+	const std::vector<AllocationRequest> Requests = CreateRequests(RequestsPerFrame);
+
+	uint64_t Checksum = 0;
+	uint64_t FailedAllocations = 0;
+	const BenchmarkTiming Ring = MeasureBenchmark(Repetitions, [&]
+	{
+		LinearRingAllocator Allocator(64 * 1024 * 1024);
+		for (uint64_t FenceValue = 1; FenceValue <= FrameCount; FenceValue++)
+		{
+			if (FenceValue > FramesInFlight)
+			{
+				Allocator.Retire(FenceValue - FramesInFlight);
+			}
+			for (const AllocationRequest& Request : Requests)
+			{
+				Checksum += Allocator.Allocate(Request.Size, Request.Alignment);
+			}
+			Allocator.FinishFrame(FenceValue);
+		}
+		FailedAllocations += Allocator.GetStatistics().FailedAllocationCount;
+	});
+
+	// Frees lag the same number of frames, so both hold the same amount of memory
+	std::vector<std::vector<void*>> FrameMemory(FramesInFlight);
+	const BenchmarkTiming Heap = MeasureBenchmark(Repetitions, [&]
+	{
+		for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+		{
+			std::vector<void*>& Memory = FrameMemory[Frame % FramesInFlight];
+			for (void* Allocation : Memory)
+			{
+				std::free(Allocation);
+			}
+			Memory.clear();
+			for (const AllocationRequest& Request : Requests)
+			{
+				Memory.push_back(std::malloc(Request.Size));
+				Checksum += reinterpret_cast<uintptr_t>(Memory.back()) & 0xFF;
+			}
+		}
+		for (std::vector<void*>& Memory : FrameMemory)
+		{
+			for (void* Allocation : Memory)
+			{
+				std::free(Allocation);
+			}
+			Memory.clear();
+		}
+	});
+
+	const double AllocationCount = static_cast<double>(RequestsPerFrame) * FrameCount;
+	printf("%u frames of %u allocations, %u frames in flight (checksum %llu)\n", FrameCount, RequestsPerFrame, FramesInFlight, static_cast<unsigned long long>(Checksum));
+	printf("ring         %10.2f Mallocs/s (best %.3f ms, median %.3f ms)\n", GetMillionsPerSecond(AllocationCount, Ring.BestMilliseconds), Ring.BestMilliseconds, Ring.MedianMilliseconds);
+	printf("malloc/free  %10.2f Mallocs/s (best %.3f ms, median %.3f ms)\n", GetMillionsPerSecond(AllocationCount, Heap.BestMilliseconds), Heap.BestMilliseconds, Heap.MedianMilliseconds);
+	BenchmarkExpect(FailedAllocations == 0, "a 64 MiB ring fits three frames of uploads");
+
+	return GetBenchmarkExitCode();
+}
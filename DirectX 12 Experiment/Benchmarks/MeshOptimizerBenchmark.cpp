@@ -0,0 +1,219 @@
+#include "BenchmarkFramework.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// The float layout the quantized one replaces: R32G32B32_FLOAT position and R32G32_FLOAT texture coordinates
+struct FloatVertex
+{
+	float Position[3];
+	float UV[2];
+};
+
+// Two interlocking tori of RingSegments by TubeSegments quads each, as an importer without an index buffer hands
+// them over: three vertices per triangle, triangles in random order
+static std::vector<FloatVertex> CreateTriangleSoup(uint32_t RingSegments, uint32_t TubeSegments)
+{
+	const float Pi = 3.14159265f;
+	std::vector<FloatVertex> Corners;
+	for (uint32_t Torus = 0; Torus < 2; Torus++)
+	{
+		auto GetVertex = [&](uint32_t Ring, uint32_t Tube)
+		{
+			const float U = 2.0f * Pi * static_cast<float>(Ring % RingSegments) / static_cast<float>(RingSegments);
+			const float V = 2.0f * Pi * static_cast<float>(Tube % TubeSegments) / static_cast<float>(TubeSegments);
+			const float Radius = 1.5f + 0.5f * std::cos(V);
+			const float Around[2] = { Radius * std::cos(U), Radius * std::sin(U) };
+
+			// The second torus stands upright through the first one's hole
+			FloatVertex Vertex;
+			Vertex.Position[0] = Around[0] + (Torus == 0 ? -1.0f : 1.0f);
+			Vertex.Position[1] = Torus == 0 ? Around[1] : 0.5f * std::sin(V);
+			Vertex.Position[2] = Torus == 0 ? 0.5f * std::sin(V) : Around[1];
+			Vertex.UV[0] = static_cast<float>(Ring % RingSegments) / static_cast<float>(RingSegments);
+			Vertex.UV[1] = static_cast<float>(Tube % TubeSegments) / static_cast<float>(TubeSegments);
+			return Vertex;
+		};
+
+		for (uint32_t Ring = 0; Ring < RingSegments; Ring++)
+		{
+			for (uint32_t Tube = 0; Tube < TubeSegments; Tube++)
+			{
+				const FloatVertex Quad[4] = { GetVertex(Ring, Tube), GetVertex(Ring + 1, Tube), GetVertex(Ring + 1, Tube + 1), GetVertex(Ring, Tube + 1) };
+				Corners.insert(Corners.end(), { Quad[0], Quad[1], Quad[2], Quad[0], Quad[2], Quad[3] });
+			}
+		}
+	}
+
+	std::mt19937 Random(3);
+	const size_t TriangleCount = Corners.size() / 3;
+	for (size_t Triangle = TriangleCount - 1; Triangle > 0; Triangle--)
+	{
+		const size_t Other = Random() % (Triangle + 1);
+		std::swap_ranges(Corners.begin() + Triangle * 3, Corners.begin() + Triangle * 3 + 3, Corners.begin() + Other * 3);
+	}
+	return Corners;
+}
+
+// Every triangle still references the same three vertices in the same winding, whatever the order
+static bool HasSameTriangles(const std::vector<uint32_t>& Indices, const std::vector<FloatVertex>& Vertices, const std::vector<FloatVertex>& Corners)
+{
+	std::vector<uint64_t> Expected;
+	std::vector<uint64_t> Actual;
+	auto HashTriangle = [](const FloatVertex& First, const FloatVertex& Second, const FloatVertex& Third)
+	{
+		// Rotated so the smallest corner leads, which keeps the winding
+		const FloatVertex* Triangle[3] = { &First, &Second, &Third };
+		uint32_t Lead = 0;
+		for (uint32_t Corner = 1; Corner < 3; Corner++)
+		{
+			if (memcmp(Triangle[Corner], Triangle[Lead], sizeof(FloatVertex)) < 0) Lead = Corner;
+		}
+		uint64_t Hash = 14695981039346656037ull;
+		for (uint32_t Corner = 0; Corner < 3; Corner++)
+		{
+			const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(Triangle[(Lead + Corner) % 3]);
+			for (size_t Byte = 0; Byte < sizeof(FloatVertex); Byte++)
+			{
+				Hash = (Hash ^ Bytes[Byte]) * 1099511628211ull;
+			}
+		}
+		return Hash;
+	};
+	for (size_t Index = 0; Index < Corners.size(); Index += 3)
+	{
+		Expected.push_back(HashTriangle(Corners[Index], Corners[Index + 1], Corners[Index + 2]));
+		Actual.push_back(HashTriangle(Vertices[Indices[Index]], Vertices[Indices[Index + 1]], Vertices[Indices[Index + 2]]));
+	}
+	std::sort(Expected.begin(), Expected.end());
+	std::sort(Actual.begin(), Actual.end());
+	return Expected == Actual;
+}
+
+// Throughput of each optimization stage on an imported mesh and the cache, fetch and memory figures it improves,
+// then the bytes per vertex and per triangle of the float, indexed and quantized layouts. Stages that work in
+// place start each run from a copy of their input, which is included in the time but small next to the stage.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t RingSegments = Quick ? 96 : 384;
+	const uint32_t TubeSegments = Quick ? 48 : 192;
+	const uint32_t Repetitions = Quick ? 3 : 10;
+
+	const std::vector<FloatVertex> Corners = CreateTriangleSoup(RingSegments, TubeSegments);
+	const size_t IndexCount = Corners.size();
+	const size_t TriangleCount = IndexCount / 3;
+	printf("%zu triangles, %zu unindexed vertices\n", TriangleCount, IndexCount);
+	printf("%-22s %10s %10s %12s\n", "stage", "best ms", "median ms", "M/s");
+	auto Report = [](const char* Name, const BenchmarkTiming& Timing, size_t Count, const char* Unit)
+	{
+		printf("%-22s %10.3f %10.3f %12.2f %s\n", Name, Timing.BestMilliseconds, Timing.MedianMilliseconds, GetMillionsPerSecond(static_cast<double>(Count), Timing.BestMilliseconds), Unit);
+	};
+
+	std::vector<uint32_t> Indices(IndexCount);
+	std::vector<FloatVertex> Vertices(IndexCount);
+	uint32_t VertexCount = 0;
+	Report("generate index buffer", MeasureBenchmark(Repetitions, [&] { VertexCount = GenerateIndexBuffer(Corners.data(), IndexCount, sizeof(FloatVertex), Indices.data(), Vertices.data()); }), TriangleCount, "triangles");
+	Vertices.resize(VertexCount);
+	BenchmarkExpect(VertexCount == 2 * RingSegments * TubeSegments, "welding finds every shared vertex");
+
+	const VertexCacheStatistics InputCache = AnalyzeVertexCache(Indices.data(), IndexCount, VertexCount);
+	const VertexFetchStatistics InputFetch = AnalyzeVertexFetch(Indices.data(), IndexCount, VertexCount, sizeof(FloatVertex));
+
+	std::vector<uint32_t> Work;
+	const std::vector<uint32_t> Welded = Indices;
+	Report("vertex cache", MeasureBenchmark(Repetitions, [&]
+	{
+		Work = Welded;
+		OptimizeVertexCache(Work.data(), IndexCount, VertexCount);
+	}), TriangleCount, "triangles");
+	Indices = Work;
+	const VertexCacheStatistics CacheOrder = AnalyzeVertexCache(Indices.data(), IndexCount, VertexCount);
+
+	const std::vector<uint32_t> CacheOptimized = Indices;
+	Report("overdraw", MeasureBenchmark(Repetitions, [&]
+	{
+		Work = CacheOptimized;
+		OptimizeOverdraw(Work.data(), IndexCount, Vertices[0].Position, VertexCount, sizeof(FloatVertex));
+	}), TriangleCount, "triangles");
+	Indices = Work;
+	const VertexCacheStatistics OverdrawOrder = AnalyzeVertexCache(Indices.data(), IndexCount, VertexCount);
+	const VertexFetchStatistics OverdrawFetch = AnalyzeVertexFetch(Indices.data(), IndexCount, VertexCount, sizeof(FloatVertex));
+
+	const std::vector<FloatVertex> Unfetched = Vertices;
+	const std::vector<uint32_t> OverdrawOptimized = Indices;
+	std::vector<FloatVertex> FetchVertices;
+	size_t KeptCount = 0;
+	Report("vertex fetch", MeasureBenchmark(Repetitions, [&]
+	{
+		FetchVertices = Unfetched;
+		Work = OverdrawOptimized;
+		KeptCount = OptimizeVertexFetch(FetchVertices.data(), Work.data(), IndexCount, VertexCount, sizeof(FloatVertex));
+	}), TriangleCount, "triangles");
+	Indices = Work;
+	Vertices = FetchVertices;
+	const VertexFetchStatistics FetchOrder = AnalyzeVertexFetch(Indices.data(), IndexCount, VertexCount, sizeof(FloatVertex));
+
+	std::vector<QuantizedVertex> Quantized(VertexCount);
+	Report("quantize", MeasureBenchmark(Repetitions, [&]
+	{
+		for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++)
+		{
+			Quantized[Vertex] = QuantizeVertex(Vertices[Vertex].Position, Vertices[Vertex].UV);
+		}
+	}), VertexCount, "vertices");
+
+	// Random unit normals; only the encoding is timed
+	std::vector<float> Normals(static_cast<size_t>(VertexCount) * 3);
+	std::mt19937 Random(5);
+	std::normal_distribution<float> Direction;
+	for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++)
+	{
+		float* Normal = &Normals[static_cast<size_t>(Vertex) * 3];
+		Normal[0] = Direction(Random);
+		Normal[1] = Direction(Random);
+		Normal[2] = Direction(Random);
+		const float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			Normal[Axis] /= Length;
+		}
+	}
+	std::vector<int8_t> EncodedNormals(static_cast<size_t>(VertexCount) * 2);
+	Report("octahedral normals", MeasureBenchmark(Repetitions, [&]
+	{
+		for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++)
+		{
+			EncodeOctahedralNormal(&Normals[static_cast<size_t>(Vertex) * 3], &EncodedNormals[static_cast<size_t>(Vertex) * 2]);
+		}
+	}), VertexCount, "vertices");
+
+	printf("\n%-22s %8s %8s %10s %14s\n", "order", "ACMR", "ATVR", "overfetch", "bytes fetched");
+	printf("%-22s %8.3f %8.3f %10.2f %14llu\n", "imported", InputCache.AverageCacheMissRatio, InputCache.AverageTransformedVertexRatio, InputFetch.Overfetch, static_cast<unsigned long long>(InputFetch.BytesFetched));
+	printf("%-22s %8.3f %8.3f %10s %14s\n", "vertex cache", CacheOrder.AverageCacheMissRatio, CacheOrder.AverageTransformedVertexRatio, "-", "-");
+	printf("%-22s %8.3f %8.3f %10.2f %14llu\n", "overdraw", OverdrawOrder.AverageCacheMissRatio, OverdrawOrder.AverageTransformedVertexRatio, OverdrawFetch.Overfetch, static_cast<unsigned long long>(OverdrawFetch.BytesFetched));
+	printf("%-22s %8.3f %8.3f %10.2f %14llu\n", "vertex fetch", OverdrawOrder.AverageCacheMissRatio, OverdrawOrder.AverageTransformedVertexRatio, FetchOrder.Overfetch, static_cast<unsigned long long>(FetchOrder.BytesFetched));
+
+	BenchmarkExpect(CacheOrder.AverageCacheMissRatio < 0.5f * InputCache.AverageCacheMissRatio, "cache optimization at least halves the transformed vertices");
+	BenchmarkExpect(OverdrawOrder.AverageCacheMissRatio <= CacheOrder.AverageCacheMissRatio * 1.05f + 1e-6f, "overdraw ordering stays within its cache threshold");
+	BenchmarkExpect(KeptCount == VertexCount && FetchOrder.Overfetch <= OverdrawFetch.Overfetch, "fetch ordering keeps every vertex and fetches no more");
+	BenchmarkExpect(HasSameTriangles(Indices, Vertices, Corners), "the optimized mesh draws the imported triangles");
+
+	// What a frame reads for this mesh in each layout, indices included
+	const bool ShortIndices = VertexCount <= 65536;
+	const double IndexSize = ShortIndices ? 2.0 : 4.0;
+	const double SoupBytes = static_cast<double>(IndexCount) * sizeof(FloatVertex);
+	const double IndexedBytes = static_cast<double>(VertexCount) * sizeof(FloatVertex) + IndexCount * IndexSize;
+	const double QuantizedBytes = static_cast<double>(VertexCount) * sizeof(QuantizedVertex) + IndexCount * IndexSize;
+	printf("\n%-22s %10s %12s %12s\n", "layout", "vertex B", "mesh MiB", "B/triangle");
+	printf("%-22s %10zu %12.2f %12.1f\n", "float, unindexed", sizeof(FloatVertex), SoupBytes / 1048576.0, SoupBytes / TriangleCount);
+	printf("%-22s %10zu %12.2f %12.1f\n", ShortIndices ? "float, 16 bit indices" : "float, 32 bit indices", sizeof(FloatVertex), IndexedBytes / 1048576.0, IndexedBytes / TriangleCount);
+	printf("%-22s %10zu %12.2f %12.1f\n", ShortIndices ? "quantized, 16 bit" : "quantized, 32 bit", sizeof(QuantizedVertex), QuantizedBytes / 1048576.0, QuantizedBytes / TriangleCount);
+	printf("normals: %zu bytes as floats, %zu as octahedral R8G8_SNORM\n", 3 * sizeof(float), 2 * sizeof(int8_t));
+	BenchmarkExpect(QuantizedBytes < 0.5 * SoupBytes, "indexed quantized meshes take less than half the unindexed float bytes");
+	return GetBenchmarkExitCode();
+}
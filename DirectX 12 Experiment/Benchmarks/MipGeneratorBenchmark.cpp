@@ -0,0 +1,82 @@
+#include "BenchmarkFramework.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ProceduralTexture.h"
+
+#include <cstdio>
+#include <string>
+
+static const char* GetInstructionSetName(InstructionSet Set)
+{
+	switch (Set)
+	{
+	case InstructionSet::Scalar: return "scalar";
+	case InstructionSet::Sse2: return "sse2";
+	case InstructionSet::Sse41: return "sse4.1";
+	default: return "avx2";
+	}
+}
+
+// Full chains from 512x512 up to 4096x4096 noise with the box and Kaiser filters, in sRGB and linear, on the scalar,
+// SSE2 and AVX2 paths, single threaded and on the job system. Throughput counts level zero texels. SSE4.1 has no
+// kernels of its own and runs the SSE2 ones, so it is not timed. Every configuration must write the scalar chain.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t SmallestSize = Quick ? 256 : 512;
+	const uint32_t LargestSize = Quick ? 512 : 4096;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+	const InstructionSet BestSet = GetBestInstructionSet();
+
+	JobSystem Jobs;
+	printf("best instruction set %s, %u threads\n", GetInstructionSetName(BestSet), Jobs.GetThreadCount());
+	printf("%6s %-7s %-7s %-12s %10s %12s %10s\n", "size", "filter", "space", "generator", "best ms", "Mtexels/s", "speedup");
+
+	for (uint32_t Size = SmallestSize; Size <= LargestSize; Size *= 2)
+	{
+		const uint32_t LevelCount = GetFullMipLevelCount(Size, Size);
+		TextureLevelLayout Levels[MaximumMipLevelCount];
+		std::vector<uint8_t> Pixels(GetTextureLevelLayouts(TextureFormat::Rgba8, Size, Size, LevelCount, 256, 512, Levels));
+		ProceduralTextureDescription Description;
+		Description.Pattern = ProceduralPattern::Noise;
+		Description.Width = Size;
+		Description.Height = Size;
+		GenerateProceduralTexture(Description, Pixels.data(), Levels[0].RowPitch, &Jobs);
+		const double TexelCount = static_cast<double>(Size) * Size;
+
+		for (MipFilter Filter : { MipFilter::Box, MipFilter::Kaiser })
+		{
+			for (bool Srgb : { true, false })
+			{
+				MipGenerationOptions Options;
+				Options.Filter = Filter;
+				Options.Srgb = Srgb;
+				Options.MaximumInstructionSet = InstructionSet::Scalar;
+				std::vector<uint8_t> Reference = Pixels;
+				GenerateMipChain(Reference.data(), Levels, LevelCount, Options);
+
+				double ScalarMilliseconds = 0.0;
+				for (InstructionSet Set : { InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2 })
+				{
+					if (ResolveInstructionSet(Set) != Set) continue;
+					Options.MaximumInstructionSet = Set;
+
+					for (JobSystem* Workers : { static_cast<JobSystem*>(nullptr), &Jobs })
+					{
+						// Only level zero is read, so every repetition writes the same chain
+						std::vector<uint8_t> Chain = Pixels;
+						const BenchmarkTiming Timing = MeasureBenchmark(Repetitions, [&] { GenerateMipChain(Chain.data(), Levels, LevelCount, Options, Workers); });
+						if (ScalarMilliseconds == 0.0) ScalarMilliseconds = Timing.BestMilliseconds;
+
+						const std::string Name = std::string(GetInstructionSetName(Set)) + (Workers ? " jobs" : "");
+						printf("%6u %-7s %-7s %-12s %10.3f %12.1f %10.2f\n", Size, Filter == MipFilter::Box ? "box" : "kaiser", Srgb ? "srgb" : "linear", Name.c_str(), Timing.BestMilliseconds,
+							GetMillionsPerSecond(TexelCount, Timing.BestMilliseconds), ScalarMilliseconds / Timing.BestMilliseconds);
+						BenchmarkExpect(Chain == Reference, "every generator configuration writes the scalar generator's chain");
+					}
+				}
+			}
+		}
+	}
+	return GetBenchmarkExitCode();
+}
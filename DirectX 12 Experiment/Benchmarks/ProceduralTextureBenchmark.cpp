@@ -0,0 +1,92 @@
+#include "BenchmarkFramework.h"
+#include "JobSystem.h"
+#include "ProceduralTexture.h"
+
+#include <cstdio>
+#include <cstring>
+
+// The checkerboard loop Application used before ProceduralTexture, column by column with a branch per texel
+static void FillCheckerboard(uint8_t* Pixels, uint32_t RowPitch, uint32_t TextureSize, uint32_t GridSquareSize)
+{
+	for (uint32_t X = 0; X < TextureSize; X++)
+	{
+		for (uint32_t Y = 0; Y < TextureSize; Y++)
+		{
+			uint8_t* Pixel = Pixels + static_cast<size_t>(Y) * RowPitch + 4 * X;
+			const uint32_t GridRow = Y / GridSquareSize;
+			const uint32_t GridColumn = X / GridSquareSize;
+			const uint8_t Value = (GridRow + GridColumn) % 2 == 0 ? 255 : 0;
+			Pixel[0] = Value;
+			Pixel[1] = Value;
+			Pixel[2] = Value;
+			Pixel[3] = 255;
+		}
+	}
+}
+
+static const char* GetInstructionSetName(InstructionSet Set)
+{
+	switch (Set)
+	{
+	case InstructionSet::Scalar: return "scalar";
+	case InstructionSet::Sse2: return "sse2";
+	case InstructionSet::Sse41: return "sse4.1";
+	default: return "avx2";
+	}
+}
+
+// Checkerboards from 512x512 up to 8192x8192 with the old loop and the generator on every supported instruction
+// set, single threaded and on the job system, checked bit for bit against the old loop. Noise is timed too since it
+// is the most expensive pattern.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t LargestSize = Quick ? 1024 : 8192;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+	const InstructionSet BestSet = GetBestInstructionSet();
+
+	JobSystem Jobs;
+	printf("best instruction set %s, %u threads\n", GetInstructionSetName(BestSet), Jobs.GetThreadCount());
+	printf("%6s %-22s %10s %12s %10s\n", "size", "generator", "best ms", "Mtexels/s", "speedup");
+
+	for (uint32_t Size = 512; Size <= LargestSize; Size *= 2)
+	{
+		const uint32_t RowPitch = 4 * Size;
+		const double TexelCount = static_cast<double>(Size) * Size;
+		std::vector<uint8_t> Reference(static_cast<size_t>(RowPitch) * Size);
+		std::vector<uint8_t> Pixels(Reference.size());
+
+		const BenchmarkTiming OldLoop = MeasureBenchmark(Repetitions, [&] { FillCheckerboard(Reference.data(), RowPitch, Size, 32); });
+		printf("%6u %-22s %10.3f %12.1f %10.2f\n", Size, "old column loop", OldLoop.BestMilliseconds, GetMillionsPerSecond(TexelCount, OldLoop.BestMilliseconds), 1.0);
+
+		ProceduralTextureDescription Checker;
+		Checker.Width = Size;
+		Checker.Height = Size;
+		Checker.CellSize = 32;
+		for (uint32_t Set = 0; Set <= static_cast<uint32_t>(BestSet); Set++)
+		{
+			Checker.MaximumInstructionSet = static_cast<InstructionSet>(Set);
+			if (ResolveInstructionSet(Checker.MaximumInstructionSet) != Checker.MaximumInstructionSet) continue;
+
+			std::fill(Pixels.begin(), Pixels.end(), 0x55);
+			const BenchmarkTiming Generated = MeasureBenchmark(Repetitions, [&] { GenerateProceduralTexture(Checker, Pixels.data(), RowPitch); });
+			const std::string Name = std::string("checker ") + GetInstructionSetName(Checker.MaximumInstructionSet);
+			printf("%6u %-22s %10.3f %12.1f %10.2f\n", Size, Name.c_str(), Generated.BestMilliseconds, GetMillionsPerSecond(TexelCount, Generated.BestMilliseconds),
+				OldLoop.BestMilliseconds / Generated.BestMilliseconds);
+			BenchmarkExpect(memcmp(Pixels.data(), Reference.data(), Pixels.size()) == 0, "the checker generator matches the old loop");
+		}
+
+		Checker.MaximumInstructionSet = BestSet;
+		std::fill(Pixels.begin(), Pixels.end(), 0x55);
+		const BenchmarkTiming Parallel = MeasureBenchmark(Repetitions, [&] { GenerateProceduralTexture(Checker, Pixels.data(), RowPitch, &Jobs); });
+		printf("%6u %-22s %10.3f %12.1f %10.2f\n", Size, "checker jobs", Parallel.BestMilliseconds, GetMillionsPerSecond(TexelCount, Parallel.BestMilliseconds),
+			OldLoop.BestMilliseconds / Parallel.BestMilliseconds);
+		BenchmarkExpect(memcmp(Pixels.data(), Reference.data(), Pixels.size()) == 0, "the parallel checker generator matches the old loop");
+
+		ProceduralTextureDescription Noise = Checker;
+		Noise.Pattern = ProceduralPattern::Noise;
+		const BenchmarkTiming NoiseTiming = MeasureBenchmark(Repetitions, [&] { GenerateProceduralTexture(Noise, Pixels.data(), RowPitch, &Jobs); });
+		printf("%6u %-22s %10.3f %12.1f %10s\n", Size, "noise jobs", NoiseTiming.BestMilliseconds, GetMillionsPerSecond(TexelCount, NoiseTiming.BestMilliseconds), "-");
+	}
+	return GetBenchmarkExitCode();
+}
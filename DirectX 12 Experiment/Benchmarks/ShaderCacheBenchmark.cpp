@@ -0,0 +1,111 @@
+#include "BenchmarkFramework.h"
+#include "JobSystem.h"
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Stands in for D3DCompileFromFile with a fixed amount of CPU work per shader; every source includes the same header
+struct StubCompiler
+{
+	std::string IncludePath;
+	double CompileMilliseconds = 0.0;
+	std::atomic<uint32_t> CompileCount{ 0 };
+
+	ShaderCompileResult operator()(const ShaderCompileRequest& Request)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count() < CompileMilliseconds)
+		{
+		}
+		CompileCount++;
+
+		ShaderCompileResult Result;
+		Result.Bytecode.assign(4096, static_cast<uint8_t>(Request.Flags));
+		Result.Includes.push_back(IncludePath);
+		Result.Succeeded = true;
+		return Result;
+	}
+};
+
+static std::string GetTemporaryDirectory()
+{
+#ifdef _WIN32
+	const char* Directory = std::getenv("TEMP");
+	return Directory != nullptr ? std::string(Directory) + "\\" : std::string(".\\");
+#else
+	const char* Directory = std::getenv("TMPDIR");
+	return Directory != nullptr ? std::string(Directory) + "/" : std::string("/tmp/");
+#endif
+}
+
+// Startup shader resolution with no pack (every shader compiled across the job system, then saved), with a warm
+// pack (validation only), and after an edit to the shared include (everything recompiled against the old pack)
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t ShaderCount = Quick ? 8 : 64;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+
+	const std::string Prefix = GetTemporaryDirectory() + "ShaderCacheBenchmark";
+	const std::string PackPath = Prefix + ".pack";
+	StubCompiler Compiler;
+	Compiler.IncludePath = Prefix + "Common.hlsli";
+	Compiler.CompileMilliseconds = Quick ? 1.0 : 20.0;
+	const ShaderCompiler CompileFunction = [&Compiler](const ShaderCompileRequest& Request) { return Compiler(Request); };
+
+	std::vector<ShaderCompileRequest> Requests(ShaderCount);
+	for (uint32_t ShaderIndex = 0; ShaderIndex < ShaderCount; ShaderIndex++)
+	{
+		const std::string Source = "float4 Main() : SV_Target { return " + std::to_string(ShaderIndex) + "; }";
+		Requests[ShaderIndex].Path = Prefix + std::to_string(ShaderIndex) + ".hlsl";
+		Requests[ShaderIndex].EntryPoint = "Main";
+		Requests[ShaderIndex].Profile = "ps_5_0";
+		Requests[ShaderIndex].Flags = ShaderIndex;
+		BenchmarkExpect(WriteFileAtomically(Requests[ShaderIndex].Path, Source.data(), Source.size()), "shader sources can be written");
+	}
+	uint32_t IncludeVersion = 0;
+	auto EditInclude = [&]
+	{
+		const std::string Include = "// version " + std::to_string(IncludeVersion++);
+		WriteFileAtomically(Compiler.IncludePath, Include.data(), Include.size());
+	};
+	EditInclude();
+
+	JobSystem Jobs;
+	ShaderCacheStatistics Last;
+	auto RunStartup = [&]
+	{
+		ShaderCache Cache(PackPath, "stub", CompileFunction);
+		Cache.Load();
+		const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Requests.data(), ShaderCount, &Jobs);
+		BenchmarkExpect(Bytecode.size() == ShaderCount && Bytecode.back().Size == 4096, "every shader resolves to its bytecode");
+		Cache.Save();
+		Last = Cache.GetStatistics();
+	};
+
+	const BenchmarkTiming Cold = MeasureBenchmark(Repetitions, [&] { std::remove(PackPath.c_str()); RunStartup(); });
+	const ShaderCacheStatistics ColdStatistics = Last;
+
+	const uint32_t CompilesBeforeWarm = Compiler.CompileCount;
+	const BenchmarkTiming Warm = MeasureBenchmark(Repetitions, RunStartup);
+	const ShaderCacheStatistics WarmStatistics = Last;
+	BenchmarkExpect(Compiler.CompileCount == CompilesBeforeWarm, "a warm pack compiles nothing");
+
+	const BenchmarkTiming Edited = MeasureBenchmark(Repetitions, [&] { EditInclude(); RunStartup(); });
+	const ShaderCacheStatistics EditedStatistics = Last;
+
+	printf("%u shaders, %.1f ms simulated compile each, %u threads\n", ShaderCount, Compiler.CompileMilliseconds, Jobs.GetThreadCount());
+	printf("%-16s %10s %10s %8s %8s %12s\n", "startup", "best ms", "median ms", "hits", "misses", "validate ms");
+	printf("%-16s %10.3f %10.3f %8u %8u %12.3f\n", "cold", Cold.BestMilliseconds, Cold.MedianMilliseconds, ColdStatistics.Hits, ColdStatistics.Misses, ColdStatistics.ValidateMilliseconds);
+	printf("%-16s %10.3f %10.3f %8u %8u %12.3f\n", "warm", Warm.BestMilliseconds, Warm.MedianMilliseconds, WarmStatistics.Hits, WarmStatistics.Misses, WarmStatistics.ValidateMilliseconds);
+	printf("%-16s %10.3f %10.3f %8u %8u %12.3f\n", "include edited", Edited.BestMilliseconds, Edited.MedianMilliseconds, EditedStatistics.Hits, EditedStatistics.Misses, EditedStatistics.ValidateMilliseconds);
+
+	BenchmarkExpect(ColdStatistics.Misses == ShaderCount && WarmStatistics.Hits == ShaderCount && EditedStatistics.Misses == ShaderCount, "hits and misses follow the pack state");
+	BenchmarkExpect(Warm.BestMilliseconds < Cold.BestMilliseconds, "a warm start is faster than compiling");
+
+	std::remove(PackPath.c_str());
+	return GetBenchmarkExitCode();
+}
@@ -0,0 +1,79 @@
+#include "BenchmarkFramework.h"
+#include "SingleProducerSingleConsumerQueue.h"
+
+#include <cstdio>
+#include <thread>
+
+// Values pushed from another thread as fast as the consumer drains them; returns false if any arrived out of order
+static bool StreamValues(SingleProducerSingleConsumerQueue<uint64_t>& Queue, uint64_t Count)
+{
+	std::thread Producer([&Queue, Count]
+	{
+		for (uint64_t Value = 0; Value < Count; Value++)
+		{
+			while (!Queue.TryPush(Value)) std::this_thread::yield();
+		}
+	});
+
+	bool InOrder = true;
+	uint64_t Value;
+	for (uint64_t Expected = 0; Expected < Count; Expected++)
+	{
+		while (!Queue.TryPop(Value)) std::this_thread::yield();
+		InOrder &= Value == Expected;
+	}
+	Producer.join();
+	return InOrder;
+}
+
+// Throughput through a queue the size of the application's input queue, and the round trip of one value
+// bounced between two threads through a pair of queues. Waiting threads yield, so on a machine with fewer cores
+// than threads the round trip measures the scheduler more than the queue.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint64_t ValueCount = Quick ? 100000 : 20000000;
+	const uint32_t RoundTrips = Quick ? 1000 : 100000;
+	const uint32_t Repetitions = Quick ? 2 : 5;
+
+	SingleProducerSingleConsumerQueue<uint64_t> Queue(256);
+	bool InOrder = true;
+	const BenchmarkTiming Streaming = MeasureBenchmark(Repetitions, [&]
+	{
+		InOrder &= StreamValues(Queue, ValueCount);
+	});
+	printf("throughput  %10.2f Mvalues/s (best %.3f ms, median %.3f ms for %llu values, capacity %zu)\n", GetMillionsPerSecond(static_cast<double>(ValueCount), Streaming.BestMilliseconds),
+		Streaming.BestMilliseconds, Streaming.MedianMilliseconds, static_cast<unsigned long long>(ValueCount), Queue.GetCapacity());
+	BenchmarkExpect(InOrder, "values arrive once and in order");
+
+	SingleProducerSingleConsumerQueue<uint64_t> Requests(16);
+	SingleProducerSingleConsumerQueue<uint64_t> Replies(16);
+	std::thread Echo([&]
+	{
+		uint64_t Value;
+		for (uint32_t RoundTrip = 0; RoundTrip < RoundTrips; RoundTrip++)
+		{
+			while (!Requests.TryPop(Value)) std::this_thread::yield();
+			while (!Replies.TryPush(Value + 1)) std::this_thread::yield();
+		}
+	});
+
+	std::vector<double> RoundTripMicroseconds;
+	RoundTripMicroseconds.reserve(RoundTrips);
+	bool RepliesMatch = true;
+	for (uint32_t RoundTrip = 0; RoundTrip < RoundTrips; RoundTrip++)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		uint64_t Reply;
+		while (!Requests.TryPush(RoundTrip)) std::this_thread::yield();
+		while (!Replies.TryPop(Reply)) std::this_thread::yield();
+		RoundTripMicroseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count());
+		RepliesMatch &= Reply == RoundTrip + 1u;
+	}
+	Echo.join();
+	printf("round trip  p50 %.2f us, p99 %.2f us, max %.2f us\n", GetPercentile(RoundTripMicroseconds, 50.0), GetPercentile(RoundTripMicroseconds, 99.0),
+		GetPercentile(RoundTripMicroseconds, 100.0));
+	BenchmarkExpect(RepliesMatch, "every reply answers its request");
+
+	return GetBenchmarkExitCode();
+}
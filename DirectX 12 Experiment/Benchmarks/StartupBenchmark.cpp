@@ -0,0 +1,161 @@
+#include "AssetStreamer.h"
+#include "BenchmarkFramework.h"
+#include "HeadlessRenderDevice.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ProceduralTexture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+static const float ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+
+struct StartupResult
+{
+	double FirstFrameMilliseconds = 0.0;
+	double TexturesReadyMilliseconds = 0.0;
+	uint64_t FramesWhileLoading = 0;
+	bool AllTexturesLoaded = false;
+};
+
+static ProceduralTextureDescription GetTextureDescription(uint32_t Size, uint32_t Seed)
+{
+	ProceduralTextureDescription Description;
+	Description.Pattern = ProceduralPattern::Noise;
+	Description.Width = Size;
+	Description.Height = Size;
+	Description.Seed = Seed;
+	return Description;
+}
+
+static void InitializeDevice(HeadlessRenderDevice& Device, JobSystem& Jobs)
+{
+	RenderDeviceDescription Description;
+	Description.Width = 256;
+	Description.Height = 256;
+	Description.Pacing.Mode = PresentMode::Uncapped;
+	Description.Jobs = &Jobs;
+	Device.Initialize(Description);
+}
+
+static void PresentFrame(HeadlessRenderDevice& Device, RenderCommandList& CommandList)
+{
+	CommandList.Reset();
+	CommandList.ClearRenderTarget(ClearColor);
+	CommandList.Close();
+	RenderCommandList* const CommandLists[] = { &CommandList };
+	Device.ExecuteCommandLists(CommandLists, 1);
+	Device.Present();
+}
+
+// Every texture generated and uploaded before the first frame, as Application::Initialize does without -stream.
+// The headless device keeps only level zero, so the mip chain the D3D12 backend builds in CreateTexture is
+// generated here to keep the CPU work of both paths the same.
+static StartupResult RunBlockingStartup(JobSystem& Jobs, uint32_t TextureCount, uint32_t TextureSize)
+{
+	const auto Start = std::chrono::steady_clock::now();
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, Jobs);
+
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	const uint32_t LevelCount = GetFullMipLevelCount(TextureSize, TextureSize);
+	std::vector<uint8_t> Pixels(GetTextureLevelLayouts(TextureFormat::Rgba8, TextureSize, TextureSize, LevelCount, 4, 4, Levels));
+	for (uint32_t TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+	{
+		GenerateProceduralTexture(GetTextureDescription(TextureSize, TextureIndex), Pixels.data(), Levels[0].RowPitch, &Jobs);
+		GenerateMipChain(Pixels.data(), Levels, LevelCount, MipGenerationOptions(), &Jobs);
+		TextureDescription Texture;
+		Texture.Width = TextureSize;
+		Texture.Height = TextureSize;
+		Device.CreateTexture(Texture, Pixels.data());
+	}
+	Device.FinishUploads();
+
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	Device.BeginFrame();
+	PresentFrame(Device, *CommandList);
+
+	StartupResult Result;
+	Result.FirstFrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	Result.TexturesReadyMilliseconds = Result.FirstFrameMilliseconds;
+	Result.AllTexturesLoaded = Device.GetStatistics().UploadedBytes == 4ull * TextureSize * TextureSize * TextureCount;
+	return Result;
+}
+
+// Textures requested from the streamer and the frame loop started straight away, as with -stream
+static StartupResult RunStreamingStartup(JobSystem& Jobs, uint32_t TextureCount, uint32_t TextureSize)
+{
+	const auto Start = std::chrono::steady_clock::now();
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, Jobs);
+	Device.FinishUploads();
+
+	StartupResult Result;
+	{
+		// The application's streaming budget
+		AssetStreamer Streamer(Device, 32 * 1024 * 1024);
+		std::vector<StreamTicket> Tickets;
+		for (uint32_t TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+		{
+			StreamRequest Request;
+			Request.Width = TextureSize;
+			Request.Height = TextureSize;
+			Request.Decode = [Description = GetTextureDescription(TextureSize, TextureIndex)](uint8_t* Pixels, uint32_t RowPitch)
+			{
+				GenerateProceduralTexture(Description, Pixels, RowPitch);
+				return true;
+			};
+			Tickets.push_back(Streamer.Request(std::move(Request)));
+		}
+
+		std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+		const auto Deadline = Start + std::chrono::seconds(60);
+		while (std::chrono::steady_clock::now() < Deadline)
+		{
+			Device.BeginFrame();
+			Streamer.Pump();
+			PresentFrame(Device, *CommandList);
+			if (Result.FramesWhileLoading++ == 0)
+			{
+				Result.FirstFrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+			}
+
+			Result.AllTexturesLoaded = std::all_of(Tickets.begin(), Tickets.end(), [&Streamer](StreamTicket Ticket) { return Streamer.GetState(Ticket) == StreamState::Ready; });
+			if (Result.AllTexturesLoaded) break;
+
+			// Stands in for the rest of a frame so the decode thread is not starved on machines with few cores
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		Result.TexturesReadyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		Result.AllTexturesLoaded &= Device.GetStatistics().StreamedTextures == TextureCount;
+	}
+	return Result;
+}
+
+// Time to the first presented frame and until every texture is resident, for blocking and streamed startup.
+// Which path presents first is only checked at full size; quick runs are too short for the order to be stable
+// when the decode thread shares a core with the frame loop.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t TextureCount = Quick ? 4 : 16;
+	const uint32_t TextureSize = Quick ? 512 : 2048;
+
+	JobSystem Jobs;
+	const StartupResult Blocking = RunBlockingStartup(Jobs, TextureCount, TextureSize);
+	const StartupResult Streaming = RunStreamingStartup(Jobs, TextureCount, TextureSize);
+
+	printf("%u noise textures of %ux%u with mips, %u threads\n", TextureCount, TextureSize, TextureSize, Jobs.GetThreadCount());
+	printf("%10s %16s %18s %18s\n", "", "first frame ms", "textures ready ms", "frames while load");
+	printf("%10s %16.2f %18.2f %18llu\n", "blocking", Blocking.FirstFrameMilliseconds, Blocking.TexturesReadyMilliseconds, 0ull);
+	printf("%10s %16.2f %18.2f %18llu\n", "streaming", Streaming.FirstFrameMilliseconds, Streaming.TexturesReadyMilliseconds, static_cast<unsigned long long>(Streaming.FramesWhileLoading));
+
+	BenchmarkExpect(Blocking.AllTexturesLoaded, "blocking startup uploads every texture");
+	BenchmarkExpect(Streaming.AllTexturesLoaded, "every streamed texture becomes ready");
+	if (!Quick)
+	{
+		BenchmarkExpect(Streaming.FirstFrameMilliseconds < Blocking.FirstFrameMilliseconds, "streaming presents its first frame sooner");
+	}
+	return GetBenchmarkExitCode();
+}
@@ -0,0 +1,189 @@
+#include "BenchmarkFramework.h"
+#include "JobSystem.h"
+#include "VisibilityCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+static const char* GetInstructionSetName(InstructionSet Set)
+{
+	switch (Set)
+	{
+	case InstructionSet::Scalar: return "scalar";
+	case InstructionSet::Sse2: return "sse2";
+	case InstructionSet::Sse41: return "sse4.1";
+	default: return "avx2";
+	}
+}
+
+// Objects scattered around a camera at the origin looking down +Z, a little under half of them inside its frustum
+static CullBounds CreateBounds(uint32_t ObjectCount)
+{
+	CullBounds Bounds;
+	for (std::vector<float>* Array : { &Bounds.CenterX, &Bounds.CenterY, &Bounds.CenterZ, &Bounds.ExtentX, &Bounds.ExtentY, &Bounds.ExtentZ, &Bounds.Radius })
+	{
+		Array->resize(ObjectCount);
+	}
+
+	std::mt19937 Random(ObjectCount);
+	std::uniform_real_distribution<float> Lateral(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> Depth(-20.0f, 60.0f);
+	std::uniform_real_distribution<float> Extent(0.05f, 1.0f);
+	for (uint32_t Object = 0; Object < ObjectCount; Object++)
+	{
+		Bounds.CenterX[Object] = Lateral(Random);
+		Bounds.CenterY[Object] = Lateral(Random);
+		Bounds.CenterZ[Object] = Depth(Random);
+		Bounds.ExtentX[Object] = Extent(Random);
+		Bounds.ExtentY[Object] = Extent(Random);
+		Bounds.ExtentZ[Object] = Extent(Random);
+		Bounds.Radius[Object] = std::sqrt(Bounds.ExtentX[Object] * Bounds.ExtentX[Object] + Bounds.ExtentY[Object] * Bounds.ExtentY[Object] + Bounds.ExtentZ[Object] * Bounds.ExtentZ[Object]);
+	}
+	return Bounds;
+}
+
+struct ReferenceVisibility
+{
+	std::vector<bool> Visible;
+	uint32_t VisibleCount = 0;
+	// Objects this close to a plane may land either way in single precision
+	uint32_t BorderlineCount = 0;
+};
+
+// The plane tests in double precision, one object at a time
+static ReferenceVisibility CullReference(const CullBounds& Bounds, const Frustum& View, BoundsTest Test)
+{
+	ReferenceVisibility Reference;
+	Reference.Visible.resize(Bounds.CenterX.size());
+	for (size_t Object = 0; Object < Bounds.CenterX.size(); Object++)
+	{
+		bool Inside = true;
+		bool Borderline = false;
+		for (const float* Plane : View.Planes)
+		{
+			const double Distance = static_cast<double>(Plane[0]) * Bounds.CenterX[Object] + static_cast<double>(Plane[1]) * Bounds.CenterY[Object] + static_cast<double>(Plane[2]) * Bounds.CenterZ[Object] + Plane[3];
+			const double Reach = Test == BoundsTest::Sphere ? static_cast<double>(Bounds.Radius[Object]) :
+				std::fabs(Plane[0]) * static_cast<double>(Bounds.ExtentX[Object]) + std::fabs(Plane[1]) * static_cast<double>(Bounds.ExtentY[Object]) + std::fabs(Plane[2]) * static_cast<double>(Bounds.ExtentZ[Object]);
+			Inside &= Distance + Reach >= 0.0;
+			Borderline |= std::fabs(Distance + Reach) < 1e-4;
+		}
+		Reference.Visible[Object] = Inside;
+		Reference.VisibleCount += Inside ? 1 : 0;
+		Reference.BorderlineCount += Borderline ? 1 : 0;
+	}
+	return Reference;
+}
+
+// Every index in ascending order, and apart from borderline objects exactly the ones the reference keeps
+static bool MatchesReference(const std::vector<uint32_t>& Visible, const ReferenceVisibility& Reference)
+{
+	if (!std::is_sorted(Visible.begin(), Visible.end()) || std::adjacent_find(Visible.begin(), Visible.end()) != Visible.end()) return false;
+
+	uint32_t Mismatches = 0;
+	size_t Next = 0;
+	for (uint32_t Object = 0; Object < Reference.Visible.size(); Object++)
+	{
+		const bool Kept = Next < Visible.size() && Visible[Next] == Object;
+		Next += Kept ? 1 : 0;
+		Mismatches += Kept != Reference.Visible[Object] ? 1 : 0;
+	}
+	return Mismatches <= Reference.BorderlineCount;
+}
+
+// Sphere and box frustum culling of 100k to 1M objects on every supported instruction set, single threaded and on
+// the job system, with the visible list checked against a double precision reference. A final pass adds a wall
+// occluder and checks that only objects behind it are occluded.
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const bool Quick = IsQuickBenchmarkRun(NumberOfArguments, Arguments);
+	const uint32_t LargestCount = Quick ? 100000 : 1000000;
+	const uint32_t Repetitions = Quick ? 3 : 20;
+	const InstructionSet BestSet = GetBestInstructionSet();
+
+	// 90 degree perspective with depth from 0.1 to 100 mapped to 0..1
+	const float Near = 0.1f, Far = 100.0f;
+	const float ViewProjection[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, Far / (Far - Near), -Near * Far / (Far - Near) }, { 0, 0, 1, 0 } };
+	const Frustum View = ExtractFrustum(ViewProjection);
+
+	JobSystem Jobs;
+	printf("best instruction set %s, %u threads\n", GetInstructionSetName(BestSet), Jobs.GetThreadCount());
+	printf("%8s %-6s %-12s %10s %10s %14s %9s\n", "objects", "bounds", "culler", "best ms", "median ms", "Mobjects/s", "visible");
+
+	for (uint32_t ObjectCount = 100000; ObjectCount <= LargestCount; ObjectCount *= 10)
+	{
+		const CullBounds Bounds = CreateBounds(ObjectCount);
+		for (BoundsTest Test : { BoundsTest::Sphere, BoundsTest::Box })
+		{
+			const ReferenceVisibility Reference = CullReference(Bounds, View, Test);
+			for (uint32_t Set = 0; Set <= static_cast<uint32_t>(BestSet); Set++)
+			{
+				VisibilityOptions Options;
+				Options.Test = Test;
+				Options.MaximumInstructionSet = static_cast<InstructionSet>(Set);
+				if (ResolveInstructionSet(Options.MaximumInstructionSet) != Options.MaximumInstructionSet) continue;
+
+				for (JobSystem* Workers : { static_cast<JobSystem*>(nullptr), &Jobs })
+				{
+					VisibilityCuller Culler(Workers);
+					std::vector<uint32_t> Visible;
+					const BenchmarkTiming Timing = MeasureBenchmark(Repetitions, [&] { Culler.Cull(Bounds, View, Options, Visible); });
+					const std::string Name = std::string(GetInstructionSetName(Options.MaximumInstructionSet)) + (Workers ? " jobs" : "");
+					printf("%8u %-6s %-12s %10.3f %10.3f %14.1f %9zu\n", ObjectCount, Test == BoundsTest::Sphere ? "sphere" : "box", Name.c_str(), Timing.BestMilliseconds,
+						Timing.MedianMilliseconds, GetMillionsPerSecond(ObjectCount, Timing.BestMilliseconds), Visible.size());
+
+					const VisibilityStatistics& Statistics = Culler.GetStatistics();
+					BenchmarkExpect(Statistics.Tested == ObjectCount && Statistics.Visible == Visible.size() && Statistics.FrustumCulled + Statistics.Visible == ObjectCount, "statistics account for every object");
+					BenchmarkExpect(MatchesReference(Visible, Reference), "the visible list matches the double precision reference");
+				}
+			}
+			printf("%8u %-6s %-12s %10s %10s %14s %9u (%u borderline)\n", ObjectCount, Test == BoundsTest::Sphere ? "sphere" : "box", "reference", "-", "-", "-", Reference.VisibleCount, Reference.BorderlineCount);
+		}
+
+		// A wall ten units ahead covering the middle 30% of the screen in each direction hides what lies behind it
+		const float WallDepth = 10.0f, WallHalfSize = 3.0f;
+		const float Wall[] =
+		{
+			-WallHalfSize, -WallHalfSize, WallDepth, WallHalfSize, -WallHalfSize, WallDepth, WallHalfSize, WallHalfSize, WallDepth,
+			-WallHalfSize, -WallHalfSize, WallDepth, -WallHalfSize, WallHalfSize, WallDepth, WallHalfSize, WallHalfSize, WallDepth
+		};
+		OcclusionBuffer Occlusion(256, 256);
+		const BenchmarkTiming Rasterize = MeasureBenchmark(Repetitions, [&]
+		{
+			Occlusion.Begin(ViewProjection);
+			Occlusion.RasterizeOccluders(Wall, 2);
+			Occlusion.Finish();
+		});
+
+		VisibilityOptions Options;
+		Options.Test = BoundsTest::Box;
+		Options.Occlusion = &Occlusion;
+		VisibilityCuller Culler(&Jobs);
+		std::vector<uint32_t> Visible;
+		const BenchmarkTiming Timing = MeasureBenchmark(Repetitions, [&] { Culler.Cull(Bounds, View, Options, Visible); });
+		const VisibilityStatistics& Statistics = Culler.GetStatistics();
+		printf("%8u %-6s %-12s %10.3f %10.3f %14.1f %9zu (%u occluded, %.3f ms occluder raster)\n", ObjectCount, "box", "occlusion", Timing.BestMilliseconds, Timing.MedianMilliseconds,
+			GetMillionsPerSecond(ObjectCount, Timing.BestMilliseconds), Visible.size(), Statistics.OcclusionCulled, Rasterize.BestMilliseconds);
+
+		// Occluded objects are the frustum survivors missing from the list; each must sit wholly behind the wall and
+		// project inside it, give or take a texel of the occlusion buffer
+		const float WallScreenSize = WallHalfSize / WallDepth + 2.0f / Occlusion.GetWidth();
+		const ReferenceVisibility Reference = CullReference(Bounds, View, BoundsTest::Box);
+		bool OnlyHiddenObjectsOccluded = Statistics.OcclusionCulled > 0 && Statistics.FrustumCulled + Statistics.OcclusionCulled + Statistics.Visible == ObjectCount;
+		size_t Next = 0;
+		for (uint32_t Object = 0; Object < ObjectCount; Object++)
+		{
+			const bool Kept = Next < Visible.size() && Visible[Next] == Object;
+			Next += Kept ? 1 : 0;
+			if (Kept || !Reference.Visible[Object]) continue;
+			const float NearestDepth = Bounds.CenterZ[Object] - Bounds.ExtentZ[Object];
+			OnlyHiddenObjectsOccluded &= NearestDepth > WallDepth &&
+				std::fabs(Bounds.CenterX[Object]) + Bounds.ExtentX[Object] <= WallScreenSize * NearestDepth &&
+				std::fabs(Bounds.CenterY[Object]) + Bounds.ExtentY[Object] <= WallScreenSize * NearestDepth;
+		}
+		BenchmarkExpect(OnlyHiddenObjectsOccluded, "only objects behind the wall are occluded");
+	}
+	return GetBenchmarkExitCode();
+}
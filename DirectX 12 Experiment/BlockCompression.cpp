@@ -0,0 +1,625 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+static const uint32_t BlockDimension = 4;
+static const uint32_t BlockTexelCount = BlockDimension * BlockDimension;
+
+// BC7 palette weights for 4 bit indices, in 64ths of the way from the first endpoint to the second
+static const int32_t Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Every BC7 block in this encoder uses mode 6, one subset with 7777 endpoints, a parity bit each and 4 bit indices
+static const uint32_t Bc7Mode = 6;
+
+// Projects each texel onto the line from Origin along Direction and counts the thresholds the projection exceeds,
+// giving its palette position. Integer only, so every instruction set produces the same blocks.
+static void ProjectBlockScalar(const uint8_t* Texels, const int16_t* Origin, const int16_t* Direction, const int32_t* Thresholds, uint32_t ThresholdCount, uint8_t* Positions)
+{
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		int32_t Projection = 0;
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Projection += (Texels[4 * Texel + Channel] - Origin[Channel]) * Direction[Channel];
+		}
+
+		uint8_t Position = 0;
+		for (uint32_t Threshold = 0; Threshold < ThresholdCount; Threshold++)
+		{
+			Position += Projection > Thresholds[Threshold] ? 1 : 0;
+		}
+		Positions[Texel] = Position;
+	}
+}
+
+#if CPU_FEATURES_X86
+static void ProjectBlockSse2(const uint8_t* Texels, const int16_t* Origin, const int16_t* Direction, const int32_t* Thresholds, uint32_t ThresholdCount, uint8_t* Positions)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i OriginPair = _mm_setr_epi16(Origin[0], Origin[1], Origin[2], Origin[3], Origin[0], Origin[1], Origin[2], Origin[3]);
+	const __m128i DirectionPair = _mm_setr_epi16(Direction[0], Direction[1], Direction[2], Direction[3], Direction[0], Direction[1], Direction[2], Direction[3]);
+
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel += 4)
+	{
+		const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Texels + 4 * Texel));
+
+		// Each texel leaves a red-green and a blue-alpha partial sum, gather the halves and add them
+		const __m128 Partial01 = _mm_castsi128_ps(_mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(Bytes, Zero), OriginPair), DirectionPair));
+		const __m128 Partial23 = _mm_castsi128_ps(_mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(Bytes, Zero), OriginPair), DirectionPair));
+		const __m128i Projections = _mm_add_epi32(
+			_mm_castps_si128(_mm_shuffle_ps(Partial01, Partial23, _MM_SHUFFLE(2, 0, 2, 0))),
+			_mm_castps_si128(_mm_shuffle_ps(Partial01, Partial23, _MM_SHUFFLE(3, 1, 3, 1))));
+
+		// Comparisons yield -1 per exceeded threshold
+		__m128i Counts = Zero;
+		for (uint32_t Threshold = 0; Threshold < ThresholdCount; Threshold++)
+		{
+			Counts = _mm_sub_epi32(Counts, _mm_cmpgt_epi32(Projections, _mm_set1_epi32(Thresholds[Threshold])));
+		}
+
+		const int32_t Packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(Counts, Zero), Zero));
+		memcpy(Positions + Texel, &Packed, sizeof(Packed));
+	}
+}
+
+CPU_TARGET_AVX2 static void ProjectBlockAvx2(const uint8_t* Texels, const int16_t* Origin, const int16_t* Direction, const int32_t* Thresholds, uint32_t ThresholdCount, uint8_t* Positions)
+{
+	const __m256i OriginQuad = _mm256_setr_epi16(
+		Origin[0], Origin[1], Origin[2], Origin[3], Origin[0], Origin[1], Origin[2], Origin[3],
+		Origin[0], Origin[1], Origin[2], Origin[3], Origin[0], Origin[1], Origin[2], Origin[3]);
+	const __m256i DirectionQuad = _mm256_setr_epi16(
+		Direction[0], Direction[1], Direction[2], Direction[3], Direction[0], Direction[1], Direction[2], Direction[3],
+		Direction[0], Direction[1], Direction[2], Direction[3], Direction[0], Direction[1], Direction[2], Direction[3]);
+
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel += 8)
+	{
+		const __m128i Bytes0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Texels + 4 * Texel));
+		const __m128i Bytes1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Texels + 4 * Texel + 16));
+		const __m256i Partial0 = _mm256_madd_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(Bytes0), OriginQuad), DirectionQuad);
+		const __m256i Partial1 = _mm256_madd_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(Bytes1), OriginQuad), DirectionQuad);
+
+		// Lanes hold texels {0,1,4,5} {2,3,6,7} after the horizontal add, restore the order
+		const __m256i Projections = _mm256_permute4x64_epi64(_mm256_hadd_epi32(Partial0, Partial1), _MM_SHUFFLE(3, 1, 2, 0));
+
+		__m256i Counts = _mm256_setzero_si256();
+		for (uint32_t Threshold = 0; Threshold < ThresholdCount; Threshold++)
+		{
+			Counts = _mm256_sub_epi32(Counts, _mm256_cmpgt_epi32(Projections, _mm256_set1_epi32(Thresholds[Threshold])));
+		}
+
+		const __m128i Words = _mm_packs_epi32(_mm256_castsi256_si128(Counts), _mm256_extracti128_si256(Counts, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(Positions + Texel), _mm_packus_epi16(Words, _mm_setzero_si128()));
+	}
+}
+#endif
+
+static void ProjectBlock(InstructionSet Instructions, const uint8_t* Texels, const int16_t* Origin, const int16_t* Direction, const int32_t* Thresholds, uint32_t ThresholdCount, uint8_t* Positions)
+{
+#if CPU_FEATURES_X86
+	if (Instructions == InstructionSet::Avx2)
+	{
+		ProjectBlockAvx2(Texels, Origin, Direction, Thresholds, ThresholdCount, Positions);
+		return;
+	}
+	if (Instructions != InstructionSet::Scalar)
+	{
+		ProjectBlockSse2(Texels, Origin, Direction, Thresholds, ThresholdCount, Positions);
+		return;
+	}
+#endif
+	ProjectBlockScalar(Texels, Origin, Direction, Thresholds, ThresholdCount, Positions);
+}
+
+// Midpoints between StepCount + 1 evenly spaced palette entries, as projections onto a line of squared length LengthSquared.
+// A projection P rounds past entry K when P * 2 * StepCount > LengthSquared * (2K + 1), which for integer P is P > floor(...).
+static void GetUniformThresholds(int32_t LengthSquared, uint32_t StepCount, int32_t* Thresholds)
+{
+	for (uint32_t Step = 0; Step < StepCount; Step++)
+	{
+		Thresholds[Step] = LengthSquared * static_cast<int32_t>(2 * Step + 1) / static_cast<int32_t>(2 * StepCount);
+	}
+}
+
+static void LoadBlock(const uint8_t* Pixels, const TextureLevelLayout& Layout, uint32_t BlockX, uint32_t BlockY, uint8_t* Texels)
+{
+	for (uint32_t Y = 0; Y < BlockDimension; Y++)
+	{
+		const uint32_t Row = std::min(BlockY * BlockDimension + Y, Layout.Height - 1);
+		const uint8_t* SourceRow = Pixels + static_cast<size_t>(Row) * Layout.RowPitch;
+		for (uint32_t X = 0; X < BlockDimension; X++)
+		{
+			const uint32_t Column = std::min(BlockX * BlockDimension + X, Layout.Width - 1);
+			memcpy(Texels + 4 * (Y * BlockDimension + X), SourceRow + 4 * Column, 4);
+		}
+	}
+}
+
+static uint16_t QuantizeColor565(const int32_t* Color)
+{
+	const int32_t Red = (Color[0] * 31 + 127) / 255;
+	const int32_t Green = (Color[1] * 63 + 127) / 255;
+	const int32_t Blue = (Color[2] * 31 + 127) / 255;
+	return static_cast<uint16_t>((Red << 11) | (Green << 5) | Blue);
+}
+
+static void ExpandColor565(uint16_t Packed, int16_t* Color)
+{
+	const int32_t Red = Packed >> 11;
+	const int32_t Green = (Packed >> 5) & 63;
+	const int32_t Blue = Packed & 31;
+	Color[0] = static_cast<int16_t>((Red << 3) | (Red >> 2));
+	Color[1] = static_cast<int16_t>((Green << 2) | (Green >> 4));
+	Color[2] = static_cast<int16_t>((Blue << 3) | (Blue >> 2));
+	Color[3] = 0;
+}
+
+// BC1 color block in four color mode. Endpoints are the inset bounding box, with its diagonal flipped
+// to follow the red-green and blue-green correlation. Alpha is ignored.
+static void EncodeColorBlock(InstructionSet Instructions, const uint8_t* Texels, uint8_t* Output)
+{
+	int32_t Minimum[3] = { 255, 255, 255 };
+	int32_t Maximum[3] = { 0, 0, 0 };
+	int32_t Sum[3] = { 0, 0, 0 };
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		for (uint32_t Channel = 0; Channel < 3; Channel++)
+		{
+			Minimum[Channel] = std::min<int32_t>(Minimum[Channel], Texels[4 * Texel + Channel]);
+			Maximum[Channel] = std::max<int32_t>(Maximum[Channel], Texels[4 * Texel + Channel]);
+			Sum[Channel] += Texels[4 * Texel + Channel];
+		}
+	}
+
+	// Only the covariance signs matter, so deviations are scaled by the texel count to stay in integers
+	const int32_t TexelCount = static_cast<int32_t>(BlockTexelCount);
+	int32_t CovarianceRedGreen = 0;
+	int32_t CovarianceBlueGreen = 0;
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		const int32_t Green = TexelCount * Texels[4 * Texel + 1] - Sum[1];
+		CovarianceRedGreen += (TexelCount * Texels[4 * Texel + 0] - Sum[0]) * Green;
+		CovarianceBlueGreen += (TexelCount * Texels[4 * Texel + 2] - Sum[2]) * Green;
+	}
+
+	int32_t Endpoints[2][3];
+	for (uint32_t Channel = 0; Channel < 3; Channel++)
+	{
+		const int32_t Inset = (Maximum[Channel] - Minimum[Channel]) >> 4;
+		Endpoints[0][Channel] = Maximum[Channel] - Inset;
+		Endpoints[1][Channel] = Minimum[Channel] + Inset;
+	}
+	if (CovarianceRedGreen < 0) std::swap(Endpoints[0][0], Endpoints[1][0]);
+	if (CovarianceBlueGreen < 0) std::swap(Endpoints[0][2], Endpoints[1][2]);
+
+	// Four color mode requires the first endpoint to compare greater
+	uint16_t Color0 = QuantizeColor565(Endpoints[0]);
+	uint16_t Color1 = QuantizeColor565(Endpoints[1]);
+	if (Color0 < Color1) std::swap(Color0, Color1);
+
+	uint32_t Indices = 0;
+	if (Color0 != Color1)
+	{
+		int16_t Origin[4];
+		int16_t End[4];
+		ExpandColor565(Color0, Origin);
+		ExpandColor565(Color1, End);
+
+		int16_t Direction[4];
+		int32_t LengthSquared = 0;
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Direction[Channel] = static_cast<int16_t>(End[Channel] - Origin[Channel]);
+			LengthSquared += Direction[Channel] * Direction[Channel];
+		}
+
+		// The origin's alpha is zero and so is the direction's, which drops alpha from the projection
+		int32_t Thresholds[3];
+		GetUniformThresholds(LengthSquared, 3, Thresholds);
+		uint8_t Positions[BlockTexelCount];
+		ProjectBlock(Instructions, Texels, Origin, Direction, Thresholds, 3, Positions);
+
+		// Palette order is endpoint 0, endpoint 1, then the two interpolants
+		static const uint32_t PositionToIndex[4] = { 0, 2, 3, 1 };
+		for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+		{
+			Indices |= PositionToIndex[Positions[Texel]] << (2 * Texel);
+		}
+	}
+
+	Output[0] = static_cast<uint8_t>(Color0);
+	Output[1] = static_cast<uint8_t>(Color0 >> 8);
+	Output[2] = static_cast<uint8_t>(Color1);
+	Output[3] = static_cast<uint8_t>(Color1 >> 8);
+	for (uint32_t Byte = 0; Byte < 4; Byte++)
+	{
+		Output[4 + Byte] = static_cast<uint8_t>(Indices >> (8 * Byte));
+	}
+}
+
+// BC3 alpha block in eight value mode between the block's alpha extremes
+static void EncodeAlphaBlock(InstructionSet Instructions, const uint8_t* Texels, uint8_t* Output)
+{
+	int16_t Maximum = 0;
+	int16_t Minimum = 255;
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		Maximum = std::max<int16_t>(Maximum, Texels[4 * Texel + 3]);
+		Minimum = std::min<int16_t>(Minimum, Texels[4 * Texel + 3]);
+	}
+
+	uint64_t Indices = 0;
+	if (Maximum != Minimum)
+	{
+		const int16_t Origin[4] = { 0, 0, 0, Maximum };
+		const int16_t Direction[4] = { 0, 0, 0, static_cast<int16_t>(Minimum - Maximum) };
+
+		int32_t Thresholds[7];
+		GetUniformThresholds(Direction[3] * Direction[3], 7, Thresholds);
+		uint8_t Positions[BlockTexelCount];
+		ProjectBlock(Instructions, Texels, Origin, Direction, Thresholds, 7, Positions);
+
+		for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+		{
+			const uint64_t Index = Positions[Texel] == 0 ? 0 : Positions[Texel] == 7 ? 1 : Positions[Texel] + 1u;
+			Indices |= Index << (3 * Texel);
+		}
+	}
+
+	Output[0] = static_cast<uint8_t>(Maximum);
+	Output[1] = static_cast<uint8_t>(Minimum);
+	for (uint32_t Byte = 0; Byte < 6; Byte++)
+	{
+		Output[2 + Byte] = static_cast<uint8_t>(Indices >> (8 * Byte));
+	}
+}
+
+struct Bc7Candidate
+{
+	// Full 8 bit endpoint values, the parity bit is the low bit of every channel
+	int16_t Endpoints[2][4];
+	uint8_t Indices[BlockTexelCount];
+	uint64_t Error;
+};
+
+static void QuantizeBc7Endpoint(const float* Endpoint, uint32_t Parity, int16_t* Quantized)
+{
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		const long Value = std::lrint((std::min(std::max(Endpoint[Channel], 0.0f), 255.0f) - static_cast<float>(Parity)) * 0.5f);
+		Quantized[Channel] = static_cast<int16_t>(std::min(std::max(Value, 0l), 127l) * 2 + Parity);
+	}
+}
+
+// Quantizes both endpoints under every parity bit combination and keeps the one with the lowest block error
+static void FitBc7Candidate(InstructionSet Instructions, const uint8_t* Texels, const float Endpoints[2][4], Bc7Candidate& Best)
+{
+	for (uint32_t Parity = 0; Parity < 4; Parity++)
+	{
+		Bc7Candidate Candidate;
+		QuantizeBc7Endpoint(Endpoints[0], Parity & 1, Candidate.Endpoints[0]);
+		QuantizeBc7Endpoint(Endpoints[1], Parity >> 1, Candidate.Endpoints[1]);
+
+		int16_t Direction[4];
+		int32_t LengthSquared = 0;
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Direction[Channel] = static_cast<int16_t>(Candidate.Endpoints[1][Channel] - Candidate.Endpoints[0][Channel]);
+			LengthSquared += Direction[Channel] * Direction[Channel];
+		}
+
+		// Midpoints between neighbouring weights, in the same integer form as GetUniformThresholds
+		int32_t Thresholds[15];
+		for (uint32_t Step = 0; Step < 15; Step++)
+		{
+			Thresholds[Step] = LengthSquared * (Bc7Weights[Step] + Bc7Weights[Step + 1]) / 128;
+		}
+		ProjectBlock(Instructions, Texels, Candidate.Endpoints[0], Direction, Thresholds, 15, Candidate.Indices);
+
+		Candidate.Error = 0;
+		for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+		{
+			const int32_t Weight = Bc7Weights[Candidate.Indices[Texel]];
+			for (uint32_t Channel = 0; Channel < 4; Channel++)
+			{
+				const int32_t Decoded = ((64 - Weight) * Candidate.Endpoints[0][Channel] + Weight * Candidate.Endpoints[1][Channel] + 32) >> 6;
+				const int32_t Difference = Decoded - Texels[4 * Texel + Channel];
+				Candidate.Error += static_cast<uint64_t>(Difference * Difference);
+			}
+		}
+
+		if (Candidate.Error < Best.Error)
+		{
+			Best = Candidate;
+		}
+	}
+}
+
+// Endpoints along the block's principal axis, found by power iteration on the RGBA covariance
+static void GetPrincipalEndpoints(const uint8_t* Texels, float Endpoints[2][4])
+{
+	float Mean[4] = {};
+	float Minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float Maximum[4] = {};
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			const float Value = Texels[4 * Texel + Channel];
+			Mean[Channel] += Value / static_cast<float>(BlockTexelCount);
+			Minimum[Channel] = std::min(Minimum[Channel], Value);
+			Maximum[Channel] = std::max(Maximum[Channel], Value);
+		}
+	}
+
+	float Covariance[4][4] = {};
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		for (uint32_t Row = 0; Row < 4; Row++)
+		{
+			for (uint32_t Column = 0; Column < 4; Column++)
+			{
+				Covariance[Row][Column] += (Texels[4 * Texel + Row] - Mean[Row]) * (Texels[4 * Texel + Column] - Mean[Column]);
+			}
+		}
+	}
+
+	float Axis[4];
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Axis[Channel] = Maximum[Channel] - Minimum[Channel];
+	}
+	for (uint32_t Iteration = 0; Iteration < 8; Iteration++)
+	{
+		float Next[4] = {};
+		float Largest = 0.0f;
+		for (uint32_t Row = 0; Row < 4; Row++)
+		{
+			for (uint32_t Column = 0; Column < 4; Column++)
+			{
+				Next[Row] += Covariance[Row][Column] * Axis[Column];
+			}
+			Largest = std::max(Largest, std::fabs(Next[Row]));
+		}
+		if (Largest == 0.0f) break;
+
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Axis[Channel] = Next[Channel] / Largest;
+		}
+	}
+
+	float LengthSquared = 0.0f;
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		LengthSquared += Axis[Channel] * Axis[Channel];
+	}
+
+	float Lowest = 0.0f;
+	float Highest = 0.0f;
+	if (LengthSquared > 0.0f)
+	{
+		Lowest = 1e30f;
+		Highest = -1e30f;
+		for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+		{
+			float Projection = 0.0f;
+			for (uint32_t Channel = 0; Channel < 4; Channel++)
+			{
+				Projection += (Texels[4 * Texel + Channel] - Mean[Channel]) * Axis[Channel];
+			}
+			Lowest = std::min(Lowest, Projection / LengthSquared);
+			Highest = std::max(Highest, Projection / LengthSquared);
+		}
+	}
+
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Endpoints[0][Channel] = Mean[Channel] + Axis[Channel] * Lowest;
+		Endpoints[1][Channel] = Mean[Channel] + Axis[Channel] * Highest;
+	}
+}
+
+// Least squares endpoints for fixed palette indices, false when every texel uses the same weight
+static bool RefitBc7Endpoints(const uint8_t* Texels, const uint8_t* Indices, float Endpoints[2][4])
+{
+	float WeightSquared0 = 0.0f;
+	float WeightCross = 0.0f;
+	float WeightSquared1 = 0.0f;
+	float Weighted0[4] = {};
+	float Weighted1[4] = {};
+	for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+	{
+		const float Weight1 = static_cast<float>(Bc7Weights[Indices[Texel]]) / 64.0f;
+		const float Weight0 = 1.0f - Weight1;
+		WeightSquared0 += Weight0 * Weight0;
+		WeightCross += Weight0 * Weight1;
+		WeightSquared1 += Weight1 * Weight1;
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Weighted0[Channel] += Weight0 * Texels[4 * Texel + Channel];
+			Weighted1[Channel] += Weight1 * Texels[4 * Texel + Channel];
+		}
+	}
+
+	const float Determinant = WeightSquared0 * WeightSquared1 - WeightCross * WeightCross;
+	if (std::fabs(Determinant) < 1e-6f) return false;
+
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Endpoints[0][Channel] = (WeightSquared1 * Weighted0[Channel] - WeightCross * Weighted1[Channel]) / Determinant;
+		Endpoints[1][Channel] = (WeightSquared0 * Weighted1[Channel] - WeightCross * Weighted0[Channel]) / Determinant;
+	}
+	return true;
+}
+
+class BlockBitWriter
+{
+public:
+	explicit BlockBitWriter(uint8_t* Output) : Output(Output) { memset(Output, 0, 16); }
+
+	void Write(uint32_t Value, uint32_t BitCount)
+	{
+		for (uint32_t Bit = 0; Bit < BitCount; Bit++, Position++)
+		{
+			Output[Position >> 3] |= static_cast<uint8_t>(((Value >> Bit) & 1) << (Position & 7));
+		}
+	}
+
+private:
+	uint8_t* Output;
+	uint32_t Position = 0;
+};
+
+static void EncodeBc7Block(InstructionSet Instructions, const BlockCompressionOptions& Options, const uint8_t* Texels, uint8_t* Output)
+{
+	float Endpoints[2][4];
+	GetPrincipalEndpoints(Texels, Endpoints);
+
+	Bc7Candidate Best;
+	Best.Error = ~0ull;
+	FitBc7Candidate(Instructions, Texels, Endpoints, Best);
+
+	for (uint32_t Pass = 0; Pass < Options.RefinementPasses && Best.Error != 0; Pass++)
+	{
+		const uint64_t PreviousError = Best.Error;
+		if (!RefitBc7Endpoints(Texels, Best.Indices, Endpoints)) break;
+		FitBc7Candidate(Instructions, Texels, Endpoints, Best);
+		if (Best.Error == PreviousError) break;
+	}
+
+	// The first index drops its top bit, so swap the endpoints when it would be set
+	if (Best.Indices[0] & 8)
+	{
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			std::swap(Best.Endpoints[0][Channel], Best.Endpoints[1][Channel]);
+		}
+		for (uint32_t Texel = 0; Texel < BlockTexelCount; Texel++)
+		{
+			Best.Indices[Texel] = static_cast<uint8_t>(15 - Best.Indices[Texel]);
+		}
+	}
+
+	BlockBitWriter Writer(Output);
+	Writer.Write(1u << Bc7Mode, Bc7Mode + 1);
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Writer.Write(Best.Endpoints[0][Channel] >> 1, 7);
+		Writer.Write(Best.Endpoints[1][Channel] >> 1, 7);
+	}
+	Writer.Write(Best.Endpoints[0][0] & 1, 1);
+	Writer.Write(Best.Endpoints[1][0] & 1, 1);
+	Writer.Write(Best.Indices[0], 3);
+	for (uint32_t Texel = 1; Texel < BlockTexelCount; Texel++)
+	{
+		Writer.Write(Best.Indices[Texel], 4);
+	}
+}
+
+bool IsBlockCompressed(TextureFormat Format)
+{
+	return Format != TextureFormat::Rgba8;
+}
+
+uint32_t GetFormatElementBytes(TextureFormat Format)
+{
+	switch (Format)
+	{
+	case TextureFormat::Bc1:
+		return 8;
+	case TextureFormat::Bc3:
+	case TextureFormat::Bc7:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+uint64_t GetTextureLevelLayouts(TextureFormat Format, uint32_t Width, uint32_t Height, uint32_t LevelCount, uint32_t RowAlignment, uint32_t LevelAlignment, TextureLevelLayout* Levels)
+{
+	const uint32_t ElementDimension = IsBlockCompressed(Format) ? BlockDimension : 1;
+	const uint32_t ElementBytes = GetFormatElementBytes(Format);
+
+	uint64_t Size = 0;
+	for (uint32_t Level = 0; Level < LevelCount; Level++)
+	{
+		TextureLevelLayout& Layout = Levels[Level];
+		Layout.Offset = (Size + LevelAlignment - 1) & ~static_cast<uint64_t>(LevelAlignment - 1);
+		Layout.Width = std::max(Width >> Level, 1u);
+		Layout.Height = std::max(Height >> Level, 1u);
+
+		const uint32_t Columns = (Layout.Width + ElementDimension - 1) / ElementDimension;
+		const uint32_t Rows = (Layout.Height + ElementDimension - 1) / ElementDimension;
+		Layout.RowPitch = (Columns * ElementBytes + RowAlignment - 1) & ~(RowAlignment - 1);
+		Size = Layout.Offset + static_cast<uint64_t>(Layout.RowPitch) * Rows;
+	}
+	return Size;
+}
+
+void CompressBlockRows(TextureFormat Format, const uint8_t* Pixels, const TextureLevelLayout& PixelLayout, uint8_t* Blocks, uint32_t BlockRowPitch, const BlockCompressionOptions& Options, uint32_t BeginBlockRow, uint32_t EndBlockRow)
+{
+	const InstructionSet Instructions = ResolveInstructionSet(Options.MaximumInstructionSet);
+	const uint32_t BlockColumns = (PixelLayout.Width + BlockDimension - 1) / BlockDimension;
+	const uint32_t BlockBytes = GetFormatElementBytes(Format);
+
+	for (uint32_t BlockY = BeginBlockRow; BlockY < EndBlockRow; BlockY++)
+	{
+		uint8_t* BlockRow = Blocks + static_cast<size_t>(BlockY) * BlockRowPitch;
+		for (uint32_t BlockX = 0; BlockX < BlockColumns; BlockX++)
+		{
+			uint8_t Texels[4 * BlockTexelCount];
+			LoadBlock(Pixels, PixelLayout, BlockX, BlockY, Texels);
+
+			uint8_t* Output = BlockRow + BlockX * BlockBytes;
+			switch (Format)
+			{
+			case TextureFormat::Bc1:
+				EncodeColorBlock(Instructions, Texels, Output);
+				break;
+			case TextureFormat::Bc3:
+				EncodeAlphaBlock(Instructions, Texels, Output);
+				EncodeColorBlock(Instructions, Texels, Output + 8);
+				break;
+			case TextureFormat::Bc7:
+				EncodeBc7Block(Instructions, Options, Texels, Output);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void CompressTexture(TextureFormat Format, const uint8_t* Pixels, const TextureLevelLayout* PixelLevels, uint8_t* Blocks, const TextureLevelLayout* BlockLevels, uint32_t LevelCount, const BlockCompressionOptions& Options, JobSystem* Jobs)
+{
+	// A block row of a 512 texel BC7 level is already a few hundred microseconds of work
+	const uint32_t MinimumBlockRowsPerJob = 4;
+
+	for (uint32_t Level = 0; Level < LevelCount; Level++)
+	{
+		const TextureLevelLayout& PixelLayout = PixelLevels[Level];
+		const uint8_t* LevelPixels = Pixels + PixelLayout.Offset;
+		uint8_t* LevelBlocks = Blocks + BlockLevels[Level].Offset;
+		const uint32_t BlockRowPitch = BlockLevels[Level].RowPitch;
+		const uint32_t BlockRows = (PixelLayout.Height + BlockDimension - 1) / BlockDimension;
+
+		if (Jobs == nullptr || BlockRows < 2 * MinimumBlockRowsPerJob)
+		{
+			CompressBlockRows(Format, LevelPixels, PixelLayout, LevelBlocks, BlockRowPitch, Options, 0, BlockRows);
+			continue;
+		}
+
+		const uint32_t Grain = std::max(BlockRows / (4 * Jobs->GetThreadCount()), MinimumBlockRowsPerJob);
+		Jobs->ParallelFor(0, BlockRows, Grain, [&](uint32_t BeginBlockRow, uint32_t EndBlockRow)
+		{
+			CompressBlockRows(Format, LevelPixels, PixelLayout, LevelBlocks, BlockRowPitch, Options, BeginBlockRow, EndBlockRow);
+		});
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include <cstdint>
+
+class JobSystem;
+
+// Storage formats a texture can be uploaded in. Source pixels are always RGBA8, block compressed
+// formats are encoded from them on the CPU in 4x4 texel blocks.
+enum class TextureFormat
+{
+	Rgba8,
+	// 8 byte blocks, opaque color only, fast
+	Bc1,
+	// 16 byte blocks, BC1 color plus interpolated alpha, fast
+	Bc3,
+	// 16 byte blocks, single subset RGBA with 4 bit indices, slower but far fewer artifacts than BC1 and BC3
+	Bc7
+};
+
+struct BlockCompressionOptions
+{
+	// BC7 endpoint refinements, each a least squares refit against the previous indices
+	uint32_t RefinementPasses = 2;
+
+	InstructionSet MaximumInstructionSet = InstructionSet::Avx2;
+};
+
+bool IsBlockCompressed(TextureFormat Format);
+
+// Bytes per texel for uncompressed formats, per 4x4 block for compressed ones
+uint32_t GetFormatElementBytes(TextureFormat Format);
+
+// Lays out LevelCount levels back to back with every row, of texels or of blocks, padded to RowAlignment and
+// every level start padded to LevelAlignment. Returns the total size; both alignments must be powers of two.
+uint64_t GetTextureLevelLayouts(TextureFormat Format, uint32_t Width, uint32_t Height, uint32_t LevelCount, uint32_t RowAlignment, uint32_t LevelAlignment, TextureLevelLayout* Levels);
+
+// Encodes block rows [BeginBlockRow, EndBlockRow) of one RGBA8 level. Blocks overhanging the level edge
+// repeat its last row and column.
+void CompressBlockRows(TextureFormat Format, const uint8_t* Pixels, const TextureLevelLayout& PixelLayout, uint8_t* Blocks, uint32_t BlockRowPitch, const BlockCompressionOptions& Options, uint32_t BeginBlockRow, uint32_t EndBlockRow);
+
+// Encodes every level of an RGBA8 chain, both chains addressed relative to their level zero.
+// Block rows within a level are spread across the job system when one is given.
+void CompressTexture(TextureFormat Format, const uint8_t* Pixels, const TextureLevelLayout* PixelLevels, uint8_t* Blocks, const TextureLevelLayout* BlockLevels, uint32_t LevelCount, const BlockCompressionOptions& Options, JobSystem* Jobs = nullptr);
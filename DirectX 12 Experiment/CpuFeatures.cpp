@@ -0,0 +1,65 @@
+#include "CpuFeatures.h"
+
+#if CPU_FEATURES_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static CpuFeatures DetectCpuFeatures()
+{
+	CpuFeatures Features;
+#if CPU_FEATURES_X86
+	unsigned int Registers[4] = {};
+	unsigned int ExtendedRegisters[4] = {};
+#ifdef _MSC_VER
+	__cpuid(reinterpret_cast<int*>(Registers), 1);
+	__cpuidex(reinterpret_cast<int*>(ExtendedRegisters), 7, 0);
+#else
+	__get_cpuid(1, &Registers[0], &Registers[1], &Registers[2], &Registers[3]);
+	__get_cpuid_count(7, 0, &ExtendedRegisters[0], &ExtendedRegisters[1], &ExtendedRegisters[2], &ExtendedRegisters[3]);
+#endif
+
+	Features.Sse2 = (Registers[3] & (1u << 26)) != 0;
+	Features.Sse41 = (Registers[2] & (1u << 19)) != 0;
+
+	// AVX registers are only usable when the operating system saves them across context switches
+	const bool OsSavesAvxState = (Registers[2] & (1u << 27)) != 0 && (Registers[2] & (1u << 28)) != 0;
+	if (OsSavesAvxState)
+	{
+#ifdef _MSC_VER
+		const unsigned long long EnabledState = _xgetbv(0);
+#else
+		unsigned int EnabledLow, EnabledHigh;
+		__asm__ volatile("xgetbv" : "=a"(EnabledLow), "=d"(EnabledHigh) : "c"(0));
+		const unsigned long long EnabledState = (static_cast<unsigned long long>(EnabledHigh) << 32) | EnabledLow;
+#endif
+		Features.Avx2 = (EnabledState & 0x6) == 0x6 && (ExtendedRegisters[1] & (1u << 5)) != 0;
+	}
+#endif
+	return Features;
+}
+
+const CpuFeatures& GetCpuFeatures()
+{
+	static const CpuFeatures Features = DetectCpuFeatures();
+	return Features;
+}
+
+InstructionSet GetBestInstructionSet()
+{
+	const CpuFeatures& Features = GetCpuFeatures();
+	if (Features.Avx2) return InstructionSet::Avx2;
+	if (Features.Sse41) return InstructionSet::Sse41;
+	if (Features.Sse2) return InstructionSet::Sse2;
+	return InstructionSet::Scalar;
+}
+
+InstructionSet ResolveInstructionSet(InstructionSet Requested)
+{
+	const InstructionSet Best = GetBestInstructionSet();
+	return Requested < Best ? Requested : Best;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#else
+#define CPU_FEATURES_X86 0
+#endif
+
+// MSVC lets any function use any intrinsic, GCC and Clang need the instruction set enabled per function
+#if CPU_FEATURES_X86 && !defined(_MSC_VER)
+#define CPU_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CPU_TARGET_SSE41
+#define CPU_TARGET_AVX2
+#endif
+
+// Widest vector path a kernel may use, ordered so a lower value is always safe to run
+enum class InstructionSet
+{
+	Scalar,
+	Sse2,
+	Sse41,
+	Avx2
+};
+
+struct CpuFeatures
+{
+	bool Sse2 = false;
+	bool Sse41 = false;
+	bool Avx2 = false;
+};
+
+// Detected once and cached, including the operating system check for saved AVX state
+const CpuFeatures& GetCpuFeatures();
+InstructionSet GetBestInstructionSet();
+
+// Clamps a requested instruction set to what this processor supports
+InstructionSet ResolveInstructionSet(InstructionSet Requested);
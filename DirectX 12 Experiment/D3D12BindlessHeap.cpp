@@ -0,0 +1,132 @@
+#include "D3D12BindlessHeap.h"
+#include "D3D12Helpers.h"
+
+#include <algorithm>
+
+void D3D12BindlessHeap::Initialize(ID3D12Device* NewDevice, uint32_t Capacity)
+{
+	Device = NewDevice;
+	Allocator = std::make_unique<DescriptorIndexAllocator>(Capacity);
+
+	D3D12_DESCRIPTOR_HEAP_DESC HeapDescription = {};
+	HeapDescription.NumDescriptors = Capacity;
+	HeapDescription.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	HeapDescription.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(Device->CreateDescriptorHeap(&HeapDescription, IID_PPV_ARGS(&ShaderVisibleHeap)));
+
+	// Shader-visible heaps can be write-combined and are never a copy source, so views are built here first
+	HeapDescription.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(Device->CreateDescriptorHeap(&HeapDescription, IID_PPV_ARGS(&StagingHeap)));
+	DescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	Statistics = D3D12BindlessHeapStatistics();
+	Statistics.Capacity = Capacity;
+}
+
+void D3D12BindlessHeap::Dispose()
+{
+	PendingWrites.clear();
+	FlushingWrites.clear();
+	Allocator.reset();
+	StagingHeap.Reset();
+	ShaderVisibleHeap.Reset();
+	Device.Reset();
+}
+
+D3D12BindlessHeap::Handle D3D12BindlessHeap::Allocate()
+{
+	const Handle Descriptor = Allocator->Allocate();
+	if (Descriptor == DescriptorIndexAllocator::InvalidHandle) throw std::runtime_error("Bindless descriptor heap is full");
+	return Descriptor;
+}
+
+void D3D12BindlessHeap::Free(Handle Descriptor)
+{
+	if (!Allocator->Free(Descriptor)) throw std::runtime_error("Freed a stale bindless descriptor handle");
+}
+
+void D3D12BindlessHeap::CreateShaderResourceView(ID3D12Resource* Resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* Description, Handle Descriptor)
+{
+	Device->CreateShaderResourceView(Resource, Description, GetStagingHandle(Descriptor));
+	QueueWrite(Descriptor);
+}
+
+void D3D12BindlessHeap::CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC* Description, Handle Descriptor)
+{
+	Device->CreateConstantBufferView(Description, GetStagingHandle(Descriptor));
+	QueueWrite(Descriptor);
+}
+
+void D3D12BindlessHeap::CreateUnorderedAccessView(ID3D12Resource* Resource, ID3D12Resource* CounterResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* Description, Handle Descriptor)
+{
+	Device->CreateUnorderedAccessView(Resource, CounterResource, Description, GetStagingHandle(Descriptor));
+	QueueWrite(Descriptor);
+}
+
+void D3D12BindlessHeap::FlushWrites()
+{
+	{
+		std::lock_guard<std::mutex> Lock(PendingMutex);
+		if (PendingWrites.empty()) return;
+		FlushingWrites.swap(PendingWrites);
+	}
+
+	// Both heaps share one layout, so each run of neighbouring slots is a single range on either side
+	std::sort(FlushingWrites.begin(), FlushingWrites.end());
+	FlushingWrites.erase(std::unique(FlushingWrites.begin(), FlushingWrites.end()), FlushingWrites.end());
+
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> DestinationStarts;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> SourceStarts;
+	std::vector<UINT> RangeSizes;
+	const D3D12_CPU_DESCRIPTOR_HANDLE DestinationBase = ShaderVisibleHeap->GetCPUDescriptorHandleForHeapStart();
+	const D3D12_CPU_DESCRIPTOR_HANDLE SourceBase = StagingHeap->GetCPUDescriptorHandleForHeapStart();
+	for (size_t RunStart = 0; RunStart < FlushingWrites.size();)
+	{
+		size_t RunEnd = RunStart + 1;
+		while (RunEnd < FlushingWrites.size() && FlushingWrites[RunEnd] == FlushingWrites[RunEnd - 1] + 1)
+		{
+			RunEnd++;
+		}
+
+		D3D12_CPU_DESCRIPTOR_HANDLE Destination = DestinationBase;
+		D3D12_CPU_DESCRIPTOR_HANDLE Source = SourceBase;
+		Destination.ptr += static_cast<SIZE_T>(FlushingWrites[RunStart]) * DescriptorSize;
+		Source.ptr += static_cast<SIZE_T>(FlushingWrites[RunStart]) * DescriptorSize;
+		DestinationStarts.push_back(Destination);
+		SourceStarts.push_back(Source);
+		RangeSizes.push_back(static_cast<UINT>(RunEnd - RunStart));
+		RunStart = RunEnd;
+	}
+
+	const UINT RangeCount = static_cast<UINT>(RangeSizes.size());
+	Device->CopyDescriptors(RangeCount, DestinationStarts.data(), RangeSizes.data(), RangeCount, SourceStarts.data(), RangeSizes.data(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	FlushingWrites.clear();
+
+	std::lock_guard<std::mutex> Lock(PendingMutex);
+	Statistics.Flushes++;
+	Statistics.CopiedRanges += RangeCount;
+}
+
+D3D12BindlessHeapStatistics D3D12BindlessHeap::GetStatistics() const
+{
+	std::lock_guard<std::mutex> Lock(PendingMutex);
+	D3D12BindlessHeapStatistics Current = Statistics;
+	Current.AllocatedDescriptors = Allocator->GetAllocatedCount();
+	return Current;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12BindlessHeap::GetStagingHandle(Handle Descriptor)
+{
+	if (!Allocator->IsValid(Descriptor)) throw std::runtime_error("View written to a stale bindless descriptor handle");
+
+	D3D12_CPU_DESCRIPTOR_HANDLE Staging = StagingHeap->GetCPUDescriptorHandleForHeapStart();
+	Staging.ptr += static_cast<SIZE_T>(GetIndex(Descriptor)) * DescriptorSize;
+	return Staging;
+}
+
+void D3D12BindlessHeap::QueueWrite(Handle Descriptor)
+{
+	std::lock_guard<std::mutex> Lock(PendingMutex);
+	PendingWrites.push_back(GetIndex(Descriptor));
+	Statistics.ViewsWritten++;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+
+#include "DescriptorIndexAllocator.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct D3D12BindlessHeapStatistics
+{
+	uint32_t AllocatedDescriptors = 0;
+	uint32_t Capacity = 0;
+	uint64_t ViewsWritten = 0;
+	uint64_t Flushes = 0;
+	uint64_t CopiedRanges = 0;
+};
+
+// One large shader-visible CBV/SRV/UAV heap that shaders index directly, so binding never changes as the scene grows.
+// Views are written into a CPU-only staging heap, which is cheap to write, and reach the shader-visible heap in one
+// batched CopyDescriptors per flush. Slots may only be freed once the GPU no longer reads them.
+class D3D12BindlessHeap
+{
+public:
+	using Handle = DescriptorIndexAllocator::Handle;
+
+	void Initialize(ID3D12Device* Device, uint32_t Capacity);
+	void Dispose();
+
+	// Safe from any thread. Allocate throws when the heap is full.
+	Handle Allocate();
+	void Free(Handle Descriptor);
+
+	// Also safe from any thread; the view becomes visible to shaders at the next FlushWrites
+	void CreateShaderResourceView(ID3D12Resource* Resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* Description, Handle Descriptor);
+	void CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC* Description, Handle Descriptor);
+	void CreateUnorderedAccessView(ID3D12Resource* Resource, ID3D12Resource* CounterResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* Description, Handle Descriptor);
+
+	// Called by the submitting thread before command lists that may read new views are executed
+	void FlushWrites();
+
+	static uint32_t GetIndex(Handle Descriptor) { return DescriptorIndexAllocator::GetIndex(Descriptor); }
+	ID3D12DescriptorHeap* GetHeap() const { return ShaderVisibleHeap.Get(); }
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuStart() const { return ShaderVisibleHeap->GetGPUDescriptorHandleForHeapStart(); }
+	D3D12BindlessHeapStatistics GetStatistics() const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Device> Device;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> ShaderVisibleHeap;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> StagingHeap;
+	UINT DescriptorSize = 0;
+	std::unique_ptr<DescriptorIndexAllocator> Allocator;
+
+	mutable std::mutex PendingMutex;
+	std::vector<uint32_t> PendingWrites;
+	std::vector<uint32_t> FlushingWrites;
+	D3D12BindlessHeapStatistics Statistics;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetStagingHandle(Handle Descriptor);
+	void QueueWrite(Handle Descriptor);
+};
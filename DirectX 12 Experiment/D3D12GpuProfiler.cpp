@@ -0,0 +1,142 @@
+#include "D3D12GpuProfiler.h"
+#include "D3D12Helpers.h"
+
+#include <algorithm>
+
+// Matches how the steady clock turns performance counter ticks into nanoseconds, without overflowing
+static uint64_t ConvertPerformanceCounter(UINT64 Ticks, UINT64 Frequency)
+{
+	return (Ticks / Frequency) * 1000000000ull + (Ticks % Frequency) * 1000000000ull / Frequency;
+}
+
+void D3D12GpuProfiler::Initialize(ID3D12Device* Device, ID3D12CommandQueue* CommandQueue, uint32_t FrameCount, uint32_t ScopesPerFrame)
+{
+	Queue = CommandQueue;
+	MaximumScopesPerFrame = ScopesPerFrame;
+	Frames.reset(new FrameScopes[FrameCount]);
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		Frames[FrameIndex].Names.resize(MaximumScopesPerFrame);
+	}
+
+	const UINT QueryCount = FrameCount * MaximumScopesPerFrame * 2;
+	D3D12_QUERY_HEAP_DESC QueryHeapDescription = {};
+	QueryHeapDescription.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	QueryHeapDescription.Count = QueryCount;
+	ThrowIfFailed(Device->CreateQueryHeap(&QueryHeapDescription, IID_PPV_ARGS(&QueryHeap)));
+
+	D3D12_HEAP_PROPERTIES ReadbackHeapProperties;
+	ReadbackHeapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	ReadbackHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	ReadbackHeapProperties.CreationNodeMask = 1;
+	ReadbackHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	ReadbackHeapProperties.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC BufferDescription;
+	BufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	BufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+	BufferDescription.Width = static_cast<UINT64>(QueryCount) * sizeof(UINT64);
+	BufferDescription.Height = 1;
+	BufferDescription.Alignment = 0;
+	BufferDescription.DepthOrArraySize = 1;
+	BufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	BufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	BufferDescription.MipLevels = 1;
+	BufferDescription.SampleDesc.Count = 1;
+	BufferDescription.SampleDesc.Quality = 0;
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&ReadbackHeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&BufferDescription,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&ReadbackBuffer)
+	));
+
+	ThrowIfFailed(Queue->GetTimestampFrequency(&TimestampFrequency));
+	QueryPerformanceFrequency(&PerformanceFrequency);
+}
+
+void D3D12GpuProfiler::Dispose()
+{
+	ReadbackBuffer.Reset();
+	QueryHeap.Reset();
+	Frames.reset();
+	Queue = nullptr;
+}
+
+uint32_t D3D12GpuProfiler::BeginScope(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex, const char* Name)
+{
+	FrameScopes& Frame = Frames[FrameIndex];
+	const uint32_t Scope = Frame.ScopeCount.fetch_add(1, std::memory_order_relaxed);
+	if (Scope >= MaximumScopesPerFrame) return InvalidScope;
+
+	Frame.Names[Scope] = Name;
+	CommandList->EndQuery(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(FrameIndex, Scope));
+	return Scope;
+}
+
+void D3D12GpuProfiler::EndScope(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex, uint32_t Scope)
+{
+	if (Scope == InvalidScope) return;
+
+	CommandList->EndQuery(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(FrameIndex, Scope) + 1);
+}
+
+void D3D12GpuProfiler::ResolveFrame(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex)
+{
+	FrameScopes& Frame = Frames[FrameIndex];
+	const uint32_t ScopeCount = std::min(Frame.ScopeCount.load(std::memory_order_relaxed), MaximumScopesPerFrame);
+	if (ScopeCount == 0) return;
+
+	const UINT FirstQuery = GetQueryIndex(FrameIndex, 0);
+	CommandList->ResolveQueryData(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, FirstQuery, ScopeCount * 2, ReadbackBuffer.Get(), static_cast<UINT64>(FirstQuery) * sizeof(UINT64));
+	Frame.Resolved = true;
+}
+
+void D3D12GpuProfiler::CollectFrame(uint32_t FrameIndex, Profiler& Target)
+{
+	FrameScopes& Frame = Frames[FrameIndex];
+	const uint32_t ScopeCount = std::min(Frame.ScopeCount.load(std::memory_order_relaxed), MaximumScopesPerFrame);
+	if (Frame.Resolved && ScopeCount != 0)
+	{
+		// Calibrated at every collection, the two clocks drift apart over a long session
+		UINT64 GpuCalibration, CpuCalibration;
+		ThrowIfFailed(Queue->GetClockCalibration(&GpuCalibration, &CpuCalibration));
+		const uint64_t CalibrationTime = ConvertPerformanceCounter(CpuCalibration, static_cast<UINT64>(PerformanceFrequency.QuadPart));
+		const double NanosecondsPerTick = 1e9 / static_cast<double>(TimestampFrequency);
+		auto ConvertTimestamp = [&](UINT64 Timestamp)
+		{
+			return CalibrationTime + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(Timestamp - GpuCalibration)) * NanosecondsPerTick);
+		};
+
+		const UINT FirstQuery = GetQueryIndex(FrameIndex, 0);
+		const D3D12_RANGE ReadRange = { FirstQuery * sizeof(UINT64), (FirstQuery + ScopeCount * 2) * sizeof(UINT64) };
+		UINT64* Timestamps = nullptr;
+		ThrowIfFailed(ReadbackBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&Timestamps)));
+		UINT64 FrameBegin = ~0ull;
+		UINT64 FrameEnd = 0;
+		for (uint32_t Scope = 0; Scope < ScopeCount; Scope++)
+		{
+			const UINT64 Begin = Timestamps[GetQueryIndex(FrameIndex, Scope)];
+			const UINT64 End = Timestamps[GetQueryIndex(FrameIndex, Scope) + 1];
+			if (End < Begin) continue;
+
+			Target.RecordGpuEvent(Frame.Names[Scope], ConvertTimestamp(Begin), ConvertTimestamp(End));
+			FrameBegin = std::min(FrameBegin, Begin);
+			FrameEnd = std::max(FrameEnd, End);
+		}
+		const D3D12_RANGE WrittenRange = {};
+		ReadbackBuffer->Unmap(0, &WrittenRange);
+
+		if (FrameBegin <= FrameEnd)
+		{
+			Target.RecordGpuEvent("Frame", ConvertTimestamp(FrameBegin), ConvertTimestamp(FrameEnd));
+			Target.RecordGpuFrame(ConvertTimestamp(FrameBegin), ConvertTimestamp(FrameEnd));
+		}
+	}
+
+	Frame.ScopeCount.store(0, std::memory_order_relaxed);
+	Frame.Resolved = false;
+}
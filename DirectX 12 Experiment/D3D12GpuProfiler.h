@@ -0,0 +1,51 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+
+#include "Profiler.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Timestamp queries around GPU work, one region of the query heap per frame in flight. A frame's queries are
+// resolved into a readback buffer by its last command list and read once the frame's fence has completed, so
+// results arrive a frame or more late on the CPU timeline of the Profiler.
+class D3D12GpuProfiler
+{
+public:
+	static const uint32_t InvalidScope = ~0u;
+
+	void Initialize(ID3D12Device* Device, ID3D12CommandQueue* CommandQueue, uint32_t FrameCount, uint32_t ScopesPerFrame);
+	void Dispose();
+
+	// May be called from several recording threads at once; a frame out of scopes records nothing more.
+	// Every scope has to be ended before the frame is resolved.
+	uint32_t BeginScope(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex, const char* Name);
+	void EndScope(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex, uint32_t Scope);
+
+	// Recorded on the frame's last command list after every EndScope of the frame
+	void ResolveFrame(ID3D12GraphicsCommandList* CommandList, uint32_t FrameIndex);
+	// Only once the GPU has finished the frame, before FrameIndex is recorded again. The GPU frame time spans the
+	// first to the last timestamp of the frame.
+	void CollectFrame(uint32_t FrameIndex, Profiler& Target);
+
+private:
+	struct FrameScopes
+	{
+		std::atomic<uint32_t> ScopeCount{ 0 };
+		std::vector<const char*> Names;
+		bool Resolved = false;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> QueryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> ReadbackBuffer;
+	ID3D12CommandQueue* Queue = nullptr;
+	uint32_t MaximumScopesPerFrame = 0;
+	std::unique_ptr<FrameScopes[]> Frames;
+
+	UINT64 TimestampFrequency = 0;
+	LARGE_INTEGER PerformanceFrequency = {};
+
+	UINT GetQueryIndex(uint32_t FrameIndex, uint32_t Scope) const { return (FrameIndex * MaximumScopesPerFrame + Scope) * 2; }
+};
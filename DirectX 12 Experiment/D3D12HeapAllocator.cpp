@@ -0,0 +1,282 @@
+#include "D3D12HeapAllocator.h"
+#include "D3D12Helpers.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+static D3D12_HEAP_FLAGS GetHeapFlags(D3D12HeapTier Tier)
+{
+	switch (Tier)
+	{
+	case D3D12HeapTier::Buffers: return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	case D3D12HeapTier::NonRenderTargetTextures: return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	default: return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	}
+}
+
+static UINT64 GetHeapAlignment(D3D12HeapTier Tier)
+{
+	// Only render targets and depth buffers can be multisampled and need the larger placement alignment
+	return Tier == D3D12HeapTier::RenderTargetTextures ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+}
+
+void D3D12HeapAllocator::Initialize(ID3D12Device* OwningDevice, UINT64 StandardHeapSize)
+{
+	Device = OwningDevice;
+	HeapSize = (StandardHeapSize + D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+}
+
+void D3D12HeapAllocator::Dispose()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (TierState& State : Tiers)
+	{
+		State.Heaps.clear();
+		State.UsedBytes = 0;
+	}
+	Device.Reset();
+}
+
+ComPtr<ID3D12Resource> D3D12HeapAllocator::CreatePlacedResource(
+	const D3D12_RESOURCE_DESC& Description,
+	D3D12_RESOURCE_STATES InitialState,
+	const D3D12_CLEAR_VALUE* ClearValue,
+	D3D12HeapAllocation& Allocation)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO AllocationInfo = Device->GetResourceAllocationInfo(0, 1, &Description);
+	if (AllocationInfo.SizeInBytes == UINT64_MAX) throw std::runtime_error("Invalid resource description");
+
+	Allocation = Allocate(GetTier(Description), AllocationInfo.SizeInBytes, AllocationInfo.Alignment);
+
+	ComPtr<ID3D12Resource> Resource;
+	const HRESULT Result = Device->CreatePlacedResource(Allocation.Heap, Allocation.Offset, &Description, InitialState, ClearValue, IID_PPV_ARGS(&Resource));
+	if (FAILED(Result))
+	{
+		Free(Allocation);
+		ThrowIfFailed(Result);
+	}
+	return Resource;
+}
+
+D3D12HeapAllocation D3D12HeapAllocator::Allocate(D3D12HeapTier Tier, UINT64 Size, UINT64 Alignment)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	TierState& State = Tiers[static_cast<uint32_t>(Tier)];
+	Alignment = std::max(Alignment, static_cast<UINT64>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+
+	D3D12HeapAllocation Allocation;
+	if (Size + Alignment - D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT > HeapSize)
+	{
+		// Sized for the same search the heap's allocator makes, which leaves room to align the offset
+		const UINT64 SearchSize = Size + Alignment - D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		const UINT64 DedicatedSize = (SearchSize + GetHeapAlignment(Tier) - 1) & ~(GetHeapAlignment(Tier) - 1);
+		const uint32_t HeapIndex = CreateHeap(Tier, DedicatedSize, true);
+		if (!TryAllocateFromHeap(Tier, HeapIndex, Size, Alignment, Allocation)) throw std::runtime_error("Dedicated heap allocation failed");
+		return Allocation;
+	}
+
+	for (uint32_t HeapIndex = 0; HeapIndex < State.Heaps.size(); HeapIndex++)
+	{
+		if (State.Heaps[HeapIndex].IsDedicated) continue;
+		if (TryAllocateFromHeap(Tier, HeapIndex, Size, Alignment, Allocation)) return Allocation;
+	}
+
+	const uint32_t HeapIndex = CreateHeap(Tier, HeapSize, false);
+	if (!TryAllocateFromHeap(Tier, HeapIndex, Size, Alignment, Allocation)) throw std::runtime_error("Heap allocation failed");
+	return Allocation;
+}
+
+void D3D12HeapAllocator::Free(D3D12HeapAllocation& Allocation)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	FreeLocked(Allocation);
+}
+
+uint32_t D3D12HeapAllocator::Defragment(D3D12HeapTier Tier, uint32_t MaximumMoves, const MoveCallback& Callback)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	TierState& State = Tiers[static_cast<uint32_t>(Tier)];
+
+	struct Candidate
+	{
+		uint32_t HeapIndex;
+		TlsfAllocator::Handle Handle;
+		UINT64 Offset;
+		UINT64 Size;
+	};
+
+	// Walk from the last heap and highest offset so emptied space accumulates at the end of the tier
+	std::vector<Candidate> Candidates;
+	for (uint32_t HeapIndex = static_cast<uint32_t>(State.Heaps.size()); HeapIndex-- > 0;)
+	{
+		const Heap& Source = State.Heaps[HeapIndex];
+		if (Source.Resource == nullptr || Source.IsDedicated) continue;
+
+		const size_t FirstCandidate = Candidates.size();
+		Source.Allocator->ForEachAllocation([&](TlsfAllocator::Handle Handle, uint64_t Offset, uint64_t Size)
+		{
+			Candidates.push_back({ HeapIndex, Handle, Offset, Size });
+		});
+		std::reverse(Candidates.begin() + FirstCandidate, Candidates.end());
+	}
+
+	uint32_t MoveCount = 0;
+	for (const Candidate& Source : Candidates)
+	{
+		if (MoveCount == MaximumMoves) break;
+
+		D3D12HeapAllocation From;
+		From.Tier = Tier;
+		From.HeapIndex = Source.HeapIndex;
+		From.Handle = Source.Handle;
+		From.Heap = State.Heaps[Source.HeapIndex].Resource.Get();
+		From.Offset = Source.Offset;
+		From.Size = Source.Size;
+		From.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		while (From.Alignment < GetHeapAlignment(Tier) && (From.Offset & (From.Alignment * 2 - 1)) == 0) From.Alignment *= 2;
+
+		// Only heaps up to the source heap are searched, and a move must strictly lower the address
+		D3D12HeapAllocation To;
+		bool Moved = false;
+		for (uint32_t HeapIndex = 0; HeapIndex <= Source.HeapIndex && !Moved; HeapIndex++)
+		{
+			if (State.Heaps[HeapIndex].Resource == nullptr || State.Heaps[HeapIndex].IsDedicated) continue;
+			if (!TryAllocateFromHeap(Tier, HeapIndex, Source.Size, From.Alignment, To)) continue;
+
+			if (HeapIndex < Source.HeapIndex || To.Offset < Source.Offset)
+			{
+				Moved = true;
+			}
+			else
+			{
+				FreeLocked(To);
+			}
+		}
+		if (!Moved) continue;
+
+		Callback(From, To);
+		MoveCount++;
+	}
+	return MoveCount;
+}
+
+void D3D12HeapAllocator::TrimEmptyHeaps()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (TierState& State : Tiers)
+	{
+		for (size_t HeapIndex = 1; HeapIndex < State.Heaps.size(); HeapIndex++)
+		{
+			Heap& Candidate = State.Heaps[HeapIndex];
+			if (Candidate.Resource != nullptr && Candidate.Allocator->GetStatistics().AllocationCount == 0)
+			{
+				Candidate.Resource.Reset();
+				Candidate.Allocator.reset();
+			}
+		}
+	}
+}
+
+D3D12HeapTierStatistics D3D12HeapAllocator::GetStatistics(D3D12HeapTier Tier) const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	const TierState& State = Tiers[static_cast<uint32_t>(Tier)];
+
+	D3D12HeapTierStatistics Statistics;
+	Statistics.UsedBytes = State.UsedBytes;
+	Statistics.PeakUsedBytes = State.PeakUsedBytes;
+
+	UINT64 FreeBytes = 0;
+	for (const Heap& Candidate : State.Heaps)
+	{
+		if (Candidate.Resource == nullptr) continue;
+
+		const TlsfStatistics HeapStatistics = Candidate.Allocator->GetStatistics();
+		Statistics.HeapCount++;
+		Statistics.AllocationCount += HeapStatistics.AllocationCount;
+		Statistics.ReservedBytes += HeapStatistics.Capacity;
+		Statistics.LargestFreeBlock = std::max(Statistics.LargestFreeBlock, HeapStatistics.LargestFreeBlock);
+		FreeBytes += HeapStatistics.FreeBytes;
+	}
+	Statistics.Fragmentation = FreeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(Statistics.LargestFreeBlock) / static_cast<double>(FreeBytes);
+	return Statistics;
+}
+
+D3D12HeapTier D3D12HeapAllocator::GetTier(const D3D12_RESOURCE_DESC& Description)
+{
+	if (Description.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) return D3D12HeapTier::Buffers;
+	if ((Description.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0) return D3D12HeapTier::RenderTargetTextures;
+	return D3D12HeapTier::NonRenderTargetTextures;
+}
+
+bool D3D12HeapAllocator::TryAllocateFromHeap(D3D12HeapTier Tier, uint32_t HeapIndex, UINT64 Size, UINT64 Alignment, D3D12HeapAllocation& Allocation)
+{
+	TierState& State = Tiers[static_cast<uint32_t>(Tier)];
+	Heap& Target = State.Heaps[HeapIndex];
+	if (Target.Resource == nullptr) return false;
+
+	const TlsfAllocator::Handle Handle = Target.Allocator->Allocate(Size, Alignment);
+	if (Handle == TlsfAllocator::InvalidHandle) return false;
+
+	Allocation.Tier = Tier;
+	Allocation.HeapIndex = HeapIndex;
+	Allocation.Handle = Handle;
+	Allocation.Heap = Target.Resource.Get();
+	Allocation.Offset = Target.Allocator->GetOffset(Handle);
+	Allocation.Size = Target.Allocator->GetSize(Handle);
+	Allocation.Alignment = Alignment;
+
+	State.UsedBytes += Allocation.Size;
+	State.PeakUsedBytes = std::max(State.PeakUsedBytes, State.UsedBytes);
+	return true;
+}
+
+uint32_t D3D12HeapAllocator::CreateHeap(D3D12HeapTier Tier, UINT64 Size, bool IsDedicated)
+{
+	TierState& State = Tiers[static_cast<uint32_t>(Tier)];
+
+	D3D12_HEAP_DESC HeapDescription = {};
+	HeapDescription.SizeInBytes = Size;
+	HeapDescription.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	HeapDescription.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapDescription.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	HeapDescription.Properties.CreationNodeMask = 1;
+	HeapDescription.Properties.VisibleNodeMask = 1;
+	HeapDescription.Alignment = GetHeapAlignment(Tier);
+	HeapDescription.Flags = GetHeapFlags(Tier);
+
+	Heap NewHeap;
+	ThrowIfFailed(Device->CreateHeap(&HeapDescription, IID_PPV_ARGS(&NewHeap.Resource)));
+	NewHeap.Allocator = std::make_unique<TlsfAllocator>(Size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	NewHeap.IsDedicated = IsDedicated;
+
+	// Reuse slots of trimmed heaps so live allocations keep their heap indices
+	for (uint32_t HeapIndex = 0; HeapIndex < State.Heaps.size(); HeapIndex++)
+	{
+		if (State.Heaps[HeapIndex].Resource == nullptr)
+		{
+			State.Heaps[HeapIndex] = std::move(NewHeap);
+			return HeapIndex;
+		}
+	}
+	State.Heaps.push_back(std::move(NewHeap));
+	return static_cast<uint32_t>(State.Heaps.size() - 1);
+}
+
+void D3D12HeapAllocator::FreeLocked(D3D12HeapAllocation& Allocation)
+{
+	if (!Allocation.IsValid()) return;
+
+	TierState& State = Tiers[static_cast<uint32_t>(Allocation.Tier)];
+	Heap& Owner = State.Heaps[Allocation.HeapIndex];
+	Owner.Allocator->Free(Allocation.Handle);
+	State.UsedBytes -= Allocation.Size;
+
+	if (Owner.IsDedicated)
+	{
+		Owner.Resource.Reset();
+		Owner.Allocator.reset();
+	}
+	Allocation = D3D12HeapAllocation();
+}
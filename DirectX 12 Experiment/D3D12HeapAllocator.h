@@ -0,0 +1,100 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+
+#include "TlsfAllocator.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Resource heap tier 1 hardware cannot mix these in a single heap, so each gets its own set of heaps
+enum class D3D12HeapTier : uint32_t
+{
+	Buffers,
+	NonRenderTargetTextures,
+	RenderTargetTextures,
+	Count
+};
+
+struct D3D12HeapAllocation
+{
+	D3D12HeapTier Tier = D3D12HeapTier::Buffers;
+	uint32_t HeapIndex = ~0u;
+	TlsfAllocator::Handle Handle = TlsfAllocator::InvalidHandle;
+	ID3D12Heap* Heap = nullptr;
+	UINT64 Offset = 0;
+	UINT64 Size = 0;
+	UINT64 Alignment = 0;
+
+	bool IsValid() const { return Heap != nullptr; }
+};
+
+struct D3D12HeapTierStatistics
+{
+	uint32_t HeapCount = 0;
+	uint32_t AllocationCount = 0;
+	UINT64 ReservedBytes = 0;
+	UINT64 UsedBytes = 0;
+	UINT64 PeakUsedBytes = 0;
+	UINT64 LargestFreeBlock = 0;
+	double Fragmentation = 0.0;
+};
+
+// Sub-allocates placed resources out of large default heaps with a TLSF allocator per heap.
+// Requests larger than the standard heap size get a dedicated heap that is released once empty.
+class D3D12HeapAllocator
+{
+public:
+	// From is still alive when the callback runs; the caller copies its contents into a resource
+	// placed at To and frees From once the GPU has finished with it
+	using MoveCallback = std::function<void(const D3D12HeapAllocation& From, const D3D12HeapAllocation& To)>;
+
+	void Initialize(ID3D12Device* Device, UINT64 HeapSize);
+	void Dispose();
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreatePlacedResource(
+		const D3D12_RESOURCE_DESC& Description,
+		D3D12_RESOURCE_STATES InitialState,
+		const D3D12_CLEAR_VALUE* ClearValue,
+		D3D12HeapAllocation& Allocation
+	);
+
+	D3D12HeapAllocation Allocate(D3D12HeapTier Tier, UINT64 Size, UINT64 Alignment);
+	void Free(D3D12HeapAllocation& Allocation);
+
+	// Relocates up to MaximumMoves allocations from the back of the tier into earlier free space
+	// and returns how many moves were handed to the callback
+	uint32_t Defragment(D3D12HeapTier Tier, uint32_t MaximumMoves, const MoveCallback& Callback);
+
+	// Releases standard heaps that no longer hold any allocations, keeping the first heap of each tier
+	void TrimEmptyHeaps();
+
+	D3D12HeapTierStatistics GetStatistics(D3D12HeapTier Tier) const;
+	static D3D12HeapTier GetTier(const D3D12_RESOURCE_DESC& Description);
+
+private:
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> Resource;
+		std::unique_ptr<TlsfAllocator> Allocator;
+		bool IsDedicated = false;
+	};
+
+	struct TierState
+	{
+		std::vector<Heap> Heaps;
+		UINT64 UsedBytes = 0;
+		UINT64 PeakUsedBytes = 0;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> Device;
+	UINT64 HeapSize = 0;
+	TierState Tiers[static_cast<uint32_t>(D3D12HeapTier::Count)];
+	mutable std::mutex Mutex;
+
+	bool TryAllocateFromHeap(D3D12HeapTier Tier, uint32_t HeapIndex, UINT64 Size, UINT64 Alignment, D3D12HeapAllocation& Allocation);
+	uint32_t CreateHeap(D3D12HeapTier Tier, UINT64 Size, bool IsDedicated);
+	void FreeLocked(D3D12HeapAllocation& Allocation);
+};
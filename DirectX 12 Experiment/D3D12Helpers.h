@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Windows.h>
+#include <stdexcept>
+#include <string>
+
+inline void ThrowIfFailed(HRESULT Result)
+{
+	if (FAILED(Result)) throw std::runtime_error("HRESULT Failed");
+}
+
+inline std::string ConvertToUtf8(const std::wstring& Text)
+{
+	const int Length = WideCharToMultiByte(CP_UTF8, 0, Text.c_str(), static_cast<int>(Text.size()), nullptr, 0, nullptr, nullptr);
+	std::string Converted(static_cast<size_t>(Length), '\0');
+	WideCharToMultiByte(CP_UTF8, 0, Text.c_str(), static_cast<int>(Text.size()), &Converted[0], Length, nullptr, nullptr);
+	return Converted;
+}
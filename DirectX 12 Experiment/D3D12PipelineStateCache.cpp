@@ -0,0 +1,313 @@
+#include "D3D12PipelineStateCache.h"
+#include "D3D12Helpers.h"
+#include "Hash.h"
+
+#include <chrono>
+
+using Microsoft::WRL::ComPtr;
+
+static const uint32_t ShaderStageCount = 5;
+static D3D12_SHADER_BYTECODE D3D12_GRAPHICS_PIPELINE_STATE_DESC::* const ShaderStages[ShaderStageCount] =
+{
+	&D3D12_GRAPHICS_PIPELINE_STATE_DESC::VS,
+	&D3D12_GRAPHICS_PIPELINE_STATE_DESC::PS,
+	&D3D12_GRAPHICS_PIPELINE_STATE_DESC::DS,
+	&D3D12_GRAPHICS_PIPELINE_STATE_DESC::HS,
+	&D3D12_GRAPHICS_PIPELINE_STATE_DESC::GS,
+};
+
+static double GetMillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+// Clears state the pipeline never reads, so descriptions that only differ there share a key and a library entry
+static void Normalize(D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description)
+{
+	if (Description.StreamOutput.NumEntries != 0) throw std::runtime_error("Stream output pipelines are not cached");
+	if (Description.NumRenderTargets > D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT) throw std::runtime_error("Too many render targets");
+
+	Description.StreamOutput = {};
+	Description.CachedPSO = {};
+
+	const UINT BlendTargetCount = Description.BlendState.IndependentBlendEnable ? Description.NumRenderTargets : 1;
+	for (UINT Index = BlendTargetCount; Index < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; Index++)
+	{
+		Description.BlendState.RenderTarget[Index] = {};
+	}
+	for (UINT Index = Description.NumRenderTargets; Index < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; Index++)
+	{
+		Description.RTVFormats[Index] = DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+// Blend and depth stencil descriptions have padding, so they are hashed field by field
+static uint64_t HashBlend(const D3D12_BLEND_DESC& Blend, uint64_t Hash)
+{
+	Hash = HashValue(Blend.AlphaToCoverageEnable, Hash);
+	Hash = HashValue(Blend.IndependentBlendEnable, Hash);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& Target : Blend.RenderTarget)
+	{
+		Hash = HashValue(Target.BlendEnable, Hash);
+		Hash = HashValue(Target.LogicOpEnable, Hash);
+		Hash = HashValue(Target.SrcBlend, Hash);
+		Hash = HashValue(Target.DestBlend, Hash);
+		Hash = HashValue(Target.BlendOp, Hash);
+		Hash = HashValue(Target.SrcBlendAlpha, Hash);
+		Hash = HashValue(Target.DestBlendAlpha, Hash);
+		Hash = HashValue(Target.BlendOpAlpha, Hash);
+		Hash = HashValue(Target.LogicOp, Hash);
+		Hash = HashValue(Target.RenderTargetWriteMask, Hash);
+	}
+	return Hash;
+}
+
+static uint64_t HashDepthStencil(const D3D12_DEPTH_STENCIL_DESC& DepthStencil, uint64_t Hash)
+{
+	Hash = HashValue(DepthStencil.DepthEnable, Hash);
+	Hash = HashValue(DepthStencil.DepthWriteMask, Hash);
+	Hash = HashValue(DepthStencil.DepthFunc, Hash);
+	Hash = HashValue(DepthStencil.StencilEnable, Hash);
+	Hash = HashValue(DepthStencil.StencilReadMask, Hash);
+	Hash = HashValue(DepthStencil.StencilWriteMask, Hash);
+	Hash = HashValue(DepthStencil.FrontFace, Hash);
+	return HashValue(DepthStencil.BackFace, Hash);
+}
+
+static uint64_t HashDescription(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description, uint64_t RootSignatureHash)
+{
+	uint64_t Hash = HashValue(RootSignatureHash, FnvOffsetBasis);
+	for (uint32_t Stage = 0; Stage < ShaderStageCount; Stage++)
+	{
+		const D3D12_SHADER_BYTECODE& Shader = Description.*ShaderStages[Stage];
+		Hash = HashValue(static_cast<uint64_t>(Shader.BytecodeLength), Hash);
+		Hash = HashBytes(Shader.pShaderBytecode, Shader.BytecodeLength, Hash);
+	}
+
+	Hash = HashBlend(Description.BlendState, Hash);
+	Hash = HashValue(Description.SampleMask, Hash);
+	Hash = HashValue(Description.RasterizerState, Hash);
+	Hash = HashDepthStencil(Description.DepthStencilState, Hash);
+
+	Hash = HashValue(Description.InputLayout.NumElements, Hash);
+	for (UINT Index = 0; Index < Description.InputLayout.NumElements; Index++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& Element = Description.InputLayout.pInputElementDescs[Index];
+		Hash = HashString(Element.SemanticName, Hash);
+		Hash = HashValue(Element.SemanticIndex, Hash);
+		Hash = HashValue(Element.Format, Hash);
+		Hash = HashValue(Element.InputSlot, Hash);
+		Hash = HashValue(Element.AlignedByteOffset, Hash);
+		Hash = HashValue(Element.InputSlotClass, Hash);
+		Hash = HashValue(Element.InstanceDataStepRate, Hash);
+	}
+
+	Hash = HashValue(Description.IBStripCutValue, Hash);
+	Hash = HashValue(Description.PrimitiveTopologyType, Hash);
+	Hash = HashValue(Description.NumRenderTargets, Hash);
+	Hash = HashValue(Description.RTVFormats, Hash);
+	Hash = HashValue(Description.DSVFormat, Hash);
+	Hash = HashValue(Description.SampleDesc, Hash);
+	Hash = HashValue(Description.NodeMask, Hash);
+	return HashValue(Description.Flags, Hash);
+}
+
+void D3D12PipelineStateCache::Initialize(ID3D12Device1* NewDevice, const std::string& NewLibraryPath, JobSystem* NewJobs)
+{
+	Device = NewDevice;
+	LibraryPath = NewLibraryPath;
+	Jobs = NewJobs;
+
+	// A library written by another driver version or adapter is rejected, as is a damaged one; it then starts over
+	if (LibraryFile.Open(LibraryPath) && LibraryFile.GetSize() != 0)
+	{
+		if (FAILED(Device->CreatePipelineLibrary(LibraryFile.GetData(), LibraryFile.GetSize(), IID_PPV_ARGS(&Library))))
+		{
+			Library.Reset();
+		}
+	}
+
+	if (!Library)
+	{
+		LibraryFile.Close();
+
+		// Drivers without library support still get deduplication and background creation
+		const HRESULT Result = Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&Library));
+		if (Result == DXGI_ERROR_UNSUPPORTED) return;
+		ThrowIfFailed(Result);
+	}
+}
+
+void D3D12PipelineStateCache::Dispose()
+{
+	if (Jobs != nullptr)
+	{
+		for (auto& Entry : Pipelines)
+		{
+			Jobs->Wait(Entry.second->Completion);
+		}
+	}
+	Pipelines.clear();
+
+	std::vector<uint8_t> Serialized;
+	if (Library && LibraryDirty)
+	{
+		Serialized.resize(Library->GetSerializedSize());
+		if (FAILED(Library->Serialize(Serialized.data(), Serialized.size())))
+		{
+			Serialized.clear();
+		}
+	}
+
+	// The mapping has to be closed before the file under it can be replaced
+	Library.Reset();
+	LibraryFile.Close();
+	LibraryDirty = false;
+
+	// A failed write only costs the next run its pipeline compiles
+	if (!Serialized.empty())
+	{
+		WriteFileAtomically(LibraryPath, Serialized.data(), Serialized.size());
+	}
+
+	RootSignatureHashes.clear();
+	Device.Reset();
+}
+
+void D3D12PipelineStateCache::AddRootSignature(ID3D12RootSignature* RootSignature, const void* SerializedData, size_t SerializedSize)
+{
+	RootSignatureHashes[RootSignature] = HashBytes(SerializedData, SerializedSize);
+}
+
+uint64_t D3D12PipelineStateCache::GetKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description) const
+{
+	auto RootSignatureHash = RootSignatureHashes.find(Description.pRootSignature);
+	if (RootSignatureHash == RootSignatureHashes.end()) throw std::runtime_error("Pipeline uses a root signature the cache does not know");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC Normalized = Description;
+	Normalize(Normalized);
+	return HashDescription(Normalized, RootSignatureHash->second);
+}
+
+uint64_t D3D12PipelineStateCache::Precompile(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description)
+{
+	const uint64_t Key = GetKey(Description);
+	std::unique_lock<std::mutex> PipelinesLock(PipelinesMutex);
+	const bool Known = Pipelines.find(Key) != Pipelines.end();
+	{
+		std::lock_guard<std::mutex> Lock(StatisticsMutex);
+		Statistics.Requests++;
+		if (Known) Statistics.Hits++;
+	}
+	if (Known) return Key;
+
+	std::unique_ptr<Pipeline> Entry = std::make_unique<Pipeline>();
+	Entry->Description = Description;
+	Normalize(Entry->Description);
+	Entry->RootSignature = Description.pRootSignature;
+
+	for (uint32_t Stage = 0; Stage < ShaderStageCount; Stage++)
+	{
+		D3D12_SHADER_BYTECODE& Shader = Entry->Description.*ShaderStages[Stage];
+		const uint8_t* Bytecode = static_cast<const uint8_t*>(Shader.pShaderBytecode);
+		Entry->Bytecode[Stage].assign(Bytecode, Bytecode + Shader.BytecodeLength);
+		Shader.pShaderBytecode = Entry->Bytecode[Stage].empty() ? nullptr : Entry->Bytecode[Stage].data();
+	}
+
+	// Names are reserved up front so the strings never move and their pointers stay valid
+	const D3D12_INPUT_LAYOUT_DESC& InputLayout = Description.InputLayout;
+	Entry->SemanticNames.reserve(InputLayout.NumElements);
+	Entry->InputElements.assign(InputLayout.pInputElementDescs, InputLayout.pInputElementDescs + InputLayout.NumElements);
+	for (D3D12_INPUT_ELEMENT_DESC& Element : Entry->InputElements)
+	{
+		Entry->SemanticNames.emplace_back(Element.SemanticName);
+		Element.SemanticName = Entry->SemanticNames.back().c_str();
+	}
+	Entry->Description.InputLayout.pInputElementDescs = Entry->InputElements.empty() ? nullptr : Entry->InputElements.data();
+
+	Pipeline& Created = *Entry;
+	Pipelines.emplace(Key, std::move(Entry));
+	PipelinesLock.unlock();
+
+	if (Jobs != nullptr)
+	{
+		Jobs->Schedule([this, Key, &Created] { CreatePipeline(Key, Created); }, &Created.Completion);
+	}
+	else
+	{
+		CreatePipeline(Key, Created);
+	}
+	return Key;
+}
+
+ID3D12PipelineState* D3D12PipelineStateCache::GetPipelineState(uint64_t Key)
+{
+	std::unique_lock<std::mutex> PipelinesLock(PipelinesMutex);
+	auto Found = Pipelines.find(Key);
+	if (Found == Pipelines.end()) throw std::runtime_error("Pipeline was never precompiled");
+
+	// Entries are never removed before dispose, so the reference outlives the lock
+	Pipeline& Entry = *Found->second;
+	PipelinesLock.unlock();
+
+	if (!Entry.Completion.IsDone())
+	{
+		const auto WaitStart = std::chrono::steady_clock::now();
+		Jobs->Wait(Entry.Completion);
+		std::lock_guard<std::mutex> Lock(StatisticsMutex);
+		Statistics.WaitMilliseconds += GetMillisecondsSince(WaitStart);
+	}
+
+	// Creation runs on a worker, so its failure is reported here on the caller's thread
+	ThrowIfFailed(Entry.Result);
+	return Entry.PipelineState.Get();
+}
+
+D3D12PipelineStateStatistics D3D12PipelineStateCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> Lock(StatisticsMutex);
+	return Statistics;
+}
+
+void D3D12PipelineStateCache::CreatePipeline(uint64_t Key, Pipeline& Entry)
+{
+	const auto CreateStart = std::chrono::steady_clock::now();
+
+	WCHAR Name[32];
+	swprintf_s(Name, L"Pipeline%016llX", static_cast<unsigned long long>(Key));
+
+	bool Loaded = false;
+	if (Library)
+	{
+		std::lock_guard<std::mutex> Lock(LibraryMutex);
+		Loaded = SUCCEEDED(Library->LoadGraphicsPipeline(Name, &Entry.Description, IID_PPV_ARGS(&Entry.PipelineState)));
+	}
+
+	if (!Loaded)
+	{
+		Entry.Result = Device->CreateGraphicsPipelineState(&Entry.Description, IID_PPV_ARGS(&Entry.PipelineState));
+
+		// Storing fails when the name is taken by an entry that no longer loads; the pipeline is still usable
+		if (SUCCEEDED(Entry.Result) && Library)
+		{
+			std::lock_guard<std::mutex> Lock(LibraryMutex);
+			if (SUCCEEDED(Library->StorePipeline(Name, Entry.PipelineState.Get())))
+			{
+				LibraryDirty = true;
+			}
+		}
+	}
+
+	const double Milliseconds = GetMillisecondsSince(CreateStart);
+	std::lock_guard<std::mutex> Lock(StatisticsMutex);
+	if (Loaded)
+	{
+		Statistics.LibraryLoads++;
+	}
+	else
+	{
+		Statistics.Creations++;
+	}
+	Statistics.CreateMilliseconds += Milliseconds;
+	if (Milliseconds > Statistics.MaximumCreateMilliseconds) Statistics.MaximumCreateMilliseconds = Milliseconds;
+}
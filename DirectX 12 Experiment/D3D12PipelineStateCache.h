@@ -0,0 +1,95 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct D3D12PipelineStateStatistics
+{
+	uint32_t Requests = 0;
+
+	// Requests answered by a pipeline already known this run
+	uint32_t Hits = 0;
+
+	// Pipelines loaded from the serialized library instead of being compiled by the driver
+	uint32_t LibraryLoads = 0;
+	uint32_t Creations = 0;
+	double CreateMilliseconds = 0.0;
+	double MaximumCreateMilliseconds = 0.0;
+
+	// Time callers spent blocked on pipelines that were still being created
+	double WaitMilliseconds = 0.0;
+};
+
+// Deduplicates graphics pipelines by a hash of their normalized description and creates new ones on the job
+// system. Created pipelines are stored in a D3D12 pipeline library that is written beside the executable on
+// dispose and mapped on the next run, so the driver only compiles a pipeline once per machine and driver version.
+// Precompile and GetPipelineState may be called from any thread; root signatures are added before either.
+class D3D12PipelineStateCache
+{
+public:
+	D3D12PipelineStateCache() = default;
+	D3D12PipelineStateCache(const D3D12PipelineStateCache&) = delete;
+	D3D12PipelineStateCache& operator=(const D3D12PipelineStateCache&) = delete;
+
+	void Initialize(ID3D12Device1* Device, const std::string& LibraryPath, JobSystem* Jobs);
+
+	// Waits for pending creations and writes the library if anything new was stored
+	void Dispose();
+
+	// Root signatures are keyed by their serialized blob, since the pointer changes between runs
+	void AddRootSignature(ID3D12RootSignature* RootSignature, const void* SerializedData, size_t SerializedSize);
+
+	// Starts creating the pipeline unless an identical one is already known and returns its key. Everything the
+	// description points to is copied, so the caller's bytecode can go away right after. Stream output is not supported.
+	uint64_t Precompile(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description);
+
+	// Blocks until the pipeline exists and throws if its creation failed
+	ID3D12PipelineState* GetPipelineState(uint64_t Key);
+	ID3D12PipelineState* GetPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description) { return GetPipelineState(Precompile(Description)); }
+
+	D3D12PipelineStateStatistics GetStatistics() const;
+
+private:
+	struct Pipeline
+	{
+		// Owned copies of everything the description points to
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Description = {};
+		std::vector<uint8_t> Bytecode[5];
+		std::vector<D3D12_INPUT_ELEMENT_DESC> InputElements;
+		std::vector<std::string> SemanticNames;
+		Microsoft::WRL::ComPtr<ID3D12RootSignature> RootSignature;
+
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineState;
+		HRESULT Result = S_OK;
+		JobCounter Completion;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device1> Device;
+	JobSystem* Jobs = nullptr;
+	std::string LibraryPath;
+
+	// The library reads pipelines straight out of the mapping, so it stays open as long as the library lives
+	MappedFile LibraryFile;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> Library;
+	std::mutex LibraryMutex;
+	bool LibraryDirty = false;
+
+	std::unordered_map<ID3D12RootSignature*, uint64_t> RootSignatureHashes;
+	std::mutex PipelinesMutex;
+	std::unordered_map<uint64_t, std::unique_ptr<Pipeline>> Pipelines;
+
+	mutable std::mutex StatisticsMutex;
+	D3D12PipelineStateStatistics Statistics;
+
+	uint64_t GetKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Description) const;
+	void CreatePipeline(uint64_t Key, Pipeline& Entry);
+};
@@ -0,0 +1,1659 @@
+#include <d3dcompiler.h>
+
+#include "D3D12RenderDevice.h"
+#include "D3D12Helpers.h"
+#include "D3D12ShaderCompiler.h"
+#include "DynamicResolution.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+// The indirect command signature sets the first instance root constant and then draws
+static_assert(sizeof(InstancedDrawArguments) == sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "Indirect arguments must match the command signature");
+
+static D3D12_RESOURCE_STATES GetD3D12States(RenderGraphState State)
+{
+	static const D3D12_RESOURCE_STATES StateBits[] =
+	{
+		D3D12_RESOURCE_STATE_PRESENT,
+		D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_DEPTH_READ,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_COPY_SOURCE,
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		D3D12_RESOURCE_STATE_INDEX_BUFFER
+	};
+
+	D3D12_RESOURCE_STATES States = D3D12_RESOURCE_STATE_COMMON;
+	for (UINT Bit = 0; Bit < _countof(StateBits); Bit++)
+	{
+		if ((static_cast<uint32_t>(State) >> Bit) & 1)
+		{
+			States |= StateBits[Bit];
+		}
+	}
+	return States;
+}
+
+// Graph resource handles index Resources; a batch becomes a single ResourceBarrier call
+static void RecordGraphBarriers(ID3D12GraphicsCommandList* CommandList, ID3D12Resource* const* Resources, const RenderGraphBarrier* Barriers, uint32_t BarrierCount)
+{
+	std::vector<D3D12_RESOURCE_BARRIER> NativeBarriers(BarrierCount);
+	for (uint32_t Index = 0; Index < BarrierCount; Index++)
+	{
+		const RenderGraphBarrier& Barrier = Barriers[Index];
+		D3D12_RESOURCE_BARRIER& NativeBarrier = NativeBarriers[Index];
+		NativeBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		if (Barrier.Split == RenderGraphBarrierSplit::Begin)
+		{
+			NativeBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+		}
+		else if (Barrier.Split == RenderGraphBarrierSplit::End)
+		{
+			NativeBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		}
+
+		switch (Barrier.Type)
+		{
+		case RenderGraphBarrierType::Aliasing:
+			NativeBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			NativeBarrier.Aliasing.pResourceBefore = Barrier.ResourceBefore == RenderGraph::InvalidResource ? nullptr : Resources[Barrier.ResourceBefore];
+			NativeBarrier.Aliasing.pResourceAfter = Resources[Barrier.Resource];
+			break;
+		case RenderGraphBarrierType::UnorderedAccess:
+			NativeBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			NativeBarrier.UAV.pResource = Resources[Barrier.Resource];
+			break;
+		default:
+			NativeBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			NativeBarrier.Transition.pResource = Resources[Barrier.Resource];
+			NativeBarrier.Transition.StateBefore = GetD3D12States(Barrier.StateBefore);
+			NativeBarrier.Transition.StateAfter = GetD3D12States(Barrier.StateAfter);
+			NativeBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			break;
+		}
+	}
+	CommandList->ResourceBarrier(BarrierCount, NativeBarriers.data());
+}
+
+static void RecordStateBarriers(ID3D12GraphicsCommandList* CommandList, const ResourceStateBarrier* Barriers, uint32_t BarrierCount)
+{
+	std::vector<D3D12_RESOURCE_BARRIER> NativeBarriers(BarrierCount);
+	for (uint32_t Index = 0; Index < BarrierCount; Index++)
+	{
+		const ResourceStateBarrier& Barrier = Barriers[Index];
+		D3D12_RESOURCE_BARRIER& NativeBarrier = NativeBarriers[Index];
+		NativeBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		if (Barrier.IsUnorderedAccess)
+		{
+			NativeBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			NativeBarrier.UAV.pResource = static_cast<ID3D12Resource*>(Barrier.Native);
+			continue;
+		}
+
+		NativeBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		NativeBarrier.Transition.pResource = static_cast<ID3D12Resource*>(Barrier.Native);
+		NativeBarrier.Transition.StateBefore = GetD3D12States(Barrier.StateBefore);
+		NativeBarrier.Transition.StateAfter = GetD3D12States(Barrier.StateAfter);
+		NativeBarrier.Transition.Subresource = Barrier.Subresource;
+	}
+	CommandList->ResourceBarrier(BarrierCount, NativeBarriers.data());
+}
+
+std::unique_ptr<RenderDevice> CreateD3D12RenderDevice()
+{
+	return std::make_unique<D3D12RenderDevice>();
+}
+
+D3D12CommandList::D3D12CommandList(D3D12RenderDevice* OwningDevice) :
+	Device(OwningDevice)
+{
+	for (UINT FrameIndex = 0; FrameIndex < Device->FrameCount; FrameIndex++)
+	{
+		ThrowIfFailed(Device->Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&CommandAllocator[FrameIndex])));
+	}
+
+	ThrowIfFailed(Device->Device->CreateCommandList(
+		0,
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		CommandAllocator[Device->CurrentFrameIndex].Get(),
+		Device->PipelineState.Get(),
+		IID_PPV_ARGS(&CommandList)
+	));
+	ThrowIfFailed(CommandList->Close());
+}
+
+void D3D12CommandList::Reset()
+{
+	ID3D12CommandAllocator* FrameAllocator = CommandAllocator[Device->CurrentFrameIndex].Get();
+	ThrowIfFailed(FrameAllocator->Reset());
+	ThrowIfFailed(CommandList->Reset(FrameAllocator, Device->PipelineState.Get()));
+	if (Device->Profiling != nullptr)
+	{
+		GpuScope = Device->GpuProfiler.BeginScope(CommandList.Get(), Device->CurrentFrameIndex, "Command list");
+	}
+
+	CommandList->SetGraphicsRootSignature(Device->RootSignature.Get());
+	ID3D12DescriptorHeap* DescriptorHeaps[] = { Device->BindlessHeap.GetHeap() };
+	CommandList->SetDescriptorHeaps(_countof(DescriptorHeaps), DescriptorHeaps);
+	CommandList->SetGraphicsRootDescriptorTable(1, Device->BindlessHeap.GetGpuStart());
+	CommandList->SetGraphicsRoot32BitConstant(0, Device->GetActiveTextureIndex(), 0);
+	CommandList->SetGraphicsRoot32BitConstant(2, 0, 0);
+	CommandList->SetGraphicsRoot32BitConstant(2, Device->UploadedInstanceCount, 1);
+	CommandList->SetGraphicsRoot32BitConstants(2, 1, &Device->AspectRatio, 2);
+	CommandList->SetGraphicsRootShaderResourceView(3, Device->InstanceBuffers[Device->CurrentFrameIndex].Resource->GetGPUVirtualAddress());
+
+	CommandList->RSSetViewports(1, &Device->Viewport);
+	CommandList->RSSetScissorRects(1, &Device->ScissorRectangle);
+
+	auto RenderTargetHandle = Device->GetCurrentRenderTargetHandle();
+	CommandList->OMSetRenderTargets(1, &RenderTargetHandle, FALSE, nullptr);
+	CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	CommandList->IASetVertexBuffers(0, 1, &Device->VertexBufferView);
+	CommandList->IASetIndexBuffer(&Device->IndexBufferView);
+}
+
+void D3D12CommandList::ClearRenderTarget(const float Color[4])
+{
+	// A scaled scene only covers part of its target, the rest is never sampled
+	CommandList->ClearRenderTargetView(Device->GetCurrentRenderTargetHandle(), Color, 1, &Device->ScissorRectangle);
+}
+
+void D3D12CommandList::DrawIndexedInstanced(uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
+{
+	CommandList->SetGraphicsRoot32BitConstant(2, StartInstanceLocation, 0);
+	CommandList->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void D3D12CommandList::DrawInstancedBatches(const InstancedDrawArguments* Draws, uint32_t DrawCount)
+{
+	for (uint32_t DrawIndex = 0; DrawIndex < DrawCount; DrawIndex++)
+	{
+		const InstancedDrawArguments& Draw = Draws[DrawIndex];
+		DrawIndexedInstanced(Draw.IndexCountPerInstance, Draw.InstanceCount, Draw.StartIndexLocation, Draw.BaseVertexLocation, Draw.FirstInstance);
+	}
+}
+
+void D3D12CommandList::ExecuteIndirect(uint32_t FirstDraw, uint32_t DrawCount)
+{
+	if (static_cast<uint64_t>(FirstDraw) + DrawCount > Device->UploadedDrawCount) throw std::runtime_error("Indirect draws outside the uploaded arguments");
+
+	const UINT64 ArgumentOffset = Device->IndirectArgumentOffset + static_cast<UINT64>(FirstDraw) * sizeof(InstancedDrawArguments);
+	CommandList->ExecuteIndirect(Device->DrawCommandSignature.Get(), DrawCount, Device->InstanceBuffers[Device->CurrentFrameIndex].Resource.Get(), ArgumentOffset, nullptr, 0);
+}
+
+void D3D12CommandList::Close()
+{
+	if (Device->Profiling != nullptr)
+	{
+		Device->GpuProfiler.EndScope(CommandList.Get(), Device->CurrentFrameIndex, GpuScope);
+	}
+	ThrowIfFailed(CommandList->Close());
+}
+
+void D3D12TimelineFence::Initialize(ID3D12Fence* QueueFence)
+{
+	Fence = QueueFence;
+	CompletionEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	InterruptEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (CompletionEvent == nullptr || InterruptEvent == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+void D3D12TimelineFence::Dispose()
+{
+	CloseHandle(CompletionEvent);
+	CloseHandle(InterruptEvent);
+	CompletionEvent = nullptr;
+	InterruptEvent = nullptr;
+}
+
+uint64_t D3D12TimelineFence::GetCompletedValue()
+{
+	return Fence->GetCompletedValue();
+}
+
+void D3D12TimelineFence::WaitForValue(uint64_t Value)
+{
+	if (Fence->GetCompletedValue() >= Value) return;
+
+	// An interrupted wait leaves its completion request behind, which at worst makes a later wait return early;
+	// the timeline looks at the completed value again after every wait
+	ThrowIfFailed(Fence->SetEventOnCompletion(Value, CompletionEvent));
+	const HANDLE Events[2] = { CompletionEvent, InterruptEvent };
+	WaitForMultipleObjects(2, Events, FALSE, INFINITE);
+}
+
+void D3D12TimelineFence::Interrupt()
+{
+	SetEvent(InterruptEvent);
+}
+
+void D3D12FrameFence::Initialize(FenceTimeline* FrameTimeline)
+{
+	Timeline = FrameTimeline;
+}
+
+uint64_t D3D12FrameFence::GetCompletedValue()
+{
+	return Timeline->GetCompletedValue();
+}
+
+void D3D12FrameFence::Wait(uint64_t Value)
+{
+	Timeline->Wait(Value);
+}
+
+void D3D12RenderDevice::Initialize(const RenderDeviceDescription& Description)
+{
+	Window = static_cast<HWND>(Description.WindowHandle);
+	PathToAssets = Description.PathToAssets;
+	Jobs = Description.Jobs;
+	TextureMipFilter = Description.TextureMipFilter;
+	GeometryFormat = Description.GeometryFormat;
+	Profiling = Description.Profiling;
+	Width = Description.Width;
+	Height = Description.Height;
+	FrameCount = Description.FrameCount;
+	if (FrameCount < 2 || FrameCount > MaximumFrameCount) throw std::runtime_error("Unsupported frame count");
+
+	UpdateRenderArea();
+
+	UINT DxgiFactoryFlags = 0;
+#ifdef _DEBUG
+	{
+		ComPtr<ID3D12Debug1> DebugController;
+		if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&DebugController))))
+		{
+			DebugController->EnableDebugLayer();
+			// DebugController->SetEnableGPUBasedValidation(TRUE);
+			DxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+		}
+	}
+#endif
+
+	ComPtr<IDXGIFactory5> Factory;
+	ThrowIfFailed(CreateDXGIFactory2(DxgiFactoryFlags, IID_PPV_ARGS(&Factory)));
+
+	// Create Device
+	{
+		ComPtr<IDXGIAdapter4> ChosenAdapter;
+
+		SIZE_T MaximumVideoMemory = 0;
+		ComPtr<IDXGIAdapter1> Adapter;
+		DXGI_ADAPTER_DESC1 AdapterDescription;
+		for (UINT AdapterIndex = 0; Factory->EnumAdapters1(AdapterIndex, &Adapter) != DXGI_ERROR_NOT_FOUND; AdapterIndex++)
+		{
+			Adapter->GetDesc1(&AdapterDescription);
+			if ((AdapterDescription.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0) continue;
+
+			if (SUCCEEDED(D3D12CreateDevice(Adapter.Get(), D3D_FEATURE_LEVEL_12_1, _uuidof(ID3D12Device3), nullptr)) &&
+				AdapterDescription.DedicatedVideoMemory > MaximumVideoMemory)
+			{
+				MaximumVideoMemory = AdapterDescription.DedicatedVideoMemory;
+				Adapter.As(&ChosenAdapter);
+			}
+		}
+
+		ThrowIfFailed(D3D12CreateDevice(ChosenAdapter.Get(), D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(&Device)));
+	}
+
+	// Create Command Queue
+	{
+		D3D12_COMMAND_QUEUE_DESC QueueDescription = {};
+		QueueDescription.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		QueueDescription.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+		ThrowIfFailed(Device->CreateCommandQueue(&QueueDescription, IID_PPV_ARGS(&CommandQueue)));
+		if (Profiling != nullptr)
+		{
+			GpuProfiler.Initialize(Device.Get(), CommandQueue.Get(), FrameCount, MaximumGpuScopesPerFrame);
+		}
+	}
+
+	// Create Swap Chain
+	{
+		DXGI_SWAP_CHAIN_DESC1 SwapChainDescription = {};
+		SwapChainDescription.BufferCount = FrameCount;
+		SwapChainDescription.Width = Width;
+		SwapChainDescription.Height = Height;
+		SwapChainDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		SwapChainDescription.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		SwapChainDescription.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+		SwapChainDescription.SampleDesc.Count = 1;
+
+		// Tearing is only requested at present time by the uncapped modes, but the swap chain has to allow it up front
+		BOOL AllowTearing = FALSE;
+		TearingSupported = SUCCEEDED(Factory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &AllowTearing, sizeof(AllowTearing))) && AllowTearing;
+		SwapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT | (TearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+		SwapChainDescription.Flags = SwapChainFlags;
+
+		ComPtr<IDXGISwapChain1> TemporarySwapChain;
+		ThrowIfFailed(Factory->CreateSwapChainForHwnd(
+			CommandQueue.Get(),
+			Window,
+			&SwapChainDescription,
+			nullptr,
+			nullptr,
+			&TemporarySwapChain
+		));
+
+		ThrowIfFailed(Factory->MakeWindowAssociation(Window, DXGI_MWA_NO_ALT_ENTER));
+		ThrowIfFailed(TemporarySwapChain.As(&SwapChain));
+		CurrentFrameIndex = SwapChain->GetCurrentBackBufferIndex();
+		FrameLatencyWaitableObject = SwapChain->GetFrameLatencyWaitableObject();
+	}
+
+	// Create Descriptor Heaps
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC RenderTargetHeapDescription = {};
+		// One view per back buffer followed by the scene target's
+		RenderTargetHeapDescription.NumDescriptors = FrameCount + 1;
+		RenderTargetHeapDescription.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+		RenderTargetHeapDescription.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		ThrowIfFailed(Device->CreateDescriptorHeap(&RenderTargetHeapDescription, IID_PPV_ARGS(&RenderTargetHeap)));
+		RenderTargetDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+		// Unbounded descriptor tables over the whole heap need resource binding tier 2
+		D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+		ThrowIfFailed(Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options)));
+		if (Options.ResourceBindingTier < D3D12_RESOURCE_BINDING_TIER_2) throw std::runtime_error("Bindless textures need resource binding tier 2");
+		BindlessHeap.Initialize(Device.Get(), BindlessDescriptorCapacity);
+
+		// Sample transparent black through a null view until a texture is bound
+		D3D12_SHADER_RESOURCE_VIEW_DESC NullShaderResourceDescription = {};
+		NullShaderResourceDescription.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		NullShaderResourceDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		NullShaderResourceDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		NullShaderResourceDescription.Texture2D.MipLevels = 1;
+		NullTextureDescriptor = BindlessHeap.Allocate();
+		BindlessHeap.CreateShaderResourceView(nullptr, &NullShaderResourceDescription, NullTextureDescriptor);
+	}
+
+	CreateBackBufferViews();
+
+	// Create Root Signature
+	{
+		D3D12_FEATURE_DATA_ROOT_SIGNATURE FeatureData = {};
+		FeatureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+		// Every texture in the bindless heap is visible at t0 in space1; the draw picks one by the index in b0.
+		// Slots that no draw reads may hold stale or no views, so the descriptors are volatile.
+		D3D12_DESCRIPTOR_RANGE1 DescriptorRange;
+		DescriptorRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		DescriptorRange.NumDescriptors = UINT_MAX;
+		DescriptorRange.BaseShaderRegister = 0;
+		DescriptorRange.RegisterSpace = 1;
+		DescriptorRange.OffsetInDescriptorsFromTableStart = 0;
+		DescriptorRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
+
+		// The upscale pass reads the scene target's index and its UV scale from the same constants
+		D3D12_ROOT_PARAMETER1 RootParameters[4];
+		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		RootParameters[0].Constants.ShaderRegister = 0;
+		RootParameters[0].Constants.RegisterSpace = 0;
+		RootParameters[0].Constants.Num32BitValues = 3;
+		RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		RootParameters[1].DescriptorTable.pDescriptorRanges = &DescriptorRange;
+		RootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
+
+		// The vertex shader finds its instance as the first instance in b1 plus SV_InstanceID, the second value is the
+		// length of each stream in the instance buffer at t0 and the third the output's aspect ratio
+		RootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		RootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		RootParameters[2].Constants.ShaderRegister = 1;
+		RootParameters[2].Constants.RegisterSpace = 0;
+		RootParameters[2].Constants.Num32BitValues = 3;
+		RootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		RootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		RootParameters[3].Descriptor.ShaderRegister = 0;
+		RootParameters[3].Descriptor.RegisterSpace = 0;
+		RootParameters[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+
+		D3D12_STATIC_SAMPLER_DESC Samplers[2] = {};
+		D3D12_STATIC_SAMPLER_DESC& Sampler = Samplers[0];
+		// Trilinear minification over the generated mips, magnification stays crisp
+		Sampler.Filter = D3D12_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
+		Sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Sampler.MipLODBias = 0;
+		Sampler.MaxAnisotropy = 0;
+		Sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+		Sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+		Sampler.MinLOD = 0.0f;
+		Sampler.MaxLOD = D3D12_FLOAT32_MAX;
+		Sampler.ShaderRegister = 0;
+		Sampler.RegisterSpace = 0;
+		Sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		// Bilinear and clamped for the upscale, which never reads outside the scene target
+		Samplers[1] = Sampler;
+		Samplers[1].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		Samplers[1].AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Samplers[1].AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Samplers[1].AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Samplers[1].ShaderRegister = 1;
+
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDescription;
+		RootSignatureDescription.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		RootSignatureDescription.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+		RootSignatureDescription.Desc_1_1.pParameters = RootParameters;
+		RootSignatureDescription.Desc_1_1.NumParameters = _countof(RootParameters);
+		RootSignatureDescription.Desc_1_1.pStaticSamplers = Samplers;
+		RootSignatureDescription.Desc_1_1.NumStaticSamplers = _countof(Samplers);
+
+		ComPtr<ID3DBlob> Signature;
+		ComPtr<ID3DBlob> Error;
+		ThrowIfFailed(D3D12SerializeVersionedRootSignature(&RootSignatureDescription, &Signature, &Error));
+		ThrowIfFailed(Device->CreateRootSignature(0, Signature->GetBufferPointer(), Signature->GetBufferSize(), IID_PPV_ARGS(&RootSignature)));
+
+		PipelineStates.Initialize(Device.Get(), ConvertToUtf8(PathToAssets) + "PipelineLibrary.bin", Jobs);
+		PipelineStates.AddRootSignature(RootSignature.Get(), Signature->GetBufferPointer(), Signature->GetBufferSize());
+
+		// Changes the first instance constant between draws, so the signature is tied to the root signature
+		D3D12_INDIRECT_ARGUMENT_DESC IndirectArguments[2] = {};
+		IndirectArguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		IndirectArguments[0].Constant.RootParameterIndex = 2;
+		IndirectArguments[0].Constant.DestOffsetIn32BitValues = 0;
+		IndirectArguments[0].Constant.Num32BitValuesToSet = 1;
+		IndirectArguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC CommandSignatureDescription = {};
+		CommandSignatureDescription.ByteStride = sizeof(InstancedDrawArguments);
+		CommandSignatureDescription.NumArgumentDescs = _countof(IndirectArguments);
+		CommandSignatureDescription.pArgumentDescs = IndirectArguments;
+		ThrowIfFailed(Device->CreateCommandSignature(&CommandSignatureDescription, RootSignature.Get(), IID_PPV_ARGS(&DrawCommandSignature)));
+	}
+
+	// Create Pipeline State
+	{
+		UINT CompilerFlags = 0;
+
+#ifdef _DEBUG
+		CompilerFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+		// Bytecode comes from the pack beside the executable, only shaders whose sources changed are compiled
+		const std::string ShaderDirectory = ConvertToUtf8(PathToAssets);
+		Shaders = std::make_unique<ShaderCache>(ShaderDirectory + "ShaderCache.pack", GetD3DCompilerIdentity(), CompileShaderWithD3DCompiler);
+		Shaders->Load();
+
+		// The scene's shaders come first, followed by the upscale pass's
+		std::vector<ShaderCompileRequest> ShaderRequests(4);
+		ShaderRequests[0].Path = ShaderDirectory + "SimpleVertexShader.hlsl";
+		ShaderRequests[0].EntryPoint = "Main";
+		ShaderRequests[0].Profile = "vs_5_0";
+		ShaderRequests[0].Flags = CompilerFlags;
+		ShaderRequests[1].Path = ShaderDirectory + "SimplePixelShader.hlsl";
+		ShaderRequests[1].EntryPoint = "Main";
+		ShaderRequests[1].Profile = "ps_5_1";
+		ShaderRequests[1].Flags = CompilerFlags;
+		ShaderRequests[2].Path = ShaderDirectory + "UpscaleVertexShader.hlsl";
+		ShaderRequests[2].EntryPoint = "Main";
+		ShaderRequests[2].Profile = "vs_5_0";
+		ShaderRequests[2].Flags = CompilerFlags;
+		ShaderRequests[3].Path = ShaderDirectory + "UpscalePixelShader.hlsl";
+		ShaderRequests[3].EntryPoint = "Main";
+		ShaderRequests[3].Profile = "ps_5_1";
+		ShaderRequests[3].Flags = CompilerFlags;
+		const std::vector<ShaderBytecode> Bytecode = Shaders->Resolve(ShaderRequests.data(), static_cast<uint32_t>(ShaderRequests.size()), Jobs);
+
+		// A fullscreen triangle generated from the vertex id, so the upscale pass has no vertex input
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC UpscalePipelineStateDescription = DescribePipelineState(Bytecode[2], Bytecode[3]);
+		UpscalePipelineStateDescription.InputLayout.pInputElementDescs = nullptr;
+		UpscalePipelineStateDescription.InputLayout.NumElements = 0;
+
+		// The cache copies the bytecode, so the shader pack can be remapped while the pipeline is still being created
+		const uint64_t PipelineStateKey = PipelineStates.Precompile(DescribePipelineState(Bytecode[0], Bytecode[1]));
+		const uint64_t UpscalePipelineStateKey = PipelineStates.Precompile(UpscalePipelineStateDescription);
+		Shaders->Save();
+		PipelineState = PipelineStates.GetPipelineState(PipelineStateKey);
+		UpscalePipelineState = PipelineStates.GetPipelineState(UpscalePipelineStateKey);
+
+		const ShaderCacheStatistics& ShaderStatistics = Shaders->GetStatistics();
+		WCHAR Report[256];
+		swprintf_s(Report, L"Shader cache: %u hits, %u compiled, %.2f ms validating, %.2f ms compiling\n", ShaderStatistics.Hits, ShaderStatistics.Misses, ShaderStatistics.ValidateMilliseconds, ShaderStatistics.CompileMilliseconds);
+		OutputDebugStringW(Report);
+
+		const D3D12PipelineStateStatistics PipelineStatistics = PipelineStates.GetStatistics();
+		swprintf_s(Report, L"Pipeline cache: %u requests, %u hits, %u from library, %u created, %.2f ms creating (%.2f ms worst), %.2f ms waiting\n", PipelineStatistics.Requests, PipelineStatistics.Hits, PipelineStatistics.LibraryLoads, PipelineStatistics.Creations, PipelineStatistics.CreateMilliseconds, PipelineStatistics.MaximumCreateMilliseconds, PipelineStatistics.WaitMilliseconds);
+		OutputDebugStringW(Report);
+
+		// From here on the shader cache belongs to the reloader thread, which hands rebuilt pipelines to AdvanceFrame
+		if (Description.WatchShaders)
+		{
+			ShaderReloader = std::make_unique<ShaderHotReloader>(ShaderDirectory, *Shaders, Jobs, [](const std::string& Messages)
+			{
+				OutputDebugStringA(("Shader reload failed: " + Messages + "\n").c_str());
+			});
+
+			// Only the scene's shaders are watched, the upscale pass keeps the pipeline it started with
+			ShaderProgram Program;
+			Program.Requests.assign(ShaderRequests.begin(), ShaderRequests.begin() + 2);
+			Program.Rebuild = [this](const std::vector<ShaderBytecode>& Reloaded)
+			{
+				ID3D12PipelineState* Rebuilt = PipelineStates.GetPipelineState(DescribePipelineState(Reloaded[0], Reloaded[1]));
+				std::lock_guard<std::mutex> Lock(ReloadedPipelineStateMutex);
+				ReloadedPipelineState = Rebuilt;
+				PipelineStateReloaded.store(true, std::memory_order_release);
+			};
+			ShaderReloader->AddProgram(std::move(Program));
+			ShaderReloader->Start();
+		}
+	}
+
+	//Create Command Lists and Allocators
+	{
+		for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+		{
+			ThrowIfFailed(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&FrameCommandAllocator[FrameIndex])));
+		}
+
+		ThrowIfFailed(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, FrameCommandAllocator[CurrentFrameIndex].Get(), nullptr, IID_PPV_ARGS(&BeginFrameCommandList)));
+		ThrowIfFailed(BeginFrameCommandList->Close());
+		ThrowIfFailed(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, FrameCommandAllocator[CurrentFrameIndex].Get(), nullptr, IID_PPV_ARGS(&EndFrameCommandList)));
+		ThrowIfFailed(EndFrameCommandList->Close());
+
+		ThrowIfFailed(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&UploadCommandAllocator)));
+		ThrowIfFailed(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, UploadCommandAllocator.Get(), nullptr, IID_PPV_ARGS(&StateResolveCommandList)));
+		ThrowIfFailed(StateResolveCommandList->Close());
+		ThrowIfFailed(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, UploadCommandAllocator.Get(), nullptr, IID_PPV_ARGS(&UploadCommandList)));
+	}
+
+	HeapAllocator.Initialize(Device.Get(), ResourceHeapSize);
+	UploadRing.Initialize(Device.Get(), UploadRingCapacity);
+
+	// Every frame binds its instance buffer even before instances are uploaded, so none may be missing
+	for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		CreateInstanceBuffer(InstanceBuffers[FrameIndex], MinimumInstanceBufferCapacity);
+	}
+
+	// Create Fence
+	{
+		ThrowIfFailed(Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence)));
+		FenceValue = 0;
+		CopyFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (CopyFenceEvent == nullptr)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+
+		TimelineFence.Initialize(Fence.Get());
+		FrameTimeline = std::make_unique<FenceTimeline>(TimelineFence);
+		PacerFence.Initialize(FrameTimeline.get());
+		SetFramePacing(Description.Pacing);
+	}
+
+	// Create Streaming Copy Queue
+	{
+		D3D12_COMMAND_QUEUE_DESC QueueDescription = {};
+		QueueDescription.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		QueueDescription.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		ThrowIfFailed(Device->CreateCommandQueue(&QueueDescription, IID_PPV_ARGS(&CopyCommandQueue)));
+
+		CopyCommandAllocator FirstAllocator;
+		FirstAllocator.FenceValue = 0;
+		ThrowIfFailed(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&FirstAllocator.Allocator)));
+		ThrowIfFailed(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, FirstAllocator.Allocator.Get(), nullptr, IID_PPV_ARGS(&CopyCommandList)));
+		ThrowIfFailed(CopyCommandList->Close());
+		CopyCommandAllocators.push_back(FirstAllocator);
+
+		ThrowIfFailed(Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&CopyFence)));
+		CopyFenceValue = 0;
+
+		D3D12_HEAP_PROPERTIES UploadHeapProperties;
+		UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+		UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		UploadHeapProperties.CreationNodeMask = 1;
+		UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		UploadHeapProperties.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC StagingBufferDescription;
+		StagingBufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		StagingBufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+		StagingBufferDescription.Width = StreamingStagingCapacity;
+		StagingBufferDescription.Height = 1;
+		StagingBufferDescription.Alignment = 0;
+		StagingBufferDescription.DepthOrArraySize = 1;
+		StagingBufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+		StagingBufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		StagingBufferDescription.MipLevels = 1;
+		StagingBufferDescription.SampleDesc.Count = 1;
+		StagingBufferDescription.SampleDesc.Quality = 0;
+
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&UploadHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&StagingBufferDescription,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&StreamingStagingBuffer)
+		));
+
+		D3D12_RANGE ReadRange = {};
+		ThrowIfFailed(StreamingStagingBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&StreamingStagingData)));
+		StreamingStagingAllocator = std::make_unique<TlsfAllocator>(StreamingStagingCapacity, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	}
+}
+
+void D3D12RenderDevice::Dispose()
+{
+	// Stopped first, since a reload in progress still creates pipelines through the cache
+	ShaderReloader.reset();
+	Shaders.reset();
+
+	WaitForGpu();
+	if (CopyFence->GetCompletedValue() < CopyFenceValue)
+	{
+		ThrowIfFailed(CopyFence->SetEventOnCompletion(CopyFenceValue, CopyFenceEvent));
+		WaitForSingleObject(CopyFenceEvent, INFINITE);
+	}
+	// Everything retired is complete now, its releases only have to finish before the heaps go away
+	FrameTimeline->Flush();
+
+	ReloadedPipelineState.Reset();
+	PipelineState.Reset();
+	UpscalePipelineState.Reset();
+	PipelineStates.Dispose();
+
+	// Placed resources must be released before the heaps backing them
+	VertexBuffer.Reset();
+	HeapAllocator.Free(VertexBufferAllocation);
+	IndexBuffer.Reset();
+	HeapAllocator.Free(IndexBufferAllocation);
+	Texture.Reset();
+	HeapAllocator.Free(TextureAllocation);
+	for (auto& Stream : Streams)
+	{
+		Stream.second.Resource.Reset();
+		HeapAllocator.Free(Stream.second.Allocation);
+	}
+	Streams.clear();
+	SceneTarget.Reset();
+	HeapAllocator.Free(SceneTargetAllocation);
+	HeapAllocator.Dispose();
+
+	StreamingStagingBuffer->Unmap(0, nullptr);
+	StreamingStagingData = nullptr;
+	StreamingStagingBuffer.Reset();
+	StreamingStagingAllocator.reset();
+
+	for (InstanceUploadBuffer& Buffer : InstanceBuffers)
+	{
+		Buffer.Resource.Reset();
+		Buffer.Data = nullptr;
+		Buffer.Capacity = 0;
+	}
+	DrawCommandSignature.Reset();
+
+	UploadRing.Dispose();
+	BindlessHeap.Dispose();
+	GpuProfiler.Dispose();
+
+	const FenceTimelineStatistics TimelineStatistics = FrameTimeline->GetStatistics();
+	wchar_t Report[160];
+	swprintf_s(Report, L"Fence timeline: %llu of %llu waits stalled for %.1f ms, %llu deferred releases avoided %.1f ms\n",
+		TimelineStatistics.StalledWaits, TimelineStatistics.Waits, std::chrono::duration<double, std::milli>(TimelineStatistics.StallTime).count(),
+		TimelineStatistics.CallbacksRun, std::chrono::duration<double, std::milli>(TimelineStatistics.AvoidedStallTime).count());
+	OutputDebugStringW(Report);
+	FrameTimeline.reset();
+	TimelineFence.Dispose();
+
+	CloseHandle(FrameLatencyWaitableObject);
+	CloseHandle(CopyFenceEvent);
+}
+
+void D3D12RenderDevice::CreateGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount)
+{
+	if (VertexCount == 0 || IndexCount == 0) throw std::runtime_error("Geometry needs vertices and indices");
+
+	// Packed into the layout DescribePipelineState declares for the format
+	std::vector<QuantizedVertex> QuantizedVertices;
+	const void* VertexData = Vertices;
+	UINT VertexStride = sizeof(Vertex);
+	if (GeometryFormat == VertexFormat::Quantized)
+	{
+		QuantizedVertices.resize(VertexCount);
+		for (uint32_t VertexIndex = 0; VertexIndex < VertexCount; VertexIndex++)
+		{
+			QuantizedVertices[VertexIndex] = QuantizeVertex(Vertices[VertexIndex].Position, Vertices[VertexIndex].UV);
+		}
+		VertexData = QuantizedVertices.data();
+		VertexStride = sizeof(QuantizedVertex);
+	}
+
+	// The base vertex is added after the index is fetched, so only the indices themselves have to fit
+	std::vector<uint16_t> NarrowIndices;
+	const void* IndexData = Indices;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
+	UINT IndexSize = sizeof(uint32_t);
+	if (*std::max_element(Indices, Indices + IndexCount) <= UINT16_MAX)
+	{
+		NarrowIndices.assign(Indices, Indices + IndexCount);
+		IndexData = NarrowIndices.data();
+		IndexFormat = DXGI_FORMAT_R16_UINT;
+		IndexSize = sizeof(uint16_t);
+	}
+
+	const UINT VertexBufferSize = VertexCount * VertexStride;
+	UploadGeometryBuffer(VertexData, VertexBufferSize, RenderGraphState::VertexBuffer, VertexBuffer, VertexBufferAllocation, VertexBufferState);
+	VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
+	VertexBufferView.StrideInBytes = VertexStride;
+	VertexBufferView.SizeInBytes = VertexBufferSize;
+
+	const UINT IndexBufferSize = IndexCount * IndexSize;
+	UploadGeometryBuffer(IndexData, IndexBufferSize, RenderGraphState::IndexBuffer, IndexBuffer, IndexBufferAllocation, IndexBufferState);
+	IndexBufferView.BufferLocation = IndexBuffer->GetGPUVirtualAddress();
+	IndexBufferView.SizeInBytes = IndexBufferSize;
+	IndexBufferView.Format = IndexFormat;
+}
+
+void D3D12RenderDevice::UploadGeometryBuffer(const void* Data, UINT Size, RenderGraphState FinalState, ComPtr<ID3D12Resource>& Buffer, D3D12HeapAllocation& Allocation, ResourceStateRegistry::Handle& State)
+{
+	ReleasePlacedResource(Buffer, Allocation);
+	if (State != ResourceStateRegistry::InvalidHandle)
+	{
+		ResourceStates.Unregister(State);
+		State = ResourceStateRegistry::InvalidHandle;
+	}
+
+	D3D12_RESOURCE_DESC BufferDescription;
+	BufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	BufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+	BufferDescription.Width = Size;
+	BufferDescription.Height = 1;
+	BufferDescription.Alignment = 0;
+	BufferDescription.DepthOrArraySize = 1;
+	BufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	BufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	BufferDescription.MipLevels = 1;
+	BufferDescription.SampleDesc.Count = 1;
+	BufferDescription.SampleDesc.Quality = 0;
+
+	// Buffers always start in the common state and are promoted to copy destination by the copy itself,
+	// so it is registered as the copy leaves it
+	Buffer = HeapAllocator.CreatePlacedResource(BufferDescription, D3D12_RESOURCE_STATE_COMMON, nullptr, Allocation);
+	State = ResourceStates.Register(Buffer.Get(), 1, RenderGraphState::CopyDestination);
+
+	UploadAllocation Staging = AllocateUpload(Size, sizeof(float));
+	memcpy(Staging.CpuAddress, Data, Size);
+	UploadStates.Transition(State, RenderGraphState::CopyDestination);
+	FlushUploadBarriers();
+	UploadCommandList->CopyBufferRegion(Buffer.Get(), 0, Staging.Resource, Staging.Offset, Size);
+
+	// Queued until the next upload command or FinishUploads, batched with whatever follows
+	UploadStates.Transition(State, FinalState);
+	UploadsPending = true;
+}
+
+void D3D12RenderDevice::CreateTexture(const TextureDescription& Description, const uint8_t* Pixels)
+{
+	const D3D12_RESOURCE_DESC ResourceDescription = DescribeTexture(Description);
+	const UINT MipLevels = ResourceDescription.MipLevels;
+
+	D3D12HeapAllocation NewTextureAllocation;
+	ComPtr<ID3D12Resource> NewTexture = HeapAllocator.CreatePlacedResource(ResourceDescription, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, NewTextureAllocation);
+	const ResourceStateRegistry::Handle NewTextureState = ResourceStates.Register(NewTexture.Get(), MipLevels, RenderGraphState::CopyDestination);
+
+	UINT64 RequiredUploadSize;
+	Device->GetCopyableFootprints(&ResourceDescription, 0, MipLevels, 0, nullptr, nullptr, nullptr, &RequiredUploadSize);
+
+	UploadAllocation Staging = AllocateUpload(RequiredUploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT TextureFootprints[MaximumMipLevelCount];
+	Device->GetCopyableFootprints(
+		&ResourceDescription,
+		0,
+		MipLevels,
+		Staging.Offset,
+		TextureFootprints,
+		nullptr,
+		nullptr,
+		nullptr
+	);
+
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	for (UINT Level = 0; Level < MipLevels; Level++)
+	{
+		Levels[Level].Offset = TextureFootprints[Level].Offset - TextureFootprints[0].Offset;
+		Levels[Level].Width = TextureFootprints[Level].Footprint.Width;
+		Levels[Level].Height = TextureFootprints[Level].Footprint.Height;
+		Levels[Level].RowPitch = TextureFootprints[Level].Footprint.RowPitch;
+	}
+
+	MipGenerationOptions MipOptions;
+	MipOptions.Filter = TextureMipFilter;
+
+	// The footprint offset already includes the ring offset, so address the mapped ring from its base
+	UINT8* TextureUploadData = Staging.CpuAddress - Staging.Offset;
+	if (IsBlockCompressed(Description.Format))
+	{
+		// Compressed levels are filtered from the full RGBA8 chain, which is built in system memory first
+		TextureLevelLayout PixelLevels[MaximumMipLevelCount];
+		std::vector<UINT8> PixelChain(GetTextureLevelLayouts(TextureFormat::Rgba8, Description.Width, Description.Height, MipLevels, 4, 16, PixelLevels));
+		memcpy(PixelChain.data(), Pixels, 4ull * Description.Width * Description.Height);
+		GenerateMipChain(PixelChain.data(), PixelLevels, MipLevels, MipOptions, Jobs);
+		CompressTexture(Description.Format, PixelChain.data(), PixelLevels, TextureUploadData + TextureFootprints[0].Offset, Levels, MipLevels, BlockCompressionOptions(), Jobs);
+	}
+	else
+	{
+		for (UINT Row = 0; Row < Description.Height; Row++)
+		{
+			memcpy(TextureUploadData + TextureFootprints[0].Offset + Row * TextureFootprints[0].Footprint.RowPitch, Pixels + 4 * Row * Description.Width, 4 * Description.Width);
+		}
+		GenerateMipChain(TextureUploadData + TextureFootprints[0].Offset, Levels, MipLevels, MipOptions, Jobs);
+	}
+
+	UploadStates.Transition(NewTextureState, RenderGraphState::CopyDestination);
+	FlushUploadBarriers();
+	for (UINT Level = 0; Level < MipLevels; Level++)
+	{
+		D3D12_TEXTURE_COPY_LOCATION DestinationLocation = {};
+		DestinationLocation.pResource = NewTexture.Get();
+		DestinationLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		DestinationLocation.SubresourceIndex = Level;
+
+		D3D12_TEXTURE_COPY_LOCATION SourceLocation = {};
+		SourceLocation.pResource = Staging.Resource;
+		SourceLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		SourceLocation.PlacedFootprint = TextureFootprints[Level];
+
+		UploadCommandList->CopyTextureRegion(
+			&DestinationLocation,
+			0,
+			0,
+			0,
+			&SourceLocation,
+			nullptr
+		);
+	}
+
+	UploadStates.Transition(NewTextureState, RenderGraphState::PixelShaderResource);
+	UploadsPending = true;
+
+	BindTexture(NewTexture, NewTextureAllocation);
+	TextureState = NewTextureState;
+}
+
+void D3D12RenderDevice::FinishUploads()
+{
+	FlushUploadBarriers();
+	ThrowIfFailed(UploadCommandList->Close());
+
+	ResolvedBarriers.clear();
+	UploadStates.Resolve(ResolvedBarriers);
+	ID3D12CommandList* CommandLists[2];
+	UINT CommandListCount = 0;
+	if (!ResolvedBarriers.empty())
+	{
+		// The upload list is closed, so the allocator is free to record this one as well
+		ThrowIfFailed(StateResolveCommandList->Reset(UploadCommandAllocator.Get(), nullptr));
+		RecordStateBarriers(StateResolveCommandList.Get(), ResolvedBarriers.data(), static_cast<uint32_t>(ResolvedBarriers.size()));
+		ThrowIfFailed(StateResolveCommandList->Close());
+		CommandLists[CommandListCount++] = StateResolveCommandList.Get();
+	}
+	CommandLists[CommandListCount++] = UploadCommandList.Get();
+	CommandQueue->ExecuteCommandLists(CommandListCount, CommandLists);
+
+	WaitForGpu();
+	PendingUploadHeaps.clear();
+	UploadRing.FinishFrame(FenceValue);
+	UploadRing.Retire(Fence->GetCompletedValue());
+
+	ThrowIfFailed(UploadCommandAllocator->Reset());
+	ThrowIfFailed(UploadCommandList->Reset(UploadCommandAllocator.Get(), nullptr));
+	UploadStates.Reset();
+	UploadsPending = false;
+}
+
+void D3D12RenderDevice::FlushUploadBarriers()
+{
+	UploadStates.FlushBarriers([this](const ResourceStateBarrier* Barriers, uint32_t BarrierCount)
+	{
+		RecordStateBarriers(UploadCommandList.Get(), Barriers, BarrierCount);
+	});
+}
+
+bool D3D12RenderDevice::TryBeginTextureStream(const TextureDescription& Description, TextureStreamStaging& Staging)
+{
+	const D3D12_RESOURCE_DESC ResourceDescription = DescribeTexture(Description);
+	const UINT MipLevels = ResourceDescription.MipLevels;
+
+	UINT64 RequiredUploadSize;
+	Device->GetCopyableFootprints(&ResourceDescription, 0, MipLevels, 0, nullptr, nullptr, nullptr, &RequiredUploadSize);
+	if (RequiredUploadSize > StreamingStagingCapacity) throw std::runtime_error("Streamed texture exceeds staging capacity");
+
+	const TlsfAllocator::Handle StagingHandle = StreamingStagingAllocator->Allocate(RequiredUploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	if (StagingHandle == TlsfAllocator::InvalidHandle) return false;
+
+	PendingStream Stream;
+	Stream.StagingHandle = StagingHandle;
+	Stream.FenceValue = 0;
+	Stream.Footprints.resize(MipLevels);
+	Device->GetCopyableFootprints(&ResourceDescription, 0, MipLevels, StreamingStagingAllocator->GetOffset(StagingHandle), Stream.Footprints.data(), nullptr, nullptr, nullptr);
+
+	// Copy queues only see the common state, the first graphics read promotes the texture implicitly
+	Stream.Resource = HeapAllocator.CreatePlacedResource(ResourceDescription, D3D12_RESOURCE_STATE_COMMON, nullptr, Stream.Allocation);
+
+	Staging.StreamId = NextStreamId++;
+	Staging.Format = Description.Format;
+	Staging.Pixels = StreamingStagingData + Stream.Footprints[0].Offset;
+	Staging.RowPitch = Stream.Footprints[0].Footprint.RowPitch;
+	Staging.Width = Description.Width;
+	Staging.Height = Description.Height;
+	Staging.MipLevelCount = MipLevels;
+	for (UINT Level = 0; Level < MipLevels; Level++)
+	{
+		Staging.Levels[Level].Offset = Stream.Footprints[Level].Offset - Stream.Footprints[0].Offset;
+		Staging.Levels[Level].Width = Stream.Footprints[Level].Footprint.Width;
+		Staging.Levels[Level].Height = Stream.Footprints[Level].Footprint.Height;
+		Staging.Levels[Level].RowPitch = Stream.Footprints[Level].Footprint.RowPitch;
+	}
+	Streams.emplace(Staging.StreamId, std::move(Stream));
+	return true;
+}
+
+uint64_t D3D12RenderDevice::SubmitTextureStream(const TextureStreamStaging& Staging)
+{
+	PendingStream& Stream = Streams.at(Staging.StreamId);
+
+	const UINT64 CompletedCopyValue = CopyFence->GetCompletedValue();
+	CopyCommandAllocator Allocator = CopyCommandAllocators.front();
+	if (Allocator.FenceValue <= CompletedCopyValue)
+	{
+		CopyCommandAllocators.pop_front();
+		ThrowIfFailed(Allocator.Allocator->Reset());
+	}
+	else
+	{
+		ThrowIfFailed(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&Allocator.Allocator)));
+	}
+	ThrowIfFailed(CopyCommandList->Reset(Allocator.Allocator.Get(), nullptr));
+
+	for (UINT Level = 0; Level < Stream.Footprints.size(); Level++)
+	{
+		D3D12_TEXTURE_COPY_LOCATION DestinationLocation = {};
+		DestinationLocation.pResource = Stream.Resource.Get();
+		DestinationLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		DestinationLocation.SubresourceIndex = Level;
+
+		D3D12_TEXTURE_COPY_LOCATION SourceLocation = {};
+		SourceLocation.pResource = StreamingStagingBuffer.Get();
+		SourceLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		SourceLocation.PlacedFootprint = Stream.Footprints[Level];
+
+		CopyCommandList->CopyTextureRegion(&DestinationLocation, 0, 0, 0, &SourceLocation, nullptr);
+	}
+	ThrowIfFailed(CopyCommandList->Close());
+
+	ID3D12CommandList* CommandLists[] = { CopyCommandList.Get() };
+	CopyCommandQueue->ExecuteCommandLists(_countof(CommandLists), CommandLists);
+	ThrowIfFailed(CopyCommandQueue->Signal(CopyFence.Get(), ++CopyFenceValue));
+
+	Allocator.FenceValue = CopyFenceValue;
+	CopyCommandAllocators.push_back(Allocator);
+	Stream.FenceValue = CopyFenceValue;
+	return CopyFenceValue;
+}
+
+void D3D12RenderDevice::CancelTextureStream(const TextureStreamStaging& Staging)
+{
+	auto Stream = Streams.find(Staging.StreamId);
+	if (Stream == Streams.end()) return;
+
+	// Submitted copies cannot be recalled, those streams are left to complete and be superseded
+	if (Stream->second.FenceValue != 0) return;
+
+	Stream->second.Resource.Reset();
+	HeapAllocator.Free(Stream->second.Allocation);
+	StreamingStagingAllocator->Free(Stream->second.StagingHandle);
+	Streams.erase(Stream);
+}
+
+void D3D12RenderDevice::UploadInstances(const InstanceBatchBuffer& Batches)
+{
+	const UINT64 TransformBytes = Batches.TransformRows.size() * sizeof(float);
+	const UINT64 MaterialBytes = Batches.MaterialIds.size() * sizeof(uint32_t);
+	const UINT64 ArgumentBytes = Batches.Draws.size() * sizeof(InstancedDrawArguments);
+	const UINT64 Size = TransformBytes + MaterialBytes + ArgumentBytes;
+
+	// The GPU finished with this frame's buffer before the frame became current again
+	InstanceUploadBuffer& Buffer = InstanceBuffers[CurrentFrameIndex];
+	if (Size > Buffer.Capacity)
+	{
+		// Grown with headroom so a slowly rising instance count does not recreate the buffer every frame
+		const UINT64 Capacity = Size + Size / 2;
+		CreateInstanceBuffer(Buffer, Capacity > MinimumInstanceBufferCapacity ? Capacity : MinimumInstanceBufferCapacity);
+	}
+
+	memcpy(Buffer.Data, Batches.TransformRows.data(), TransformBytes);
+	memcpy(Buffer.Data + TransformBytes, Batches.MaterialIds.data(), MaterialBytes);
+	memcpy(Buffer.Data + TransformBytes + MaterialBytes, Batches.Draws.data(), ArgumentBytes);
+
+	UploadedInstanceCount = Batches.InstanceCount;
+	UploadedDrawCount = static_cast<UINT>(Batches.Draws.size());
+	IndirectArgumentOffset = TransformBytes + MaterialBytes;
+}
+
+std::unique_ptr<RenderCommandList> D3D12RenderDevice::CreateCommandList()
+{
+	return std::make_unique<D3D12CommandList>(this);
+}
+
+void D3D12RenderDevice::ExecuteCommandLists(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists)
+{
+	ProfileScope Scope(Profiling, "Execute command lists");
+
+	// Staging memory is tagged with frame fences, so uploads recorded since the last flush must land first
+	if (UploadsPending)
+	{
+		FinishUploads();
+	}
+
+	// Views written since the last submit reach the shader-visible heap in one batch
+	BindlessHeap.FlushWrites();
+
+	ThrowIfFailed(FrameCommandAllocator[CurrentFrameIndex]->Reset());
+
+	// The submitted lists form the scene pass; barriers the graph places before it go on the list in front of them,
+	// everything after it on the list behind. A scaled scene is upscaled into the back buffer on the list behind.
+	ID3D12GraphicsCommandList* BarrierCommandList = BeginFrameCommandList.Get();
+	FrameGraph.Reset();
+	const RenderGraph::ResourceHandle BackBuffer = FrameGraph.ImportResource("Back buffer", RenderGraphState::Present, RenderGraphState::Present);
+	const RenderGraph::PassHandle ScenePass = FrameGraph.AddPass("Scene", [&]() { BarrierCommandList = EndFrameCommandList.Get(); });
+	if (RenderingScaled)
+	{
+		const RenderGraph::ResourceHandle SceneColor = FrameGraph.ImportResource("Scene color", RenderGraphState::PixelShaderResource, RenderGraphState::PixelShaderResource);
+		const RenderGraph::PassHandle UpscalePass = FrameGraph.AddPass("Upscale", [&]() { RecordUpscale(EndFrameCommandList.Get()); });
+		FrameGraph.Write(ScenePass, SceneColor, RenderGraphState::RenderTarget);
+		FrameGraph.Read(UpscalePass, SceneColor, RenderGraphState::PixelShaderResource);
+		FrameGraph.Write(UpscalePass, BackBuffer, RenderGraphState::RenderTarget);
+	}
+	else
+	{
+		FrameGraph.Write(ScenePass, BackBuffer, RenderGraphState::RenderTarget);
+	}
+	FrameGraph.Compile();
+
+	ID3D12Resource* const GraphResources[] = { RenderTargets[CurrentFrameIndex].Get(), SceneTarget.Get() };
+	ThrowIfFailed(BeginFrameCommandList->Reset(FrameCommandAllocator[CurrentFrameIndex].Get(), nullptr));
+	ThrowIfFailed(EndFrameCommandList->Reset(FrameCommandAllocator[CurrentFrameIndex].Get(), nullptr));
+	uint32_t BeginFrameScope = D3D12GpuProfiler::InvalidScope;
+	uint32_t EndFrameScope = D3D12GpuProfiler::InvalidScope;
+	if (Profiling != nullptr)
+	{
+		BeginFrameScope = GpuProfiler.BeginScope(BeginFrameCommandList.Get(), CurrentFrameIndex, "Begin frame");
+		EndFrameScope = GpuProfiler.BeginScope(EndFrameCommandList.Get(), CurrentFrameIndex, "End frame");
+	}
+	FrameGraph.Execute([&](const RenderGraphBarrier* Barriers, uint32_t BarrierCount)
+	{
+		RecordGraphBarriers(BarrierCommandList, GraphResources, Barriers, BarrierCount);
+	});
+	if (RenderingScaled && SceneTargetDiscardPending)
+	{
+		// The begin frame list has just moved the target to render target, the state DiscardResource needs
+		BeginFrameCommandList->DiscardResource(SceneTarget.Get(), nullptr);
+		SceneTargetDiscardPending = false;
+	}
+	if (Profiling != nullptr)
+	{
+		// The end frame list runs last, so it carries the resolve of every timestamp the frame wrote
+		GpuProfiler.EndScope(BeginFrameCommandList.Get(), CurrentFrameIndex, BeginFrameScope);
+		GpuProfiler.EndScope(EndFrameCommandList.Get(), CurrentFrameIndex, EndFrameScope);
+		GpuProfiler.ResolveFrame(EndFrameCommandList.Get(), CurrentFrameIndex);
+	}
+	ThrowIfFailed(BeginFrameCommandList->Close());
+	ThrowIfFailed(EndFrameCommandList->Close());
+
+	std::vector<ID3D12CommandList*> NativeCommandLists;
+	NativeCommandLists.reserve(NumberOfCommandLists + 2);
+	NativeCommandLists.push_back(BeginFrameCommandList.Get());
+	for (UINT Index = 0; Index < NumberOfCommandLists; Index++)
+	{
+		NativeCommandLists.push_back(static_cast<D3D12CommandList*>(CommandLists[Index])->GetCommandList());
+	}
+	NativeCommandLists.push_back(EndFrameCommandList.Get());
+
+	CommandQueue->ExecuteCommandLists(static_cast<UINT>(NativeCommandLists.size()), NativeCommandLists.data());
+}
+
+void D3D12RenderDevice::BeginFrame()
+{
+	// Waiting for room in the present queue here rather than inside Present keeps the frame's input behind the wait
+	WaitForSingleObjectEx(FrameLatencyWaitableObject, 1000, TRUE);
+	Pacer.BeginFrame();
+}
+
+void D3D12RenderDevice::Present()
+{
+	ProfileScope Scope(Profiling, "Present");
+	const UINT PresentedFrameIndex = CurrentFrameIndex;
+	const UINT PresentFlags = Pacer.AllowsTearing() && TearingSupported ? DXGI_PRESENT_ALLOW_TEARING : 0;
+	ThrowIfFailed(SwapChain->Present(Pacer.GetSyncInterval(), PresentFlags));
+	AdvanceFrame();
+	Pacer.EndFrame(FrameSignalValue[PresentedFrameIndex]);
+}
+
+void D3D12RenderDevice::SetFramePacing(const FramePacingDescription& Description)
+{
+	if (Description.FramesInFlight > FrameCount) throw std::runtime_error("More frames in flight than back buffers");
+
+	Pacer.Configure(Description);
+	// The low latency mode keeps a single frame queued for presentation, the others as many as may be in flight
+	ThrowIfFailed(SwapChain->SetMaximumFrameLatency(Description.Mode == PresentMode::LowLatency ? 1 : Description.FramesInFlight));
+}
+
+void D3D12RenderDevice::WaitForIdle()
+{
+	WaitForGpu();
+}
+
+void D3D12RenderDevice::Resize(uint32_t NewWidth, uint32_t NewHeight)
+{
+	if (NewWidth == 0 || NewHeight == 0 || (NewWidth == Width && NewHeight == Height)) return;
+	ProfileScope Scope(Profiling, "Resize");
+
+	// Every frame that used a back buffer signalled its fence when presented; queued streams and uploads keep going
+	UINT64 LastFrameSignalValue = 0;
+	for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		LastFrameSignalValue = std::max(LastFrameSignalValue, FrameSignalValue[FrameIndex]);
+	}
+	FrameTimeline->Wait(LastFrameSignalValue);
+
+	for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		RenderTargets[FrameIndex].Reset();
+	}
+	ThrowIfFailed(SwapChain->ResizeBuffers(FrameCount, NewWidth, NewHeight, DXGI_FORMAT_UNKNOWN, SwapChainFlags));
+	Width = NewWidth;
+	Height = NewHeight;
+	CreateBackBufferViews();
+
+	// The swap chain starts over at its first buffer, whose queries may still hold timestamps nobody collected
+	const UINT NextFrameIndex = SwapChain->GetCurrentBackBufferIndex();
+	if (Profiling != nullptr && NextFrameIndex != CurrentFrameIndex)
+	{
+		GpuProfiler.CollectFrame(NextFrameIndex, *Profiling);
+	}
+	CurrentFrameIndex = NextFrameIndex;
+
+	if (SceneTarget != nullptr && (Width > SceneTargetWidth || Height > SceneTargetHeight))
+	{
+		CreateSceneTarget(std::max(Width, SceneTargetWidth), std::max(Height, SceneTargetHeight));
+	}
+	UpdateRenderArea();
+}
+
+void D3D12RenderDevice::SetRenderScale(float Scale)
+{
+	if (!(Scale > 0.0f)) throw std::runtime_error("Render scale must be positive");
+
+	RenderScale = std::min(Scale, 1.0f);
+	if (RenderScale < 1.0f && (SceneTarget == nullptr || Width > SceneTargetWidth || Height > SceneTargetHeight))
+	{
+		CreateSceneTarget(std::max(Width, SceneTargetWidth), std::max(Height, SceneTargetHeight));
+	}
+	UpdateRenderArea();
+}
+
+UploadAllocation D3D12RenderDevice::AllocateUpload(UINT64 Size, UINT64 Alignment)
+{
+	UploadAllocation Allocation;
+	if (UploadRing.TryAllocate(Size, Alignment, Allocation)) return Allocation;
+
+	// The ring is full of work the GPU has not consumed yet, submit what is queued and wait for it
+	if (UploadsPending)
+	{
+		FinishUploads();
+	}
+	else
+	{
+		WaitForGpu();
+		UploadRing.FinishFrame(FenceValue);
+		UploadRing.Retire(Fence->GetCompletedValue());
+	}
+	if (UploadRing.TryAllocate(Size, Alignment, Allocation)) return Allocation;
+
+	// Larger than the whole ring, fall back to a dedicated upload heap that lives until the next flush
+	D3D12_HEAP_PROPERTIES UploadHeapProperties;
+	UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	UploadHeapProperties.CreationNodeMask = 1;
+	UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	UploadHeapProperties.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC IntermediaryBufferDescription;
+	IntermediaryBufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	IntermediaryBufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+	IntermediaryBufferDescription.Width = Size;
+	IntermediaryBufferDescription.Height = 1;
+	IntermediaryBufferDescription.Alignment = 0;
+	IntermediaryBufferDescription.DepthOrArraySize = 1;
+	IntermediaryBufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	IntermediaryBufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	IntermediaryBufferDescription.MipLevels = 1;
+	IntermediaryBufferDescription.SampleDesc.Count = 1;
+	IntermediaryBufferDescription.SampleDesc.Quality = 0;
+
+	ComPtr<ID3D12Resource> IntermediaryBuffer;
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&UploadHeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&IntermediaryBufferDescription,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&IntermediaryBuffer)
+	));
+
+	D3D12_RANGE ReadRange = {};
+	ThrowIfFailed(IntermediaryBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&Allocation.CpuAddress)));
+	Allocation.Resource = IntermediaryBuffer.Get();
+	Allocation.Offset = 0;
+	Allocation.GpuAddress = IntermediaryBuffer->GetGPUVirtualAddress();
+	PendingUploadHeaps.push_back(IntermediaryBuffer);
+	return Allocation;
+}
+
+UINT D3D12RenderDevice::GetActiveTextureIndex() const
+{
+	return D3D12BindlessHeap::GetIndex(Texture != nullptr ? TextureDescriptor : NullTextureDescriptor);
+}
+
+void D3D12RenderDevice::BindTexture(ComPtr<ID3D12Resource> NewTexture, const D3D12HeapAllocation& NewAllocation)
+{
+	// Called between frames, so every list that could reference the current texture is already submitted.
+	// Its descriptor slot is recycled together with it, so a new view never lands in a slot the GPU may still read.
+	if (TextureState != ResourceStateRegistry::InvalidHandle)
+	{
+		ResourceStates.Unregister(TextureState);
+		TextureState = ResourceStateRegistry::InvalidHandle;
+	}
+	if (Texture != nullptr)
+	{
+		RetireResource(Texture, TextureAllocation, TextureDescriptor, FenceValue);
+	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC ShaderResourceDescription = {};
+	ShaderResourceDescription.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	ShaderResourceDescription.Format = NewTexture->GetDesc().Format;
+	ShaderResourceDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	ShaderResourceDescription.Texture2D.MipLevels = NewTexture->GetDesc().MipLevels;
+
+	const D3D12BindlessHeap::Handle NewDescriptor = BindlessHeap.Allocate();
+	BindlessHeap.CreateShaderResourceView(NewTexture.Get(), &ShaderResourceDescription, NewDescriptor);
+
+	Texture = NewTexture;
+	TextureAllocation = NewAllocation;
+	TextureDescriptor = NewDescriptor;
+}
+
+void D3D12RenderDevice::PromoteStreamedTextures()
+{
+	const UINT64 CompletedCopyValue = CopyFence->GetCompletedValue();
+
+	// Only the newest completed stream is bound, older ones that finished in the same frame are superseded
+	auto Newest = Streams.end();
+	for (auto Stream = Streams.begin(); Stream != Streams.end(); ++Stream)
+	{
+		const UINT64 StreamFenceValue = Stream->second.FenceValue;
+		if (StreamFenceValue == 0 || StreamFenceValue > CompletedCopyValue) continue;
+		if (Newest == Streams.end() || StreamFenceValue > Newest->second.FenceValue) Newest = Stream;
+	}
+	if (Newest == Streams.end()) return;
+
+	for (auto Stream = Streams.begin(); Stream != Streams.end();)
+	{
+		PendingStream& Candidate = Stream->second;
+		if (Candidate.FenceValue == 0 || Candidate.FenceValue > CompletedCopyValue)
+		{
+			++Stream;
+			continue;
+		}
+
+		StreamingStagingAllocator->Free(Candidate.StagingHandle);
+		if (Stream == Newest)
+		{
+			BindTexture(Candidate.Resource, Candidate.Allocation);
+		}
+		else
+		{
+			Candidate.Resource.Reset();
+			HeapAllocator.Free(Candidate.Allocation);
+		}
+		Stream = Streams.erase(Stream);
+	}
+}
+
+void D3D12RenderDevice::RetireResource(ComPtr<ID3D12Resource> Resource, const D3D12HeapAllocation& Allocation, D3D12BindlessHeap::Handle Descriptor, UINT64 RetiredFenceValue)
+{
+	// Runs on the completion thread; the heap allocator locks and descriptor slots are freed lock-free
+	FrameTimeline->OnCompleted(RetiredFenceValue, [this, Resource, Allocation, Descriptor]() mutable
+	{
+		Resource.Reset();
+		HeapAllocator.Free(Allocation);
+		if (Descriptor != DescriptorIndexAllocator::InvalidHandle)
+		{
+			BindlessHeap.Free(Descriptor);
+		}
+	});
+}
+
+void D3D12RenderDevice::CreateInstanceBuffer(InstanceUploadBuffer& Buffer, UINT64 Capacity)
+{
+	D3D12_HEAP_PROPERTIES UploadHeapProperties;
+	UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	UploadHeapProperties.CreationNodeMask = 1;
+	UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	UploadHeapProperties.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC InstanceBufferDescription;
+	InstanceBufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	InstanceBufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+	InstanceBufferDescription.Width = Capacity;
+	InstanceBufferDescription.Height = 1;
+	InstanceBufferDescription.Alignment = 0;
+	InstanceBufferDescription.DepthOrArraySize = 1;
+	InstanceBufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	InstanceBufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	InstanceBufferDescription.MipLevels = 1;
+	InstanceBufferDescription.SampleDesc.Count = 1;
+	InstanceBufferDescription.SampleDesc.Quality = 0;
+
+	// Upload heaps stay in generic read, which covers both the vertex shader reads and indirect arguments
+	ComPtr<ID3D12Resource> Resource;
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&UploadHeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&InstanceBufferDescription,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&Resource)
+	));
+
+	D3D12_RANGE ReadRange = {};
+	ThrowIfFailed(Resource->Map(0, &ReadRange, reinterpret_cast<void**>(&Buffer.Data)));
+	Buffer.Resource = Resource;
+	Buffer.Capacity = Capacity;
+}
+
+void D3D12RenderDevice::ReleasePlacedResource(ComPtr<ID3D12Resource>& Resource, D3D12HeapAllocation& Allocation)
+{
+	if (Resource == nullptr) return;
+
+	// Lists still being recorded may reference it, so they are submitted before the fence value it waits for
+	if (UploadsPending)
+	{
+		FinishUploads();
+	}
+	ThrowIfFailed(CommandQueue->Signal(Fence.Get(), ++FenceValue));
+	RetireResource(Resource, Allocation, DescriptorIndexAllocator::InvalidHandle, FenceValue);
+	Resource.Reset();
+	Allocation = D3D12HeapAllocation();
+}
+
+D3D12_RESOURCE_DESC D3D12RenderDevice::DescribeTexture(const TextureDescription& Description) const
+{
+	// Block compressed textures need whole blocks at the top level, smaller mips are padded by the runtime
+	if (IsBlockCompressed(Description.Format) && (Description.Width % 4 != 0 || Description.Height % 4 != 0)) throw std::runtime_error("Block compressed texture dimensions must be multiples of four");
+
+	D3D12_RESOURCE_DESC ResourceDescription = {};
+	ResourceDescription.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	ResourceDescription.Format = GetDxgiFormat(Description.Format);
+	ResourceDescription.Width = Description.Width;
+	ResourceDescription.Height = Description.Height;
+	ResourceDescription.DepthOrArraySize = 1;
+	ResourceDescription.MipLevels = static_cast<UINT16>(GetFullMipLevelCount(Description.Width, Description.Height));
+	ResourceDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	ResourceDescription.SampleDesc.Count = 1;
+	ResourceDescription.SampleDesc.Quality = 0;
+	return ResourceDescription;
+}
+
+// Bytecode is the only part that changes when shaders are reloaded
+D3D12_GRAPHICS_PIPELINE_STATE_DESC D3D12RenderDevice::DescribePipelineState(const ShaderBytecode& VertexShader, const ShaderBytecode& PixelShader) const
+{
+	static const D3D12_INPUT_ELEMENT_DESC FloatInputElementDescriptions[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	// QuantizedVertex; the input assembler expands both to floats, so the shaders are shared. There is no three
+	// component half format, the fourth half only pads the position.
+	static const D3D12_INPUT_ELEMENT_DESC QuantizedInputElementDescriptions[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+	static_assert(sizeof(QuantizedVertex) == 12, "Quantized vertices must match their input layout");
+	const bool Quantized = GeometryFormat == VertexFormat::Quantized;
+
+	D3D12_RASTERIZER_DESC RasterizerDescription;
+	RasterizerDescription.FillMode = D3D12_FILL_MODE_SOLID;
+	RasterizerDescription.CullMode = D3D12_CULL_MODE_BACK;
+	RasterizerDescription.FrontCounterClockwise = FALSE;
+	RasterizerDescription.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
+	RasterizerDescription.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
+	RasterizerDescription.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
+	RasterizerDescription.DepthClipEnable = TRUE;
+	RasterizerDescription.MultisampleEnable = FALSE;
+	RasterizerDescription.AntialiasedLineEnable = FALSE;
+	RasterizerDescription.ForcedSampleCount = 0;
+	RasterizerDescription.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+	D3D12_BLEND_DESC BlendDescription;
+	BlendDescription.AlphaToCoverageEnable = FALSE;
+	BlendDescription.IndependentBlendEnable = FALSE;
+	const D3D12_RENDER_TARGET_BLEND_DESC DefaultRenderTargetBlendDescription =
+	{
+		FALSE,FALSE,
+		D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+		D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+		D3D12_LOGIC_OP_NOOP,
+		D3D12_COLOR_WRITE_ENABLE_ALL,
+	};
+	for (UINT Index = 0; Index < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; Index++)
+	{
+		BlendDescription.RenderTarget[Index] = DefaultRenderTargetBlendDescription;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC PipelineStateDescription = {};
+	PipelineStateDescription.InputLayout.pInputElementDescs = Quantized ? QuantizedInputElementDescriptions : FloatInputElementDescriptions;
+	PipelineStateDescription.InputLayout.NumElements = Quantized ? _countof(QuantizedInputElementDescriptions) : _countof(FloatInputElementDescriptions);
+	PipelineStateDescription.pRootSignature = RootSignature.Get();
+	PipelineStateDescription.VS.pShaderBytecode = VertexShader.Data;
+	PipelineStateDescription.VS.BytecodeLength = VertexShader.Size;
+	PipelineStateDescription.PS.pShaderBytecode = PixelShader.Data;
+	PipelineStateDescription.PS.BytecodeLength = PixelShader.Size;
+	PipelineStateDescription.RasterizerState = RasterizerDescription;
+	PipelineStateDescription.BlendState = BlendDescription;
+	PipelineStateDescription.DepthStencilState.DepthEnable = FALSE;
+	PipelineStateDescription.DepthStencilState.StencilEnable = FALSE;
+	PipelineStateDescription.SampleMask = UINT_MAX;
+	PipelineStateDescription.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	PipelineStateDescription.NumRenderTargets = 1;
+	PipelineStateDescription.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	PipelineStateDescription.SampleDesc.Count = 1;
+	return PipelineStateDescription;
+}
+
+// Texel values pass through to the UNORM back buffer untouched, so compressed formats stay UNORM as well
+DXGI_FORMAT D3D12RenderDevice::GetDxgiFormat(TextureFormat Format)
+{
+	switch (Format)
+	{
+	case TextureFormat::Bc1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case TextureFormat::Bc3:
+		return DXGI_FORMAT_BC3_UNORM;
+	case TextureFormat::Bc7:
+		return DXGI_FORMAT_BC7_UNORM;
+	default:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+void D3D12RenderDevice::CreateBackBufferViews()
+{
+	auto Handle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
+	for (UINT FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		ThrowIfFailed(SwapChain->GetBuffer(FrameIndex, IID_PPV_ARGS(&RenderTargets[FrameIndex])));
+		Device->CreateRenderTargetView(RenderTargets[FrameIndex].Get(), nullptr, Handle);
+		Handle.ptr += RenderTargetDescriptorSize;
+	}
+}
+
+void D3D12RenderDevice::CreateSceneTarget(UINT TargetWidth, UINT TargetHeight)
+{
+	// Called between frames, so everything that drew into or sampled the old target was submitted before FenceValue
+	if (SceneTarget != nullptr)
+	{
+		RetireResource(SceneTarget, SceneTargetAllocation, SceneTargetDescriptor, FenceValue);
+		SceneTarget.Reset();
+		SceneTargetAllocation = D3D12HeapAllocation();
+		SceneTargetDescriptor = DescriptorIndexAllocator::InvalidHandle;
+	}
+
+	D3D12_RESOURCE_DESC ResourceDescription = {};
+	ResourceDescription.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	ResourceDescription.Width = TargetWidth;
+	ResourceDescription.Height = TargetHeight;
+	ResourceDescription.DepthOrArraySize = 1;
+	ResourceDescription.MipLevels = 1;
+	ResourceDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	ResourceDescription.SampleDesc.Count = 1;
+	ResourceDescription.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	ResourceDescription.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+	// Created in the state the frame graph expects between frames
+	SceneTarget = HeapAllocator.CreatePlacedResource(ResourceDescription, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr, SceneTargetAllocation);
+	SceneTargetWidth = TargetWidth;
+	SceneTargetHeight = TargetHeight;
+	SceneTargetDiscardPending = true;
+
+	auto Handle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
+	Handle.ptr += FrameCount * RenderTargetDescriptorSize;
+	Device->CreateRenderTargetView(SceneTarget.Get(), nullptr, Handle);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC ShaderResourceDescription = {};
+	ShaderResourceDescription.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	ShaderResourceDescription.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	ShaderResourceDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	ShaderResourceDescription.Texture2D.MipLevels = 1;
+	SceneTargetDescriptor = BindlessHeap.Allocate();
+	BindlessHeap.CreateShaderResourceView(SceneTarget.Get(), &ShaderResourceDescription, SceneTargetDescriptor);
+}
+
+void D3D12RenderDevice::UpdateRenderArea()
+{
+	RenderingScaled = RenderScale < 1.0f && SceneTarget != nullptr;
+	const UINT RenderWidth = RenderingScaled ? DynamicResolutionController::GetScaledSize(Width, RenderScale) : Width;
+	const UINT RenderHeight = RenderingScaled ? DynamicResolutionController::GetScaledSize(Height, RenderScale) : Height;
+
+	Viewport = { 0.0f, 0.0f, static_cast<float>(RenderWidth), static_cast<float>(RenderHeight) };
+	ScissorRectangle = { 0, 0, static_cast<LONG>(RenderWidth), static_cast<LONG>(RenderHeight) };
+	AspectRatio = static_cast<float>(Width) / static_cast<float>(Height);
+}
+
+void D3D12RenderDevice::RecordUpscale(ID3D12GraphicsCommandList* CommandList)
+{
+	// Texture coordinates over the output map onto the part of the scene target that was drawn
+	const float UVScale[2] = { Viewport.Width / static_cast<float>(SceneTargetWidth), Viewport.Height / static_cast<float>(SceneTargetHeight) };
+	const D3D12_VIEWPORT OutputViewport = { 0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height) };
+	const D3D12_RECT OutputRectangle = { 0, 0, static_cast<LONG>(Width), static_cast<LONG>(Height) };
+	const D3D12_CPU_DESCRIPTOR_HANDLE BackBufferHandle = GetBackBufferHandle();
+
+	CommandList->SetPipelineState(UpscalePipelineState.Get());
+	CommandList->SetGraphicsRootSignature(RootSignature.Get());
+	ID3D12DescriptorHeap* DescriptorHeaps[] = { BindlessHeap.GetHeap() };
+	CommandList->SetDescriptorHeaps(_countof(DescriptorHeaps), DescriptorHeaps);
+	CommandList->SetGraphicsRootDescriptorTable(1, BindlessHeap.GetGpuStart());
+	CommandList->SetGraphicsRoot32BitConstant(0, D3D12BindlessHeap::GetIndex(SceneTargetDescriptor), 0);
+	CommandList->SetGraphicsRoot32BitConstants(0, 2, UVScale, 1);
+	CommandList->RSSetViewports(1, &OutputViewport);
+	CommandList->RSSetScissorRects(1, &OutputRectangle);
+	CommandList->OMSetRenderTargets(1, &BackBufferHandle, FALSE, nullptr);
+	CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	CommandList->DrawInstanced(3, 1, 0, 0);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12RenderDevice::GetBackBufferHandle() const
+{
+	auto RenderTargetHandle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
+	RenderTargetHandle.ptr += CurrentFrameIndex * RenderTargetDescriptorSize;
+	return RenderTargetHandle;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12RenderDevice::GetCurrentRenderTargetHandle() const
+{
+	if (!RenderingScaled) return GetBackBufferHandle();
+
+	auto RenderTargetHandle = RenderTargetHeap->GetCPUDescriptorHandleForHeapStart();
+	RenderTargetHandle.ptr += FrameCount * RenderTargetDescriptorSize;
+	return RenderTargetHandle;
+}
+
+void D3D12RenderDevice::WaitForGpu()
+{
+	ThrowIfFailed(CommandQueue->Signal(Fence.Get(), ++FenceValue));
+	FrameTimeline->Wait(FenceValue);
+}
+
+void D3D12RenderDevice::SwapReloadedPipelineState()
+{
+	// Every list recorded with the old pipeline was submitted before the current fence value
+	ComPtr<ID3D12PipelineState> RetiredPipelineState = PipelineState;
+	FrameTimeline->OnCompleted(FenceValue, [RetiredPipelineState]() mutable { RetiredPipelineState.Reset(); });
+
+	std::lock_guard<std::mutex> Lock(ReloadedPipelineStateMutex);
+	PipelineState = ReloadedPipelineState;
+	ReloadedPipelineState.Reset();
+	PipelineStateReloaded.store(false, std::memory_order_relaxed);
+	OutputDebugStringW(L"Shaders reloaded\n");
+}
+
+void D3D12RenderDevice::AdvanceFrame()
+{
+	ProfileScope Scope(Profiling, "Advance frame");
+	CommandQueue->Signal(Fence.Get(), ++FenceValue);
+	FrameSignalValue[CurrentFrameIndex] = FenceValue;
+	UploadRing.FinishFrame(FenceValue);
+
+	// The pacer has usually waited for this frame already, so this rarely blocks
+	const UINT NextFrameIndex = SwapChain->GetCurrentBackBufferIndex();
+	FrameTimeline->Wait(FrameSignalValue[NextFrameIndex]);
+	UploadRing.Retire(FrameTimeline->GetCompletedValue());
+
+	// The frame that last used these queries has completed, so its timestamps are readable before they are reused
+	if (Profiling != nullptr)
+	{
+		GpuProfiler.CollectFrame(NextFrameIndex, *Profiling);
+	}
+
+	CurrentFrameIndex = NextFrameIndex;
+	LastFrameStateStatistics = ResourceStates.TakeFrameStatistics();
+	UploadedInstanceCount = 0;
+	UploadedDrawCount = 0;
+
+	// A single load per frame while no shader has changed
+	if (PipelineStateReloaded.load(std::memory_order_acquire))
+	{
+		SwapReloadedPipelineState();
+	}
+
+	PromoteStreamedTextures();
+}
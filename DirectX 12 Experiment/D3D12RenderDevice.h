@@ -0,0 +1,300 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include "D3D12BindlessHeap.h"
+#include "D3D12GpuProfiler.h"
+#include "D3D12HeapAllocator.h"
+#include "D3D12PipelineStateCache.h"
+#include "D3D12UploadRing.h"
+#include "FenceTimeline.h"
+#include "RenderDevice.h"
+#include "RenderGraph.h"
+#include "ResourceStateTracker.h"
+#include "ShaderHotReloader.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class D3D12RenderDevice;
+
+// The fence the direct queue signals, waited on by the completion thread of the device's fence timeline
+class D3D12TimelineFence : public TimelineFence
+{
+public:
+	void Initialize(ID3D12Fence* QueueFence);
+	void Dispose();
+
+	uint64_t GetCompletedValue() override;
+	void WaitForValue(uint64_t Value) override;
+	void Interrupt() override;
+
+private:
+	ID3D12Fence* Fence = nullptr;
+	HANDLE CompletionEvent = nullptr;
+	HANDLE InterruptEvent = nullptr;
+};
+
+// Lets the frame pacer wait on the fence timeline rather than on an event of its own
+class D3D12FrameFence : public FramePacerFence
+{
+public:
+	void Initialize(FenceTimeline* FrameTimeline);
+
+	uint64_t GetCompletedValue() override;
+	void Wait(uint64_t Value) override;
+
+private:
+	FenceTimeline* Timeline = nullptr;
+};
+
+class D3D12CommandList : public RenderCommandList
+{
+public:
+	explicit D3D12CommandList(D3D12RenderDevice* OwningDevice);
+
+	void Reset() override;
+	void ClearRenderTarget(const float Color[4]) override;
+	void DrawIndexedInstanced(uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+	void DrawInstancedBatches(const InstancedDrawArguments* Draws, uint32_t DrawCount) override;
+	void ExecuteIndirect(uint32_t FirstDraw, uint32_t DrawCount) override;
+	void Close() override;
+
+	ID3D12GraphicsCommandList* GetCommandList() const { return CommandList.Get(); }
+
+private:
+	D3D12RenderDevice* Device;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocator[RenderDevice::MaximumFrameCount];
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList;
+	uint32_t GpuScope = D3D12GpuProfiler::InvalidScope;
+};
+
+class D3D12RenderDevice : public RenderDevice
+{
+public:
+	D3D12RenderDevice() = default;
+	~D3D12RenderDevice() override = default;
+
+	void Initialize(const RenderDeviceDescription& Description) override;
+	void Dispose() override;
+
+	void CreateGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount) override;
+	void CreateTexture(const TextureDescription& Description, const uint8_t* Pixels) override;
+	void FinishUploads() override;
+
+	void UploadInstances(const InstanceBatchBuffer& Batches) override;
+
+	bool TryBeginTextureStream(const TextureDescription& Description, TextureStreamStaging& Staging) override;
+	uint64_t SubmitTextureStream(const TextureStreamStaging& Staging) override;
+	void CancelTextureStream(const TextureStreamStaging& Staging) override;
+	uint64_t GetCompletedStreamFenceValue() override { return CopyFence->GetCompletedValue(); }
+
+	std::unique_ptr<RenderCommandList> CreateCommandList() override;
+	void BeginFrame() override;
+	void ExecuteCommandLists(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists) override;
+	void Present() override;
+	void WaitForIdle() override;
+
+	void Resize(uint32_t NewWidth, uint32_t NewHeight) override;
+	void SetRenderScale(float Scale) override;
+
+	uint32_t GetWidth() const override { return Width; }
+	uint32_t GetHeight() const override { return Height; }
+	uint32_t GetCurrentFrameIndex() const override { return CurrentFrameIndex; }
+	uint32_t GetFrameCount() const override { return FrameCount; }
+
+	void SetFramePacing(const FramePacingDescription& Description) override;
+	const FramePacingStatistics& GetFramePacingStatistics() const override { return Pacer.GetStatistics(); }
+
+	const D3D12HeapAllocator& GetHeapAllocator() const { return HeapAllocator; }
+	// Barrier counts and transient memory of the last submitted frame
+	const RenderGraphStatistics& GetFrameGraphStatistics() const { return FrameGraph.GetStatistics(); }
+	// Barriers issued and elided by tracked command lists during the last presented frame
+	const ResourceStateStatistics& GetResourceStateStatistics() const { return LastFrameStateStatistics; }
+	// Blocking waits on the direct queue and the stalls deferred releases avoided
+	FenceTimelineStatistics GetFenceTimelineStatistics() const { return FrameTimeline->GetStatistics(); }
+
+private:
+	friend class D3D12CommandList;
+
+	HWND Window = nullptr;
+	std::wstring PathToAssets;
+	JobSystem* Jobs = nullptr;
+	MipFilter TextureMipFilter = MipFilter::Box;
+	VertexFormat GeometryFormat = VertexFormat::Float;
+	UINT Width = 0;
+	UINT Height = 0;
+	UINT FrameCount = 0;
+
+	// Cover the part of the render target the scene is drawn to, which is smaller than the output while scaled
+	D3D12_VIEWPORT Viewport = {};
+	D3D12_RECT ScissorRectangle = {};
+	float AspectRatio = 1.0f;
+
+	Microsoft::WRL::ComPtr<IDXGISwapChain4> SwapChain;
+	// Signalled whenever the present queue has room for another frame
+	HANDLE FrameLatencyWaitableObject = nullptr;
+	bool TearingSupported = false;
+	// ResizeBuffers has to be given the flags the swap chain was created with
+	UINT SwapChainFlags = 0;
+	Microsoft::WRL::ComPtr<ID3D12Device3> Device;
+	Microsoft::WRL::ComPtr<ID3D12Resource> RenderTargets[MaximumFrameCount];
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> RenderTargetHeap;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineState;
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> RootSignature;
+	D3D12PipelineStateCache PipelineStates;
+
+	// While the render scale is below one the scene is drawn into the top left of this target and upscaled into the
+	// back buffer. It keeps the largest output size seen, so neither a lower scale nor a smaller window reallocates it.
+	Microsoft::WRL::ComPtr<ID3D12Resource> SceneTarget;
+	D3D12HeapAllocation SceneTargetAllocation;
+	D3D12BindlessHeap::Handle SceneTargetDescriptor = DescriptorIndexAllocator::InvalidHandle;
+	UINT SceneTargetWidth = 0;
+	UINT SceneTargetHeight = 0;
+	// A new placed render target holds undefined compression metadata until it is discarded, which the scissored
+	// scene clear does not do
+	bool SceneTargetDiscardPending = false;
+	float RenderScale = 1.0f;
+	bool RenderingScaled = false;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> UpscalePipelineState;
+
+	std::unique_ptr<ShaderCache> Shaders;
+	std::unique_ptr<ShaderHotReloader> ShaderReloader;
+
+	// Published by the reloader thread and swapped in by AdvanceFrame, so a frame never mixes old and new shaders
+	std::mutex ReloadedPipelineStateMutex;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> ReloadedPipelineState;
+	std::atomic<bool> PipelineStateReloaded{ false };
+
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> FrameCommandAllocator[MaximumFrameCount];
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> BeginFrameCommandList;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> EndFrameCommandList;
+	RenderGraph FrameGraph;
+
+	static const UINT64 ResourceHeapSize = 64 * 1024 * 1024;
+	D3D12HeapAllocator HeapAllocator;
+
+	static const UINT64 UploadRingCapacity = 32 * 1024 * 1024;
+	D3D12UploadRing UploadRing;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> UploadCommandAllocator;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> UploadCommandList;
+
+	// The upload list tracks the states of the resources it fills; transitions it expects at its first use of
+	// a resource are resolved against the global states on a list submitted just ahead of it
+	ResourceStateRegistry ResourceStates;
+	ResourceStateTracker UploadStates{ ResourceStates };
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> StateResolveCommandList;
+	std::vector<ResourceStateBarrier> ResolvedBarriers;
+	ResourceStateStatistics LastFrameStateStatistics;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> PendingUploadHeaps;
+	bool UploadsPending = false;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBuffer;
+	D3D12HeapAllocation VertexBufferAllocation;
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView = {};
+	ResourceStateRegistry::Handle VertexBufferState = ResourceStateRegistry::InvalidHandle;
+	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBuffer;
+	D3D12HeapAllocation IndexBufferAllocation;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView = {};
+	ResourceStateRegistry::Handle IndexBufferState = ResourceStateRegistry::InvalidHandle;
+	Microsoft::WRL::ComPtr<ID3D12Resource> Texture;
+	D3D12HeapAllocation TextureAllocation;
+	// Streamed textures stay untracked, the copy queue leaves them in the common state for implicit promotion
+	ResourceStateRegistry::Handle TextureState = ResourceStateRegistry::InvalidHandle;
+
+	// Instance streams followed by the indirect arguments, one persistently mapped upload buffer per frame that the
+	// GPU reads in place. A frame's buffer is idle once the frame is current again, so it can grow without waiting.
+	struct InstanceUploadBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT8* Data = nullptr;
+		UINT64 Capacity = 0;
+	};
+	static const UINT64 MinimumInstanceBufferCapacity = 64 * 1024;
+	InstanceUploadBuffer InstanceBuffers[MaximumFrameCount];
+	UINT UploadedInstanceCount = 0;
+	UINT UploadedDrawCount = 0;
+	UINT64 IndirectArgumentOffset = 0;
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature> DrawCommandSignature;
+
+	// Every view lives in one shader-visible heap; draws select their texture by index through a root constant
+	static const uint32_t BindlessDescriptorCapacity = 65536;
+	D3D12BindlessHeap BindlessHeap;
+	D3D12BindlessHeap::Handle NullTextureDescriptor = DescriptorIndexAllocator::InvalidHandle;
+	D3D12BindlessHeap::Handle TextureDescriptor = DescriptorIndexAllocator::InvalidHandle;
+
+	struct CopyCommandAllocator
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		UINT64 FenceValue;
+	};
+
+	struct PendingStream
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		D3D12HeapAllocation Allocation;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+		TlsfAllocator::Handle StagingHandle;
+		UINT64 FenceValue;
+	};
+
+	// Streamed textures finish out of order, so their staging memory is sub-allocated rather than taken from a ring
+	static const UINT64 StreamingStagingCapacity = 64 * 1024 * 1024;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CopyCommandQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CopyCommandList;
+	std::deque<CopyCommandAllocator> CopyCommandAllocators;
+	Microsoft::WRL::ComPtr<ID3D12Fence1> CopyFence;
+	UINT64 CopyFenceValue = 0;
+	Microsoft::WRL::ComPtr<ID3D12Resource> StreamingStagingBuffer;
+	UINT8* StreamingStagingData = nullptr;
+	std::unique_ptr<TlsfAllocator> StreamingStagingAllocator;
+	std::unordered_map<uint64_t, PendingStream> Streams;
+	uint64_t NextStreamId = 1;
+
+	UINT RenderTargetDescriptorSize = 0;
+	UINT CurrentFrameIndex = 0;
+	HANDLE CopyFenceEvent = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Fence1> Fence;
+	UINT64 FenceValue = 0;
+	UINT64 FrameSignalValue[MaximumFrameCount] = {};
+	// Every wait on the direct queue goes through the timeline, and resources the GPU may still read are
+	// released by its completion thread once the fence value they were retired at has completed
+	D3D12TimelineFence TimelineFence;
+	std::unique_ptr<FenceTimeline> FrameTimeline;
+
+	// Every submitted list is timed, the parallel recorder adds one per worker
+	static const uint32_t MaximumGpuScopesPerFrame = 64;
+	Profiler* Profiling = nullptr;
+	D3D12GpuProfiler GpuProfiler;
+
+	SystemFramePacerClock PacerClock;
+	D3D12FrameFence PacerFence;
+	FramePacer Pacer{ PacerClock, PacerFence };
+
+	UploadAllocation AllocateUpload(UINT64 Size, UINT64 Alignment);
+	void FlushUploadBarriers();
+	D3D12_RESOURCE_DESC DescribeTexture(const TextureDescription& Description) const;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC DescribePipelineState(const ShaderBytecode& VertexShader, const ShaderBytecode& PixelShader) const;
+	static DXGI_FORMAT GetDxgiFormat(TextureFormat Format);
+	void CreateInstanceBuffer(InstanceUploadBuffer& Buffer, UINT64 Capacity);
+	void ReleasePlacedResource(Microsoft::WRL::ComPtr<ID3D12Resource>& Resource, D3D12HeapAllocation& Allocation);
+	void UploadGeometryBuffer(const void* Data, UINT Size, RenderGraphState FinalState, Microsoft::WRL::ComPtr<ID3D12Resource>& Buffer, D3D12HeapAllocation& Allocation, ResourceStateRegistry::Handle& State);
+	UINT GetActiveTextureIndex() const;
+	void BindTexture(Microsoft::WRL::ComPtr<ID3D12Resource> NewTexture, const D3D12HeapAllocation& NewAllocation);
+	void PromoteStreamedTextures();
+	void RetireResource(Microsoft::WRL::ComPtr<ID3D12Resource> Resource, const D3D12HeapAllocation& Allocation, D3D12BindlessHeap::Handle Descriptor, UINT64 RetiredFenceValue);
+	void CreateBackBufferViews();
+	void CreateSceneTarget(UINT TargetWidth, UINT TargetHeight);
+	void UpdateRenderArea();
+	void RecordUpscale(ID3D12GraphicsCommandList* CommandList);
+	D3D12_CPU_DESCRIPTOR_HANDLE GetBackBufferHandle() const;
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentRenderTargetHandle() const;
+	void WaitForGpu();
+	void SwapReloadedPipelineState();
+	void AdvanceFrame();
+};
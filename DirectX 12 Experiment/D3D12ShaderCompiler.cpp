@@ -0,0 +1,106 @@
+#include <d3dcompiler.h>
+
+#include "D3D12ShaderCompiler.h"
+#include <wrl.h>
+#include <memory>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+static std::string GetDirectory(const std::string& Path)
+{
+	const size_t Separator = Path.find_last_of("\\/");
+	return Separator == std::string::npos ? std::string() : Path.substr(0, Separator + 1);
+}
+
+// Serves #include from mapped files and records every file it opened
+class RecordingInclude : public ID3DInclude
+{
+public:
+	explicit RecordingInclude(const std::string& SourcePath)
+	{
+		Directories.push_back(GetDirectory(SourcePath));
+	}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR FileName, LPCVOID ParentData, LPCVOID* Data, UINT* Bytes) override
+	{
+		// Nested includes resolve against their parent, found by the data pointer handed out for it
+		std::string Directory = Directories.front();
+		for (size_t FileIndex = 0; FileIndex < OpenFiles.size(); FileIndex++)
+		{
+			if (ParentData != nullptr && OpenFiles[FileIndex]->GetData() == ParentData)
+			{
+				Directory = Directories[FileIndex + 1];
+			}
+		}
+
+		const std::string Path = Directory + FileName;
+		std::unique_ptr<MappedFile> File = std::make_unique<MappedFile>();
+		if (!File->Open(Path)) return E_FAIL;
+
+		*Data = File->GetData();
+		*Bytes = static_cast<UINT>(File->GetSize());
+		Includes.push_back(Path);
+		Directories.push_back(GetDirectory(Path));
+		OpenFiles.push_back(std::move(File));
+		return S_OK;
+	}
+
+	// Files stay mapped until the compile finishes, the compiler may still refer to them
+	HRESULT __stdcall Close(LPCVOID Data) override
+	{
+		return S_OK;
+	}
+
+	std::vector<std::string> Includes;
+
+private:
+	std::vector<std::string> Directories;
+	std::vector<std::unique_ptr<MappedFile>> OpenFiles;
+};
+
+ShaderCompileResult CompileShaderWithD3DCompiler(const ShaderCompileRequest& Request)
+{
+	ShaderCompileResult Result;
+
+	MappedFile Source;
+	if (!Source.Open(Request.Path))
+	{
+		Result.Messages = "Cannot open " + Request.Path;
+		return Result;
+	}
+
+	RecordingInclude Include(Request.Path);
+	ComPtr<ID3DBlob> Bytecode;
+	ComPtr<ID3DBlob> Errors;
+	const HRESULT CompileResult = D3DCompile(
+		Source.GetData(),
+		Source.GetSize(),
+		Request.Path.c_str(),
+		nullptr,
+		&Include,
+		Request.EntryPoint.c_str(),
+		Request.Profile.c_str(),
+		Request.Flags,
+		0,
+		&Bytecode,
+		&Errors
+	);
+
+	if (Errors != nullptr)
+	{
+		Result.Messages.assign(static_cast<const char*>(Errors->GetBufferPointer()), Errors->GetBufferSize());
+	}
+	if (FAILED(CompileResult)) return Result;
+
+	const uint8_t* Data = static_cast<const uint8_t*>(Bytecode->GetBufferPointer());
+	Result.Bytecode.assign(Data, Data + Bytecode->GetBufferSize());
+	Result.Includes = std::move(Include.Includes);
+	Result.Succeeded = true;
+	return Result;
+}
+
+std::string GetD3DCompilerIdentity()
+{
+	return "D3DCompiler_" + std::to_string(D3D_COMPILER_VERSION);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ShaderCache.h"
+#include <string>
+
+// Compiles HLSL with D3DCompile. Includes resolve against the directory of the including file and are
+// reported back so the shader cache can hash them.
+ShaderCompileResult CompileShaderWithD3DCompiler(const ShaderCompileRequest& Request);
+
+// Names the compiler library version, for ShaderCache keys
+std::string GetD3DCompilerIdentity();
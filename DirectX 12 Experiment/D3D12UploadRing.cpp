@@ -0,0 +1,64 @@
+#include "D3D12UploadRing.h"
+#include "D3D12Helpers.h"
+
+void D3D12UploadRing::Initialize(ID3D12Device* Device, UINT64 Capacity)
+{
+	D3D12_HEAP_PROPERTIES UploadHeapProperties;
+	UploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	UploadHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	UploadHeapProperties.CreationNodeMask = 1;
+	UploadHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	UploadHeapProperties.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC BufferDescription;
+	BufferDescription.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	BufferDescription.Format = DXGI_FORMAT_UNKNOWN;
+	BufferDescription.Width = Capacity;
+	BufferDescription.Height = 1;
+	BufferDescription.Alignment = 0;
+	BufferDescription.DepthOrArraySize = 1;
+	BufferDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+	BufferDescription.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	BufferDescription.MipLevels = 1;
+	BufferDescription.SampleDesc.Count = 1;
+	BufferDescription.SampleDesc.Quality = 0;
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&UploadHeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&BufferDescription,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&Buffer)
+	));
+
+	// Upload heaps may stay mapped for their whole lifetime, the CPU never reads back through this pointer
+	D3D12_RANGE ReadRange = {};
+	ThrowIfFailed(Buffer->Map(0, &ReadRange, reinterpret_cast<void**>(&MappedData)));
+	BaseGpuAddress = Buffer->GetGPUVirtualAddress();
+
+	Allocator = std::make_unique<LinearRingAllocator>(Capacity);
+}
+
+void D3D12UploadRing::Dispose()
+{
+	if (Buffer != nullptr)
+	{
+		Buffer->Unmap(0, nullptr);
+	}
+	MappedData = nullptr;
+	Buffer.Reset();
+	Allocator.reset();
+}
+
+bool D3D12UploadRing::TryAllocate(UINT64 Size, UINT64 Alignment, UploadAllocation& Allocation)
+{
+	const UINT64 Offset = Allocator->Allocate(Size, Alignment);
+	if (Offset == LinearRingAllocator::InvalidOffset) return false;
+
+	Allocation.Resource = Buffer.Get();
+	Allocation.Offset = Offset;
+	Allocation.CpuAddress = MappedData + Offset;
+	Allocation.GpuAddress = BaseGpuAddress + Offset;
+	return true;
+}
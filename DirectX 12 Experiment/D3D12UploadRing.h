@@ -0,0 +1,36 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+
+#include "LinearRingAllocator.h"
+#include <memory>
+
+struct UploadAllocation
+{
+	ID3D12Resource* Resource = nullptr;
+	UINT64 Offset = 0;
+	UINT8* CpuAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+};
+
+// One persistently mapped upload buffer shared by per-frame constants, dynamic vertices and staging copies
+class D3D12UploadRing
+{
+public:
+	void Initialize(ID3D12Device* Device, UINT64 Capacity);
+	void Dispose();
+
+	bool TryAllocate(UINT64 Size, UINT64 Alignment, UploadAllocation& Allocation);
+	void FinishFrame(UINT64 FenceValue) { Allocator->FinishFrame(FenceValue); }
+	void Retire(UINT64 CompletedFenceValue) { Allocator->Retire(CompletedFenceValue); }
+
+	UINT64 GetCapacity() const { return Allocator->GetCapacity(); }
+	const LinearRingAllocatorStatistics& GetStatistics() const { return Allocator->GetStatistics(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+	UINT8* MappedData = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS BaseGpuAddress = 0;
+	std::unique_ptr<LinearRingAllocator> Allocator;
+};
@@ -0,0 +1,65 @@
+#include "DescriptorIndexAllocator.h"
+
+#include <stdexcept>
+
+DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t Capacity) :
+	Capacity(Capacity)
+{
+	if (Capacity == 0 || Capacity > MaximumCapacity) throw std::runtime_error("Unsupported descriptor capacity");
+
+	NextFree.reset(new std::atomic<uint32_t>[Capacity]);
+	Generations.reset(new std::atomic<uint32_t>[Capacity]);
+
+	for (uint32_t Index = 0; Index < Capacity; Index++)
+	{
+		NextFree[Index].store(Index + 1 < Capacity ? Index + 1 : EndOfList, std::memory_order_relaxed);
+		Generations[Index].store(0, std::memory_order_relaxed);
+	}
+	FreeHead.store(0, std::memory_order_release);
+}
+
+DescriptorIndexAllocator::Handle DescriptorIndexAllocator::Allocate()
+{
+	uint64_t Head = FreeHead.load(std::memory_order_acquire);
+	uint32_t Index;
+	for (;;)
+	{
+		Index = static_cast<uint32_t>(Head);
+		if (Index == EndOfList) return InvalidHandle;
+
+		// Another thread may pop this slot first, in which case the link read here is stale and the tag rejects it
+		const uint64_t Next = NextFree[Index].load(std::memory_order_relaxed);
+		const uint64_t NewHead = (((Head >> 32) + 1) << 32) | Next;
+		if (FreeHead.compare_exchange_weak(Head, NewHead, std::memory_order_acq_rel, std::memory_order_acquire)) break;
+	}
+
+	AllocatedCount.fetch_add(1, std::memory_order_relaxed);
+	return MakeHandle(Index, Generations[Index].load(std::memory_order_relaxed));
+}
+
+bool DescriptorIndexAllocator::Free(Handle Allocation)
+{
+	const uint32_t Index = GetIndex(Allocation);
+	if (Index >= Capacity) return false;
+
+	// Retiring the generation first means only one of several racing frees of the same handle gets through
+	uint32_t Generation = Allocation >> IndexBits;
+	if (!Generations[Index].compare_exchange_strong(Generation, (Generation + 1) & GenerationMask, std::memory_order_acq_rel)) return false;
+
+	uint64_t Head = FreeHead.load(std::memory_order_relaxed);
+	uint64_t NewHead;
+	do
+	{
+		NextFree[Index].store(static_cast<uint32_t>(Head), std::memory_order_relaxed);
+		NewHead = (((Head >> 32) + 1) << 32) | Index;
+	} while (!FreeHead.compare_exchange_weak(Head, NewHead, std::memory_order_release, std::memory_order_relaxed));
+
+	AllocatedCount.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool DescriptorIndexAllocator::IsValid(Handle Allocation) const
+{
+	const uint32_t Index = GetIndex(Allocation);
+	return Index < Capacity && Generations[Index].load(std::memory_order_acquire) == Allocation >> IndexBits;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Lock-free free list over a fixed range of descriptor slots. Handles carry a generation next to the slot index,
+// so freeing a handle twice or using one after its slot was recycled is caught instead of silently aliasing.
+class DescriptorIndexAllocator
+{
+public:
+	using Handle = uint32_t;
+	static const Handle InvalidHandle = ~0u;
+
+	static const uint32_t IndexBits = 20;
+	static const uint32_t MaximumCapacity = (1u << IndexBits) - 1;
+
+	// Slots are handed out lowest index first until the first one is freed
+	explicit DescriptorIndexAllocator(uint32_t Capacity);
+
+	DescriptorIndexAllocator(const DescriptorIndexAllocator&) = delete;
+	DescriptorIndexAllocator& operator=(const DescriptorIndexAllocator&) = delete;
+
+	// Both are safe from any number of threads. Allocate returns InvalidHandle when every slot is in use,
+	// Free returns false for a handle that is stale or already freed.
+	Handle Allocate();
+	bool Free(Handle Allocation);
+
+	bool IsValid(Handle Allocation) const;
+	uint32_t GetCapacity() const { return Capacity; }
+	uint32_t GetAllocatedCount() const { return AllocatedCount.load(std::memory_order_relaxed); }
+
+	static uint32_t GetIndex(Handle Allocation) { return Allocation & IndexMask; }
+
+private:
+	static const uint32_t IndexMask = (1u << IndexBits) - 1;
+	static const uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+	static const uint32_t EndOfList = IndexMask;
+
+	uint32_t Capacity;
+
+	// Low half is the first free slot, high half a tag bumped on every change so a stale head never compares equal
+	std::atomic<uint64_t> FreeHead;
+	std::unique_ptr<std::atomic<uint32_t>[]> NextFree;
+	std::unique_ptr<std::atomic<uint32_t>[]> Generations;
+	std::atomic<uint32_t> AllocatedCount{ 0 };
+
+	static Handle MakeHandle(uint32_t Index, uint32_t Generation) { return (Generation << IndexBits) | Index; }
+};
@@ -0,0 +1,86 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DynamicResolutionController::DynamicResolutionController(const DynamicResolutionDescription& Description)
+{
+	Configure(Description);
+}
+
+void DynamicResolutionController::Configure(const DynamicResolutionDescription& NewDescription)
+{
+	if (!(NewDescription.BudgetMilliseconds > 0.0)) throw std::runtime_error("Dynamic resolution needs a positive frame time budget");
+	if (!(NewDescription.MinimumScale > 0.0f) || NewDescription.MinimumScale > NewDescription.MaximumScale || NewDescription.MaximumScale > 1.0f) throw std::runtime_error("Dynamic resolution scales must satisfy 0 < minimum <= maximum <= 1");
+	if (!(NewDescription.ScaleGranularity > 0.0f)) throw std::runtime_error("Dynamic resolution needs a positive scale granularity");
+
+	Description = NewDescription;
+	Reset();
+}
+
+void DynamicResolutionController::Reset()
+{
+	Scale = Description.MaximumScale;
+	SmoothedMilliseconds = 0.0;
+	HasSample = false;
+	SettleCountdown = 0;
+}
+
+float DynamicResolutionController::Update(double GpuFrameMilliseconds)
+{
+	if (SettleCountdown != 0)
+	{
+		SettleCountdown--;
+		return Scale;
+	}
+
+	// Asymmetric smoothing: a frame getting more expensive is believed quickly, a cheaper one only once it lasts
+	if (!HasSample)
+	{
+		SmoothedMilliseconds = GpuFrameMilliseconds;
+		HasSample = true;
+	}
+	else
+	{
+		const uint32_t SmoothingFrames = GpuFrameMilliseconds > SmoothedMilliseconds ? Description.FastSmoothingFrames : Description.SlowSmoothingFrames;
+		const double Weight = 2.0 / (static_cast<double>(SmoothingFrames) + 1.0);
+		SmoothedMilliseconds += (GpuFrameMilliseconds - SmoothedMilliseconds) * Weight;
+	}
+	if (!(SmoothedMilliseconds > 0.0)) return Scale;
+
+	const double AimMilliseconds = Description.BudgetMilliseconds * (1.0 - Description.Headroom);
+	const float Ideal = Scale * static_cast<float>(std::sqrt(AimMilliseconds / SmoothedMilliseconds));
+
+	float NewScale = Scale;
+	if (SmoothedMilliseconds > Description.BudgetMilliseconds)
+	{
+		NewScale = Quantize(std::max(Ideal, Description.MinimumScale));
+	}
+	else if (SmoothedMilliseconds < AimMilliseconds * (1.0 - Description.Hysteresis))
+	{
+		// The maximum need not be a multiple of the granularity, so reaching it is not left to the rounding
+		const float Limit = std::min(Scale + Description.MaximumIncrease, Description.MaximumScale);
+		NewScale = Ideal >= Limit && Limit == Description.MaximumScale ? Limit : Quantize(std::min(Ideal, Limit));
+	}
+	NewScale = std::min(std::max(NewScale, Description.MinimumScale), Description.MaximumScale);
+	if (NewScale == Scale) return Scale;
+
+	Scale = NewScale;
+	ScaleChanges++;
+	HasSample = false;
+	SettleCountdown = Description.SettleFrames;
+	return Scale;
+}
+
+uint32_t DynamicResolutionController::GetScaledSize(uint32_t Size, float Scale)
+{
+	const double Scaled = std::ceil(static_cast<double>(Size) * static_cast<double>(Scale) - 1e-6);
+	return std::min(Size, std::max(static_cast<uint32_t>(Scaled), 1u));
+}
+
+float DynamicResolutionController::Quantize(float Value) const
+{
+	// Rounded down so a step never lands above what the measurement allows
+	return std::floor(Value / Description.ScaleGranularity + 1e-4f) * Description.ScaleGranularity;
+}
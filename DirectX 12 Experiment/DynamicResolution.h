@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+struct DynamicResolutionDescription
+{
+	// GPU time a frame should stay below; the scale aims for the budget less the headroom
+	double BudgetMilliseconds = 16.0;
+	double Headroom = 0.1;
+	// The scale only grows once the frame time falls this far below the aim, which keeps it from oscillating
+	double Hysteresis = 0.15;
+
+	float MinimumScale = 0.5f;
+	float MaximumScale = 1.0f;
+	// Scales are multiples of this, so a noisy frame time does not change the resolution every frame
+	float ScaleGranularity = 1.0f / 32.0f;
+	// Largest step up at once; steps down go as far as the measurement asks for
+	float MaximumIncrease = 0.1f;
+
+	// GPU timestamps arrive frames late, so this many samples after a change still describe the old scale
+	uint32_t SettleFrames = 3;
+	// Rising frame times are followed within about FastSmoothingFrames, falling ones within SlowSmoothingFrames
+	uint32_t FastSmoothingFrames = 3;
+	uint32_t SlowSmoothingFrames = 16;
+};
+
+// Picks the internal render resolution from measured GPU frame times. GPU time is taken to follow the number of
+// pixels shaded, so the scale moves by the square root of the ratio between the aim and the measurement.
+class DynamicResolutionController
+{
+public:
+	explicit DynamicResolutionController(const DynamicResolutionDescription& Description = DynamicResolutionDescription());
+
+	// Starts over at the maximum scale
+	void Configure(const DynamicResolutionDescription& Description);
+	void Reset();
+
+	// Takes one GPU frame time in milliseconds and returns the scale to render the next frame at
+	float Update(double GpuFrameMilliseconds);
+	float GetScale() const { return Scale; }
+	double GetSmoothedFrameTime() const { return SmoothedMilliseconds; }
+	uint32_t GetScaleChangeCount() const { return ScaleChanges; }
+
+	// Rounded up to whole pixels and never below one
+	static uint32_t GetScaledSize(uint32_t Size, float Scale);
+
+private:
+	DynamicResolutionDescription Description;
+	float Scale = 1.0f;
+	double SmoothedMilliseconds = 0.0;
+	bool HasSample = false;
+	uint32_t SettleCountdown = 0;
+	uint32_t ScaleChanges = 0;
+
+	float Quantize(float Value) const;
+};
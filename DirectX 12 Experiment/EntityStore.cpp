@@ -0,0 +1,242 @@
+#include "EntityStore.h"
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+// Pops the lowest component id out of a mask
+static uint32_t PopComponentId(uint64_t& Mask)
+{
+	uint32_t Id = 0;
+	while (((Mask >> Id) & 1) == 0) Id++;
+	Mask &= Mask - 1;
+	return Id;
+}
+
+void EntityStore::Destroy(Entity Target)
+{
+	const EntityRecord* Record = FindRecord(Target);
+	if (Record == nullptr) throw std::runtime_error("Destroyed a stale entity handle");
+
+	const EntityRecord Removed = *Record;
+	RemoveRow(Removed);
+
+	EntityRecord& Dead = Records[static_cast<uint32_t>(Target)];
+	Dead.ArchetypeIndex = DeadArchetype;
+	Dead.Generation++;
+	FreeRecords.push_back(static_cast<uint32_t>(Target));
+	EntityCount--;
+}
+
+bool EntityStore::IsAlive(Entity Target) const
+{
+	return FindRecord(Target) != nullptr;
+}
+
+EntityStoreStatistics EntityStore::GetStatistics() const
+{
+	EntityStoreStatistics Statistics;
+	Statistics.EntityCount = EntityCount;
+	Statistics.ArchetypeCount = static_cast<uint32_t>(Archetypes.size());
+	Statistics.PooledChunkCount = static_cast<uint32_t>(PooledChunks.size());
+
+	Statistics.BookkeepingBytes = Records.capacity() * sizeof(EntityRecord) + FreeRecords.capacity() * sizeof(uint32_t) + Archetypes.capacity() * sizeof(Archetype) + PooledChunks.capacity() * sizeof(PooledChunks[0]);
+	Statistics.BookkeepingBytes += ArchetypeIndices.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + 2 * sizeof(void*)) + ArchetypeIndices.bucket_count() * sizeof(void*);
+	for (const Archetype& Type : Archetypes)
+	{
+		Statistics.ChunkCount += static_cast<uint32_t>(Type.Chunks.size());
+		Statistics.BookkeepingBytes += Type.Chunks.capacity() * sizeof(Chunk);
+	}
+	Statistics.ChunkBytes = static_cast<uint64_t>(Statistics.ChunkCount + Statistics.PooledChunkCount) * ChunkSize;
+	return Statistics;
+}
+
+uint32_t EntityStore::AllocateComponentId()
+{
+	static std::atomic<uint32_t> NextId{ 0 };
+	const uint32_t Id = NextId.fetch_add(1);
+	if (Id >= MaximumComponentTypes) throw std::runtime_error("Too many component types");
+	return Id;
+}
+
+void EntityStore::RegisterComponent(uint32_t Id, uint32_t Size, uint32_t Alignment)
+{
+	// Chunks come from plain new, which only guarantees fundamental alignment
+	if (Alignment > alignof(std::max_align_t)) throw std::runtime_error("Component alignment exceeds what chunks provide");
+	ComponentSizes[Id] = Size;
+	ComponentAlignments[Id] = Alignment;
+}
+
+EntityStore::Entity EntityStore::CreateEntity(uint64_t Mask)
+{
+	const uint32_t ArchetypeIndex = GetArchetype(Mask);
+
+	uint32_t Index;
+	if (!FreeRecords.empty())
+	{
+		Index = FreeRecords.back();
+		FreeRecords.pop_back();
+	}
+	else
+	{
+		Index = static_cast<uint32_t>(Records.size());
+		if (Index == DeadArchetype) throw std::runtime_error("Too many entities");
+		Records.push_back({ DeadArchetype, 0, 0, 0 });
+	}
+
+	EntityRecord& Record = Records[Index];
+	const Entity Created = (static_cast<uint64_t>(Record.Generation) << 32) | Index;
+	AllocateRow(ArchetypeIndex, Created, Record);
+	EntityCount++;
+	return Created;
+}
+
+uint8_t* EntityStore::ChangeComponents(Entity Target, uint32_t ComponentId, bool Adding)
+{
+	const EntityRecord* Found = FindRecord(Target);
+	if (Found == nullptr) throw std::runtime_error("Changed components of a stale entity handle");
+
+	const EntityRecord Old = *Found;
+	const uint64_t OldMask = Archetypes[Old.ArchetypeIndex].Mask;
+	const uint64_t NewMask = Adding ? OldMask | (1ull << ComponentId) : OldMask & ~(1ull << ComponentId);
+	if (NewMask == OldMask) return Adding ? GetComponentData(Old, ComponentId) : nullptr;
+
+	// Looked up first, a new archetype may move the others
+	const uint32_t NewArchetype = GetArchetype(NewMask);
+	EntityRecord& Record = Records[static_cast<uint32_t>(Target)];
+	AllocateRow(NewArchetype, Target, Record);
+
+	// The new row starts zeroed, only components both archetypes have are carried over
+	for (uint64_t Shared = OldMask & NewMask; Shared != 0;)
+	{
+		const uint32_t Id = PopComponentId(Shared);
+		memcpy(GetComponentData(Record, Id), GetComponentData(Old, Id), ComponentSizes[Id]);
+	}
+	RemoveRow(Old);
+	return Adding ? GetComponentData(Record, ComponentId) : nullptr;
+}
+
+uint8_t* EntityStore::FindComponent(Entity Target, uint32_t ComponentId)
+{
+	const EntityRecord* Record = FindRecord(Target);
+	if (Record == nullptr || (Archetypes[Record->ArchetypeIndex].Mask & (1ull << ComponentId)) == 0) return nullptr;
+	return GetComponentData(*Record, ComponentId);
+}
+
+const EntityStore::EntityRecord* EntityStore::FindRecord(Entity Target) const
+{
+	const uint32_t Index = static_cast<uint32_t>(Target);
+	if (Index >= Records.size()) return nullptr;
+
+	const EntityRecord& Record = Records[Index];
+	if (Record.ArchetypeIndex == DeadArchetype || Record.Generation != static_cast<uint32_t>(Target >> 32)) return nullptr;
+	return &Record;
+}
+
+uint32_t EntityStore::GetArchetype(uint64_t Mask)
+{
+	auto Found = ArchetypeIndices.find(Mask);
+	if (Found != ArchetypeIndices.end()) return Found->second;
+
+	Archetype Type;
+	Type.Mask = Mask;
+	memset(Type.Offsets, 0, sizeof(Type.Offsets));
+
+	uint32_t RowBytes = sizeof(Entity);
+	for (uint64_t Remaining = Mask; Remaining != 0;)
+	{
+		RowBytes += ComponentSizes[PopComponentId(Remaining)];
+	}
+
+	// Aligning each array can push the last one past the end of the chunk, in which case one row less fits
+	for (Type.Capacity = ChunkSize / RowBytes; Type.Capacity > 0; Type.Capacity--)
+	{
+		uint32_t Offset = sizeof(Entity) * Type.Capacity;
+		for (uint64_t Remaining = Mask; Remaining != 0;)
+		{
+			const uint32_t Id = PopComponentId(Remaining);
+			Offset = (Offset + ComponentAlignments[Id] - 1) & ~(ComponentAlignments[Id] - 1);
+			Type.Offsets[Id] = Offset;
+			Offset += ComponentSizes[Id] * Type.Capacity;
+		}
+		if (Offset <= ChunkSize) break;
+	}
+	if (Type.Capacity == 0) throw std::runtime_error("Components do not fit in one chunk");
+
+	const uint32_t Index = static_cast<uint32_t>(Archetypes.size());
+	Archetypes.push_back(std::move(Type));
+	ArchetypeIndices.emplace(Mask, Index);
+	return Index;
+}
+
+void EntityStore::AllocateRow(uint32_t ArchetypeIndex, Entity Owner, EntityRecord& Record)
+{
+	Archetype& Type = Archetypes[ArchetypeIndex];
+	if (Type.Chunks.empty() || Type.Chunks.back().Count == Type.Capacity)
+	{
+		Chunk NewChunk;
+		if (!PooledChunks.empty())
+		{
+			NewChunk.Data = std::move(PooledChunks.back());
+			PooledChunks.pop_back();
+		}
+		else
+		{
+			NewChunk.Data.reset(new uint8_t[ChunkSize]);
+		}
+		NewChunk.Count = 0;
+		Type.Chunks.push_back(std::move(NewChunk));
+	}
+
+	Chunk& Block = Type.Chunks.back();
+	Record.ArchetypeIndex = ArchetypeIndex;
+	Record.ChunkIndex = static_cast<uint32_t>(Type.Chunks.size() - 1);
+	Record.Row = Block.Count++;
+	reinterpret_cast<Entity*>(Block.Data.get())[Record.Row] = Owner;
+
+	for (uint64_t Remaining = Type.Mask; Remaining != 0;)
+	{
+		const uint32_t Id = PopComponentId(Remaining);
+		memset(GetComponentData(Record, Id), 0, ComponentSizes[Id]);
+	}
+}
+
+void EntityStore::RemoveRow(const EntityRecord& Record)
+{
+	Archetype& Type = Archetypes[Record.ArchetypeIndex];
+	Chunk& Last = Type.Chunks.back();
+	const uint32_t LastChunkIndex = static_cast<uint32_t>(Type.Chunks.size() - 1);
+	const uint32_t LastRow = Last.Count - 1;
+
+	// The archetype's last entity fills the hole, so every chunk but the last stays full
+	if (Record.ChunkIndex != LastChunkIndex || Record.Row != LastRow)
+	{
+		const EntityRecord Source = { Record.ArchetypeIndex, LastChunkIndex, LastRow, 0 };
+		const Entity Moved = reinterpret_cast<const Entity*>(Last.Data.get())[LastRow];
+		reinterpret_cast<Entity*>(Type.Chunks[Record.ChunkIndex].Data.get())[Record.Row] = Moved;
+		for (uint64_t Remaining = Type.Mask; Remaining != 0;)
+		{
+			const uint32_t Id = PopComponentId(Remaining);
+			memcpy(GetComponentData(Record, Id), GetComponentData(Source, Id), ComponentSizes[Id]);
+		}
+
+		EntityRecord& MovedRecord = Records[static_cast<uint32_t>(Moved)];
+		MovedRecord.ChunkIndex = Record.ChunkIndex;
+		MovedRecord.Row = Record.Row;
+	}
+
+	if (--Last.Count == 0)
+	{
+		if (PooledChunks.size() < MaximumPooledChunks)
+		{
+			PooledChunks.push_back(std::move(Last.Data));
+		}
+		Type.Chunks.pop_back();
+	}
+}
+
+uint8_t* EntityStore::GetComponentData(const EntityRecord& Record, uint32_t ComponentId)
+{
+	const Archetype& Type = Archetypes[Record.ArchetypeIndex];
+	return Type.Chunks[Record.ChunkIndex].Data.get() + Type.Offsets[ComponentId] + static_cast<size_t>(Record.Row) * ComponentSizes[ComponentId];
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "JobSystem.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct EntityStoreStatistics
+{
+	uint32_t EntityCount = 0;
+	uint32_t ArchetypeCount = 0;
+	uint32_t ChunkCount = 0;
+	uint32_t PooledChunkCount = 0;
+	uint64_t ChunkBytes = 0;
+	// Entity records, free lists and archetype tables, everything besides the chunks
+	uint64_t BookkeepingBytes = 0;
+};
+
+// Entities grouped by their exact set of components, their archetype, into fixed-size chunks. Inside a chunk every
+// component type is its own packed array, so a system touching two components streams through just those two.
+// Handles stay valid while entities move between chunks and are rejected once the entity is destroyed.
+// Adding, removing, creating and destroying is single threaded; ParallelForEachChunk may only write components.
+class EntityStore
+{
+public:
+	using Entity = uint64_t;
+	static const Entity InvalidEntity = ~0ull;
+
+	static const uint32_t MaximumComponentTypes = 64;
+	static const uint32_t ChunkSize = 16 * 1024;
+
+	EntityStore() = default;
+
+	EntityStore(const EntityStore&) = delete;
+	EntityStore& operator=(const EntityStore&) = delete;
+
+	// Components start zeroed
+	template <typename... Components>
+	Entity Create()
+	{
+		return CreateEntity(GetMask<Components...>());
+	}
+
+	void Destroy(Entity Target);
+	bool IsAlive(Entity Target) const;
+
+	// Adding a component the entity already has overwrites it. Both throw for a stale handle.
+	template <typename Component>
+	void Add(Entity Target, const Component& Value)
+	{
+		memcpy(ChangeComponents(Target, GetComponentId<Component>(), true), &Value, sizeof(Component));
+	}
+
+	template <typename Component>
+	void Remove(Entity Target)
+	{
+		ChangeComponents(Target, GetComponentId<Component>(), false);
+	}
+
+	// Null when the entity is dead or lacks the component, otherwise valid until the next structural change
+	template <typename Component>
+	Component* Get(Entity Target)
+	{
+		return reinterpret_cast<Component*>(FindComponent(Target, GetComponentId<Component>()));
+	}
+
+	// Visit(uint32_t Count, const Entity* Entities, Components*... Arrays) runs once for every chunk whose archetype
+	// has all of Components, with one array of Count entries per component
+	template <typename... Components, typename Function>
+	void ForEachChunk(Function&& Visit)
+	{
+		const uint64_t Mask = GetMask<Components...>();
+		for (Archetype& Type : Archetypes)
+		{
+			if ((Type.Mask & Mask) != Mask) continue;
+			for (Chunk& Block : Type.Chunks)
+			{
+				Visit(Block.Count, reinterpret_cast<const Entity*>(Block.Data.get()), reinterpret_cast<Components*>(Block.Data.get() + Type.Offsets[GetComponentId<Components>()])...);
+			}
+		}
+	}
+
+	// Same visit with chunks spread over the job system, so Visit may run on several threads at once
+	template <typename... Components, typename Function>
+	void ParallelForEachChunk(JobSystem& Jobs, Function&& Visit)
+	{
+		// Registers the components here, so the workers below only read the store
+		const uint64_t Mask = GetMask<Components...>();
+
+		std::vector<std::pair<uint32_t, uint32_t>> Matches;
+		for (uint32_t TypeIndex = 0; TypeIndex < Archetypes.size(); TypeIndex++)
+		{
+			if ((Archetypes[TypeIndex].Mask & Mask) != Mask) continue;
+			for (uint32_t ChunkIndex = 0; ChunkIndex < Archetypes[TypeIndex].Chunks.size(); ChunkIndex++)
+			{
+				Matches.emplace_back(TypeIndex, ChunkIndex);
+			}
+		}
+
+		Jobs.ParallelFor(0, static_cast<uint32_t>(Matches.size()), 0, [&](uint32_t Begin, uint32_t End)
+		{
+			for (uint32_t Match = Begin; Match < End; Match++)
+			{
+				Archetype& Type = Archetypes[Matches[Match].first];
+				Chunk& Block = Type.Chunks[Matches[Match].second];
+				Visit(Block.Count, reinterpret_cast<const Entity*>(Block.Data.get()), reinterpret_cast<Components*>(Block.Data.get() + Type.Offsets[GetComponentId<Components>()])...);
+			}
+		});
+	}
+
+	uint32_t GetEntityCount() const { return EntityCount; }
+	EntityStoreStatistics GetStatistics() const;
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<uint8_t[]> Data;
+		uint32_t Count;
+	};
+
+	// Chunks start with the entity handles, followed by one array per component in component id order
+	struct Archetype
+	{
+		uint64_t Mask;
+		uint32_t Capacity;
+		uint32_t Offsets[MaximumComponentTypes];
+		std::vector<Chunk> Chunks;
+	};
+
+	struct EntityRecord
+	{
+		uint32_t ArchetypeIndex;
+		uint32_t ChunkIndex;
+		uint32_t Row;
+		uint32_t Generation;
+	};
+
+	static const uint32_t DeadArchetype = ~0u;
+	static const uint32_t MaximumPooledChunks = 64;
+
+	uint32_t ComponentSizes[MaximumComponentTypes] = {};
+	uint32_t ComponentAlignments[MaximumComponentTypes] = {};
+	std::vector<Archetype> Archetypes;
+	std::unordered_map<uint64_t, uint32_t> ArchetypeIndices;
+	std::vector<EntityRecord> Records;
+	std::vector<uint32_t> FreeRecords;
+	std::vector<std::unique_ptr<uint8_t[]>> PooledChunks;
+	uint32_t EntityCount = 0;
+
+	// Ids are shared by every store, a component type keeps its id for the lifetime of the program
+	template <typename Component>
+	uint32_t GetComponentId()
+	{
+		static_assert(std::is_trivially_copyable<Component>::value, "Components are moved between chunks with memcpy");
+		static const uint32_t Id = AllocateComponentId();
+		if (ComponentSizes[Id] == 0)
+		{
+			RegisterComponent(Id, sizeof(Component), alignof(Component));
+		}
+		return Id;
+	}
+
+	template <typename... Components>
+	uint64_t GetMask()
+	{
+		uint64_t Mask = 0;
+		const int Expand[] = { 0, (Mask |= 1ull << GetComponentId<Components>(), 0)... };
+		(void)Expand;
+		return Mask;
+	}
+
+	static uint32_t AllocateComponentId();
+	void RegisterComponent(uint32_t Id, uint32_t Size, uint32_t Alignment);
+
+	Entity CreateEntity(uint64_t Mask);
+	uint8_t* ChangeComponents(Entity Target, uint32_t ComponentId, bool Adding);
+	uint8_t* FindComponent(Entity Target, uint32_t ComponentId);
+	const EntityRecord* FindRecord(Entity Target) const;
+
+	uint32_t GetArchetype(uint64_t Mask);
+	void AllocateRow(uint32_t ArchetypeIndex, Entity Owner, EntityRecord& Record);
+	void RemoveRow(const EntityRecord& Record);
+	uint8_t* GetComponentData(const EntityRecord& Record, uint32_t ComponentId);
+};
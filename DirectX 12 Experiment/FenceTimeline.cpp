@@ -0,0 +1,143 @@
+#include "FenceTimeline.h"
+
+#include <algorithm>
+#include <vector>
+
+FenceTimeline::FenceTimeline(TimelineFence& Fence) :
+	Fence(Fence)
+{
+	Thread = std::thread(&FenceTimeline::CompletionMain, this);
+}
+
+FenceTimeline::~FenceTimeline()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Stopping = true;
+		WorkQueued.notify_one();
+		Progressed.notify_all();
+		Fence.Interrupt();
+	}
+	Thread.join();
+}
+
+void FenceTimeline::Wait(uint64_t Value)
+{
+	WaitCount.fetch_add(1, std::memory_order_relaxed);
+	if (Fence.GetCompletedValue() >= Value) return;
+
+	const std::chrono::steady_clock::time_point WaitBegin = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> Lock(Mutex);
+	const auto Waited = WaitedValues.insert(Value);
+	WakeForValue(Value);
+	Progressed.wait(Lock, [this, Value] { return ObservedValue >= Value || Stopping; });
+	WaitedValues.erase(Waited);
+
+	Statistics.StalledWaits++;
+	Statistics.StallTime += std::chrono::steady_clock::now() - WaitBegin;
+}
+
+void FenceTimeline::OnCompleted(uint64_t Value, Callback Function)
+{
+	PendingCallback Pending;
+	Pending.Function = std::move(Function);
+	Pending.Queued = std::chrono::steady_clock::now();
+
+	// Equal values keep the order they were queued in
+	std::lock_guard<std::mutex> Lock(Mutex);
+	Callbacks.emplace(Value, std::move(Pending));
+	WakeForValue(Value);
+}
+
+void FenceTimeline::Flush()
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	Progressed.wait(Lock, [this] { return (Callbacks.empty() && !RunningCallbacks) || Stopping; });
+}
+
+FenceTimelineStatistics FenceTimeline::GetStatistics() const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	FenceTimelineStatistics Result = Statistics;
+	Result.Waits = WaitCount.load(std::memory_order_relaxed);
+	return Result;
+}
+
+void FenceTimeline::CompletionMain()
+{
+	std::vector<PendingCallback> Ready;
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while (!Stopping)
+	{
+		if (Callbacks.empty() && WaitedValues.empty())
+		{
+			Sleeping = true;
+			WorkQueued.wait(Lock);
+			Sleeping = false;
+			continue;
+		}
+
+		// Only the nearest value is waited for, everything queued behind it is picked up on the way
+		TargetValue = Callbacks.empty() ? *WaitedValues.begin() : Callbacks.begin()->first;
+		if (!WaitedValues.empty()) TargetValue = std::min(TargetValue, *WaitedValues.begin());
+		const uint64_t Target = TargetValue;
+		Lock.unlock();
+		Fence.WaitForValue(Target);
+		const uint64_t CompletedValue = Fence.GetCompletedValue();
+		Lock.lock();
+		TargetValue = 0;
+
+		// Waiters are released before the callbacks run, which may take a while
+		if (CompletedValue > ObservedValue)
+		{
+			ObservedValue = CompletedValue;
+			Progressed.notify_all();
+		}
+
+		const auto ReadyEnd = Callbacks.upper_bound(CompletedValue);
+		if (ReadyEnd == Callbacks.begin()) continue;
+		for (auto Pending = Callbacks.begin(); Pending != ReadyEnd; ++Pending)
+		{
+			Ready.push_back(std::move(Pending->second));
+		}
+		Callbacks.erase(Callbacks.begin(), ReadyEnd);
+		RunningCallbacks = true;
+		Lock.unlock();
+
+		// A thread that blocked at each enqueue would have resumed here; overlapping waits only count once
+		const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point EarliestQueued = Now;
+		for (PendingCallback& Pending : Ready)
+		{
+			EarliestQueued = std::min(EarliestQueued, Pending.Queued);
+			Pending.Function();
+		}
+		const size_t ReadyCount = Ready.size();
+		// Destroyed outside the lock as well, since releasing what the callbacks captured is often their point
+		Ready.clear();
+
+		Lock.lock();
+		const std::chrono::steady_clock::time_point AvoidedFrom = std::max(EarliestQueued, AvoidedUntil);
+		if (Now > AvoidedFrom)
+		{
+			Statistics.AvoidedStallTime += Now - AvoidedFrom;
+			AvoidedUntil = Now;
+		}
+		Statistics.CallbacksRun += ReadyCount;
+		RunningCallbacks = false;
+		Progressed.notify_all();
+	}
+}
+
+void FenceTimeline::WakeForValue(uint64_t Value)
+{
+	// A completion thread that is busy looks at the queues again before it blocks, so only a blocked one is woken
+	if (Sleeping)
+	{
+		WorkQueued.notify_one();
+	}
+	else if (Value < TargetValue)
+	{
+		Fence.Interrupt();
+	}
+}
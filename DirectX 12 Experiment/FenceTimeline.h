@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// A monotonically increasing fence the GPU signals, behind an interface so the timeline can run against a
+// simulated one. Only the completion thread of a FenceTimeline waits on it.
+class TimelineFence
+{
+public:
+	virtual ~TimelineFence() = default;
+
+	virtual uint64_t GetCompletedValue() = 0;
+	// Blocks until Value has completed or Interrupt is called; an interrupt before the wait makes it return at once
+	virtual void WaitForValue(uint64_t Value) = 0;
+	// Called from any thread
+	virtual void Interrupt() = 0;
+};
+
+struct FenceTimelineStatistics
+{
+	// Calls to Wait, and those that found the value incomplete and had to block
+	uint64_t Waits = 0;
+	uint64_t StalledWaits = 0;
+	std::chrono::nanoseconds StallTime{ 0 };
+
+	// Callbacks run by the completion thread, and the time a thread blocking at each enqueue until its value
+	// completed would have lost, overlapping waits counted once
+	uint64_t CallbacksRun = 0;
+	std::chrono::nanoseconds AvoidedStallTime{ 0 };
+};
+
+// Tracks a fence on a thread of its own so nothing else has to block on it. Any number of threads may wait for a
+// value at once, poll it, or queue a callback that the completion thread runs once the value completes, which is
+// how resources still referenced by frames in flight are released without stalling the frame loop.
+class FenceTimeline
+{
+public:
+	using Callback = std::function<void()>;
+
+	explicit FenceTimeline(TimelineFence& Fence);
+	// Callbacks still pending are destroyed without running, which still releases what they captured
+	~FenceTimeline();
+
+	FenceTimeline(const FenceTimeline&) = delete;
+	FenceTimeline& operator=(const FenceTimeline&) = delete;
+
+	uint64_t GetCompletedValue() { return Fence.GetCompletedValue(); }
+	bool IsCompleted(uint64_t Value) { return Fence.GetCompletedValue() >= Value; }
+	void Wait(uint64_t Value);
+
+	// Callbacks run in fence value order on the completion thread; they must not throw or call back into the timeline
+	void OnCompleted(uint64_t Value, Callback Function);
+	// Returns once no callback is pending, so the values they wait for have to be signalled already
+	void Flush();
+
+	FenceTimelineStatistics GetStatistics() const;
+
+private:
+	struct PendingCallback
+	{
+		Callback Function;
+		std::chrono::steady_clock::time_point Queued;
+	};
+
+	TimelineFence& Fence;
+
+	mutable std::mutex Mutex;
+	std::condition_variable WorkQueued;
+	std::condition_variable Progressed;
+	std::multimap<uint64_t, PendingCallback> Callbacks;
+	std::multiset<uint64_t> WaitedValues;
+	// The value the completion thread is blocked on in the fence, zero while it is doing anything else
+	uint64_t TargetValue = 0;
+	uint64_t ObservedValue = 0;
+	bool Sleeping = false;
+	bool RunningCallbacks = false;
+	bool Stopping = false;
+
+	std::atomic<uint64_t> WaitCount{ 0 };
+	FenceTimelineStatistics Statistics;
+	std::chrono::steady_clock::time_point AvoidedUntil;
+
+	std::thread Thread;
+
+	void CompletionMain();
+	void WakeForValue(uint64_t Value);
+};
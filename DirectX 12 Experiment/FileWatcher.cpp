@@ -0,0 +1,104 @@
+#include "FileWatcher.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+FileWatcher::FileWatcher(const std::string& Directory)
+{
+	const int Length = MultiByteToWideChar(CP_UTF8, 0, Directory.c_str(), static_cast<int>(Directory.size()), nullptr, 0);
+	std::wstring WideDirectory(static_cast<size_t>(Length), L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, Directory.c_str(), static_cast<int>(Directory.size()), &WideDirectory[0], Length);
+
+	const DWORD Filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+	ChangeHandle = FindFirstChangeNotificationW(WideDirectory.c_str(), FALSE, Filter);
+	if (ChangeHandle == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to watch " + Directory);
+
+	CancelEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (CancelEvent == nullptr)
+	{
+		FindCloseChangeNotification(ChangeHandle);
+		throw std::runtime_error("Failed to create file watcher event");
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	FindCloseChangeNotification(ChangeHandle);
+	CloseHandle(CancelEvent);
+}
+
+FileWatchResult FileWatcher::Wait(uint32_t TimeoutMilliseconds)
+{
+	// The cancel event comes first so it wins when both are signaled
+	const HANDLE Handles[] = { CancelEvent, ChangeHandle };
+	const DWORD Result = WaitForMultipleObjects(2, Handles, FALSE, TimeoutMilliseconds == Infinite ? INFINITE : TimeoutMilliseconds);
+	if (Result == WAIT_TIMEOUT) return FileWatchResult::TimedOut;
+	if (Result != WAIT_OBJECT_0 + 1) return FileWatchResult::Cancelled;
+
+	FindNextChangeNotification(ChangeHandle);
+	return FileWatchResult::Changed;
+}
+
+void FileWatcher::Cancel()
+{
+	SetEvent(CancelEvent);
+}
+#else
+FileWatcher::FileWatcher(const std::string& Directory)
+{
+	NotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (NotifyDescriptor < 0) throw std::runtime_error("Failed to create inotify instance");
+
+	const uint32_t Mask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+	if (inotify_add_watch(NotifyDescriptor, Directory.c_str(), Mask) < 0 || pipe2(CancelPipe, O_NONBLOCK | O_CLOEXEC) != 0)
+	{
+		close(NotifyDescriptor);
+		throw std::runtime_error("Failed to watch " + Directory);
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	close(NotifyDescriptor);
+	close(CancelPipe[0]);
+	close(CancelPipe[1]);
+}
+
+FileWatchResult FileWatcher::Wait(uint32_t TimeoutMilliseconds)
+{
+	pollfd Descriptors[2] = {};
+	Descriptors[0].fd = CancelPipe[0];
+	Descriptors[0].events = POLLIN;
+	Descriptors[1].fd = NotifyDescriptor;
+	Descriptors[1].events = POLLIN;
+
+	const int Ready = poll(Descriptors, 2, TimeoutMilliseconds == Infinite ? -1 : static_cast<int>(TimeoutMilliseconds));
+	if (Ready == 0 || (Ready < 0 && errno == EINTR)) return FileWatchResult::TimedOut;
+	if (Ready < 0 || (Descriptors[0].revents & POLLIN) != 0) return FileWatchResult::Cancelled;
+
+	// Events only say that something happened, so they are drained without being parsed
+	alignas(inotify_event) char Events[4096];
+	while (read(NotifyDescriptor, Events, sizeof(Events)) > 0)
+	{
+	}
+	return FileWatchResult::Changed;
+}
+
+void FileWatcher::Cancel()
+{
+	// A full pipe means Cancel already ran, so a failed write changes nothing
+	const char Signal = 1;
+	const ssize_t Written = write(CancelPipe[1], &Signal, 1);
+	(void)Written;
+}
+#endif
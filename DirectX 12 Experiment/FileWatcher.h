@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class FileWatchResult
+{
+	Changed,
+	TimedOut,
+	Cancelled
+};
+
+// Blocks a thread on change notifications for the files directly inside one directory. Only the fact that
+// something changed is reported; callers find out what by looking, which also absorbs editors that save in steps.
+class FileWatcher
+{
+public:
+	// Throws when the directory cannot be watched. The path is UTF-8.
+	explicit FileWatcher(const std::string& Directory);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	static const uint32_t Infinite = ~0u;
+
+	// Returns as soon as anything was written, created, renamed or deleted since the previous call
+	FileWatchResult Wait(uint32_t TimeoutMilliseconds = Infinite);
+
+	// Wakes the waiting thread; every later Wait returns Cancelled. Safe from any thread.
+	void Cancel();
+
+private:
+#ifdef _WIN32
+	void* ChangeHandle = nullptr;
+	void* CancelEvent = nullptr;
+#else
+	int NotifyDescriptor = -1;
+	int CancelPipe[2] = { -1, -1 };
+#endif
+};
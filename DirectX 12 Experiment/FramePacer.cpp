@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// Bounds the spinning a single outlier, such as the process being descheduled, can cause on every later frame
+static const std::chrono::nanoseconds MaximumSleepMargin = std::chrono::milliseconds(4);
+
+std::chrono::nanoseconds SystemFramePacerClock::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void SystemFramePacerClock::Sleep(std::chrono::nanoseconds Duration)
+{
+	std::this_thread::sleep_for(Duration);
+}
+
+FramePacer::FramePacer(FramePacerClock& Clock, FramePacerFence& Fence) :
+	Clock(Clock),
+	Fence(Fence),
+	SleepMargin(Description.SpinThreshold)
+{
+}
+
+void FramePacer::Configure(const FramePacingDescription& NewDescription)
+{
+	if (NewDescription.FramesInFlight == 0) throw std::runtime_error("At least one frame has to be in flight");
+	if (NewDescription.Mode == PresentMode::Capped && !(NewDescription.TargetFramesPerSecond > 0.0)) throw std::runtime_error("Capped presentation needs a positive frame rate");
+
+	Description = NewDescription;
+	SleepMargin = Description.SpinThreshold;
+}
+
+void FramePacer::BeginFrame()
+{
+	Statistics.FenceWait = std::chrono::nanoseconds(0);
+	Statistics.PacingWait = std::chrono::nanoseconds(0);
+
+	// In the low latency mode this is the only wait, so input sampled right after it is as fresh as it can be.
+	// The other modes already waited in EndFrame and only get here with work pending after lowering the count.
+	WaitForFramesInFlight(Description.FramesInFlight - 1);
+
+	if (Description.Mode == PresentMode::Capped)
+	{
+		const std::chrono::nanoseconds Interval = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / Description.TargetFramesPerSecond));
+		const std::chrono::nanoseconds WaitBegin = Clock.Now();
+		if (Started && NextFrameDeadline > WaitBegin)
+		{
+			WaitUntil(NextFrameDeadline);
+		}
+		const std::chrono::nanoseconds Now = Clock.Now();
+		Statistics.PacingWait = Now - WaitBegin;
+
+		// A late frame keeps the cadence, one that missed a whole interval starts a new one instead of catching up
+		if (!Started || Now - NextFrameDeadline > Interval)
+		{
+			NextFrameDeadline = Now;
+		}
+		NextFrameDeadline += Interval;
+	}
+
+	const std::chrono::nanoseconds FrameStart = Clock.Now();
+	Statistics.FrameInterval = Started ? FrameStart - LastFrameStart : std::chrono::nanoseconds(0);
+	LastFrameStart = FrameStart;
+	Started = true;
+}
+
+void FramePacer::EndFrame(uint64_t FrameFenceValue)
+{
+	FramesInFlight.push_back(FrameFenceValue);
+	if (Description.Mode != PresentMode::LowLatency)
+	{
+		WaitForFramesInFlight(Description.FramesInFlight - 1);
+	}
+}
+
+uint32_t FramePacer::GetSyncInterval() const
+{
+	return Description.Mode == PresentMode::Vsync || Description.Mode == PresentMode::LowLatency ? 1 : 0;
+}
+
+bool FramePacer::AllowsTearing() const
+{
+	return Description.Mode == PresentMode::Uncapped || Description.Mode == PresentMode::Capped;
+}
+
+void FramePacer::WaitForFramesInFlight(uint32_t MaximumPending)
+{
+	const uint64_t CompletedValue = Fence.GetCompletedValue();
+	while (!FramesInFlight.empty() && FramesInFlight.front() <= CompletedValue)
+	{
+		FramesInFlight.pop_front();
+	}
+	if (FramesInFlight.size() <= MaximumPending) return;
+
+	const std::chrono::nanoseconds WaitBegin = Clock.Now();
+	while (FramesInFlight.size() > MaximumPending)
+	{
+		Fence.Wait(FramesInFlight.front());
+		FramesInFlight.pop_front();
+	}
+	Statistics.FenceWait += Clock.Now() - WaitBegin;
+}
+
+void FramePacer::WaitUntil(std::chrono::nanoseconds Deadline)
+{
+	// Sleeping wakes up late by a scheduler quantum or more, so it stops short and the rest is spun
+	const std::chrono::nanoseconds Remaining = Deadline - Clock.Now();
+	if (Remaining > SleepMargin)
+	{
+		const std::chrono::nanoseconds Requested = Remaining - SleepMargin;
+		const std::chrono::nanoseconds SleepBegin = Clock.Now();
+		Clock.Sleep(Requested);
+		const std::chrono::nanoseconds Overslept = Clock.Now() - SleepBegin - Requested;
+		if (Overslept > SleepMargin)
+		{
+			SleepMargin = std::min(Overslept, MaximumSleepMargin);
+		}
+	}
+
+	while (Clock.Now() < Deadline)
+	{
+	}
+}
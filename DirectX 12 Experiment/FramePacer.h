@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+enum class PresentMode
+{
+	// Present on every vertical blank, frames in flight wait after submit
+	Vsync,
+	// Present immediately, tearing where the display allows it
+	Uncapped,
+	// Present immediately, spaced out to TargetFramesPerSecond by sleeping and then spinning
+	Capped,
+	// Vsync, but the wait for the GPU happens before input is sampled instead of after submit
+	LowLatency
+};
+
+struct FramePacingDescription
+{
+	PresentMode Mode = PresentMode::Vsync;
+	// Frames the CPU may run ahead of the GPU, between one and the device's back buffer count
+	uint32_t FramesInFlight = 2;
+	double TargetFramesPerSecond = 60.0;
+	// Sleeps end at least this long before the deadline and spin the rest, grown when the OS oversleeps
+	std::chrono::nanoseconds SpinThreshold = std::chrono::microseconds(1500);
+};
+
+struct FramePacingStatistics
+{
+	// Time blocked on the GPU and time spent holding to the frame rate cap during the last frame
+	std::chrono::nanoseconds FenceWait{ 0 };
+	std::chrono::nanoseconds PacingWait{ 0 };
+	// Between the starts of the last two frames
+	std::chrono::nanoseconds FrameInterval{ 0 };
+};
+
+// Time and the GPU fence are behind interfaces so the pacing can run against fakes
+class FramePacerClock
+{
+public:
+	virtual ~FramePacerClock() = default;
+
+	// Monotonic, from an arbitrary origin
+	virtual std::chrono::nanoseconds Now() = 0;
+	virtual void Sleep(std::chrono::nanoseconds Duration) = 0;
+};
+
+class FramePacerFence
+{
+public:
+	virtual ~FramePacerFence() = default;
+
+	virtual uint64_t GetCompletedValue() = 0;
+	virtual void Wait(uint64_t Value) = 0;
+};
+
+class SystemFramePacerClock : public FramePacerClock
+{
+public:
+	std::chrono::nanoseconds Now() override;
+	void Sleep(std::chrono::nanoseconds Duration) override;
+};
+
+// Decides when the CPU may start the next frame. BeginFrame runs before input is sampled and EndFrame after the
+// frame is presented with the fence value the GPU signals once it is done with the frame.
+class FramePacer
+{
+public:
+	FramePacer(FramePacerClock& Clock, FramePacerFence& Fence);
+
+	// Takes effect from the next BeginFrame, may be called between any two frames
+	void Configure(const FramePacingDescription& Description);
+	const FramePacingDescription& GetDescription() const { return Description; }
+
+	void BeginFrame();
+	void EndFrame(uint64_t FrameFenceValue);
+
+	// Swap chain parameters for the current mode, tearing is only honoured where the device supports it
+	uint32_t GetSyncInterval() const;
+	bool AllowsTearing() const;
+
+	const FramePacingStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	FramePacerClock& Clock;
+	FramePacerFence& Fence;
+	FramePacingDescription Description;
+	std::chrono::nanoseconds SleepMargin;
+
+	// Fence values of submitted frames the GPU may not have finished, oldest first
+	std::deque<uint64_t> FramesInFlight;
+	std::chrono::nanoseconds NextFrameDeadline{ 0 };
+	std::chrono::nanoseconds LastFrameStart{ 0 };
+	bool Started = false;
+	FramePacingStatistics Statistics;
+
+	void WaitForFramesInFlight(uint32_t MaximumPending);
+	void WaitUntil(std::chrono::nanoseconds Deadline);
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a. Stable across runs and platforms, so hashes can be persisted as cache keys.
+static const uint64_t FnvOffsetBasis = 14695981039346656037ull;
+static const uint64_t FnvPrime = 1099511628211ull;
+
+inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Hash = FnvOffsetBasis)
+{
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+	for (size_t Index = 0; Index < Size; Index++)
+	{
+		Hash = (Hash ^ Bytes[Index]) * FnvPrime;
+	}
+	return Hash;
+}
+
+// Strings are hashed with their terminator so adjacent fields cannot run into each other
+inline uint64_t HashString(const char* Value, uint64_t Hash)
+{
+	return HashBytes(Value, std::char_traits<char>::length(Value) + 1, Hash);
+}
+
+inline uint64_t HashString(const std::string& Value, uint64_t Hash)
+{
+	return HashBytes(Value.c_str(), Value.size() + 1, Hash);
+}
+
+// Only for types without padding, whose bytes are fully determined by their value
+template <typename Type>
+inline uint64_t HashValue(const Type& Value, uint64_t Hash)
+{
+	return HashBytes(&Value, sizeof(Value), Hash);
+}
@@ -0,0 +1,491 @@
+#include "HeadlessRenderDevice.h"
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static uint32_t PackColor(const float Color[4])
+{
+	uint32_t Packed = 0;
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		const float Clamped = std::min(std::max(Color[Channel], 0.0f), 1.0f);
+		Packed |= static_cast<uint32_t>(Clamped * 255.0f + 0.5f) << (8 * Channel);
+	}
+	return Packed;
+}
+
+// Matches the tint table in SimplePixelShader.hlsl
+static const float MaterialTints[4][3] =
+{
+	{ 1.0f, 1.0f, 1.0f },
+	{ 1.0f, 0.6f, 0.6f },
+	{ 0.6f, 1.0f, 0.6f },
+	{ 0.6f, 0.6f, 1.0f }
+};
+
+static uint32_t TintColor(uint32_t Packed, uint32_t MaterialId)
+{
+	const float* Tint = MaterialTints[MaterialId % 4];
+	uint32_t Tinted = Packed & 0xFF000000u;
+	for (uint32_t Channel = 0; Channel < 3; Channel++)
+	{
+		const float Value = static_cast<float>((Packed >> (8 * Channel)) & 0xFF) * Tint[Channel];
+		Tinted |= static_cast<uint32_t>(Value + 0.5f) << (8 * Channel);
+	}
+	return Tinted;
+}
+
+static float EdgeFunction(float AX, float AY, float BX, float BY, float PX, float PY)
+{
+	return (BX - AX) * (PY - AY) - (BY - AY) * (PX - AX);
+}
+
+std::unique_ptr<RenderDevice> CreateHeadlessRenderDevice()
+{
+	return std::make_unique<HeadlessRenderDevice>();
+}
+
+void HeadlessCommandList::Reset()
+{
+	Commands.clear();
+	Closed = false;
+}
+
+void HeadlessCommandList::ClearRenderTarget(const float Color[4])
+{
+	HeadlessCommand Command = {};
+	Command.Type = HeadlessCommandType::ClearRenderTarget;
+	std::copy(Color, Color + 4, Command.Color);
+	Commands.push_back(Command);
+}
+
+void HeadlessCommandList::DrawIndexedInstanced(uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
+{
+	HeadlessCommand Command = {};
+	Command.Type = HeadlessCommandType::DrawIndexedInstanced;
+	Command.IndexCountPerInstance = IndexCountPerInstance;
+	Command.InstanceCount = InstanceCount;
+	Command.StartIndexLocation = StartIndexLocation;
+	Command.BaseVertexLocation = BaseVertexLocation;
+	Command.StartInstanceLocation = StartInstanceLocation;
+	Commands.push_back(Command);
+}
+
+void HeadlessCommandList::DrawInstancedBatches(const InstancedDrawArguments* Draws, uint32_t DrawCount)
+{
+	for (uint32_t DrawIndex = 0; DrawIndex < DrawCount; DrawIndex++)
+	{
+		const InstancedDrawArguments& Draw = Draws[DrawIndex];
+		DrawIndexedInstanced(Draw.IndexCountPerInstance, Draw.InstanceCount, Draw.StartIndexLocation, Draw.BaseVertexLocation, Draw.FirstInstance);
+	}
+}
+
+void HeadlessCommandList::ExecuteIndirect(uint32_t FirstDraw, uint32_t DrawCount)
+{
+	HeadlessCommand Command = {};
+	Command.Type = HeadlessCommandType::ExecuteIndirect;
+	Command.FirstDraw = FirstDraw;
+	Command.DrawCount = DrawCount;
+	Commands.push_back(Command);
+}
+
+void HeadlessCommandList::Close()
+{
+	Closed = true;
+}
+
+void HeadlessRenderDevice::Initialize(const RenderDeviceDescription& Description)
+{
+	Width = Description.Width;
+	Height = Description.Height;
+	FrameCount = Description.FrameCount;
+	if (FrameCount < 1 || FrameCount > MaximumFrameCount) throw std::runtime_error("Unsupported frame count");
+	CurrentFrameIndex = 0;
+	GeometryFormat = Description.GeometryFormat;
+
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		Framebuffers[FrameIndex].assign(static_cast<size_t>(Width) * Height, 0);
+	}
+	UpdateRenderArea();
+	SetFramePacing(Description.Pacing);
+}
+
+void HeadlessRenderDevice::Dispose()
+{
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		Framebuffers[FrameIndex].clear();
+	}
+	SceneBuffer.clear();
+	VertexBuffer.clear();
+	IndexBuffer.clear();
+	Texture.clear();
+	Instances = InstanceBatchBuffer();
+	Streams.clear();
+	StreamingStagingBytes = 0;
+}
+
+void HeadlessRenderDevice::CreateGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount)
+{
+	VertexBuffer.assign(Vertices, Vertices + VertexCount);
+	IndexBuffer.assign(Indices, Indices + IndexCount);
+	if (GeometryFormat == VertexFormat::Quantized)
+	{
+		for (Vertex& Stored : VertexBuffer)
+		{
+			const QuantizedVertex Quantized = QuantizeVertex(Stored.Position, Stored.UV);
+			for (uint32_t Axis = 0; Axis < 3; Axis++)
+			{
+				Stored.Position[Axis] = DequantizeHalf(Quantized.Position[Axis]);
+			}
+			Stored.UV[0] = static_cast<float>(Quantized.UV[0]) / 65535.0f;
+			Stored.UV[1] = static_cast<float>(Quantized.UV[1]) / 65535.0f;
+		}
+	}
+
+	const uint64_t VertexSize = GeometryFormat == VertexFormat::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+	const uint64_t IndexSize = IndexCount != 0 && *std::max_element(Indices, Indices + IndexCount) > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
+	Statistics.UploadedBytes += VertexCount * VertexSize + IndexCount * IndexSize;
+}
+
+void HeadlessRenderDevice::CreateTexture(const TextureDescription& Description, const uint8_t* Pixels)
+{
+	// The reference rasterizer samples RGBA8 directly, so requested compression is not applied
+	TextureWidth = Description.Width;
+	TextureHeight = Description.Height;
+	Texture.resize(static_cast<size_t>(Description.Width) * Description.Height);
+	memcpy(Texture.data(), Pixels, Texture.size() * sizeof(uint32_t));
+	Statistics.UploadedBytes += Texture.size() * sizeof(uint32_t);
+}
+
+void HeadlessRenderDevice::FinishUploads()
+{
+}
+
+void HeadlessRenderDevice::UploadInstances(const InstanceBatchBuffer& Batches)
+{
+	Instances = Batches;
+	Statistics.UploadedBytes += Batches.TransformRows.size() * sizeof(float) + Batches.MaterialIds.size() * sizeof(uint32_t) + Batches.Draws.size() * sizeof(InstancedDrawArguments);
+}
+
+bool HeadlessRenderDevice::TryBeginTextureStream(const TextureDescription& Description, TextureStreamStaging& Staging)
+{
+	// Staging stays RGBA8 like CreateTexture. Match the D3D12 pitch and placement alignment so callers that
+	// ignore the layout break here too.
+	Staging.Format = TextureFormat::Rgba8;
+	Staging.MipLevelCount = GetFullMipLevelCount(Description.Width, Description.Height);
+	const uint64_t Size = GetTextureLevelLayouts(Staging.Format, Description.Width, Description.Height, Staging.MipLevelCount, 256, 512, Staging.Levels);
+	if (StreamingStagingBytes != 0 && StreamingStagingBytes + Size > StreamingStagingCapacity) return false;
+
+	PendingStream& Stream = Streams[NextStreamId];
+	Stream.Width = Description.Width;
+	Stream.Height = Description.Height;
+	Stream.RowPitch = Staging.Levels[0].RowPitch;
+	Stream.Pixels.resize(Size);
+	Stream.FenceValue = 0;
+	StreamingStagingBytes += Size;
+
+	Staging.StreamId = NextStreamId++;
+	Staging.Pixels = Stream.Pixels.data();
+	Staging.RowPitch = Stream.RowPitch;
+	Staging.Width = Description.Width;
+	Staging.Height = Description.Height;
+	return true;
+}
+
+uint64_t HeadlessRenderDevice::SubmitTextureStream(const TextureStreamStaging& Staging)
+{
+	Streams.at(Staging.StreamId).FenceValue = ++StreamFenceValue;
+	return StreamFenceValue;
+}
+
+void HeadlessRenderDevice::CancelTextureStream(const TextureStreamStaging& Staging)
+{
+	auto Stream = Streams.find(Staging.StreamId);
+	if (Stream == Streams.end()) return;
+
+	StreamingStagingBytes -= Stream->second.Pixels.size();
+	Streams.erase(Stream);
+}
+
+std::unique_ptr<RenderCommandList> HeadlessRenderDevice::CreateCommandList()
+{
+	return std::make_unique<HeadlessCommandList>();
+}
+
+void HeadlessRenderDevice::ExecuteCommandLists(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists)
+{
+	// A scaled frame is rasterized at the render size and upscaled once every list has run
+	const bool Scaled = RenderWidth != Width || RenderHeight != Height;
+	std::vector<uint32_t>& Framebuffer = Scaled ? SceneBuffer : Framebuffers[CurrentFrameIndex];
+
+	for (uint32_t ListIndex = 0; ListIndex < NumberOfCommandLists; ListIndex++)
+	{
+		auto CommandList = static_cast<const HeadlessCommandList*>(CommandLists[ListIndex]);
+		if (!CommandList->IsClosed()) throw std::runtime_error("Executed a command list that was not closed");
+
+		for (const HeadlessCommand& Command : CommandList->GetCommands())
+		{
+			switch (Command.Type)
+			{
+			case HeadlessCommandType::ClearRenderTarget:
+				Clear(Framebuffer, Command.Color);
+				break;
+
+			case HeadlessCommandType::DrawIndexedInstanced:
+				Draw(Framebuffer, Command.IndexCountPerInstance, Command.InstanceCount, Command.StartIndexLocation, Command.BaseVertexLocation, Command.StartInstanceLocation);
+				break;
+
+			case HeadlessCommandType::ExecuteIndirect:
+				if (static_cast<uint64_t>(Command.FirstDraw) + Command.DrawCount > Instances.Draws.size()) throw std::runtime_error("Indirect draws outside the uploaded arguments");
+				for (uint32_t DrawIndex = Command.FirstDraw; DrawIndex < Command.FirstDraw + Command.DrawCount; DrawIndex++)
+				{
+					const InstancedDrawArguments& Arguments = Instances.Draws[DrawIndex];
+					Draw(Framebuffer, Arguments.IndexCountPerInstance, Arguments.InstanceCount, Arguments.StartIndexLocation, Arguments.BaseVertexLocation, Arguments.FirstInstance);
+				}
+				break;
+			}
+			Statistics.ExecutedCommands++;
+		}
+		Statistics.ExecutedCommandLists++;
+	}
+
+	if (Scaled)
+	{
+		Upscale(Framebuffers[CurrentFrameIndex]);
+	}
+}
+
+void HeadlessRenderDevice::BeginFrame()
+{
+	Pacer.BeginFrame();
+}
+
+void HeadlessRenderDevice::Present()
+{
+	Statistics.PresentedFrames++;
+	PacerFence.Signal(Statistics.PresentedFrames);
+	Pacer.EndFrame(Statistics.PresentedFrames);
+	CurrentFrameIndex = (CurrentFrameIndex + 1) % FrameCount;
+	Instances.InstanceCount = 0;
+	Instances.Draws.clear();
+
+	CompletedStreamFenceValue = StreamFenceValue;
+	PromoteStreamedTextures();
+}
+
+void HeadlessRenderDevice::WaitForIdle()
+{
+}
+
+void HeadlessRenderDevice::Resize(uint32_t NewWidth, uint32_t NewHeight)
+{
+	if (NewWidth == 0 || NewHeight == 0 || (NewWidth == Width && NewHeight == Height)) return;
+
+	Width = NewWidth;
+	Height = NewHeight;
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		Framebuffers[FrameIndex].assign(static_cast<size_t>(Width) * Height, 0);
+	}
+	UpdateRenderArea();
+}
+
+void HeadlessRenderDevice::SetRenderScale(float Scale)
+{
+	if (!(Scale > 0.0f)) throw std::runtime_error("Render scale must be positive");
+
+	RenderScale = std::min(Scale, 1.0f);
+	UpdateRenderArea();
+}
+
+void HeadlessRenderDevice::SetFramePacing(const FramePacingDescription& Description)
+{
+	if (Description.FramesInFlight > FrameCount) throw std::runtime_error("More frames in flight than back buffers");
+	Pacer.Configure(Description);
+}
+
+void HeadlessRenderDevice::Clear(std::vector<uint32_t>& Framebuffer, const float Color[4])
+{
+	std::fill(Framebuffer.begin(), Framebuffer.end(), PackColor(Color));
+}
+
+void HeadlessRenderDevice::Draw(std::vector<uint32_t>& Framebuffer, uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation)
+{
+	// Same rule as the vertex shader, vertices are only transformed once instances were uploaded this frame
+	const uint32_t UploadedCount = Instances.InstanceCount;
+	if (UploadedCount != 0 && static_cast<uint64_t>(StartInstanceLocation) + InstanceCount > UploadedCount) throw std::runtime_error("Draw reads past the uploaded instances");
+
+	for (uint32_t InstanceIndex = 0; InstanceIndex < InstanceCount; InstanceIndex++)
+	{
+		const uint32_t Instance = StartInstanceLocation + InstanceIndex;
+		const uint32_t MaterialId = UploadedCount != 0 ? Instances.MaterialIds[Instance] : 0;
+		for (uint32_t Index = 0; Index + 2 < IndexCountPerInstance; Index += 3)
+		{
+			const uint64_t First = static_cast<uint64_t>(StartIndexLocation) + Index;
+			if (First + 2 >= IndexBuffer.size()) break;
+
+			// Vertices past the vertex buffer read as zero on the GPU, which leaves nothing to rasterize
+			int64_t CornerVertices[3];
+			for (uint32_t Corner = 0; Corner < 3; Corner++)
+			{
+				CornerVertices[Corner] = static_cast<int64_t>(IndexBuffer[First + Corner]) + BaseVertexLocation;
+			}
+			if (std::any_of(CornerVertices, CornerVertices + 3, [this](int64_t Vertex) { return Vertex < 0 || Vertex >= static_cast<int64_t>(VertexBuffer.size()); })) continue;
+
+			// Stretched by the aspect ratio before the transform, like the vertex shader
+			Vertex Corners[3] = { VertexBuffer[CornerVertices[0]], VertexBuffer[CornerVertices[1]], VertexBuffer[CornerVertices[2]] };
+			for (Vertex& Corner : Corners)
+			{
+				Corner.Position[1] *= AspectRatio;
+			}
+			if (UploadedCount != 0)
+			{
+				for (Vertex& Corner : Corners)
+				{
+					const float X = Corner.Position[0], Y = Corner.Position[1], Z = Corner.Position[2];
+					for (uint32_t RowIndex = 0; RowIndex < 3; RowIndex++)
+					{
+						const float* Row = &Instances.TransformRows[(static_cast<size_t>(RowIndex) * UploadedCount + Instance) * 4];
+						Corner.Position[RowIndex] = Row[0] * X + Row[1] * Y + Row[2] * Z + Row[3];
+					}
+				}
+			}
+			RasterizeTriangle(Framebuffer, Corners[0], Corners[1], Corners[2], MaterialId);
+		}
+	}
+	Statistics.DrawnInstances += InstanceCount;
+}
+
+void HeadlessRenderDevice::RasterizeTriangle(std::vector<uint32_t>& Framebuffer, const Vertex& V0, const Vertex& V1, const Vertex& V2, uint32_t MaterialId)
+{
+	const float HalfWidth = 0.5f * static_cast<float>(RenderWidth);
+	const float HalfHeight = 0.5f * static_cast<float>(RenderHeight);
+	const float X0 = (V0.Position[0] + 1.0f) * HalfWidth, Y0 = (1.0f - V0.Position[1]) * HalfHeight;
+	const float X1 = (V1.Position[0] + 1.0f) * HalfWidth, Y1 = (1.0f - V1.Position[1]) * HalfHeight;
+	const float X2 = (V2.Position[0] + 1.0f) * HalfWidth, Y2 = (1.0f - V2.Position[1]) * HalfHeight;
+
+	// Clockwise triangles are front facing and back faces are culled, matching the D3D12 rasterizer state
+	const float Area = EdgeFunction(X0, Y0, X1, Y1, X2, Y2);
+	if (Area <= 0.0f) return;
+	Statistics.RasterizedTriangles++;
+
+	const int MinimumX = std::max(0, static_cast<int>(std::floor(std::min({ X0, X1, X2 }))));
+	const int MaximumX = std::min(static_cast<int>(RenderWidth) - 1, static_cast<int>(std::ceil(std::max({ X0, X1, X2 }))));
+	const int MinimumY = std::max(0, static_cast<int>(std::floor(std::min({ Y0, Y1, Y2 }))));
+	const int MaximumY = std::min(static_cast<int>(RenderHeight) - 1, static_cast<int>(std::ceil(std::max({ Y0, Y1, Y2 }))));
+
+	const float InverseArea = 1.0f / Area;
+	for (int Y = MinimumY; Y <= MaximumY; Y++)
+	{
+		const float PixelY = static_cast<float>(Y) + 0.5f;
+		uint32_t* Row = &Framebuffer[static_cast<size_t>(Y) * RenderWidth];
+		for (int X = MinimumX; X <= MaximumX; X++)
+		{
+			const float PixelX = static_cast<float>(X) + 0.5f;
+			const float W0 = EdgeFunction(X1, Y1, X2, Y2, PixelX, PixelY);
+			const float W1 = EdgeFunction(X2, Y2, X0, Y0, PixelX, PixelY);
+			const float W2 = EdgeFunction(X0, Y0, X1, Y1, PixelX, PixelY);
+			if (W0 < 0.0f || W1 < 0.0f || W2 < 0.0f) continue;
+
+			const float U = (W0 * V0.UV[0] + W1 * V1.UV[0] + W2 * V2.UV[0]) * InverseArea;
+			const float V = (W0 * V0.UV[1] + W1 * V1.UV[1] + W2 * V2.UV[1]) * InverseArea;
+			Row[X] = TintColor(SampleTexture(U, V), MaterialId);
+		}
+	}
+}
+
+uint32_t HeadlessRenderDevice::SampleTexture(float U, float V) const
+{
+	// Point sampling with a transparent black border, matching the static sampler in the root signature
+	if (Texture.empty() || U < 0.0f || V < 0.0f) return 0;
+
+	const uint32_t TexelX = static_cast<uint32_t>(U * static_cast<float>(TextureWidth));
+	const uint32_t TexelY = static_cast<uint32_t>(V * static_cast<float>(TextureHeight));
+	if (TexelX >= TextureWidth || TexelY >= TextureHeight) return 0;
+
+	return Texture[static_cast<size_t>(TexelY) * TextureWidth + TexelX];
+}
+
+void HeadlessRenderDevice::UpdateRenderArea()
+{
+	RenderWidth = DynamicResolutionController::GetScaledSize(Width, RenderScale);
+	RenderHeight = DynamicResolutionController::GetScaledSize(Height, RenderScale);
+	AspectRatio = static_cast<float>(Width) / static_cast<float>(Height);
+	if (RenderWidth != Width || RenderHeight != Height)
+	{
+		SceneBuffer.assign(static_cast<size_t>(RenderWidth) * RenderHeight, 0);
+	}
+}
+
+void HeadlessRenderDevice::Upscale(std::vector<uint32_t>& Framebuffer) const
+{
+	// Bilinear between the nearest scene texels, clamped at the edges like the upscale pass's sampler
+	const float ScaleX = static_cast<float>(RenderWidth) / static_cast<float>(Width);
+	const float ScaleY = static_cast<float>(RenderHeight) / static_cast<float>(Height);
+	for (uint32_t Y = 0; Y < Height; Y++)
+	{
+		const float SourceY = std::min(std::max((static_cast<float>(Y) + 0.5f) * ScaleY - 0.5f, 0.0f), static_cast<float>(RenderHeight - 1));
+		const uint32_t Y0 = static_cast<uint32_t>(SourceY);
+		const uint32_t Y1 = std::min(Y0 + 1, RenderHeight - 1);
+		const float FractionY = SourceY - static_cast<float>(Y0);
+		for (uint32_t X = 0; X < Width; X++)
+		{
+			const float SourceX = std::min(std::max((static_cast<float>(X) + 0.5f) * ScaleX - 0.5f, 0.0f), static_cast<float>(RenderWidth - 1));
+			const uint32_t X0 = static_cast<uint32_t>(SourceX);
+			const uint32_t X1 = std::min(X0 + 1, RenderWidth - 1);
+			const float FractionX = SourceX - static_cast<float>(X0);
+
+			const uint32_t Texels[4] =
+			{
+				SceneBuffer[static_cast<size_t>(Y0) * RenderWidth + X0], SceneBuffer[static_cast<size_t>(Y0) * RenderWidth + X1],
+				SceneBuffer[static_cast<size_t>(Y1) * RenderWidth + X0], SceneBuffer[static_cast<size_t>(Y1) * RenderWidth + X1]
+			};
+			uint32_t Packed = 0;
+			for (uint32_t Channel = 0; Channel < 4; Channel++)
+			{
+				const uint32_t Shift = 8 * Channel;
+				const float Top = static_cast<float>((Texels[0] >> Shift) & 0xff) * (1.0f - FractionX) + static_cast<float>((Texels[1] >> Shift) & 0xff) * FractionX;
+				const float Bottom = static_cast<float>((Texels[2] >> Shift) & 0xff) * (1.0f - FractionX) + static_cast<float>((Texels[3] >> Shift) & 0xff) * FractionX;
+				Packed |= static_cast<uint32_t>(Top * (1.0f - FractionY) + Bottom * FractionY + 0.5f) << Shift;
+			}
+			Framebuffer[static_cast<size_t>(Y) * Width + X] = Packed;
+		}
+	}
+}
+
+void HeadlessRenderDevice::PromoteStreamedTextures()
+{
+	// Only the most recently completed stream stays bound, and like CreateTexture only level zero is sampled
+	uint64_t NewestFenceValue = 0;
+	for (auto Stream = Streams.begin(); Stream != Streams.end();)
+	{
+		const PendingStream& Candidate = Stream->second;
+		if (Candidate.FenceValue == 0 || Candidate.FenceValue > CompletedStreamFenceValue)
+		{
+			++Stream;
+			continue;
+		}
+
+		if (Candidate.FenceValue > NewestFenceValue)
+		{
+			NewestFenceValue = Candidate.FenceValue;
+			TextureWidth = Candidate.Width;
+			TextureHeight = Candidate.Height;
+			Texture.resize(static_cast<size_t>(Candidate.Width) * Candidate.Height);
+			for (uint32_t Row = 0; Row < Candidate.Height; Row++)
+			{
+				memcpy(Texture.data() + static_cast<size_t>(Row) * Candidate.Width, Candidate.Pixels.data() + static_cast<size_t>(Row) * Candidate.RowPitch, 4 * Candidate.Width);
+			}
+		}
+
+		Statistics.UploadedBytes += 4ull * Candidate.Width * Candidate.Height;
+		Statistics.StreamedTextures++;
+		StreamingStagingBytes -= Candidate.Pixels.size();
+		Stream = Streams.erase(Stream);
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include <unordered_map>
+#include <vector>
+
+enum class HeadlessCommandType
+{
+	ClearRenderTarget,
+	DrawIndexedInstanced,
+	ExecuteIndirect
+};
+
+struct HeadlessCommand
+{
+	HeadlessCommandType Type;
+	float Color[4];
+	uint32_t IndexCountPerInstance;
+	uint32_t InstanceCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	uint32_t StartInstanceLocation;
+	uint32_t FirstDraw;
+	uint32_t DrawCount;
+};
+
+class HeadlessCommandList : public RenderCommandList
+{
+public:
+	void Reset() override;
+	void ClearRenderTarget(const float Color[4]) override;
+	void DrawIndexedInstanced(uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) override;
+	void DrawInstancedBatches(const InstancedDrawArguments* Draws, uint32_t DrawCount) override;
+	void ExecuteIndirect(uint32_t FirstDraw, uint32_t DrawCount) override;
+	void Close() override;
+
+	const std::vector<HeadlessCommand>& GetCommands() const { return Commands; }
+	bool IsClosed() const { return Closed; }
+
+private:
+	std::vector<HeadlessCommand> Commands;
+	bool Closed = true;
+};
+
+struct HeadlessDeviceStatistics
+{
+	uint64_t PresentedFrames = 0;
+	uint64_t ExecutedCommandLists = 0;
+	uint64_t ExecutedCommands = 0;
+	uint64_t RasterizedTriangles = 0;
+	uint64_t DrawnInstances = 0;
+	uint64_t UploadedBytes = 0;
+	uint64_t StreamedTextures = 0;
+};
+
+// Frames complete as soon as they are presented, so the pacer only ever holds to a frame rate cap
+class HeadlessFrameFence : public FramePacerFence
+{
+public:
+	void Signal(uint64_t Value) { CompletedValue = Value; }
+
+	uint64_t GetCompletedValue() override { return CompletedValue; }
+	void Wait(uint64_t) override {}
+
+private:
+	uint64_t CompletedValue = 0;
+};
+
+class HeadlessRenderDevice : public RenderDevice
+{
+public:
+	HeadlessRenderDevice() = default;
+	~HeadlessRenderDevice() override = default;
+
+	void Initialize(const RenderDeviceDescription& Description) override;
+	void Dispose() override;
+
+	void CreateGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount) override;
+	void CreateTexture(const TextureDescription& Description, const uint8_t* Pixels) override;
+	void FinishUploads() override;
+
+	void UploadInstances(const InstanceBatchBuffer& Batches) override;
+
+	bool TryBeginTextureStream(const TextureDescription& Description, TextureStreamStaging& Staging) override;
+	uint64_t SubmitTextureStream(const TextureStreamStaging& Staging) override;
+	void CancelTextureStream(const TextureStreamStaging& Staging) override;
+	uint64_t GetCompletedStreamFenceValue() override { return CompletedStreamFenceValue; }
+
+	std::unique_ptr<RenderCommandList> CreateCommandList() override;
+	void BeginFrame() override;
+	void ExecuteCommandLists(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists) override;
+	void Present() override;
+	void WaitForIdle() override;
+
+	void Resize(uint32_t NewWidth, uint32_t NewHeight) override;
+	void SetRenderScale(float Scale) override;
+
+	uint32_t GetWidth() const override { return Width; }
+	uint32_t GetHeight() const override { return Height; }
+	uint32_t GetCurrentFrameIndex() const override { return CurrentFrameIndex; }
+	uint32_t GetFrameCount() const override { return FrameCount; }
+
+	void SetFramePacing(const FramePacingDescription& Description) override;
+	const FramePacingStatistics& GetFramePacingStatistics() const override { return Pacer.GetStatistics(); }
+
+	// Framebuffers are packed R8G8B8A8, one per back buffer
+	const std::vector<uint32_t>& GetFramebuffer(uint32_t FrameIndex) const { return Framebuffers[FrameIndex]; }
+	const HeadlessDeviceStatistics& GetStatistics() const { return Statistics; }
+	uint32_t GetRenderWidth() const { return RenderWidth; }
+	uint32_t GetRenderHeight() const { return RenderHeight; }
+
+private:
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t FrameCount = 0;
+	uint32_t CurrentFrameIndex = 0;
+	std::vector<uint32_t> Framebuffers[MaximumFrameCount];
+
+	// Below a render scale of one, frames are rasterized into the scene buffer and upscaled into the framebuffer
+	float RenderScale = 1.0f;
+	uint32_t RenderWidth = 0;
+	uint32_t RenderHeight = 0;
+	float AspectRatio = 1.0f;
+	std::vector<uint32_t> SceneBuffer;
+
+	// Quantized geometry is kept as it reads back after quantization, so both formats rasterize like the GPU
+	VertexFormat GeometryFormat = VertexFormat::Float;
+	std::vector<Vertex> VertexBuffer;
+	std::vector<uint32_t> IndexBuffer;
+	uint32_t TextureWidth = 0;
+	uint32_t TextureHeight = 0;
+	std::vector<uint32_t> Texture;
+
+	// Copied on upload and dropped at Present, like the per-frame upload memory of the D3D12 backend
+	InstanceBatchBuffer Instances;
+
+	struct PendingStream
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t RowPitch;
+		std::vector<uint8_t> Pixels;
+		uint64_t FenceValue;
+	};
+
+	// Streams pretend to copy for one frame so callers see the same ordering as the copy queue backend
+	static const uint64_t StreamingStagingCapacity = 64 * 1024 * 1024;
+	std::unordered_map<uint64_t, PendingStream> Streams;
+	uint64_t NextStreamId = 1;
+	uint64_t StreamingStagingBytes = 0;
+	uint64_t StreamFenceValue = 0;
+	uint64_t CompletedStreamFenceValue = 0;
+
+	HeadlessDeviceStatistics Statistics;
+
+	SystemFramePacerClock PacerClock;
+	HeadlessFrameFence PacerFence;
+	FramePacer Pacer{ PacerClock, PacerFence };
+
+	void Clear(std::vector<uint32_t>& Framebuffer, const float Color[4]);
+	void Draw(std::vector<uint32_t>& Framebuffer, uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation);
+	void RasterizeTriangle(std::vector<uint32_t>& Framebuffer, const Vertex& V0, const Vertex& V1, const Vertex& V2, uint32_t MaterialId);
+	uint32_t SampleTexture(float U, float V) const;
+	void UpdateRenderArea();
+	void Upscale(std::vector<uint32_t>& Framebuffer) const;
+	void PromoteStreamedTextures();
+};
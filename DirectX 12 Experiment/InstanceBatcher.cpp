@@ -0,0 +1,109 @@
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+// Chunks have a fixed size rather than one per worker, so the output never depends on the thread count
+static const uint32_t InstancesPerChunk = 16384;
+
+static void ForEachChunk(JobSystem* Jobs, uint32_t ChunkCount, const std::function<void(uint32_t, uint32_t)>& Function)
+{
+	if (Jobs != nullptr && ChunkCount > 1)
+	{
+		Jobs->ParallelFor(0, ChunkCount, 1, Function);
+	}
+	else
+	{
+		Function(0, ChunkCount);
+	}
+}
+
+void BuildInstanceBatches(const InstanceList& Instances, const MeshRange* Meshes, uint32_t MeshCount, InstanceBatchBuffer& Batches, JobSystem* Jobs)
+{
+	const uint32_t InstanceCount = static_cast<uint32_t>(Instances.MeshIds.size());
+	if (Instances.MaterialIds.size() != InstanceCount || Instances.Transforms.size() != InstanceCount) throw std::runtime_error("Instance arrays differ in length");
+
+	Batches.InstanceCount = InstanceCount;
+	Batches.TransformRows.resize(static_cast<size_t>(InstanceCount) * 12);
+	Batches.MaterialIds.resize(InstanceCount);
+	Batches.Draws.clear();
+	if (InstanceCount == 0) return;
+
+	// Each chunk counts its own meshes, a prefix sum over mesh then chunk turns the counts into write cursors
+	const uint32_t ChunkCount = (InstanceCount + InstancesPerChunk - 1) / InstancesPerChunk;
+	std::vector<uint32_t> Cursors(static_cast<size_t>(ChunkCount) * MeshCount);
+	std::atomic<bool> InvalidMesh{ false };
+
+	ForEachChunk(Jobs, ChunkCount, [&](uint32_t BeginChunk, uint32_t EndChunk)
+	{
+		// Counted locally because neighbouring chunks' rows share cache lines
+		std::vector<uint32_t> Counts(MeshCount);
+		for (uint32_t Chunk = BeginChunk; Chunk < EndChunk; Chunk++)
+		{
+			std::fill(Counts.begin(), Counts.end(), 0);
+			const uint32_t End = std::min(InstanceCount, (Chunk + 1) * InstancesPerChunk);
+			for (uint32_t Instance = Chunk * InstancesPerChunk; Instance < End; Instance++)
+			{
+				const uint32_t MeshId = Instances.MeshIds[Instance];
+				if (MeshId >= MeshCount)
+				{
+					InvalidMesh.store(true, std::memory_order_relaxed);
+					return;
+				}
+				Counts[MeshId]++;
+			}
+			std::copy(Counts.begin(), Counts.end(), Cursors.begin() + static_cast<size_t>(Chunk) * MeshCount);
+		}
+	});
+	if (InvalidMesh.load()) throw std::runtime_error("Instance refers to a mesh that does not exist");
+
+	uint32_t Running = 0;
+	for (uint32_t MeshId = 0; MeshId < MeshCount; MeshId++)
+	{
+		const uint32_t FirstInstance = Running;
+		for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+		{
+			uint32_t& Cursor = Cursors[static_cast<size_t>(Chunk) * MeshCount + MeshId];
+			const uint32_t Count = Cursor;
+			Cursor = Running;
+			Running += Count;
+		}
+		if (Running == FirstInstance) continue;
+
+		InstancedDrawArguments Draw;
+		Draw.FirstInstance = FirstInstance;
+		Draw.IndexCountPerInstance = Meshes[MeshId].IndexCount;
+		Draw.InstanceCount = Running - FirstInstance;
+		Draw.StartIndexLocation = Meshes[MeshId].StartIndex;
+		Draw.BaseVertexLocation = Meshes[MeshId].BaseVertex;
+		Draw.StartInstanceLocation = FirstInstance;
+		Batches.Draws.push_back(Draw);
+	}
+
+	float* Row0 = Batches.TransformRows.data();
+	float* Row1 = Row0 + static_cast<size_t>(InstanceCount) * 4;
+	float* Row2 = Row1 + static_cast<size_t>(InstanceCount) * 4;
+	ForEachChunk(Jobs, ChunkCount, [&](uint32_t BeginChunk, uint32_t EndChunk)
+	{
+		std::vector<uint32_t> Next(MeshCount);
+		for (uint32_t Chunk = BeginChunk; Chunk < EndChunk; Chunk++)
+		{
+			const auto ChunkCursors = Cursors.begin() + static_cast<size_t>(Chunk) * MeshCount;
+			std::copy(ChunkCursors, ChunkCursors + MeshCount, Next.begin());
+
+			const uint32_t End = std::min(InstanceCount, (Chunk + 1) * InstancesPerChunk);
+			for (uint32_t Instance = Chunk * InstancesPerChunk; Instance < End; Instance++)
+			{
+				const uint32_t Destination = Next[Instances.MeshIds[Instance]]++;
+				const InstanceTransform& Transform = Instances.Transforms[Instance];
+				memcpy(Row0 + static_cast<size_t>(Destination) * 4, Transform.Rows[0], sizeof(Transform.Rows[0]));
+				memcpy(Row1 + static_cast<size_t>(Destination) * 4, Transform.Rows[1], sizeof(Transform.Rows[1]));
+				memcpy(Row2 + static_cast<size_t>(Destination) * 4, Transform.Rows[2], sizeof(Transform.Rows[2]));
+				Batches.MaterialIds[Destination] = Instances.MaterialIds[Instance];
+			}
+		}
+	});
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Row-major affine transform, the fourth column holds the translation
+struct InstanceTransform
+{
+	float Rows[3][4];
+};
+
+// Scene objects as parallel arrays, one entry per object in any mesh order
+struct InstanceList
+{
+	std::vector<uint32_t> MeshIds;
+	std::vector<uint32_t> MaterialIds;
+	std::vector<InstanceTransform> Transforms;
+};
+
+// Index range of one mesh in the shared index buffer; its indices are relative to BaseVertex in the shared vertex buffer
+struct MeshRange
+{
+	uint32_t StartIndex = 0;
+	uint32_t IndexCount = 0;
+	int32_t BaseVertex = 0;
+};
+
+// One instanced draw, laid out as an indirect command of one root constant followed by the draw arguments so an
+// array of them doubles as the ExecuteIndirect argument buffer. SV_InstanceID does not include
+// StartInstanceLocation, which is why the first instance also reaches the vertex shader as a root constant.
+struct InstancedDrawArguments
+{
+	uint32_t FirstInstance;
+	uint32_t IndexCountPerInstance;
+	uint32_t InstanceCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	uint32_t StartInstanceLocation;
+};
+
+// Instances grouped by mesh in structure-of-arrays form, ready to be copied into a GPU buffer as they are
+struct InstanceBatchBuffer
+{
+	uint32_t InstanceCount = 0;
+
+	// Three float4 streams of InstanceCount entries, one per transform row; row R of instance I starts at float (R * InstanceCount + I) * 4
+	std::vector<float> TransformRows;
+	std::vector<uint32_t> MaterialIds;
+
+	// One draw per mesh that has instances, in mesh order
+	std::vector<InstancedDrawArguments> Draws;
+};
+
+// Groups the instances of each mesh into one draw with a stable counting sort, so instances keep their relative
+// order within a mesh. Runs on the job system when one is given and reuses the memory already in Batches.
+// Throws when an instance refers to a mesh outside Meshes.
+void BuildInstanceBatches(const InstanceList& Instances, const MeshRange* Meshes, uint32_t MeshCount, InstanceBatchBuffer& Batches, JobSystem* Jobs = nullptr);
@@ -0,0 +1,197 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+static thread_local uint32_t CurrentThreadIndex = 0;
+
+JobSystem::JobSystem(uint32_t NumberOfWorkers)
+{
+	if (NumberOfWorkers == 0)
+	{
+		NumberOfWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	for (uint32_t QueueIndex = 0; QueueIndex <= NumberOfWorkers; QueueIndex++)
+	{
+		Queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (uint32_t ThreadIndex = 1; ThreadIndex <= NumberOfWorkers; ThreadIndex++)
+	{
+		Workers.emplace_back(&JobSystem::WorkerMain, this, ThreadIndex);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		ShuttingDown = true;
+	}
+	SleepCondition.notify_all();
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+void JobSystem::Schedule(Job NewJob, JobCounter* Counter)
+{
+	if (Counter != nullptr)
+	{
+		Counter->Pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Sequentially consistent so either this thread sees the sleeper or the sleeper sees the job
+	QueuedJobs.fetch_add(1);
+
+	// Threads the job system does not own share queue zero with the owning thread
+	WorkerQueue& Queue = *Queues[CurrentThreadIndex < Queues.size() ? CurrentThreadIndex : 0];
+	{
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		Queue.Jobs.emplace_back(std::move(NewJob), Counter);
+	}
+
+	if (SleepingWorkers.load() != 0)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(SleepMutex);
+		}
+		SleepCondition.notify_one();
+	}
+}
+
+void JobSystem::ContinueWith(JobCounter& Counter, Job Continuation)
+{
+	{
+		std::lock_guard<std::mutex> Lock(Counter.ContinuationMutex);
+		if (Counter.Pending.load(std::memory_order_acquire) != 0)
+		{
+			Counter.Continuations.push_back(std::move(Continuation));
+			return;
+		}
+	}
+	Schedule(std::move(Continuation));
+}
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+	const uint32_t ThreadIndex = CurrentThreadIndex < Queues.size() ? CurrentThreadIndex : 0;
+	while (!Counter.IsDone())
+	{
+		if (!TryRunJob(ThreadIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The last job drains the counter under this lock, so once it is released the counter can be destroyed
+	std::lock_guard<std::mutex> Lock(Counter.ContinuationMutex);
+}
+
+void JobSystem::ParallelFor(uint32_t Begin, uint32_t End, uint32_t Grain, const std::function<void(uint32_t, uint32_t)>& Function, JobCounter& Counter)
+{
+	if (Begin >= End) return;
+
+	if (Grain == 0)
+	{
+		Grain = std::max((End - Begin) / (4 * GetThreadCount()), 1u);
+	}
+
+	for (uint32_t ChunkBegin = Begin; ChunkBegin < End; ChunkBegin += std::min(Grain, End - ChunkBegin))
+	{
+		const uint32_t ChunkEnd = ChunkBegin + std::min(Grain, End - ChunkBegin);
+		Schedule([&Function, ChunkBegin, ChunkEnd] { Function(ChunkBegin, ChunkEnd); }, &Counter);
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t Begin, uint32_t End, uint32_t Grain, const std::function<void(uint32_t, uint32_t)>& Function)
+{
+	JobCounter Counter;
+	ParallelFor(Begin, End, Grain, Function, Counter);
+	Wait(Counter);
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex()
+{
+	return CurrentThreadIndex;
+}
+
+void JobSystem::WorkerMain(uint32_t ThreadIndex)
+{
+	CurrentThreadIndex = ThreadIndex;
+
+	for (;;)
+	{
+		if (TryRunJob(ThreadIndex)) continue;
+
+		std::unique_lock<std::mutex> Lock(SleepMutex);
+		SleepingWorkers.fetch_add(1);
+		SleepCondition.wait(Lock, [this] { return ShuttingDown || QueuedJobs.load() != 0; });
+		SleepingWorkers.fetch_sub(1);
+		if (ShuttingDown) return;
+	}
+}
+
+bool JobSystem::TryRunJob(uint32_t ThreadIndex)
+{
+	std::pair<Job, JobCounter*> Next;
+
+	// Own queue is LIFO for cache locality, stealing takes the oldest job from a victim
+	bool Found = TryPop(ThreadIndex, true, Next);
+	const uint32_t QueueCount = static_cast<uint32_t>(Queues.size());
+	for (uint32_t Offset = 1; !Found && Offset < QueueCount; Offset++)
+	{
+		Found = TryPop((ThreadIndex + Offset) % QueueCount, false, Next);
+	}
+	if (!Found) return false;
+
+	QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	Next.first();
+	FinishJob(Next.second);
+	return true;
+}
+
+bool JobSystem::TryPop(uint32_t QueueIndex, bool FromBack, std::pair<Job, JobCounter*>& Result)
+{
+	WorkerQueue& Queue = *Queues[QueueIndex];
+	std::lock_guard<std::mutex> Lock(Queue.Mutex);
+	if (Queue.Jobs.empty()) return false;
+
+	if (FromBack)
+	{
+		Result = std::move(Queue.Jobs.back());
+		Queue.Jobs.pop_back();
+	}
+	else
+	{
+		Result = std::move(Queue.Jobs.front());
+		Queue.Jobs.pop_front();
+	}
+	return true;
+}
+
+void JobSystem::FinishJob(JobCounter* Counter)
+{
+	if (Counter == nullptr) return;
+
+	// Only the job that drains the counter needs the lock, everyone else just decrements
+	uint32_t Previous = Counter->Pending.load(std::memory_order_relaxed);
+	while (Previous > 1)
+	{
+		if (Counter->Pending.compare_exchange_weak(Previous, Previous - 1, std::memory_order_acq_rel)) return;
+	}
+
+	std::vector<Job> ReadyContinuations;
+	{
+		std::lock_guard<std::mutex> Lock(Counter->ContinuationMutex);
+		if (Counter->Pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		ReadyContinuations.swap(Counter->Continuations);
+	}
+
+	for (Job& Continuation : ReadyContinuations)
+	{
+		Schedule(std::move(Continuation));
+	}
+}
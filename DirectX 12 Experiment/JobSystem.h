@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Job = std::function<void()>;
+
+// Counts outstanding jobs; continuations attached with JobSystem::ContinueWith run once it drains
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> Pending{ 0 };
+	std::mutex ContinuationMutex;
+	std::vector<Job> Continuations;
+};
+
+class JobSystem
+{
+public:
+	// Zero workers picks one per hardware thread, minus the thread that owns the job system
+	explicit JobSystem(uint32_t NumberOfWorkers = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Schedule(Job NewJob, JobCounter* Counter = nullptr);
+	void ContinueWith(JobCounter& Counter, Job Continuation);
+
+	// Runs queued jobs on the calling thread until the counter drains
+	void Wait(JobCounter& Counter);
+
+	// Splits [Begin, End) into chunks of at most Grain items and schedules them against the counter.
+	// A Grain of zero picks a size that gives every thread a few chunks to steal.
+	// Function is captured by reference and must outlive the counter.
+	void ParallelFor(uint32_t Begin, uint32_t End, uint32_t Grain, const std::function<void(uint32_t, uint32_t)>& Function, JobCounter& Counter);
+	void ParallelFor(uint32_t Begin, uint32_t End, uint32_t Grain, const std::function<void(uint32_t, uint32_t)>& Function);
+
+	// Workers plus the owning thread
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(Queues.size()); }
+
+	// Zero for the owning thread and any thread the job system did not start
+	static uint32_t GetCurrentThreadIndex();
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::pair<Job, JobCounter*>> Jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> Queues;
+	std::vector<std::thread> Workers;
+
+	std::atomic<uint32_t> QueuedJobs{ 0 };
+	std::atomic<uint32_t> SleepingWorkers{ 0 };
+	std::mutex SleepMutex;
+	std::condition_variable SleepCondition;
+	bool ShuttingDown = false;
+
+	void WorkerMain(uint32_t ThreadIndex);
+	bool TryRunJob(uint32_t ThreadIndex);
+	bool TryPop(uint32_t QueueIndex, bool FromBack, std::pair<Job, JobCounter*>& Result);
+	void FinishJob(JobCounter* Counter);
+};
@@ -0,0 +1,39 @@
+#include "LatencyTracker.h"
+
+#include <algorithm>
+
+void LatencyTracker::OnInputConsumed(LatencyClock::time_point InputTimestamp)
+{
+	if (PendingInputCount < MaximumPendingInputs)
+	{
+		PendingInputs[PendingInputCount++] = InputTimestamp;
+	}
+}
+
+void LatencyTracker::OnPresent(LatencyClock::time_point PresentTimestamp)
+{
+	for (uint32_t InputIndex = 0; InputIndex < PendingInputCount; InputIndex++)
+	{
+		const double Milliseconds = std::chrono::duration<double, std::milli>(PresentTimestamp - PendingInputs[InputIndex]).count();
+		TotalMilliseconds += Milliseconds;
+		WorstMilliseconds = std::max(WorstMilliseconds, Milliseconds);
+		Samples++;
+	}
+	PendingInputCount = 0;
+}
+
+bool LatencyTracker::TryReport(double& AverageMilliseconds, double& MaximumMilliseconds, uint64_t& SampleCount)
+{
+	const LatencyClock::time_point Now = LatencyClock::now();
+	if (Now - WindowStart < std::chrono::seconds(1)) return false;
+
+	AverageMilliseconds = Samples != 0 ? TotalMilliseconds / static_cast<double>(Samples) : 0.0;
+	MaximumMilliseconds = WorstMilliseconds;
+	SampleCount = Samples;
+
+	WindowStart = Now;
+	TotalMilliseconds = 0.0;
+	WorstMilliseconds = 0.0;
+	Samples = 0;
+	return true;
+}
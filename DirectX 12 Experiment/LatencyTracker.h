@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+using LatencyClock = std::chrono::steady_clock;
+
+// Accumulates input-to-present latency over a reporting window
+class LatencyTracker
+{
+public:
+	// Called when the render thread consumes an input event for the frame it is about to build
+	void OnInputConsumed(LatencyClock::time_point InputTimestamp);
+
+	// Called right after present; every input consumed since the last present is charged to this frame
+	void OnPresent(LatencyClock::time_point PresentTimestamp);
+
+	// Returns true when a full window has elapsed, filling in the statistics and starting a new window
+	bool TryReport(double& AverageMilliseconds, double& MaximumMilliseconds, uint64_t& SampleCount);
+
+private:
+	static const uint32_t MaximumPendingInputs = 64;
+
+	LatencyClock::time_point PendingInputs[MaximumPendingInputs];
+	uint32_t PendingInputCount = 0;
+
+	LatencyClock::time_point WindowStart = LatencyClock::now();
+	double TotalMilliseconds = 0.0;
+	double WorstMilliseconds = 0.0;
+	uint64_t Samples = 0;
+};
@@ -0,0 +1,55 @@
+#include "LinearRingAllocator.h"
+
+#include <algorithm>
+
+LinearRingAllocator::LinearRingAllocator(uint64_t Capacity) :
+	Capacity(Capacity)
+{
+}
+
+uint64_t LinearRingAllocator::Allocate(uint64_t Size, uint64_t Alignment)
+{
+	const uint64_t PhysicalHead = Head % Capacity;
+	uint64_t Offset = (PhysicalHead + Alignment - 1) & ~(Alignment - 1);
+	uint64_t Padding = Offset - PhysicalHead;
+
+	// Skip the tail end of the ring rather than split an allocation across the wrap
+	if (Offset + Size > Capacity)
+	{
+		Padding = Capacity - PhysicalHead;
+		Offset = 0;
+	}
+
+	if (Size > Capacity || GetUsedBytes() + Padding + Size > Capacity)
+	{
+		Statistics.FailedAllocationCount++;
+		return InvalidOffset;
+	}
+
+	Head += Padding + Size;
+
+	Statistics.AllocationCount++;
+	Statistics.AllocatedBytes += Size;
+	Statistics.WastedBytes += Padding;
+	Statistics.PeakUsedBytes = std::max(Statistics.PeakUsedBytes, GetUsedBytes());
+	return Offset;
+}
+
+void LinearRingAllocator::FinishFrame(uint64_t FenceValue)
+{
+	if (Head == (Frames.empty() ? Tail : Frames.back().Head)) return;
+
+	FrameMarker Marker;
+	Marker.FenceValue = FenceValue;
+	Marker.Head = Head;
+	Frames.push_back(Marker);
+}
+
+void LinearRingAllocator::Retire(uint64_t CompletedFenceValue)
+{
+	while (!Frames.empty() && Frames.front().FenceValue <= CompletedFenceValue)
+	{
+		Tail = Frames.front().Head;
+		Frames.pop_front();
+	}
+}
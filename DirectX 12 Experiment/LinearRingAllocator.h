@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+struct LinearRingAllocatorStatistics
+{
+	uint64_t AllocationCount = 0;
+	uint64_t FailedAllocationCount = 0;
+	uint64_t AllocatedBytes = 0;
+	uint64_t WastedBytes = 0;
+	uint64_t PeakUsedBytes = 0;
+};
+
+// Offset-only ring sub-allocator. Allocations are grouped into frames tagged with a fence value,
+// and a frame's memory is recycled once that fence value has completed.
+class LinearRingAllocator
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+	explicit LinearRingAllocator(uint64_t Capacity);
+
+	// Returns InvalidOffset when the ring cannot fit the request until older frames retire.
+	// Alignment must be a power of two; an allocation never straddles the end of the ring.
+	uint64_t Allocate(uint64_t Size, uint64_t Alignment);
+
+	// Everything allocated since the previous call becomes reusable once FenceValue completes
+	void FinishFrame(uint64_t FenceValue);
+	void Retire(uint64_t CompletedFenceValue);
+
+	uint64_t GetCapacity() const { return Capacity; }
+	uint64_t GetUsedBytes() const { return Head - Tail; }
+	const LinearRingAllocatorStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	struct FrameMarker
+	{
+		uint64_t FenceValue;
+		uint64_t Head;
+	};
+
+	uint64_t Capacity;
+
+	// Head and Tail count bytes ever handed out and freed, the physical offset is taken modulo Capacity
+	uint64_t Head = 0;
+	uint64_t Tail = 0;
+	std::deque<FrameMarker> Frames;
+
+	LinearRingAllocatorStatistics Statistics;
+};
@@ -0,0 +1,234 @@
+#include "Lz4Codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static const size_t MinimumMatch = 4;
+static const size_t MaximumOffset = 65535;
+// The format requires the last five bytes to be literals and the last match to start twelve bytes before the end
+static const size_t LastLiterals = 5;
+static const size_t MatchSearchMargin = 12;
+static const uint32_t HashBits = 12;
+
+static uint32_t Read32(const uint8_t* Bytes)
+{
+	uint32_t Value;
+	memcpy(&Value, Bytes, sizeof(Value));
+	return Value;
+}
+
+static uint32_t FindLowestSetBit(uint64_t Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+	_BitScanForward64(&Index, Value);
+	return Index;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(Value));
+#endif
+}
+
+static uint32_t HashSequence(uint32_t Sequence)
+{
+	return (Sequence * 2654435761u) >> (32 - HashBits);
+}
+
+// Lengths of 15 and more continue in bytes of 255 ended by a smaller one
+static uint8_t* WriteLengthBytes(uint8_t* Output, size_t Length)
+{
+	for (; Length >= 255; Length -= 255)
+	{
+		*Output++ = 255;
+	}
+	*Output++ = static_cast<uint8_t>(Length);
+	return Output;
+}
+
+static bool ReadLengthBytes(const uint8_t*& Input, const uint8_t* InputEnd, size_t& Length)
+{
+	uint8_t Byte;
+	do
+	{
+		if (Input == InputEnd) return false;
+		Byte = *Input++;
+		Length += Byte;
+	} while (Byte == 255);
+	return true;
+}
+
+// A zero offset writes the final sequence, which only has literals
+static bool WriteSequence(uint8_t*& Output, const uint8_t* OutputEnd, const uint8_t* Literals, size_t LiteralCount, size_t Offset, size_t MatchLength)
+{
+	const size_t WorstCaseSize = 2 + LiteralCount / 255 + LiteralCount + (Offset != 0 ? 3 + MatchLength / 255 : 0);
+	if (static_cast<size_t>(OutputEnd - Output) < WorstCaseSize) return false;
+
+	uint8_t* Token = Output++;
+	*Token = static_cast<uint8_t>(std::min<size_t>(LiteralCount, 15) << 4);
+	if (LiteralCount >= 15)
+	{
+		Output = WriteLengthBytes(Output, LiteralCount - 15);
+	}
+	if (LiteralCount != 0)
+	{
+		memcpy(Output, Literals, LiteralCount);
+		Output += LiteralCount;
+	}
+	if (Offset == 0) return true;
+
+	*Output++ = static_cast<uint8_t>(Offset);
+	*Output++ = static_cast<uint8_t>(Offset >> 8);
+	const size_t ExtraLength = MatchLength - MinimumMatch;
+	*Token |= static_cast<uint8_t>(std::min<size_t>(ExtraLength, 15));
+	if (ExtraLength >= 15)
+	{
+		Output = WriteLengthBytes(Output, ExtraLength - 15);
+	}
+	return true;
+}
+
+size_t GetLz4CompressBound(size_t Size)
+{
+	return Size + Size / 255 + 16;
+}
+
+size_t CompressLz4(const uint8_t* Source, size_t SourceSize, uint8_t* Destination, size_t Capacity)
+{
+	uint8_t* Output = Destination;
+	const uint8_t* OutputEnd = Destination + Capacity;
+	size_t Anchor = 0;
+
+	if (SourceSize > MatchSearchMargin)
+	{
+		// Last position each hashed sequence was seen at; stale entries are rejected by comparing the bytes
+		size_t Table[1 << HashBits] = {};
+		const size_t SearchEnd = SourceSize - MatchSearchMargin;
+		const size_t MatchEnd = SourceSize - LastLiterals;
+		size_t Position = 0;
+		uint32_t Misses = 0;
+		while (Position < SearchEnd)
+		{
+			const uint32_t Sequence = Read32(Source + Position);
+			size_t& Slot = Table[HashSequence(Sequence)];
+			const size_t Candidate = Slot;
+			Slot = Position;
+			if (Candidate >= Position || Position - Candidate > MaximumOffset || Read32(Source + Candidate) != Sequence)
+			{
+				// Steps grow through data that does not match, so incompressible input passes quickly
+				Position += 1 + (Misses++ >> 6);
+				continue;
+			}
+			Misses = 0;
+
+			// Matches grow backwards into the pending literals as well as forwards
+			size_t Start = Position;
+			size_t Match = Candidate;
+			while (Start > Anchor && Match > 0 && Source[Start - 1] == Source[Match - 1])
+			{
+				Start--;
+				Match--;
+			}
+			// Eight bytes at a time, the first differing byte is the lowest set byte of the difference on little endian
+			size_t End = Position + MinimumMatch;
+			while (End + 8 <= MatchEnd)
+			{
+				uint64_t Current, Earlier;
+				memcpy(&Current, Source + End, sizeof(Current));
+				memcpy(&Earlier, Source + Match + (End - Start), sizeof(Earlier));
+				if (Current != Earlier)
+				{
+					End += FindLowestSetBit(Current ^ Earlier) / 8;
+					break;
+				}
+				End += 8;
+			}
+			while (End < MatchEnd && Source[End] == Source[Match + (End - Start)])
+			{
+				End++;
+			}
+
+			if (!WriteSequence(Output, OutputEnd, Source + Anchor, Start - Anchor, Start - Match, End - Start)) return 0;
+			Table[HashSequence(Read32(Source + End - 2))] = End - 2;
+			Anchor = End;
+			Position = End;
+		}
+	}
+
+	if (!WriteSequence(Output, OutputEnd, Source + Anchor, SourceSize - Anchor, 0, 0)) return 0;
+	return static_cast<size_t>(Output - Destination);
+}
+
+// Copies in whole 16 byte steps, writing up to 15 bytes past Size; a match source at least 16 bytes back never
+// overlaps the step being written, so this also repeats overlapping matches correctly
+static void WildCopy(uint8_t* Destination, const uint8_t* Source, size_t Size)
+{
+	for (size_t Copied = 0; Copied < Size; Copied += 16)
+	{
+		memcpy(Destination + Copied, Source + Copied, 16);
+	}
+}
+
+bool DecompressLz4(const uint8_t* Source, size_t SourceSize, uint8_t* Destination, size_t DestinationSize)
+{
+	const uint8_t* Input = Source;
+	const uint8_t* InputEnd = Source + SourceSize;
+	uint8_t* Output = Destination;
+	uint8_t* OutputEnd = Destination + DestinationSize;
+
+	while (Input < InputEnd)
+	{
+		const uint8_t Token = *Input++;
+		size_t LiteralCount = Token >> 4;
+		if (LiteralCount == 15 && !ReadLengthBytes(Input, InputEnd, LiteralCount)) return false;
+		if (LiteralCount > static_cast<size_t>(InputEnd - Input) || LiteralCount > static_cast<size_t>(OutputEnd - Output)) return false;
+		// Short copies dominate, so they overshoot wherever both buffers have room for it
+		if (static_cast<size_t>(InputEnd - Input) >= LiteralCount + 16 && static_cast<size_t>(OutputEnd - Output) >= LiteralCount + 16)
+		{
+			WildCopy(Output, Input, LiteralCount);
+		}
+		else if (LiteralCount != 0)
+		{
+			memcpy(Output, Input, LiteralCount);
+		}
+		Input += LiteralCount;
+		Output += LiteralCount;
+
+		// Only the last sequence ends without a match
+		if (Input == InputEnd) break;
+		if (InputEnd - Input < 2) return false;
+		const size_t Offset = static_cast<size_t>(Input[0]) | static_cast<size_t>(Input[1]) << 8;
+		Input += 2;
+		if (Offset == 0 || Offset > static_cast<size_t>(Output - Destination)) return false;
+
+		size_t MatchLength = Token & 15;
+		if (MatchLength == 15 && !ReadLengthBytes(Input, InputEnd, MatchLength)) return false;
+		MatchLength += MinimumMatch;
+		if (MatchLength > static_cast<size_t>(OutputEnd - Output)) return false;
+
+		if (Offset >= 16 && static_cast<size_t>(OutputEnd - Output) >= MatchLength + 16)
+		{
+			WildCopy(Output, Output - Offset, MatchLength);
+			Output += MatchLength;
+			continue;
+		}
+
+		// Overlapping matches repeat the last Offset bytes, which is copied a period at a time
+		if (Offset == 1)
+		{
+			memset(Output, Output[-1], MatchLength);
+			Output += MatchLength;
+			continue;
+		}
+		for (size_t Remaining = MatchLength; Remaining != 0;)
+		{
+			const size_t Step = std::min(Offset, Remaining);
+			memcpy(Output, Output - Offset, Step);
+			Output += Step;
+			Remaining -= Step;
+		}
+	}
+	return Output == OutputEnd;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format, without the frame format around it: a block carries neither its sizes nor a checksum, so the
+// caller stores both sizes. Blocks written here decode with any LZ4 implementation and the other way around.
+
+// Largest compressed size of Size bytes, reached when nothing matches
+size_t GetLz4CompressBound(size_t Size);
+
+// Greedy single pass compression. Returns the compressed size, or zero when it would not fit in Capacity.
+size_t CompressLz4(const uint8_t* Source, size_t SourceSize, uint8_t* Destination, size_t Capacity);
+
+// Decodes a whole block into exactly DestinationSize bytes. Returns false for malformed or truncated input and
+// never reads or writes outside either buffer, so blocks from untrusted files are safe to decode.
+bool DecompressLz4(const uint8_t* Source, size_t SourceSize, uint8_t* Destination, size_t DestinationSize);
@@ -28,12 +28,24 @@ LRESULT CALLBACK ProcessMessage(HWND Window, UINT Message, WPARAM WParameter, LP
 		}
 		return 0;
 
+	case WM_SIZE:
+		if (App != nullptr)
+		{
+			App->OnResize(LOWORD(LParameter), HIWORD(LParameter));
+		}
+		return 0;
+
 	case WM_PAINT:
+		// Frames are produced by the render thread, painting only has to validate the window
+		ValidateRect(Window, nullptr);
+		return 0;
+
+	case WM_CLOSE:
 		if (App != nullptr)
 		{
-			App->Update();
-			App->Render();
+			App->StopRenderThread();
 		}
+		DestroyWindow(Window);
 		return 0;
 
 	case WM_DESTROY:
@@ -63,7 +75,7 @@ int WINAPI WinMain(HINSTANCE Instance, HINSTANCE, LPSTR, int ShowCommands)
 	WindowClass.lpszClassName = L"DirectX 12 Window Class";
 	RegisterClassEx(&WindowClass);
 
-	RECT WindowRectangle = { 0, 0, static_cast<LONG>(App->GetWidth()), static_cast<LONG>(App->GetHeight()) };
+	RECT WindowRectangle = { 0, 0, static_cast<LONG>(App->GetInitialWidth()), static_cast<LONG>(App->GetInitialHeight()) };
 	AdjustWindowRect(&WindowRectangle, WS_OVERLAPPEDWINDOW, FALSE);
 
 	HWND Window = CreateWindow(
@@ -83,15 +95,13 @@ int WINAPI WinMain(HINSTANCE Instance, HINSTANCE, LPSTR, int ShowCommands)
 	App->SetWindow(Window);
 	App->Initialize();
 	ShowWindow(Window, ShowCommands);
+	App->StartRenderThread();
 
 	MSG Message = {};
-	while (Message.message != WM_QUIT)
+	while (GetMessage(&Message, nullptr, 0, 0) > 0)
 	{
-		if (PeekMessage(&Message, nullptr, 0, 0, PM_REMOVE))
-		{
-			TranslateMessage(&Message);
-			DispatchMessage(&Message);
-		}
+		TranslateMessage(&Message);
+		DispatchMessage(&Message);
 	}
 
 	App->Dispose();
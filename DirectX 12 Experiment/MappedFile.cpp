@@ -0,0 +1,163 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static std::wstring ToWidePath(const std::string& Path)
+{
+	const int Length = MultiByteToWideChar(CP_UTF8, 0, Path.c_str(), static_cast<int>(Path.size()), nullptr, 0);
+	std::wstring WidePath(static_cast<size_t>(Length), L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, Path.c_str(), static_cast<int>(Path.size()), &WidePath[0], Length);
+	return WidePath;
+}
+
+bool MappedFile::Open(const std::string& Path)
+{
+	Close();
+
+	HANDLE File = CreateFileW(ToWidePath(Path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(File, &FileSize))
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	// Mapping an empty file fails, so it opens with no view
+	FileHandle = File;
+	Opened = true;
+	if (FileSize.QuadPart == 0) return true;
+
+	MappingHandle = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (MappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	Data = static_cast<const uint8_t*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (Data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	Size = static_cast<size_t>(FileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data != nullptr) UnmapViewOfFile(Data);
+	if (MappingHandle != nullptr) CloseHandle(MappingHandle);
+	if (FileHandle != nullptr) CloseHandle(FileHandle);
+	Data = nullptr;
+	Size = 0;
+	MappingHandle = nullptr;
+	FileHandle = nullptr;
+	Opened = false;
+}
+
+bool WriteFileAtomically(const std::string& Path, const void* Data, size_t Size)
+{
+	const std::wstring TemporaryPath = ToWidePath(Path + ".tmp");
+	HANDLE File = CreateFileW(TemporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE) return false;
+
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+	bool Succeeded = true;
+	while (Succeeded && Size != 0)
+	{
+		const DWORD Chunk = static_cast<DWORD>(Size < 0x40000000 ? Size : 0x40000000);
+		DWORD Written = 0;
+		Succeeded = WriteFile(File, Bytes, Chunk, &Written, nullptr) && Written == Chunk;
+		Bytes += Chunk;
+		Size -= Chunk;
+	}
+	CloseHandle(File);
+
+	if (!Succeeded || !MoveFileExW(TemporaryPath.c_str(), ToWidePath(Path).c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(TemporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+#else
+bool MappedFile::Open(const std::string& Path)
+{
+	Close();
+
+	const int File = open(Path.c_str(), O_RDONLY);
+	if (File < 0) return false;
+
+	struct stat Status;
+	if (fstat(File, &Status) != 0)
+	{
+		close(File);
+		return false;
+	}
+
+	// The mapping keeps the file alive on its own, and an empty file has nothing to map
+	if (Status.st_size != 0)
+	{
+		void* View = mmap(nullptr, static_cast<size_t>(Status.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+		if (View == MAP_FAILED)
+		{
+			close(File);
+			return false;
+		}
+		Data = static_cast<const uint8_t*>(View);
+		Size = static_cast<size_t>(Status.st_size);
+	}
+	close(File);
+	Opened = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data != nullptr) munmap(const_cast<uint8_t*>(Data), Size);
+	Data = nullptr;
+	Size = 0;
+	Opened = false;
+}
+
+bool WriteFileAtomically(const std::string& Path, const void* Data, size_t Size)
+{
+	const std::string TemporaryPath = Path + ".tmp";
+	const int File = open(TemporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (File < 0) return false;
+
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+	bool Succeeded = true;
+	while (Succeeded && Size != 0)
+	{
+		const ssize_t Written = write(File, Bytes, Size);
+		Succeeded = Written > 0;
+		if (Succeeded)
+		{
+			Bytes += Written;
+			Size -= static_cast<size_t>(Written);
+		}
+	}
+	Succeeded = close(File) == 0 && Succeeded;
+
+	if (!Succeeded || rename(TemporaryPath.c_str(), Path.c_str()) != 0)
+	{
+		unlink(TemporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file, mapped rather than read so large packs cost nothing until touched.
+// Paths are UTF-8 on every platform.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false when the file cannot be opened; an empty file opens with no data
+	bool Open(const std::string& Path);
+	void Close();
+
+	bool IsOpen() const { return Opened; }
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+private:
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	bool Opened = false;
+#ifdef _WIN32
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#endif
+};
+
+// Writes Data to a temporary file beside Path and renames it over Path, so readers never see a partial file
+bool WriteFileAtomically(const std::string& Path, const void* Data, size_t Size);
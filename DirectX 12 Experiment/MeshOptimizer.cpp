@@ -0,0 +1,608 @@
+#include "MeshOptimizer.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+static void ValidateIndices(const uint32_t* Indices, size_t IndexCount, size_t VertexCount)
+{
+	if (IndexCount % 3 != 0) throw std::runtime_error("Index count must be a multiple of three");
+	for (size_t Index = 0; Index < IndexCount; Index++)
+	{
+		if (Indices[Index] >= VertexCount) throw std::runtime_error("Index refers to a vertex that does not exist");
+	}
+}
+
+// FIFO post-transform cache; a vertex is cached while fewer than CacheSize misses happened since it was loaded
+class VertexCacheSimulator
+{
+public:
+	VertexCacheSimulator(size_t VertexCount, uint32_t CacheSize) :
+		LoadedAt(VertexCount, 0),
+		CacheSize(CacheSize),
+		Misses(CacheSize + 1)
+	{
+	}
+
+	// Returns whether the vertex had to be transformed
+	bool Access(uint32_t Vertex)
+	{
+		if (Misses - LoadedAt[Vertex] <= CacheSize) return false;
+		LoadedAt[Vertex] = Misses++;
+		return true;
+	}
+
+	// Empties the cache without forgetting the vertices
+	void Flush()
+	{
+		Misses += CacheSize;
+	}
+
+private:
+	std::vector<uint64_t> LoadedAt;
+	const uint64_t CacheSize;
+	uint64_t Misses;
+};
+
+uint32_t GenerateIndexBuffer(const void* Vertices, size_t VertexCount, size_t VertexSize, uint32_t* Indices, void* UniqueVertices)
+{
+	if (VertexSize == 0) throw std::runtime_error("Vertices need a size");
+	if (VertexCount > UINT32_MAX) throw std::runtime_error("Too many vertices for 32 bit indices");
+
+	const uint8_t* Source = static_cast<const uint8_t*>(Vertices);
+	uint8_t* Unique = static_cast<uint8_t*>(UniqueVertices);
+
+	// Open addressing over the unique vertices, at most half full
+	size_t TableSize = 16;
+	while (TableSize < VertexCount * 2)
+	{
+		TableSize *= 2;
+	}
+	std::vector<uint32_t> Table(TableSize, UINT32_MAX);
+
+	uint32_t UniqueCount = 0;
+	for (size_t VertexIndex = 0; VertexIndex < VertexCount; VertexIndex++)
+	{
+		const uint8_t* Candidate = Source + VertexIndex * VertexSize;
+		size_t Slot = static_cast<size_t>(HashBytes(Candidate, VertexSize)) & (TableSize - 1);
+		while (Table[Slot] != UINT32_MAX && memcmp(Unique + static_cast<size_t>(Table[Slot]) * VertexSize, Candidate, VertexSize) != 0)
+		{
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+
+		if (Table[Slot] == UINT32_MAX)
+		{
+			// Unique vertices never overtake the input, so both may be the same buffer
+			memmove(Unique + static_cast<size_t>(UniqueCount) * VertexSize, Candidate, VertexSize);
+			Table[Slot] = UniqueCount++;
+		}
+		Indices[VertexIndex] = Table[Slot];
+	}
+	return UniqueCount;
+}
+
+// Scores from Forsyth's article: the last triangle's vertices score the same so the order within it does not
+// matter, later cache entries fall off with a power curve and vertices with few triangles left get a boost so
+// they are finished instead of being left behind as isolated triangles
+static const uint32_t ForsythCacheSize = 32;
+static const uint32_t ForsythMaximumValence = 32;
+
+struct ForsythScoreTables
+{
+	float Cache[ForsythCacheSize];
+	float Valence[ForsythMaximumValence];
+};
+
+static ForsythScoreTables BuildForsythScoreTables()
+{
+	ForsythScoreTables Tables;
+	for (uint32_t Position = 0; Position < ForsythCacheSize; Position++)
+	{
+		Tables.Cache[Position] = Position < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(Position - 3) / static_cast<float>(ForsythCacheSize - 3), 1.5f);
+	}
+	Tables.Valence[0] = 0.0f;
+	for (uint32_t Valence = 1; Valence < ForsythMaximumValence; Valence++)
+	{
+		Tables.Valence[Valence] = 2.0f / std::sqrt(static_cast<float>(Valence));
+	}
+	return Tables;
+}
+
+static float ScoreVertex(const ForsythScoreTables& Tables, int32_t CachePosition, uint32_t RemainingTriangles)
+{
+	if (RemainingTriangles == 0) return -1.0f;
+
+	const float CacheScore = CachePosition < 0 ? 0.0f : Tables.Cache[CachePosition];
+	return CacheScore + Tables.Valence[std::min(RemainingTriangles, ForsythMaximumValence - 1)];
+}
+
+void OptimizeVertexCache(uint32_t* Indices, size_t IndexCount, size_t VertexCount)
+{
+	ValidateIndices(Indices, IndexCount, VertexCount);
+	const size_t TriangleCount = IndexCount / 3;
+	if (TriangleCount < 2) return;
+
+	static const ForsythScoreTables Tables = BuildForsythScoreTables();
+
+	// The triangles of every vertex in one array; a vertex's slice shrinks as its triangles are emitted
+	std::vector<uint32_t> RemainingTriangles(VertexCount, 0);
+	for (size_t Index = 0; Index < IndexCount; Index++)
+	{
+		RemainingTriangles[Indices[Index]]++;
+	}
+	std::vector<uint32_t> FirstAdjacency(VertexCount + 1, 0);
+	for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+	{
+		FirstAdjacency[Vertex + 1] = FirstAdjacency[Vertex] + RemainingTriangles[Vertex];
+	}
+	std::vector<uint32_t> AdjacentTriangles(IndexCount);
+	{
+		std::vector<uint32_t> Filled(FirstAdjacency.begin(), FirstAdjacency.end() - 1);
+		for (size_t Index = 0; Index < IndexCount; Index++)
+		{
+			AdjacentTriangles[Filled[Indices[Index]]++] = static_cast<uint32_t>(Index / 3);
+		}
+	}
+
+	std::vector<int32_t> CachePositions(VertexCount, -1);
+	std::vector<float> VertexScores(VertexCount);
+	for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+	{
+		VertexScores[Vertex] = ScoreVertex(Tables, -1, RemainingTriangles[Vertex]);
+	}
+
+	std::vector<float> TriangleScores(TriangleCount);
+	size_t BestTriangle = 0;
+	for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+	{
+		TriangleScores[Triangle] = VertexScores[Indices[3 * Triangle]] + VertexScores[Indices[3 * Triangle + 1]] + VertexScores[Indices[3 * Triangle + 2]];
+		if (TriangleScores[Triangle] > TriangleScores[BestTriangle])
+		{
+			BestTriangle = Triangle;
+		}
+	}
+
+	std::vector<uint8_t> Emitted(TriangleCount, 0);
+	std::vector<uint32_t> Output(IndexCount);
+	uint32_t Cache[ForsythCacheSize + 3];
+	uint32_t CacheCount = 0;
+	size_t NextUnemitted = 0;
+
+	for (size_t Written = 0; Written < TriangleCount; Written++)
+	{
+		// Nothing in the cache has triangles left, continue with the first triangle not emitted yet
+		if (BestTriangle == SIZE_MAX)
+		{
+			while (Emitted[NextUnemitted])
+			{
+				NextUnemitted++;
+			}
+			BestTriangle = NextUnemitted;
+		}
+
+		const uint32_t* Corners = &Indices[3 * BestTriangle];
+		std::copy(Corners, Corners + 3, &Output[3 * Written]);
+		Emitted[BestTriangle] = 1;
+
+		for (uint32_t Corner = 0; Corner < 3; Corner++)
+		{
+			const uint32_t Vertex = Corners[Corner];
+			uint32_t* Adjacency = &AdjacentTriangles[FirstAdjacency[Vertex]];
+			uint32_t& Count = RemainingTriangles[Vertex];
+			uint32_t* Found = std::find(Adjacency, Adjacency + Count, static_cast<uint32_t>(BestTriangle));
+			*Found = Adjacency[--Count];
+		}
+
+		// The triangle's vertices move to the front, entries pushed past the cache size fall out
+		uint32_t NewCache[ForsythCacheSize + 3];
+		uint32_t NewCount = 0;
+		for (uint32_t Corner = 0; Corner < 3; Corner++)
+		{
+			if (std::find(NewCache, NewCache + NewCount, Corners[Corner]) == NewCache + NewCount)
+			{
+				NewCache[NewCount++] = Corners[Corner];
+			}
+		}
+		for (uint32_t Entry = 0; Entry < CacheCount; Entry++)
+		{
+			if (std::find(Corners, Corners + 3, Cache[Entry]) == Corners + 3)
+			{
+				NewCache[NewCount++] = Cache[Entry];
+			}
+		}
+
+		// Rescore every vertex whose cache position or triangle count changed, along with its triangles
+		for (uint32_t Entry = 0; Entry < NewCount; Entry++)
+		{
+			const uint32_t Vertex = NewCache[Entry];
+			CachePositions[Vertex] = Entry < ForsythCacheSize ? static_cast<int32_t>(Entry) : -1;
+			const float Score = ScoreVertex(Tables, CachePositions[Vertex], RemainingTriangles[Vertex]);
+			const float Change = Score - VertexScores[Vertex];
+			VertexScores[Vertex] = Score;
+
+			const uint32_t* Adjacency = &AdjacentTriangles[FirstAdjacency[Vertex]];
+			for (uint32_t Triangle = 0; Triangle < RemainingTriangles[Vertex]; Triangle++)
+			{
+				TriangleScores[Adjacency[Triangle]] += Change;
+			}
+		}
+
+		// Only triangles touching the cache are candidates, which keeps the whole pass linear
+		CacheCount = std::min(NewCount, ForsythCacheSize);
+		std::copy(NewCache, NewCache + CacheCount, Cache);
+		BestTriangle = SIZE_MAX;
+		float BestScore = -1.0f;
+		for (uint32_t Entry = 0; Entry < CacheCount; Entry++)
+		{
+			const uint32_t Vertex = Cache[Entry];
+			const uint32_t* Adjacency = &AdjacentTriangles[FirstAdjacency[Vertex]];
+			for (uint32_t Triangle = 0; Triangle < RemainingTriangles[Vertex]; Triangle++)
+			{
+				if (TriangleScores[Adjacency[Triangle]] > BestScore)
+				{
+					BestScore = TriangleScores[Adjacency[Triangle]];
+					BestTriangle = Adjacency[Triangle];
+				}
+			}
+		}
+	}
+
+	std::copy(Output.begin(), Output.end(), Indices);
+}
+
+void OptimizeOverdraw(uint32_t* Indices, size_t IndexCount, const float* Positions, size_t VertexCount, size_t PositionStride, float Threshold)
+{
+	ValidateIndices(Indices, IndexCount, VertexCount);
+	const size_t TriangleCount = IndexCount / 3;
+	if (TriangleCount < 2) return;
+
+	static const uint32_t CacheSize = 16;
+	const VertexCacheStatistics Original = AnalyzeVertexCache(Indices, IndexCount, VertexCount, CacheSize);
+	auto GetPosition = [Positions, PositionStride](uint32_t Vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(Positions) + Vertex * PositionStride);
+	};
+
+	// Hard boundaries where all three vertices miss, so the cache order starts over anyway. Within those, soft
+	// boundaries wherever the cluster so far reuses the cache about as well as the whole mesh does.
+	std::vector<size_t> ClusterStarts;
+	{
+		VertexCacheSimulator Cache(VertexCount, CacheSize);
+		uint32_t ClusterMisses = 0;
+		size_t ClusterStart = 0;
+		for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+		{
+			uint32_t Misses = 0;
+			for (uint32_t Corner = 0; Corner < 3; Corner++)
+			{
+				Misses += Cache.Access(Indices[3 * Triangle + Corner]) ? 1 : 0;
+			}
+
+			const float ClusterRatio = static_cast<float>(ClusterMisses) / static_cast<float>(Triangle - ClusterStart);
+			if (Triangle == 0 || Misses == 3 || ClusterRatio <= Original.AverageCacheMissRatio * Threshold)
+			{
+				ClusterStarts.push_back(Triangle);
+				ClusterStart = Triangle;
+				ClusterMisses = 0;
+				if (Misses != 3)
+				{
+					// Estimated as if the cluster ran after any other, which the final check confirms
+					Cache.Flush();
+					Misses = 0;
+					for (uint32_t Corner = 0; Corner < 3; Corner++)
+					{
+						Misses += Cache.Access(Indices[3 * Triangle + Corner]) ? 1 : 0;
+					}
+				}
+			}
+			ClusterMisses += Misses;
+		}
+	}
+	const size_t ClusterCount = ClusterStarts.size();
+	ClusterStarts.push_back(TriangleCount);
+	if (ClusterCount < 2) return;
+
+	// Area weighted centroid and normal of every cluster, and the centroid of the whole mesh
+	std::vector<float> ClusterData(ClusterCount * 6, 0.0f);
+	std::vector<float> ClusterArea(ClusterCount, 0.0f);
+	float MeshCentroid[3] = {};
+	float MeshArea = 0.0f;
+	for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+	{
+		float* Centroid = &ClusterData[Cluster * 6];
+		float* Normal = Centroid + 3;
+		for (size_t Triangle = ClusterStarts[Cluster]; Triangle < ClusterStarts[Cluster + 1]; Triangle++)
+		{
+			const float* P0 = GetPosition(Indices[3 * Triangle]);
+			const float* P1 = GetPosition(Indices[3 * Triangle + 1]);
+			const float* P2 = GetPosition(Indices[3 * Triangle + 2]);
+			const float Edge0[3] = { P1[0] - P0[0], P1[1] - P0[1], P1[2] - P0[2] };
+			const float Edge1[3] = { P2[0] - P0[0], P2[1] - P0[1], P2[2] - P0[2] };
+			const float Cross[3] = { Edge0[1] * Edge1[2] - Edge0[2] * Edge1[1], Edge0[2] * Edge1[0] - Edge0[0] * Edge1[2], Edge0[0] * Edge1[1] - Edge0[1] * Edge1[0] };
+			const float Area = std::sqrt(Cross[0] * Cross[0] + Cross[1] * Cross[1] + Cross[2] * Cross[2]);
+			for (uint32_t Axis = 0; Axis < 3; Axis++)
+			{
+				Centroid[Axis] += (P0[Axis] + P1[Axis] + P2[Axis]) * Area;
+				Normal[Axis] += Cross[Axis];
+			}
+			ClusterArea[Cluster] += Area;
+		}
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			MeshCentroid[Axis] += Centroid[Axis];
+		}
+		MeshArea += ClusterArea[Cluster];
+	}
+	if (!(MeshArea > 0.0f)) return;
+	for (uint32_t Axis = 0; Axis < 3; Axis++)
+	{
+		MeshCentroid[Axis] /= 3.0f * MeshArea;
+	}
+
+	// Clusters facing away from the centre are outermost and most likely to hide the others, so they go first
+	std::vector<float> SortKeys(ClusterCount, 0.0f);
+	for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+	{
+		const float* Centroid = &ClusterData[Cluster * 6];
+		const float* Normal = Centroid + 3;
+		const float NormalLength = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+		if (!(ClusterArea[Cluster] > 0.0f) || !(NormalLength > 0.0f)) continue;
+
+		float Key = 0.0f;
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			Key += (Centroid[Axis] / (3.0f * ClusterArea[Cluster]) - MeshCentroid[Axis]) * Normal[Axis];
+		}
+		SortKeys[Cluster] = Key / NormalLength;
+	}
+	std::vector<uint32_t> Order(ClusterCount);
+	for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+	{
+		Order[Cluster] = static_cast<uint32_t>(Cluster);
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&SortKeys](uint32_t Left, uint32_t Right) { return SortKeys[Left] > SortKeys[Right]; });
+
+	std::vector<uint32_t> Reordered;
+	Reordered.reserve(IndexCount);
+	for (uint32_t Cluster : Order)
+	{
+		Reordered.insert(Reordered.end(), Indices + 3 * ClusterStarts[Cluster], Indices + 3 * ClusterStarts[Cluster + 1]);
+	}
+
+	const VertexCacheStatistics Result = AnalyzeVertexCache(Reordered.data(), IndexCount, VertexCount, CacheSize);
+	if (Result.AverageCacheMissRatio > Original.AverageCacheMissRatio * Threshold) return;
+	std::copy(Reordered.begin(), Reordered.end(), Indices);
+}
+
+size_t OptimizeVertexFetch(void* Vertices, uint32_t* Indices, size_t IndexCount, size_t VertexCount, size_t VertexSize)
+{
+	ValidateIndices(Indices, IndexCount, VertexCount);
+
+	std::vector<uint32_t> Remap(VertexCount, UINT32_MAX);
+	uint32_t NextVertex = 0;
+	for (size_t Index = 0; Index < IndexCount; Index++)
+	{
+		uint32_t& Target = Remap[Indices[Index]];
+		if (Target == UINT32_MAX)
+		{
+			Target = NextVertex++;
+		}
+		Indices[Index] = Target;
+	}
+
+	uint8_t* Data = static_cast<uint8_t*>(Vertices);
+	std::vector<uint8_t> Reordered(static_cast<size_t>(NextVertex) * VertexSize);
+	for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+	{
+		if (Remap[Vertex] == UINT32_MAX) continue;
+		memcpy(&Reordered[static_cast<size_t>(Remap[Vertex]) * VertexSize], Data + Vertex * VertexSize, VertexSize);
+	}
+	std::copy(Reordered.begin(), Reordered.end(), Data);
+	return NextVertex;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, uint32_t CacheSize)
+{
+	ValidateIndices(Indices, IndexCount, VertexCount);
+
+	VertexCacheStatistics Statistics;
+	VertexCacheSimulator Cache(VertexCount, CacheSize);
+	std::vector<uint8_t> Referenced(VertexCount, 0);
+	size_t ReferencedCount = 0;
+	for (size_t Index = 0; Index < IndexCount; Index++)
+	{
+		Statistics.VerticesTransformed += Cache.Access(Indices[Index]) ? 1 : 0;
+		if (!Referenced[Indices[Index]])
+		{
+			Referenced[Indices[Index]] = 1;
+			ReferencedCount++;
+		}
+	}
+
+	if (IndexCount != 0)
+	{
+		Statistics.AverageCacheMissRatio = static_cast<float>(Statistics.VerticesTransformed) / static_cast<float>(IndexCount / 3);
+		Statistics.AverageTransformedVertexRatio = static_cast<float>(Statistics.VerticesTransformed) / static_cast<float>(ReferencedCount);
+	}
+	return Statistics;
+}
+
+VertexFetchStatistics AnalyzeVertexFetch(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, size_t VertexSize)
+{
+	ValidateIndices(Indices, IndexCount, VertexCount);
+
+	static const size_t LineSize = 64;
+	static const uint64_t LineCount = 64;
+	VertexFetchStatistics Statistics;
+	std::unordered_map<size_t, uint64_t> LoadedAt;
+	uint64_t Loads = LineCount + 1;
+	std::vector<uint8_t> Referenced(VertexCount, 0);
+	size_t ReferencedCount = 0;
+	for (size_t Index = 0; Index < IndexCount; Index++)
+	{
+		const size_t Vertex = Indices[Index];
+		if (!Referenced[Vertex])
+		{
+			Referenced[Vertex] = 1;
+			ReferencedCount++;
+		}
+
+		// Every line the vertex touches, lines loaded more than LineCount loads ago have been evicted
+		for (size_t Line = Vertex * VertexSize / LineSize; Line <= ((Vertex + 1) * VertexSize - 1) / LineSize; Line++)
+		{
+			uint64_t& Loaded = LoadedAt[Line];
+			if (Loaded != 0 && Loads - Loaded <= LineCount) continue;
+			Loaded = Loads++;
+			Statistics.BytesFetched += LineSize;
+		}
+	}
+
+	if (ReferencedCount != 0)
+	{
+		Statistics.Overfetch = static_cast<float>(Statistics.BytesFetched) / static_cast<float>(ReferencedCount * VertexSize);
+	}
+	return Statistics;
+}
+
+uint16_t QuantizeHalf(float Value)
+{
+	uint32_t Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+	const uint16_t Sign = static_cast<uint16_t>((Bits >> 16) & 0x8000);
+	const uint32_t Magnitude = Bits & 0x7fffffff;
+
+	if (Magnitude > 0x7f800000) return Sign | 0x7e00;
+	// 65520 and above round past the largest half, 65504
+	if (Magnitude >= 0x477ff000) return Sign | 0x7c00;
+	// Below the smallest normal half the value is a multiple of 2^-24, rounded to nearest even by the FPU
+	if (Magnitude < 0x38800000)
+	{
+		float Absolute;
+		memcpy(&Absolute, &Magnitude, sizeof(Absolute));
+		return Sign | static_cast<uint16_t>(std::nearbyint(Absolute * 16777216.0f));
+	}
+
+	// Rebias the exponent and round the mantissa from 23 to 10 bits, ties to even
+	uint32_t Half = (Magnitude - 0x38000000) >> 13;
+	const uint32_t Remainder = Magnitude & 0x1fff;
+	if (Remainder > 0x1000 || (Remainder == 0x1000 && (Half & 1) != 0))
+	{
+		Half++;
+	}
+	return Sign | static_cast<uint16_t>(Half);
+}
+
+float DequantizeHalf(uint16_t Value)
+{
+	const uint32_t Sign = static_cast<uint32_t>(Value & 0x8000) << 16;
+	const uint32_t Exponent = (Value >> 10) & 0x1f;
+	const uint32_t Mantissa = Value & 0x3ff;
+
+	if (Exponent == 0)
+	{
+		const float Magnitude = std::ldexp(static_cast<float>(Mantissa), -24);
+		return Sign != 0 ? -Magnitude : Magnitude;
+	}
+
+	const uint32_t Bits = Sign | (Exponent == 31 ? 0x7f800000 : (Exponent + 112) << 23) | (Mantissa << 13);
+	float Result;
+	memcpy(&Result, &Bits, sizeof(Result));
+	return Result;
+}
+
+uint16_t QuantizeUnorm16(float Value)
+{
+	const float Clamped = std::min(std::max(Value, 0.0f), 1.0f);
+	return static_cast<uint16_t>(std::lrint(Clamped * 65535.0f));
+}
+
+QuantizedVertex QuantizeVertex(const float Position[3], const float UV[2])
+{
+	QuantizedVertex Quantized;
+	for (uint32_t Axis = 0; Axis < 3; Axis++)
+	{
+		Quantized.Position[Axis] = QuantizeHalf(Position[Axis]);
+	}
+	Quantized.Position[3] = QuantizeHalf(1.0f);
+	Quantized.UV[0] = QuantizeUnorm16(UV[0]);
+	Quantized.UV[1] = QuantizeUnorm16(UV[1]);
+	return Quantized;
+}
+
+static float SignNotZero(float Value)
+{
+	return Value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Projects onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the diagonals
+static void FoldOctahedral(const float Normal[3], float& X, float& Y)
+{
+	const float Length = std::fabs(Normal[0]) + std::fabs(Normal[1]) + std::fabs(Normal[2]);
+	X = Length > 0.0f ? Normal[0] / Length : 0.0f;
+	Y = Length > 0.0f ? Normal[1] / Length : 0.0f;
+	if (Normal[2] < 0.0f)
+	{
+		const float FoldedX = (1.0f - std::fabs(Y)) * SignNotZero(X);
+		Y = (1.0f - std::fabs(X)) * SignNotZero(Y);
+		X = FoldedX;
+	}
+}
+
+static void UnfoldOctahedral(float X, float Y, float Normal[3])
+{
+	Normal[2] = 1.0f - std::fabs(X) - std::fabs(Y);
+	if (Normal[2] < 0.0f)
+	{
+		const float UnfoldedX = (1.0f - std::fabs(Y)) * SignNotZero(X);
+		Y = (1.0f - std::fabs(X)) * SignNotZero(Y);
+		X = UnfoldedX;
+	}
+	Normal[0] = X;
+	Normal[1] = Y;
+
+	const float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+	for (uint32_t Axis = 0; Axis < 3; Axis++)
+	{
+		Normal[Axis] /= Length;
+	}
+}
+
+template <typename SnormType>
+static void EncodeOctahedral(const float Normal[3], SnormType Encoded[2], float Maximum)
+{
+	float X, Y;
+	FoldOctahedral(Normal, X, Y);
+	Encoded[0] = static_cast<SnormType>(std::lrint(std::min(std::max(X, -1.0f), 1.0f) * Maximum));
+	Encoded[1] = static_cast<SnormType>(std::lrint(std::min(std::max(Y, -1.0f), 1.0f) * Maximum));
+}
+
+// SNORM decoding maps the lowest value to -1 as well
+template <typename SnormType>
+static void DecodeOctahedral(const SnormType Encoded[2], float Normal[3], float Maximum)
+{
+	UnfoldOctahedral(std::max(static_cast<float>(Encoded[0]) / Maximum, -1.0f), std::max(static_cast<float>(Encoded[1]) / Maximum, -1.0f), Normal);
+}
+
+void EncodeOctahedralNormal(const float Normal[3], int8_t Encoded[2])
+{
+	EncodeOctahedral(Normal, Encoded, 127.0f);
+}
+
+void EncodeOctahedralNormal(const float Normal[3], int16_t Encoded[2])
+{
+	EncodeOctahedral(Normal, Encoded, 32767.0f);
+}
+
+void DecodeOctahedralNormal(const int8_t Encoded[2], float Normal[3])
+{
+	DecodeOctahedral(Encoded, Normal, 127.0f);
+}
+
+void DecodeOctahedralNormal(const int16_t Encoded[2], float Normal[3])
+{
+	DecodeOctahedral(Encoded, Normal, 32767.0f);
+}
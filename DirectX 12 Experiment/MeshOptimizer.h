@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Triangle lists are optimized in place as 32 bit indices; the device narrows them to 16 bits when they fit.
+// The usual order is GenerateIndexBuffer, OptimizeVertexCache, OptimizeOverdraw and OptimizeVertexFetch last,
+// since the fetch order follows the final index order.
+
+// Post-transform cache behaviour, simulated as a FIFO cache of CacheSize vertices
+struct VertexCacheStatistics
+{
+	uint32_t VerticesTransformed = 0;
+	// Transformed vertices per triangle, 3 without any reuse and about 0.5 for a large regular grid
+	float AverageCacheMissRatio = 0.0f;
+	// Transformed vertices per referenced vertex, 1 is the best possible
+	float AverageTransformedVertexRatio = 0.0f;
+};
+
+// Memory traffic of the vertex fetch, simulated over a FIFO cache of 64 byte lines
+struct VertexFetchStatistics
+{
+	uint64_t BytesFetched = 0;
+	// Bytes fetched over the bytes of the referenced vertices, 1 when every vertex is read once
+	float Overfetch = 0.0f;
+};
+
+// Welds bitwise identical vertices: writes one index per input vertex and the unique vertices, in the order they
+// first occur, to UniqueVertices, which needs room for VertexCount vertices. Returns the unique vertex count.
+uint32_t GenerateIndexBuffer(const void* Vertices, size_t VertexCount, size_t VertexSize, uint32_t* Indices, void* UniqueVertices);
+
+// Reorders triangles so vertices are reused while still in the post-transform cache, following Forsyth's linear
+// speed vertex cache optimization. Independent of the actual cache size, which no API reports.
+void OptimizeVertexCache(uint32_t* Indices, size_t IndexCount, size_t VertexCount);
+
+// Reorders clusters of triangles, split where the cache order starts over, so outward facing clusters are drawn
+// first and hide what lies behind them. Positions are three floats PositionStride bytes apart. The new order is
+// only kept while the cache miss ratio grows by less than Threshold times.
+void OptimizeOverdraw(uint32_t* Indices, size_t IndexCount, const float* Positions, size_t VertexCount, size_t PositionStride, float Threshold = 1.05f);
+
+// Moves vertices into the order the indices first reference them and rewrites the indices to match, so the fetch
+// walks memory forwards. Unreferenced vertices are dropped; returns the number of vertices kept at the front.
+size_t OptimizeVertexFetch(void* Vertices, uint32_t* Indices, size_t IndexCount, size_t VertexCount, size_t VertexSize);
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, uint32_t CacheSize = 16);
+VertexFetchStatistics AnalyzeVertexFetch(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, size_t VertexSize);
+
+// Position as half floats with w set to one and texture coordinates as 16 bit UNORM, 12 bytes instead of 20.
+// Read as R16G16B16A16_FLOAT and R16G16_UNORM, so shaders see the same float inputs as before.
+struct QuantizedVertex
+{
+	uint16_t Position[4];
+	uint16_t UV[2];
+};
+
+// Round to nearest even; out of range values saturate to infinity and NaN stays NaN
+uint16_t QuantizeHalf(float Value);
+float DequantizeHalf(uint16_t Value);
+// Texture coordinates outside [0, 1] are clamped, so repeating coordinates need the float layout
+uint16_t QuantizeUnorm16(float Value);
+
+QuantizedVertex QuantizeVertex(const float Position[3], const float UV[2]);
+
+// Unit normals folded onto an octahedron and stored as two SNORM values, read as R8G8_SNORM or R16G16_SNORM
+// and unfolded in the shader. Eight bits keep the error below a degree and a half.
+void EncodeOctahedralNormal(const float Normal[3], int8_t Encoded[2]);
+void EncodeOctahedralNormal(const float Normal[3], int16_t Encoded[2]);
+void DecodeOctahedralNormal(const int8_t Encoded[2], float Normal[3]);
+void DecodeOctahedralNormal(const int16_t Encoded[2], float Normal[3]);
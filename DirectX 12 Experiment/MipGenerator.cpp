@@ -0,0 +1,350 @@
+#include "MipGenerator.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+static const uint32_t KaiserTapCount = 6;
+static const uint32_t SrgbEncodeTableSize = 4096;
+
+struct MipTables
+{
+	float SrgbToLinear[256];
+	uint8_t LinearToSrgb[SrgbEncodeTableSize];
+	float KaiserWeights[KaiserTapCount];
+
+	MipTables()
+	{
+		for (uint32_t Value = 0; Value < 256; Value++)
+		{
+			const float Encoded = static_cast<float>(Value) / 255.0f;
+			SrgbToLinear[Value] = Encoded <= 0.04045f ? Encoded / 12.92f : std::pow((Encoded + 0.055f) / 1.055f, 2.4f);
+		}
+
+		for (uint32_t Index = 0; Index < SrgbEncodeTableSize; Index++)
+		{
+			const float Linear = static_cast<float>(Index) / static_cast<float>(SrgbEncodeTableSize - 1);
+			const float Encoded = Linear <= 0.0031308f ? Linear * 12.92f : 1.055f * std::pow(Linear, 1.0f / 2.4f) - 0.055f;
+			LinearToSrgb[Index] = static_cast<uint8_t>(std::lrint(std::min(std::max(Encoded, 0.0f), 1.0f) * 255.0f));
+		}
+
+		// Taps sit at -2.5 .. 2.5 source texels from the destination texel center, halving the bandwidth
+		const double Alpha = 4.0;
+		const double Radius = 3.0;
+		const double Pi = 3.14159265358979323846;
+		double Total = 0.0;
+		double Weights[KaiserTapCount];
+		for (uint32_t Tap = 0; Tap < KaiserTapCount; Tap++)
+		{
+			const double X = static_cast<double>(Tap) - 2.5;
+			const double Sinc = std::sin(Pi * X * 0.5) / (Pi * X * 0.5);
+			const double Ratio = X / Radius;
+			Weights[Tap] = Sinc * BesselI0(Alpha * std::sqrt(1.0 - Ratio * Ratio)) / BesselI0(Alpha);
+			Total += Weights[Tap];
+		}
+		for (uint32_t Tap = 0; Tap < KaiserTapCount; Tap++)
+		{
+			KaiserWeights[Tap] = static_cast<float>(Weights[Tap] / Total);
+		}
+	}
+
+	static double BesselI0(double X)
+	{
+		double Sum = 1.0;
+		double Term = 1.0;
+		for (int K = 1; K < 32; K++)
+		{
+			Term *= (X / (2.0 * K)) * (X / (2.0 * K));
+			Sum += Term;
+		}
+		return Sum;
+	}
+};
+
+static const MipTables& GetMipTables()
+{
+	static const MipTables Tables;
+	return Tables;
+}
+
+static void DecodeTexel(const uint8_t* Texel, bool Srgb, const MipTables& Tables, float Linear[4])
+{
+	for (uint32_t Channel = 0; Channel < 3; Channel++)
+	{
+		Linear[Channel] = Srgb ? Tables.SrgbToLinear[Texel[Channel]] : static_cast<float>(Texel[Channel]) / 255.0f;
+	}
+	Linear[3] = static_cast<float>(Texel[3]) / 255.0f;
+}
+
+static void EncodeTexel(const float Linear[4], bool Srgb, const MipTables& Tables, uint8_t* Texel)
+{
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		const float Clamped = std::min(std::max(Linear[Channel], 0.0f), 1.0f);
+		if (Srgb && Channel < 3)
+		{
+			Texel[Channel] = Tables.LinearToSrgb[std::lrint(Clamped * static_cast<float>(SrgbEncodeTableSize - 1))];
+		}
+		else
+		{
+			Texel[Channel] = static_cast<uint8_t>(std::lrint(Clamped * 255.0f));
+		}
+	}
+}
+
+// Source coordinates for every tap of one destination row or column, clamped to the edge
+static void GatherTapCoordinates(uint32_t DestinationCoordinate, uint32_t SourceSize, MipFilter Filter, uint32_t* Coordinates, uint32_t& TapCount)
+{
+	const int32_t First = Filter == MipFilter::Box ? 2 * static_cast<int32_t>(DestinationCoordinate) : 2 * static_cast<int32_t>(DestinationCoordinate) - 2;
+	TapCount = Filter == MipFilter::Box ? 2 : KaiserTapCount;
+	for (uint32_t Tap = 0; Tap < TapCount; Tap++)
+	{
+		Coordinates[Tap] = static_cast<uint32_t>(std::min(std::max(First + static_cast<int32_t>(Tap), 0), static_cast<int32_t>(SourceSize) - 1));
+	}
+}
+
+static void GetTapWeights(MipFilter Filter, const MipTables& Tables, const float*& Weights)
+{
+	static const float BoxWeights[2] = { 0.5f, 0.5f };
+	Weights = Filter == MipFilter::Box ? BoxWeights : Tables.KaiserWeights;
+}
+
+static void FilterRowScalar(const uint8_t* Source, const TextureLevelLayout& SourceLayout, uint8_t* DestinationRow, uint32_t DestinationWidth, const uint32_t* Rows, uint32_t TapCount, const MipGenerationOptions& Options, const MipTables& Tables)
+{
+	const float* Weights;
+	GetTapWeights(Options.Filter, Tables, Weights);
+
+	for (uint32_t X = 0; X < DestinationWidth; X++)
+	{
+		uint32_t Columns[KaiserTapCount];
+		uint32_t ColumnCount;
+		GatherTapCoordinates(X, SourceLayout.Width, Options.Filter, Columns, ColumnCount);
+
+		float Sum[4] = {};
+		for (uint32_t RowTap = 0; RowTap < TapCount; RowTap++)
+		{
+			const uint8_t* SourceRow = Source + static_cast<size_t>(Rows[RowTap]) * SourceLayout.RowPitch;
+			for (uint32_t ColumnTap = 0; ColumnTap < ColumnCount; ColumnTap++)
+			{
+				const float Weight = Weights[RowTap] * Weights[ColumnTap];
+				float Linear[4];
+				DecodeTexel(SourceRow + 4 * Columns[ColumnTap], Options.Srgb, Tables, Linear);
+				for (uint32_t Channel = 0; Channel < 4; Channel++)
+				{
+					Sum[Channel] += Weight * Linear[Channel];
+				}
+			}
+		}
+		EncodeTexel(Sum, Options.Srgb, Tables, DestinationRow + 4 * X);
+	}
+}
+
+// Exact integer 2x2 average for linear data, the common case for non-color textures
+static void BoxRowIntegerScalar(const uint8_t* Row0, const uint8_t* Row1, uint8_t* DestinationRow, uint32_t Begin, uint32_t End, uint32_t SourceWidth)
+{
+	for (uint32_t X = Begin; X < End; X++)
+	{
+		const uint32_t Column0 = std::min(2 * X, SourceWidth - 1);
+		const uint32_t Column1 = std::min(2 * X + 1, SourceWidth - 1);
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			const uint32_t Sum = Row0[4 * Column0 + Channel] + Row0[4 * Column1 + Channel] + Row1[4 * Column0 + Channel] + Row1[4 * Column1 + Channel];
+			DestinationRow[4 * X + Channel] = static_cast<uint8_t>((Sum + 2) >> 2);
+		}
+	}
+}
+
+#if CPU_FEATURES_X86
+static __m128 DecodeTexelSse2(const uint8_t* Texel, bool Srgb, const MipTables& Tables)
+{
+	if (Srgb)
+	{
+		return _mm_set_ps(static_cast<float>(Texel[3]) / 255.0f, Tables.SrgbToLinear[Texel[2]], Tables.SrgbToLinear[Texel[1]], Tables.SrgbToLinear[Texel[0]]);
+	}
+
+	uint32_t Packed;
+	memcpy(&Packed, Texel, sizeof(Packed));
+	const __m128i Bytes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(Packed)), _mm_setzero_si128()), _mm_setzero_si128());
+	return _mm_div_ps(_mm_cvtepi32_ps(Bytes), _mm_set1_ps(255.0f));
+}
+
+static void FilterRowSse2(const uint8_t* Source, const TextureLevelLayout& SourceLayout, uint8_t* DestinationRow, uint32_t DestinationWidth, const uint32_t* Rows, uint32_t TapCount, const MipGenerationOptions& Options, const MipTables& Tables)
+{
+	const float* Weights;
+	GetTapWeights(Options.Filter, Tables, Weights);
+
+	for (uint32_t X = 0; X < DestinationWidth; X++)
+	{
+		uint32_t Columns[KaiserTapCount];
+		uint32_t ColumnCount;
+		GatherTapCoordinates(X, SourceLayout.Width, Options.Filter, Columns, ColumnCount);
+
+		// One register per texel holds all four channels, accumulated in the same order as the scalar path
+		__m128 Sum = _mm_setzero_ps();
+		for (uint32_t RowTap = 0; RowTap < TapCount; RowTap++)
+		{
+			const uint8_t* SourceRow = Source + static_cast<size_t>(Rows[RowTap]) * SourceLayout.RowPitch;
+			for (uint32_t ColumnTap = 0; ColumnTap < ColumnCount; ColumnTap++)
+			{
+				const __m128 Weight = _mm_set1_ps(Weights[RowTap] * Weights[ColumnTap]);
+				Sum = _mm_add_ps(Sum, _mm_mul_ps(Weight, DecodeTexelSse2(SourceRow + 4 * Columns[ColumnTap], Options.Srgb, Tables)));
+			}
+		}
+
+		float Linear[4];
+		_mm_storeu_ps(Linear, Sum);
+		EncodeTexel(Linear, Options.Srgb, Tables, DestinationRow + 4 * X);
+	}
+}
+
+static void BoxRowIntegerSse2(const uint8_t* Row0, const uint8_t* Row1, uint8_t* DestinationRow, uint32_t DestinationWidth, uint32_t SourceWidth)
+{
+	// Four destination texels per iteration while both source texels of every pair are in bounds
+	const uint32_t VectorEnd = std::min(DestinationWidth, SourceWidth / 2) & ~3u;
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Rounding = _mm_set1_epi16(2);
+
+	for (uint32_t X = 0; X < VectorEnd; X += 4)
+	{
+		const __m128i Top0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + 8 * X));
+		const __m128i Top1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + 8 * X + 16));
+		const __m128i Bottom0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + 8 * X));
+		const __m128i Bottom1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + 8 * X + 16));
+
+		// Vertical sums of source texels 0-1, 2-3, 4-5 and 6-7 as 16 bit channels
+		const __m128i Sum01 = _mm_add_epi16(_mm_unpacklo_epi8(Top0, Zero), _mm_unpacklo_epi8(Bottom0, Zero));
+		const __m128i Sum23 = _mm_add_epi16(_mm_unpackhi_epi8(Top0, Zero), _mm_unpackhi_epi8(Bottom0, Zero));
+		const __m128i Sum45 = _mm_add_epi16(_mm_unpacklo_epi8(Top1, Zero), _mm_unpacklo_epi8(Bottom1, Zero));
+		const __m128i Sum67 = _mm_add_epi16(_mm_unpackhi_epi8(Top1, Zero), _mm_unpackhi_epi8(Bottom1, Zero));
+
+		// Pair even texels with odd texels to finish the 2x2 sums
+		const __m128i Pixels01 = _mm_add_epi16(_mm_unpacklo_epi64(Sum01, Sum23), _mm_unpackhi_epi64(Sum01, Sum23));
+		const __m128i Pixels23 = _mm_add_epi16(_mm_unpacklo_epi64(Sum45, Sum67), _mm_unpackhi_epi64(Sum45, Sum67));
+
+		const __m128i Averages01 = _mm_srli_epi16(_mm_add_epi16(Pixels01, Rounding), 2);
+		const __m128i Averages23 = _mm_srli_epi16(_mm_add_epi16(Pixels23, Rounding), 2);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(DestinationRow + 4 * X), _mm_packus_epi16(Averages01, Averages23));
+	}
+
+	BoxRowIntegerScalar(Row0, Row1, DestinationRow, VectorEnd, DestinationWidth, SourceWidth);
+}
+
+CPU_TARGET_AVX2 static void BoxRowIntegerAvx2(const uint8_t* Row0, const uint8_t* Row1, uint8_t* DestinationRow, uint32_t DestinationWidth, uint32_t SourceWidth)
+{
+	const uint32_t VectorEnd = std::min(DestinationWidth, SourceWidth / 2) & ~7u;
+	const __m256i Zero = _mm256_setzero_si256();
+	const __m256i Rounding = _mm256_set1_epi16(2);
+
+	for (uint32_t X = 0; X < VectorEnd; X += 8)
+	{
+		const __m256i Top0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row0 + 8 * X));
+		const __m256i Top1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row0 + 8 * X + 32));
+		const __m256i Bottom0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row1 + 8 * X));
+		const __m256i Bottom1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row1 + 8 * X + 32));
+
+		// Same steps as the SSE2 kernel, run independently in each 128 bit lane
+		const __m256i SumA = _mm256_add_epi16(_mm256_unpacklo_epi8(Top0, Zero), _mm256_unpacklo_epi8(Bottom0, Zero));
+		const __m256i SumB = _mm256_add_epi16(_mm256_unpackhi_epi8(Top0, Zero), _mm256_unpackhi_epi8(Bottom0, Zero));
+		const __m256i SumC = _mm256_add_epi16(_mm256_unpacklo_epi8(Top1, Zero), _mm256_unpacklo_epi8(Bottom1, Zero));
+		const __m256i SumD = _mm256_add_epi16(_mm256_unpackhi_epi8(Top1, Zero), _mm256_unpackhi_epi8(Bottom1, Zero));
+
+		const __m256i PixelsAB = _mm256_add_epi16(_mm256_unpacklo_epi64(SumA, SumB), _mm256_unpackhi_epi64(SumA, SumB));
+		const __m256i PixelsCD = _mm256_add_epi16(_mm256_unpacklo_epi64(SumC, SumD), _mm256_unpackhi_epi64(SumC, SumD));
+
+		const __m256i AveragesAB = _mm256_srli_epi16(_mm256_add_epi16(PixelsAB, Rounding), 2);
+		const __m256i AveragesCD = _mm256_srli_epi16(_mm256_add_epi16(PixelsCD, Rounding), 2);
+
+		// Lanes hold destination texels {0,1,4,5} {2,3,6,7}, restore the order after packing
+		const __m256i Packed = _mm256_packus_epi16(AveragesAB, AveragesCD);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(DestinationRow + 4 * X), _mm256_permute4x64_epi64(Packed, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	BoxRowIntegerScalar(Row0, Row1, DestinationRow, VectorEnd, DestinationWidth, SourceWidth);
+}
+#endif
+
+uint32_t GetFullMipLevelCount(uint32_t Width, uint32_t Height)
+{
+	uint32_t LevelCount = 1;
+	for (uint32_t Size = std::max(Width, Height); Size > 1; Size /= 2)
+	{
+		LevelCount++;
+	}
+	return LevelCount;
+}
+
+void GenerateMipRows(const uint8_t* Source, const TextureLevelLayout& SourceLayout, uint8_t* Destination, const TextureLevelLayout& DestinationLayout, const MipGenerationOptions& Options, uint32_t BeginRow, uint32_t EndRow)
+{
+	const MipTables& Tables = GetMipTables();
+	const InstructionSet Instructions = ResolveInstructionSet(Options.MaximumInstructionSet);
+	const bool IntegerBox = Options.Filter == MipFilter::Box && !Options.Srgb;
+
+	for (uint32_t Y = BeginRow; Y < EndRow; Y++)
+	{
+		uint8_t* DestinationRow = Destination + static_cast<size_t>(Y) * DestinationLayout.RowPitch;
+
+		uint32_t Rows[KaiserTapCount];
+		uint32_t RowCount;
+		GatherTapCoordinates(Y, SourceLayout.Height, Options.Filter, Rows, RowCount);
+
+		if (IntegerBox)
+		{
+			const uint8_t* Row0 = Source + static_cast<size_t>(Rows[0]) * SourceLayout.RowPitch;
+			const uint8_t* Row1 = Source + static_cast<size_t>(Rows[1]) * SourceLayout.RowPitch;
+#if CPU_FEATURES_X86
+			if (Instructions == InstructionSet::Avx2)
+			{
+				BoxRowIntegerAvx2(Row0, Row1, DestinationRow, DestinationLayout.Width, SourceLayout.Width);
+				continue;
+			}
+			if (Instructions != InstructionSet::Scalar)
+			{
+				BoxRowIntegerSse2(Row0, Row1, DestinationRow, DestinationLayout.Width, SourceLayout.Width);
+				continue;
+			}
+#endif
+			BoxRowIntegerScalar(Row0, Row1, DestinationRow, 0, DestinationLayout.Width, SourceLayout.Width);
+			continue;
+		}
+
+#if CPU_FEATURES_X86
+		if (Instructions != InstructionSet::Scalar)
+		{
+			FilterRowSse2(Source, SourceLayout, DestinationRow, DestinationLayout.Width, Rows, RowCount, Options, Tables);
+			continue;
+		}
+#endif
+		FilterRowScalar(Source, SourceLayout, DestinationRow, DestinationLayout.Width, Rows, RowCount, Options, Tables);
+	}
+}
+
+void GenerateMipChain(uint8_t* Pixels, const TextureLevelLayout* Levels, uint32_t LevelCount, const MipGenerationOptions& Options, JobSystem* Jobs)
+{
+	// Small levels finish faster than the jobs needed to split them
+	const uint32_t MinimumRowsPerJob = 16;
+
+	for (uint32_t Level = 1; Level < LevelCount; Level++)
+	{
+		const TextureLevelLayout& SourceLayout = Levels[Level - 1];
+		const TextureLevelLayout& DestinationLayout = Levels[Level];
+		const uint8_t* Source = Pixels + SourceLayout.Offset;
+		uint8_t* Destination = Pixels + DestinationLayout.Offset;
+
+		if (Jobs == nullptr || DestinationLayout.Height < 2 * MinimumRowsPerJob)
+		{
+			GenerateMipRows(Source, SourceLayout, Destination, DestinationLayout, Options, 0, DestinationLayout.Height);
+			continue;
+		}
+
+		const uint32_t Grain = std::max(DestinationLayout.Height / (4 * Jobs->GetThreadCount()), MinimumRowsPerJob);
+		Jobs->ParallelFor(0, DestinationLayout.Height, Grain, [&](uint32_t BeginRow, uint32_t EndRow)
+		{
+			GenerateMipRows(Source, SourceLayout, Destination, DestinationLayout, Options, BeginRow, EndRow);
+		});
+	}
+}
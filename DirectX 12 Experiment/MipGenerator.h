@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include <cstdint>
+
+class JobSystem;
+
+// Enough levels for a 16384 texel edge, the largest 2D texture D3D12 allows
+static const uint32_t MaximumMipLevelCount = 15;
+
+// Placement of one RGBA8 mip level, with Offset relative to the start of level zero
+struct TextureLevelLayout
+{
+	uint64_t Offset = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t RowPitch = 0;
+};
+
+enum class MipFilter
+{
+	// 2x2 average
+	Box,
+	// 6x6 Kaiser-windowed sinc, sharper at the cost of slight ringing on hard edges
+	Kaiser
+};
+
+struct MipGenerationOptions
+{
+	MipFilter Filter = MipFilter::Box;
+
+	// Treat color channels as sRGB encoded and average them in linear light; alpha is always linear
+	bool Srgb = true;
+
+	InstructionSet MaximumInstructionSet = InstructionSet::Avx2;
+};
+
+uint32_t GetFullMipLevelCount(uint32_t Width, uint32_t Height);
+
+// Fills levels [1, LevelCount) from level zero, each level downsampled from the one above it.
+// Levels run in order; rows within a level are spread across the job system when one is given.
+void GenerateMipChain(uint8_t* Pixels, const TextureLevelLayout* Levels, uint32_t LevelCount, const MipGenerationOptions& Options, JobSystem* Jobs = nullptr);
+
+// Downsamples rows [BeginRow, EndRow) of Destination from a source level twice its size, edges clamped
+void GenerateMipRows(const uint8_t* Source, const TextureLevelLayout& SourceLayout, uint8_t* Destination, const TextureLevelLayout& DestinationLayout, const MipGenerationOptions& Options, uint32_t BeginRow, uint32_t EndRow);
@@ -0,0 +1,52 @@
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+
+ParallelCommandRecorder::ParallelCommandRecorder(RenderDevice& Device, JobSystem& Jobs, uint32_t NumberOfCommandLists) :
+	Jobs(Jobs)
+{
+	if (NumberOfCommandLists == 0)
+	{
+		NumberOfCommandLists = Jobs.GetThreadCount();
+	}
+
+	CommandLists.reserve(NumberOfCommandLists);
+	for (uint32_t ListIndex = 0; ListIndex < NumberOfCommandLists; ListIndex++)
+	{
+		CommandLists.push_back(Device.CreateCommandList());
+	}
+}
+
+void ParallelCommandRecorder::Record(uint32_t DrawCount, const RecordFunction& Function)
+{
+	JobCounter Counter;
+	RecordAsync(DrawCount, Function, Counter);
+	Jobs.Wait(Counter);
+}
+
+void ParallelCommandRecorder::RecordAsync(uint32_t DrawCount, const RecordFunction& Function, JobCounter& Counter)
+{
+	const uint32_t ListCount = std::max(std::min(static_cast<uint32_t>(CommandLists.size()), DrawCount), 1u);
+
+	RecordedCommandLists.clear();
+	for (uint32_t ListIndex = 0; ListIndex < ListCount; ListIndex++)
+	{
+		RecordedCommandLists.push_back(CommandLists[ListIndex].get());
+	}
+	RecordedDrawCount = DrawCount;
+
+	// Each list is its own job so the scheduler can steal whole ranges; lists never share an allocator
+	for (uint32_t ListIndex = 0; ListIndex < ListCount; ListIndex++)
+	{
+		Jobs.Schedule([this, &Function, ListIndex, ListCount]
+		{
+			const uint32_t BeginDraw = static_cast<uint32_t>(static_cast<uint64_t>(RecordedDrawCount) * ListIndex / ListCount);
+			const uint32_t EndDraw = static_cast<uint32_t>(static_cast<uint64_t>(RecordedDrawCount) * (ListIndex + 1) / ListCount);
+
+			RenderCommandList& CommandList = *RecordedCommandLists[ListIndex];
+			CommandList.Reset();
+			Function(CommandList, BeginDraw, EndDraw);
+			CommandList.Close();
+		}, &Counter);
+	}
+}
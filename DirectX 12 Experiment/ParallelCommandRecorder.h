@@ -0,0 +1,36 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "RenderDevice.h"
+#include <functional>
+#include <vector>
+
+class ParallelCommandRecorder
+{
+public:
+	using RecordFunction = std::function<void(RenderCommandList& CommandList, uint32_t BeginDraw, uint32_t EndDraw)>;
+
+	// One command list per job system thread unless NumberOfCommandLists says otherwise
+	ParallelCommandRecorder(RenderDevice& Device, JobSystem& Jobs, uint32_t NumberOfCommandLists = 0);
+
+	ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+	ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+	// Splits [0, DrawCount) into contiguous ranges, one per command list, and records them as jobs.
+	// Returns once every list is closed.
+	void Record(uint32_t DrawCount, const RecordFunction& Function);
+
+	// Schedules the same recording against Counter without waiting, so it can sit in a larger task graph.
+	// Function must outlive the counter.
+	void RecordAsync(uint32_t DrawCount, const RecordFunction& Function, JobCounter& Counter);
+
+	// Closed lists from the last Record call, in draw order, ready for a single ExecuteCommandLists
+	RenderCommandList* const* GetCommandLists() const { return RecordedCommandLists.data(); }
+	uint32_t GetCommandListCount() const { return static_cast<uint32_t>(RecordedCommandLists.size()); }
+
+private:
+	JobSystem& Jobs;
+	std::vector<std::unique_ptr<RenderCommandList>> CommandLists;
+	std::vector<RenderCommandList*> RecordedCommandLists;
+	uint32_t RecordedDrawCount = 0;
+};
@@ -0,0 +1,281 @@
+#include "ProceduralTexture.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+// Every pattern reduces to runs of one color or runs whose blend factor changes linearly, so only these
+// two kernels are vectorized. The blend is computed the same way on every path so the output is identical.
+using FillRunFunction = void (*)(uint32_t* Destination, uint32_t Count, uint32_t Color);
+using LerpRunFunction = void (*)(uint32_t* Destination, uint32_t Count, float T0, float DeltaT, const float Start[4], const float Difference[4]);
+
+struct ProceduralKernels
+{
+	FillRunFunction FillRun;
+	LerpRunFunction LerpRun;
+};
+
+static void FillRunScalar(uint32_t* Destination, uint32_t Count, uint32_t Color)
+{
+	std::fill(Destination, Destination + Count, Color);
+}
+
+static uint32_t LerpPixel(float T, const float Start[4], const float Difference[4])
+{
+	uint32_t Packed = 0;
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		const long Value = std::lrint(Start[Channel] + Difference[Channel] * T);
+		Packed |= static_cast<uint32_t>(std::min(std::max(Value, 0l), 255l)) << (8 * Channel);
+	}
+	return Packed;
+}
+
+static void LerpRunScalar(uint32_t* Destination, uint32_t Count, float T0, float DeltaT, const float Start[4], const float Difference[4])
+{
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		Destination[Index] = LerpPixel(T0 + DeltaT * static_cast<float>(Index), Start, Difference);
+	}
+}
+
+#if CPU_FEATURES_X86
+static void FillRunSse2(uint32_t* Destination, uint32_t Count, uint32_t Color)
+{
+	const __m128i Colors = _mm_set1_epi32(static_cast<int>(Color));
+	uint32_t Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + Index), Colors);
+	}
+	for (; Index < Count; Index++)
+	{
+		Destination[Index] = Color;
+	}
+}
+
+static void LerpRunSse2(uint32_t* Destination, uint32_t Count, float T0, float DeltaT, const float Start[4], const float Difference[4])
+{
+	const __m128 StartVector = _mm_loadu_ps(Start);
+	const __m128 DifferenceVector = _mm_loadu_ps(Difference);
+	const __m128 Steps = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	uint32_t Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const __m128 IndexVector = _mm_add_ps(_mm_set1_ps(static_cast<float>(Index)), Steps);
+		const __m128 T = _mm_add_ps(_mm_set1_ps(T0), _mm_mul_ps(_mm_set1_ps(DeltaT), IndexVector));
+
+		const __m128i Pixel0 = _mm_cvtps_epi32(_mm_add_ps(StartVector, _mm_mul_ps(DifferenceVector, _mm_shuffle_ps(T, T, _MM_SHUFFLE(0, 0, 0, 0)))));
+		const __m128i Pixel1 = _mm_cvtps_epi32(_mm_add_ps(StartVector, _mm_mul_ps(DifferenceVector, _mm_shuffle_ps(T, T, _MM_SHUFFLE(1, 1, 1, 1)))));
+		const __m128i Pixel2 = _mm_cvtps_epi32(_mm_add_ps(StartVector, _mm_mul_ps(DifferenceVector, _mm_shuffle_ps(T, T, _MM_SHUFFLE(2, 2, 2, 2)))));
+		const __m128i Pixel3 = _mm_cvtps_epi32(_mm_add_ps(StartVector, _mm_mul_ps(DifferenceVector, _mm_shuffle_ps(T, T, _MM_SHUFFLE(3, 3, 3, 3)))));
+
+		const __m128i Packed = _mm_packus_epi16(_mm_packs_epi32(Pixel0, Pixel1), _mm_packs_epi32(Pixel2, Pixel3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + Index), Packed);
+	}
+	for (; Index < Count; Index++)
+	{
+		Destination[Index] = LerpPixel(T0 + DeltaT * static_cast<float>(Index), Start, Difference);
+	}
+}
+
+CPU_TARGET_AVX2 static void FillRunAvx2(uint32_t* Destination, uint32_t Count, uint32_t Color)
+{
+	const __m256i Colors = _mm256_set1_epi32(static_cast<int>(Color));
+	uint32_t Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(Destination + Index), Colors);
+	}
+	for (; Index < Count; Index++)
+	{
+		Destination[Index] = Color;
+	}
+}
+
+CPU_TARGET_AVX2 static void LerpRunAvx2(uint32_t* Destination, uint32_t Count, float T0, float DeltaT, const float Start[4], const float Difference[4])
+{
+	const __m256 StartVector = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(Start));
+	const __m256 DifferenceVector = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(Difference));
+	const __m256 Steps = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+	// Each 256 bit register holds two pixels, one per lane, and the lane-wise packs leave them interleaved
+	const __m256i Pair01 = _mm256_set_epi32(1, 1, 1, 1, 0, 0, 0, 0);
+	const __m256i Pair23 = _mm256_set_epi32(3, 3, 3, 3, 2, 2, 2, 2);
+	const __m256i Pair45 = _mm256_set_epi32(5, 5, 5, 5, 4, 4, 4, 4);
+	const __m256i Pair67 = _mm256_set_epi32(7, 7, 7, 7, 6, 6, 6, 6);
+	const __m256i Reorder = _mm256_set_epi32(7, 3, 6, 2, 5, 1, 4, 0);
+
+	uint32_t Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		const __m256 IndexVector = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(Index)), Steps);
+		const __m256 T = _mm256_add_ps(_mm256_set1_ps(T0), _mm256_mul_ps(_mm256_set1_ps(DeltaT), IndexVector));
+
+		const __m256i Pixels01 = _mm256_cvtps_epi32(_mm256_add_ps(StartVector, _mm256_mul_ps(DifferenceVector, _mm256_permutevar8x32_ps(T, Pair01))));
+		const __m256i Pixels23 = _mm256_cvtps_epi32(_mm256_add_ps(StartVector, _mm256_mul_ps(DifferenceVector, _mm256_permutevar8x32_ps(T, Pair23))));
+		const __m256i Pixels45 = _mm256_cvtps_epi32(_mm256_add_ps(StartVector, _mm256_mul_ps(DifferenceVector, _mm256_permutevar8x32_ps(T, Pair45))));
+		const __m256i Pixels67 = _mm256_cvtps_epi32(_mm256_add_ps(StartVector, _mm256_mul_ps(DifferenceVector, _mm256_permutevar8x32_ps(T, Pair67))));
+
+		const __m256i Packed = _mm256_packus_epi16(_mm256_packs_epi32(Pixels01, Pixels23), _mm256_packs_epi32(Pixels45, Pixels67));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(Destination + Index), _mm256_permutevar8x32_epi32(Packed, Reorder));
+	}
+	for (; Index < Count; Index++)
+	{
+		Destination[Index] = LerpPixel(T0 + DeltaT * static_cast<float>(Index), Start, Difference);
+	}
+}
+#endif
+
+static ProceduralKernels SelectKernels(InstructionSet MaximumInstructionSet)
+{
+#if CPU_FEATURES_X86
+	switch (ResolveInstructionSet(MaximumInstructionSet))
+	{
+	case InstructionSet::Avx2: return { FillRunAvx2, LerpRunAvx2 };
+	case InstructionSet::Sse41:
+	case InstructionSet::Sse2: return { FillRunSse2, LerpRunSse2 };
+	default: break;
+	}
+#endif
+	return { FillRunScalar, LerpRunScalar };
+}
+
+static uint32_t PackColor(const uint8_t Color[4])
+{
+	return Color[0] | (Color[1] << 8) | (Color[2] << 16) | (static_cast<uint32_t>(Color[3]) << 24);
+}
+
+// Integer hash built from shifts and adds only, mapped to [0, 1]
+static float LatticeValue(uint32_t X, uint32_t Y, uint32_t Seed)
+{
+	uint32_t Key = X * 0x8DA6B343u ^ Y * 0xD8163841u ^ Seed * 0xCB1AB31Fu;
+	Key = ~Key + (Key << 15);
+	Key ^= Key >> 12;
+	Key += Key << 2;
+	Key ^= Key >> 4;
+	Key += (Key << 3) + (Key << 11);
+	Key ^= Key >> 16;
+	return static_cast<float>(Key & 0xFFFF) / 65535.0f;
+}
+
+static void GenerateCheckerRow(const ProceduralTextureDescription& Description, const ProceduralKernels& Kernels, uint32_t* Row, uint32_t Y, uint32_t CellSize)
+{
+	const uint32_t Colors[2] = { PackColor(Description.ColorA), PackColor(Description.ColorB) };
+	const uint32_t RowParity = (Y / CellSize) & 1;
+
+	for (uint32_t X = 0, Cell = 0; X < Description.Width; X += CellSize, Cell++)
+	{
+		Kernels.FillRun(Row + X, std::min(CellSize, Description.Width - X), Colors[(Cell & 1) ^ RowParity]);
+	}
+}
+
+static void GenerateTilesRow(const ProceduralTextureDescription& Description, const ProceduralKernels& Kernels, uint32_t* Row, uint32_t Y, uint32_t CellSize)
+{
+	const uint32_t Face = PackColor(Description.ColorA);
+	const uint32_t Mortar = PackColor(Description.ColorB);
+	const uint32_t MortarSize = std::min(Description.MortarSize, CellSize);
+
+	if (Y % CellSize < MortarSize)
+	{
+		Kernels.FillRun(Row, Description.Width, Mortar);
+		return;
+	}
+
+	// Running bond: every other course of tiles is shifted by half a tile
+	const uint32_t TileWidth = 2 * CellSize;
+	const uint32_t Offset = ((Y / CellSize) & 1) != 0 ? CellSize : 0;
+	for (uint32_t X = 0; X < Description.Width;)
+	{
+		const uint32_t Local = (X + Offset) % TileWidth;
+		const bool InMortar = Local < MortarSize;
+		const uint32_t RunLength = std::min((InMortar ? MortarSize : TileWidth) - Local, Description.Width - X);
+		Kernels.FillRun(Row + X, RunLength, InMortar ? Mortar : Face);
+		X += RunLength;
+	}
+}
+
+void GenerateProceduralRows(const ProceduralTextureDescription& Description, uint8_t* Pixels, uint32_t RowPitch, uint32_t BeginRow, uint32_t EndRow)
+{
+	const ProceduralKernels Kernels = SelectKernels(Description.MaximumInstructionSet);
+	const uint32_t CellSize = std::max(Description.CellSize, 1u);
+
+	float Start[4], Difference[4];
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Start[Channel] = static_cast<float>(Description.ColorA[Channel]);
+		Difference[Channel] = static_cast<float>(Description.ColorB[Channel]) - Start[Channel];
+	}
+
+	const uint32_t LatticeWidth = (Description.Width + CellSize - 1) / CellSize;
+	const uint32_t LatticeHeight = (Description.Height + CellSize - 1) / CellSize;
+	std::vector<float> RowLattice;
+	if (Description.Pattern == ProceduralPattern::Noise)
+	{
+		RowLattice.resize(LatticeWidth + 1);
+	}
+
+	for (uint32_t Y = BeginRow; Y < EndRow; Y++)
+	{
+		uint32_t* Row = reinterpret_cast<uint32_t*>(Pixels + static_cast<size_t>(Y) * RowPitch);
+		switch (Description.Pattern)
+		{
+		case ProceduralPattern::Checker:
+			GenerateCheckerRow(Description, Kernels, Row, Y, CellSize);
+			break;
+
+		case ProceduralPattern::Tiles:
+			GenerateTilesRow(Description, Kernels, Row, Y, CellSize);
+			break;
+
+		case ProceduralPattern::Gradient:
+		{
+			// Diagonal blend from the top left to the bottom right texel
+			const float InverseSpan = 1.0f / static_cast<float>(std::max(Description.Width + Description.Height, 3u) - 2);
+			Kernels.LerpRun(Row, Description.Width, static_cast<float>(Y) * InverseSpan, InverseSpan, Start, Difference);
+			break;
+		}
+
+		case ProceduralPattern::Noise:
+		{
+			// Blend the two lattice rows around Y once, then every cell span is a linear run
+			const uint32_t LatticeY = Y / CellSize;
+			const float FractionY = static_cast<float>(Y % CellSize) / static_cast<float>(CellSize);
+			for (uint32_t LatticeX = 0; LatticeX <= LatticeWidth; LatticeX++)
+			{
+				const float Top = LatticeValue(LatticeX % LatticeWidth, LatticeY % LatticeHeight, Description.Seed);
+				const float Bottom = LatticeValue(LatticeX % LatticeWidth, (LatticeY + 1) % LatticeHeight, Description.Seed);
+				RowLattice[LatticeX] = Top + (Bottom - Top) * FractionY;
+			}
+
+			for (uint32_t LatticeX = 0; LatticeX < LatticeWidth; LatticeX++)
+			{
+				const uint32_t X = LatticeX * CellSize;
+				const float Slope = (RowLattice[LatticeX + 1] - RowLattice[LatticeX]) / static_cast<float>(CellSize);
+				Kernels.LerpRun(Row + X, std::min(CellSize, Description.Width - X), RowLattice[LatticeX], Slope, Start, Difference);
+			}
+			break;
+		}
+		}
+	}
+}
+
+void GenerateProceduralTexture(const ProceduralTextureDescription& Description, uint8_t* Pixels, uint32_t RowPitch, JobSystem* Jobs)
+{
+	if (Jobs == nullptr)
+	{
+		GenerateProceduralRows(Description, Pixels, RowPitch, 0, Description.Height);
+		return;
+	}
+
+	Jobs->ParallelFor(0, Description.Height, 0, [&](uint32_t BeginRow, uint32_t EndRow)
+	{
+		GenerateProceduralRows(Description, Pixels, RowPitch, BeginRow, EndRow);
+	});
+}
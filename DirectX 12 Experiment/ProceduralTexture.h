@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include <cstdint>
+
+class JobSystem;
+
+enum class ProceduralPattern
+{
+	Checker,
+	Gradient,
+	Noise,
+	Tiles
+};
+
+struct ProceduralTextureDescription
+{
+	ProceduralPattern Pattern = ProceduralPattern::Checker;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+
+	// Checker square size, noise lattice spacing and tile height in texels; tiles are twice as wide
+	uint32_t CellSize = 32;
+	uint32_t MortarSize = 2;
+	uint32_t Seed = 0;
+
+	// RGBA8, the checker and tile faces use ColorA, gradients and noise blend from ColorA to ColorB
+	uint8_t ColorA[4] = { 255, 255, 255, 255 };
+	uint8_t ColorB[4] = { 0, 0, 0, 255 };
+
+	InstructionSet MaximumInstructionSet = InstructionSet::Avx2;
+};
+
+// Writes rows [BeginRow, EndRow) of an RGBA8 image whose rows start RowPitch bytes apart.
+// Rows must be four byte aligned, which every D3D12 upload footprint is. Noise tiles seamlessly
+// when both dimensions are multiples of CellSize.
+void GenerateProceduralRows(const ProceduralTextureDescription& Description, uint8_t* Pixels, uint32_t RowPitch, uint32_t BeginRow, uint32_t EndRow);
+
+// Whole image, with rows spread across the job system when one is given
+void GenerateProceduralTexture(const ProceduralTextureDescription& Description, uint8_t* Pixels, uint32_t RowPitch, JobSystem* Jobs = nullptr);
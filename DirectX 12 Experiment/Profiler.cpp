@@ -0,0 +1,253 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// The thread's buffer in the profiler it last recorded into; identifiers are never reused, so a binding to a
+// destroyed profiler can never match again
+struct ProfilerThreadBinding
+{
+	uint64_t ProfilerId = 0;
+	void* Buffer = nullptr;
+};
+
+static thread_local ProfilerThreadBinding ThreadBinding;
+static thread_local uint32_t ScopeDepth = 0;
+static std::atomic<uint64_t> NextProfilerId{ 1 };
+
+static void WriteJsonString(std::ostream& Stream, const char* Text)
+{
+	Stream << '"';
+	for (const char* Character = Text; *Character != '\0'; Character++)
+	{
+		const unsigned char Code = static_cast<unsigned char>(*Character);
+		if (Code == '"' || Code == '\\')
+		{
+			Stream << '\\' << *Character;
+		}
+		else if (Code < 0x20)
+		{
+			char Escaped[8];
+			snprintf(Escaped, sizeof(Escaped), "\\u%04x", Code);
+			Stream << Escaped;
+		}
+		else
+		{
+			Stream << *Character;
+		}
+	}
+	Stream << '"';
+}
+
+Profiler::Profiler(uint32_t ThreadEventCapacity, uint32_t FrameWindow) :
+	Id(NextProfilerId.fetch_add(1, std::memory_order_relaxed)),
+	ThreadEventCapacity(ThreadEventCapacity),
+	StartTime(Now()),
+	LastFrameEnd(StartTime)
+{
+	CpuFrameTimes.Samples.resize(std::max(FrameWindow, 1u));
+	GpuFrameTimes.Samples.resize(std::max(FrameWindow, 1u));
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::RecordCpuEvent(const char* Name, uint64_t Begin, uint64_t End, uint32_t Depth)
+{
+	ThreadBuffer& Buffer = GetThreadBuffer();
+	const ProfileEvent Event = { Name, Begin, End, Depth };
+	if (!Buffer.Events.TryPush(Event))
+	{
+		Buffer.DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Profiler::SetThreadName(const char* Name)
+{
+	ThreadBuffer& Buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+	Buffer.Name = Name;
+}
+
+void Profiler::RecordGpuEvent(const char* Name, uint64_t Begin, uint64_t End)
+{
+	const ProfileEvent Event = { Name, Begin, End, 0 };
+	Capture(Event, GpuTrack);
+}
+
+void Profiler::RecordGpuFrame(uint64_t Begin, uint64_t End)
+{
+	GpuFrameTimes.Add(static_cast<double>(End - Begin) / 1e6);
+}
+
+void Profiler::EndFrame()
+{
+	const uint64_t FrameEnd = Now();
+	{
+		std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+		for (const std::unique_ptr<ThreadBuffer>& Buffer : ThreadBuffers)
+		{
+			ProfileEvent Event;
+			while (Buffer->Events.TryPop(Event))
+			{
+				Capture(Event, Buffer->ThreadIndex);
+			}
+		}
+	}
+
+	CpuFrameTimes.Add(static_cast<double>(FrameEnd - LastFrameEnd) / 1e6);
+	LastFrameEnd = FrameEnd;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& Stream) const
+{
+	Stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	Stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	Stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+	Stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"Direct queue\"}}";
+	{
+		std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+		for (const std::unique_ptr<ThreadBuffer>& Buffer : ThreadBuffers)
+		{
+			const std::string Name = Buffer->Name.empty() ? "Thread " + std::to_string(Buffer->ThreadIndex) : Buffer->Name;
+			Stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << Buffer->ThreadIndex << ",\"args\":{\"name\":";
+			WriteJsonString(Stream, Name.c_str());
+			Stream << "}}";
+		}
+	}
+
+	// Complete events in microseconds since the profiler was created
+	for (const CapturedEvent& Captured : CapturedEvents)
+	{
+		const ProfileEvent& Event = Captured.Event;
+		const double Timestamp = static_cast<double>(static_cast<int64_t>(Event.Begin - StartTime)) / 1000.0;
+		const double Duration = static_cast<double>(Event.End - Event.Begin) / 1000.0;
+		char Times[96];
+		snprintf(Times, sizeof(Times), ",\"ts\":%.3f,\"dur\":%.3f}", Timestamp, Duration);
+
+		Stream << ",\n{\"name\":";
+		WriteJsonString(Stream, Event.Name);
+		if (Captured.Track == GpuTrack)
+		{
+			Stream << ",\"ph\":\"X\",\"pid\":2,\"tid\":0" << Times;
+		}
+		else
+		{
+			Stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << Captured.Track << Times;
+		}
+	}
+	Stream << "\n]}\n";
+}
+
+double Profiler::GetCpuFrameTimePercentile(double Percentile) const
+{
+	return CpuFrameTimes.GetPercentile(Percentile);
+}
+
+double Profiler::GetGpuFrameTimePercentile(double Percentile) const
+{
+	return GpuFrameTimes.GetPercentile(Percentile);
+}
+
+double Profiler::GetLastGpuFrameTime() const
+{
+	if (GpuFrameTimes.Count == 0) return 0.0;
+	return GpuFrameTimes.Samples[(GpuFrameTimes.Next + GpuFrameTimes.Samples.size() - 1) % GpuFrameTimes.Samples.size()];
+}
+
+uint64_t Profiler::GetDroppedEventCount() const
+{
+	uint64_t Dropped = DroppedCaptureEvents;
+	std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+	for (const std::unique_ptr<ThreadBuffer>& Buffer : ThreadBuffers)
+	{
+		Dropped += Buffer->DroppedEvents.load(std::memory_order_relaxed);
+	}
+	return Dropped;
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+	if (ThreadBinding.ProfilerId == Id) return *static_cast<ThreadBuffer*>(ThreadBinding.Buffer);
+
+	// A thread alternating between profilers finds its buffer again instead of registering a new one
+	const std::thread::id ThreadId = std::this_thread::get_id();
+	std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+	ThreadBuffer* Buffer = nullptr;
+	for (const std::unique_ptr<ThreadBuffer>& Existing : ThreadBuffers)
+	{
+		if (Existing->ThreadId == ThreadId)
+		{
+			Buffer = Existing.get();
+			break;
+		}
+	}
+	if (Buffer == nullptr)
+	{
+		ThreadBuffers.push_back(std::make_unique<ThreadBuffer>(ThreadEventCapacity));
+		Buffer = ThreadBuffers.back().get();
+		Buffer->ThreadId = ThreadId;
+		Buffer->ThreadIndex = static_cast<uint32_t>(ThreadBuffers.size());
+	}
+
+	ThreadBinding.ProfilerId = Id;
+	ThreadBinding.Buffer = Buffer;
+	return *Buffer;
+}
+
+void Profiler::Capture(const ProfileEvent& Event, uint32_t Track)
+{
+	if (!Capturing) return;
+	if (CapturedEvents.size() >= MaximumCapturedEvents)
+	{
+		DroppedCaptureEvents++;
+		return;
+	}
+
+	CapturedEvent Captured;
+	Captured.Event = Event;
+	Captured.Track = Track;
+	CapturedEvents.push_back(Captured);
+}
+
+void Profiler::FrameTimeWindow::Add(double Milliseconds)
+{
+	Samples[Next] = Milliseconds;
+	Next = (Next + 1) % Samples.size();
+	Count = std::min(Count + 1, Samples.size());
+	Total++;
+}
+
+double Profiler::FrameTimeWindow::GetPercentile(double Percentile) const
+{
+	if (Count == 0) return 0.0;
+
+	std::vector<double> Sorted(Samples.begin(), Samples.begin() + Count);
+	const double Rank = std::ceil(std::min(std::max(Percentile, 0.0), 100.0) / 100.0 * static_cast<double>(Count));
+	const size_t Index = static_cast<size_t>(std::max(Rank, 1.0)) - 1;
+	std::nth_element(Sorted.begin(), Sorted.begin() + Index, Sorted.end());
+	return Sorted[Index];
+}
+
+ProfileScope::ProfileScope(Profiler* Owner, const char* Name) :
+	Owner(Owner),
+	Name(Name),
+	Begin(0)
+{
+	if (Owner == nullptr) return;
+
+	Begin = Profiler::Now();
+	ScopeDepth++;
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (Owner == nullptr) return;
+
+	ScopeDepth--;
+	Owner->RecordCpuEvent(Name, Begin, Profiler::Now(), ScopeDepth);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "SingleProducerSingleConsumerQueue.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Times are nanoseconds on the steady clock, which GPU timestamps are calibrated against as well
+struct ProfileEvent
+{
+	const char* Name;
+	uint64_t Begin;
+	uint64_t End;
+	uint32_t Depth;
+};
+
+// Collects CPU scopes from any thread and GPU intervals from the backend, keeps rolling frame time percentiles and
+// exports captured events as Chrome trace JSON, which Perfetto loads as well. Recording a scope writes into a ring
+// owned by the calling thread; only the first scope a thread records takes a lock. EndFrame drains the rings.
+class Profiler
+{
+public:
+	// A thread records at most ThreadEventCapacity scopes between two EndFrame calls, further ones are dropped
+	explicit Profiler(uint32_t ThreadEventCapacity = 8192, uint32_t FrameWindow = 600);
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static uint64_t Now();
+
+	// Names must outlive the profiler, string literals in practice
+	void RecordCpuEvent(const char* Name, uint64_t Begin, uint64_t End, uint32_t Depth);
+	void SetThreadName(const char* Name);
+
+	// Only from the thread calling EndFrame, with the intervals already on the steady clock
+	void RecordGpuEvent(const char* Name, uint64_t Begin, uint64_t End);
+	void RecordGpuFrame(uint64_t Begin, uint64_t End);
+
+	// Called once per frame by the thread that owns the frame loop
+	void EndFrame();
+
+	// Events are only kept for export while capturing, up to MaximumCapturedEvents
+	void SetCapturing(bool Enabled) { Capturing = Enabled; }
+	void WriteChromeTrace(std::ostream& Stream) const;
+
+	// Nearest rank over the last FrameWindow frames in milliseconds, zero before the first frame
+	double GetCpuFrameTimePercentile(double Percentile) const;
+	double GetGpuFrameTimePercentile(double Percentile) const;
+	// GPU frames recorded so far and the newest one's time, for controllers that react to every frame
+	uint64_t GetGpuFrameCount() const { return GpuFrameTimes.Total; }
+	double GetLastGpuFrameTime() const;
+	uint64_t GetDroppedEventCount() const;
+	size_t GetCapturedEventCount() const { return CapturedEvents.size(); }
+
+	static const size_t MaximumCapturedEvents = 1 << 20;
+
+private:
+	struct ThreadBuffer
+	{
+		explicit ThreadBuffer(uint32_t Capacity) : Events(Capacity) {}
+
+		SingleProducerSingleConsumerQueue<ProfileEvent> Events;
+		std::thread::id ThreadId;
+		uint32_t ThreadIndex = 0;
+		std::string Name;
+		std::atomic<uint64_t> DroppedEvents{ 0 };
+	};
+
+	struct CapturedEvent
+	{
+		ProfileEvent Event;
+		// Index of the recording thread, or GpuTrack
+		uint32_t Track;
+	};
+
+	static const uint32_t GpuTrack = ~0u;
+
+	// Frame times in milliseconds, overwritten oldest first
+	struct FrameTimeWindow
+	{
+		std::vector<double> Samples;
+		size_t Next = 0;
+		size_t Count = 0;
+		uint64_t Total = 0;
+
+		void Add(double Milliseconds);
+		double GetPercentile(double Percentile) const;
+	};
+
+	const uint64_t Id;
+	const uint32_t ThreadEventCapacity;
+	const uint64_t StartTime;
+
+	// Guards the list of thread buffers, which the hot path never touches once its thread is registered
+	mutable std::mutex ThreadBuffersMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> ThreadBuffers;
+
+	bool Capturing = false;
+	std::vector<CapturedEvent> CapturedEvents;
+	uint64_t DroppedCaptureEvents = 0;
+
+	uint64_t LastFrameEnd;
+	FrameTimeWindow CpuFrameTimes;
+	FrameTimeWindow GpuFrameTimes;
+
+	ThreadBuffer& GetThreadBuffer();
+	void Capture(const ProfileEvent& Event, uint32_t Track);
+};
+
+// Times the enclosing block on the calling thread; a null profiler turns it into a no-op
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler* Owner, const char* Name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	Profiler* Owner;
+	const char* Name;
+	uint64_t Begin;
+};
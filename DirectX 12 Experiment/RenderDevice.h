@@ -0,0 +1,144 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "FramePacer.h"
+#include "InstanceBatcher.h"
+#include "MeshOptimizer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class JobSystem;
+class Profiler;
+
+// Positions are in clip space with y given for a square output; the device stretches y by the output's aspect
+// ratio, so the scene keeps its proportions whatever size the window is resized to
+struct Vertex
+{
+	float Position[3];
+	float UV[2];
+};
+
+// How vertices are stored once uploaded; Quantized packs them into a QuantizedVertex on upload
+enum class VertexFormat
+{
+	Float,
+	Quantized
+};
+
+struct RenderDeviceDescription
+{
+	void* WindowHandle = nullptr;
+	std::wstring PathToAssets;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t FrameCount = 2;
+	// Changeable between frames through SetFramePacing, FramesInFlight may not exceed FrameCount
+	FramePacingDescription Pacing;
+
+	// Optional workers for CPU-side texture processing such as mip generation
+	JobSystem* Jobs = nullptr;
+	MipFilter TextureMipFilter = MipFilter::Box;
+	VertexFormat GeometryFormat = VertexFormat::Quantized;
+
+	// Recompile shaders when their sources beside the executable change and swap the pipelines between frames
+	bool WatchShaders = false;
+
+	// Receives the device's CPU scopes and, where the backend supports it, GPU timestamps; null disables both
+	Profiler* Profiling = nullptr;
+};
+
+// Pixels handed to the device are always RGBA8; Format is how the device stores them, encoding on upload
+struct TextureDescription
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	TextureFormat Format = TextureFormat::Rgba8;
+};
+
+// CPU-visible staging memory reserved for one streamed texture, rows are RowPitch bytes apart.
+// Pixels and RowPitch describe level zero; the remaining levels are laid out relative to Pixels.
+// Format is the layout the device expects in staging, which may be RGBA8 even when compression was requested.
+struct TextureStreamStaging
+{
+	uint64_t StreamId = 0;
+	TextureFormat Format = TextureFormat::Rgba8;
+	uint8_t* Pixels = nullptr;
+	uint32_t RowPitch = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipLevelCount = 1;
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+};
+
+class RenderCommandList
+{
+public:
+	virtual ~RenderCommandList() = default;
+
+	virtual void Reset() = 0;
+	virtual void ClearRenderTarget(const float Color[4]) = 0;
+	// Indexed triangle lists from the geometry buffers. Vertices are transformed by the frame's uploaded instances
+	// starting at StartInstanceLocation, or left as they are when no instances were uploaded.
+	virtual void DrawIndexedInstanced(uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation, int32_t BaseVertexLocation, uint32_t StartInstanceLocation) = 0;
+	virtual void DrawInstancedBatches(const InstancedDrawArguments* Draws, uint32_t DrawCount) = 0;
+	// Issues draws straight from the frame's uploaded argument buffer, which a GPU culling pass could fill instead
+	virtual void ExecuteIndirect(uint32_t FirstDraw, uint32_t DrawCount) = 0;
+	virtual void Close() = 0;
+};
+
+class RenderDevice
+{
+public:
+	// Upper bound on frames in flight; the actual count comes from RenderDeviceDescription
+	static const uint32_t MaximumFrameCount = 4;
+
+	virtual ~RenderDevice() = default;
+
+	virtual void Initialize(const RenderDeviceDescription& Description) = 0;
+	virtual void Dispose() = 0;
+
+	// Uploads are recorded on an internal setup list and only guaranteed visible after FinishUploads.
+	// Textures get a full mip chain generated from the sRGB encoded Pixels. Geometry replaces the vertex and index
+	// buffers, storing indices as 16 bits whenever all of them fit.
+	virtual void CreateGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount) = 0;
+	virtual void CreateTexture(const TextureDescription& Description, const uint8_t* Pixels) = 0;
+	virtual void FinishUploads() = 0;
+
+	// Instance data and its draws as indirect arguments for the current frame, uploaded before the command lists
+	// that read them are recorded. Both stay valid until the frame is presented.
+	virtual void UploadInstances(const InstanceBatchBuffer& Batches) = 0;
+
+	// Streaming uploads run on a copy queue. Staging memory is reserved up front so it can be filled from any
+	// thread, returning false while the staging memory is exhausted. A submitted texture replaces the bound
+	// texture at the first frame boundary after GetCompletedStreamFenceValue reaches the returned value.
+	virtual bool TryBeginTextureStream(const TextureDescription& Description, TextureStreamStaging& Staging) = 0;
+	virtual uint64_t SubmitTextureStream(const TextureStreamStaging& Staging) = 0;
+	virtual void CancelTextureStream(const TextureStreamStaging& Staging) = 0;
+	virtual uint64_t GetCompletedStreamFenceValue() = 0;
+
+	virtual std::unique_ptr<RenderCommandList> CreateCommandList() = 0;
+	// Blocks until the next frame may start, called before the input for that frame is sampled
+	virtual void BeginFrame() = 0;
+	virtual void ExecuteCommandLists(RenderCommandList* const* CommandLists, uint32_t NumberOfCommandLists) = 0;
+	virtual void Present() = 0;
+	virtual void WaitForIdle() = 0;
+
+	// Called between frames with the window's new client size; zero sizes, as while minimized, are ignored.
+	// Only the frames still using the back buffers are waited for.
+	virtual void Resize(uint32_t Width, uint32_t Height) = 0;
+	// Fraction of the output size the scene is rendered at before it is upscaled, taking effect for command lists
+	// reset after the call; 1 renders straight into the back buffer
+	virtual void SetRenderScale(float Scale) = 0;
+
+	virtual uint32_t GetWidth() const = 0;
+	virtual uint32_t GetHeight() const = 0;
+	virtual uint32_t GetCurrentFrameIndex() const = 0;
+	virtual uint32_t GetFrameCount() const = 0;
+
+	virtual void SetFramePacing(const FramePacingDescription& Description) = 0;
+	virtual const FramePacingStatistics& GetFramePacingStatistics() const = 0;
+};
+
+std::unique_ptr<RenderDevice> CreateD3D12RenderDevice();
+std::unique_ptr<RenderDevice> CreateHeadlessRenderDevice();
@@ -0,0 +1,460 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+static const RenderGraphState WritableStates = RenderGraphState::RenderTarget | RenderGraphState::DepthWrite | RenderGraphState::UnorderedAccess | RenderGraphState::CopyDestination;
+static const uint32_t NoPosition = ~0u;
+
+static bool Contains(RenderGraphState State, RenderGraphState Flags)
+{
+	return (static_cast<uint32_t>(State) & static_cast<uint32_t>(Flags)) == static_cast<uint32_t>(Flags);
+}
+
+static bool IsReadOnly(RenderGraphState State)
+{
+	return State != RenderGraphState::Undefined && State != RenderGraphState::Present && (static_cast<uint32_t>(State) & static_cast<uint32_t>(WritableStates)) == 0;
+}
+
+static uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+{
+	return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+void RenderGraph::Reset()
+{
+	Resources.clear();
+	Passes.clear();
+	ExecutionOrder.clear();
+	Barriers.clear();
+	BarrierOffsets.clear();
+	Statistics = RenderGraphStatistics();
+	Compiled = false;
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportResource(const char* Name, RenderGraphState InitialState, RenderGraphState FinalState)
+{
+	if (InitialState == RenderGraphState::Undefined || FinalState == RenderGraphState::Undefined) throw std::runtime_error("Imported resources need a defined state");
+
+	Resource NewResource;
+	NewResource.Name = Name;
+	NewResource.IsTransient = false;
+	NewResource.InitialState = InitialState;
+	NewResource.FinalState = FinalState;
+	NewResource.Size = 0;
+	NewResource.Alignment = 1;
+	NewResource.Offset = 0;
+	Resources.push_back(NewResource);
+	Compiled = false;
+	return static_cast<ResourceHandle>(Resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateTransient(const char* Name, uint64_t Size, uint64_t Alignment)
+{
+	if (Size == 0) throw std::runtime_error("Transient resources need a size");
+	if (Alignment == 0 || (Alignment & (Alignment - 1)) != 0) throw std::runtime_error("Transient alignment must be a power of two");
+
+	Resource NewResource;
+	NewResource.Name = Name;
+	NewResource.IsTransient = true;
+	NewResource.InitialState = RenderGraphState::Undefined;
+	NewResource.FinalState = RenderGraphState::Undefined;
+	NewResource.Size = Size;
+	NewResource.Alignment = Alignment;
+	NewResource.Offset = 0;
+	Resources.push_back(NewResource);
+	Compiled = false;
+	return static_cast<ResourceHandle>(Resources.size() - 1);
+}
+
+RenderGraph::PassHandle RenderGraph::AddPass(const char* Name, std::function<void()> Execute, bool NeverCull)
+{
+	Pass NewPass;
+	NewPass.Name = Name;
+	NewPass.Execute = std::move(Execute);
+	NewPass.NeverCull = NeverCull;
+	Passes.push_back(std::move(NewPass));
+	Compiled = false;
+	return static_cast<PassHandle>(Passes.size() - 1);
+}
+
+void RenderGraph::Read(PassHandle Pass, ResourceHandle Resource, RenderGraphState State)
+{
+	if (!IsReadOnly(State)) throw std::runtime_error("Reads need a read-only state");
+	AddAccess(Pass, Resource, State, false);
+}
+
+void RenderGraph::Write(PassHandle Pass, ResourceHandle Resource, RenderGraphState State)
+{
+	if (State != RenderGraphState::RenderTarget && State != RenderGraphState::DepthWrite && State != RenderGraphState::UnorderedAccess && State != RenderGraphState::CopyDestination) throw std::runtime_error("Writes need exactly one writable state");
+	AddAccess(Pass, Resource, State, true);
+}
+
+void RenderGraph::AddAccess(PassHandle Pass, ResourceHandle Resource, RenderGraphState State, bool IsWrite)
+{
+	if (Pass >= Passes.size() || Resource >= Resources.size()) throw std::runtime_error("Unknown pass or resource");
+
+	for (Access& Existing : Passes[Pass].Accesses)
+	{
+		if (Existing.Resource != Resource) continue;
+		if (Existing.IsWrite || IsWrite)
+		{
+			if (Existing.IsWrite && IsWrite && Existing.State == State) return;
+			throw std::runtime_error("A pass may not access a resource it writes in another way");
+		}
+		Existing.State = Existing.State | State;
+		return;
+	}
+
+	Access NewAccess;
+	NewAccess.Resource = Resource;
+	NewAccess.State = State;
+	NewAccess.IsWrite = IsWrite;
+	Passes[Pass].Accesses.push_back(NewAccess);
+	Compiled = false;
+}
+
+void RenderGraph::Compile()
+{
+	const uint32_t PassCount = static_cast<uint32_t>(Passes.size());
+	Statistics = RenderGraphStatistics();
+
+	// Walking backwards, a pass survives if it writes something imported or read by a pass that survived.
+	// Writers are kept even when a later pass overwrites everything, since a pass cannot say it does.
+	std::vector<bool> Alive(PassCount, false);
+	std::vector<bool> Needed(Resources.size(), false);
+	for (uint32_t PassIndex = PassCount; PassIndex-- > 0;)
+	{
+		bool Keep = Passes[PassIndex].NeverCull;
+		for (const Access& Use : Passes[PassIndex].Accesses)
+		{
+			Keep = Keep || (Use.IsWrite && (!Resources[Use.Resource].IsTransient || Needed[Use.Resource]));
+		}
+		if (!Keep) continue;
+
+		Alive[PassIndex] = true;
+		for (const Access& Use : Passes[PassIndex].Accesses)
+		{
+			if (!Use.IsWrite)
+			{
+				Needed[Use.Resource] = true;
+			}
+		}
+	}
+
+	SortPasses(Alive);
+	Statistics.PassCount = static_cast<uint32_t>(ExecutionOrder.size());
+	Statistics.CulledPassCount = PassCount - Statistics.PassCount;
+
+	for (Resource& Current : Resources)
+	{
+		Current.FirstPosition = NoPosition;
+		Current.LastPosition = NoPosition;
+	}
+	for (uint32_t Position = 0; Position < ExecutionOrder.size(); Position++)
+	{
+		for (const Access& Use : Passes[ExecutionOrder[Position]].Accesses)
+		{
+			Resource& Used = Resources[Use.Resource];
+			if (Used.FirstPosition == NoPosition)
+			{
+				Used.FirstPosition = Position;
+				// Transients return to the state of their first use, so each frame starts where the last one did
+				if (Used.IsTransient)
+				{
+					Used.InitialState = Use.State;
+					Used.FinalState = Use.State;
+				}
+			}
+			Used.LastPosition = Position;
+		}
+	}
+
+	PlaceTransients();
+	BuildBarriers();
+	Compiled = true;
+}
+
+void RenderGraph::SortPasses(const std::vector<bool>& Alive)
+{
+	const uint32_t PassCount = static_cast<uint32_t>(Passes.size());
+	std::vector<std::vector<PassHandle>> Successors(PassCount);
+	std::vector<uint32_t> PredecessorCounts(PassCount, 0);
+	const auto AddEdge = [&](PassHandle From, PassHandle To)
+	{
+		if (From == To) return;
+		Successors[From].push_back(To);
+		PredecessorCounts[To]++;
+	};
+
+	// Reads wait for the last write, writes wait for the last write and every read since
+	std::vector<PassHandle> LastWriters(Resources.size(), ~0u);
+	std::vector<std::vector<PassHandle>> ReadersSinceWrite(Resources.size());
+	for (PassHandle PassIndex = 0; PassIndex < PassCount; PassIndex++)
+	{
+		if (!Alive[PassIndex]) continue;
+		for (const Access& Use : Passes[PassIndex].Accesses)
+		{
+			if (LastWriters[Use.Resource] != ~0u)
+			{
+				AddEdge(LastWriters[Use.Resource], PassIndex);
+			}
+			if (!Use.IsWrite)
+			{
+				ReadersSinceWrite[Use.Resource].push_back(PassIndex);
+				continue;
+			}
+
+			for (PassHandle Reader : ReadersSinceWrite[Use.Resource])
+			{
+				AddEdge(Reader, PassIndex);
+			}
+			ReadersSinceWrite[Use.Resource].clear();
+			LastWriters[Use.Resource] = PassIndex;
+		}
+	}
+
+	// Among the passes that are ready, the one declared first goes first, which keeps declaration order stable
+	std::priority_queue<PassHandle, std::vector<PassHandle>, std::greater<PassHandle>> Ready;
+	for (PassHandle PassIndex = 0; PassIndex < PassCount; PassIndex++)
+	{
+		if (Alive[PassIndex] && PredecessorCounts[PassIndex] == 0)
+		{
+			Ready.push(PassIndex);
+		}
+	}
+
+	ExecutionOrder.clear();
+	while (!Ready.empty())
+	{
+		const PassHandle Next = Ready.top();
+		Ready.pop();
+		ExecutionOrder.push_back(Next);
+		for (PassHandle Successor : Successors[Next])
+		{
+			if (--PredecessorCounts[Successor] == 0)
+			{
+				Ready.push(Successor);
+			}
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	// Largest first, each at the lowest offset clear of every placed resource whose lifetime overlaps its own
+	std::vector<ResourceHandle> Order;
+	for (ResourceHandle Handle = 0; Handle < Resources.size(); Handle++)
+	{
+		if (Resources[Handle].IsTransient && Resources[Handle].FirstPosition != NoPosition)
+		{
+			Order.push_back(Handle);
+			Statistics.TransientBytes += Resources[Handle].Size;
+		}
+	}
+	std::stable_sort(Order.begin(), Order.end(), [this](ResourceHandle Left, ResourceHandle Right) { return Resources[Left].Size > Resources[Right].Size; });
+
+	std::vector<ResourceHandle> Placed;
+	std::vector<ResourceHandle> Conflicts;
+	for (ResourceHandle Handle : Order)
+	{
+		Resource& Current = Resources[Handle];
+		Conflicts.clear();
+		for (ResourceHandle Other : Placed)
+		{
+			if (Resources[Other].FirstPosition <= Current.LastPosition && Current.FirstPosition <= Resources[Other].LastPosition)
+			{
+				Conflicts.push_back(Other);
+			}
+		}
+		std::sort(Conflicts.begin(), Conflicts.end(), [this](ResourceHandle Left, ResourceHandle Right) { return Resources[Left].Offset < Resources[Right].Offset; });
+
+		uint64_t Offset = 0;
+		for (ResourceHandle Other : Conflicts)
+		{
+			if (Offset + Current.Size <= Resources[Other].Offset) break;
+			Offset = std::max(Offset, AlignUp(Resources[Other].Offset + Resources[Other].Size, Current.Alignment));
+		}
+		Current.Offset = Offset;
+		Statistics.TransientHeapBytes = std::max(Statistics.TransientHeapBytes, Offset + Current.Size);
+		Placed.push_back(Handle);
+	}
+}
+
+void RenderGraph::BuildBarriers()
+{
+	const uint32_t PositionCount = static_cast<uint32_t>(ExecutionOrder.size()) + 1;
+	std::vector<std::vector<RenderGraphBarrier>> Batches(PositionCount);
+
+	// Memory that held another transient earlier in the frame needs an aliasing barrier before its new first use
+	for (ResourceHandle Handle = 0; Handle < Resources.size(); Handle++)
+	{
+		const Resource& Current = Resources[Handle];
+		if (!Current.IsTransient || Current.FirstPosition == NoPosition) continue;
+
+		ResourceHandle Previous = InvalidResource;
+		uint32_t PreviousLastPosition = 0;
+		bool Ambiguous = false;
+		for (ResourceHandle Other = 0; Other < Resources.size(); Other++)
+		{
+			const Resource& Candidate = Resources[Other];
+			if (!Candidate.IsTransient || Candidate.FirstPosition == NoPosition || Candidate.LastPosition >= Current.FirstPosition) continue;
+			if (Candidate.Offset >= Current.Offset + Current.Size || Current.Offset >= Candidate.Offset + Candidate.Size) continue;
+
+			if (Previous == InvalidResource || Candidate.LastPosition > PreviousLastPosition)
+			{
+				Previous = Other;
+				PreviousLastPosition = Candidate.LastPosition;
+				Ambiguous = false;
+			}
+			else if (Candidate.LastPosition == PreviousLastPosition)
+			{
+				Ambiguous = true;
+			}
+		}
+		if (Previous == InvalidResource) continue;
+
+		// Several resources finishing in the same pass leave no single predecessor, which backends express as any
+		RenderGraphBarrier Barrier;
+		Barrier.Type = RenderGraphBarrierType::Aliasing;
+		Barrier.Resource = Handle;
+		Barrier.ResourceBefore = Ambiguous ? InvalidResource : Previous;
+		Batches[Current.FirstPosition].push_back(Barrier);
+		Statistics.AliasingBarrierCount++;
+	}
+
+	struct Tracked
+	{
+		RenderGraphState State;
+		uint32_t LastPosition;
+		// Where the latest transition into a read-only state sits, so later reads can widen it instead
+		uint32_t TransitionPosition;
+		uint32_t TransitionIndex;
+		uint32_t SplitBeginPosition;
+		uint32_t SplitBeginIndex;
+	};
+	std::vector<Tracked> States(Resources.size());
+	for (ResourceHandle Handle = 0; Handle < Resources.size(); Handle++)
+	{
+		States[Handle].State = Resources[Handle].InitialState;
+		States[Handle].LastPosition = NoPosition;
+		States[Handle].TransitionPosition = NoPosition;
+		States[Handle].SplitBeginPosition = NoPosition;
+	}
+
+	const auto Transition = [&](ResourceHandle Handle, RenderGraphState After, uint32_t Position)
+	{
+		Tracked& Current = States[Handle];
+		RenderGraphBarrier Barrier;
+		Barrier.Resource = Handle;
+		Barrier.StateBefore = Current.State;
+		Barrier.StateAfter = After;
+
+		const uint32_t Earliest = Current.LastPosition == NoPosition ? 0 : Current.LastPosition + 1;
+		Current.SplitBeginPosition = NoPosition;
+		if (Earliest < Position)
+		{
+			Barrier.Split = RenderGraphBarrierSplit::Begin;
+			Current.SplitBeginPosition = Earliest;
+			Current.SplitBeginIndex = static_cast<uint32_t>(Batches[Earliest].size());
+			Batches[Earliest].push_back(Barrier);
+			Barrier.Split = RenderGraphBarrierSplit::End;
+			Statistics.SplitBarrierCount++;
+		}
+		Current.TransitionPosition = Position;
+		Current.TransitionIndex = static_cast<uint32_t>(Batches[Position].size());
+		Batches[Position].push_back(Barrier);
+		Current.State = After;
+		Statistics.TransitionBarrierCount++;
+	};
+
+	for (uint32_t Position = 0; Position + 1 < PositionCount; Position++)
+	{
+		for (const Access& Use : Passes[ExecutionOrder[Position]].Accesses)
+		{
+			Tracked& Current = States[Use.Resource];
+			const bool FirstTransientUse = Resources[Use.Resource].IsTransient && Current.LastPosition == NoPosition;
+			if (FirstTransientUse || Current.State == Use.State || (!Use.IsWrite && IsReadOnly(Current.State) && Contains(Current.State, Use.State)))
+			{
+				// Back to back unordered access still has to wait for the earlier writes to finish
+				if (!FirstTransientUse && Use.State == RenderGraphState::UnorderedAccess)
+				{
+					RenderGraphBarrier Barrier;
+					Barrier.Type = RenderGraphBarrierType::UnorderedAccess;
+					Barrier.Resource = Use.Resource;
+					Batches[Position].push_back(Barrier);
+					Statistics.UnorderedAccessBarrierCount++;
+				}
+			}
+			else if (!Use.IsWrite && IsReadOnly(Current.State) && Current.TransitionPosition != NoPosition)
+			{
+				// A read in another read-only state joins the transition made for the earlier read
+				const RenderGraphState Combined = Current.State | Use.State;
+				Batches[Current.TransitionPosition][Current.TransitionIndex].StateAfter = Combined;
+				if (Current.SplitBeginPosition != NoPosition)
+				{
+					Batches[Current.SplitBeginPosition][Current.SplitBeginIndex].StateAfter = Combined;
+				}
+				Current.State = Combined;
+				Statistics.MergedReadCount++;
+			}
+			else
+			{
+				Transition(Use.Resource, Use.State, Position);
+			}
+			if (Use.IsWrite)
+			{
+				Current.TransitionPosition = NoPosition;
+			}
+			Current.LastPosition = Position;
+		}
+	}
+
+	const uint32_t FinalPosition = PositionCount - 1;
+	for (ResourceHandle Handle = 0; Handle < Resources.size(); Handle++)
+	{
+		if (States[Handle].State != Resources[Handle].FinalState)
+		{
+			Transition(Handle, Resources[Handle].FinalState, FinalPosition);
+		}
+	}
+
+	Barriers.clear();
+	BarrierOffsets.assign(1, 0);
+	for (const std::vector<RenderGraphBarrier>& Batch : Batches)
+	{
+		Barriers.insert(Barriers.end(), Batch.begin(), Batch.end());
+		BarrierOffsets.push_back(static_cast<uint32_t>(Barriers.size()));
+		Statistics.BarrierBatchCount += Batch.empty() ? 0 : 1;
+	}
+}
+
+void RenderGraph::GetBarriers(uint32_t Position, const RenderGraphBarrier*& BatchBarriers, uint32_t& BarrierCount) const
+{
+	if (!Compiled || Position + 1 >= BarrierOffsets.size()) throw std::runtime_error("No such position in the compiled graph");
+
+	BatchBarriers = Barriers.data() + BarrierOffsets[Position];
+	BarrierCount = BarrierOffsets[Position + 1] - BarrierOffsets[Position];
+}
+
+void RenderGraph::Execute(const BarrierCallback& RecordBarriers) const
+{
+	if (!Compiled) throw std::runtime_error("Render graph executed before it was compiled");
+
+	for (uint32_t Position = 0; Position <= ExecutionOrder.size(); Position++)
+	{
+		const RenderGraphBarrier* BatchBarriers;
+		uint32_t BarrierCount;
+		GetBarriers(Position, BatchBarriers, BarrierCount);
+		if (BarrierCount != 0)
+		{
+			RecordBarriers(BatchBarriers, BarrierCount);
+		}
+
+		if (Position < ExecutionOrder.size() && Passes[ExecutionOrder[Position]].Execute)
+		{
+			Passes[ExecutionOrder[Position]].Execute();
+		}
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Resource states as bit flags so read-only states can be combined, mirroring D3D12_RESOURCE_STATES without
+// depending on it. Undefined is only valid as the state before the first use of transient memory.
+enum class RenderGraphState : uint32_t
+{
+	Undefined = 0,
+	Present = 1 << 0,
+	RenderTarget = 1 << 1,
+	DepthWrite = 1 << 2,
+	UnorderedAccess = 1 << 3,
+	CopyDestination = 1 << 4,
+	DepthRead = 1 << 5,
+	PixelShaderResource = 1 << 6,
+	NonPixelShaderResource = 1 << 7,
+	CopySource = 1 << 8,
+	VertexBuffer = 1 << 9,
+	IndirectArgument = 1 << 10
+};
+
+inline RenderGraphState operator|(RenderGraphState Left, RenderGraphState Right)
+{
+	return static_cast<RenderGraphState>(static_cast<uint32_t>(Left) | static_cast<uint32_t>(Right));
+}
+
+enum class RenderGraphBarrierType
+{
+	Transition,
+	Aliasing,
+	UnorderedAccess
+};
+
+// Split barriers begin right after the resource's last use and end right before its next one, so the GPU can
+// perform the transition while the passes in between run
+enum class RenderGraphBarrierSplit
+{
+	None,
+	Begin,
+	End
+};
+
+struct RenderGraphBarrier
+{
+	RenderGraphBarrierType Type = RenderGraphBarrierType::Transition;
+	RenderGraphBarrierSplit Split = RenderGraphBarrierSplit::None;
+	uint32_t Resource = 0;
+	// Aliasing barriers name the resource that last used the memory here
+	uint32_t ResourceBefore = 0;
+	RenderGraphState StateBefore = RenderGraphState::Undefined;
+	RenderGraphState StateAfter = RenderGraphState::Undefined;
+};
+
+struct RenderGraphStatistics
+{
+	uint32_t PassCount = 0;
+	uint32_t CulledPassCount = 0;
+	// One per non-empty barrier batch, the number of ResourceBarrier calls a backend makes
+	uint32_t BarrierBatchCount = 0;
+	uint32_t TransitionBarrierCount = 0;
+	uint32_t SplitBarrierCount = 0;
+	uint32_t AliasingBarrierCount = 0;
+	uint32_t UnorderedAccessBarrierCount = 0;
+	// Reads that joined the state of an earlier read instead of needing their own transition
+	uint32_t MergedReadCount = 0;
+
+	uint64_t TransientBytes = 0;
+	uint64_t TransientHeapBytes = 0;
+
+	uint64_t GetSavedTransientBytes() const { return TransientBytes - TransientHeapBytes; }
+};
+
+// Passes declare the resources they read and write; Compile orders them by their dependencies, drops passes whose
+// results are never used, derives every state transition and packs transient resources whose lifetimes do not
+// overlap into the same memory. Nothing here touches a GPU, backends translate the compiled barriers.
+// A graph is built, compiled and executed once per frame; Reset keeps the allocations for the next one.
+class RenderGraph
+{
+public:
+	using ResourceHandle = uint32_t;
+	using PassHandle = uint32_t;
+	using BarrierCallback = std::function<void(const RenderGraphBarrier* Barriers, uint32_t BarrierCount)>;
+
+	static const ResourceHandle InvalidResource = ~0u;
+
+	void Reset();
+
+	// Resources living outside the graph, such as the back buffer, which the graph leaves in FinalState
+	ResourceHandle ImportResource(const char* Name, RenderGraphState InitialState, RenderGraphState FinalState);
+	// Memory owned by the graph for one frame. The first pass to use one must overwrite all of it, since the
+	// memory may have held another resource; afterwards it returns to the state of that first use.
+	ResourceHandle CreateTransient(const char* Name, uint64_t Size, uint64_t Alignment);
+
+	// Passes that write no imported resource and feed no surviving pass are culled unless NeverCull is set
+	PassHandle AddPass(const char* Name, std::function<void()> Execute, bool NeverCull = false);
+	// A pass may read a resource in several states, which are combined, but not read and write it differently
+	void Read(PassHandle Pass, ResourceHandle Resource, RenderGraphState State);
+	void Write(PassHandle Pass, ResourceHandle Resource, RenderGraphState State);
+
+	void Compile();
+	// Hands each batch of barriers to RecordBarriers before running the pass that needs them, then the final batch
+	void Execute(const BarrierCallback& RecordBarriers) const;
+
+	// Passes in execution order
+	const std::vector<PassHandle>& GetExecutionOrder() const { return ExecutionOrder; }
+	// Barriers recorded before the pass at Position in the execution order, or after the last pass at its end
+	void GetBarriers(uint32_t Position, const RenderGraphBarrier*& Barriers, uint32_t& BarrierCount) const;
+	// Offset into the transient heap, valid after Compile
+	uint64_t GetTransientOffset(ResourceHandle Resource) const { return Resources[Resource].Offset; }
+	const std::string& GetResourceName(ResourceHandle Resource) const { return Resources[Resource].Name; }
+	const std::string& GetPassName(PassHandle Pass) const { return Passes[Pass].Name; }
+	const RenderGraphStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	struct Resource
+	{
+		std::string Name;
+		bool IsTransient;
+		RenderGraphState InitialState;
+		RenderGraphState FinalState;
+		uint64_t Size;
+		uint64_t Alignment;
+		uint64_t Offset;
+		uint32_t FirstPosition;
+		uint32_t LastPosition;
+	};
+
+	struct Access
+	{
+		ResourceHandle Resource;
+		RenderGraphState State;
+		bool IsWrite;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		std::function<void()> Execute;
+		bool NeverCull;
+		std::vector<Access> Accesses;
+	};
+
+	std::vector<Resource> Resources;
+	std::vector<Pass> Passes;
+	std::vector<PassHandle> ExecutionOrder;
+	std::vector<RenderGraphBarrier> Barriers;
+	// Barriers for position P are Barriers[BarrierOffsets[P]] up to Barriers[BarrierOffsets[P + 1]]
+	std::vector<uint32_t> BarrierOffsets;
+	RenderGraphStatistics Statistics;
+	bool Compiled = false;
+
+	void AddAccess(PassHandle Pass, ResourceHandle Resource, RenderGraphState State, bool IsWrite);
+	void SortPasses(const std::vector<bool>& Alive);
+	void PlaceTransients();
+	void BuildBarriers();
+};
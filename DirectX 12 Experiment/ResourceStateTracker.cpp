@@ -0,0 +1,302 @@
+#include "ResourceStateTracker.h"
+
+#include <stdexcept>
+
+static bool IsReadOnly(RenderGraphState State)
+{
+	const uint32_t WritableStates = static_cast<uint32_t>(RenderGraphState::Present | RenderGraphState::RenderTarget | RenderGraphState::DepthWrite | RenderGraphState::UnorderedAccess | RenderGraphState::CopyDestination);
+	return State != RenderGraphState::Undefined && (static_cast<uint32_t>(State) & WritableStates) == 0;
+}
+
+// Moving to a read-only state the resource is already in, among others, needs no barrier
+static bool Satisfies(RenderGraphState Current, RenderGraphState Requested)
+{
+	if (Current == Requested) return true;
+	return IsReadOnly(Current) && IsReadOnly(Requested) && (static_cast<uint32_t>(Current) & static_cast<uint32_t>(Requested)) == static_cast<uint32_t>(Requested);
+}
+
+ResourceStateRegistry::Handle ResourceStateRegistry::Register(void* Native, uint32_t SubresourceCount, RenderGraphState InitialState)
+{
+	if (SubresourceCount == 0) throw std::runtime_error("Resources need at least one subresource");
+	if (InitialState == RenderGraphState::Undefined) throw std::runtime_error("Resources need a defined initial state");
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+	uint32_t Index;
+	if (!FreeEntries.empty())
+	{
+		Index = FreeEntries.back();
+		FreeEntries.pop_back();
+	}
+	else
+	{
+		Index = static_cast<uint32_t>(Entries.size());
+		Entry NewEntry = {};
+		Entries.push_back(NewEntry);
+	}
+
+	Entry& Registered = Entries[Index];
+	Registered.Native = Native;
+	Registered.States.assign(SubresourceCount, InitialState);
+	return (static_cast<Handle>(Registered.Generation) << 32) | Index;
+}
+
+void ResourceStateRegistry::Unregister(Handle Resource)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	if (FindEntry(Resource) == nullptr) throw std::runtime_error("Resource is not registered");
+
+	Entry& Unregistered = Entries[static_cast<uint32_t>(Resource)];
+	Unregistered.Native = nullptr;
+	Unregistered.States.clear();
+	Unregistered.Generation++;
+	FreeEntries.push_back(static_cast<uint32_t>(Resource));
+}
+
+bool ResourceStateRegistry::IsRegistered(Handle Resource) const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return FindEntry(Resource) != nullptr;
+}
+
+RenderGraphState ResourceStateRegistry::GetState(Handle Resource, uint32_t Subresource) const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	const Entry* Registered = FindEntry(Resource);
+	if (Registered == nullptr || Subresource >= Registered->States.size()) throw std::runtime_error("No such registered subresource");
+	return Registered->States[Subresource];
+}
+
+ResourceStateStatistics ResourceStateRegistry::TakeFrameStatistics()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	const ResourceStateStatistics Taken = FrameStatistics;
+	FrameStatistics = ResourceStateStatistics();
+	return Taken;
+}
+
+const ResourceStateRegistry::Entry* ResourceStateRegistry::FindEntry(Handle Resource) const
+{
+	const uint32_t Index = static_cast<uint32_t>(Resource);
+	if (Index >= Entries.size()) return nullptr;
+
+	const Entry& Found = Entries[Index];
+	if (Found.Generation != static_cast<uint32_t>(Resource >> 32) || Found.States.empty()) return nullptr;
+	return &Found;
+}
+
+ResourceStateTracker::ResourceStateTracker(ResourceStateRegistry& Registry) :
+	Registry(Registry)
+{
+}
+
+void ResourceStateTracker::Reset()
+{
+	Resources.clear();
+	ResourceIndices.clear();
+	Pending.clear();
+	Statistics = ResourceStateStatistics();
+}
+
+void ResourceStateTracker::Transition(ResourceStateRegistry::Handle Resource, RenderGraphState State, uint32_t Subresource)
+{
+	if (State == RenderGraphState::Undefined) throw std::runtime_error("Cannot transition to an undefined state");
+
+	TrackedResource& Tracked = *FindResource(Resource);
+	const uint32_t SubresourceCount = static_cast<uint32_t>(Tracked.Current.size());
+	if (Subresource != ResourceStateRegistry::AllSubresources && Subresource >= SubresourceCount) throw std::runtime_error("Subresource out of range");
+
+	// A whole resource whose subresources the list already knows to share one state moves with a single barrier
+	if (Subresource == ResourceStateRegistry::AllSubresources && SubresourceCount > 1)
+	{
+		const RenderGraphState Shared = Tracked.Current[0];
+		bool Uniform = Shared != RenderGraphState::Undefined;
+		for (uint32_t Index = 1; Index < SubresourceCount && Uniform; Index++)
+		{
+			Uniform = Tracked.Current[Index] == Shared;
+		}
+		if (Uniform && Satisfies(Shared, State))
+		{
+			Statistics.ElidedBarriers++;
+			return;
+		}
+		if (Uniform)
+		{
+			QueueTransition(Tracked, ResourceStateRegistry::AllSubresources, Shared, State);
+			Tracked.Current.assign(SubresourceCount, State);
+			return;
+		}
+	}
+
+	const uint32_t First = Subresource == ResourceStateRegistry::AllSubresources ? 0 : Subresource;
+	const uint32_t Last = Subresource == ResourceStateRegistry::AllSubresources ? SubresourceCount - 1 : Subresource;
+	for (uint32_t Index = First; Index <= Last; Index++)
+	{
+		RenderGraphState& Current = Tracked.Current[Index];
+		if (Current == RenderGraphState::Undefined)
+		{
+			// Whatever state earlier lists leave behind is only known at submit, Resolve inserts the barrier there
+			Tracked.Required[Index] = State;
+			Current = State;
+		}
+		else if (Satisfies(Current, State))
+		{
+			Statistics.ElidedBarriers++;
+		}
+		else
+		{
+			QueueTransition(Tracked, SubresourceCount == 1 ? ResourceStateRegistry::AllSubresources : Index, Current, State);
+			Current = State;
+		}
+	}
+}
+
+void ResourceStateTracker::UnorderedAccessBarrier(ResourceStateRegistry::Handle Resource)
+{
+	TrackedResource& Tracked = *FindResource(Resource);
+
+	// Nothing has touched the resource since a queued barrier that already orders it
+	for (size_t Index = Pending.size(); Index-- > 0;)
+	{
+		if (Pending[Index].Resource != Resource) continue;
+		if (Pending[Index].IsUnorderedAccess)
+		{
+			Statistics.ElidedBarriers++;
+			return;
+		}
+		break;
+	}
+
+	ResourceStateBarrier Barrier;
+	Barrier.IsUnorderedAccess = true;
+	Barrier.Resource = Resource;
+	Barrier.Native = Tracked.Native;
+	Pending.push_back(Barrier);
+}
+
+void ResourceStateTracker::FlushBarriers(const BarrierCallback& RecordBarriers)
+{
+	if (Pending.empty()) return;
+
+	RecordBarriers(Pending.data(), static_cast<uint32_t>(Pending.size()));
+	Statistics.IssuedBarriers += static_cast<uint32_t>(Pending.size());
+	Statistics.BarrierBatches++;
+	Pending.clear();
+}
+
+void ResourceStateTracker::Resolve(std::vector<ResourceStateBarrier>& Barriers)
+{
+	if (!Pending.empty()) throw std::runtime_error("Command list submitted with barriers it never flushed");
+
+	const size_t FirstResolved = Barriers.size();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (const TrackedResource& Tracked : Resources)
+	{
+		// Unregistered while the list was recording, nothing later can refer to it
+		if (Registry.FindEntry(Tracked.Resource) == nullptr) continue;
+
+		std::vector<RenderGraphState>& States = Registry.Entries[static_cast<uint32_t>(Tracked.Resource)].States;
+		const uint32_t SubresourceCount = static_cast<uint32_t>(States.size());
+
+		bool Uniform = true;
+		for (uint32_t Index = 0; Index < SubresourceCount && Uniform; Index++)
+		{
+			Uniform = Tracked.Required[Index] == Tracked.Required[0] && States[Index] == States[0];
+		}
+
+		ResourceStateBarrier Barrier;
+		Barrier.Resource = Tracked.Resource;
+		Barrier.Native = Tracked.Native;
+		if (Uniform && Tracked.Required[0] != RenderGraphState::Undefined && States[0] != Tracked.Required[0])
+		{
+			Barrier.Subresource = ResourceStateRegistry::AllSubresources;
+			Barrier.StateBefore = States[0];
+			Barrier.StateAfter = Tracked.Required[0];
+			Barriers.push_back(Barrier);
+		}
+		else if (!Uniform)
+		{
+			for (uint32_t Index = 0; Index < SubresourceCount; Index++)
+			{
+				if (Tracked.Required[Index] == RenderGraphState::Undefined || States[Index] == Tracked.Required[Index]) continue;
+
+				Barrier.Subresource = Index;
+				Barrier.StateBefore = States[Index];
+				Barrier.StateAfter = Tracked.Required[Index];
+				Barriers.push_back(Barrier);
+			}
+		}
+
+		for (uint32_t Index = 0; Index < SubresourceCount; Index++)
+		{
+			if (Tracked.Current[Index] != RenderGraphState::Undefined)
+			{
+				States[Index] = Tracked.Current[Index];
+			}
+		}
+	}
+
+	const uint32_t ResolvedCount = static_cast<uint32_t>(Barriers.size() - FirstResolved);
+	Statistics.ResolvedBarriers += ResolvedCount;
+	Statistics.IssuedBarriers += ResolvedCount;
+	Statistics.BarrierBatches += ResolvedCount != 0 ? 1 : 0;
+	Registry.FrameStatistics.Add(Statistics);
+}
+
+ResourceStateTracker::TrackedResource* ResourceStateTracker::FindResource(ResourceStateRegistry::Handle Resource)
+{
+	const auto Found = ResourceIndices.find(Resource);
+	if (Found != ResourceIndices.end()) return &Resources[Found->second];
+
+	TrackedResource NewResource;
+	NewResource.Resource = Resource;
+	{
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		const ResourceStateRegistry::Entry* Registered = Registry.FindEntry(Resource);
+		if (Registered == nullptr) throw std::runtime_error("Resource is not registered");
+
+		NewResource.Native = Registered->Native;
+		NewResource.Required.assign(Registered->States.size(), RenderGraphState::Undefined);
+		NewResource.Current.assign(Registered->States.size(), RenderGraphState::Undefined);
+	}
+
+	ResourceIndices.emplace(Resource, static_cast<uint32_t>(Resources.size()));
+	Resources.push_back(std::move(NewResource));
+	return &Resources.back();
+}
+
+void ResourceStateTracker::QueueTransition(const TrackedResource& Tracked, uint32_t Subresource, RenderGraphState StateBefore, RenderGraphState StateAfter)
+{
+	// A queued transition of the same subresource is extended instead, or dropped when this one undoes it.
+	// The search stops at anything queued for the resource that overlaps it, which has to stay in between.
+	for (size_t Index = Pending.size(); Index-- > 0;)
+	{
+		ResourceStateBarrier& Queued = Pending[Index];
+		if (Queued.Resource != Tracked.Resource) continue;
+		if (Queued.IsUnorderedAccess) break;
+		if (Queued.Subresource != Subresource)
+		{
+			if (Queued.Subresource == ResourceStateRegistry::AllSubresources || Subresource == ResourceStateRegistry::AllSubresources) break;
+			continue;
+		}
+
+		if (Queued.StateBefore == StateAfter)
+		{
+			Pending.erase(Pending.begin() + Index);
+			Statistics.ElidedBarriers += 2;
+		}
+		else
+		{
+			Queued.StateAfter = StateAfter;
+			Statistics.ElidedBarriers++;
+		}
+		return;
+	}
+
+	ResourceStateBarrier Barrier;
+	Barrier.Resource = Tracked.Resource;
+	Barrier.Native = Tracked.Native;
+	Barrier.Subresource = Subresource;
+	Barrier.StateBefore = StateBefore;
+	Barrier.StateAfter = StateAfter;
+	Pending.push_back(Barrier);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "RenderGraph.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct ResourceStateBarrier
+{
+	bool IsUnorderedAccess = false;
+	uint64_t Resource = 0;
+	// The backend's resource object as registered, so barriers translate without a lookup
+	void* Native = nullptr;
+	uint32_t Subresource = 0;
+	RenderGraphState StateBefore = RenderGraphState::Undefined;
+	RenderGraphState StateAfter = RenderGraphState::Undefined;
+};
+
+struct ResourceStateStatistics
+{
+	uint32_t IssuedBarriers = 0;
+	uint32_t ElidedBarriers = 0;
+	// ResourceBarrier calls, each carrying a whole batch
+	uint32_t BarrierBatches = 0;
+	// Issued at submit because a list's first use differed from the state left by earlier lists
+	uint32_t ResolvedBarriers = 0;
+
+	void Add(const ResourceStateStatistics& Other)
+	{
+		IssuedBarriers += Other.IssuedBarriers;
+		ElidedBarriers += Other.ElidedBarriers;
+		BarrierBatches += Other.BarrierBatches;
+		ResolvedBarriers += Other.ResolvedBarriers;
+	}
+};
+
+// The state every registered resource is in once all submitted command lists have run. Handles carry a generation,
+// so a list still holding the handle of an unregistered resource cannot touch whatever reuses its slot.
+class ResourceStateRegistry
+{
+public:
+	using Handle = uint64_t;
+	static const Handle InvalidHandle = ~0ull;
+	static const uint32_t AllSubresources = ~0u;
+
+	Handle Register(void* Native, uint32_t SubresourceCount, RenderGraphState InitialState);
+	void Unregister(Handle Resource);
+
+	bool IsRegistered(Handle Resource) const;
+	RenderGraphState GetState(Handle Resource, uint32_t Subresource) const;
+
+	// Counters of every list resolved since the last call, read and cleared once per frame
+	ResourceStateStatistics TakeFrameStatistics();
+
+private:
+	friend class ResourceStateTracker;
+
+	struct Entry
+	{
+		void* Native;
+		uint32_t Generation;
+		std::vector<RenderGraphState> States;
+	};
+
+	mutable std::mutex Mutex;
+	std::vector<Entry> Entries;
+	std::vector<uint32_t> FreeEntries;
+	ResourceStateStatistics FrameStatistics;
+
+	const Entry* FindEntry(Handle Resource) const;
+};
+
+// Per command list view of resource states. The list records barriers against states it already knows; the
+// first use of each subresource becomes a requirement that Resolve checks against the registry at submit time.
+// Transitions queue up until FlushBarriers, which is called before the next command that depends on them, so
+// they reach the API as one batch with no-ops and transitions that cancel out removed.
+class ResourceStateTracker
+{
+public:
+	using BarrierCallback = std::function<void(const ResourceStateBarrier* Barriers, uint32_t BarrierCount)>;
+
+	explicit ResourceStateTracker(ResourceStateRegistry& Registry);
+
+	// Forgets everything, for when the command list is reset
+	void Reset();
+
+	void Transition(ResourceStateRegistry::Handle Resource, RenderGraphState State, uint32_t Subresource = ResourceStateRegistry::AllSubresources);
+	void UnorderedAccessBarrier(ResourceStateRegistry::Handle Resource);
+	void FlushBarriers(const BarrierCallback& RecordBarriers);
+
+	// Called on the submitting thread in submission order. Appends the barriers that must run before this list to
+	// Barriers and publishes the states the list leaves behind.
+	void Resolve(std::vector<ResourceStateBarrier>& Barriers);
+
+	const ResourceStateStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	struct TrackedResource
+	{
+		ResourceStateRegistry::Handle Resource;
+		void* Native;
+		// Undefined where the list has not used the subresource yet
+		std::vector<RenderGraphState> Required;
+		std::vector<RenderGraphState> Current;
+	};
+
+	ResourceStateRegistry& Registry;
+	std::vector<TrackedResource> Resources;
+	std::unordered_map<ResourceStateRegistry::Handle, uint32_t> ResourceIndices;
+	std::vector<ResourceStateBarrier> Pending;
+	ResourceStateStatistics Statistics;
+
+	TrackedResource* FindResource(ResourceStateRegistry::Handle Resource);
+	void QueueTransition(const TrackedResource& Tracked, uint32_t Subresource, RenderGraphState StateBefore, RenderGraphState StateAfter);
+};
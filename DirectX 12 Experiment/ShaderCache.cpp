@@ -0,0 +1,322 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+// "SHPK" when read as little endian bytes
+static const uint32_t PackMagic = 0x4B504853;
+static const uint32_t PackVersion = 1;
+static const uint64_t PackBytecodeAlignment = 16;
+
+// Every record is a multiple of eight bytes so the index can be read in place from the mapping
+struct PackHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t EntryCount;
+	uint32_t DependencyCount;
+	uint64_t Size;
+};
+
+struct PackEntry
+{
+	uint64_t RequestKey;
+	uint64_t ContentKey;
+	uint64_t BytecodeOffset;
+	uint32_t BytecodeSize;
+	uint32_t FirstDependency;
+	uint32_t DependencyCount;
+	uint32_t Reserved;
+};
+
+struct PackDependency
+{
+	uint64_t ContentHash;
+	uint64_t PathOffset;
+	uint32_t PathSize;
+	uint32_t Reserved;
+};
+
+static double GetMillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+ShaderCache::ShaderCache(std::string PackPath, std::string CompilerIdentity, ShaderCompiler Compiler) :
+	PackPath(std::move(PackPath)),
+	CompilerIdentity(std::move(CompilerIdentity)),
+	Compiler(std::move(Compiler))
+{
+}
+
+bool ShaderCache::Load()
+{
+	Entries.clear();
+	Dirty = false;
+	if (!Pack.Open(PackPath)) return false;
+
+	const uint8_t* Data = Pack.GetData();
+	const size_t Size = Pack.GetSize();
+
+	PackHeader Header;
+	if (Size < sizeof(Header))
+	{
+		Pack.Close();
+		return false;
+	}
+	memcpy(&Header, Data, sizeof(Header));
+
+	const uint64_t IndexSize = sizeof(PackHeader) + static_cast<uint64_t>(Header.EntryCount) * sizeof(PackEntry) + static_cast<uint64_t>(Header.DependencyCount) * sizeof(PackDependency);
+	if (Header.Magic != PackMagic || Header.Version != PackVersion || Header.Size != Size || IndexSize > Size)
+	{
+		Pack.Close();
+		return false;
+	}
+
+	const PackEntry* PackEntries = reinterpret_cast<const PackEntry*>(Data + sizeof(PackHeader));
+	const PackDependency* PackDependencies = reinterpret_cast<const PackDependency*>(PackEntries + Header.EntryCount);
+
+	for (uint32_t EntryIndex = 0; EntryIndex < Header.EntryCount; EntryIndex++)
+	{
+		const PackEntry& Source = PackEntries[EntryIndex];
+		const bool Valid =
+			Source.BytecodeOffset <= Size && Source.BytecodeSize <= Size - Source.BytecodeOffset &&
+			Source.FirstDependency <= Header.DependencyCount && Source.DependencyCount <= Header.DependencyCount - Source.FirstDependency;
+		if (!Valid)
+		{
+			Entries.clear();
+			Pack.Close();
+			return false;
+		}
+
+		Entry& Loaded = Entries[Source.RequestKey];
+		Loaded.ContentKey = Source.ContentKey;
+		Loaded.Bytecode = Data + Source.BytecodeOffset;
+		Loaded.BytecodeSize = Source.BytecodeSize;
+
+		for (uint32_t DependencyIndex = 0; DependencyIndex < Source.DependencyCount; DependencyIndex++)
+		{
+			const PackDependency& Stored = PackDependencies[Source.FirstDependency + DependencyIndex];
+			if (Stored.PathOffset > Size || Stored.PathSize > Size - Stored.PathOffset)
+			{
+				Entries.clear();
+				Pack.Close();
+				return false;
+			}
+
+			Dependency File;
+			File.Path.assign(reinterpret_cast<const char*>(Data + Stored.PathOffset), Stored.PathSize);
+			File.ContentHash = Stored.ContentHash;
+			Loaded.Dependencies.push_back(std::move(File));
+		}
+	}
+	return true;
+}
+
+std::vector<ShaderBytecode> ShaderCache::Resolve(const ShaderCompileRequest* Requests, uint32_t RequestCount, JobSystem* Jobs)
+{
+	const auto ValidateStart = std::chrono::steady_clock::now();
+
+	// Includes are usually shared, so each file is read and hashed once per call
+	std::unordered_map<std::string, uint64_t> FileHashes;
+	std::vector<uint64_t> RequestKeys(RequestCount);
+	std::vector<uint32_t> StaleRequests;
+	for (uint32_t RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
+	{
+		RequestKeys[RequestIndex] = GetRequestKey(Requests[RequestIndex]);
+
+		auto Cached = Entries.find(RequestKeys[RequestIndex]);
+		bool Fresh = Cached != Entries.end();
+		if (Fresh)
+		{
+			std::vector<Dependency> Current = Cached->second.Dependencies;
+			for (Dependency& File : Current)
+			{
+				File.ContentHash = HashFile(File.Path, FileHashes);
+			}
+			Fresh = GetContentKey(RequestKeys[RequestIndex], Current) == Cached->second.ContentKey;
+		}
+
+		if (Fresh)
+		{
+			Statistics.Hits++;
+		}
+		else
+		{
+			Statistics.Misses++;
+			StaleRequests.push_back(RequestIndex);
+		}
+	}
+	Statistics.ValidateMilliseconds += GetMillisecondsSince(ValidateStart);
+
+	if (!StaleRequests.empty())
+	{
+		const auto CompileStart = std::chrono::steady_clock::now();
+
+		// Compiles write only their own result slot, everything shared is updated afterwards on this thread
+		std::vector<ShaderCompileResult> Results(StaleRequests.size());
+		auto CompileRange = [&](uint32_t Begin, uint32_t End)
+		{
+			for (uint32_t Stale = Begin; Stale < End; Stale++)
+			{
+				Results[Stale] = Compiler(Requests[StaleRequests[Stale]]);
+			}
+		};
+		if (Jobs != nullptr && StaleRequests.size() > 1)
+		{
+			Jobs->ParallelFor(0, static_cast<uint32_t>(StaleRequests.size()), 1, CompileRange);
+		}
+		else
+		{
+			CompileRange(0, static_cast<uint32_t>(StaleRequests.size()));
+		}
+		Statistics.CompileMilliseconds += GetMillisecondsSince(CompileStart);
+
+		for (uint32_t Stale = 0; Stale < StaleRequests.size(); Stale++)
+		{
+			const ShaderCompileRequest& Request = Requests[StaleRequests[Stale]];
+			ShaderCompileResult& Result = Results[Stale];
+			if (!Result.Succeeded) throw std::runtime_error("Shader compilation failed for " + Request.Path + " (" + Request.EntryPoint + ", " + Request.Profile + "): " + Result.Messages);
+
+			// Files already hashed during validation keep that earlier hash, so an edit made while compiling is stale next run
+			Entry Compiled;
+			Compiled.Dependencies.push_back({ Request.Path, 0 });
+			for (std::string& Include : Result.Includes)
+			{
+				Compiled.Dependencies.push_back({ std::move(Include), 0 });
+			}
+			for (Dependency& File : Compiled.Dependencies)
+			{
+				File.ContentHash = HashFile(File.Path, FileHashes);
+			}
+
+			const uint64_t RequestKey = RequestKeys[StaleRequests[Stale]];
+			Compiled.ContentKey = GetContentKey(RequestKey, Compiled.Dependencies);
+			Compiled.OwnedBytecode = std::move(Result.Bytecode);
+
+			Entry& Stored = Entries[RequestKey];
+			Stored = std::move(Compiled);
+			Stored.Bytecode = Stored.OwnedBytecode.data();
+			Stored.BytecodeSize = Stored.OwnedBytecode.size();
+		}
+		Dirty = true;
+	}
+
+	std::vector<ShaderBytecode> Bytecode(RequestCount);
+	for (uint32_t RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
+	{
+		const Entry& Resolved = Entries.at(RequestKeys[RequestIndex]);
+		Bytecode[RequestIndex].Data = Resolved.Bytecode;
+		Bytecode[RequestIndex].Size = Resolved.BytecodeSize;
+	}
+	return Bytecode;
+}
+
+bool ShaderCache::Save()
+{
+	if (!Dirty) return true;
+
+	uint32_t DependencyCount = 0;
+	uint64_t PathBytes = 0;
+	for (const auto& Cached : Entries)
+	{
+		DependencyCount += static_cast<uint32_t>(Cached.second.Dependencies.size());
+		for (const Dependency& File : Cached.second.Dependencies)
+		{
+			PathBytes += File.Path.size();
+		}
+	}
+
+	const uint64_t IndexSize = sizeof(PackHeader) + Entries.size() * sizeof(PackEntry) + static_cast<uint64_t>(DependencyCount) * sizeof(PackDependency);
+	uint64_t Size = (IndexSize + PathBytes + PackBytecodeAlignment - 1) & ~(PackBytecodeAlignment - 1);
+	for (const auto& Cached : Entries)
+	{
+		Size = (Size + Cached.second.BytecodeSize + PackBytecodeAlignment - 1) & ~(PackBytecodeAlignment - 1);
+	}
+
+	// Built in memory first because the old pack stays mapped, and its bytecode copied, until the write
+	std::vector<uint8_t> Buffer(static_cast<size_t>(Size));
+	PackHeader Header = {};
+	Header.Magic = PackMagic;
+	Header.Version = PackVersion;
+	Header.EntryCount = static_cast<uint32_t>(Entries.size());
+	Header.DependencyCount = DependencyCount;
+	Header.Size = Size;
+	memcpy(Buffer.data(), &Header, sizeof(Header));
+
+	uint64_t EntryOffset = sizeof(PackHeader);
+	uint64_t DependencyOffset = sizeof(PackHeader) + Entries.size() * sizeof(PackEntry);
+	uint64_t PathOffset = IndexSize;
+	uint64_t BytecodeOffset = (IndexSize + PathBytes + PackBytecodeAlignment - 1) & ~(PackBytecodeAlignment - 1);
+	uint32_t FirstDependency = 0;
+	for (const auto& Cached : Entries)
+	{
+		PackEntry Stored = {};
+		Stored.RequestKey = Cached.first;
+		Stored.ContentKey = Cached.second.ContentKey;
+		Stored.BytecodeOffset = BytecodeOffset;
+		Stored.BytecodeSize = static_cast<uint32_t>(Cached.second.BytecodeSize);
+		Stored.FirstDependency = FirstDependency;
+		Stored.DependencyCount = static_cast<uint32_t>(Cached.second.Dependencies.size());
+		memcpy(Buffer.data() + EntryOffset, &Stored, sizeof(Stored));
+		EntryOffset += sizeof(Stored);
+
+		for (const Dependency& File : Cached.second.Dependencies)
+		{
+			PackDependency StoredDependency = {};
+			StoredDependency.ContentHash = File.ContentHash;
+			StoredDependency.PathOffset = PathOffset;
+			StoredDependency.PathSize = static_cast<uint32_t>(File.Path.size());
+			memcpy(Buffer.data() + DependencyOffset, &StoredDependency, sizeof(StoredDependency));
+			memcpy(Buffer.data() + PathOffset, File.Path.data(), File.Path.size());
+			DependencyOffset += sizeof(StoredDependency);
+			PathOffset += File.Path.size();
+		}
+		FirstDependency += Stored.DependencyCount;
+
+		memcpy(Buffer.data() + BytecodeOffset, Cached.second.Bytecode, Cached.second.BytecodeSize);
+		BytecodeOffset = (BytecodeOffset + Cached.second.BytecodeSize + PackBytecodeAlignment - 1) & ~(PackBytecodeAlignment - 1);
+	}
+
+	// Windows refuses to replace a file that is still mapped
+	Entries.clear();
+	Pack.Close();
+	const bool Written = WriteFileAtomically(PackPath, Buffer.data(), Buffer.size());
+	Load();
+	return Written;
+}
+
+uint64_t ShaderCache::GetRequestKey(const ShaderCompileRequest& Request) const
+{
+	uint64_t Hash = HashString(CompilerIdentity, FnvOffsetBasis);
+	Hash = HashString(Request.Path, Hash);
+	Hash = HashString(Request.EntryPoint, Hash);
+	Hash = HashString(Request.Profile, Hash);
+	return HashValue(Request.Flags, Hash);
+}
+
+uint64_t ShaderCache::GetContentKey(uint64_t RequestKey, const std::vector<Dependency>& Dependencies)
+{
+	uint64_t Hash = HashValue(RequestKey, FnvOffsetBasis);
+	for (const Dependency& File : Dependencies)
+	{
+		Hash = HashString(File.Path, Hash);
+		Hash = HashValue(File.ContentHash, Hash);
+	}
+	return Hash;
+}
+
+uint64_t ShaderCache::HashFile(const std::string& Path, std::unordered_map<std::string, uint64_t>& FileHashes)
+{
+	auto Known = FileHashes.find(Path);
+	if (Known != FileHashes.end()) return Known->second;
+
+	// A missing file hashes to zero, which no stored content hash matches
+	MappedFile File;
+	const uint64_t Hash = File.Open(Path) ? HashBytes(File.GetData(), File.GetSize()) : 0;
+	FileHashes.emplace(Path, Hash);
+	return Hash;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+struct ShaderCompileRequest
+{
+	// UTF-8 path of the main source file
+	std::string Path;
+	std::string EntryPoint;
+	std::string Profile;
+	uint32_t Flags = 0;
+};
+
+struct ShaderCompileResult
+{
+	bool Succeeded = false;
+	std::vector<uint8_t> Bytecode;
+
+	// Every file the compiler read besides the main source, as UTF-8 paths
+	std::vector<std::string> Includes;
+	std::string Messages;
+};
+
+// Called from job system threads, several at once when more than one shader is stale
+using ShaderCompiler = std::function<ShaderCompileResult(const ShaderCompileRequest& Request)>;
+
+struct ShaderBytecode
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
+
+struct ShaderCacheStatistics
+{
+	uint32_t Hits = 0;
+	uint32_t Misses = 0;
+	double ValidateMilliseconds = 0.0;
+	double CompileMilliseconds = 0.0;
+};
+
+// Content addressed store of compiled shaders. An entry is keyed by the request and validated against a hash of
+// its source and every include, so edits anywhere in the include tree force a recompile. Bytecode lives in one
+// pack file that is mapped on load; cache hits point straight into the mapping.
+class ShaderCache
+{
+public:
+	// CompilerIdentity is folded into every key so bytecode from another compiler or version is never reused
+	ShaderCache(std::string PackPath, std::string CompilerIdentity, ShaderCompiler Compiler);
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	// Returns false and starts empty when the pack is missing, from another version or damaged
+	bool Load();
+
+	// Bytecode for each request in order, recompiling stale entries across the job system when one is given.
+	// Throws with the compiler messages if any compile fails. The data stays valid until Save or destruction.
+	std::vector<ShaderBytecode> Resolve(const ShaderCompileRequest* Requests, uint32_t RequestCount, JobSystem* Jobs = nullptr);
+
+	// Rewrites the pack if Resolve compiled anything and maps the new one; entries not requested this run are kept
+	bool Save();
+
+	const ShaderCacheStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	struct Dependency
+	{
+		std::string Path;
+		uint64_t ContentHash;
+	};
+
+	struct Entry
+	{
+		uint64_t ContentKey = 0;
+
+		// The main source first, then its includes
+		std::vector<Dependency> Dependencies;
+
+		const uint8_t* Bytecode = nullptr;
+		size_t BytecodeSize = 0;
+		std::vector<uint8_t> OwnedBytecode;
+	};
+
+	std::string PackPath;
+	std::string CompilerIdentity;
+	ShaderCompiler Compiler;
+
+	MappedFile Pack;
+	std::unordered_map<uint64_t, Entry> Entries;
+	bool Dirty = false;
+	ShaderCacheStatistics Statistics;
+
+	uint64_t GetRequestKey(const ShaderCompileRequest& Request) const;
+	static uint64_t GetContentKey(uint64_t RequestKey, const std::vector<Dependency>& Dependencies);
+	static uint64_t HashFile(const std::string& Path, std::unordered_map<std::string, uint64_t>& FileHashes);
+};
@@ -0,0 +1,91 @@
+#include "ShaderHotReloader.h"
+
+#include <stdexcept>
+
+ShaderHotReloader::ShaderHotReloader(const std::string& Directory, ShaderCache& Cache, JobSystem* Jobs, ErrorCallback OnError) :
+	Watcher(Directory),
+	Cache(Cache),
+	Jobs(Jobs),
+	OnError(std::move(OnError))
+{
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+	Stop();
+}
+
+void ShaderHotReloader::AddProgram(ShaderProgram Program)
+{
+	if (Thread.joinable()) throw std::runtime_error("Shader programs must be added before the reloader starts");
+	Programs.push_back(std::move(Program));
+}
+
+void ShaderHotReloader::Start()
+{
+	if (Thread.joinable()) return;
+	Thread = std::thread(&ShaderHotReloader::ReloaderMain, this);
+}
+
+void ShaderHotReloader::Stop()
+{
+	if (!Thread.joinable()) return;
+	Watcher.Cancel();
+	Thread.join();
+}
+
+ShaderReloadStatistics ShaderHotReloader::GetStatistics() const
+{
+	ShaderReloadStatistics Statistics;
+	Statistics.Checks = Checks.load(std::memory_order_relaxed);
+	Statistics.Reloads = Reloads.load(std::memory_order_relaxed);
+	Statistics.Failures = Failures.load(std::memory_order_relaxed);
+	return Statistics;
+}
+
+void ShaderHotReloader::ReloaderMain()
+{
+	while (Watcher.Wait() == FileWatchResult::Changed)
+	{
+		FileWatchResult Result;
+		do
+		{
+			Result = Watcher.Wait(SettleMilliseconds);
+		} while (Result == FileWatchResult::Changed);
+		if (Result == FileWatchResult::Cancelled) return;
+
+		ReloadChangedPrograms();
+	}
+}
+
+void ShaderHotReloader::ReloadChangedPrograms()
+{
+	Checks.fetch_add(1, std::memory_order_relaxed);
+
+	// The cache validates every dependency by content, so a program only counts as changed when it had to compile
+	bool Compiled = false;
+	for (ShaderProgram& Program : Programs)
+	{
+		try
+		{
+			const uint32_t MissesBefore = Cache.GetStatistics().Misses;
+			const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Program.Requests.data(), static_cast<uint32_t>(Program.Requests.size()), Jobs);
+			if (Cache.GetStatistics().Misses == MissesBefore) continue;
+
+			Compiled = true;
+			Program.Rebuild(Bytecode);
+			Reloads.fetch_add(1, std::memory_order_relaxed);
+		}
+		catch (const std::exception& Error)
+		{
+			Failures.fetch_add(1, std::memory_order_relaxed);
+			if (OnError) OnError(Error.what());
+		}
+	}
+
+	// Saving remaps the pack, which is safe now that no bytecode from this pass is referenced any more
+	if (Compiled)
+	{
+		Cache.Save();
+	}
+}
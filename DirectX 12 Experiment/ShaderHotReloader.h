@@ -0,0 +1,66 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "ShaderCache.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ShaderProgram
+{
+	std::vector<ShaderCompileRequest> Requests;
+
+	// Runs on the reloader thread with bytecode in request order, which is only valid during the call
+	std::function<void(const std::vector<ShaderBytecode>& Bytecode)> Rebuild;
+};
+
+struct ShaderReloadStatistics
+{
+	uint32_t Checks = 0;
+	uint32_t Reloads = 0;
+	uint32_t Failures = 0;
+};
+
+// Watches the shader directory on a thread of its own. Whenever something in it changes, every program is
+// resolved through the shader cache again, and programs whose sources or includes really changed are handed
+// to their rebuild callback. While no file changes it costs the rest of the engine nothing.
+class ShaderHotReloader
+{
+public:
+	// Called on the reloader thread with the compiler messages; the program keeps its previous bytecode
+	using ErrorCallback = std::function<void(const std::string& Messages)>;
+
+	// The cache is used only by the reloader thread from Start until Stop
+	ShaderHotReloader(const std::string& Directory, ShaderCache& Cache, JobSystem* Jobs, ErrorCallback OnError);
+	~ShaderHotReloader();
+
+	ShaderHotReloader(const ShaderHotReloader&) = delete;
+	ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+	// Programs are added before Start
+	void AddProgram(ShaderProgram Program);
+	void Start();
+	void Stop();
+
+	ShaderReloadStatistics GetStatistics() const;
+
+private:
+	// Editors often save in several steps, so the directory has to stay quiet this long before it is looked at
+	static const uint32_t SettleMilliseconds = 50;
+
+	FileWatcher Watcher;
+	ShaderCache& Cache;
+	JobSystem* Jobs;
+	ErrorCallback OnError;
+	std::vector<ShaderProgram> Programs;
+	std::thread Thread;
+
+	std::atomic<uint32_t> Checks{ 0 };
+	std::atomic<uint32_t> Reloads{ 0 };
+	std::atomic<uint32_t> Failures{ 0 };
+
+	void ReloaderMain();
+	void ReloadChangedPrograms();
+};
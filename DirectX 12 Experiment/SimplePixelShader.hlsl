@@ -2,12 +2,28 @@ struct PixelInput
 {
 	float4 Position : SV_POSITION;
 	float2 UV : TEXCOORD;
+	nointerpolation uint MaterialId : MATERIAL;
 };
 
-Texture2D Texture : register(t0);
+// Index of this draw's texture in the bindless heap
+cbuffer DrawConstants : register(b0)
+{
+	uint TextureIndex;
+};
+
+Texture2D Textures[] : register(t0, space1);
 SamplerState Sampler : register(s0);
 
+// Materials only tint the shared texture for now
+static const float4 MaterialTints[4] =
+{
+	float4(1.0f, 1.0f, 1.0f, 1.0f),
+	float4(1.0f, 0.6f, 0.6f, 1.0f),
+	float4(0.6f, 1.0f, 0.6f, 1.0f),
+	float4(0.6f, 0.6f, 1.0f, 1.0f)
+};
+
 float4 Main(PixelInput Input) : SV_TARGET
 {
-	return Texture.Sample(Sampler, Input.UV);
+	return Textures[TextureIndex].Sample(Sampler, Input.UV) * MaterialTints[Input.MaterialId % 4];
 }
\ No newline at end of file
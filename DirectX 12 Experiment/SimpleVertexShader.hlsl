@@ -8,12 +8,39 @@ struct VertexOutput
 {
 	float4 Position : SV_POSITION;
 	float2 UV : TEXCOORD;
+	nointerpolation uint MaterialId : MATERIAL;
 };
 
-VertexOutput Main(VertexInput Input)
+// First instance of this draw, the number of entries in each instance stream and the output's width over its height
+cbuffer InstanceConstants : register(b1)
 {
+	uint FirstInstance;
+	uint InstanceCount;
+	float AspectRatio;
+};
+
+// Three float4 transform row streams followed by the material ids
+ByteAddressBuffer Instances : register(t0);
+
+VertexOutput Main(VertexInput Input, uint InstanceId : SV_InstanceID)
+{
+	// Vertices are given for a square output, stretching y keeps their proportions on any other
+	const float4 Local = float4(Input.Position.x, Input.Position.y * AspectRatio, Input.Position.z, 1.0f);
+
 	VertexOutput Output;
-	Output.Position = Input.Position;
+	Output.Position = Local;
 	Output.UV = Input.UV;
+	Output.MaterialId = 0;
+
+	// Vertices are drawn as they are until instances are uploaded for the frame
+	if (InstanceCount != 0)
+	{
+		const uint Instance = FirstInstance + InstanceId;
+		const float4 Row0 = asfloat(Instances.Load4(16 * Instance));
+		const float4 Row1 = asfloat(Instances.Load4(16 * (InstanceCount + Instance)));
+		const float4 Row2 = asfloat(Instances.Load4(16 * (2 * InstanceCount + Instance)));
+		Output.Position = float4(dot(Row0, Local), dot(Row1, Local), dot(Row2, Local), 1.0f);
+		Output.MaterialId = Instances.Load(48 * InstanceCount + 4 * Instance);
+	}
 	return Output;
 }
\ No newline at end of file
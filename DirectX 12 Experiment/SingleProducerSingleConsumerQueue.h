@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free ring buffer: exactly one thread may push and exactly one thread may pop
+template <typename T>
+class SingleProducerSingleConsumerQueue
+{
+public:
+	explicit SingleProducerSingleConsumerQueue(size_t MinimumCapacity)
+	{
+		size_t Capacity = 2;
+		while (Capacity < MinimumCapacity) Capacity *= 2;
+		Slots.resize(Capacity);
+		Mask = Capacity - 1;
+	}
+
+	SingleProducerSingleConsumerQueue(const SingleProducerSingleConsumerQueue&) = delete;
+	SingleProducerSingleConsumerQueue& operator=(const SingleProducerSingleConsumerQueue&) = delete;
+
+	// Producer only, returns false if the queue is full
+	bool TryPush(const T& Value)
+	{
+		const size_t Tail = WriteIndex.load(std::memory_order_relaxed);
+		if (Tail - CachedReadIndex > Mask)
+		{
+			CachedReadIndex = ReadIndex.load(std::memory_order_acquire);
+			if (Tail - CachedReadIndex > Mask) return false;
+		}
+
+		Slots[Tail & Mask] = Value;
+		WriteIndex.store(Tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, returns false if the queue is empty
+	bool TryPop(T& Value)
+	{
+		const size_t Head = ReadIndex.load(std::memory_order_relaxed);
+		if (Head == CachedWriteIndex)
+		{
+			CachedWriteIndex = WriteIndex.load(std::memory_order_acquire);
+			if (Head == CachedWriteIndex) return false;
+		}
+
+		Value = Slots[Head & Mask];
+		ReadIndex.store(Head + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t GetCapacity() const { return Slots.size(); }
+
+private:
+	std::vector<T> Slots;
+	size_t Mask = 0;
+
+	// Producer and consumer indices are padded onto separate cache lines, each next to its cached copy of the other.
+	// Padding rather than alignas keeps heap allocation of the queue valid without C++17 aligned new.
+	char ProducerPadding[64];
+	std::atomic<size_t> WriteIndex{ 0 };
+	size_t CachedReadIndex = 0;
+	char ConsumerPadding[64];
+	std::atomic<size_t> ReadIndex{ 0 };
+	size_t CachedWriteIndex = 0;
+	char TrailingPadding[64];
+};
@@ -0,0 +1,332 @@
+#include "AssetArchive.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+static std::string GetArchivePath(const char* Name)
+{
+	return GetTestTemporaryDirectory() + "AssetArchiveTests" + Name + ".pak";
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& Path)
+{
+	MappedFile File;
+	REQUIRE(File.Open(Path));
+	return std::vector<uint8_t>(File.GetData(), File.GetData() + File.GetSize());
+}
+
+static void WriteFile(const std::string& Path, const std::vector<uint8_t>& Data)
+{
+	REQUIRE(WriteFileAtomically(Path, Data.data(), Data.size()));
+}
+
+// Compressible blob: a counter with every seventh stretch of thirteen bytes random
+static std::vector<uint8_t> CreateBlob(size_t Size)
+{
+	std::mt19937 Random(1);
+	std::vector<uint8_t> Blob(Size);
+	for (size_t Index = 0; Index < Size; Index++)
+	{
+		Blob[Index] = (Index / 7) % 13 == 0 ? static_cast<uint8_t>(Random()) : static_cast<uint8_t>(Index >> 5);
+	}
+	return Blob;
+}
+
+struct TextureChain
+{
+	TextureFormat Format;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipLevelCount;
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	std::vector<uint8_t> Data;
+
+	// Laid out the way the archive stores it, mostly zero so it compresses
+	TextureChain(TextureFormat Format, uint32_t Width, uint32_t Height) :
+		Format(Format),
+		Width(Width),
+		Height(Height),
+		MipLevelCount(GetFullMipLevelCount(Width, Height))
+	{
+		Data.resize(static_cast<size_t>(GetTextureLevelLayouts(Format, Width, Height, MipLevelCount, AssetArchiveRowAlignment, AssetArchiveLevelAlignment, Levels)));
+		std::mt19937 Random(Width * Height);
+		for (uint8_t& Byte : Data)
+		{
+			Byte = Random() % 4 == 0 ? static_cast<uint8_t>(Random()) : 0;
+		}
+	}
+
+	TextureStreamStaging CreateStaging(uint32_t RowAlignment, uint32_t LevelAlignment, std::vector<uint8_t>& Pixels) const
+	{
+		TextureStreamStaging Staging;
+		Staging.Format = Format;
+		Staging.Width = Width;
+		Staging.Height = Height;
+		Staging.MipLevelCount = MipLevelCount;
+		Pixels.assign(static_cast<size_t>(GetTextureLevelLayouts(Format, Width, Height, MipLevelCount, RowAlignment, LevelAlignment, Staging.Levels)), 0);
+		Staging.Pixels = Pixels.data();
+		Staging.RowPitch = Staging.Levels[0].RowPitch;
+		return Staging;
+	}
+
+	// Every row of every level landed where the staging layout puts it
+	bool Matches(const TextureStreamStaging& Staging) const
+	{
+		const bool Compressed = Format != TextureFormat::Rgba8;
+		for (uint32_t Level = 0; Level < MipLevelCount; Level++)
+		{
+			const uint32_t RowCount = Compressed ? (Levels[Level].Height + 3) / 4 : Levels[Level].Height;
+			const uint32_t RowBytes = Compressed ? (Levels[Level].Width + 3) / 4 * (Format == TextureFormat::Bc1 ? 8 : 16) : Levels[Level].Width * 4;
+			for (uint32_t Row = 0; Row < RowCount; Row++)
+			{
+				if (memcmp(Staging.Pixels + Staging.Levels[Level].Offset + static_cast<size_t>(Row) * Staging.Levels[Level].RowPitch,
+					Data.data() + Levels[Level].Offset + static_cast<size_t>(Row) * Levels[Level].RowPitch, RowBytes) != 0) return false;
+			}
+		}
+		return true;
+	}
+};
+
+TEST_CASE(BlobsRoundTrip)
+{
+	JobSystem Jobs(2);
+	const std::vector<uint8_t> Blob = CreateBlob(1000003);
+	for (ArchiveCompression Compression : { ArchiveCompression::None, ArchiveCompression::Lz4 })
+	{
+		for (uint32_t ChunkSize : { 4096u, 65536u, 1u << 20 })
+		{
+			AssetArchiveWriter Writer(Compression, ChunkSize, &Jobs);
+			Writer.AddBlob("Blob", Blob.data(), Blob.size());
+			Writer.AddBlob("Empty", nullptr, 0);
+			for (uint32_t Index = 0; Index < 100; Index++)
+			{
+				const std::vector<uint8_t> Small(Index * 37, static_cast<uint8_t>(Index));
+				Writer.AddBlob("Small/" + std::to_string(Index), Small.data(), Small.size());
+			}
+			CHECK_THROWS(Writer.AddBlob("Blob", Blob.data(), 1));
+
+			const std::string Path = GetArchivePath("Blobs");
+			REQUIRE(Writer.Write(Path));
+			CHECK(ReadFile(Path).size() == Writer.GetFileSize());
+			if (Compression == ArchiveCompression::Lz4) CHECK(Writer.GetFileSize() < Writer.GetDataSize());
+
+			AssetArchive Archive;
+			REQUIRE(Archive.Open(Path));
+			CHECK(Archive.GetEntryCount() == 102);
+			CHECK(Archive.Find("Missing") == nullptr && Archive.Find("Blo") == nullptr && Archive.Find("") == nullptr);
+
+			for (uint32_t Index = 0; Index < 100; Index++)
+			{
+				const std::string Name = "Small/" + std::to_string(Index);
+				const AssetArchiveEntry* Entry = Archive.Find(Name);
+				REQUIRE(Entry != nullptr);
+				CHECK(Entry->Size == Index * 37 && !Entry->IsTexture() && Archive.GetName(*Entry) == Name);
+				CHECK(Entry->Offset % AssetArchiveDataAlignment == 0);
+
+				std::vector<uint8_t> Read(static_cast<size_t>(Entry->Size) + 1, 0xCC);
+				CHECK(Archive.Read(*Entry, Read.data()));
+				CHECK(std::count(Read.begin(), Read.end() - 1, static_cast<uint8_t>(Index)) == static_cast<ptrdiff_t>(Entry->Size) && Read.back() == 0xCC);
+			}
+
+			const AssetArchiveEntry* Entry = Archive.Find("Blob");
+			REQUIRE(Entry != nullptr);
+			std::vector<uint8_t> Read(Blob.size());
+			CHECK(Archive.Read(*Entry, Read.data(), &Jobs) && Read == Blob);
+			std::fill(Read.begin(), Read.end(), 0);
+			CHECK(Archive.Read(*Entry, Read.data()) && Read == Blob);
+
+			// Uncompressed entries are read straight from the mapping
+			if (Compression == ArchiveCompression::None) CHECK(memcmp(Archive.GetStoredData(*Entry), Blob.data(), Blob.size()) == 0);
+
+			const AssetArchiveEntry* Empty = Archive.Find("Empty");
+			CHECK(Empty != nullptr && Empty->Size == 0 && Archive.Read(*Empty, Read.data()));
+		}
+	}
+}
+
+TEST_CASE(TexturesFillAnyStagingLayout)
+{
+	JobSystem Jobs(2);
+	const TextureChain Rgba(TextureFormat::Rgba8, 300, 77);
+	const TextureChain Bc1(TextureFormat::Bc1, 300, 77);
+	AssetArchiveWriter Writer(ArchiveCompression::Lz4, 16384);
+	Writer.AddTexture("Rgba", Rgba.Format, Rgba.Width, Rgba.Height, Rgba.MipLevelCount, Rgba.Data.data());
+	Writer.AddTexture("Bc1", Bc1.Format, Bc1.Width, Bc1.Height, Bc1.MipLevelCount, Bc1.Data.data());
+	const std::string Path = GetArchivePath("Textures");
+	REQUIRE(Writer.Write(Path));
+
+	AssetArchive Archive;
+	REQUIRE(Archive.Open(Path));
+	const AssetArchiveEntry* RgbaEntry = Archive.Find("Rgba");
+	const AssetArchiveEntry* Bc1Entry = Archive.Find("Bc1");
+	REQUIRE(RgbaEntry != nullptr && Bc1Entry != nullptr);
+	CHECK(RgbaEntry->IsTexture() && RgbaEntry->Width == 300 && RgbaEntry->Height == 77 && RgbaEntry->MipLevelCount == Rgba.MipLevelCount);
+
+	// D3D12's own footprint takes the chain in one copy, without the padding after the last row
+	std::vector<uint8_t> Pixels;
+	TextureStreamStaging Staging = Rgba.CreateStaging(AssetArchiveRowAlignment, AssetArchiveLevelAlignment, Pixels);
+	Pixels.resize(static_cast<size_t>(RgbaEntry->Size));
+	CHECK(RgbaEntry->Size < Rgba.Data.size());
+	CHECK(Archive.ReadTexture(*RgbaEntry, Staging, &Jobs));
+	CHECK(memcmp(Pixels.data(), Rgba.Data.data(), Pixels.size()) == 0);
+
+	// Tightly packed rows are copied row by row
+	std::vector<uint8_t> TightPixels;
+	const TextureStreamStaging Tight = Rgba.CreateStaging(4, 16, TightPixels);
+	CHECK(Archive.ReadTexture(*RgbaEntry, Tight));
+	CHECK(Rgba.Matches(Tight));
+
+	std::vector<uint8_t> BlockPixels;
+	TextureStreamStaging Blocks = Bc1.CreateStaging(8, 8, BlockPixels);
+	CHECK(Archive.ReadTexture(*Bc1Entry, Blocks));
+	CHECK(Bc1.Matches(Blocks));
+
+	// Staging for something else is refused
+	Blocks.Format = TextureFormat::Bc3;
+	CHECK(!Archive.ReadTexture(*Bc1Entry, Blocks));
+	Staging.MipLevelCount--;
+	CHECK(!Archive.ReadTexture(*RgbaEntry, Staging));
+	Staging.MipLevelCount++;
+	Staging.Width++;
+	CHECK(!Archive.ReadTexture(*RgbaEntry, Staging));
+}
+
+TEST_CASE(DamagedFilesAreRejectedAtOpen)
+{
+	AssetArchive Archive;
+	CHECK(!Archive.Open(GetArchivePath("Missing")));
+	const std::string Path = GetArchivePath("Damaged");
+	WriteFile(Path, std::vector<uint8_t>());
+	CHECK(!Archive.Open(Path));
+
+	AssetArchiveWriter EmptyWriter;
+	REQUIRE(EmptyWriter.Write(Path));
+	REQUIRE(Archive.Open(Path));
+	CHECK(Archive.GetEntryCount() == 0 && Archive.Find("Anything") == nullptr);
+	Archive.Close();
+
+	const std::vector<uint8_t> Blob = CreateBlob(100000);
+	AssetArchiveWriter Writer(ArchiveCompression::Lz4, 4096);
+	Writer.AddBlob("Blob", Blob.data(), Blob.size());
+	REQUIRE(Writer.Write(Path));
+	const std::vector<uint8_t> Good = ReadFile(Path);
+
+	// Cut short anywhere, the recorded file size no longer matches
+	for (size_t Size : { static_cast<size_t>(0), static_cast<size_t>(16), Good.size() / 2, Good.size() - 1 })
+	{
+		WriteFile(Path, std::vector<uint8_t>(Good.begin(), Good.begin() + Size));
+		CHECK(!Archive.Open(Path));
+	}
+
+	// Another magic or version
+	for (size_t Byte : { static_cast<size_t>(0), static_cast<size_t>(4) })
+	{
+		std::vector<uint8_t> Damaged = Good;
+		Damaged[Byte] ^= 0x01;
+		WriteFile(Path, Damaged);
+		CHECK(!Archive.Open(Path));
+	}
+}
+
+// Chunks that are damaged or cut short open fine, since only their offsets are checked up front, and fail to read
+TEST_CASE(DamagedChunksFailToRead)
+{
+	const std::vector<uint8_t> Blob = CreateBlob(100000);
+	AssetArchiveWriter Writer(ArchiveCompression::Lz4, 4096);
+	Writer.AddBlob("Blob", Blob.data(), Blob.size());
+	const std::string Path = GetArchivePath("Chunks");
+	REQUIRE(Writer.Write(Path));
+	const std::vector<uint8_t> Good = ReadFile(Path);
+
+	uint64_t EntryOffset = 0;
+	uint64_t ChunkOffsets[3];
+	{
+		AssetArchive Archive;
+		REQUIRE(Archive.Open(Path));
+		const AssetArchiveEntry* Entry = Archive.Find("Blob");
+		REQUIRE(Entry != nullptr && Entry->ChunkCount > 2);
+		EntryOffset = Entry->Offset;
+		memcpy(ChunkOffsets, Archive.GetStoredData(*Entry), sizeof(ChunkOffsets));
+	}
+	REQUIRE(ChunkOffsets[1] - ChunkOffsets[0] < 4096);
+
+	auto OpensButFailsToRead = [&Path, &Blob](const std::vector<uint8_t>& Damaged)
+	{
+		WriteFile(Path, Damaged);
+		AssetArchive Archive;
+		REQUIRE(Archive.Open(Path));
+		const AssetArchiveEntry* Entry = Archive.Find("Blob");
+		REQUIRE(Entry != nullptr);
+		std::vector<uint8_t> Read(Blob.size());
+		return !Archive.Read(*Entry, Read.data());
+	};
+
+	// The first chunk ends early and the second starts with its tail
+	std::vector<uint8_t> Truncated = Good;
+	const uint64_t ShorterEnd = ChunkOffsets[1] - 5;
+	memcpy(&Truncated[static_cast<size_t>(EntryOffset + sizeof(uint64_t))], &ShorterEnd, sizeof(ShorterEnd));
+	CHECK(OpensButFailsToRead(Truncated));
+
+	// The first chunk's data overwritten with tokens asking for more literals than remain
+	std::vector<uint8_t> Overwritten = Good;
+	std::fill(Overwritten.begin() + static_cast<ptrdiff_t>(EntryOffset + ChunkOffsets[0]), Overwritten.begin() + static_cast<ptrdiff_t>(EntryOffset + ChunkOffsets[1]), 0xFF);
+	CHECK(OpensButFailsToRead(Overwritten));
+
+	// Offsets running backwards or past the entry are caught at open
+	std::vector<uint8_t> Backwards = Good;
+	const uint64_t BeforeStart = ChunkOffsets[0] - 1;
+	memcpy(&Backwards[static_cast<size_t>(EntryOffset + sizeof(uint64_t))], &BeforeStart, sizeof(BeforeStart));
+	WriteFile(Path, Backwards);
+	AssetArchive Archive;
+	CHECK(!Archive.Open(Path));
+}
+
+// Random damage to the tables and the first chunks never takes a read outside the mapping
+TEST_CASE(RandomDamageIsSafe)
+{
+	const TextureChain Rgba(TextureFormat::Rgba8, 64, 48);
+	const std::vector<uint8_t> Blob = CreateBlob(20000);
+	AssetArchiveWriter Writer(ArchiveCompression::Lz4, 4096);
+	Writer.AddTexture("Texture", Rgba.Format, Rgba.Width, Rgba.Height, Rgba.MipLevelCount, Rgba.Data.data());
+	Writer.AddBlob("Blob", Blob.data(), Blob.size());
+	const std::string Path = GetArchivePath("Random");
+	REQUIRE(Writer.Write(Path));
+	const std::vector<uint8_t> Good = ReadFile(Path);
+
+	std::mt19937 Random(9);
+	uint32_t Opened = 0;
+	uint32_t Rejected = 0;
+	for (uint32_t Attempt = 0; Attempt < 300; Attempt++)
+	{
+		std::vector<uint8_t> Damaged = Good;
+		const uint32_t FlipCount = 1 + Random() % 4;
+		for (uint32_t Flip = 0; Flip < FlipCount; Flip++)
+		{
+			const size_t Byte = Random() % 3 != 0 ? Random() % std::min<size_t>(Damaged.size(), 3 * AssetArchiveDataAlignment) : Random() % Damaged.size();
+			Damaged[Byte] ^= static_cast<uint8_t>(1u << (Random() % 8));
+		}
+		WriteFile(Path, Damaged);
+
+		AssetArchive Archive;
+		if (!Archive.Open(Path))
+		{
+			Rejected++;
+			continue;
+		}
+		Opened++;
+		for (uint32_t Index = 0; Index < Archive.GetEntryCount(); Index++)
+		{
+			const AssetArchiveEntry& Entry = Archive.GetEntry(Index);
+			if (Entry.Size > (64u << 20)) continue;
+			std::vector<uint8_t> Read(static_cast<size_t>(Entry.Size));
+			Archive.Read(Entry, Read.data());
+		}
+		Archive.Find("Texture");
+		Archive.Find("Blob");
+	}
+	CHECK(Opened > 0 && Rejected > 0);
+}
@@ -0,0 +1,292 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "ProceduralTexture.h"
+#include "TestFramework.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static void ExpandColor565(uint16_t Packed, int32_t* Color)
+{
+	const int32_t Red = Packed >> 11, Green = (Packed >> 5) & 63, Blue = Packed & 31;
+	Color[0] = (Red << 3) | (Red >> 2);
+	Color[1] = (Green << 2) | (Green >> 4);
+	Color[2] = (Blue << 3) | (Blue >> 2);
+}
+
+// Decoders written from the format specifications, independent of the encoder. Output is 16 RGBA8 texels.
+static void DecodeColorBlock(const uint8_t* Block, bool AlwaysFourColors, uint8_t* Texels)
+{
+	const uint16_t Color0 = static_cast<uint16_t>(Block[0] | Block[1] << 8);
+	const uint16_t Color1 = static_cast<uint16_t>(Block[2] | Block[3] << 8);
+	int32_t Palette[4][3];
+	ExpandColor565(Color0, Palette[0]);
+	ExpandColor565(Color1, Palette[1]);
+	const bool FourColors = AlwaysFourColors || Color0 > Color1;
+	for (uint32_t Channel = 0; Channel < 3; Channel++)
+	{
+		Palette[2][Channel] = FourColors ? (2 * Palette[0][Channel] + Palette[1][Channel]) / 3 : (Palette[0][Channel] + Palette[1][Channel]) / 2;
+		Palette[3][Channel] = FourColors ? (Palette[0][Channel] + 2 * Palette[1][Channel]) / 3 : 0;
+	}
+
+	const uint32_t Indices = Block[4] | Block[5] << 8 | Block[6] << 16 | static_cast<uint32_t>(Block[7]) << 24;
+	for (uint32_t Texel = 0; Texel < 16; Texel++)
+	{
+		const int32_t* Color = Palette[(Indices >> (2 * Texel)) & 3];
+		Texels[4 * Texel + 0] = static_cast<uint8_t>(Color[0]);
+		Texels[4 * Texel + 1] = static_cast<uint8_t>(Color[1]);
+		Texels[4 * Texel + 2] = static_cast<uint8_t>(Color[2]);
+		Texels[4 * Texel + 3] = 255;
+	}
+}
+
+static void DecodeAlphaBlock(const uint8_t* Block, uint8_t* Texels)
+{
+	int32_t Palette[8] = { Block[0], Block[1] };
+	if (Palette[0] > Palette[1])
+	{
+		for (int32_t Step = 1; Step < 7; Step++) Palette[Step + 1] = ((7 - Step) * Palette[0] + Step * Palette[1]) / 7;
+	}
+	else
+	{
+		for (int32_t Step = 1; Step < 5; Step++) Palette[Step + 1] = ((5 - Step) * Palette[0] + Step * Palette[1]) / 5;
+		Palette[6] = 0;
+		Palette[7] = 255;
+	}
+
+	uint64_t Indices = 0;
+	for (uint32_t Byte = 0; Byte < 6; Byte++)
+	{
+		Indices |= static_cast<uint64_t>(Block[2 + Byte]) << (8 * Byte);
+	}
+	for (uint32_t Texel = 0; Texel < 16; Texel++)
+	{
+		Texels[4 * Texel + 3] = static_cast<uint8_t>(Palette[(Indices >> (3 * Texel)) & 7]);
+	}
+}
+
+static uint32_t ReadBits(const uint8_t* Block, uint32_t& Position, uint32_t Count)
+{
+	uint32_t Value = 0;
+	for (uint32_t Bit = 0; Bit < Count; Bit++, Position++)
+	{
+		Value |= ((Block[Position >> 3] >> (Position & 7)) & 1u) << Bit;
+	}
+	return Value;
+}
+
+// Only mode 6 is decoded, the one mode the encoder writes
+static bool DecodeBc7Block(const uint8_t* Block, uint8_t* Texels)
+{
+	static const int32_t Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	uint32_t Position = 0;
+	if (ReadBits(Block, Position, 7) != 64) return false;
+
+	int32_t Endpoints[2][4];
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Endpoints[0][Channel] = static_cast<int32_t>(ReadBits(Block, Position, 7));
+		Endpoints[1][Channel] = static_cast<int32_t>(ReadBits(Block, Position, 7));
+	}
+	const uint32_t Parity0 = ReadBits(Block, Position, 1), Parity1 = ReadBits(Block, Position, 1);
+	for (uint32_t Channel = 0; Channel < 4; Channel++)
+	{
+		Endpoints[0][Channel] = Endpoints[0][Channel] * 2 + static_cast<int32_t>(Parity0);
+		Endpoints[1][Channel] = Endpoints[1][Channel] * 2 + static_cast<int32_t>(Parity1);
+	}
+
+	// The anchor index drops its top bit
+	for (uint32_t Texel = 0; Texel < 16; Texel++)
+	{
+		const uint32_t Index = ReadBits(Block, Position, Texel == 0 ? 3 : 4);
+		for (uint32_t Channel = 0; Channel < 4; Channel++)
+		{
+			Texels[4 * Texel + Channel] = static_cast<uint8_t>(((64 - Weights[Index]) * Endpoints[0][Channel] + Weights[Index] * Endpoints[1][Channel] + 32) >> 6);
+		}
+	}
+	return Position == 128;
+}
+
+struct Image
+{
+	uint32_t Width;
+	uint32_t Height;
+	std::vector<uint8_t> Pixels;
+};
+
+// Decodes Blocks and compares against the source, over RGB only for BC1 which stores no alpha
+static double GetPsnr(TextureFormat Format, const Image& Source, const std::vector<uint8_t>& Blocks, const TextureLevelLayout& BlockLayout)
+{
+	const uint32_t ChannelCount = Format == TextureFormat::Bc1 ? 3 : 4;
+	double SquaredError = 0.0;
+	for (uint32_t BlockY = 0; BlockY < (Source.Height + 3) / 4; BlockY++)
+	{
+		for (uint32_t BlockX = 0; BlockX < (Source.Width + 3) / 4; BlockX++)
+		{
+			const uint8_t* Block = &Blocks[static_cast<size_t>(BlockY) * BlockLayout.RowPitch + BlockX * GetFormatElementBytes(Format)];
+			uint8_t Texels[64];
+			if (Format == TextureFormat::Bc1)
+			{
+				DecodeColorBlock(Block, false, Texels);
+			}
+			else if (Format == TextureFormat::Bc3)
+			{
+				DecodeColorBlock(Block + 8, true, Texels);
+				DecodeAlphaBlock(Block, Texels);
+			}
+			else if (!DecodeBc7Block(Block, Texels))
+			{
+				return 0.0;
+			}
+
+			for (uint32_t Y = 0; Y < 4; Y++)
+			{
+				for (uint32_t X = 0; X < 4; X++)
+				{
+					const uint32_t ImageX = 4 * BlockX + X, ImageY = 4 * BlockY + Y;
+					if (ImageX >= Source.Width || ImageY >= Source.Height) continue;
+					for (uint32_t Channel = 0; Channel < ChannelCount; Channel++)
+					{
+						const double Difference = static_cast<double>(Texels[4 * (4 * Y + X) + Channel]) - Source.Pixels[(static_cast<size_t>(ImageY) * Source.Width + ImageX) * 4 + Channel];
+						SquaredError += Difference * Difference;
+					}
+				}
+			}
+		}
+	}
+	const double MeanSquaredError = SquaredError / (static_cast<double>(Source.Width) * Source.Height * ChannelCount);
+	return MeanSquaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / MeanSquaredError);
+}
+
+static Image CreateImage(ProceduralPattern Pattern, uint32_t Width, uint32_t Height)
+{
+	Image Result = { Width, Height, std::vector<uint8_t>(4 * static_cast<size_t>(Width) * Height) };
+	ProceduralTextureDescription Description;
+	Description.Pattern = Pattern;
+	Description.Width = Width;
+	Description.Height = Height;
+	Description.CellSize = 32;
+	GenerateProceduralTexture(Description, Result.Pixels.data(), 4 * Width);
+
+	// Noise gets a varying alpha channel so BC3 and BC7 have alpha to encode
+	if (Pattern == ProceduralPattern::Noise)
+	{
+		for (size_t Texel = 0; Texel < Result.Pixels.size() / 4; Texel++)
+		{
+			Result.Pixels[4 * Texel + 3] = Result.Pixels[4 * Texel + 1];
+		}
+	}
+	return Result;
+}
+
+static std::vector<uint8_t> Compress(TextureFormat Format, const Image& Source, TextureLevelLayout& BlockLayout, InstructionSet Instructions = InstructionSet::Avx2, JobSystem* Jobs = nullptr)
+{
+	TextureLevelLayout PixelLayout;
+	PixelLayout.Width = Source.Width;
+	PixelLayout.Height = Source.Height;
+	PixelLayout.RowPitch = 4 * Source.Width;
+	std::vector<uint8_t> Blocks(GetTextureLevelLayouts(Format, Source.Width, Source.Height, 1, 256, 512, &BlockLayout));
+
+	BlockCompressionOptions Options;
+	Options.MaximumInstructionSet = Instructions;
+	CompressTexture(Format, Source.Pixels.data(), &PixelLayout, Blocks.data(), &BlockLayout, 1, Options, Jobs);
+	return Blocks;
+}
+
+struct QualityFloor
+{
+	ProceduralPattern Pattern;
+	TextureFormat Format;
+	double MinimumPsnr;
+};
+
+// Floors sit a couple of decibels under what the encoder reaches, so quality regressions fail while small changes pass
+TEST_CASE(CompressedPatternsStayAboveTheirQualityFloors)
+{
+	const QualityFloor Floors[] =
+	{
+		{ ProceduralPattern::Checker, TextureFormat::Bc1, 99.0 },
+		{ ProceduralPattern::Checker, TextureFormat::Bc3, 99.0 },
+		{ ProceduralPattern::Checker, TextureFormat::Bc7, 55.0 },
+		{ ProceduralPattern::Gradient, TextureFormat::Bc1, 41.0 },
+		{ ProceduralPattern::Gradient, TextureFormat::Bc3, 42.0 },
+		{ ProceduralPattern::Gradient, TextureFormat::Bc7, 60.0 },
+		{ ProceduralPattern::Noise, TextureFormat::Bc1, 41.0 },
+		{ ProceduralPattern::Noise, TextureFormat::Bc3, 36.0 },
+		{ ProceduralPattern::Noise, TextureFormat::Bc7, 34.0 },
+		{ ProceduralPattern::Tiles, TextureFormat::Bc1, 29.0 },
+		{ ProceduralPattern::Tiles, TextureFormat::Bc3, 30.0 },
+		{ ProceduralPattern::Tiles, TextureFormat::Bc7, 60.0 }
+	};
+	for (const QualityFloor& Floor : Floors)
+	{
+		const Image Source = CreateImage(Floor.Pattern, 256, 256);
+		TextureLevelLayout BlockLayout;
+		const std::vector<uint8_t> Blocks = Compress(Floor.Format, Source, BlockLayout);
+		const double Psnr = GetPsnr(Floor.Format, Source, Blocks, BlockLayout);
+		if (Psnr < Floor.MinimumPsnr)
+		{
+			fprintf(stderr, "pattern %d format %d: %.2f dB, floor %.2f dB\n", static_cast<int>(Floor.Pattern), static_cast<int>(Floor.Format), Psnr, Floor.MinimumPsnr);
+		}
+		CHECK(Psnr >= Floor.MinimumPsnr);
+	}
+}
+
+// A solid color exact in 565 survives BC1 and BC3 bit for bit, including blocks that overhang the edge of odd sized
+// images. BC7 shares one parity bit across the channels of an endpoint, so 0 and 255 together land a step off.
+TEST_CASE(SolidColorsSurviveOddSizes)
+{
+	const uint8_t Color[] = { 255, 0, 255, 255 };
+	for (uint32_t Size : { 1u, 3u, 5u, 13u })
+	{
+		Image Source = { Size, Size + 2, std::vector<uint8_t>() };
+		for (uint32_t Texel = 0; Texel < Source.Width * Source.Height; Texel++)
+		{
+			Source.Pixels.insert(Source.Pixels.end(), Color, Color + 4);
+		}
+		for (TextureFormat Format : { TextureFormat::Bc1, TextureFormat::Bc3, TextureFormat::Bc7 })
+		{
+			TextureLevelLayout BlockLayout;
+			const std::vector<uint8_t> Blocks = Compress(Format, Source, BlockLayout);
+			CHECK(BlockLayout.RowPitch >= (Size + 3) / 4 * GetFormatElementBytes(Format));
+			CHECK(Blocks.size() == static_cast<size_t>(BlockLayout.RowPitch) * ((Size + 5) / 4));
+			CHECK(GetPsnr(Format, Source, Blocks, BlockLayout) >= (Format == TextureFormat::Bc7 ? 50.0 : 99.0));
+		}
+	}
+}
+
+TEST_CASE(InstructionSetsAndJobsEncodeIdenticalBlocks)
+{
+	JobSystem Jobs(3);
+	const Image Source = CreateImage(ProceduralPattern::Noise, 200, 120);
+	for (TextureFormat Format : { TextureFormat::Bc1, TextureFormat::Bc3, TextureFormat::Bc7 })
+	{
+		TextureLevelLayout BlockLayout;
+		const std::vector<uint8_t> Expected = Compress(Format, Source, BlockLayout, InstructionSet::Scalar);
+		for (uint32_t Set = 0; Set <= static_cast<uint32_t>(InstructionSet::Avx2); Set++)
+		{
+			CHECK(Compress(Format, Source, BlockLayout, static_cast<InstructionSet>(Set)) == Expected);
+			CHECK(Compress(Format, Source, BlockLayout, static_cast<InstructionSet>(Set), &Jobs) == Expected);
+		}
+	}
+}
+
+TEST_CASE(LevelLayoutsPadRowsAndLevels)
+{
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	const uint32_t LevelCount = GetFullMipLevelCount(100, 60);
+	const uint64_t Size = GetTextureLevelLayouts(TextureFormat::Bc7, 100, 60, LevelCount, 256, 512, Levels);
+	CHECK(LevelCount == 7);
+	// Widths stay in texels; the pitch covers 25 blocks of 16 bytes
+	CHECK(Levels[0].Width == 100 && Levels[0].Height == 60 && Levels[0].RowPitch == 512);
+	for (uint32_t Level = 1; Level < LevelCount; Level++)
+	{
+		CHECK(Levels[Level].Offset % 512 == 0);
+		CHECK(Levels[Level].Offset >= Levels[Level - 1].Offset + static_cast<uint64_t>(Levels[Level - 1].RowPitch) * ((Levels[Level - 1].Height + 3) / 4));
+		CHECK(Levels[Level].RowPitch % 256 == 0 && Levels[Level].Width >= 1 && Levels[Level].Height >= 1);
+	}
+	CHECK(Levels[LevelCount - 1].Width == 1 && Levels[LevelCount - 1].Height == 1);
+	CHECK(Size == Levels[LevelCount - 1].Offset + Levels[LevelCount - 1].RowPitch);
+	CHECK(GetFormatElementBytes(TextureFormat::Rgba8) == 4 && GetFormatElementBytes(TextureFormat::Bc1) == 8 && GetFormatElementBytes(TextureFormat::Bc7) == 16);
+}
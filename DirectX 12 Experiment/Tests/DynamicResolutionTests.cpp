@@ -0,0 +1,163 @@
+#include "DynamicResolution.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Timestamps of a frame reach the controller this many frames after it was rendered
+static const uint32_t TimestampLatency = 2;
+
+struct TraceResult
+{
+	// GPU frame time and the scale it was rendered at, per frame
+	std::vector<double> FrameTimes;
+	std::vector<float> Scales;
+};
+
+// Runs the controller against a synthetic trace. Each entry is what the frame would cost at full resolution; the
+// rendered frame costs that times the pixel fraction, with Noise as relative jitter.
+static TraceResult RunTrace(DynamicResolutionController& Controller, const std::vector<double>& FullResolutionTimes, double Noise = 0.0)
+{
+	std::mt19937 Random(7);
+	std::uniform_real_distribution<double> Jitter(1.0 - Noise, 1.0 + Noise);
+	std::deque<double> InFlight;
+	TraceResult Result;
+	float Scale = Controller.GetScale();
+	for (double FullResolutionTime : FullResolutionTimes)
+	{
+		const double FrameTime = FullResolutionTime * Scale * Scale * Jitter(Random);
+		Result.FrameTimes.push_back(FrameTime);
+		Result.Scales.push_back(Scale);
+
+		InFlight.push_back(FrameTime);
+		if (InFlight.size() > TimestampLatency)
+		{
+			Scale = Controller.Update(InFlight.front());
+			InFlight.pop_front();
+		}
+	}
+	return Result;
+}
+
+static std::vector<double> CreateConstantTrace(uint32_t FrameCount, double Milliseconds)
+{
+	return std::vector<double>(FrameCount, Milliseconds);
+}
+
+static uint32_t CountFramesOverBudget(const TraceResult& Result, size_t First, double BudgetMilliseconds)
+{
+	return static_cast<uint32_t>(std::count_if(Result.FrameTimes.begin() + First, Result.FrameTimes.end(), [BudgetMilliseconds](double Time) { return Time > BudgetMilliseconds; }));
+}
+
+TEST_CASE(LightFramesKeepFullResolution)
+{
+	DynamicResolutionController Controller;
+	const TraceResult Result = RunTrace(Controller, CreateConstantTrace(300, 9.0), 0.05);
+	CHECK(Controller.GetScale() == 1.0f);
+	CHECK(Controller.GetScaleChangeCount() == 0);
+}
+
+TEST_CASE(HeavyFramesConvergeBelowTheBudget)
+{
+	DynamicResolutionController Controller;
+	const TraceResult Result = RunTrace(Controller, CreateConstantTrace(600, 24.0), 0.05);
+
+	// Pixels scale with the square, so the aim of 14.4 ms out of 24 ms lands near 0.77
+	CHECK(Controller.GetScale() >= 0.70f && Controller.GetScale() <= 0.80f);
+	CHECK(CountFramesOverBudget(Result, 60, 16.0) == 0);
+
+	// Jitter of 5% does not keep the scale moving once it has settled
+	CHECK(Controller.GetScaleChangeCount() <= 4);
+	const float Settled = Result.Scales[100];
+	CHECK(std::all_of(Result.Scales.begin() + 100, Result.Scales.end(), [Settled](float Scale) { return Scale == Settled; }));
+}
+
+TEST_CASE(LoadStepsAreFollowedBothWays)
+{
+	DynamicResolutionController Controller;
+	std::vector<double> Trace = CreateConstantTrace(120, 10.0);
+	const std::vector<double> Heavy = CreateConstantTrace(240, 30.0);
+	Trace.insert(Trace.end(), Heavy.begin(), Heavy.end());
+	Trace.insert(Trace.end(), 480, 10.0);
+	const TraceResult Result = RunTrace(Controller, Trace);
+
+	// The heavy section is under budget within two corrections of the step, each waiting out the timestamp latency
+	// and the settle frames
+	const DynamicResolutionDescription Description;
+	CHECK(Result.Scales[119] == 1.0f);
+	CHECK(CountFramesOverBudget(Result, 120, 16.0) <= 2 * (TimestampLatency + Description.SettleFrames + 1));
+	CHECK(Result.Scales[359] < 0.75f);
+
+	// Growing back is capped per step and held off by hysteresis, but full resolution returns
+	CHECK(Controller.GetScale() == 1.0f);
+	const auto Recovered = std::find(Result.Scales.begin() + 360, Result.Scales.end(), 1.0f);
+	REQUIRE(Recovered != Result.Scales.end());
+	CHECK(Recovered - (Result.Scales.begin() + 360) > 10);
+	for (size_t Frame = 361; Frame < Result.Scales.size(); Frame++)
+	{
+		CHECK(Result.Scales[Frame] - Result.Scales[Frame - 1] <= 0.1f + 1e-6f);
+	}
+}
+
+TEST_CASE(ScaleStaysWithinItsLimits)
+{
+	DynamicResolutionDescription Description;
+	Description.MinimumScale = 0.6f;
+	Description.MaximumScale = 0.9f;
+	DynamicResolutionController Controller(Description);
+	CHECK(Controller.GetScale() == 0.9f);
+
+	// Far too heavy to reach the budget at any allowed scale
+	RunTrace(Controller, CreateConstantTrace(200, 100.0));
+	CHECK(Controller.GetScale() == 0.6f);
+
+	// Far too light to need any scaling
+	RunTrace(Controller, CreateConstantTrace(400, 1.0));
+	CHECK(Controller.GetScale() == 0.9f);
+
+	// Every scale is a multiple of the granularity, apart from the limits themselves
+	Controller.Reset();
+	const TraceResult Result = RunTrace(Controller, CreateConstantTrace(200, 21.0), 0.1);
+	for (float Scale : Result.Scales)
+	{
+		const float Steps = Scale / Description.ScaleGranularity;
+		CHECK(Scale == 0.6f || Scale == 0.9f || std::fabs(Steps - std::round(Steps)) < 1e-3f);
+		CHECK(Scale >= 0.6f && Scale <= 0.9f);
+	}
+}
+
+// A single slow frame is believed quickly, so it may lower the scale, but the drop does not last
+TEST_CASE(IsolatedSpikesRecover)
+{
+	DynamicResolutionController Controller;
+	std::vector<double> Trace = CreateConstantTrace(600, 10.0);
+	Trace[100] = 60.0;
+	const TraceResult Result = RunTrace(Controller, Trace);
+	CHECK(Controller.GetScaleChangeCount() <= 8);
+	CHECK(Controller.GetScale() == 1.0f);
+	CHECK(std::all_of(Result.Scales.begin(), Result.Scales.begin() + 100, [](float Scale) { return Scale == 1.0f; }));
+}
+
+TEST_CASE(ScaledSizesRoundUpToWholePixels)
+{
+	CHECK(DynamicResolutionController::GetScaledSize(1280, 1.0f) == 1280);
+	CHECK(DynamicResolutionController::GetScaledSize(1280, 0.5f) == 640);
+	CHECK(DynamicResolutionController::GetScaledSize(720, 0.75f) == 540);
+	CHECK(DynamicResolutionController::GetScaledSize(1001, 0.5f) == 501);
+	CHECK(DynamicResolutionController::GetScaledSize(1, 0.5f) == 1);
+	CHECK(DynamicResolutionController::GetScaledSize(3, 0.01f) == 1);
+
+	DynamicResolutionController Controller;
+	DynamicResolutionDescription Invalid;
+	Invalid.BudgetMilliseconds = 0.0;
+	CHECK_THROWS(Controller.Configure(Invalid));
+	Invalid = DynamicResolutionDescription();
+	Invalid.MinimumScale = 0.8f;
+	Invalid.MaximumScale = 0.7f;
+	CHECK_THROWS(Controller.Configure(Invalid));
+	Invalid = DynamicResolutionDescription();
+	Invalid.MaximumScale = 1.5f;
+	CHECK_THROWS(Controller.Configure(Invalid));
+}
@@ -0,0 +1,251 @@
+#include "FenceTimeline.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+// A fence the test completes by hand, standing in for ID3D12Fence and its event
+class SimulatedFence : public TimelineFence
+{
+public:
+	uint64_t GetCompletedValue() override
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		return CompletedValue;
+	}
+
+	void WaitForValue(uint64_t Value) override
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Changed.wait(Lock, [this, Value] { return CompletedValue >= Value || Interrupted; });
+		Interrupted = false;
+	}
+
+	void Interrupt() override
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Interrupted = true;
+		Changed.notify_all();
+	}
+
+	void Complete(uint64_t Value)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		CompletedValue = Value;
+		Changed.notify_all();
+	}
+
+private:
+	std::mutex Mutex;
+	std::condition_variable Changed;
+	uint64_t CompletedValue = 0;
+	bool Interrupted = false;
+};
+
+// A GPU thread working through submitted frames one after another, signalling each when it is done
+class SimulatedQueue
+{
+public:
+	explicit SimulatedQueue(SimulatedFence& Fence) :
+		Fence(Fence)
+	{
+		Thread = std::thread(&SimulatedQueue::Run, this);
+	}
+
+	~SimulatedQueue()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Stopping = true;
+			Submitted.notify_all();
+		}
+		Thread.join();
+	}
+
+	void Submit(uint64_t Value, microseconds Duration)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Work.push_back({ Value, Duration });
+		Submitted.notify_all();
+	}
+
+private:
+	struct Frame
+	{
+		uint64_t Value;
+		microseconds Duration;
+	};
+
+	SimulatedFence& Fence;
+	std::mutex Mutex;
+	std::condition_variable Submitted;
+	std::vector<Frame> Work;
+	bool Stopping = false;
+	std::thread Thread;
+
+	// Drains the queue before stopping, so every submitted value is signalled
+	void Run()
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		for (;;)
+		{
+			Submitted.wait(Lock, [this] { return Stopping || !Work.empty(); });
+			if (Work.empty()) return;
+
+			const Frame Next = Work.front();
+			Work.erase(Work.begin());
+			Lock.unlock();
+			std::this_thread::sleep_for(Next.Duration);
+			Fence.Complete(Next.Value);
+			Lock.lock();
+		}
+	}
+};
+
+TEST_CASE(WaitersAndCallbacksFollowTheFence)
+{
+	SimulatedFence Fence;
+	FenceTimeline Timeline(Fence);
+
+	std::mutex SeenMutex;
+	std::vector<uint64_t> Seen;
+	std::atomic<bool> CompletedEarly{ false };
+	for (uint64_t Value = 1; Value <= 20; Value++)
+	{
+		Timeline.OnCompleted(Value, [&, Value]
+		{
+			CompletedEarly = CompletedEarly || Fence.GetCompletedValue() < Value;
+			std::lock_guard<std::mutex> Lock(SeenMutex);
+			Seen.push_back(Value);
+		});
+	}
+
+	// Several threads wait on different values at once
+	std::atomic<uint32_t> Released{ 0 };
+	std::atomic<bool> ReleasedEarly{ false };
+	std::vector<std::thread> Waiters;
+	for (uint64_t Value = 5; Value <= 20; Value += 5)
+	{
+		Waiters.emplace_back([&, Value]
+		{
+			Timeline.Wait(Value);
+			ReleasedEarly = ReleasedEarly || Fence.GetCompletedValue() < Value;
+			Released++;
+		});
+	}
+	std::this_thread::sleep_for(milliseconds(5));
+	CHECK(Released == 0);
+
+	for (uint64_t Value = 1; Value <= 20; Value++)
+	{
+		std::this_thread::sleep_for(microseconds(200));
+		Fence.Complete(Value);
+	}
+	for (std::thread& Waiter : Waiters)
+	{
+		Waiter.join();
+	}
+	Timeline.Flush();
+
+	CHECK(!CompletedEarly && !ReleasedEarly);
+	REQUIRE(Seen.size() == 20);
+	for (uint64_t Index = 0; Index < Seen.size(); Index++)
+	{
+		CHECK(Seen[Index] == Index + 1);
+	}
+
+	FenceTimelineStatistics Statistics = Timeline.GetStatistics();
+	CHECK(Statistics.Waits == 4 && Statistics.StalledWaits == 4 && Statistics.CallbacksRun == 20);
+	CHECK(Timeline.IsCompleted(20) && !Timeline.IsCompleted(21));
+
+	// Waiting for a completed value returns without blocking
+	Timeline.Wait(3);
+	Statistics = Timeline.GetStatistics();
+	CHECK(Statistics.Waits == 5 && Statistics.StalledWaits == 4);
+}
+
+// The completion thread is blocked on a far value when a nearer one is waited for
+TEST_CASE(NearerValuesInterruptTheCompletionThread)
+{
+	SimulatedFence Fence;
+	FenceTimeline Timeline(Fence);
+	std::atomic<bool> FarRan{ false };
+	Timeline.OnCompleted(100, [&FarRan] { FarRan = true; });
+	std::this_thread::sleep_for(milliseconds(2));
+
+	std::atomic<bool> Released{ false };
+	std::thread Waiter([&] { Timeline.Wait(3); Released = true; });
+	std::this_thread::sleep_for(milliseconds(2));
+	Fence.Complete(3);
+	Waiter.join();
+	CHECK(Released && !FarRan);
+
+	Fence.Complete(100);
+	Timeline.Flush();
+	CHECK(FarRan);
+}
+
+TEST_CASE(PendingCallbacksAreReleasedUnrun)
+{
+	const std::shared_ptr<int> Resource = std::make_shared<int>(1);
+	std::atomic<bool> Ran{ false };
+	{
+		SimulatedFence Fence;
+		FenceTimeline Timeline(Fence);
+		Timeline.OnCompleted(7, [Resource, &Ran] { Ran = true; });
+		CHECK(Resource.use_count() == 2);
+	}
+	CHECK(!Ran);
+	CHECK(Resource.use_count() == 1);
+}
+
+// A frame loop of 2 ms CPU and 3 ms GPU frames with two in flight, retiring one resource per frame. Blocking at
+// each retirement, as WaitForGpu did, stalls every frame; deferring the release to the completion thread only
+// stalls where the frames in flight limit would anyway.
+TEST_CASE(DeferredReleaseAvoidsStalls)
+{
+	const uint32_t FrameCount = 30;
+	FenceTimelineStatistics Results[2];
+	for (uint32_t Deferred = 0; Deferred < 2; Deferred++)
+	{
+		SimulatedFence Fence;
+		SimulatedQueue Queue(Fence);
+		FenceTimeline Timeline(Fence);
+		std::atomic<uint32_t> ReleasedCount{ 0 };
+
+		uint64_t Value = 0;
+		for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+		{
+			std::this_thread::sleep_for(milliseconds(2));
+			Queue.Submit(++Value, microseconds(3000));
+
+			std::shared_ptr<uint32_t> Retired = std::make_shared<uint32_t>(Frame);
+			if (Deferred)
+			{
+				Timeline.OnCompleted(Value, [Retired, &ReleasedCount]() mutable { Retired.reset(); ReleasedCount++; });
+			}
+			else
+			{
+				Timeline.Wait(Value);
+				Retired.reset();
+				ReleasedCount++;
+			}
+			if (Value > 2) Timeline.Wait(Value - 2);
+		}
+		Timeline.Wait(Value);
+		Timeline.Flush();
+
+		CHECK(ReleasedCount == FrameCount);
+		Results[Deferred] = Timeline.GetStatistics();
+	}
+
+	CHECK(Results[0].StalledWaits >= FrameCount);
+	CHECK(Results[1].StalledWaits < Results[0].StalledWaits);
+	CHECK(Results[1].StallTime < Results[0].StallTime);
+	CHECK(Results[1].CallbacksRun == FrameCount);
+	CHECK(Results[1].AvoidedStallTime > milliseconds(FrameCount));
+}
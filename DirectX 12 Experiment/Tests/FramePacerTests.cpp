@@ -0,0 +1,220 @@
+#include "FramePacer.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <vector>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+// Time only moves when the pacer looks at it or sleeps. Each look costs a microsecond, so spinning ends; sleeps
+// can be made to oversleep like a coarse OS scheduler.
+struct FakeClock : FramePacerClock
+{
+	nanoseconds Time{ 0 };
+	nanoseconds Oversleep{ 0 };
+	uint32_t Sleeps = 0;
+
+	nanoseconds Now() override
+	{
+		Time += microseconds(1);
+		return Time;
+	}
+
+	void Sleep(nanoseconds Duration) override
+	{
+		Time += Duration + Oversleep;
+		Sleeps++;
+	}
+};
+
+// A GPU that runs submitted frames back to back, each taking GpuTime. Fence value N is the Nth submitted frame.
+struct FakeFence : FramePacerFence
+{
+	FakeClock& Clock;
+	nanoseconds GpuTime;
+	std::vector<nanoseconds> CompletionTimes;
+	uint32_t Waits = 0;
+
+	FakeFence(FakeClock& Clock, nanoseconds GpuTime) :
+		Clock(Clock),
+		GpuTime(GpuTime)
+	{
+	}
+
+	uint64_t Submit()
+	{
+		const nanoseconds Start = std::max(Clock.Time, CompletionTimes.empty() ? nanoseconds(0) : CompletionTimes.back());
+		CompletionTimes.push_back(Start + GpuTime);
+		return CompletionTimes.size();
+	}
+
+	uint64_t GetPendingCount() const
+	{
+		return CompletionTimes.end() - std::upper_bound(CompletionTimes.begin(), CompletionTimes.end(), Clock.Time);
+	}
+
+	uint64_t GetCompletedValue() override
+	{
+		return CompletionTimes.size() - GetPendingCount();
+	}
+
+	void Wait(uint64_t Value) override
+	{
+		REQUIRE(Value >= 1 && Value <= CompletionTimes.size());
+		Clock.Time = std::max(Clock.Time, CompletionTimes[Value - 1]);
+		Waits++;
+	}
+};
+
+static FramePacingDescription CreateDescription(PresentMode Mode, uint32_t FramesInFlight, double TargetFramesPerSecond = 60.0)
+{
+	FramePacingDescription Description;
+	Description.Mode = Mode;
+	Description.FramesInFlight = FramesInFlight;
+	Description.TargetFramesPerSecond = TargetFramesPerSecond;
+	return Description;
+}
+
+// One frame of the render loop: pace, sample input, record for CpuTime, submit, present
+static void RunFrame(FramePacer& Pacer, FakeClock& Clock, FakeFence& Fence, nanoseconds CpuTime)
+{
+	Pacer.BeginFrame();
+	Clock.Time += CpuTime;
+	Pacer.EndFrame(Fence.Submit());
+}
+
+static double ToMilliseconds(nanoseconds Duration)
+{
+	return std::chrono::duration<double, std::milli>(Duration).count();
+}
+
+TEST_CASE(VsyncBoundsFramesInFlight)
+{
+	for (uint32_t FramesInFlight = 1; FramesInFlight <= 3; FramesInFlight++)
+	{
+		FakeClock Clock;
+		FakeFence Fence(Clock, milliseconds(10));
+		FramePacer Pacer(Clock, Fence);
+		Pacer.Configure(CreateDescription(PresentMode::Vsync, FramesInFlight));
+
+		// GPU bound, so the CPU runs ahead until the limit and then waits in EndFrame for every frame. With a single
+		// frame in flight the CPU and GPU take turns.
+		for (uint32_t Frame = 0; Frame < 50; Frame++)
+		{
+			RunFrame(Pacer, Clock, Fence, milliseconds(4));
+			CHECK(Fence.GetPendingCount() <= FramesInFlight - 1);
+		}
+		CHECK_NEAR(ToMilliseconds(Pacer.GetStatistics().FrameInterval), FramesInFlight == 1 ? 14.0 : 10.0, 0.1);
+		CHECK(Pacer.GetStatistics().FenceWait > milliseconds(5));
+		CHECK(Pacer.GetStatistics().PacingWait == nanoseconds(0));
+	}
+}
+
+// The low latency mode blocks before input is sampled, so the wait shows up in BeginFrame and input is sampled
+// with at most FramesInFlight - 1 frames still ahead of it on the GPU
+TEST_CASE(LowLatencyWaitsBeforeSamplingInput)
+{
+	FakeClock Clock;
+	FakeFence Fence(Clock, milliseconds(10));
+	FramePacer Pacer(Clock, Fence);
+	Pacer.Configure(CreateDescription(PresentMode::LowLatency, 2));
+
+	for (uint32_t Frame = 0; Frame < 50; Frame++)
+	{
+		Pacer.BeginFrame();
+		CHECK(Fence.GetPendingCount() <= 1);
+		const uint32_t WaitsBeforeSubmit = Fence.Waits;
+		Clock.Time += milliseconds(4);
+		Pacer.EndFrame(Fence.Submit());
+		CHECK(Fence.Waits == WaitsBeforeSubmit);
+	}
+	CHECK(Fence.Waits > 0);
+	CHECK_NEAR(ToMilliseconds(Pacer.GetStatistics().FrameInterval), 10.0, 0.1);
+	CHECK(Pacer.GetSyncInterval() == 1 && !Pacer.AllowsTearing());
+}
+
+TEST_CASE(CappedFramesHoldTheTargetRate)
+{
+	FakeClock Clock;
+	FakeFence Fence(Clock, milliseconds(2));
+	FramePacer Pacer(Clock, Fence);
+	Pacer.Configure(CreateDescription(PresentMode::Capped, 2, 100.0));
+
+	// Every sleep wakes 3 ms late; after the first oversleep the pacer stops sleeping earlier and spins the rest
+	Clock.Oversleep = milliseconds(3);
+	for (uint32_t Frame = 0; Frame < 100; Frame++)
+	{
+		RunFrame(Pacer, Clock, Fence, milliseconds(3));
+		if (Frame < 3) continue;
+
+		const FramePacingStatistics& Statistics = Pacer.GetStatistics();
+		CHECK_NEAR(ToMilliseconds(Statistics.FrameInterval), 10.0, 0.01);
+		CHECK(Statistics.PacingWait > milliseconds(6));
+	}
+	CHECK(Clock.Sleeps > 90);
+	CHECK(Pacer.GetSyncInterval() == 0 && Pacer.AllowsTearing());
+}
+
+// A frame that overruns its interval by a lot starts a new cadence instead of rushing later frames to catch up
+TEST_CASE(CappedFramesDoNotCatchUpAfterAHitch)
+{
+	FakeClock Clock;
+	FakeFence Fence(Clock, milliseconds(1));
+	FramePacer Pacer(Clock, Fence);
+	Pacer.Configure(CreateDescription(PresentMode::Capped, 2, 100.0));
+
+	for (uint32_t Frame = 0; Frame < 10; Frame++)
+	{
+		RunFrame(Pacer, Clock, Fence, milliseconds(2));
+	}
+	RunFrame(Pacer, Clock, Fence, milliseconds(35));
+	for (uint32_t Frame = 0; Frame < 10; Frame++)
+	{
+		RunFrame(Pacer, Clock, Fence, milliseconds(2));
+		CHECK(Pacer.GetStatistics().FrameInterval >= milliseconds(10) - microseconds(10));
+	}
+	CHECK_NEAR(ToMilliseconds(Pacer.GetStatistics().FrameInterval), 10.0, 0.01);
+}
+
+TEST_CASE(UncappedFramesNeverWaitForPacing)
+{
+	FakeClock Clock;
+	FakeFence Fence(Clock, milliseconds(1));
+	FramePacer Pacer(Clock, Fence);
+	Pacer.Configure(CreateDescription(PresentMode::Uncapped, 2));
+	for (uint32_t Frame = 0; Frame < 20; Frame++)
+	{
+		RunFrame(Pacer, Clock, Fence, milliseconds(3));
+		CHECK(Pacer.GetStatistics().PacingWait == nanoseconds(0));
+	}
+	CHECK(Clock.Sleeps == 0 && Fence.Waits == 0);
+	CHECK_NEAR(ToMilliseconds(Pacer.GetStatistics().FrameInterval), 3.0, 0.1);
+	CHECK(Pacer.GetSyncInterval() == 0 && Pacer.AllowsTearing());
+}
+
+TEST_CASE(FramesInFlightChangeBetweenFrames)
+{
+	FakeClock Clock;
+	FakeFence Fence(Clock, milliseconds(10));
+	FramePacer Pacer(Clock, Fence);
+	Pacer.Configure(CreateDescription(PresentMode::Vsync, 3));
+	for (uint32_t Frame = 0; Frame < 10; Frame++)
+	{
+		RunFrame(Pacer, Clock, Fence, milliseconds(1));
+	}
+	CHECK(Fence.GetPendingCount() == 2);
+
+	// Lowering the count drains the extra frames at the next BeginFrame
+	Pacer.Configure(CreateDescription(PresentMode::Vsync, 1));
+	Pacer.BeginFrame();
+	CHECK(Fence.GetPendingCount() == 0);
+	CHECK(Pacer.GetStatistics().FenceWait > milliseconds(10));
+	Pacer.EndFrame(Fence.Submit());
+	CHECK(Fence.GetPendingCount() == 0);
+
+	CHECK_THROWS(Pacer.Configure(CreateDescription(PresentMode::Vsync, 0)));
+	CHECK_THROWS(Pacer.Configure(CreateDescription(PresentMode::Capped, 2, 0.0)));
+	CHECK(Pacer.GetDescription().FramesInFlight == 1);
+}
@@ -0,0 +1,191 @@
+#include "HeadlessRenderDevice.h"
+#include "TestFramework.h"
+
+static const float ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+static const uint32_t PackedClearColor = 0xFF663300u;
+static const uint32_t White = 0xFFFFFFFFu;
+
+// The application's triangle, clockwise on screen and so front facing
+static const Vertex TriangleCorners[] =
+{
+	{ {  0.0f,   0.25f, 0.0f }, { 0.5f, 1.0f } },
+	{ {  0.25f, -0.25f, 0.0f }, { 1.0f, 0.0f } },
+	{ { -0.25f, -0.25f, 0.0f }, { 0.0f, 0.0f } }
+};
+
+static void InitializeDevice(HeadlessRenderDevice& Device, uint32_t Width, uint32_t Height, uint32_t FrameCount = 2)
+{
+	RenderDeviceDescription Description;
+	Description.Width = Width;
+	Description.Height = Height;
+	Description.FrameCount = FrameCount;
+	Description.Pacing.Mode = PresentMode::Uncapped;
+	Description.Pacing.FramesInFlight = 1;
+	Device.Initialize(Description);
+
+	const uint32_t Indices[] = { 0, 1, 2 };
+	Device.CreateGeometry(TriangleCorners, 3, Indices, 3);
+	const uint8_t WhiteTexel[] = { 255, 255, 255, 255 };
+	TextureDescription Texture;
+	Texture.Width = 1;
+	Texture.Height = 1;
+	Device.CreateTexture(Texture, WhiteTexel);
+	Device.FinishUploads();
+}
+
+static void ExecuteFrame(HeadlessRenderDevice& Device, RenderCommandList& CommandList, bool DrawTriangle)
+{
+	CommandList.Reset();
+	CommandList.ClearRenderTarget(ClearColor);
+	if (DrawTriangle)
+	{
+		CommandList.DrawIndexedInstanced(3, 1, 0, 0, 0);
+	}
+	CommandList.Close();
+	RenderCommandList* const CommandLists[] = { &CommandList };
+	Device.ExecuteCommandLists(CommandLists, 1);
+}
+
+static uint32_t GetPixel(const HeadlessRenderDevice& Device, uint32_t X, uint32_t Y)
+{
+	return Device.GetFramebuffer(Device.GetCurrentFrameIndex())[static_cast<size_t>(Y) * Device.GetWidth() + X];
+}
+
+TEST_CASE(ClearFillsTheCurrentFramebuffer)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 16, 8);
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	ExecuteFrame(Device, *CommandList, false);
+
+	for (uint32_t Pixel : Device.GetFramebuffer(0))
+	{
+		CHECK(Pixel == PackedClearColor);
+	}
+	CHECK(Device.GetStatistics().ExecutedCommandLists == 1);
+	CHECK(Device.GetStatistics().ExecutedCommands == 1);
+}
+
+TEST_CASE(DrawRasterizesTheTexturedTriangle)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 64, 64);
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	ExecuteFrame(Device, *CommandList, true);
+
+	CHECK(Device.GetStatistics().RasterizedTriangles == 1);
+	CHECK(GetPixel(Device, 32, 32) == White);
+	CHECK(GetPixel(Device, 0, 0) == PackedClearColor);
+	CHECK(GetPixel(Device, 63, 63) == PackedClearColor);
+
+	// Half a unit wide and high in clip space, so a quarter of the width by a quarter of the height, halved
+	uint32_t Covered = 0;
+	for (uint32_t Pixel : Device.GetFramebuffer(0))
+	{
+		Covered += Pixel == White ? 1 : 0;
+	}
+	CHECK_NEAR(Covered, 64 * 64 / 32, 24);
+}
+
+TEST_CASE(BackFacesAreCulled)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 32, 32);
+	const Vertex Reversed[] = { TriangleCorners[0], TriangleCorners[2], TriangleCorners[1] };
+	const uint32_t Indices[] = { 0, 1, 2 };
+	Device.CreateGeometry(Reversed, 3, Indices, 3);
+
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	ExecuteFrame(Device, *CommandList, true);
+	CHECK(Device.GetStatistics().RasterizedTriangles == 0);
+	CHECK(GetPixel(Device, 16, 16) == PackedClearColor);
+}
+
+TEST_CASE(InstancesAreTransformedAndTinted)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 64, 64);
+
+	// One instance moved half a screen to the right with the second material's red tint
+	InstanceList Instances;
+	Instances.MeshIds.push_back(0);
+	Instances.MaterialIds.push_back(1);
+	Instances.Transforms.push_back({ { { 1.0f, 0.0f, 0.0f, 0.5f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } } });
+	MeshRange Triangle;
+	Triangle.IndexCount = 3;
+	InstanceBatchBuffer Batches;
+	BuildInstanceBatches(Instances, &Triangle, 1, Batches);
+	Device.UploadInstances(Batches);
+
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	CommandList->Reset();
+	CommandList->ClearRenderTarget(ClearColor);
+	CommandList->ExecuteIndirect(0, static_cast<uint32_t>(Batches.Draws.size()));
+	CommandList->Close();
+	RenderCommandList* const CommandLists[] = { CommandList.get() };
+	Device.ExecuteCommandLists(CommandLists, 1);
+
+	CHECK(GetPixel(Device, 32, 32) == PackedClearColor);
+	CHECK(GetPixel(Device, 48, 32) == 0xFF9999FFu);
+	CHECK(Device.GetStatistics().DrawnInstances == 1);
+}
+
+TEST_CASE(PresentCyclesThroughTheBackBuffers)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 8, 8, 3);
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	for (uint32_t Frame = 0; Frame < 7; Frame++)
+	{
+		CHECK(Device.GetCurrentFrameIndex() == Frame % 3);
+		Device.BeginFrame();
+		ExecuteFrame(Device, *CommandList, false);
+		Device.Present();
+	}
+	CHECK(Device.GetStatistics().PresentedFrames == 7);
+}
+
+TEST_CASE(CommandListsMustBeClosedBeforeExecution)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 8, 8);
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	CommandList->Reset();
+	CommandList->ClearRenderTarget(ClearColor);
+	RenderCommandList* const CommandLists[] = { CommandList.get() };
+	CHECK_THROWS(Device.ExecuteCommandLists(CommandLists, 1));
+}
+
+TEST_CASE(ResizeAndRenderScaleChangeTheRenderArea)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 64, 32);
+	Device.Resize(0, 10);
+	CHECK(Device.GetWidth() == 64 && Device.GetHeight() == 32);
+
+	Device.Resize(40, 20);
+	CHECK(Device.GetWidth() == 40 && Device.GetHeight() == 20);
+	CHECK(Device.GetFramebuffer(1).size() == 40 * 20);
+
+	// Scaled frames are rendered smaller and upscaled into the whole framebuffer
+	Device.SetRenderScale(0.5f);
+	CHECK(Device.GetRenderWidth() == 20 && Device.GetRenderHeight() == 10);
+	std::unique_ptr<RenderCommandList> CommandList = Device.CreateCommandList();
+	ExecuteFrame(Device, *CommandList, true);
+	CHECK(GetPixel(Device, 0, 0) == PackedClearColor);
+	CHECK(GetPixel(Device, 39, 19) == PackedClearColor);
+	CHECK(GetPixel(Device, 20, 10) == White);
+
+	CHECK_THROWS(Device.SetRenderScale(0.0f));
+}
+
+TEST_CASE(FramesInFlightAreLimitedByTheBackBuffers)
+{
+	HeadlessRenderDevice Device;
+	InitializeDevice(Device, 8, 8, 2);
+	FramePacingDescription Pacing;
+	Pacing.FramesInFlight = 3;
+	CHECK_THROWS(Device.SetFramePacing(Pacing));
+	Pacing.FramesInFlight = 2;
+	Device.SetFramePacing(Pacing);
+}
@@ -0,0 +1,142 @@
+#include "LinearRingAllocator.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST_CASE(AlignmentPadsTheOffset)
+{
+	LinearRingAllocator Allocator(1024);
+	CHECK(Allocator.Allocate(3, 1) == 0);
+	CHECK(Allocator.Allocate(16, 256) == 256);
+	CHECK(Allocator.Allocate(1, 4) == 272);
+	CHECK(Allocator.GetUsedBytes() == 273);
+	CHECK(Allocator.GetStatistics().AllocatedBytes == 20);
+	CHECK(Allocator.GetStatistics().WastedBytes == 253);
+	CHECK(Allocator.GetStatistics().AllocationCount == 3);
+}
+
+TEST_CASE(AllocationsNeverStraddleTheEndOfTheRing)
+{
+	LinearRingAllocator Allocator(1024);
+	CHECK(Allocator.Allocate(1000, 1) == 0);
+	Allocator.FinishFrame(1);
+	Allocator.Retire(1);
+	CHECK(Allocator.GetUsedBytes() == 0);
+
+	// The 24 bytes left before the end are skipped and count as used until the frame retires
+	CHECK(Allocator.Allocate(100, 1) == 0);
+	CHECK(Allocator.GetUsedBytes() == 124);
+	CHECK(Allocator.GetStatistics().WastedBytes == 24);
+
+	CHECK(Allocator.Allocate(800, 1) == 100);
+	Allocator.FinishFrame(2);
+	Allocator.Retire(2);
+
+	// An aligned offset that would run past the end wraps too
+	CHECK(Allocator.Allocate(64, 128) == 0);
+}
+
+TEST_CASE(FramesRetireInFenceOrder)
+{
+	LinearRingAllocator Allocator(1024);
+	for (uint64_t FenceValue = 1; FenceValue <= 3; FenceValue++)
+	{
+		CHECK(Allocator.Allocate(256, 256) == (FenceValue - 1) * 256);
+		Allocator.FinishFrame(FenceValue);
+	}
+	CHECK(Allocator.GetUsedBytes() == 768);
+
+	Allocator.Retire(0);
+	CHECK(Allocator.GetUsedBytes() == 768);
+	Allocator.Retire(2);
+	CHECK(Allocator.GetUsedBytes() == 256);
+	Allocator.Retire(2);
+	CHECK(Allocator.GetUsedBytes() == 256);
+	Allocator.Retire(3);
+	CHECK(Allocator.GetUsedBytes() == 0);
+	CHECK(Allocator.GetStatistics().PeakUsedBytes == 768);
+}
+
+TEST_CASE(EmptyFramesDoNotRetireLaterAllocations)
+{
+	LinearRingAllocator Allocator(1024);
+	Allocator.FinishFrame(1);
+	CHECK(Allocator.Allocate(64, 1) == 0);
+	Allocator.FinishFrame(2);
+	Allocator.Retire(1);
+	CHECK(Allocator.GetUsedBytes() == 64);
+	Allocator.Retire(2);
+	CHECK(Allocator.GetUsedBytes() == 0);
+}
+
+TEST_CASE(FullRingFailsUntilOlderFramesRetire)
+{
+	LinearRingAllocator Allocator(1024);
+	CHECK(Allocator.Allocate(512, 1) == 0);
+	Allocator.FinishFrame(1);
+	CHECK(Allocator.Allocate(512, 1) == 512);
+	Allocator.FinishFrame(2);
+
+	CHECK(Allocator.Allocate(1, 1) == LinearRingAllocator::InvalidOffset);
+	CHECK(Allocator.GetStatistics().FailedAllocationCount == 1);
+	CHECK(Allocator.GetUsedBytes() == 1024);
+
+	Allocator.Retire(1);
+	CHECK(Allocator.Allocate(256, 1) == 0);
+
+	// Requests larger than the ring fail however much is free
+	Allocator.FinishFrame(3);
+	Allocator.Retire(3);
+	CHECK(Allocator.Allocate(1025, 1) == LinearRingAllocator::InvalidOffset);
+	CHECK(Allocator.GetStatistics().FailedAllocationCount == 2);
+	CHECK(Allocator.GetStatistics().AllocationCount == 3);
+}
+
+struct LiveAllocation
+{
+	uint64_t Offset;
+	uint64_t Size;
+	uint64_t FenceValue;
+};
+
+// Random frames with the GPU two frames behind, checked against the ranges that are still in flight
+TEST_CASE(RandomFramesNeverOverlapLiveAllocations)
+{
+	const uint64_t Capacity = 64 * 1024;
+	LinearRingAllocator Allocator(Capacity);
+	std::mt19937 Random(5);
+	std::vector<LiveAllocation> Live;
+
+	for (uint64_t FenceValue = 1; FenceValue <= 2000; FenceValue++)
+	{
+		const uint32_t AllocationCount = Random() % 24;
+		for (uint32_t Allocation = 0; Allocation < AllocationCount; Allocation++)
+		{
+			const uint64_t Size = 1 + Random() % 2048;
+			const uint64_t Alignment = 1ull << (Random() % 9);
+			const uint64_t Offset = Allocator.Allocate(Size, Alignment);
+			if (Offset == LinearRingAllocator::InvalidOffset) continue;
+
+			REQUIRE(Offset % Alignment == 0);
+			REQUIRE(Offset + Size <= Capacity);
+			for (const LiveAllocation& Other : Live)
+			{
+				REQUIRE(Offset + Size <= Other.Offset || Other.Offset + Other.Size <= Offset);
+			}
+			Live.push_back({ Offset, Size, FenceValue });
+		}
+		Allocator.FinishFrame(FenceValue);
+
+		if (FenceValue > 2)
+		{
+			const uint64_t CompletedFenceValue = FenceValue - 2;
+			Allocator.Retire(CompletedFenceValue);
+			Live.erase(std::remove_if(Live.begin(), Live.end(), [CompletedFenceValue](const LiveAllocation& Allocation) { return Allocation.FenceValue <= CompletedFenceValue; }), Live.end());
+		}
+	}
+	CHECK(Allocator.GetStatistics().AllocationCount > 10000);
+	CHECK(Allocator.GetStatistics().FailedAllocationCount > 0);
+	CHECK(Allocator.GetStatistics().PeakUsedBytes <= Capacity);
+}
@@ -0,0 +1,144 @@
+#include "Lz4Codec.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Text-like data with repeats at every distance, long runs and stretches of noise
+static std::vector<uint8_t> CreateMixedData(size_t Size, uint32_t Seed)
+{
+	std::mt19937 Random(Seed);
+	std::vector<uint8_t> Data(Size);
+	for (size_t Index = 0; Index < Size; Index++)
+	{
+		switch ((Index / 4096) % 4)
+		{
+		case 0: Data[Index] = static_cast<uint8_t>("the quick brown fox jumps over the lazy dog "[Index % 44]); break;
+		case 1: Data[Index] = 0x5A; break;
+		case 2: Data[Index] = static_cast<uint8_t>(Random()); break;
+		default: Data[Index] = Index >= 1000 && Random() % 8 != 0 ? Data[Index - 1000] : static_cast<uint8_t>(Random()); break;
+		}
+	}
+	return Data;
+}
+
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& Data)
+{
+	std::vector<uint8_t> Compressed(GetLz4CompressBound(Data.size()));
+	const size_t CompressedSize = CompressLz4(Data.data(), Data.size(), Compressed.data(), Compressed.size());
+	Compressed.resize(CompressedSize);
+	return Compressed;
+}
+
+static bool RoundTrips(const std::vector<uint8_t>& Data)
+{
+	const std::vector<uint8_t> Compressed = Compress(Data);
+	if (Compressed.empty() || Compressed.size() > GetLz4CompressBound(Data.size())) return false;
+
+	std::vector<uint8_t> Decoded(Data.size() + 1, 0xCC);
+	return DecompressLz4(Compressed.data(), Compressed.size(), Decoded.data(), Data.size()) && std::equal(Data.begin(), Data.end(), Decoded.begin()) && Decoded.back() == 0xCC;
+}
+
+TEST_CASE(BlocksRoundTrip)
+{
+	// Every size around the minimum match and end of block limits
+	for (size_t Size = 0; Size <= 80; Size++)
+	{
+		CHECK(RoundTrips(std::vector<uint8_t>(Size, 7)));
+		CHECK(RoundTrips(CreateMixedData(Size, static_cast<uint32_t>(Size))));
+	}
+
+	// Long runs need extra length bytes for both literals and matches
+	CHECK(RoundTrips(std::vector<uint8_t>(1 << 20, 0)));
+	CHECK(RoundTrips(CreateMixedData(1 << 20, 1)));
+	std::vector<uint8_t> Noise = CreateMixedData(70000, 2);
+	std::mt19937 Random(3);
+	for (uint8_t& Byte : Noise)
+	{
+		Byte = static_cast<uint8_t>(Random());
+	}
+	CHECK(RoundTrips(Noise));
+
+	CHECK(Compress(CreateMixedData(1 << 20, 1)).size() < (1 << 20) / 2);
+	CHECK(Compress(std::vector<uint8_t>(1 << 16, 0)).size() < 512);
+}
+
+// A block written by hand from the format description: three literals, a match of nine reaching back three bytes
+// so it overlaps itself, then five closing literals
+TEST_CASE(HandWrittenBlocksDecode)
+{
+	const uint8_t Block[] = { 0x35, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v' };
+	const std::string Expected = "abcabcabcabcxyzwv";
+	std::vector<uint8_t> Decoded(Expected.size());
+	REQUIRE(DecompressLz4(Block, sizeof(Block), Decoded.data(), Decoded.size()));
+	CHECK(std::string(Decoded.begin(), Decoded.end()) == Expected);
+
+	// The sizes have to match exactly
+	std::vector<uint8_t> Larger(Expected.size() + 1);
+	CHECK(!DecompressLz4(Block, sizeof(Block), Larger.data(), Larger.size()));
+	CHECK(!DecompressLz4(Block, sizeof(Block), Decoded.data(), Decoded.size() - 1));
+
+	// Matches reaching before the start of the output, or with offset zero, are malformed
+	const uint8_t BeforeStart[] = { 0x35, 'a', 'b', 'c', 0x04, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v' };
+	const uint8_t ZeroOffset[] = { 0x35, 'a', 'b', 'c', 0x00, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v' };
+	CHECK(!DecompressLz4(BeforeStart, sizeof(BeforeStart), Decoded.data(), Decoded.size()));
+	CHECK(!DecompressLz4(ZeroOffset, sizeof(ZeroOffset), Decoded.data(), Decoded.size()));
+
+	// A literal length continued past the end of the input
+	const uint8_t Overlong[] = { 0xF0, 0xFF, 0xFF };
+	CHECK(!DecompressLz4(Overlong, sizeof(Overlong), Decoded.data(), Decoded.size()));
+}
+
+TEST_CASE(TruncatedBlocksAreRejected)
+{
+	const std::vector<uint8_t> Data = CreateMixedData(20000, 4);
+	const std::vector<uint8_t> Compressed = Compress(Data);
+	REQUIRE(!Compressed.empty());
+
+	std::vector<uint8_t> Decoded(Data.size());
+	for (size_t Size = 0; Size < Compressed.size(); Size++)
+	{
+		// A shorter copy, so reading past the given size would leave the buffer
+		const std::vector<uint8_t> Truncated(Compressed.begin(), Compressed.begin() + Size);
+		CHECK(!DecompressLz4(Truncated.data(), Truncated.size(), Decoded.data(), Decoded.size()));
+	}
+}
+
+// Damaged blocks decode to something or fail, but never outside the buffers; the canary catches overruns
+TEST_CASE(CorruptBlocksStayInBounds)
+{
+	const std::vector<uint8_t> Data = CreateMixedData(16384, 5);
+	const std::vector<uint8_t> Compressed = Compress(Data);
+	std::mt19937 Random(6);
+	uint32_t Rejected = 0;
+	for (uint32_t Attempt = 0; Attempt < 2000; Attempt++)
+	{
+		std::vector<uint8_t> Corrupt = Compressed;
+		const uint32_t FlipCount = 1 + Random() % 4;
+		for (uint32_t Flip = 0; Flip < FlipCount; Flip++)
+		{
+			Corrupt[Random() % Corrupt.size()] ^= static_cast<uint8_t>(1u << (Random() % 8));
+		}
+
+		std::vector<uint8_t> Decoded(Data.size() + 64, 0xCC);
+		Rejected += DecompressLz4(Corrupt.data(), Corrupt.size(), Decoded.data(), Data.size()) ? 0 : 1;
+		bool CanaryIntact = true;
+		for (size_t Index = Data.size(); Index < Decoded.size(); Index++)
+		{
+			CanaryIntact &= Decoded[Index] == 0xCC;
+		}
+		CHECK(CanaryIntact);
+	}
+	CHECK(Rejected > 0);
+}
+
+TEST_CASE(SmallCapacitiesFailToCompress)
+{
+	const std::vector<uint8_t> Data = CreateMixedData(10000, 7);
+	const size_t CompressedSize = Compress(Data).size();
+	std::vector<uint8_t> Destination(CompressedSize);
+	CHECK(CompressLz4(Data.data(), Data.size(), Destination.data(), CompressedSize) == CompressedSize);
+	CHECK(CompressLz4(Data.data(), Data.size(), Destination.data(), CompressedSize - 1) == 0);
+	CHECK(CompressLz4(Data.data(), Data.size(), Destination.data(), 0) == 0);
+}
@@ -0,0 +1,244 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ProceduralTexture.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+struct MipChain
+{
+	uint32_t LevelCount = 0;
+	TextureLevelLayout Levels[MaximumMipLevelCount];
+	std::vector<uint8_t> Pixels;
+};
+
+// Rows padded to 256 bytes like an upload footprint, so kernels that ignore the pitch show up as differences
+static MipChain CreateMipChain(uint32_t Width, uint32_t Height, ProceduralPattern Pattern)
+{
+	MipChain Chain;
+	Chain.LevelCount = GetFullMipLevelCount(Width, Height);
+	Chain.Pixels.assign(GetTextureLevelLayouts(TextureFormat::Rgba8, Width, Height, Chain.LevelCount, 256, 512, Chain.Levels), 0xCD);
+
+	ProceduralTextureDescription Description;
+	Description.Pattern = Pattern;
+	Description.Width = Width;
+	Description.Height = Height;
+	Description.CellSize = 8;
+	Description.Seed = 7;
+	Description.ColorA[0] = 250; Description.ColorA[1] = 40; Description.ColorA[2] = 90; Description.ColorA[3] = 255;
+	Description.ColorB[0] = 5; Description.ColorB[1] = 180; Description.ColorB[2] = 220; Description.ColorB[3] = 60;
+	GenerateProceduralTexture(Description, Chain.Pixels.data(), Chain.Levels[0].RowPitch);
+	return Chain;
+}
+
+static double DecodeSrgb(uint8_t Value)
+{
+	const double Encoded = Value / 255.0;
+	return Encoded <= 0.04045 ? Encoded / 12.92 : std::pow((Encoded + 0.055) / 1.055, 2.4);
+}
+
+static double EncodeSrgb(double Linear)
+{
+	Linear = std::min(std::max(Linear, 0.0), 1.0);
+	return Linear <= 0.0031308 ? Linear * 12.92 : 1.055 * std::pow(Linear, 1.0 / 2.4) - 0.055;
+}
+
+static double BesselI0(double X)
+{
+	double Sum = 1.0;
+	double Term = 1.0;
+	for (int K = 1; K < 32; K++)
+	{
+		Term *= (X / (2.0 * K)) * (X / (2.0 * K));
+		Sum += Term;
+	}
+	return Sum;
+}
+
+// Separable weights around the destination texel center, which sits between source texels 2X and 2X + 1: a 2x2 box,
+// or six taps of a half-band sinc under a Kaiser window of radius 3 and alpha 4
+static std::vector<double> GetReferenceWeights(MipFilter Filter)
+{
+	if (Filter == MipFilter::Box) return { 0.5, 0.5 };
+
+	const double Pi = 3.14159265358979323846;
+	std::vector<double> Weights;
+	double Total = 0.0;
+	for (int Tap = 0; Tap < 6; Tap++)
+	{
+		const double X = Tap - 2.5;
+		const double Ratio = X / 3.0;
+		Weights.push_back(std::sin(Pi * X * 0.5) / (Pi * X * 0.5) * BesselI0(4.0 * std::sqrt(1.0 - Ratio * Ratio)) / BesselI0(4.0));
+		Total += Weights.back();
+	}
+	for (double& Weight : Weights)
+	{
+		Weight /= Total;
+	}
+	return Weights;
+}
+
+// Straightforward double precision downsample with clamped edges, the reference the generator is diffed against
+static void DownsampleReference(const uint8_t* Source, const TextureLevelLayout& SourceLayout, uint8_t* Destination, const TextureLevelLayout& DestinationLayout, MipFilter Filter, bool Srgb)
+{
+	const std::vector<double> Weights = GetReferenceWeights(Filter);
+	const int FirstTap = Filter == MipFilter::Box ? 0 : -2;
+	for (uint32_t Y = 0; Y < DestinationLayout.Height; Y++)
+	{
+		for (uint32_t X = 0; X < DestinationLayout.Width; X++)
+		{
+			double Sum[4] = {};
+			for (size_t RowTap = 0; RowTap < Weights.size(); RowTap++)
+			{
+				const int SourceY = std::min(std::max(2 * static_cast<int>(Y) + FirstTap + static_cast<int>(RowTap), 0), static_cast<int>(SourceLayout.Height) - 1);
+				for (size_t ColumnTap = 0; ColumnTap < Weights.size(); ColumnTap++)
+				{
+					const int SourceX = std::min(std::max(2 * static_cast<int>(X) + FirstTap + static_cast<int>(ColumnTap), 0), static_cast<int>(SourceLayout.Width) - 1);
+					const uint8_t* Texel = Source + static_cast<size_t>(SourceY) * SourceLayout.RowPitch + 4 * SourceX;
+					for (uint32_t Channel = 0; Channel < 4; Channel++)
+					{
+						const double Value = Srgb && Channel < 3 ? DecodeSrgb(Texel[Channel]) : Texel[Channel] / 255.0;
+						Sum[Channel] += Weights[RowTap] * Weights[ColumnTap] * Value;
+					}
+				}
+			}
+
+			uint8_t* Texel = Destination + static_cast<size_t>(Y) * DestinationLayout.RowPitch + 4 * X;
+			for (uint32_t Channel = 0; Channel < 4; Channel++)
+			{
+				const double Encoded = Srgb && Channel < 3 ? EncodeSrgb(Sum[Channel]) : std::min(std::max(Sum[Channel], 0.0), 1.0);
+				// Ties round up like the generator's integer box; the epsilon absorbs the error of dividing by 255
+				Texel[Channel] = static_cast<uint8_t>(std::floor(Encoded * 255.0 + 0.5 + 1e-9));
+			}
+		}
+	}
+}
+
+struct ImageDifference
+{
+	uint32_t MaximumDifference = 0;
+	double Psnr = 0.0;
+};
+
+static ImageDifference CompareLevel(const uint8_t* Actual, const uint8_t* Expected, const TextureLevelLayout& Layout)
+{
+	ImageDifference Difference;
+	double SquaredError = 0.0;
+	for (uint32_t Y = 0; Y < Layout.Height; Y++)
+	{
+		for (uint32_t Byte = 0; Byte < 4 * Layout.Width; Byte++)
+		{
+			const size_t Offset = static_cast<size_t>(Y) * Layout.RowPitch + Byte;
+			const uint32_t Channel = static_cast<uint32_t>(std::abs(Actual[Offset] - Expected[Offset]));
+			Difference.MaximumDifference = std::max(Difference.MaximumDifference, Channel);
+			SquaredError += static_cast<double>(Channel) * Channel;
+		}
+	}
+	const double MeanSquaredError = SquaredError / (4.0 * Layout.Width * Layout.Height);
+	Difference.Psnr = MeanSquaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / MeanSquaredError);
+	return Difference;
+}
+
+// Each level is diffed against the reference downsample of the generator's own level above it, so errors are
+// measured per level rather than accumulated down the chain
+static void CheckChainAgainstReference(uint32_t Width, uint32_t Height, MipFilter Filter, bool Srgb, uint32_t MaximumDifference)
+{
+	MipChain Chain = CreateMipChain(Width, Height, ProceduralPattern::Noise);
+	MipGenerationOptions Options;
+	Options.Filter = Filter;
+	Options.Srgb = Srgb;
+	GenerateMipChain(Chain.Pixels.data(), Chain.Levels, Chain.LevelCount, Options);
+
+	std::vector<uint8_t> Reference(Chain.Pixels.size());
+	for (uint32_t Level = 1; Level < Chain.LevelCount; Level++)
+	{
+		const TextureLevelLayout& Source = Chain.Levels[Level - 1];
+		const TextureLevelLayout& Destination = Chain.Levels[Level];
+		DownsampleReference(Chain.Pixels.data() + Source.Offset, Source, Reference.data() + Destination.Offset, Destination, Filter, Srgb);
+
+		const ImageDifference Difference = CompareLevel(Chain.Pixels.data() + Destination.Offset, Reference.data() + Destination.Offset, Destination);
+		CHECK(Difference.MaximumDifference <= MaximumDifference);
+		CHECK(Difference.Psnr > 50.0);
+		CHECK(Destination.Width == std::max(Source.Width / 2, 1u) && Destination.Height == std::max(Source.Height / 2, 1u));
+	}
+	CHECK(Chain.Levels[Chain.LevelCount - 1].Width == 1 && Chain.Levels[Chain.LevelCount - 1].Height == 1);
+}
+
+TEST_CASE(LinearBoxMatchesTheReferenceExactly)
+{
+	CheckChainAgainstReference(256, 256, MipFilter::Box, false, 0);
+	CheckChainAgainstReference(100, 37, MipFilter::Box, false, 0);
+}
+
+// The sRGB encode goes through a table, which may land one step off the exact curve
+TEST_CASE(SrgbBoxIsWithinOneStepOfTheReference)
+{
+	CheckChainAgainstReference(256, 256, MipFilter::Box, true, 1);
+	CheckChainAgainstReference(100, 37, MipFilter::Box, true, 1);
+}
+
+TEST_CASE(KaiserIsWithinOneStepOfTheReference)
+{
+	CheckChainAgainstReference(256, 256, MipFilter::Kaiser, true, 1);
+	CheckChainAgainstReference(256, 128, MipFilter::Kaiser, false, 1);
+	CheckChainAgainstReference(3, 100, MipFilter::Kaiser, true, 1);
+}
+
+TEST_CASE(FlatImagesStayFlat)
+{
+	for (MipFilter Filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		MipChain Chain = CreateMipChain(64, 64, ProceduralPattern::Checker);
+		for (uint32_t Y = 0; Y < 64; Y++)
+		{
+			for (uint32_t X = 0; X < 64; X++)
+			{
+				const uint8_t Texel[] = { 200, 100, 30, 128 };
+				memcpy(&Chain.Pixels[static_cast<size_t>(Y) * Chain.Levels[0].RowPitch + 4 * X], Texel, 4);
+			}
+		}
+		MipGenerationOptions Options;
+		Options.Filter = Filter;
+		GenerateMipChain(Chain.Pixels.data(), Chain.Levels, Chain.LevelCount, Options);
+
+		const TextureLevelLayout& Last = Chain.Levels[Chain.LevelCount - 1];
+		const uint8_t* Texel = &Chain.Pixels[Last.Offset];
+		CHECK(Texel[0] == 200 && Texel[1] == 100 && Texel[2] == 30 && Texel[3] == 128);
+	}
+}
+
+// Whatever the path, the output is the same bytes, and row padding beyond each level's width is never written
+TEST_CASE(InstructionSetsAndJobsProduceIdenticalChains)
+{
+	JobSystem Jobs(3);
+	for (MipFilter Filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		for (bool Srgb : { false, true })
+		{
+			MipGenerationOptions Options;
+			Options.Filter = Filter;
+			Options.Srgb = Srgb;
+			Options.MaximumInstructionSet = InstructionSet::Scalar;
+			MipChain Expected = CreateMipChain(300, 200, ProceduralPattern::Noise);
+			GenerateMipChain(Expected.Pixels.data(), Expected.Levels, Expected.LevelCount, Options);
+
+			for (uint32_t Set = 0; Set <= static_cast<uint32_t>(InstructionSet::Avx2); Set++)
+			{
+				Options.MaximumInstructionSet = static_cast<InstructionSet>(Set);
+				for (JobSystem* Workers : { static_cast<JobSystem*>(nullptr), &Jobs })
+				{
+					MipChain Actual = CreateMipChain(300, 200, ProceduralPattern::Noise);
+					GenerateMipChain(Actual.Pixels.data(), Actual.Levels, Actual.LevelCount, Options, Workers);
+					CHECK(Actual.Pixels == Expected.Pixels);
+				}
+			}
+
+			// Padding keeps the fill value CreateMipChain wrote
+			const TextureLevelLayout& Level = Expected.Levels[1];
+			CHECK(Expected.Pixels[Level.Offset + 4 * Level.Width] == 0xCD);
+		}
+	}
+}
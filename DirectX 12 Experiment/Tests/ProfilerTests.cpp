@@ -0,0 +1,217 @@
+#include "Profiler.h"
+#include "TestFramework.h"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+static size_t CountOccurrences(const std::string& Text, const std::string& Pattern)
+{
+	size_t Count = 0;
+	for (size_t Position = Text.find(Pattern); Position != std::string::npos; Position = Text.find(Pattern, Position + Pattern.size()))
+	{
+		Count++;
+	}
+	return Count;
+}
+
+static std::string GetChromeTrace(const Profiler& Owner)
+{
+	std::ostringstream Stream;
+	Owner.WriteChromeTrace(Stream);
+	return Stream.str();
+}
+
+// Brackets balance outside strings and every string ends, which is as far as the export can go wrong
+static bool IsBalancedJson(const std::string& Text)
+{
+	std::string Open;
+	bool InString = false;
+	for (size_t Index = 0; Index < Text.size(); Index++)
+	{
+		const char Character = Text[Index];
+		if (InString)
+		{
+			if (Character == '\\') Index++;
+			else if (Character == '"') InString = false;
+			else if (static_cast<unsigned char>(Character) < 0x20) return false;
+			continue;
+		}
+		if (Character == '"') InString = true;
+		else if (Character == '{' || Character == '[') Open.push_back(Character);
+		else if (Character == '}' || Character == ']')
+		{
+			if (Open.empty() || Open.back() != (Character == '}' ? '{' : '[')) return false;
+			Open.pop_back();
+		}
+	}
+	return Open.empty() && !InString;
+}
+
+TEST_CASE(NestedScopesRecordDepthAndContainment)
+{
+	Profiler Owner;
+	Owner.SetCapturing(true);
+	{
+		ProfileScope Frame(&Owner, "Frame");
+		{
+			ProfileScope Render(&Owner, "Render");
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ProfileScope Advance(&Owner, "AdvanceFrame");
+	}
+
+	// Nothing leaves the thread's ring until the frame ends
+	CHECK(Owner.GetCapturedEventCount() == 0);
+	Owner.EndFrame();
+	CHECK(Owner.GetCapturedEventCount() == 3);
+	CHECK(Owner.GetDroppedEventCount() == 0);
+
+	// Scopes are recorded as they close, innermost first
+	const std::string Trace = GetChromeTrace(Owner);
+	const size_t Render = Trace.find("\"name\":\"Render\"");
+	const size_t Advance = Trace.find("\"name\":\"AdvanceFrame\"");
+	const size_t Frame = Trace.find("\"name\":\"Frame\"");
+	REQUIRE(Render != std::string::npos && Advance != std::string::npos && Frame != std::string::npos);
+	CHECK(Render < Advance && Advance < Frame);
+
+	// A null profiler times nothing
+	ProfileScope Disabled(nullptr, "Disabled");
+	Owner.EndFrame();
+	CHECK(Owner.GetCapturedEventCount() == 3);
+}
+
+TEST_CASE(ThreadsRecordIntoTheirOwnRings)
+{
+	const uint32_t ThreadCount = 4;
+	const uint32_t ScopesPerThread = 1000;
+	Profiler Owner(ScopesPerThread);
+	Owner.SetCapturing(true);
+
+	std::vector<std::thread> Threads;
+	for (uint32_t Thread = 0; Thread < ThreadCount; Thread++)
+	{
+		Threads.emplace_back([&Owner, Thread]
+		{
+			Owner.SetThreadName(Thread % 2 == 0 ? "Worker" : "Quoted \"worker\"");
+			for (uint32_t Scope = 0; Scope < ScopesPerThread; Scope++)
+			{
+				ProfileScope Timed(&Owner, "Job");
+			}
+		});
+	}
+	for (std::thread& Thread : Threads)
+	{
+		Thread.join();
+	}
+	Owner.EndFrame();
+
+	CHECK(Owner.GetCapturedEventCount() == ThreadCount * ScopesPerThread);
+	CHECK(Owner.GetDroppedEventCount() == 0);
+
+	const std::string Trace = GetChromeTrace(Owner);
+	CHECK(CountOccurrences(Trace, "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1") == ThreadCount);
+	CHECK(CountOccurrences(Trace, "\"name\":\"Job\",\"ph\":\"X\"") == ThreadCount * ScopesPerThread);
+	CHECK(Trace.find("Quoted \\\"worker\\\"") != std::string::npos);
+	CHECK(IsBalancedJson(Trace));
+}
+
+TEST_CASE(FullRingsDropScopesUntilTheFrameEnds)
+{
+	Profiler Owner(8);
+	Owner.SetCapturing(true);
+	for (uint32_t Scope = 0; Scope < 20; Scope++)
+	{
+		Owner.RecordCpuEvent("Scope", Scope, Scope + 1, 0);
+	}
+	Owner.EndFrame();
+	const uint64_t Dropped = Owner.GetDroppedEventCount();
+	CHECK(Dropped > 0);
+	CHECK(Owner.GetCapturedEventCount() + Dropped == 20);
+
+	// Draining made room again
+	Owner.RecordCpuEvent("Scope", 0, 1, 0);
+	Owner.EndFrame();
+	CHECK(Owner.GetDroppedEventCount() == Dropped);
+	CHECK(Owner.GetCapturedEventCount() + Dropped == 21);
+}
+
+TEST_CASE(EventsAreOnlyKeptWhileCapturing)
+{
+	Profiler Owner;
+	Owner.RecordCpuEvent("Ignored", 0, 1, 0);
+	Owner.RecordGpuEvent("Ignored", 0, 1);
+	Owner.EndFrame();
+	CHECK(Owner.GetCapturedEventCount() == 0);
+
+	Owner.SetCapturing(true);
+	const uint64_t Begin = Profiler::Now();
+	Owner.RecordCpuEvent("Kept", Begin, Begin + 2000, 0);
+	Owner.RecordGpuEvent("Shadow \\ pass\n", Begin + 1000, Begin + 4000);
+	Owner.EndFrame();
+	CHECK(Owner.GetCapturedEventCount() == 2);
+
+	// The GPU interval lands on its own process with its name escaped and its times in microseconds
+	const std::string Trace = GetChromeTrace(Owner);
+	CHECK(IsBalancedJson(Trace));
+	CHECK(Trace.find("\"name\":\"Shadow \\\\ pass\\u000a\",\"ph\":\"X\",\"pid\":2,\"tid\":0") != std::string::npos);
+	CHECK(Trace.find("\"dur\":3.000}") != std::string::npos);
+	CHECK(Trace.find("\"dur\":2.000}") != std::string::npos);
+}
+
+// The GPU side arrives through RecordGpuFrame the way the backend delivers resolved timestamp queries
+TEST_CASE(FrameTimePercentilesRollOverTheWindow)
+{
+	Profiler Owner(64, 100);
+	CHECK(Owner.GetGpuFrameTimePercentile(50.0) == 0.0);
+	CHECK(Owner.GetLastGpuFrameTime() == 0.0);
+
+	// 1 to 100 ms in shuffled order
+	for (uint32_t Frame = 0; Frame < 100; Frame++)
+	{
+		const uint64_t Milliseconds = (Frame * 37) % 100 + 1;
+		Owner.RecordGpuFrame(1000000, 1000000 + Milliseconds * 1000000);
+	}
+	CHECK(Owner.GetGpuFrameCount() == 100);
+	CHECK_NEAR(Owner.GetGpuFrameTimePercentile(50.0), 50.0, 1e-9);
+	CHECK_NEAR(Owner.GetGpuFrameTimePercentile(99.0), 99.0, 1e-9);
+	CHECK_NEAR(Owner.GetGpuFrameTimePercentile(100.0), 100.0, 1e-9);
+	CHECK_NEAR(Owner.GetGpuFrameTimePercentile(0.0), 1.0, 1e-9);
+	CHECK_NEAR(Owner.GetLastGpuFrameTime(), 64.0, 1e-9);
+
+	// A hundred 5 ms frames push every earlier one out
+	for (uint32_t Frame = 0; Frame < 100; Frame++)
+	{
+		Owner.RecordGpuFrame(0, 5000000);
+	}
+	CHECK(Owner.GetGpuFrameCount() == 200);
+	CHECK_NEAR(Owner.GetGpuFrameTimePercentile(99.0), 5.0, 1e-9);
+
+	// CPU frames are timed between EndFrame calls
+	for (uint32_t Frame = 0; Frame < 5; Frame++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Owner.EndFrame();
+	}
+	CHECK(Owner.GetCpuFrameTimePercentile(50.0) >= 2.0);
+	CHECK(Owner.GetCpuFrameTimePercentile(99.0) >= Owner.GetCpuFrameTimePercentile(50.0));
+}
+
+// A thread recording into one profiler and then another keeps a ring in each
+TEST_CASE(ProfilersKeepSeparateRings)
+{
+	Profiler First;
+	Profiler Second;
+	First.SetCapturing(true);
+	Second.SetCapturing(true);
+	for (uint32_t Scope = 0; Scope < 10; Scope++)
+	{
+		ProfileScope InFirst(&First, "First");
+		ProfileScope InSecond(&Second, "Second");
+	}
+	First.EndFrame();
+	Second.EndFrame();
+	CHECK(First.GetCapturedEventCount() == 10 && Second.GetCapturedEventCount() == 10);
+	CHECK(GetChromeTrace(First).find("\"Second\"") == std::string::npos);
+}
@@ -0,0 +1,358 @@
+#include "RenderGraph.h"
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using State = RenderGraphState;
+
+static uint32_t ToBits(State Value)
+{
+	return static_cast<uint32_t>(Value);
+}
+
+// Builds a graph while keeping its own copy of every declaration, which CheckCompiledGraph replays the compiled
+// barriers against
+struct RecordedGraph
+{
+	struct Declaration
+	{
+		RenderGraph::PassHandle Pass;
+		RenderGraph::ResourceHandle Resource;
+		State Required;
+		bool IsWrite;
+	};
+
+	struct ResourceInfo
+	{
+		bool IsTransient;
+		State InitialState;
+		State FinalState;
+		uint64_t Size;
+	};
+
+	RenderGraph Graph;
+	std::vector<ResourceInfo> Resources;
+	std::vector<Declaration> Declarations;
+
+	RenderGraph::ResourceHandle Import(State InitialState, State FinalState)
+	{
+		Resources.push_back({ false, InitialState, FinalState, 0 });
+		return Graph.ImportResource("imported", InitialState, FinalState);
+	}
+
+	RenderGraph::ResourceHandle Transient(uint64_t Size, uint64_t Alignment = 64 * 1024)
+	{
+		Resources.push_back({ true, State::Undefined, State::Undefined, Size });
+		return Graph.CreateTransient("transient", Size, Alignment);
+	}
+
+	void Read(RenderGraph::PassHandle Pass, RenderGraph::ResourceHandle Resource, State Required)
+	{
+		Graph.Read(Pass, Resource, Required);
+		Declarations.push_back({ Pass, Resource, Required, false });
+	}
+
+	void Write(RenderGraph::PassHandle Pass, RenderGraph::ResourceHandle Resource, State Required)
+	{
+		Graph.Write(Pass, Resource, Required);
+		Declarations.push_back({ Pass, Resource, Required, true });
+	}
+};
+
+// Replays the barriers of a compiled graph the way a GPU would apply them and checks that:
+// - passes sharing a resource, one of them writing it, keep their declaration order;
+// - every pass finds each resource in the states it declared, and no split barrier is still in flight;
+// - imported resources end in their final state;
+// - transients sharing memory never live at the same time, and aliasing barriers come at a transient's first use.
+static void CheckCompiledGraph(const RecordedGraph& Recorded)
+{
+	const RenderGraph& Graph = Recorded.Graph;
+	const size_t ResourceCount = Recorded.Resources.size();
+	const std::vector<RenderGraph::PassHandle>& Order = Graph.GetExecutionOrder();
+
+	std::map<RenderGraph::PassHandle, int> Positions;
+	for (size_t Position = 0; Position < Order.size(); Position++)
+	{
+		Positions[Order[Position]] = static_cast<int>(Position);
+	}
+	auto GetPosition = [&Positions](RenderGraph::PassHandle Pass) { auto Found = Positions.find(Pass); return Found != Positions.end() ? Found->second : -1; };
+
+	std::vector<int> FirstUse(ResourceCount, -1), LastUse(ResourceCount, -1);
+	for (const RecordedGraph::Declaration& Use : Recorded.Declarations)
+	{
+		const int Position = GetPosition(Use.Pass);
+		if (Position < 0) continue;
+		if (FirstUse[Use.Resource] < 0 || Position < FirstUse[Use.Resource]) FirstUse[Use.Resource] = Position;
+		LastUse[Use.Resource] = std::max(LastUse[Use.Resource], Position);
+
+		for (const RecordedGraph::Declaration& Later : Recorded.Declarations)
+		{
+			if (Later.Resource != Use.Resource || Later.Pass <= Use.Pass || !(Later.IsWrite || Use.IsWrite) || GetPosition(Later.Pass) < 0) continue;
+			REQUIRE(Position < GetPosition(Later.Pass));
+		}
+	}
+
+	std::vector<uint32_t> Current(ResourceCount);
+	std::vector<bool> InFlight(ResourceCount, false), Used(ResourceCount, false);
+	for (size_t Resource = 0; Resource < ResourceCount; Resource++)
+	{
+		Current[Resource] = ToBits(Recorded.Resources[Resource].InitialState);
+	}
+
+	for (uint32_t Position = 0; Position <= Order.size(); Position++)
+	{
+		const RenderGraphBarrier* Barriers;
+		uint32_t BarrierCount;
+		Graph.GetBarriers(Position, Barriers, BarrierCount);
+		for (uint32_t Index = 0; Index < BarrierCount; Index++)
+		{
+			const RenderGraphBarrier& Barrier = Barriers[Index];
+			if (Barrier.Type == RenderGraphBarrierType::Aliasing)
+			{
+				REQUIRE(Recorded.Resources[Barrier.Resource].IsTransient && FirstUse[Barrier.Resource] == static_cast<int>(Position));
+			}
+			if (Barrier.Type != RenderGraphBarrierType::Transition) continue;
+
+			if (Barrier.Split == RenderGraphBarrierSplit::End)
+			{
+				REQUIRE(InFlight[Barrier.Resource]);
+				InFlight[Barrier.Resource] = false;
+				Current[Barrier.Resource] = ToBits(Barrier.StateAfter);
+				continue;
+			}
+			REQUIRE(!InFlight[Barrier.Resource] && Current[Barrier.Resource] == ToBits(Barrier.StateBefore));
+			if (Barrier.Split == RenderGraphBarrierSplit::Begin)
+			{
+				InFlight[Barrier.Resource] = true;
+			}
+			else
+			{
+				Current[Barrier.Resource] = ToBits(Barrier.StateAfter);
+			}
+		}
+		if (Position == Order.size()) break;
+
+		for (const RecordedGraph::Declaration& Use : Recorded.Declarations)
+		{
+			if (Use.Pass != Order[Position]) continue;
+			REQUIRE(!InFlight[Use.Resource]);
+
+			// A pass reading one resource in several states needs all of them at once
+			uint32_t Required = 0;
+			for (const RecordedGraph::Declaration& Other : Recorded.Declarations)
+			{
+				if (Other.Pass == Use.Pass && Other.Resource == Use.Resource) Required |= ToBits(Other.Required);
+			}
+
+			// Transient memory takes the state of its first use
+			if (Recorded.Resources[Use.Resource].IsTransient && !Used[Use.Resource]) Current[Use.Resource] = Required;
+			Used[Use.Resource] = true;
+			REQUIRE(Use.IsWrite ? Current[Use.Resource] == Required : (Current[Use.Resource] & Required) == Required);
+		}
+	}
+
+	for (size_t Resource = 0; Resource < ResourceCount; Resource++)
+	{
+		REQUIRE(!InFlight[Resource]);
+		if (!Recorded.Resources[Resource].IsTransient) REQUIRE(Current[Resource] == ToBits(Recorded.Resources[Resource].FinalState));
+	}
+
+	for (size_t First = 0; First < ResourceCount; First++)
+	{
+		for (size_t Second = First + 1; Second < ResourceCount; Second++)
+		{
+			if (!Recorded.Resources[First].IsTransient || !Recorded.Resources[Second].IsTransient || FirstUse[First] < 0 || FirstUse[Second] < 0) continue;
+			const uint64_t FirstOffset = Graph.GetTransientOffset(static_cast<RenderGraph::ResourceHandle>(First));
+			const uint64_t SecondOffset = Graph.GetTransientOffset(static_cast<RenderGraph::ResourceHandle>(Second));
+			const bool SharedMemory = FirstOffset < SecondOffset + Recorded.Resources[Second].Size && SecondOffset < FirstOffset + Recorded.Resources[First].Size;
+			const bool SharedLifetime = FirstUse[First] <= LastUse[Second] && FirstUse[Second] <= LastUse[First];
+			REQUIRE(!(SharedMemory && SharedLifetime));
+		}
+	}
+}
+
+TEST_CASE(SinglePassTransitionsTheBackBufferAndBack)
+{
+	RenderGraph Graph;
+	const RenderGraph::ResourceHandle BackBuffer = Graph.ImportResource("Back buffer", State::Present, State::Present);
+	uint32_t Runs = 0;
+	const RenderGraph::PassHandle Scene = Graph.AddPass("Scene", [&Runs]() { Runs++; });
+	Graph.Write(Scene, BackBuffer, State::RenderTarget);
+	Graph.Compile();
+
+	const RenderGraphStatistics& Statistics = Graph.GetStatistics();
+	CHECK(Statistics.TransitionBarrierCount == 2 && Statistics.BarrierBatchCount == 2 && Statistics.SplitBarrierCount == 0);
+
+	std::vector<RenderGraphBarrier> Recorded;
+	Graph.Execute([&Recorded](const RenderGraphBarrier* Barriers, uint32_t BarrierCount) { Recorded.insert(Recorded.end(), Barriers, Barriers + BarrierCount); });
+	CHECK(Runs == 1);
+	REQUIRE(Recorded.size() == 2);
+	CHECK(Recorded[0].StateBefore == State::Present && Recorded[0].StateAfter == State::RenderTarget);
+	CHECK(Recorded[1].StateBefore == State::RenderTarget && Recorded[1].StateAfter == State::Present);
+}
+
+// Shadows, G-buffer, lighting, bloom and post processing, plus a debug pass nothing reads
+TEST_CASE(DeferredFrameCullsAliasesMergesAndSplits)
+{
+	RecordedGraph Frame;
+	const RenderGraph::ResourceHandle BackBuffer = Frame.Import(State::Present, State::Present);
+	const RenderGraph::ResourceHandle ShadowMap = Frame.Import(State::PixelShaderResource, State::PixelShaderResource);
+	const RenderGraph::ResourceHandle Albedo = Frame.Transient(8 << 20);
+	const RenderGraph::ResourceHandle Depth = Frame.Transient(4 << 20);
+	const RenderGraph::ResourceHandle Hdr = Frame.Transient(16 << 20);
+	const RenderGraph::ResourceHandle Bloom = Frame.Transient(4 << 20);
+	const RenderGraph::ResourceHandle Debug = Frame.Transient(8 << 20);
+	const RenderGraph::ResourceHandle HalfSize = Frame.Transient(8 << 20);
+
+	const RenderGraph::PassHandle Shadows = Frame.Graph.AddPass("Shadows", nullptr);
+	Frame.Write(Shadows, ShadowMap, State::DepthWrite);
+	const RenderGraph::PassHandle GBuffer = Frame.Graph.AddPass("G-buffer", nullptr);
+	Frame.Write(GBuffer, Albedo, State::RenderTarget);
+	Frame.Write(GBuffer, Depth, State::DepthWrite);
+	const RenderGraph::PassHandle DebugView = Frame.Graph.AddPass("Debug view", nullptr);
+	Frame.Read(DebugView, Depth, State::PixelShaderResource);
+	Frame.Write(DebugView, Debug, State::RenderTarget);
+	const RenderGraph::PassHandle Lighting = Frame.Graph.AddPass("Lighting", nullptr);
+	Frame.Read(Lighting, Albedo, State::PixelShaderResource);
+	Frame.Read(Lighting, Depth, State::DepthRead);
+	Frame.Read(Lighting, ShadowMap, State::PixelShaderResource);
+	Frame.Write(Lighting, Hdr, State::RenderTarget);
+	const RenderGraph::PassHandle Downsample = Frame.Graph.AddPass("Downsample", nullptr);
+	Frame.Read(Downsample, Hdr, State::PixelShaderResource);
+	Frame.Write(Downsample, HalfSize, State::RenderTarget);
+	const RenderGraph::PassHandle BloomBlur = Frame.Graph.AddPass("Bloom blur", nullptr);
+	Frame.Read(BloomBlur, HalfSize, State::NonPixelShaderResource);
+	Frame.Write(BloomBlur, Bloom, State::UnorderedAccess);
+	const RenderGraph::PassHandle BloomBlurAgain = Frame.Graph.AddPass("Bloom blur again", nullptr);
+	Frame.Write(BloomBlurAgain, Bloom, State::UnorderedAccess);
+	const RenderGraph::PassHandle Composite = Frame.Graph.AddPass("Composite", nullptr);
+	Frame.Read(Composite, Hdr, State::CopySource);
+	Frame.Read(Composite, Depth, State::CopySource);
+	Frame.Write(Composite, Bloom, State::UnorderedAccess);
+	const RenderGraph::PassHandle Post = Frame.Graph.AddPass("Post", nullptr);
+	Frame.Read(Post, Hdr, State::PixelShaderResource);
+	Frame.Read(Post, Bloom, State::PixelShaderResource);
+	Frame.Write(Post, BackBuffer, State::RenderTarget);
+
+	Frame.Graph.Compile();
+	CheckCompiledGraph(Frame);
+
+	const std::vector<RenderGraph::PassHandle>& Order = Frame.Graph.GetExecutionOrder();
+	CHECK(std::find(Order.begin(), Order.end(), DebugView) == Order.end());
+
+	const RenderGraphStatistics& Statistics = Frame.Graph.GetStatistics();
+	CHECK(Statistics.PassCount == 8 && Statistics.CulledPassCount == 1);
+	CHECK(Statistics.AliasingBarrierCount > 0);
+	CHECK(Statistics.TransientHeapBytes < Statistics.TransientBytes);
+	CHECK(Statistics.GetSavedTransientBytes() == Statistics.TransientBytes - Statistics.TransientHeapBytes);
+	CHECK(Statistics.MergedReadCount > 0);
+	CHECK(Statistics.SplitBarrierCount > 0);
+
+	// The three back to back writes of the bloom target are separated by UAV barriers
+	CHECK(Statistics.UnorderedAccessBarrierCount == 2);
+}
+
+TEST_CASE(InvalidDeclarationsThrow)
+{
+	RenderGraph Graph;
+	const RenderGraph::ResourceHandle Target = Graph.CreateTransient("Target", 16, 16);
+	const RenderGraph::PassHandle Pass = Graph.AddPass("Pass", nullptr);
+
+	// Transient memory must be written before it is read
+	CHECK_THROWS(Graph.Read(Pass, Target, State::RenderTarget));
+	Graph.Write(Pass, Target, State::RenderTarget);
+	CHECK_THROWS(Graph.Read(Pass, Target, State::PixelShaderResource));
+	CHECK_THROWS(Graph.CreateTransient("Misaligned", 16, 3));
+	CHECK_THROWS(Graph.Execute([](const RenderGraphBarrier*, uint32_t) {}));
+}
+
+TEST_CASE(ResetGraphsCompileTheSameFrameAgain)
+{
+	RenderGraph Graph;
+	std::vector<uint32_t> BatchCounts;
+	for (uint32_t Frame = 0; Frame < 2; Frame++)
+	{
+		Graph.Reset();
+		const RenderGraph::ResourceHandle BackBuffer = Graph.ImportResource("Back buffer", State::Present, State::Present);
+		const RenderGraph::ResourceHandle Scene = Graph.CreateTransient("Scene", 1 << 20, 64 * 1024);
+		const RenderGraph::PassHandle Draw = Graph.AddPass("Draw", nullptr);
+		Graph.Write(Draw, Scene, State::RenderTarget);
+		const RenderGraph::PassHandle Upscale = Graph.AddPass("Upscale", nullptr);
+		Graph.Read(Upscale, Scene, State::PixelShaderResource);
+		Graph.Write(Upscale, BackBuffer, State::RenderTarget);
+		Graph.Compile();
+		BatchCounts.push_back(Graph.GetStatistics().BarrierBatchCount);
+		CHECK(Graph.GetExecutionOrder().size() == 2 && Graph.GetStatistics().TransientBytes == 1 << 20);
+	}
+	CHECK(BatchCounts[0] == BatchCounts[1]);
+}
+
+TEST_CASE(RandomGraphsCompileToValidBarriers)
+{
+	const State Reads[] = { State::PixelShaderResource, State::NonPixelShaderResource, State::CopySource, State::DepthRead, State::VertexBuffer, State::IndirectArgument };
+	const State Writes[] = { State::RenderTarget, State::DepthWrite, State::UnorderedAccess, State::CopyDestination };
+	std::mt19937 Random(7);
+	auto RandomImportedState = [&]() { return Random() % 3 == 0 ? State::Present : Random() % 2 ? Reads[Random() % 6] : Writes[Random() % 4]; };
+
+	for (uint32_t Iteration = 0; Iteration < 2000; Iteration++)
+	{
+		RecordedGraph Recorded;
+		const uint32_t ResourceCount = 1 + Random() % 10;
+		const uint32_t PassCount = 1 + Random() % 15;
+		for (uint32_t Resource = 0; Resource < ResourceCount; Resource++)
+		{
+			if (Random() % 2)
+			{
+				const State InitialState = RandomImportedState();
+				Recorded.Import(InitialState, RandomImportedState());
+			}
+			else
+			{
+				Recorded.Transient((1 + Random() % 64) * 1024, 1ull << (Random() % 13));
+			}
+		}
+
+		for (uint32_t Pass = 0; Pass < PassCount; Pass++)
+		{
+			Recorded.Graph.AddPass("Pass", nullptr, Random() % 8 == 0);
+
+			// A resource may be read in several states by one pass, but never read and written
+			std::map<uint32_t, bool> Written;
+			const uint32_t AccessCount = Random() % 4;
+			for (uint32_t Access = 0; Access < AccessCount; Access++)
+			{
+				const uint32_t Resource = Random() % ResourceCount;
+				auto Previous = Written.find(Resource);
+				if (Previous != Written.end())
+				{
+					if (!Previous->second && Random() % 2) Recorded.Read(Pass, Resource, Reads[Random() % 6]);
+					continue;
+				}
+
+				// Transients are written before anything reads them
+				const bool IsWrite = Random() % 2 == 0;
+				try
+				{
+					if (IsWrite)
+					{
+						Recorded.Write(Pass, Resource, Writes[Random() % 4]);
+					}
+					else
+					{
+						Recorded.Read(Pass, Resource, Reads[Random() % 6]);
+					}
+					Written[Resource] = IsWrite;
+				}
+				catch (const std::runtime_error&)
+				{
+					REQUIRE(!IsWrite && Recorded.Resources[Resource].IsTransient);
+				}
+			}
+		}
+
+		Recorded.Graph.Compile();
+		CheckCompiledGraph(Recorded);
+	}
+}
@@ -0,0 +1,339 @@
+#include "ResourceStateTracker.h"
+#include "TestFramework.h"
+
+#include <map>
+#include <memory>
+#include <random>
+
+using State = RenderGraphState;
+using Handle = ResourceStateRegistry::Handle;
+
+static const uint32_t AllSubresources = ResourceStateRegistry::AllSubresources;
+
+static uint32_t ToBits(State Value)
+{
+	return static_cast<uint32_t>(Value);
+}
+
+// Collects every batch a tracker flushes, as the command list would see them
+struct RecordedBatches
+{
+	std::vector<std::vector<ResourceStateBarrier>> Batches;
+
+	ResourceStateTracker::BarrierCallback GetCallback()
+	{
+		return [this](const ResourceStateBarrier* Barriers, uint32_t BarrierCount) { Batches.emplace_back(Barriers, Barriers + BarrierCount); };
+	}
+};
+
+// The state of every subresource as the GPU sees it. Barriers must start from the state the subresource is in, and
+// every use must find the subresource in the requested state or in a read-only combination that includes it.
+struct SimulatedGpu
+{
+	std::map<Handle, std::vector<uint32_t>> States;
+	bool Valid = true;
+
+	void Apply(const ResourceStateBarrier& Barrier)
+	{
+		if (Barrier.IsUnorderedAccess) return;
+
+		std::vector<uint32_t>& Subresources = States.at(Barrier.Resource);
+		const uint32_t First = Barrier.Subresource == AllSubresources ? 0 : Barrier.Subresource;
+		const uint32_t Last = Barrier.Subresource == AllSubresources ? static_cast<uint32_t>(Subresources.size()) - 1 : Barrier.Subresource;
+		for (uint32_t Index = First; Index <= Last; Index++)
+		{
+			Valid &= Subresources[Index] == ToBits(Barrier.StateBefore) && Barrier.StateBefore != Barrier.StateAfter;
+			Subresources[Index] = ToBits(Barrier.StateAfter);
+		}
+	}
+
+	void Use(Handle Resource, uint32_t Subresource, State Required)
+	{
+		const uint32_t WritableStates = ToBits(State::Present | State::RenderTarget | State::DepthWrite | State::UnorderedAccess | State::CopyDestination);
+		const std::vector<uint32_t>& Subresources = States.at(Resource);
+		const uint32_t First = Subresource == AllSubresources ? 0 : Subresource;
+		const uint32_t Last = Subresource == AllSubresources ? static_cast<uint32_t>(Subresources.size()) - 1 : Subresource;
+		for (uint32_t Index = First; Index <= Last; Index++)
+		{
+			const uint32_t Current = Subresources[Index];
+			const bool ReadOnly = (Current & WritableStates) == 0 && (ToBits(Required) & WritableStates) == 0;
+			Valid &= Current == ToBits(Required) || (ReadOnly && (Current & ToBits(Required)) == ToBits(Required));
+		}
+	}
+};
+
+TEST_CASE(RedundantTransitionsAreElided)
+{
+	ResourceStateRegistry Registry;
+	int Texture = 0;
+	const Handle Resource = Registry.Register(&Texture, 1, State::CopyDestination);
+	ResourceStateTracker Tracker(Registry);
+	RecordedBatches Recorded;
+
+	// The first use only becomes a requirement; the repeat and a read-only subset of the state are no-ops
+	Tracker.Transition(Resource, State::PixelShaderResource | State::NonPixelShaderResource);
+	Tracker.Transition(Resource, State::PixelShaderResource | State::NonPixelShaderResource);
+	Tracker.Transition(Resource, State::PixelShaderResource);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	CHECK(Recorded.Batches.empty());
+	CHECK(Tracker.GetStatistics().ElidedBarriers == 2);
+
+	// Transitions that cancel out before a flush reach nothing
+	Tracker.Transition(Resource, State::RenderTarget);
+	Tracker.Transition(Resource, State::PixelShaderResource | State::NonPixelShaderResource);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	CHECK(Recorded.Batches.empty());
+	CHECK(Tracker.GetStatistics().ElidedBarriers == 4);
+
+	// A chain collapses into one barrier from the first state to the last
+	Tracker.Transition(Resource, State::RenderTarget);
+	Tracker.Transition(Resource, State::CopySource);
+	Tracker.Transition(Resource, State::CopyDestination);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 1 && Recorded.Batches[0].size() == 1);
+	const ResourceStateBarrier& Barrier = Recorded.Batches[0][0];
+	CHECK(Barrier.Native == &Texture && Barrier.Subresource == AllSubresources);
+	CHECK(Barrier.StateBefore == (State::PixelShaderResource | State::NonPixelShaderResource) && Barrier.StateAfter == State::CopyDestination);
+	CHECK(Tracker.GetStatistics().IssuedBarriers == 1 && Tracker.GetStatistics().BarrierBatches == 1);
+}
+
+TEST_CASE(PendingTransitionsFlushAsOneBatch)
+{
+	ResourceStateRegistry Registry;
+	std::vector<Handle> Resources;
+	for (uint32_t Index = 0; Index < 4; Index++)
+	{
+		Resources.push_back(Registry.Register(nullptr, 1, State::PixelShaderResource));
+	}
+	ResourceStateTracker Tracker(Registry);
+	RecordedBatches Recorded;
+	for (Handle Resource : Resources)
+	{
+		Tracker.Transition(Resource, State::PixelShaderResource);
+	}
+	for (Handle Resource : Resources)
+	{
+		Tracker.Transition(Resource, State::RenderTarget);
+	}
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 1);
+	CHECK(Recorded.Batches[0].size() == Resources.size());
+
+	// Back to back UAV barriers with nothing between them order the same work
+	Tracker.Transition(Resources[0], State::UnorderedAccess);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	Tracker.UnorderedAccessBarrier(Resources[0]);
+	Tracker.UnorderedAccessBarrier(Resources[0]);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 3);
+	CHECK(Recorded.Batches[2].size() == 1 && Recorded.Batches[2][0].IsUnorderedAccess);
+
+	const ResourceStateStatistics& Statistics = Tracker.GetStatistics();
+	CHECK(Statistics.IssuedBarriers == 6 && Statistics.BarrierBatches == 3 && Statistics.ElidedBarriers == 1);
+}
+
+TEST_CASE(SubresourcesAreTrackedSeparately)
+{
+	ResourceStateRegistry Registry;
+	const Handle Resource = Registry.Register(nullptr, 4, State::CopyDestination);
+	ResourceStateTracker Tracker(Registry);
+	RecordedBatches Recorded;
+
+	// A whole resource in one known state moves with a single barrier
+	Tracker.Transition(Resource, State::CopyDestination);
+	Tracker.Transition(Resource, State::PixelShaderResource);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 1 && Recorded.Batches[0].size() == 1);
+	CHECK(Recorded.Batches[0][0].Subresource == AllSubresources);
+
+	// Mip 2 on its own, then the whole resource needs one barrier for each subresource that moves
+	Tracker.Transition(Resource, State::RenderTarget, 2);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 2 && Recorded.Batches[1].size() == 1);
+	CHECK(Recorded.Batches[1][0].Subresource == 2 && Recorded.Batches[1][0].StateAfter == State::RenderTarget);
+
+	Tracker.Transition(Resource, State::PixelShaderResource);
+	Tracker.FlushBarriers(Recorded.GetCallback());
+	REQUIRE(Recorded.Batches.size() == 3 && Recorded.Batches[2].size() == 1);
+	CHECK(Recorded.Batches[2][0].Subresource == 2 && Recorded.Batches[2][0].StateBefore == State::RenderTarget);
+	CHECK_THROWS(Tracker.Transition(Resource, State::RenderTarget, 4));
+}
+
+TEST_CASE(ResolveBridgesStatesBetweenLists)
+{
+	ResourceStateRegistry Registry;
+	const Handle Resource = Registry.Register(nullptr, 1, State::Present);
+	RecordedBatches Recorded;
+
+	// Both lists record before either is submitted, so neither knows the other's final state
+	ResourceStateTracker First(Registry);
+	First.Transition(Resource, State::RenderTarget);
+	First.Transition(Resource, State::PixelShaderResource);
+	First.FlushBarriers(Recorded.GetCallback());
+	ResourceStateTracker Second(Registry);
+	Second.Transition(Resource, State::CopySource);
+	Second.FlushBarriers(Recorded.GetCallback());
+
+	std::vector<ResourceStateBarrier> Resolved;
+	First.Resolve(Resolved);
+	REQUIRE(Resolved.size() == 1);
+	CHECK(Resolved[0].StateBefore == State::Present && Resolved[0].StateAfter == State::RenderTarget);
+	CHECK(Registry.GetState(Resource, 0) == State::PixelShaderResource);
+
+	Resolved.clear();
+	Second.Resolve(Resolved);
+	REQUIRE(Resolved.size() == 1);
+	CHECK(Resolved[0].StateBefore == State::PixelShaderResource && Resolved[0].StateAfter == State::CopySource);
+	CHECK(Registry.GetState(Resource, 0) == State::CopySource);
+
+	// The frame counters add up both lists, and reading them clears them
+	const ResourceStateStatistics Frame = Registry.TakeFrameStatistics();
+	CHECK(Frame.ResolvedBarriers == 2 && Frame.IssuedBarriers == 3);
+	CHECK(Registry.TakeFrameStatistics().IssuedBarriers == 0);
+
+	// Submitting with barriers still queued is an error
+	ResourceStateTracker Third(Registry);
+	Third.Transition(Resource, State::CopySource);
+	Third.Transition(Resource, State::RenderTarget);
+	CHECK_THROWS(Third.Resolve(Resolved));
+}
+
+TEST_CASE(UnregisteredHandlesAreRejected)
+{
+	ResourceStateRegistry Registry;
+	const Handle Old = Registry.Register(nullptr, 1, State::Present);
+	Registry.Unregister(Old);
+	const Handle Reused = Registry.Register(nullptr, 1, State::CopySource);
+	CHECK(Reused != Old);
+	CHECK(!Registry.IsRegistered(Old) && Registry.IsRegistered(Reused));
+
+	ResourceStateTracker Tracker(Registry);
+	CHECK_THROWS(Tracker.Transition(Old, State::RenderTarget));
+	CHECK_THROWS(Registry.Unregister(Old));
+	CHECK_THROWS(Registry.Register(nullptr, 0, State::Present));
+	CHECK_THROWS(Registry.Register(nullptr, 1, State::Undefined));
+
+	// A resource unregistered while a list still tracks it is skipped at submit
+	Tracker.Transition(Reused, State::RenderTarget);
+	Registry.Unregister(Reused);
+	std::vector<ResourceStateBarrier> Resolved;
+	Tracker.Resolve(Resolved);
+	CHECK(Resolved.empty());
+}
+
+// Random command streams over several lists per frame, recorded independently and submitted in order. Every
+// barrier and every use is replayed on a simulated GPU, which must agree with the registry after each frame.
+TEST_CASE(RandomCommandStreamsKeepStatesConsistent)
+{
+	const State States[] =
+	{
+		State::RenderTarget, State::DepthWrite, State::UnorderedAccess, State::CopyDestination, State::PixelShaderResource, State::NonPixelShaderResource,
+		State::CopySource, State::VertexBuffer, State::PixelShaderResource | State::NonPixelShaderResource, State::Present
+	};
+	const uint32_t StateCount = sizeof(States) / sizeof(States[0]);
+
+	struct Command
+	{
+		bool IsBatch;
+		std::vector<ResourceStateBarrier> Batch;
+		Handle Resource;
+		uint32_t Subresource;
+		State Required;
+	};
+
+	std::mt19937 Random(11);
+	uint64_t RequestedTransitions = 0;
+	ResourceStateStatistics Total;
+	for (uint32_t Stream = 0; Stream < 500; Stream++)
+	{
+		ResourceStateRegistry Registry;
+		SimulatedGpu Gpu;
+		std::vector<Handle> Resources;
+		const uint32_t ResourceCount = 1 + Random() % 6;
+		for (uint32_t Index = 0; Index < ResourceCount; Index++)
+		{
+			const uint32_t SubresourceCount = 1 + Random() % 4;
+			const State InitialState = States[Random() % StateCount];
+			Resources.push_back(Registry.Register(nullptr, SubresourceCount, InitialState));
+			Gpu.States[Resources.back()].assign(SubresourceCount, ToBits(InitialState));
+		}
+
+		for (uint32_t Frame = 0; Frame < 3; Frame++)
+		{
+			const uint32_t ListCount = 1 + Random() % 4;
+			std::vector<std::unique_ptr<ResourceStateTracker>> Trackers;
+			std::vector<std::vector<Command>> Lists(ListCount);
+			for (uint32_t List = 0; List < ListCount; List++)
+			{
+				Trackers.emplace_back(new ResourceStateTracker(Registry));
+				ResourceStateTracker& Tracker = *Trackers.back();
+				const auto RecordBatch = [&Lists, List](const ResourceStateBarrier* Barriers, uint32_t BarrierCount)
+				{
+					Command Batch = {};
+					Batch.IsBatch = true;
+					Batch.Batch.assign(Barriers, Barriers + BarrierCount);
+					Lists[List].push_back(Batch);
+				};
+
+				const uint32_t OperationCount = Random() % 30;
+				for (uint32_t Operation = 0; Operation < OperationCount; Operation++)
+				{
+					const Handle Resource = Resources[Random() % ResourceCount];
+					const uint32_t SubresourceCount = static_cast<uint32_t>(Gpu.States[Resource].size());
+					const uint32_t Subresource = Random() % 3 == 0 ? AllSubresources : Random() % SubresourceCount;
+					const State Required = States[Random() % StateCount];
+					Tracker.Transition(Resource, Required, Subresource);
+					RequestedTransitions++;
+
+					// Some transitions are followed by a command that uses the resource, which needs them flushed
+					if (Random() % 3 != 0)
+					{
+						Tracker.FlushBarriers(RecordBatch);
+						Command Use = {};
+						Use.Resource = Resource;
+						Use.Subresource = Subresource;
+						Use.Required = Required;
+						Lists[List].push_back(Use);
+					}
+				}
+				Tracker.FlushBarriers(RecordBatch);
+			}
+
+			for (uint32_t List = 0; List < ListCount; List++)
+			{
+				std::vector<ResourceStateBarrier> Resolved;
+				Trackers[List]->Resolve(Resolved);
+				for (const ResourceStateBarrier& Barrier : Resolved)
+				{
+					Gpu.Apply(Barrier);
+				}
+				for (const Command& Recorded : Lists[List])
+				{
+					if (!Recorded.IsBatch)
+					{
+						Gpu.Use(Recorded.Resource, Recorded.Subresource, Recorded.Required);
+						continue;
+					}
+					for (const ResourceStateBarrier& Barrier : Recorded.Batch)
+					{
+						Gpu.Apply(Barrier);
+					}
+				}
+			}
+			REQUIRE(Gpu.Valid);
+
+			for (Handle Resource : Resources)
+			{
+				for (uint32_t Index = 0; Index < Gpu.States[Resource].size(); Index++)
+				{
+					CHECK(ToBits(Registry.GetState(Resource, Index)) == Gpu.States[Resource][Index]);
+				}
+			}
+			Total.Add(Registry.TakeFrameStatistics());
+		}
+	}
+
+	// Random streams are full of no-ops and transitions that cancel out before a flush
+	CHECK(Total.ElidedBarriers > RequestedTransitions / 10);
+	CHECK(Total.IssuedBarriers > 0 && Total.ResolvedBarriers > 0);
+}
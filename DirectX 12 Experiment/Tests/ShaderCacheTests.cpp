@@ -0,0 +1,221 @@
+#include "JobSystem.h"
+#include "ShaderCache.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+// Stands in for D3DCompileFromFile: the bytecode spells out the request and the source, a source mentioning
+// "#include" depends on Common.hlsli, and one containing "error" fails to compile
+struct StubCompiler
+{
+	std::string CommonPath;
+	std::atomic<uint32_t> CompileCount{ 0 };
+
+	ShaderCompileResult operator()(const ShaderCompileRequest& Request)
+	{
+		CompileCount++;
+		ShaderCompileResult Result;
+		MappedFile Source;
+		if (!Source.Open(Request.Path))
+		{
+			Result.Messages = "cannot open " + Request.Path;
+			return Result;
+		}
+
+		const std::string Text(reinterpret_cast<const char*>(Source.GetData()), Source.GetSize());
+		if (Text.find("#include") != std::string::npos) Result.Includes.push_back(CommonPath);
+		if (Text.find("error") != std::string::npos)
+		{
+			Result.Messages = Request.Path + "(1): error X3000: syntax error";
+			return Result;
+		}
+
+		const std::string Bytecode = Request.EntryPoint + "|" + Request.Profile + "|" + std::to_string(Request.Flags) + "|" + Text;
+		Result.Bytecode.assign(Bytecode.begin(), Bytecode.end());
+		Result.Succeeded = true;
+		return Result;
+	}
+};
+
+// Source files, requests and a pack path of their own for each case, so cases never see each other's packs
+struct ShaderFixture
+{
+	std::string Directory = GetTestTemporaryDirectory();
+	std::string Prefix;
+	std::string PackPath;
+	StubCompiler Compiler;
+	ShaderCompileRequest Requests[3];
+
+	explicit ShaderFixture(const char* Name) :
+		Prefix(Directory + "ShaderCacheTests" + Name),
+		PackPath(Prefix + ".pack")
+	{
+		std::remove(PackPath.c_str());
+		Compiler.CommonPath = Prefix + "Common.hlsli";
+		WriteSource("Common.hlsli", "float4 Tint;");
+		WriteSource("Vertex.hlsl", "#include \"Common.hlsli\"\nvertex");
+		WriteSource("Pixel.hlsl", "pixel");
+
+		Requests[0] = { Prefix + "Vertex.hlsl", "VSMain", "vs_5_0", 0 };
+		Requests[1] = { Prefix + "Pixel.hlsl", "PSMain", "ps_5_0", 0 };
+		Requests[2] = { Prefix + "Pixel.hlsl", "PSMain", "ps_5_0", 1 };
+	}
+
+	void WriteSource(const char* Name, const std::string& Text)
+	{
+		REQUIRE(WriteFileAtomically(Prefix + Name, Text.data(), Text.size()));
+	}
+
+	ShaderCompiler GetCompiler()
+	{
+		return [this](const ShaderCompileRequest& Request) { return Compiler(Request); };
+	}
+};
+
+static std::string ToString(const ShaderBytecode& Bytecode)
+{
+	return std::string(reinterpret_cast<const char*>(Bytecode.Data), Bytecode.Size);
+}
+
+TEST_CASE(WarmStartsServeEveryShaderFromThePack)
+{
+	ShaderFixture Fixture("Warm");
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		CHECK(!Cache.Load());
+		const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Fixture.Requests, 3);
+		REQUIRE(Bytecode.size() == 3);
+		CHECK(ToString(Bytecode[0]) == "VSMain|vs_5_0|0|#include \"Common.hlsli\"\nvertex");
+		CHECK(ToString(Bytecode[2]) == "PSMain|ps_5_0|1|pixel");
+		CHECK(Cache.GetStatistics().Misses == 3 && Cache.GetStatistics().Hits == 0);
+		CHECK(Cache.Save());
+	}
+	CHECK(Fixture.Compiler.CompileCount == 3);
+
+	ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+	REQUIRE(Cache.Load());
+	const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Fixture.Requests, 3);
+	CHECK(Fixture.Compiler.CompileCount == 3);
+	CHECK(Cache.GetStatistics().Hits == 3 && Cache.GetStatistics().Misses == 0);
+	CHECK(ToString(Bytecode[1]) == "PSMain|ps_5_0|0|pixel");
+
+	// Hits point into the mapping, aligned for the runtime
+	CHECK(reinterpret_cast<uintptr_t>(Bytecode[0].Data) % 16 == 0);
+}
+
+TEST_CASE(EditingAnIncludeRecompilesOnlyItsDependents)
+{
+	ShaderFixture Fixture("Include");
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		Cache.Resolve(Fixture.Requests, 3);
+		CHECK(Cache.Save());
+	}
+
+	Fixture.WriteSource("Common.hlsli", "float4 Tint; float Scale;");
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		REQUIRE(Cache.Load());
+		Cache.Resolve(Fixture.Requests, 3);
+		CHECK(Cache.GetStatistics().Misses == 1 && Cache.GetStatistics().Hits == 2);
+		CHECK(Cache.Save());
+	}
+	CHECK(Fixture.Compiler.CompileCount == 4);
+
+	// The main source counts too
+	Fixture.WriteSource("Pixel.hlsl", "pixel2");
+	ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+	REQUIRE(Cache.Load());
+	const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Fixture.Requests, 3);
+	CHECK(Cache.GetStatistics().Misses == 2 && Cache.GetStatistics().Hits == 1);
+	CHECK(ToString(Bytecode[1]) == "PSMain|ps_5_0|0|pixel2");
+}
+
+// Switching compilers misses, and the entries of the first compiler survive the second one's save
+TEST_CASE(CompilerIdentityIsPartOfTheKey)
+{
+	ShaderFixture Fixture("Identity");
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		Cache.Resolve(Fixture.Requests, 3);
+		CHECK(Cache.Save());
+	}
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 2.0", Fixture.GetCompiler());
+		REQUIRE(Cache.Load());
+		Cache.Resolve(Fixture.Requests, 1);
+		CHECK(Cache.GetStatistics().Misses == 1);
+		CHECK(Cache.Save());
+	}
+
+	ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+	REQUIRE(Cache.Load());
+	Cache.Resolve(Fixture.Requests, 3);
+	CHECK(Cache.GetStatistics().Hits == 3);
+	CHECK(Fixture.Compiler.CompileCount == 4);
+}
+
+TEST_CASE(FailedCompilesThrowWithTheCompilerMessages)
+{
+	ShaderFixture Fixture("Failure");
+	Fixture.WriteSource("Pixel.hlsl", "error");
+	ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+	bool Threw = false;
+	try
+	{
+		Cache.Resolve(Fixture.Requests, 3);
+	}
+	catch (const std::runtime_error& Error)
+	{
+		Threw = strstr(Error.what(), "error X3000") != nullptr;
+	}
+	CHECK(Threw);
+}
+
+// Stale shaders compile concurrently; results still come back in request order
+TEST_CASE(StaleShadersCompileAcrossTheJobSystem)
+{
+	ShaderFixture Fixture("Jobs");
+	JobSystem Jobs(3);
+	ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+	const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Fixture.Requests, 3, &Jobs);
+	REQUIRE(Bytecode.size() == 3);
+	CHECK(ToString(Bytecode[0]).compare(0, 13, "VSMain|vs_5_0") == 0);
+	CHECK(ToString(Bytecode[1]) == "PSMain|ps_5_0|0|pixel");
+	CHECK(ToString(Bytecode[2]) == "PSMain|ps_5_0|1|pixel");
+	CHECK(Fixture.Compiler.CompileCount == 3);
+}
+
+TEST_CASE(DamagedPacksLoadEmpty)
+{
+	ShaderFixture Fixture("Damaged");
+	{
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		Cache.Resolve(Fixture.Requests, 3);
+		CHECK(Cache.Save());
+	}
+
+	MappedFile Pack;
+	REQUIRE(Pack.Open(Fixture.PackPath));
+	const std::vector<uint8_t> Original(Pack.GetData(), Pack.GetData() + Pack.GetSize());
+	Pack.Close();
+
+	// Truncated, wrong version, and an entry whose bytecode runs past the end
+	std::vector<std::vector<uint8_t>> Damaged(3, Original);
+	Damaged[0].resize(Original.size() / 2);
+	Damaged[1][4] ^= 0xFF;
+	memset(&Damaged[2][24 + 16], 0xFF, 8);
+	for (const std::vector<uint8_t>& Contents : Damaged)
+	{
+		REQUIRE(WriteFileAtomically(Fixture.PackPath, Contents.data(), Contents.size()));
+		ShaderCache Cache(Fixture.PackPath, "stub 1.0", Fixture.GetCompiler());
+		CHECK(!Cache.Load());
+
+		// A damaged pack only costs a recompile
+		const std::vector<ShaderBytecode> Bytecode = Cache.Resolve(Fixture.Requests, 3);
+		CHECK(ToString(Bytecode[2]) == "PSMain|ps_5_0|1|pixel");
+	}
+	CHECK(Fixture.Compiler.CompileCount == 12);
+}
@@ -0,0 +1,171 @@
+#include "ShaderHotReloader.h"
+#include "TestFramework.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Frames are paced like a 60 Hz swap chain. The reloader waits for the directory to settle for 50 ms and then
+// compiles, so a swap within 15 frames leaves room for a busy machine.
+static const uint32_t FrameMilliseconds = 16;
+static const uint32_t MaximumSwapFrames = 15;
+
+static void WriteText(const std::string& Path, const std::string& Text)
+{
+	REQUIRE(WriteFileAtomically(Path, Text.data(), Text.size()));
+}
+
+// Bytecode is the source text; a source containing "error" fails to compile
+static ShaderCompileResult CompileText(const ShaderCompileRequest& Request)
+{
+	ShaderCompileResult Result;
+	MappedFile Source;
+	if (!Source.Open(Request.Path)) return Result;
+
+	Result.Bytecode.assign(Source.GetData(), Source.GetData() + Source.GetSize());
+	const std::string Text(Result.Bytecode.begin(), Result.Bytecode.end());
+	if (Text.find("error") != std::string::npos)
+	{
+		Result.Messages = Request.Path + "(1): error X3000: syntax error";
+		return Result;
+	}
+	Result.Succeeded = true;
+	return Result;
+}
+
+// A watched directory of its own holding one program, with its pack outside so saves do not wake the watcher. The
+// renderer side copies D3D12RenderDevice: the rebuild callback publishes under a mutex and raises a flag, and each
+// frame swaps in whatever was published.
+struct ReloadFixture
+{
+	std::string Directory;
+	ShaderCache Cache;
+	std::unique_ptr<ShaderHotReloader> Reloader;
+
+	std::mutex PublishedMutex;
+	std::string Published;
+	std::atomic<bool> Reloaded{ false };
+	std::atomic<uint32_t> Errors{ 0 };
+	std::string Current;
+
+	explicit ReloadFixture(const char* Name) :
+		Directory(GetTestTemporaryDirectory() + "ShaderHotReloaderTests" + Name),
+		Cache(Directory + ".pack", "text", CompileText)
+	{
+#ifdef _WIN32
+		_mkdir(Directory.c_str());
+#else
+		mkdir(Directory.c_str(), 0755);
+#endif
+		WriteText(Directory + "/Vertex.hlsl", "vertex 1");
+		WriteText(Directory + "/Pixel.hlsl", "pixel 1");
+
+		ShaderProgram Program;
+		Program.Requests.push_back({ Directory + "/Vertex.hlsl", "VSMain", "vs_5_0", 0 });
+		Program.Requests.push_back({ Directory + "/Pixel.hlsl", "PSMain", "ps_5_0", 0 });
+		Cache.Load();
+		const std::vector<ShaderBytecode> Initial = Cache.Resolve(Program.Requests.data(), 2);
+		Current.assign(reinterpret_cast<const char*>(Initial[1].Data), Initial[1].Size);
+		Cache.Save();
+
+		Program.Rebuild = [this](const std::vector<ShaderBytecode>& Bytecode)
+		{
+			std::lock_guard<std::mutex> Lock(PublishedMutex);
+			Published.assign(reinterpret_cast<const char*>(Bytecode[1].Data), Bytecode[1].Size);
+			Reloaded.store(true, std::memory_order_release);
+		};
+		Reloader = std::make_unique<ShaderHotReloader>(Directory, Cache, nullptr, [this](const std::string&) { Errors++; });
+		Reloader->AddProgram(std::move(Program));
+		Reloader->Start();
+	}
+
+	// The rebuild callback uses the members declared after the reloader
+	~ReloadFixture()
+	{
+		Reloader->Stop();
+	}
+
+	// Runs frames until the current pixel shader is Expected, returning how many it took, or zero if it never was
+	uint32_t RunFrames(uint32_t FrameCount, const std::string& Expected)
+	{
+		for (uint32_t Frame = 1; Frame <= FrameCount; Frame++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(FrameMilliseconds));
+
+			// The whole per-frame cost of hot reloading while nothing changes
+			if (Reloaded.load(std::memory_order_acquire))
+			{
+				std::lock_guard<std::mutex> Lock(PublishedMutex);
+				Current = Published;
+				Reloaded.store(false, std::memory_order_relaxed);
+			}
+			if (Current == Expected) return Frame;
+		}
+		return 0;
+	}
+};
+
+TEST_CASE(EditedShadersSwapWithinBoundedFrames)
+{
+	ReloadFixture Fixture("Swap");
+
+	// Idle frames never wake the reloader
+	CHECK(Fixture.RunFrames(10, "") == 0);
+	CHECK(Fixture.Reloader->GetStatistics().Checks == 0);
+
+	WriteText(Fixture.Directory + "/Pixel.hlsl", "pixel 2");
+	const uint32_t Frames = Fixture.RunFrames(MaximumSwapFrames, "pixel 2");
+	CHECK(Frames > 0 && Frames <= MaximumSwapFrames);
+
+	Fixture.Reloader->Stop();
+	const ShaderReloadStatistics Statistics = Fixture.Reloader->GetStatistics();
+	CHECK(Statistics.Reloads == 1 && Statistics.Failures == 0);
+}
+
+TEST_CASE(CompileErrorsKeepThePreviousShader)
+{
+	ReloadFixture Fixture("Error");
+	WriteText(Fixture.Directory + "/Pixel.hlsl", "error");
+	CHECK(Fixture.RunFrames(MaximumSwapFrames, "error") == 0);
+	CHECK(Fixture.Current == "pixel 1");
+	CHECK(Fixture.Errors == 1);
+
+	// Fixing the error swaps as usual
+	WriteText(Fixture.Directory + "/Pixel.hlsl", "pixel 3");
+	CHECK(Fixture.RunFrames(MaximumSwapFrames, "pixel 3") > 0);
+
+	Fixture.Reloader->Stop();
+	const ShaderReloadStatistics Statistics = Fixture.Reloader->GetStatistics();
+	CHECK(Statistics.Reloads == 1 && Statistics.Failures == 1);
+}
+
+// Other files in the directory are looked at but rebuild nothing
+TEST_CASE(UnrelatedFilesDoNotRebuild)
+{
+	ReloadFixture Fixture("Unrelated");
+	WriteText(Fixture.Directory + "/Notes.txt", "not a shader");
+	Fixture.RunFrames(MaximumSwapFrames, "");
+
+	Fixture.Reloader->Stop();
+	const ShaderReloadStatistics Statistics = Fixture.Reloader->GetStatistics();
+	CHECK(Statistics.Checks >= 1);
+	CHECK(Statistics.Reloads == 0);
+	CHECK(!Fixture.Reloaded.load());
+}
+
+TEST_CASE(StopWakesAnIdleReloader)
+{
+	ReloadFixture Fixture("Stop");
+	const auto Start = std::chrono::steady_clock::now();
+	Fixture.Reloader->Stop();
+	CHECK(std::chrono::steady_clock::now() - Start < std::chrono::milliseconds(500));
+	CHECK(Fixture.Reloader->GetStatistics().Checks == 0);
+}
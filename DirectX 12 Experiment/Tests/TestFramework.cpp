@@ -0,0 +1,79 @@
+#include "TestFramework.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct RegisteredTest
+{
+	const char* Name;
+	TestFunction Function;
+};
+
+// Function local so registrations from other translation units never run before it exists
+static std::vector<RegisteredTest>& GetRegisteredTests()
+{
+	static std::vector<RegisteredTest> Tests;
+	return Tests;
+}
+
+static uint32_t FailedChecks = 0;
+
+TestRegistration::TestRegistration(const char* Name, TestFunction Function)
+{
+	GetRegisteredTests().push_back({ Name, Function });
+}
+
+void ReportCheckFailure(const char* File, int Line, const char* Expression)
+{
+	FailedChecks++;
+	fprintf(stderr, "%s:%d: check failed: %s\n", File, Line, Expression);
+}
+
+std::string GetTestTemporaryDirectory()
+{
+#ifdef _WIN32
+	const char* Directory = std::getenv("TEMP");
+	return Directory != nullptr ? std::string(Directory) + "\\" : std::string(".\\");
+#else
+	const char* Directory = std::getenv("TMPDIR");
+	return Directory != nullptr ? std::string(Directory) + "/" : std::string("/tmp/");
+#endif
+}
+
+// Runs every registered case, or only those whose names contain the first argument
+int main(int NumberOfArguments, char* Arguments[])
+{
+	const char* Filter = NumberOfArguments > 1 ? Arguments[1] : "";
+	uint32_t FailedTests = 0;
+	uint32_t RunTests = 0;
+	for (const RegisteredTest& Test : GetRegisteredTests())
+	{
+		if (strstr(Test.Name, Filter) == nullptr) continue;
+
+		const uint32_t FailuresBefore = FailedChecks;
+		const auto Start = std::chrono::steady_clock::now();
+		try
+		{
+			Test.Function();
+		}
+		catch (const TestAbort&)
+		{
+		}
+		catch (const std::exception& Error)
+		{
+			ReportCheckFailure(Test.Name, 0, Error.what());
+		}
+		const double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+		RunTests++;
+		const bool Passed = FailedChecks == FailuresBefore;
+		FailedTests += Passed ? 0 : 1;
+		printf("%s %s (%.1f ms)\n", Passed ? "[  OK  ]" : "[FAILED]", Test.Name, Milliseconds);
+	}
+
+	printf("%u of %u tests passed\n", RunTests - FailedTests, RunTests);
+	return FailedTests == 0 && RunTests != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
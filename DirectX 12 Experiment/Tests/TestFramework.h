@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Self-registering test cases, linked into one executable per tested module. A failed CHECK reports and the case
+// carries on, a failed REQUIRE ends the case; the executable fails if any check did.
+using TestFunction = void (*)();
+
+class TestRegistration
+{
+public:
+	TestRegistration(const char* Name, TestFunction Function);
+};
+
+void ReportCheckFailure(const char* File, int Line, const char* Expression);
+
+// Thrown by REQUIRE to leave the running case
+struct TestAbort
+{
+};
+
+#define TEST_CASE(Name) \
+	static void Name(); \
+	static TestRegistration Name##Registration(#Name, Name); \
+	static void Name()
+
+#define CHECK(Expression) \
+	do \
+	{ \
+		if (!(Expression)) ReportCheckFailure(__FILE__, __LINE__, #Expression); \
+	} while (false)
+
+#define REQUIRE(Expression) \
+	do \
+	{ \
+		if (!(Expression)) \
+		{ \
+			ReportCheckFailure(__FILE__, __LINE__, #Expression); \
+			throw TestAbort(); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(Actual, Expected, Tolerance) CHECK(std::fabs(static_cast<double>(Actual) - static_cast<double>(Expected)) <= static_cast<double>(Tolerance))
+
+#define CHECK_THROWS(Expression) \
+	do \
+	{ \
+		bool Threw = false; \
+		try \
+		{ \
+			Expression; \
+		} \
+		catch (const std::exception&) \
+		{ \
+			Threw = true; \
+		} \
+		if (!Threw) ReportCheckFailure(__FILE__, __LINE__, "throws: " #Expression); \
+	} while (false)
+
+// Directory for the files tests write, with a trailing separator; each test picks names of its own
+std::string GetTestTemporaryDirectory();
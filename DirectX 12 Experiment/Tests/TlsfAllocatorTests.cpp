@@ -0,0 +1,181 @@
+#include "TestFramework.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static const uint64_t PlacementAlignment = 64 * 1024;
+
+TEST_CASE(AllocationsAreRoundedAlignedAndDisjoint)
+{
+	TlsfAllocator Allocator(1024 * 1024);
+	const TlsfAllocator::Handle First = Allocator.Allocate(100, 1);
+	const TlsfAllocator::Handle Second = Allocator.Allocate(300, 4096);
+	REQUIRE(First != TlsfAllocator::InvalidHandle && Second != TlsfAllocator::InvalidHandle);
+
+	CHECK(Allocator.GetOffset(First) == 0);
+	CHECK(Allocator.GetSize(First) == 256);
+	CHECK(Allocator.GetOffset(Second) == 4096);
+	CHECK(Allocator.GetSize(Second) == 512);
+
+	const TlsfStatistics Statistics = Allocator.GetStatistics();
+	CHECK(Statistics.UsedBytes == 768);
+	CHECK(Statistics.AllocationCount == 2);
+
+	// The padding in front of the aligned allocation stays free
+	CHECK(Statistics.FreeBlockCount == 2);
+	CHECK(Statistics.FreeBytes == 1024 * 1024 - 768);
+}
+
+TEST_CASE(FreeingMergesNeighbouringBlocks)
+{
+	TlsfAllocator Allocator(64 * 1024);
+	TlsfAllocator::Handle Handles[4];
+	for (TlsfAllocator::Handle& Handle : Handles)
+	{
+		Handle = Allocator.Allocate(4096, 1);
+		REQUIRE(Handle != TlsfAllocator::InvalidHandle);
+	}
+
+	Allocator.Free(Handles[1]);
+	Allocator.Free(Handles[3]);
+	CHECK(Allocator.GetStatistics().FreeBlockCount == 2);
+	CHECK(Allocator.GetStatistics().LargestFreeBlock == 64 * 1024 - 3 * 4096);
+	CHECK(Allocator.GetStatistics().GetFragmentation() > 0.0);
+
+	Allocator.Free(Handles[2]);
+	CHECK(Allocator.GetStatistics().FreeBlockCount == 1);
+	CHECK(Allocator.GetStatistics().LargestFreeBlock == 64 * 1024 - 4096);
+	Allocator.Free(Handles[0]);
+	const TlsfStatistics Statistics = Allocator.GetStatistics();
+	CHECK(Statistics.FreeBlockCount == 1);
+	CHECK(Statistics.LargestFreeBlock == 64 * 1024);
+	CHECK(Statistics.UsedBytes == 0);
+	CHECK(Statistics.PeakUsedBytes == 4 * 4096);
+	CHECK(Statistics.GetFragmentation() == 0.0);
+}
+
+TEST_CASE(FullAllocatorReturnsInvalidHandles)
+{
+	TlsfAllocator Allocator(8192);
+	CHECK(Allocator.Allocate(8193, 1) == TlsfAllocator::InvalidHandle);
+	const TlsfAllocator::Handle Everything = Allocator.Allocate(8192, 1);
+	CHECK(Everything != TlsfAllocator::InvalidHandle);
+	CHECK(Allocator.Allocate(1, 1) == TlsfAllocator::InvalidHandle);
+
+	Allocator.Free(Everything);
+	CHECK(Allocator.Allocate(1, 1) != TlsfAllocator::InvalidHandle);
+}
+
+// Capacities that are not on a size class boundary used to fail an allocation of the whole range
+TEST_CASE(AllocationsMayFillAWholeBlockOffTheSizeClassBoundaries)
+{
+	const uint64_t Capacity = 65 * 1024 * 1024 + 5 * PlacementAlignment;
+	TlsfAllocator Allocator(Capacity, PlacementAlignment);
+	const TlsfAllocator::Handle Everything = Allocator.Allocate(Capacity, PlacementAlignment);
+	REQUIRE(Everything != TlsfAllocator::InvalidHandle);
+	CHECK(Allocator.GetOffset(Everything) == 0);
+	CHECK(Allocator.GetSize(Everything) == Capacity);
+}
+
+// A heap sized like D3D12HeapAllocator's dedicated heaps: the request plus its alignment, less the placement alignment
+TEST_CASE(DedicatedHeapSizeFitsAnMsaaAlignedResource)
+{
+	const uint64_t MsaaAlignment = 4 * 1024 * 1024;
+	const uint64_t Size = 70 * 1024 * 1024 + 3 * PlacementAlignment;
+	const uint64_t DedicatedSize = (Size + MsaaAlignment - PlacementAlignment + MsaaAlignment - 1) & ~(MsaaAlignment - 1);
+
+	TlsfAllocator Allocator(DedicatedSize, PlacementAlignment);
+	const TlsfAllocator::Handle Resource = Allocator.Allocate(Size, MsaaAlignment);
+	REQUIRE(Resource != TlsfAllocator::InvalidHandle);
+	CHECK(Allocator.GetOffset(Resource) % MsaaAlignment == 0);
+	CHECK(Allocator.GetOffset(Resource) + Allocator.GetSize(Resource) <= DedicatedSize);
+}
+
+TEST_CASE(AllocationsAreVisitedInAddressOrder)
+{
+	TlsfAllocator Allocator(64 * 1024);
+	std::vector<TlsfAllocator::Handle> Handles;
+	for (uint32_t Index = 0; Index < 8; Index++)
+	{
+		Handles.push_back(Allocator.Allocate(1024, 1));
+	}
+	Allocator.Free(Handles[2]);
+	Allocator.Free(Handles[5]);
+
+	std::vector<uint64_t> Offsets;
+	Allocator.ForEachAllocation([&](TlsfAllocator::Handle Handle, uint64_t Offset, uint64_t Size)
+	{
+		CHECK(Allocator.GetOffset(Handle) == Offset);
+		CHECK(Size == 1024);
+		Offsets.push_back(Offset);
+	});
+	CHECK(Offsets.size() == 6);
+	CHECK(std::is_sorted(Offsets.begin(), Offsets.end()));
+	CHECK(std::find(Offsets.begin(), Offsets.end(), 2 * 1024) == Offsets.end());
+}
+
+struct LiveBlock
+{
+	TlsfAllocator::Handle Handle;
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+// Random allocations and frees checked against each other; freeing everything leaves one block again
+TEST_CASE(RandomAllocationsNeverOverlap)
+{
+	const uint64_t Capacity = 256 * 1024 * 1024;
+	TlsfAllocator Allocator(Capacity, PlacementAlignment);
+	std::mt19937 Random(11);
+	std::vector<LiveBlock> Live;
+	uint32_t FailedAllocations = 0;
+
+	for (uint32_t Step = 0; Step < 20000; Step++)
+	{
+		if (!Live.empty() && Random() % 5 < 2)
+		{
+			const size_t Index = Random() % Live.size();
+			Allocator.Free(Live[Index].Handle);
+			Live[Index] = Live.back();
+			Live.pop_back();
+			continue;
+		}
+
+		const uint64_t Size = (1 + Random() % 64) * PlacementAlignment - Random() % PlacementAlignment;
+		const uint64_t Alignment = Random() % 8 == 0 ? 4 * 1024 * 1024 : PlacementAlignment;
+		const TlsfAllocator::Handle Handle = Allocator.Allocate(Size, Alignment);
+		if (Handle == TlsfAllocator::InvalidHandle)
+		{
+			FailedAllocations++;
+			continue;
+		}
+
+		const LiveBlock Block = { Handle, Allocator.GetOffset(Handle), Allocator.GetSize(Handle) };
+		REQUIRE(Block.Offset % Alignment == 0);
+		REQUIRE(Block.Size >= Size);
+		REQUIRE(Block.Offset + Block.Size <= Capacity);
+		for (const LiveBlock& Other : Live)
+		{
+			REQUIRE(Block.Offset + Block.Size <= Other.Offset || Other.Offset + Other.Size <= Block.Offset);
+		}
+		Live.push_back(Block);
+	}
+
+	uint64_t LiveBytes = 0;
+	for (const LiveBlock& Block : Live)
+	{
+		LiveBytes += Block.Size;
+	}
+	CHECK(Allocator.GetStatistics().UsedBytes == LiveBytes);
+	CHECK(Allocator.GetStatistics().AllocationCount == Live.size());
+	CHECK(FailedAllocations > 0);
+
+	for (const LiveBlock& Block : Live)
+	{
+		Allocator.Free(Block.Handle);
+	}
+	CHECK(Allocator.GetStatistics().FreeBlockCount == 1);
+	CHECK(Allocator.GetStatistics().LargestFreeBlock == Capacity);
+}
@@ -0,0 +1,296 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static uint32_t FindLowestSetBit(uint64_t Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+	_BitScanForward64(&Index, Value);
+	return Index;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(Value));
+#endif
+}
+
+static uint32_t FindHighestSetBit(uint64_t Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+	_BitScanReverse64(&Index, Value);
+	return Index;
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(Value));
+#endif
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t Capacity, uint64_t Granularity) :
+	Capacity(Capacity & ~(Granularity - 1)),
+	Granularity(Granularity)
+{
+	for (uint32_t FirstLevel = 0; FirstLevel < FirstLevelCount; FirstLevel++)
+	{
+		for (uint32_t SecondLevel = 0; SecondLevel < SecondLevelCount; SecondLevel++)
+		{
+			FreeLists[FirstLevel][SecondLevel] = NoBlock;
+		}
+	}
+
+	// Block zero always starts at offset zero: splits keep the front half and merges keep the lower block
+	if (this->Capacity != 0)
+	{
+		InsertFree(CreateBlock(0, this->Capacity));
+	}
+}
+
+TlsfAllocator::Handle TlsfAllocator::Allocate(uint64_t Size, uint64_t Alignment)
+{
+	Size = (std::max<uint64_t>(Size, 1) + Granularity - 1) & ~(Granularity - 1);
+	Alignment = std::max(Alignment, Granularity);
+
+	// Blocks are already Granularity aligned, anything stricter needs room to slide forward
+	const uint64_t SearchSize = Size + (Alignment - Granularity);
+	if (SearchSize > Capacity) return InvalidHandle;
+
+	uint32_t BlockIndex = FindFreeBlock(SearchSize);
+	if (BlockIndex == NoBlock) return InvalidHandle;
+	RemoveFree(BlockIndex);
+
+	const uint64_t AlignedOffset = (Blocks[BlockIndex].Offset + Alignment - 1) & ~(Alignment - 1);
+	const uint64_t FrontPadding = AlignedOffset - Blocks[BlockIndex].Offset;
+	if (FrontPadding != 0)
+	{
+		const uint32_t AlignedBlock = Split(BlockIndex, FrontPadding);
+		InsertFree(BlockIndex);
+		BlockIndex = AlignedBlock;
+	}
+
+	if (Blocks[BlockIndex].Size > Size)
+	{
+		InsertFree(Split(BlockIndex, Size));
+	}
+
+	Blocks[BlockIndex].IsFree = false;
+	UsedBytes += Size;
+	PeakUsedBytes = std::max(PeakUsedBytes, UsedBytes);
+	AllocationCount++;
+	return BlockIndex;
+}
+
+void TlsfAllocator::Free(Handle Allocation)
+{
+	uint32_t BlockIndex = Allocation;
+	Blocks[BlockIndex].IsFree = true;
+	UsedBytes -= Blocks[BlockIndex].Size;
+	AllocationCount--;
+
+	const uint32_t Previous = Blocks[BlockIndex].PreviousPhysical;
+	if (Previous != NoBlock && Blocks[Previous].IsFree)
+	{
+		RemoveFree(Previous);
+		Blocks[Previous].Size += Blocks[BlockIndex].Size;
+		Blocks[Previous].NextPhysical = Blocks[BlockIndex].NextPhysical;
+		if (Blocks[BlockIndex].NextPhysical != NoBlock)
+		{
+			Blocks[Blocks[BlockIndex].NextPhysical].PreviousPhysical = Previous;
+		}
+		ReleaseBlock(BlockIndex);
+		BlockIndex = Previous;
+	}
+
+	const uint32_t Next = Blocks[BlockIndex].NextPhysical;
+	if (Next != NoBlock && Blocks[Next].IsFree)
+	{
+		RemoveFree(Next);
+		Blocks[BlockIndex].Size += Blocks[Next].Size;
+		Blocks[BlockIndex].NextPhysical = Blocks[Next].NextPhysical;
+		if (Blocks[Next].NextPhysical != NoBlock)
+		{
+			Blocks[Blocks[Next].NextPhysical].PreviousPhysical = BlockIndex;
+		}
+		ReleaseBlock(Next);
+	}
+
+	InsertFree(BlockIndex);
+}
+
+TlsfStatistics TlsfAllocator::GetStatistics() const
+{
+	TlsfStatistics Statistics;
+	Statistics.Capacity = Capacity;
+	Statistics.UsedBytes = UsedBytes;
+	Statistics.PeakUsedBytes = PeakUsedBytes;
+	Statistics.FreeBytes = Capacity - UsedBytes;
+	Statistics.AllocationCount = AllocationCount;
+
+	for (uint32_t BlockIndex = Blocks.empty() ? NoBlock : 0; BlockIndex != NoBlock; BlockIndex = Blocks[BlockIndex].NextPhysical)
+	{
+		if (!Blocks[BlockIndex].IsFree) continue;
+		Statistics.FreeBlockCount++;
+		Statistics.LargestFreeBlock = std::max(Statistics.LargestFreeBlock, Blocks[BlockIndex].Size);
+	}
+	return Statistics;
+}
+
+void TlsfAllocator::ForEachAllocation(const std::function<void(Handle Allocation, uint64_t Offset, uint64_t Size)>& Visitor) const
+{
+	for (uint32_t BlockIndex = Blocks.empty() ? NoBlock : 0; BlockIndex != NoBlock; BlockIndex = Blocks[BlockIndex].NextPhysical)
+	{
+		if (!Blocks[BlockIndex].IsFree)
+		{
+			Visitor(BlockIndex, Blocks[BlockIndex].Offset, Blocks[BlockIndex].Size);
+		}
+	}
+}
+
+void TlsfAllocator::MapSize(uint64_t Size, uint32_t& FirstLevel, uint32_t& SecondLevel)
+{
+	if (Size < SecondLevelCount)
+	{
+		FirstLevel = 0;
+		SecondLevel = static_cast<uint32_t>(Size);
+		return;
+	}
+
+	FirstLevel = FindHighestSetBit(Size);
+	SecondLevel = static_cast<uint32_t>(Size >> (FirstLevel - SecondLevelBits)) - SecondLevelCount;
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t Size) const
+{
+	// Round up to the start of the next size class so any block found is guaranteed to fit
+	uint64_t RoundedSize = Size;
+	if (Size >= SecondLevelCount)
+	{
+		RoundedSize += (1ull << (FindHighestSetBit(Size) - SecondLevelBits)) - 1;
+	}
+
+	uint32_t FirstLevel, SecondLevel;
+	MapSize(RoundedSize, FirstLevel, SecondLevel);
+	if (FirstLevel < FirstLevelCount)
+	{
+		uint32_t SecondLevelMap = SecondLevelBitmaps[FirstLevel] & (~0u << SecondLevel);
+		if (SecondLevelMap == 0)
+		{
+			const uint64_t FirstLevelMap = FirstLevel + 1 < FirstLevelCount ? FirstLevelBitmap & (~0ull << (FirstLevel + 1)) : 0;
+			if (FirstLevelMap != 0)
+			{
+				FirstLevel = FindLowestSetBit(FirstLevelMap);
+				SecondLevelMap = SecondLevelBitmaps[FirstLevel];
+			}
+		}
+		if (SecondLevelMap != 0)
+		{
+			return FreeLists[FirstLevel][FindLowestSetBit(SecondLevelMap)];
+		}
+	}
+
+	// Blocks in the request's own class may still fit, such as a dedicated heap sized exactly for its one allocation
+	MapSize(Size, FirstLevel, SecondLevel);
+	for (uint32_t BlockIndex = FreeLists[FirstLevel][SecondLevel]; BlockIndex != NoBlock; BlockIndex = Blocks[BlockIndex].NextFree)
+	{
+		if (Blocks[BlockIndex].Size >= Size) return BlockIndex;
+	}
+	return NoBlock;
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t Offset, uint64_t Size)
+{
+	uint32_t BlockIndex;
+	if (!UnusedBlocks.empty())
+	{
+		BlockIndex = UnusedBlocks.back();
+		UnusedBlocks.pop_back();
+	}
+	else
+	{
+		BlockIndex = static_cast<uint32_t>(Blocks.size());
+		Blocks.emplace_back();
+	}
+
+	Block& NewBlock = Blocks[BlockIndex];
+	NewBlock.Offset = Offset;
+	NewBlock.Size = Size;
+	NewBlock.PreviousPhysical = NoBlock;
+	NewBlock.NextPhysical = NoBlock;
+	NewBlock.PreviousFree = NoBlock;
+	NewBlock.NextFree = NoBlock;
+	NewBlock.IsFree = true;
+	NewBlock.IsUnused = false;
+	return BlockIndex;
+}
+
+void TlsfAllocator::ReleaseBlock(uint32_t BlockIndex)
+{
+	Blocks[BlockIndex].IsUnused = true;
+	Blocks[BlockIndex].IsFree = false;
+	UnusedBlocks.push_back(BlockIndex);
+}
+
+void TlsfAllocator::InsertFree(uint32_t BlockIndex)
+{
+	uint32_t FirstLevel, SecondLevel;
+	MapSize(Blocks[BlockIndex].Size, FirstLevel, SecondLevel);
+
+	const uint32_t Head = FreeLists[FirstLevel][SecondLevel];
+	Blocks[BlockIndex].IsFree = true;
+	Blocks[BlockIndex].PreviousFree = NoBlock;
+	Blocks[BlockIndex].NextFree = Head;
+	if (Head != NoBlock)
+	{
+		Blocks[Head].PreviousFree = BlockIndex;
+	}
+	FreeLists[FirstLevel][SecondLevel] = BlockIndex;
+
+	FirstLevelBitmap |= 1ull << FirstLevel;
+	SecondLevelBitmaps[FirstLevel] |= 1u << SecondLevel;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t BlockIndex)
+{
+	uint32_t FirstLevel, SecondLevel;
+	MapSize(Blocks[BlockIndex].Size, FirstLevel, SecondLevel);
+
+	const uint32_t Previous = Blocks[BlockIndex].PreviousFree;
+	const uint32_t Next = Blocks[BlockIndex].NextFree;
+	if (Previous != NoBlock)
+	{
+		Blocks[Previous].NextFree = Next;
+	}
+	else
+	{
+		FreeLists[FirstLevel][SecondLevel] = Next;
+	}
+	if (Next != NoBlock)
+	{
+		Blocks[Next].PreviousFree = Previous;
+	}
+
+	if (FreeLists[FirstLevel][SecondLevel] == NoBlock)
+	{
+		SecondLevelBitmaps[FirstLevel] &= ~(1u << SecondLevel);
+		if (SecondLevelBitmaps[FirstLevel] == 0)
+		{
+			FirstLevelBitmap &= ~(1ull << FirstLevel);
+		}
+	}
+}
+
+uint32_t TlsfAllocator::Split(uint32_t BlockIndex, uint64_t FirstSize)
+{
+	const uint32_t SecondBlock = CreateBlock(Blocks[BlockIndex].Offset + FirstSize, Blocks[BlockIndex].Size - FirstSize);
+	Blocks[BlockIndex].Size = FirstSize;
+
+	Blocks[SecondBlock].PreviousPhysical = BlockIndex;
+	Blocks[SecondBlock].NextPhysical = Blocks[BlockIndex].NextPhysical;
+	if (Blocks[BlockIndex].NextPhysical != NoBlock)
+	{
+		Blocks[Blocks[BlockIndex].NextPhysical].PreviousPhysical = SecondBlock;
+	}
+	Blocks[BlockIndex].NextPhysical = SecondBlock;
+	return SecondBlock;
+}
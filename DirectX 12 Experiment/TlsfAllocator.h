@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct TlsfStatistics
+{
+	uint64_t Capacity = 0;
+	uint64_t UsedBytes = 0;
+	uint64_t PeakUsedBytes = 0;
+	uint64_t FreeBytes = 0;
+	uint64_t LargestFreeBlock = 0;
+	uint32_t AllocationCount = 0;
+	uint32_t FreeBlockCount = 0;
+
+	// Zero when all free space is one block, approaching one as it splinters
+	double GetFragmentation() const { return FreeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(LargestFreeBlock) / static_cast<double>(FreeBytes); }
+};
+
+// Two-level segregated fit allocator over an abstract range of offsets. It never touches the memory
+// it manages, so the same code carves up GPU heaps and can be exercised entirely on the CPU.
+class TlsfAllocator
+{
+public:
+	using Handle = uint32_t;
+	static const Handle InvalidHandle = ~0u;
+
+	// Sizes are rounded up to Granularity, so every block starts Granularity aligned.
+	// Granularity and alignments must be powers of two.
+	TlsfAllocator(uint64_t Capacity, uint64_t Granularity = 256);
+
+	Handle Allocate(uint64_t Size, uint64_t Alignment);
+	void Free(Handle Allocation);
+
+	uint64_t GetOffset(Handle Allocation) const { return Blocks[Allocation].Offset; }
+	uint64_t GetSize(Handle Allocation) const { return Blocks[Allocation].Size; }
+	uint64_t GetCapacity() const { return Capacity; }
+	TlsfStatistics GetStatistics() const;
+
+	// Visits live allocations in address order, used to plan defragmentation
+	void ForEachAllocation(const std::function<void(Handle Allocation, uint64_t Offset, uint64_t Size)>& Visitor) const;
+
+private:
+	static const uint32_t SecondLevelBits = 4;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelBits;
+	static const uint32_t FirstLevelCount = 64;
+	static const uint32_t NoBlock = ~0u;
+
+	struct Block
+	{
+		uint64_t Offset;
+		uint64_t Size;
+		uint32_t PreviousPhysical;
+		uint32_t NextPhysical;
+		uint32_t PreviousFree;
+		uint32_t NextFree;
+		bool IsFree;
+		bool IsUnused;
+	};
+
+	uint64_t Capacity;
+	uint64_t Granularity;
+	uint64_t UsedBytes = 0;
+	uint64_t PeakUsedBytes = 0;
+	uint32_t AllocationCount = 0;
+
+	std::vector<Block> Blocks;
+	std::vector<uint32_t> UnusedBlocks;
+
+	uint64_t FirstLevelBitmap = 0;
+	uint32_t SecondLevelBitmaps[FirstLevelCount] = {};
+	uint32_t FreeLists[FirstLevelCount][SecondLevelCount];
+
+	static void MapSize(uint64_t Size, uint32_t& FirstLevel, uint32_t& SecondLevel);
+	uint32_t FindFreeBlock(uint64_t Size) const;
+	uint32_t CreateBlock(uint64_t Offset, uint64_t Size);
+	void ReleaseBlock(uint32_t BlockIndex);
+	void InsertFree(uint32_t BlockIndex);
+	void RemoveFree(uint32_t BlockIndex);
+	uint32_t Split(uint32_t BlockIndex, uint64_t FirstSize);
+};
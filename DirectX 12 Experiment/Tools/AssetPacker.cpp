@@ -0,0 +1,188 @@
+// Builds and lists asset archives. Not part of the application project; the portable CMake build produces it.
+// Load throughput is measured by Benchmarks/AssetArchiveBenchmark.
+//
+//   AssetPacker pack <archive> [--lz4] [--format rgba8|bc1|bc3|bc7] [--kaiser] entries...
+//     --checker <name> <size>                  the application's procedural checkerboard
+//     --texture <name> <width> <height> <file> raw RGBA8 pixels, rows tightly packed
+//     <name>=<file>                            any file as a blob
+//   AssetPacker list <archive>
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include "ProceduralTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct PackOptions
+{
+	TextureFormat Format = TextureFormat::Rgba8;
+	MipGenerationOptions Mips;
+};
+
+static std::vector<uint8_t> ReadWholeFile(const std::string& Path)
+{
+	FILE* File = fopen(Path.c_str(), "rb");
+	if (File == nullptr) throw std::runtime_error("Cannot open " + Path);
+	std::vector<uint8_t> Data;
+	uint8_t Buffer[64 * 1024];
+	size_t Count;
+	while ((Count = fread(Buffer, 1, sizeof(Buffer), File)) != 0)
+	{
+		Data.insert(Data.end(), Buffer, Buffer + Count);
+	}
+	fclose(File);
+	return Data;
+}
+
+static TextureFormat ParseFormat(const std::string& Name)
+{
+	if (Name == "rgba8") return TextureFormat::Rgba8;
+	if (Name == "bc1") return TextureFormat::Bc1;
+	if (Name == "bc3") return TextureFormat::Bc3;
+	if (Name == "bc7") return TextureFormat::Bc7;
+	throw std::runtime_error("Unknown format " + Name);
+}
+
+static const char* GetFormatName(TextureFormat Format)
+{
+	switch (Format)
+	{
+	case TextureFormat::Bc1: return "bc1";
+	case TextureFormat::Bc3: return "bc3";
+	case TextureFormat::Bc7: return "bc7";
+	default: return "rgba8";
+	}
+}
+
+static double GetMillisecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+// Level zero is copied into an RGBA8 chain with the archive's layout, the rest is filtered and, for block
+// compressed formats, encoded into a second chain, all the way the streamer does it at runtime
+static void AddTexture(AssetArchiveWriter& Writer, const std::string& Name, uint32_t Width, uint32_t Height, const uint8_t* Pixels, const PackOptions& Options, JobSystem& Jobs)
+{
+	const uint32_t LevelCount = GetFullMipLevelCount(Width, Height);
+	TextureLevelLayout PixelLevels[MaximumMipLevelCount];
+	std::vector<uint8_t> PixelChain(GetTextureLevelLayouts(TextureFormat::Rgba8, Width, Height, LevelCount, AssetArchiveRowAlignment, AssetArchiveLevelAlignment, PixelLevels));
+	for (uint32_t Row = 0; Row < Height; Row++)
+	{
+		memcpy(&PixelChain[static_cast<size_t>(Row) * PixelLevels[0].RowPitch], Pixels + static_cast<size_t>(Row) * Width * 4, Width * 4);
+	}
+	GenerateMipChain(PixelChain.data(), PixelLevels, LevelCount, Options.Mips, &Jobs);
+
+	if (!IsBlockCompressed(Options.Format))
+	{
+		Writer.AddTexture(Name, Options.Format, Width, Height, LevelCount, PixelChain.data());
+		return;
+	}
+
+	TextureLevelLayout BlockLevels[MaximumMipLevelCount];
+	std::vector<uint8_t> BlockChain(GetTextureLevelLayouts(Options.Format, Width, Height, LevelCount, AssetArchiveRowAlignment, AssetArchiveLevelAlignment, BlockLevels));
+	CompressTexture(Options.Format, PixelChain.data(), PixelLevels, BlockChain.data(), BlockLevels, LevelCount, BlockCompressionOptions(), &Jobs);
+	Writer.AddTexture(Name, Options.Format, Width, Height, LevelCount, BlockChain.data());
+}
+
+static int Pack(int NumberOfArguments, char* Arguments[])
+{
+	const std::string ArchivePath = Arguments[2];
+	ArchiveCompression Compression = ArchiveCompression::None;
+	PackOptions Options;
+	for (int ArgumentIndex = 3; ArgumentIndex < NumberOfArguments; ArgumentIndex++)
+	{
+		const std::string Argument = Arguments[ArgumentIndex];
+		if (Argument == "--lz4") Compression = ArchiveCompression::Lz4;
+		else if (Argument == "--kaiser") Options.Mips.Filter = MipFilter::Kaiser;
+		else if (Argument == "--format" && ArgumentIndex + 1 < NumberOfArguments) Options.Format = ParseFormat(Arguments[++ArgumentIndex]);
+	}
+
+	JobSystem Jobs;
+	AssetArchiveWriter Writer(Compression, 64 * 1024, &Jobs);
+	const auto PackStart = std::chrono::steady_clock::now();
+	for (int ArgumentIndex = 3; ArgumentIndex < NumberOfArguments; ArgumentIndex++)
+	{
+		const std::string Argument = Arguments[ArgumentIndex];
+		if (Argument == "--lz4" || Argument == "--kaiser") continue;
+		if (Argument == "--format")
+		{
+			ArgumentIndex++;
+		}
+		else if (Argument == "--checker" && ArgumentIndex + 2 < NumberOfArguments)
+		{
+			const std::string Name = Arguments[++ArgumentIndex];
+			const uint32_t Size = static_cast<uint32_t>(std::stoul(Arguments[++ArgumentIndex]));
+			ProceduralTextureDescription Checkerboard;
+			Checkerboard.Pattern = ProceduralPattern::Checker;
+			Checkerboard.Width = Size;
+			Checkerboard.Height = Size;
+			Checkerboard.CellSize = 32;
+			std::vector<uint8_t> Pixels(static_cast<size_t>(Size) * Size * 4);
+			GenerateProceduralTexture(Checkerboard, Pixels.data(), Size * 4, &Jobs);
+			AddTexture(Writer, Name, Size, Size, Pixels.data(), Options, Jobs);
+		}
+		else if (Argument == "--texture" && ArgumentIndex + 4 < NumberOfArguments)
+		{
+			const std::string Name = Arguments[++ArgumentIndex];
+			const uint32_t Width = static_cast<uint32_t>(std::stoul(Arguments[++ArgumentIndex]));
+			const uint32_t Height = static_cast<uint32_t>(std::stoul(Arguments[++ArgumentIndex]));
+			const std::vector<uint8_t> Pixels = ReadWholeFile(Arguments[++ArgumentIndex]);
+			if (Pixels.size() != static_cast<size_t>(Width) * Height * 4) throw std::runtime_error("Texture file size does not match " + Name);
+			AddTexture(Writer, Name, Width, Height, Pixels.data(), Options, Jobs);
+		}
+		else if (Argument.find('=') != std::string::npos)
+		{
+			const size_t Separator = Argument.find('=');
+			const std::vector<uint8_t> Data = ReadWholeFile(Argument.substr(Separator + 1));
+			Writer.AddBlob(Argument.substr(0, Separator), Data.data(), Data.size());
+		}
+		else
+		{
+			throw std::runtime_error("Unknown argument " + Argument);
+		}
+	}
+
+	if (!Writer.Write(ArchivePath)) throw std::runtime_error("Cannot write " + ArchivePath);
+	printf("%s: %llu bytes of assets in %llu bytes (%.3f) after %.1f ms\n", ArchivePath.c_str(), static_cast<unsigned long long>(Writer.GetDataSize()), static_cast<unsigned long long>(Writer.GetFileSize()),
+		static_cast<double>(Writer.GetFileSize()) / static_cast<double>(std::max<uint64_t>(Writer.GetDataSize(), 1)), GetMillisecondsSince(PackStart));
+	return 0;
+}
+
+static int List(const std::string& ArchivePath)
+{
+	AssetArchive Archive;
+	if (!Archive.Open(ArchivePath)) throw std::runtime_error("Cannot open archive " + ArchivePath);
+	for (uint32_t EntryIndex = 0; EntryIndex < Archive.GetEntryCount(); EntryIndex++)
+	{
+		const AssetArchiveEntry& Entry = Archive.GetEntry(EntryIndex);
+		printf("%-24s %10llu -> %10llu at %10llu", Archive.GetName(Entry).c_str(), static_cast<unsigned long long>(Entry.Size), static_cast<unsigned long long>(Entry.StoredSize), static_cast<unsigned long long>(Entry.Offset));
+		if (Entry.IsTexture())
+		{
+			printf("  %ux%u %s, %u levels", Entry.Width, Entry.Height, GetFormatName(Entry.Format), Entry.MipLevelCount);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+int main(int NumberOfArguments, char* Arguments[])
+{
+	try
+	{
+		const std::string Command = NumberOfArguments >= 3 ? Arguments[1] : "";
+		if (Command == "pack") return Pack(NumberOfArguments, Arguments);
+		if (Command == "list") return List(Arguments[2]);
+		fprintf(stderr, "usage: AssetPacker pack|list <archive> ...\n");
+		return 2;
+	}
+	catch (const std::exception& Error)
+	{
+		fprintf(stderr, "%s\n", Error.what());
+		return 1;
+	}
+}
@@ -0,0 +1,26 @@
+struct PixelInput
+{
+	float4 Position : SV_POSITION;
+	float2 UV : TEXCOORD;
+};
+
+// Index of the scene target in the bindless heap and the fraction of it the scene was rendered to
+cbuffer UpscaleConstants : register(b0)
+{
+	uint TextureIndex;
+	float2 UVScale;
+};
+
+Texture2D Textures[] : register(t0, space1);
+SamplerState LinearSampler : register(s1);
+
+float4 Main(PixelInput Input) : SV_TARGET
+{
+	uint Width;
+	uint Height;
+	Textures[TextureIndex].GetDimensions(Width, Height);
+
+	// Kept half a texel inside the rendered part, so filtering never blends in what lies beyond it
+	const float2 UV = min(Input.UV * UVScale, UVScale - 0.5f / float2(Width, Height));
+	return Textures[TextureIndex].SampleLevel(LinearSampler, UV, 0.0f);
+}
\ No newline at end of file
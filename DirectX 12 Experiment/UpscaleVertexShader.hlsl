@@ -0,0 +1,14 @@
+struct VertexOutput
+{
+	float4 Position : SV_POSITION;
+	float2 UV : TEXCOORD;
+};
+
+// One triangle covering the whole output, UVs run from zero at the top left to one at the bottom right
+VertexOutput Main(uint VertexId : SV_VertexID)
+{
+	VertexOutput Output;
+	Output.UV = float2((VertexId << 1) & 2, VertexId & 2);
+	Output.Position = float4(Output.UV * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	return Output;
+}
\ No newline at end of file
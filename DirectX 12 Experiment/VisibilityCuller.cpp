@@ -0,0 +1,427 @@
+#include "VisibilityCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+// Fixed size so the output never depends on the thread count
+static const uint32_t ObjectsPerChunk = 16384;
+
+// Points closer to the eye than this are treated as crossing the near plane
+static const float MinimumClipW = 1e-5f;
+
+static float EdgeFunction(float AX, float AY, float BX, float BY, float PX, float PY)
+{
+	return (BX - AX) * (PY - AY) - (BY - AY) * (PX - AX);
+}
+
+Frustum ExtractFrustum(const float ViewProjection[4][4])
+{
+	// Clip space bounds are -w <= x <= w, -w <= y <= w and 0 <= z <= w, each one a combination of matrix rows
+	static const float Signs[6][2] = { { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f }, { 1.0f, 2.0f }, { -1.0f, 2.0f } };
+
+	Frustum View;
+	for (uint32_t Plane = 0; Plane < 6; Plane++)
+	{
+		const float Sign = Signs[Plane][0];
+		const uint32_t Row = static_cast<uint32_t>(Signs[Plane][1]);
+		for (uint32_t Column = 0; Column < 4; Column++)
+		{
+			// The near plane is z >= 0 alone, every other plane is measured against w
+			const float W = Plane == 4 ? 0.0f : ViewProjection[3][Column];
+			View.Planes[Plane][Column] = W + Sign * ViewProjection[Row][Column];
+		}
+
+		const float Length = std::sqrt(View.Planes[Plane][0] * View.Planes[Plane][0] + View.Planes[Plane][1] * View.Planes[Plane][1] + View.Planes[Plane][2] * View.Planes[Plane][2]);
+		if (Length > 0.0f)
+		{
+			for (uint32_t Column = 0; Column < 4; Column++)
+			{
+				View.Planes[Plane][Column] /= Length;
+			}
+		}
+	}
+	return View;
+}
+
+OcclusionBuffer::OcclusionBuffer(uint32_t Width, uint32_t Height) :
+	Width(Width),
+	Height(Height)
+{
+	if (Width == 0 || Height == 0) throw std::runtime_error("Occlusion buffer needs a size");
+
+	uint32_t LevelWidth = Width;
+	uint32_t LevelHeight = Height;
+	for (;;)
+	{
+		Level NewLevel;
+		NewLevel.Width = LevelWidth;
+		NewLevel.Height = LevelHeight;
+		NewLevel.Depth.assign(static_cast<size_t>(LevelWidth) * LevelHeight, 1.0f);
+		Levels.push_back(std::move(NewLevel));
+		if (LevelWidth == 1 && LevelHeight == 1) break;
+
+		LevelWidth = (LevelWidth + 1) / 2;
+		LevelHeight = (LevelHeight + 1) / 2;
+	}
+	memset(ViewProjection, 0, sizeof(ViewProjection));
+}
+
+void OcclusionBuffer::Begin(const float NewViewProjection[4][4])
+{
+	memcpy(ViewProjection, NewViewProjection, sizeof(ViewProjection));
+	for (Level& Current : Levels)
+	{
+		std::fill(Current.Depth.begin(), Current.Depth.end(), 1.0f);
+	}
+}
+
+void OcclusionBuffer::RasterizeOccluders(const float* Positions, uint32_t TriangleCount)
+{
+	std::vector<float>& Depth = Levels[0].Depth;
+
+	for (uint32_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+	{
+		// Triangles crossing the near plane are dropped, which can only make fewer objects occluded
+		float X[3], Y[3], Z[3];
+		bool Projected = true;
+		for (uint32_t Corner = 0; Corner < 3 && Projected; Corner++)
+		{
+			Projected = ProjectToScreen(Positions + (3 * Triangle + Corner) * 3, X[Corner], Y[Corner], Z[Corner]);
+		}
+		if (!Projected) continue;
+
+		float Area = EdgeFunction(X[0], Y[0], X[1], Y[1], X[2], Y[2]);
+		if (std::fabs(Area) < 1e-6f) continue;
+		if (Area < 0.0f)
+		{
+			std::swap(X[1], X[2]);
+			std::swap(Y[1], Y[2]);
+			std::swap(Z[1], Z[2]);
+			Area = -Area;
+		}
+
+		// Depth is linear in screen space; each pixel stores the farthest depth the triangle reaches inside it
+		const float InverseArea = 1.0f / Area;
+		const float DepthX = ((Y[1] - Y[2]) * Z[0] + (Y[2] - Y[0]) * Z[1] + (Y[0] - Y[1]) * Z[2]) * InverseArea;
+		const float DepthY = ((X[2] - X[1]) * Z[0] + (X[0] - X[2]) * Z[1] + (X[1] - X[0]) * Z[2]) * InverseArea;
+		const float DepthReach = 0.5f * (std::fabs(DepthX) + std::fabs(DepthY));
+		const float FarthestDepth = std::max({ Z[0], Z[1], Z[2] });
+
+		const int MinimumX = std::max(0, static_cast<int>(std::floor(std::min({ X[0], X[1], X[2] }))));
+		const int MaximumX = std::min(static_cast<int>(Width) - 1, static_cast<int>(std::ceil(std::max({ X[0], X[1], X[2] }))));
+		const int MinimumY = std::max(0, static_cast<int>(std::floor(std::min({ Y[0], Y[1], Y[2] }))));
+		const int MaximumY = std::min(static_cast<int>(Height) - 1, static_cast<int>(std::ceil(std::max({ Y[0], Y[1], Y[2] }))));
+
+		for (int PixelY = MinimumY; PixelY <= MaximumY; PixelY++)
+		{
+			const float CenterY = static_cast<float>(PixelY) + 0.5f;
+			float* Row = &Depth[static_cast<size_t>(PixelY) * Width];
+			for (int PixelX = MinimumX; PixelX <= MaximumX; PixelX++)
+			{
+				const float CenterX = static_cast<float>(PixelX) + 0.5f;
+				const float W0 = EdgeFunction(X[1], Y[1], X[2], Y[2], CenterX, CenterY);
+				const float W1 = EdgeFunction(X[2], Y[2], X[0], Y[0], CenterX, CenterY);
+				const float W2 = EdgeFunction(X[0], Y[0], X[1], Y[1], CenterX, CenterY);
+				if (W0 < 0.0f || W1 < 0.0f || W2 < 0.0f) continue;
+
+				const float CenterDepth = (W0 * Z[0] + W1 * Z[1] + W2 * Z[2]) * InverseArea;
+				Row[PixelX] = std::min(Row[PixelX], std::min(CenterDepth + DepthReach, FarthestDepth));
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::Finish()
+{
+	for (size_t LevelIndex = 1; LevelIndex < Levels.size(); LevelIndex++)
+	{
+		const Level& Source = Levels[LevelIndex - 1];
+		Level& Destination = Levels[LevelIndex];
+		for (uint32_t Y = 0; Y < Destination.Height; Y++)
+		{
+			const uint32_t Y0 = 2 * Y;
+			const uint32_t Y1 = std::min(2 * Y + 1, Source.Height - 1);
+			for (uint32_t X = 0; X < Destination.Width; X++)
+			{
+				const uint32_t X0 = 2 * X;
+				const uint32_t X1 = std::min(2 * X + 1, Source.Width - 1);
+				Destination.Depth[static_cast<size_t>(Y) * Destination.Width + X] = std::max(
+					std::max(Source.Depth[static_cast<size_t>(Y0) * Source.Width + X0], Source.Depth[static_cast<size_t>(Y0) * Source.Width + X1]),
+					std::max(Source.Depth[static_cast<size_t>(Y1) * Source.Width + X0], Source.Depth[static_cast<size_t>(Y1) * Source.Width + X1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::IsOccluded(const float Minimum[3], const float Maximum[3]) const
+{
+	float MinimumX = static_cast<float>(Width), MaximumX = 0.0f;
+	float MinimumY = static_cast<float>(Height), MaximumY = 0.0f;
+	float NearestDepth = 1.0f;
+	for (uint32_t Corner = 0; Corner < 8; Corner++)
+	{
+		const float Position[3] = { (Corner & 1) ? Maximum[0] : Minimum[0], (Corner & 2) ? Maximum[1] : Minimum[1], (Corner & 4) ? Maximum[2] : Minimum[2] };
+		float X, Y, Depth;
+		if (!ProjectToScreen(Position, X, Y, Depth)) return false;
+
+		MinimumX = std::min(MinimumX, X);
+		MaximumX = std::max(MaximumX, X);
+		MinimumY = std::min(MinimumY, Y);
+		MaximumY = std::max(MaximumY, Y);
+		NearestDepth = std::min(NearestDepth, Depth);
+	}
+	if (MaximumX < 0.0f || MaximumY < 0.0f || MinimumX >= static_cast<float>(Width) || MinimumY >= static_cast<float>(Height)) return false;
+
+	const uint32_t X0 = static_cast<uint32_t>(std::max(MinimumX, 0.0f));
+	const uint32_t X1 = std::min(static_cast<uint32_t>(MaximumX), Width - 1);
+	const uint32_t Y0 = static_cast<uint32_t>(std::max(MinimumY, 0.0f));
+	const uint32_t Y1 = std::min(static_cast<uint32_t>(MaximumY), Height - 1);
+
+	// The finest level where the rectangle spans at most two texels each way
+	uint32_t LevelIndex = 0;
+	while (LevelIndex + 1 < Levels.size() && ((X1 >> LevelIndex) - (X0 >> LevelIndex) > 1 || (Y1 >> LevelIndex) - (Y0 >> LevelIndex) > 1))
+	{
+		LevelIndex++;
+	}
+
+	const Level& Coarse = Levels[LevelIndex];
+	for (uint32_t Y = Y0 >> LevelIndex; Y <= Y1 >> LevelIndex; Y++)
+	{
+		for (uint32_t X = X0 >> LevelIndex; X <= X1 >> LevelIndex; X++)
+		{
+			if (Coarse.Depth[static_cast<size_t>(Y) * Coarse.Width + X] >= NearestDepth) return false;
+		}
+	}
+	return true;
+}
+
+bool OcclusionBuffer::ProjectToScreen(const float Position[3], float& X, float& Y, float& Depth) const
+{
+	float Clip[4];
+	for (uint32_t Row = 0; Row < 4; Row++)
+	{
+		Clip[Row] = ViewProjection[Row][0] * Position[0] + ViewProjection[Row][1] * Position[1] + ViewProjection[Row][2] * Position[2] + ViewProjection[Row][3];
+	}
+	if (Clip[3] < MinimumClipW) return false;
+
+	const float InverseW = 1.0f / Clip[3];
+	X = (Clip[0] * InverseW * 0.5f + 0.5f) * static_cast<float>(Width);
+	Y = (0.5f - Clip[1] * InverseW * 0.5f) * static_cast<float>(Height);
+	Depth = Clip[2] * InverseW;
+	return true;
+}
+
+// The vector kernels evaluate the same expressions in the same order, so every path keeps the same objects
+static uint32_t CullRangeScalar(const CullBounds& Bounds, const Frustum& View, BoundsTest Test, uint32_t Begin, uint32_t End, uint32_t* Visible)
+{
+	uint32_t VisibleCount = 0;
+	for (uint32_t Index = Begin; Index < End; Index++)
+	{
+		bool Inside = true;
+		for (uint32_t Plane = 0; Plane < 6; Plane++)
+		{
+			const float* P = View.Planes[Plane];
+			const float Distance = P[0] * Bounds.CenterX[Index] + P[1] * Bounds.CenterY[Index] + P[2] * Bounds.CenterZ[Index] + P[3];
+			const float Reach = Test == BoundsTest::Sphere ? Bounds.Radius[Index] : std::fabs(P[0]) * Bounds.ExtentX[Index] + std::fabs(P[1]) * Bounds.ExtentY[Index] + std::fabs(P[2]) * Bounds.ExtentZ[Index];
+			Inside = Inside && Distance + Reach >= 0.0f;
+		}
+
+		Visible[VisibleCount] = Index;
+		VisibleCount += Inside ? 1 : 0;
+	}
+	return VisibleCount;
+}
+
+#if CPU_FEATURES_X86
+static uint32_t CullRangeSse2(const CullBounds& Bounds, const Frustum& View, BoundsTest Test, uint32_t Begin, uint32_t End, uint32_t* Visible)
+{
+	const uint32_t VectorEnd = Begin + ((End - Begin) & ~3u);
+	const __m128 Zero = _mm_setzero_ps();
+	uint32_t VisibleCount = 0;
+
+	for (uint32_t Index = Begin; Index < VectorEnd; Index += 4)
+	{
+		const __m128 X = _mm_loadu_ps(&Bounds.CenterX[Index]);
+		const __m128 Y = _mm_loadu_ps(&Bounds.CenterY[Index]);
+		const __m128 Z = _mm_loadu_ps(&Bounds.CenterZ[Index]);
+
+		__m128 Inside = _mm_cmpeq_ps(Zero, Zero);
+		for (uint32_t Plane = 0; Plane < 6; Plane++)
+		{
+			const float* P = View.Planes[Plane];
+			const __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[0]), X), _mm_mul_ps(_mm_set1_ps(P[1]), Y)), _mm_mul_ps(_mm_set1_ps(P[2]), Z)), _mm_set1_ps(P[3]));
+			__m128 Reach;
+			if (Test == BoundsTest::Sphere)
+			{
+				Reach = _mm_loadu_ps(&Bounds.Radius[Index]);
+			}
+			else
+			{
+				Reach = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(std::fabs(P[0])), _mm_loadu_ps(&Bounds.ExtentX[Index])),
+					_mm_mul_ps(_mm_set1_ps(std::fabs(P[1])), _mm_loadu_ps(&Bounds.ExtentY[Index]))),
+					_mm_mul_ps(_mm_set1_ps(std::fabs(P[2])), _mm_loadu_ps(&Bounds.ExtentZ[Index])));
+			}
+			Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(Distance, Reach), Zero));
+		}
+
+		// Branchless compaction, every lane is written and only the visible ones advance the output
+		const int Mask = _mm_movemask_ps(Inside);
+		for (uint32_t Lane = 0; Lane < 4; Lane++)
+		{
+			Visible[VisibleCount] = Index + Lane;
+			VisibleCount += (Mask >> Lane) & 1;
+		}
+	}
+
+	return VisibleCount + CullRangeScalar(Bounds, View, Test, VectorEnd, End, Visible + VisibleCount);
+}
+
+CPU_TARGET_AVX2 static uint32_t CullRangeAvx2(const CullBounds& Bounds, const Frustum& View, BoundsTest Test, uint32_t Begin, uint32_t End, uint32_t* Visible)
+{
+	const uint32_t VectorEnd = Begin + ((End - Begin) & ~7u);
+	const __m256 Zero = _mm256_setzero_ps();
+	uint32_t VisibleCount = 0;
+
+	for (uint32_t Index = Begin; Index < VectorEnd; Index += 8)
+	{
+		const __m256 X = _mm256_loadu_ps(&Bounds.CenterX[Index]);
+		const __m256 Y = _mm256_loadu_ps(&Bounds.CenterY[Index]);
+		const __m256 Z = _mm256_loadu_ps(&Bounds.CenterZ[Index]);
+
+		// No fused multiply-add, it would round differently from the other paths
+		__m256 Inside = _mm256_cmp_ps(Zero, Zero, _CMP_EQ_OQ);
+		for (uint32_t Plane = 0; Plane < 6; Plane++)
+		{
+			const float* P = View.Planes[Plane];
+			const __m256 Distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(P[0]), X), _mm256_mul_ps(_mm256_set1_ps(P[1]), Y)), _mm256_mul_ps(_mm256_set1_ps(P[2]), Z)), _mm256_set1_ps(P[3]));
+			__m256 Reach;
+			if (Test == BoundsTest::Sphere)
+			{
+				Reach = _mm256_loadu_ps(&Bounds.Radius[Index]);
+			}
+			else
+			{
+				Reach = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(std::fabs(P[0])), _mm256_loadu_ps(&Bounds.ExtentX[Index])),
+					_mm256_mul_ps(_mm256_set1_ps(std::fabs(P[1])), _mm256_loadu_ps(&Bounds.ExtentY[Index]))),
+					_mm256_mul_ps(_mm256_set1_ps(std::fabs(P[2])), _mm256_loadu_ps(&Bounds.ExtentZ[Index])));
+			}
+			Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(_mm256_add_ps(Distance, Reach), Zero, _CMP_GE_OQ));
+		}
+
+		const int Mask = _mm256_movemask_ps(Inside);
+		for (uint32_t Lane = 0; Lane < 8; Lane++)
+		{
+			Visible[VisibleCount] = Index + Lane;
+			VisibleCount += (Mask >> Lane) & 1;
+		}
+	}
+
+	return VisibleCount + CullRangeScalar(Bounds, View, Test, VectorEnd, End, Visible + VisibleCount);
+}
+#endif
+
+VisibilityCuller::VisibilityCuller(JobSystem* Jobs) :
+	Jobs(Jobs)
+{
+}
+
+void VisibilityCuller::Cull(const CullBounds& Bounds, const Frustum& View, const VisibilityOptions& Options, std::vector<uint32_t>& Visible)
+{
+	const uint32_t ObjectCount = static_cast<uint32_t>(Bounds.CenterX.size());
+	if (Bounds.CenterY.size() != ObjectCount || Bounds.CenterZ.size() != ObjectCount) throw std::runtime_error("Bounds arrays differ in length");
+	const bool NeedsExtents = Options.Test == BoundsTest::Box;
+	const bool NeedsRadius = Options.Test == BoundsTest::Sphere;
+	if (NeedsExtents && (Bounds.ExtentX.size() != ObjectCount || Bounds.ExtentY.size() != ObjectCount || Bounds.ExtentZ.size() != ObjectCount)) throw std::runtime_error("Box culling needs an extent for every object");
+	if (NeedsRadius && Bounds.Radius.size() != ObjectCount) throw std::runtime_error("Sphere culling needs a radius for every object");
+
+	const InstructionSet Instructions = ResolveInstructionSet(Options.MaximumInstructionSet);
+	const uint32_t ChunkCount = (ObjectCount + ObjectsPerChunk - 1) / ObjectsPerChunk;
+	Candidates.resize(ObjectCount);
+	ChunkVisibleCounts.assign(ChunkCount, 0);
+	ChunkOccludedCounts.assign(ChunkCount, 0);
+
+	const auto CullChunks = [&](uint32_t BeginChunk, uint32_t EndChunk)
+	{
+		for (uint32_t Chunk = BeginChunk; Chunk < EndChunk; Chunk++)
+		{
+			const uint32_t Begin = Chunk * ObjectsPerChunk;
+			const uint32_t End = std::min(ObjectCount, Begin + ObjectsPerChunk);
+			uint32_t* ChunkCandidates = Candidates.data() + Begin;
+
+			uint32_t Count;
+#if CPU_FEATURES_X86
+			if (Instructions == InstructionSet::Avx2)
+			{
+				Count = CullRangeAvx2(Bounds, View, Options.Test, Begin, End, ChunkCandidates);
+			}
+			else if (Instructions != InstructionSet::Scalar)
+			{
+				Count = CullRangeSse2(Bounds, View, Options.Test, Begin, End, ChunkCandidates);
+			}
+			else
+#endif
+			{
+				Count = CullRangeScalar(Bounds, View, Options.Test, Begin, End, ChunkCandidates);
+			}
+
+			// Survivors of the frustum are few and scattered over the screen, so occlusion is tested one by one
+			if (Options.Occlusion != nullptr)
+			{
+				uint32_t Kept = 0;
+				for (uint32_t Candidate = 0; Candidate < Count; Candidate++)
+				{
+					const uint32_t Index = ChunkCandidates[Candidate];
+					const float ExtentX = NeedsExtents ? Bounds.ExtentX[Index] : Bounds.Radius[Index];
+					const float ExtentY = NeedsExtents ? Bounds.ExtentY[Index] : Bounds.Radius[Index];
+					const float ExtentZ = NeedsExtents ? Bounds.ExtentZ[Index] : Bounds.Radius[Index];
+					const float Minimum[3] = { Bounds.CenterX[Index] - ExtentX, Bounds.CenterY[Index] - ExtentY, Bounds.CenterZ[Index] - ExtentZ };
+					const float Maximum[3] = { Bounds.CenterX[Index] + ExtentX, Bounds.CenterY[Index] + ExtentY, Bounds.CenterZ[Index] + ExtentZ };
+					if (Options.Occlusion->IsOccluded(Minimum, Maximum)) continue;
+
+					ChunkCandidates[Kept++] = Index;
+				}
+				ChunkOccludedCounts[Chunk] = Count - Kept;
+				Count = Kept;
+			}
+			ChunkVisibleCounts[Chunk] = Count;
+		}
+	};
+
+	if (Jobs != nullptr && ChunkCount > 1)
+	{
+		Jobs->ParallelFor(0, ChunkCount, 1, CullChunks);
+	}
+	else
+	{
+		CullChunks(0, ChunkCount);
+	}
+
+	Statistics = VisibilityStatistics();
+	Statistics.Tested = ObjectCount;
+	for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+	{
+		Statistics.Visible += ChunkVisibleCounts[Chunk];
+		Statistics.OcclusionCulled += ChunkOccludedCounts[Chunk];
+	}
+	Statistics.FrustumCulled = ObjectCount - Statistics.Visible - Statistics.OcclusionCulled;
+
+	// Chunks are packed in order, which keeps the indices ascending
+	Visible.resize(Statistics.Visible);
+	uint32_t Offset = 0;
+	for (uint32_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+	{
+		if (ChunkVisibleCounts[Chunk] == 0) continue;
+
+		memcpy(Visible.data() + Offset, Candidates.data() + static_cast<size_t>(Chunk) * ObjectsPerChunk, ChunkVisibleCounts[Chunk] * sizeof(uint32_t));
+		Offset += ChunkVisibleCounts[Chunk];
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Object bounds as separate arrays so that one load fills a whole vector register. The box test reads the
+// extents (half sizes of an axis-aligned box), the sphere test the radii; the unused arrays may stay empty.
+struct CullBounds
+{
+	std::vector<float> CenterX;
+	std::vector<float> CenterY;
+	std::vector<float> CenterZ;
+	std::vector<float> ExtentX;
+	std::vector<float> ExtentY;
+	std::vector<float> ExtentZ;
+	std::vector<float> Radius;
+};
+
+// Planes as a x + b y + c z + d, positive inside and with unit length normals
+struct Frustum
+{
+	float Planes[6][4];
+};
+
+// Planes of a projection with depth from 0 to 1, the matrix is row-major and transforms column vectors
+Frustum ExtractFrustum(const float ViewProjection[4][4]);
+
+// Occluders rendered in software at low resolution into a depth buffer plus a pyramid holding the farthest depth
+// of each 2x2 block, so an object is tested against a handful of texels whatever its size on screen.
+// Depth runs from 0 near to 1 far. Occluders cover the pixels whose centers they contain and store the farthest
+// depth they reach inside them; tests cover every texel an object's screen rectangle touches.
+class OcclusionBuffer
+{
+public:
+	OcclusionBuffer(uint32_t Width, uint32_t Height);
+
+	// Clears to the far plane and sets the transform used by the occluders and the tests that follow
+	void Begin(const float ViewProjection[4][4]);
+	// Triangle list of world space positions, three floats per vertex, in either winding
+	void RasterizeOccluders(const float* Positions, uint32_t TriangleCount);
+	// Builds the pyramid after the last occluder, tests are only valid afterwards
+	void Finish();
+
+	bool IsOccluded(const float Minimum[3], const float Maximum[3]) const;
+
+	uint32_t GetWidth() const { return Width; }
+	uint32_t GetHeight() const { return Height; }
+
+private:
+	struct Level
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<float> Depth;
+	};
+
+	uint32_t Width;
+	uint32_t Height;
+	float ViewProjection[4][4];
+	std::vector<Level> Levels;
+
+	bool ProjectToScreen(const float Position[3], float& X, float& Y, float& Depth) const;
+};
+
+enum class BoundsTest
+{
+	Sphere,
+	Box
+};
+
+struct VisibilityOptions
+{
+	BoundsTest Test = BoundsTest::Sphere;
+	InstructionSet MaximumInstructionSet = InstructionSet::Avx2;
+
+	// Tested after the frustum for objects inside it. Sphere bounds are tested as the cube around the sphere.
+	const OcclusionBuffer* Occlusion = nullptr;
+};
+
+struct VisibilityStatistics
+{
+	uint32_t Tested = 0;
+	uint32_t FrustumCulled = 0;
+	uint32_t OcclusionCulled = 0;
+	uint32_t Visible = 0;
+};
+
+// Frustum and occlusion culling over fixed-size chunks of objects, spread over the job system when one is given.
+// The output is the compact list of visible object indices in ascending order.
+class VisibilityCuller
+{
+public:
+	explicit VisibilityCuller(JobSystem* Jobs = nullptr);
+
+	VisibilityCuller(const VisibilityCuller&) = delete;
+	VisibilityCuller& operator=(const VisibilityCuller&) = delete;
+
+	void Cull(const CullBounds& Bounds, const Frustum& View, const VisibilityOptions& Options, std::vector<uint32_t>& Visible);
+
+	// Counts from the last Cull
+	const VisibilityStatistics& GetStatistics() const { return Statistics; }
+
+private:
+	JobSystem* Jobs;
+	VisibilityStatistics Statistics;
+
+	// Every chunk compacts its survivors at the start of its own range, which are then packed together
+	std::vector<uint32_t> Candidates;
+	std::vector<uint32_t> ChunkVisibleCounts;
+	std::vector<uint32_t> ChunkOccludedCounts;
+};